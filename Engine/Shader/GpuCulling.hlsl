@@ -0,0 +1,226 @@
+//	GPU駆動描画のカリングと ExecuteIndirect 用コマンドの詰め込み
+//	CPU 側の参照実装は GpuCullingReference。判定や詰め方を変えたら両方を直すこと。
+
+#ifndef HIZ_ENABLED
+#define HIZ_ENABLED 0
+#endif
+
+#define GROUP_SIZE 64
+
+#define CULL_FLAG_FRUSTUM 1
+#define CULL_FLAG_HIZ 2
+#define CULL_FLAG_EARLY 4
+#define CULL_FLAG_LATE 8
+#define CULL_FLAG_VISIBILITY_VALID 16
+#define OBJECT_FLAG_DISABLED 1
+
+//	GpuDrivenTypes.hpp の GpuObject と同じ並び
+struct GpuObject
+{
+	row_major float4x4 World;
+	float3 Center;
+	float Radius;
+	float3 Extents;
+	uint Mesh;
+	uint Material;
+	uint Flags;
+	uint2 Padding;
+};
+
+//	GpuDrivenTypes.hpp の GpuMeshInfo と同じ並び
+struct GpuMeshInfo
+{
+	uint IndexCount;
+	uint StartIndex;
+	int BaseVertex;
+	uint Padding;
+};
+
+//	GpuDrivenTypes.hpp の IndirectCommand と同じ並び
+struct IndirectCommand
+{
+	uint ObjectIndex;
+	uint IndexCountPerInstance;
+	uint InstanceCount;
+	uint StartIndexLocation;
+	int BaseVertexLocation;
+	uint StartInstanceLocation;
+};
+
+//	GpuDrivenTypes.hpp の GpuCullConstants と同じ並び
+cbuffer CullConstants : register(b0)
+{
+	float4 Planes[6];
+	row_major float4x4 ViewProjection;
+	uint ObjectCount;
+	uint MeshCount;
+	uint MaxCommands;
+	uint Flags;
+	uint HiZMipCount;
+	uint HiZWidth;
+	uint HiZHeight;
+	uint CommandOffset;
+};
+
+StructuredBuffer<GpuObject> Objects : register(t0);
+StructuredBuffer<GpuMeshInfo> Meshes : register(t1);
+RWStructuredBuffer<IndirectCommand> Commands : register(u0);
+RWByteAddressBuffer CommandCount : register(u1);
+//	描画対象ごとの前のフレームで見えていたかどうか（2段目が書き換える）
+RWStructuredBuffer<uint> Visibility : register(u2);
+
+#if HIZ_ENABLED
+Texture2D<float> HiZ : register(t2);
+#endif
+
+//	グループ内で見えた数と、全体の中でのグループの開始位置
+groupshared uint gLocalCount;
+groupshared uint gGroupBase;
+
+//	AABBが視錐台に掛かっているか
+bool IsInsideFrustum(GpuObject Object)
+{
+	[unroll]
+	for (uint i = 0; i < 6; ++i)
+	{
+		const float4 plane = Planes[i];
+		const float d = dot(plane.xyz, Object.Center) + plane.w;
+		const float r = dot(abs(plane.xyz), Object.Extents);
+		if (d + r < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#if HIZ_ENABLED
+//	AABBが Hi-Z の深度より完全に奥にあるか
+bool IsOccluded(GpuObject Object)
+{
+	float2 ndcMin = float2(1.0f, 1.0f);
+	float2 ndcMax = float2(-1.0f, -1.0f);
+	float nearestZ = 1.0f;
+
+	[unroll]
+	for (uint i = 0; i < 8; ++i)
+	{
+		const float3 corner = Object.Center + Object.Extents * float3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+		const float4 clip = mul(float4(corner, 1.0f), ViewProjection);
+
+		//	近平面をまたぐものは判定できないので見えている扱い
+		if (clip.w <= 0.0f)
+		{
+			return false;
+		}
+
+		const float3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc.xy);
+		ndcMax = max(ndcMax, ndc.xy);
+		nearestZ = min(nearestZ, ndc.z);
+	}
+
+	//	NDC からテクスチャ座標へ（y は反転）
+	const float2 uvMin = saturate(float2(ndcMin.x * 0.5f + 0.5f, 0.5f - ndcMax.y * 0.5f));
+	const float2 uvMax = saturate(float2(ndcMax.x * 0.5f + 0.5f, 0.5f - ndcMin.y * 0.5f));
+
+	//	矩形が 1 テクセルに収まるミップを選ぶと、読むのは 2x2 で足りる
+	const float2 size = (uvMax - uvMin) * float2(HiZWidth, HiZHeight);
+	const uint mip = min((uint)ceil(log2(max(max(size.x, size.y), 1.0f))), HiZMipCount - 1);
+
+	const int mipWidth = (int)max(HiZWidth >> mip, 1u);
+	const int mipHeight = (int)max(HiZHeight >> mip, 1u);
+	const int x0 = clamp((int)floor(uvMin.x * mipWidth), 0, mipWidth - 1);
+	const int y0 = clamp((int)floor(uvMin.y * mipHeight), 0, mipHeight - 1);
+	const int x1 = clamp((int)floor(uvMax.x * mipWidth), 0, mipWidth - 1);
+	const int y1 = clamp((int)floor(uvMax.y * mipHeight), 0, mipHeight - 1);
+
+	const float depth = max(
+		max(HiZ.Load(int3(x0, y0, mip)), HiZ.Load(int3(x1, y0, mip))),
+		max(HiZ.Load(int3(x0, y1, mip)), HiZ.Load(int3(x1, y1, mip))));
+
+	return nearestZ > depth;
+}
+#endif
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void CSMain(uint3 DispatchId : SV_DispatchThreadID, uint GroupIndex : SV_GroupIndex)
+{
+	if (GroupIndex == 0)
+	{
+		gLocalCount = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	const uint index = DispatchId.x;
+	bool visible = false;
+	GpuObject object = (GpuObject)0;
+
+	if (index < ObjectCount)
+	{
+		object = Objects[index];
+		visible = (object.Flags & OBJECT_FLAG_DISABLED) == 0 && object.Mesh < MeshCount;
+
+		if (visible && (Flags & CULL_FLAG_FRUSTUM) != 0)
+		{
+			visible = IsInsideFrustum(object);
+		}
+
+		const bool wasVisible = (Flags & CULL_FLAG_VISIBILITY_VALID) != 0 && Visibility[index] != 0;
+
+		if ((Flags & CULL_FLAG_EARLY) != 0)
+		{
+			//	1段目は前のフレームで見えていたものだけ（Hi-Z はまだない）
+			visible = visible && wasVisible;
+		}
+		else
+		{
+#if HIZ_ENABLED
+			if (visible && (Flags & CULL_FLAG_HIZ) != 0)
+			{
+				visible = !IsOccluded(object);
+			}
+#endif
+			//	2段目は結果を次のフレームのために残し、1段目で描いたものは描かない
+			if ((Flags & CULL_FLAG_LATE) != 0)
+			{
+				Visibility[index] = visible ? 1 : 0;
+				visible = visible && !wasVisible;
+			}
+		}
+	}
+
+	//	グループ内で詰めてから、グループ単位で1回だけ全体のカウンタを進める
+	uint localSlot = 0;
+	if (visible)
+	{
+		InterlockedAdd(gLocalCount, 1, localSlot);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (GroupIndex == 0)
+	{
+		//	1段目と2段目でカウンタを分ける
+		const uint countOffset = (Flags & CULL_FLAG_LATE) != 0 ? 4 : 0;
+		CommandCount.InterlockedAdd(countOffset, gLocalCount, gGroupBase);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (visible)
+	{
+		const uint slot = gGroupBase + localSlot;
+		if (slot < MaxCommands)
+		{
+			const GpuMeshInfo mesh = Meshes[object.Mesh];
+
+			IndirectCommand command;
+			command.ObjectIndex = index;
+			command.IndexCountPerInstance = mesh.IndexCount;
+			command.InstanceCount = 1;
+			command.StartIndexLocation = mesh.StartIndex;
+			command.BaseVertexLocation = mesh.BaseVertex;
+			command.StartInstanceLocation = 0;
+			Commands[CommandOffset + slot] = command;
+		}
+	}
+}
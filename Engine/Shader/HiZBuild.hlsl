@@ -0,0 +1,49 @@
+//	深度ピラミッド（Hi-Z）の1ミップ分の縮小
+//	各テクセルに縮小元で覆う範囲の最も奥の深度を書く。
+//	CPU 側の参照実装は HiZPyramid::Build。作り方を変えたら両方を直すこと。
+
+#define GROUP_SIZE 8
+
+//	ルート定数
+cbuffer HiZConstants : register(b0)
+{
+	uint SrcWidth;
+	uint SrcHeight;
+	uint DstWidth;
+	uint DstHeight;
+};
+
+//	ミップ0の時は深度バッファ、それ以外は1つ下のミップ
+Texture2D<float> Src : register(t0);
+RWTexture2D<float> Dst : register(u0);
+
+//	縮小先のテクセルが覆う縮小元の範囲 [Begin, End)（HiZPyramid::GetFootprint と同じ）
+uint2 GetFootprint(uint DstIndex, uint SrcSize, uint DstSize)
+{
+	const uint begin = DstIndex * SrcSize / DstSize;
+	const uint end = max(((DstIndex + 1) * SrcSize + DstSize - 1) / DstSize, begin + 1);
+	return uint2(begin, end);
+}
+
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void CSMain(uint3 DispatchId : SV_DispatchThreadID)
+{
+	if (DispatchId.x >= DstWidth || DispatchId.y >= DstHeight)
+	{
+		return;
+	}
+
+	const uint2 rangeX = GetFootprint(DispatchId.x, SrcWidth, DstWidth);
+	const uint2 rangeY = GetFootprint(DispatchId.y, SrcHeight, DstHeight);
+
+	float depth = 0.0f;
+	for (uint y = rangeY.x; y < rangeY.y; ++y)
+	{
+		for (uint x = rangeX.x; x < rangeX.y; ++x)
+		{
+			depth = max(depth, Src.Load(int3(x, y, 0)));
+		}
+	}
+
+	Dst[DispatchId.xy] = depth;
+}
@@ -0,0 +1,65 @@
+//	カリング後のメッシュレットを DrawInstanced で描くための頂点シェーダー用の関数
+//	1インスタンスが1メッシュレットで、頂点は MESHLET_MAX_TRIANGLES * 3 個ずつ呼ばれる。
+//	三角形が足りない分は縮退させて捨てる。
+
+#ifndef MESHLET_COMMON_HLSLI
+#define MESHLET_COMMON_HLSLI
+
+//	Meshlet.hpp の MESHLET_MAX_TRIANGLES
+#define MESHLET_MAX_TRIANGLES 124
+
+//	Meshlet.hpp の Meshlet と同じ並び
+struct Meshlet
+{
+	uint VertexOffset;
+	uint TriangleOffset;
+	uint VertexCount;
+	uint TriangleCount;
+};
+
+//	SV_InstanceID と SV_VertexID から元の頂点バッファの添字を求める
+//	false の時は使われない頂点なので、位置を NaN にして三角形ごと捨てること。
+bool LoadMeshletVertex(
+	StructuredBuffer<Meshlet> Meshlets,
+	StructuredBuffer<uint> MeshletVertices,
+	StructuredBuffer<uint> MeshletTriangles,
+	StructuredBuffer<uint> VisibleMeshlets,
+	uint InstanceId,
+	uint VertexId,
+	out uint VertexIndex)
+{
+	VertexIndex = 0;
+
+	const Meshlet meshlet = Meshlets[VisibleMeshlets[InstanceId]];
+	const uint triangle = VertexId / 3;
+	if (triangle >= meshlet.TriangleCount)
+	{
+		return false;
+	}
+
+	const uint packed = MeshletTriangles[meshlet.TriangleOffset + triangle];
+	const uint local = (packed >> ((VertexId % 3) * 8)) & 0xFF;
+	VertexIndex = MeshletVertices[meshlet.VertexOffset + local];
+	return true;
+}
+
+//	MeshAsset の MESH_ASSET_FLAG_QUANTIZED_POSITION の位置を戻す
+//	Value は R16G16B16A16_UNORM で読んだ値、BoundsMin / BoundsMax は MeshAssetHeader の AABB
+float3 DequantizePosition(float4 Value, float3 BoundsMin, float3 BoundsMax)
+{
+	return BoundsMin + Value.xyz * (BoundsMax - BoundsMin);
+}
+
+//	MeshAsset の MESH_ASSET_FLAG_QUANTIZED_NORMAL の法線を戻す（MeshOptimizer::DecodeOctahedral と同じ）
+//	Value は R16G16_SNORM で読んだ値
+float3 DecodeOctahedral(float2 Value)
+{
+	float3 normal = float3(Value, 1.0 - abs(Value.x) - abs(Value.y));
+	if (normal.z < 0.0)
+	{
+		normal.xy = (1.0 - abs(normal.yx)) * ((normal.xy >= 0.0) ? 1.0 : -1.0);
+	}
+	return normalize(normal);
+}
+
+#endif
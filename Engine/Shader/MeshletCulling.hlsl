@@ -0,0 +1,110 @@
+//	メッシュレットの視錐台・法線コーンのカリング
+//	残ったメッシュレットの添字を詰め、DrawInstanced の引数のインスタンス数を数える。
+//	CPU 側の参照実装は MeshletCulling。判定を変えたら両方を直すこと。
+
+#define GROUP_SIZE 64
+
+#define CULL_FLAG_FRUSTUM 1
+#define CULL_FLAG_CONE 2
+
+//	Meshlet.hpp の MeshletBounds と同じ並び
+struct MeshletBounds
+{
+	float3 Center;
+	float Radius;
+	float3 ConeAxis;
+	float ConeCutoff;
+};
+
+//	Meshlet.hpp の MeshletCullConstants と同じ並び
+cbuffer MeshletCullConstants : register(b0)
+{
+	float4 Planes[6];
+	float3 CameraPosition;
+	uint MeshletCount;
+	uint Flags;
+	uint3 Padding;
+};
+
+StructuredBuffer<MeshletBounds> Bounds : register(t0);
+RWStructuredBuffer<uint> VisibleMeshlets : register(u0);
+//	D3D12_DRAW_ARGUMENTS（InstanceCount は 4 バイト目）
+RWByteAddressBuffer DrawArgs : register(u1);
+
+//	グループ内で残った数と、全体の中でのグループの開始位置
+groupshared uint gLocalCount;
+groupshared uint gGroupBase;
+
+//	包む球が視錐台に掛かっているか
+bool IsInsideFrustum(MeshletBounds Meshlet)
+{
+	[unroll]
+	for (uint i = 0; i < 6; ++i)
+	{
+		const float4 plane = Planes[i];
+		if (dot(plane.xyz, Meshlet.Center) + plane.w < -Meshlet.Radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//	球のどこから見ても全ての三角形が裏を向いているか
+bool IsBackFacing(MeshletBounds Meshlet)
+{
+	if (Meshlet.ConeCutoff >= 1.0f)
+	{
+		return false;
+	}
+
+	const float3 view = Meshlet.Center - CameraPosition;
+	return dot(view, Meshlet.ConeAxis) >= Meshlet.ConeCutoff * length(view) + Meshlet.Radius;
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void CSMain(uint3 DispatchId : SV_DispatchThreadID, uint GroupIndex : SV_GroupIndex)
+{
+	if (GroupIndex == 0)
+	{
+		gLocalCount = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	const uint index = DispatchId.x;
+	bool visible = false;
+
+	if (index < MeshletCount)
+	{
+		const MeshletBounds meshlet = Bounds[index];
+		visible = true;
+
+		if ((Flags & CULL_FLAG_FRUSTUM) != 0)
+		{
+			visible = IsInsideFrustum(meshlet);
+		}
+		if (visible && (Flags & CULL_FLAG_CONE) != 0)
+		{
+			visible = !IsBackFacing(meshlet);
+		}
+	}
+
+	//	グループ内で詰めてから、グループ単位で1回だけ全体のカウンタを進める
+	uint localSlot = 0;
+	if (visible)
+	{
+		InterlockedAdd(gLocalCount, 1, localSlot);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (GroupIndex == 0)
+	{
+		DrawArgs.InterlockedAdd(4, gLocalCount, gGroupBase);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (visible)
+	{
+		VisibleMeshlets[gGroupBase + localSlot] = index;
+	}
+}
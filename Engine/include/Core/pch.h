@@ -6,6 +6,8 @@
 //	メモリ最適化
 #include <mimalloc/include/mimalloc.h>
 
+//	Windows と DirectX12 は Windows の時だけ（それ以外では描画を除いたエンジンとツールを組む）
+#if defined(_WIN32)
 //	Windows.hの無駄削除
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN 
@@ -19,13 +21,15 @@
 #include<d3d12.h>
 #include <dxgi1_6.h>
 #include <d3dcompiler.h>
-#include <DirectXMath.h>
 #include <wrl.h>
 #include <comdef.h>
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "d3dcompiler.lib")
+#endif
+
+#include <DirectXMath.h>
 
 
 // STL
@@ -45,7 +49,7 @@
 #include<string>
 #include<string_view>
 #include<filesystem>
-#include<format>
+#include<Utility/Format/Format.hpp>
 
 #include<memory>
 #include<optional>
@@ -65,19 +69,24 @@
 #include<thread>
 #include<mutex>
 #include<atomic>
+#include<condition_variable>
 
 #include<iostream>
 #include<sstream>
 #include<fstream>
 
+#if defined(_WIN32)
 #include <dxgidebug.h>
+#endif
 #include<cassert>
 #include<cstdint>
 
 // Library
 #include<ImGui/imgui.h>
 #include<entt/entt.hpp>
+#if defined(_WIN32)
 #include<DirectXTex/DirectXTex.h>
+#endif
 
 //	My
 #include<Utility/Types/EcseTypes.hpp>
@@ -4,7 +4,9 @@
 #include<System/Service/ServiceProvider.hpp>
 #include<ImGui/imgui.h>
 #include<Utility/Export/Export.hpp>
+#include<System/Thread/RenderThread.hpp>
 #include<vector>
+#include<array>
 #include<functional>
 
 namespace Ecse::Graphics
@@ -27,8 +29,9 @@ namespace Ecse::Debug
         /// <summary>
         /// 初期化
         /// </summary>
+        /// <param name="EnableViewports">マルチビューポートを有効にするか（描画スレッド使用時は無効にする）</param>
         /// <returns>true:成功</returns>
-        bool Initialize();
+        bool Initialize(bool EnableViewports = true);
 
         /// <summary>
         ///フレーム開始 
@@ -45,6 +48,18 @@ namespace Ecse::Debug
         /// </summary>
         void EndFrame();
 
+        /// <summary>
+        /// 描画データを確定してスナップショットへ複製する（ゲームスレッド）
+        /// </summary>
+        /// <param name="Slot">書き込むスナップショット番号</param>
+        void CaptureDrawData(uint32_t Slot);
+
+        /// <summary>
+        /// 複製済みの描画データを記録する（描画スレッド）
+        /// </summary>
+        /// <param name="Slot">読み込むスナップショット番号</param>
+        void RenderCapturedDrawData(uint32_t Slot);
+
         /// <summary>
         /// 解放
         /// </summary>
@@ -56,6 +71,17 @@ namespace Ecse::Debug
         /// <param name="guiFunc"></param>
         void AddDebugUI(std::function<void()> guiFunc);
 
+	private:
+        /// <summary>
+        /// 描画データをフレームのコマンドリストに記録
+        /// </summary>
+        void RecordDrawData(ImDrawData* DrawData);
+
+        /// <summary>
+        /// スナップショットが持っている複製の破棄
+        /// </summary>
+        void ClearSnapshot(ImDrawData& Snapshot);
+
 	private:
         /// <summary>
         /// デバックUI用の処理を呼び出す関数群
@@ -67,6 +93,11 @@ namespace Ecse::Debug
         /// </summary>
         std::unique_ptr<Graphics::GDescriptorHeap> mHeap;
 
+        /// <summary>
+        /// 描画スレッドに渡す描画データの複製（ImDrawListは複製したものを所有）
+        /// </summary>
+        std::array<ImDrawData, System::FRAME_SNAPSHOT_COUNT> mSnapshots;
+
         /// <summary>
         /// ImGuiのコンテキスト
         /// </summary>
@@ -0,0 +1,196 @@
+﻿#pragma once
+
+#include<cstdint>
+#include<string>
+#include<string_view>
+#include<initializer_list>
+#include<vector>
+#include<span>
+
+namespace Ecse::Debug
+{
+	/// <summary>
+	/// 計測区間1つ分の記録
+	/// タイムスタンプは区間番号*2が開始、+1が終了の位置に書き込まれる
+	/// </summary>
+	struct ProfileScope
+	{
+		//	区間名（文字列リテラル前提）
+		const char* Name;
+		//	親区間のインデックス（-1:ルート）
+		int32_t Parent;
+		//	入れ子の深さ
+		uint32_t Depth;
+	};
+
+	/// <summary>
+	/// 区間の入れ子関係を記録するクラス
+	/// 時間そのものは持たず、タイムスタンプの書き込み先だけを発行する。
+	/// GPU（クエリヒープ）とCPU（配列）のどちらでも同じ形で使えるようにしています。
+	/// </summary>
+	class ProfileScopeRecorder
+	{
+	public:
+		/// <summary>
+		/// 上限を超えた時の書き込み先
+		/// </summary>
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		ProfileScopeRecorder();
+
+		/// <summary>
+		/// 記録できる区間数の設定
+		/// </summary>
+		/// <param name="MaxScopes">1フレームの最大区間数</param>
+		void Reserve(uint32_t MaxScopes);
+
+		/// <summary>
+		/// 記録の破棄
+		/// </summary>
+		void Reset();
+
+		/// <summary>
+		/// 区間の開始
+		/// </summary>
+		/// <param name="Name">区間名</param>
+		/// <returns>開始タイムスタンプの書き込み先 INVALID_INDEX:上限超過</returns>
+		uint32_t Begin(const char* Name);
+
+		/// <summary>
+		/// 直近に開始した区間の終了
+		/// </summary>
+		/// <returns>終了タイムスタンプの書き込み先 INVALID_INDEX:上限超過or対応する開始がない</returns>
+		uint32_t End();
+
+		/// <summary>
+		/// 記録された区間の取得
+		/// </summary>
+		std::span<const ProfileScope> GetScopes() const;
+
+		/// <summary>
+		/// 解決が必要なタイムスタンプの数
+		/// </summary>
+		uint32_t GetTimestampCount() const;
+
+		/// <summary>
+		/// 開始と終了の対応がとれているかどうか
+		/// </summary>
+		/// <returns>true:全て閉じている</returns>
+		bool IsBalanced() const;
+
+		/// <summary>
+		/// 上限超過で捨てた区間数
+		/// </summary>
+		uint32_t GetDroppedCount() const;
+
+	private:
+		/// <summary>
+		/// 記録済みの区間
+		/// </summary>
+		std::vector<ProfileScope> mScopes;
+		/// <summary>
+		/// 開いている区間のスタック
+		/// </summary>
+		std::vector<uint32_t> mStack;
+		/// <summary>
+		/// 区間数の上限
+		/// </summary>
+		uint32_t mMaxScopes;
+		/// <summary>
+		/// 上限超過で捨てた区間数
+		/// </summary>
+		uint32_t mDroppedCount;
+	};
+
+	/// <summary>
+	/// 階層化した計測結果の1ノード
+	/// CPUとGPUで同じ階層・同じ名前の区間は1つにまとめる
+	/// </summary>
+	struct ProfileNode
+	{
+		//	区間名
+		std::string Name;
+		//	親・最初の子・次の兄弟（-1:なし）
+		int32_t Parent;
+		int32_t FirstChild;
+		int32_t NextSibling;
+		//	入れ子の深さ
+		uint32_t Depth;
+		//	フレーム先頭からの開始時間と合計時間（ミリ秒、-1:未計測）
+		double CpuStartMs;
+		double CpuMs;
+		double GpuStartMs;
+		double GpuMs;
+		//	同じフレームで何回呼ばれたか
+		uint32_t CpuCalls;
+		uint32_t GpuCalls;
+	};
+
+	/// <summary>
+	/// タイムスタンプの解決と階層ツリーの構築
+	/// D3D12に依存しないのでデバイスなしで単体確認できます。
+	/// </summary>
+	class ProfileTree
+	{
+	public:
+		ProfileTree();
+
+		/// <summary>
+		/// 全ノードの破棄
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// CPU区間の結果を追加
+		/// </summary>
+		/// <param name="Scopes">区間の記録</param>
+		/// <param name="Ticks">区間番号*2(+1)に並んだタイムスタンプ</param>
+		/// <param name="Frequency">1秒あたりのTick数</param>
+		void AddCpu(std::span<const ProfileScope> Scopes, std::span<const uint64_t> Ticks, uint64_t Frequency);
+
+		/// <summary>
+		/// GPU区間の結果を追加
+		/// </summary>
+		/// <param name="Scopes">区間の記録</param>
+		/// <param name="Ticks">ResolveQueryDataで読み戻したタイムスタンプ</param>
+		/// <param name="Frequency">コマンドキューのタイムスタンプ周波数</param>
+		void AddGpu(std::span<const ProfileScope> Scopes, std::span<const uint64_t> Ticks, uint64_t Frequency);
+
+		/// <summary>
+		/// ノードの取得
+		/// </summary>
+		std::span<const ProfileNode> GetNodes() const;
+
+		/// <summary>
+		/// 最初のルートノード（-1:空）
+		/// </summary>
+		int32_t GetFirstRoot() const;
+
+		/// <summary>
+		/// 名前の経路でノードを検索 例:{"Frame","Shadows"}
+		/// </summary>
+		/// <returns>見つからなければ nullptr</returns>
+		const ProfileNode* Find(std::initializer_list<std::string_view> Path) const;
+
+	private:
+		/// <summary>
+		/// CPU・GPU共通のマージ処理
+		/// </summary>
+		void Merge(std::span<const ProfileScope> Scopes, std::span<const uint64_t> Ticks, uint64_t Frequency, bool IsGpu);
+
+		/// <summary>
+		/// 親の下から同名の子を探して、なければ追加
+		/// </summary>
+		int32_t FindOrAddChild(int32_t Parent, const char* Name, uint32_t Depth);
+
+	private:
+		/// <summary>
+		/// 全ノード
+		/// </summary>
+		std::vector<ProfileNode> mNodes;
+		/// <summary>
+		/// 最初のルートノード
+		/// </summary>
+		int32_t mFirstRoot;
+	};
+}
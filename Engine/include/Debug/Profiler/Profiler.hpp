@@ -0,0 +1,266 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<System/EngineConfig.hpp>
+#include<Graphics/DX12/DX12.hpp>
+#include<Debug/Profiler/ProfileTree.hpp>
+
+#include<array>
+#include<vector>
+#include<atomic>
+#include<mutex>
+#include<thread>
+
+namespace Ecse::Debug
+{
+	/// <summary>
+	/// CPUとGPUの区間計測
+	/// GPUはフレームごとのクエリヒープにタイムスタンプを書き込み、
+	/// FRAME_COUNT フレーム後（フェンス待ち済み）に読み戻すのでストールしない。
+	/// GPU区間は BeginFrame を呼んだスレッド（記録を行うスレッド）のものだけを記録する。
+	/// CPU区間はどのスレッドからでも記録でき、スレッドごとに分けて記録中のフレームの枠に書く。
+	/// 記録を行うスレッド以外の区間は、スレッド名の区間の下にまとめて表示する。
+	/// ファイバーで動く仕事の中で区間を開いたまま Wait するとスレッドが変わるので、その区間は正しく閉じない。
+	/// </summary>
+	class ENGINE_API Profiler : public System::ServiceProvider<Profiler>
+	{
+		ECSE_SERVICE_ACCESS(Profiler);
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// 1フレームで計測できる区間の最大数（CPU・GPUそれぞれ）
+		/// </summary>
+		static constexpr uint32_t MAX_SCOPES = 256;
+
+		/// <summary>
+		/// CPU区間を記録できるスレッドの最大数（超えたスレッドの区間は捨てる）
+		/// </summary>
+		static constexpr uint32_t MAX_THREADS = 64;
+
+		/// <summary>
+		/// 初期化
+		/// </summary>
+		/// <param name="Device">クエリヒープと読み戻しバッファを作るデバイス</param>
+		/// <param name="Queue">タイムスタンプ周波数の取得元</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, ID3D12CommandQueue* Queue);
+
+		/// <summary>
+		/// フレームの開始
+		/// BegineRendering のフェンス待ちの後に呼ぶこと（同じ枠の前回分が完了している前提）
+		/// </summary>
+		/// <param name="FrameIndex">DX12のフレームインデックス</param>
+		/// <param name="CmdList">記録中のコマンドリスト</param>
+		void BeginFrame(UINT FrameIndex, ID3D12GraphicsCommandList* CmdList);
+
+		/// <summary>
+		/// フレームの終了。クエリを読み戻しバッファへ解決する命令を積む
+		/// </summary>
+		/// <param name="CmdList">記録中のコマンドリスト（Close前）</param>
+		void EndFrame(ID3D12GraphicsCommandList* CmdList);
+
+		/// <summary>
+		/// CPU区間の開始
+		/// </summary>
+		/// <param name="Name">区間名（文字列リテラル）</param>
+		void BeginCpuScope(const char* Name);
+
+		/// <summary>
+		/// CPU区間の終了
+		/// </summary>
+		void EndCpuScope();
+
+		/// <summary>
+		/// 呼び出したスレッドの表示名（付けていないスレッドは "Worker" にまとめる）
+		/// </summary>
+		/// <param name="Name">スレッド名（文字列リテラル）</param>
+		void SetThreadName(const char* Name);
+
+		/// <summary>
+		/// GPU区間の開始
+		/// </summary>
+		/// <param name="Name">区間名（文字列リテラル）</param>
+		/// <param name="CmdList">nullptrならフレームのコマンドリスト</param>
+		void BeginGpuScope(const char* Name, ID3D12GraphicsCommandList* CmdList = nullptr);
+
+		/// <summary>
+		/// GPU区間の終了
+		/// </summary>
+		/// <param name="CmdList">nullptrならフレームのコマンドリスト</param>
+		void EndGpuScope(ID3D12GraphicsCommandList* CmdList = nullptr);
+
+		/// <summary>
+		/// 最後に解決できたフレームの計測結果
+		/// </summary>
+		const ProfileTree& GetLatestTree() const;
+
+	private:
+		/// <summary>
+		/// 計測結果のデバッグ表示
+		/// </summary>
+		void DrawDebugUI();
+
+		/// <summary>
+		/// 枠に残っている前回分の計測結果を読み戻す
+		/// </summary>
+		void ResolveSlot(UINT FrameIndex);
+
+		/// <summary>
+		/// 呼び出し元がフレームを記録中のスレッドかどうか
+		/// </summary>
+		bool IsRecordingThread() const;
+
+	private:
+		/// <summary>
+		/// スレッド1つ分のCPU区間
+		/// </summary>
+		struct ThreadScopes
+		{
+			//	書き込むスレッドと ResolveSlot の排他（普段は競合しない）
+			std::mutex Mutex;
+			//	CPU区間の入れ子
+			ProfileScopeRecorder Cpu;
+			//	CPU区間のタイムスタンプ
+			std::vector<uint64_t> Ticks;
+		};
+
+		/// <summary>
+		/// フレームごとの記録
+		/// </summary>
+		struct FrameSlot
+		{
+			//	GPU区間の入れ子
+			ProfileScopeRecorder Gpu;
+			//	スレッドの番号ごとのCPU区間
+			std::array<ThreadScopes, MAX_THREADS> Threads;
+			//	BeginFrame を呼んだスレッドの番号
+			uint32_t FrameThread = MAX_THREADS;
+			//	読み戻し待ちのデータがあるか
+			bool IsPending = false;
+		};
+
+		/// <summary>
+		/// 呼び出したスレッドが書き込む枠のCPU区間（MAX_THREADS を超えたスレッドは nullptr）
+		/// </summary>
+		/// <param name="IsBegin">true:区間の開始</param>
+		ThreadScopes* GetThreadScopes(bool IsBegin);
+
+		/// <summary>
+		/// タイムスタンプ用クエリヒープ（FRAME_COUNT 枠分）
+		/// </summary>
+		QueryHeap mQueryHeap;
+		/// <summary>
+		/// 解決先の読み戻しバッファ（FRAME_COUNT 枠分）
+		/// </summary>
+		Resource mReadback;
+		/// <summary>
+		/// GPUのタイムスタンプ周波数
+		/// </summary>
+		UINT64 mGpuFrequency;
+		/// <summary>
+		/// フレームごとの記録
+		/// </summary>
+		std::array<FrameSlot, Graphics::DX12::FRAME_COUNT> mSlots;
+		/// <summary>
+		/// スレッドの番号ごとの表示名（nullptr:"Worker"）
+		/// </summary>
+		std::array<std::atomic<const char*>, MAX_THREADS> mThreadNames;
+		/// <summary>
+		/// 記録中のフレーム（他のスレッドはこの枠にCPU区間を書く）
+		/// </summary>
+		std::atomic<UINT> mFrameIndex;
+		/// <summary>
+		/// 記録中のコマンドリスト
+		/// </summary>
+		ID3D12GraphicsCommandList* mpCmdList;
+		/// <summary>
+		/// フレームを記録中のスレッド
+		/// </summary>
+		std::atomic<std::thread::id> mFrameThread;
+		/// <summary>
+		/// 最後に解決できたフレームの結果
+		/// </summary>
+		ProfileTree mLatest;
+		/// <summary>
+		/// ResolveSlot でスレッド名の区間を足す時の作業領域
+		/// </summary>
+		std::vector<ProfileScope> mThreadScopes;
+		std::vector<uint64_t> mThreadTicks;
+		/// <summary>
+		/// 初期化済みかどうか
+		/// </summary>
+		bool mIsInitialized;
+	};
+
+	/// <summary>
+	/// スコープを抜けるときにCPU区間を閉じる
+	/// </summary>
+	class ScopedCpuProfile
+	{
+	public:
+		explicit ScopedCpuProfile(const char* Name)
+			:mpProfiler(System::ServiceLocator::Get<Profiler>())
+		{
+			if (mpProfiler != nullptr) mpProfiler->BeginCpuScope(Name);
+		}
+		~ScopedCpuProfile()
+		{
+			if (mpProfiler != nullptr) mpProfiler->EndCpuScope();
+		}
+		ScopedCpuProfile(const ScopedCpuProfile&) = delete;
+		ScopedCpuProfile& operator=(const ScopedCpuProfile&) = delete;
+	private:
+		Profiler* mpProfiler;
+	};
+
+	/// <summary>
+	/// スコープを抜けるときにGPU区間を閉じる
+	/// </summary>
+	class ScopedGpuProfile
+	{
+	public:
+		ScopedGpuProfile(const char* Name, ID3D12GraphicsCommandList* CmdList = nullptr)
+			:mpProfiler(System::ServiceLocator::Get<Profiler>())
+			, mpCmdList(CmdList)
+		{
+			if (mpProfiler != nullptr) mpProfiler->BeginGpuScope(Name, mpCmdList);
+		}
+		~ScopedGpuProfile()
+		{
+			if (mpProfiler != nullptr) mpProfiler->EndGpuScope(mpCmdList);
+		}
+		ScopedGpuProfile(const ScopedGpuProfile&) = delete;
+		ScopedGpuProfile& operator=(const ScopedGpuProfile&) = delete;
+	private:
+		Profiler* mpProfiler;
+		ID3D12GraphicsCommandList* mpCmdList;
+	};
+}
+
+/*
+* 計測区間のマクロ
+* ECSE_PROFILER_ENABLED が 0 の時は何も残らない
+*/
+#define ECSE_PROFILE_CONCAT_INNER(a, b) a##b
+#define ECSE_PROFILE_CONCAT(a, b) ECSE_PROFILE_CONCAT_INNER(a, b)
+
+#if ECSE_PROFILER_ENABLED
+#define ECSE_PROFILE_CPU(name) ::Ecse::Debug::ScopedCpuProfile ECSE_PROFILE_CONCAT(ecseCpuScope, __LINE__)(name)
+#define ECSE_PROFILE_GPU(name, ...) ::Ecse::Debug::ScopedGpuProfile ECSE_PROFILE_CONCAT(ecseGpuScope, __LINE__)(name, ##__VA_ARGS__)
+#else
+#define ECSE_PROFILE_CPU(name) do {} while (0)
+#define ECSE_PROFILE_GPU(name, ...) do {} while (0)
+#endif
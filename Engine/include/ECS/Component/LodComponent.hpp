@@ -0,0 +1,25 @@
+﻿#pragma once
+#include<array>
+#include<cstdint>
+
+namespace Ecse::ECS
+{
+	/// <summary>
+	/// 画面上の大きさで切り替える詳細度（LOD）
+	/// MeshRendererComponent と一緒に付けると、LodSelector が Meshes から描くメッシュを選ぶ。
+	/// 画面上の大きさは「包む球の直径 / 画面の高さ」。
+	/// </summary>
+	struct LodComponent
+	{
+		//	持てるレベルの最大数
+		static constexpr uint32_t MAX_LEVELS = 4;
+
+		//	レベルごとのメッシュのID（0 が一番細かい）
+		std::array<uint32_t, MAX_LEVELS> Meshes = {};
+		//	そのレベルを使う最小の画面上の大きさ（レベルの順に小さくしていく）
+		//	最後のレベルで下回ると描かない。最後を 0 にすれば描き続ける
+		std::array<float, MAX_LEVELS> ScreenSizes = {};
+		//	使うレベルの数（0 なら LOD なし）
+		uint8_t LevelCount = 0;
+	};
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+#include<cstdint>
+#include<DirectXMath.h>
+
+namespace Ecse::ECS
+{
+	/// <summary>
+	/// 描画に使うメッシュとマテリアル
+	/// RenderableTag と TransformComponent が揃っている時だけ描画対象になる
+	/// </summary>
+	struct MeshRendererComponent
+	{
+		//	メッシュのID
+		uint32_t Mesh = 0;
+		//	マテリアルのID
+		uint32_t Material = 0;
+		//	パイプライン（PSO）のID
+		uint32_t Pipeline = 0;
+		//	半透明か（奥から手前へ描く）
+		bool IsTranslucent = false;
+		//	ローカル空間のAABB（中心と半分の大きさ）
+		DirectX::XMFLOAT3 BoundsCenter = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 BoundsExtents = { 0.5f, 0.5f, 0.5f };
+	};
+}
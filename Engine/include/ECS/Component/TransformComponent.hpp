@@ -0,0 +1,19 @@
+﻿#pragma once
+#include<DirectXMath.h>
+
+namespace Ecse::ECS
+{
+	/// <summary>
+	/// 位置・回転・拡縮
+	/// 描画側へ変更を伝えるために書き換えは registry.patch / replace で行うこと
+	/// </summary>
+	struct TransformComponent
+	{
+		//	位置
+		DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+		//	回転（クォータニオン）
+		DirectX::XMFLOAT4 Rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+		//	拡縮
+		DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+	};
+}
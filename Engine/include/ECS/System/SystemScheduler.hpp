@@ -0,0 +1,350 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<entt/entt.hpp>
+#include<atomic>
+#include<bitset>
+#include<chrono>
+#include<cstdint>
+#include<deque>
+#include<functional>
+#include<span>
+#include<string>
+#include<string_view>
+#include<type_traits>
+#include<unordered_map>
+#include<vector>
+
+namespace Ecse::ECS
+{
+	/// <summary>
+	/// システムの番号（AddSystem の順）
+	/// </summary>
+	using SystemId = uint32_t;
+
+	/// <summary>
+	/// 無効なシステムの番号
+	/// </summary>
+	inline constexpr SystemId INVALID_SYSTEM_ID = UINT32_MAX;
+
+	/// <summary>
+	/// システムが触るコンポーネントの宣言
+	/// SystemAccess().Read<Velocity>().Write<TransformComponent>() のように並べる。
+	/// 宣言していないコンポーネントに触ると、同時に動く他のシステムと競合するので触らないこと。
+	/// エンティティやコンポーネントの追加・削除（宣言した型以外の storage も変わる）をするなら Exclusive にする。
+	/// </summary>
+	class SystemAccess
+	{
+	public:
+		/// <summary>
+		/// 宣言したコンポーネント1つ
+		/// </summary>
+		struct Component
+		{
+			//	型
+			entt::id_type Type = 0;
+			//	書き込むか
+			bool IsWrite = false;
+			//	storage を先に作る（同時に動いている間に registry へ storage が増えないように）
+			void(*Assure)(entt::registry&) = nullptr;
+		};
+
+		/// <summary>
+		/// 読むだけのコンポーネント
+		/// </summary>
+		template<typename... T>
+		SystemAccess& Read()
+		{
+			(this->Add<T>(false), ...);
+			return *this;
+		}
+
+		/// <summary>
+		/// 書き込むコンポーネント（読むのも含む）
+		/// </summary>
+		template<typename... T>
+		SystemAccess& Write()
+		{
+			(this->Add<T>(true), ...);
+			return *this;
+		}
+
+		/// <summary>
+		/// 他の全てのシステムと同時に動かさない
+		/// </summary>
+		SystemAccess& Exclusive()
+		{
+			mIsExclusive = true;
+			return *this;
+		}
+
+		/// <summary>
+		/// 宣言したコンポーネント
+		/// </summary>
+		std::span<const Component> GetComponents() const
+		{
+			return mComponents;
+		}
+
+		/// <summary>
+		/// 他の全てのシステムと同時に動かさないか
+		/// </summary>
+		bool IsExclusive() const
+		{
+			return mIsExclusive;
+		}
+
+	private:
+		template<typename T>
+		void Add(bool IsWrite)
+		{
+			using Type = std::remove_const_t<T>;
+			mComponents.push_back({ entt::type_id<Type>().hash(), IsWrite, [](entt::registry& Registry) { Registry.storage<Type>(); } });
+		}
+
+	private:
+		/// <summary>
+		/// 宣言したコンポーネント
+		/// </summary>
+		std::vector<Component> mComponents;
+		/// <summary>
+		/// 他の全てのシステムと同時に動かさないか
+		/// </summary>
+		bool mIsExclusive = false;
+	};
+
+	/// <summary>
+	/// 直近のフレームでのシステム1つの計測結果
+	/// </summary>
+	struct SystemTiming
+	{
+		//	かかった時間（ミリ秒）
+		double Ms = 0.0;
+		//	Update の始まりからの開始・終了（ミリ秒）
+		double StartMs = 0.0;
+		double EndMs = 0.0;
+		//	動いたスレッド（JobSystem::GetThreadIndex）
+		uint32_t ThreadIndex = 0;
+		//	クリティカルパスに乗っているか
+		bool IsOnCriticalPath = false;
+	};
+
+	/// <summary>
+	/// 直近のフレームの計測結果
+	/// </summary>
+	struct SystemSchedulerStats
+	{
+		//	動かしたシステムの数
+		uint32_t Systems = 0;
+		//	依存の数
+		uint32_t Edges = 0;
+		//	Update にかかった時間（ミリ秒）
+		double FrameMs = 0.0;
+		//	各システムの時間の合計（ミリ秒。1スレッドで動かした時の目安）
+		double TotalMs = 0.0;
+		//	依存を辿って一番長い道のりの時間（ミリ秒。ワーカーがいくらあってもこれより速くならない）
+		double CriticalPathMs = 0.0;
+	};
+
+	/// <summary>
+	/// ECS のシステムを読み書きするコンポーネントから依存を決めて並列に動かす
+	/// 毎フレーム、有効なシステムを登録順に並べ、先のシステムと競合する（片方が書き、もう片方が読むか書く。Exclusive は全てと競合）
+	/// ものは先のシステムが終わってから動くように依存を張る。競合しないものは JobSystem のワーカーで同時に動かす。
+	/// 結果は登録順に1つずつ動かした時と同じになる。
+	/// システムごとの時間と、その依存を辿ったクリティカルパスの長さを計測する。
+	/// </summary>
+	class ENGINE_API SystemScheduler : public System::ServiceProvider<SystemScheduler>
+	{
+		ECSE_SERVICE_ACCESS(SystemScheduler);
+
+	public:
+		/// <summary>
+		/// システムの処理（ワーカーで呼ぶことがある）
+		/// </summary>
+		using SystemFunction = std::function<void(entt::registry& Registry, float DeltaTime)>;
+
+		/// <summary>
+		/// 宣言できるコンポーネントの型の数
+		/// </summary>
+		static constexpr uint32_t MAX_COMPONENT_TYPES = 256;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// 初期化
+		/// </summary>
+		/// <param name="Registry">システムに渡すレジストリ</param>
+		/// <param name="IsParallel">false:登録順に呼んだスレッドで動かす（比べる時やデバッグ用）</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(entt::registry& Registry, bool IsParallel = true);
+
+		/// <summary>
+		/// システムを加える（Update の外で）
+		/// </summary>
+		/// <param name="Name">名前（計測の表示用）</param>
+		/// <param name="Access">触るコンポーネント</param>
+		/// <param name="Function">処理</param>
+		/// <returns>番号（コンポーネントの型が多すぎる時は INVALID_SYSTEM_ID）</returns>
+		SystemId AddSystem(std::string Name, const SystemAccess& Access, SystemFunction Function);
+
+		/// <summary>
+		/// 有効・無効を切り替える（次の Update から）
+		/// </summary>
+		void SetEnabled(SystemId Id, bool IsEnabled);
+
+		/// <summary>
+		/// 有効か
+		/// </summary>
+		bool IsEnabled(SystemId Id) const;
+
+		/// <summary>
+		/// 並列に動かすかを切り替える（次の Update から）
+		/// </summary>
+		void SetParallel(bool IsParallel);
+
+		/// <summary>
+		/// 依存を作り直して全ての有効なシステムを動かし、終わるまで待つ（ゲームスレッドでフレームに1回）
+		/// </summary>
+		void Update(float DeltaTime);
+
+		/// <summary>
+		/// 加えたシステムの数
+		/// </summary>
+		uint32_t GetSystemCount() const;
+
+		/// <summary>
+		/// 名前
+		/// </summary>
+		std::string_view GetName(SystemId Id) const;
+
+		/// <summary>
+		/// 直近のフレームでの計測結果（無効なシステムは 0）
+		/// </summary>
+		const SystemTiming& GetTiming(SystemId Id) const;
+
+		/// <summary>
+		/// 直近のフレームのクリティカルパス（動いた順）
+		/// </summary>
+		std::span<const SystemId> GetCriticalPath() const;
+
+		/// <summary>
+		/// 直近のフレームの計測結果
+		/// </summary>
+		SystemSchedulerStats GetStats() const;
+
+	private:
+		/// <summary>
+		/// コンポーネントの型の集まり（型ごとのビット）
+		/// </summary>
+		using ComponentSet = std::bitset<MAX_COMPONENT_TYPES>;
+
+		/// <summary>
+		/// システム1つ
+		/// </summary>
+		struct SystemEntry
+		{
+			//	名前
+			std::string Name;
+			//	処理
+			SystemFunction Function;
+			//	読む・書くコンポーネント
+			ComponentSet Reads;
+			ComponentSet Writes;
+			//	全てと競合するか
+			bool IsExclusive = false;
+			//	有効か
+			bool IsEnabled = true;
+			//	今のフレームで先に終わっていてほしいシステムと、自分の後に動くシステム
+			std::vector<SystemId> Predecessors;
+			std::vector<SystemId> Successors;
+			//	まだ終わっていない先のシステムの数
+			std::atomic<uint32_t> Remaining = 0;
+			//	直近のフレームでの計測結果
+			SystemTiming Timing;
+		};
+
+		/// <summary>
+		/// 同時に動かせないか
+		/// </summary>
+		static bool IsConflicting(const SystemEntry& First, const SystemEntry& Second);
+
+		/// <summary>
+		/// 有効なシステムの依存を作り直す
+		/// </summary>
+		void BuildGraph();
+
+		/// <summary>
+		/// システムを動かし、動けるようになった後のシステムを積む（1つはそのまま続けて動かす）
+		/// </summary>
+		void RunSystem(SystemId Id);
+
+		/// <summary>
+		/// 計測結果からクリティカルパスを求める
+		/// </summary>
+		void ComputeCriticalPath();
+
+		/// <summary>
+		/// コンポーネントの型のビット（足りなければ UINT32_MAX）
+		/// </summary>
+		uint32_t GetComponentBit(entt::id_type Type);
+
+	private:
+		/// <summary>
+		/// システムに渡すレジストリ
+		/// </summary>
+		entt::registry* mpRegistry;
+		/// <summary>
+		/// 加えたシステム（Remaining を持つので動かさない入れ物）
+		/// </summary>
+		std::deque<SystemEntry> mSystems;
+		/// <summary>
+		/// コンポーネントの型ごとのビット
+		/// </summary>
+		std::unordered_map<entt::id_type, uint32_t> mComponentBits;
+		/// <summary>
+		/// 今のフレームで動かすシステム（登録順）
+		/// </summary>
+		std::vector<SystemId> mOrder;
+		/// <summary>
+		/// 直近のフレームのクリティカルパス
+		/// </summary>
+		std::vector<SystemId> mCriticalPath;
+		/// <summary>
+		/// 今のフレームのシステムが全て終わったか
+		/// </summary>
+		System::JobCounter mFrameCounter;
+		/// <summary>
+		/// 今のフレームの Update の始まり
+		/// </summary>
+		std::chrono::steady_clock::time_point mFrameStart;
+		/// <summary>
+		/// 今のフレームの経過時間
+		/// </summary>
+		float mDeltaTime;
+		/// <summary>
+		/// 並列に動かすか
+		/// </summary>
+		bool mIsParallel;
+		/// <summary>
+		/// Update の途中か
+		/// </summary>
+		bool mIsUpdating;
+		/// <summary>
+		/// 直近のフレームの計測結果
+		/// </summary>
+		SystemSchedulerStats mStats;
+	};
+}
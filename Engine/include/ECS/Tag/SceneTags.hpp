@@ -13,4 +13,7 @@ namespace Ecse::ECS
 
     // カメラに映る対象である
     struct RenderableTag {};
+
+    // 遮蔽物として深度バッファに描く（境界ボックスの中身が詰まっている物だけに付ける）
+    struct OccluderTag {};
 }
\ No newline at end of file
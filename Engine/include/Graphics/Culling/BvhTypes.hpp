@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include<DirectXMath.h>
+
+#include<algorithm>
+#include<cfloat>
+#include<cstdint>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 軸に沿った箱（最小・最大）
+	/// 既定値は何も含まない空の箱
+	/// </summary>
+	struct Aabb
+	{
+		DirectX::XMFLOAT3 Min = { FLT_MAX, FLT_MAX, FLT_MAX };
+		DirectX::XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		/// <summary>
+		/// 中心と半分の大きさから作成
+		/// </summary>
+		static Aabb FromCenterExtents(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents)
+		{
+			return { { Center.x - Extents.x, Center.y - Extents.y, Center.z - Extents.z }, { Center.x + Extents.x, Center.y + Extents.y, Center.z + Extents.z } };
+		}
+
+		/// <summary>
+		/// 2つを包む箱
+		/// </summary>
+		static Aabb Union(const Aabb& A, const Aabb& B)
+		{
+			return {
+				{ std::min(A.Min.x, B.Min.x), std::min(A.Min.y, B.Min.y), std::min(A.Min.z, B.Min.z) },
+				{ std::max(A.Max.x, B.Max.x), std::max(A.Max.y, B.Max.y), std::max(A.Max.z, B.Max.z) } };
+		}
+
+		/// <summary>
+		/// 表面積（SAHの評価に使う。空の箱は0）
+		/// </summary>
+		float SurfaceArea() const
+		{
+			const float dx = Max.x - Min.x;
+			const float dy = Max.y - Min.y;
+			const float dz = Max.z - Min.z;
+			if (dx < 0.0f || dy < 0.0f || dz < 0.0f) return 0.0f;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+
+		/// <summary>
+		/// 中心
+		/// </summary>
+		DirectX::XMFLOAT3 Center() const
+		{
+			return { (Min.x + Max.x) * 0.5f, (Min.y + Max.y) * 0.5f, (Min.z + Max.z) * 0.5f };
+		}
+
+		/// <summary>
+		/// 重なっているか（接している場合も含む）
+		/// </summary>
+		bool Overlaps(const Aabb& Other) const
+		{
+			return Min.x <= Other.Max.x && Max.x >= Other.Min.x &&
+				Min.y <= Other.Max.y && Max.y >= Other.Min.y &&
+				Min.z <= Other.Max.z && Max.z >= Other.Min.z;
+		}
+
+		/// <summary>
+		/// Other を丸ごと含んでいるか
+		/// </summary>
+		bool Contains(const Aabb& Other) const
+		{
+			return Min.x <= Other.Min.x && Min.y <= Other.Min.y && Min.z <= Other.Min.z &&
+				Max.x >= Other.Max.x && Max.y >= Other.Max.y && Max.z >= Other.Max.z;
+		}
+	};
+
+	/// <summary>
+	/// 光線（Direction は正規化しなくてもよい。T は Direction の長さ単位）
+	/// </summary>
+	struct Ray
+	{
+		DirectX::XMFLOAT3 Origin = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 Direction = { 0.0f, 0.0f, 1.0f };
+		float MaxT = FLT_MAX;
+	};
+
+	/// <summary>
+	/// 光線が当たった箱
+	/// </summary>
+	struct RayHit
+	{
+		/// <summary>
+		/// 当たらなかった時の Index
+		/// </summary>
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		//	当たった物（StaticBvh は Build に渡した添字、DynamicBvh は UserData）
+		uint32_t Index = INVALID_INDEX;
+		//	当たった距離
+		float T = FLT_MAX;
+
+		/// <summary>
+		/// 当たったか
+		/// </summary>
+		bool IsHit() const { return Index != INVALID_INDEX; }
+	};
+}
@@ -0,0 +1,188 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Culling/BvhTypes.hpp>
+
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct Frustum;
+
+	/// <summary>
+	/// 動く物の空間検索用の2分木
+	/// 葉の箱は少し太らせて持つので、太らせた箱からはみ出すまでは動いても木を触らない。
+	/// はみ出した物だけを抜いて入れ直し、入れ直した道筋を回転させて偏りを直す。
+	/// 大量の物を一度に動かす時は RefitProxy で葉だけ更新してから Refit でまとめて直す。
+	/// </summary>
+	class ENGINE_API DynamicBvh
+	{
+	public:
+		/// <summary>
+		/// 無効なプロキシ
+		/// </summary>
+		static constexpr uint32_t INVALID_PROXY = UINT32_MAX;
+
+		/// <param name="Margin">葉の箱を太らせる量</param>
+		explicit DynamicBvh(float Margin = 0.1f);
+
+		/// <summary>
+		/// 物の追加
+		/// </summary>
+		/// <param name="Bounds">物の箱</param>
+		/// <param name="UserData">検索結果として返す値（エンティティなど）</param>
+		/// <returns>プロキシ</returns>
+		uint32_t CreateProxy(const Aabb& Bounds, uint32_t UserData);
+
+		/// <summary>
+		/// 物の削除
+		/// </summary>
+		void DestroyProxy(uint32_t Proxy);
+
+		/// <summary>
+		/// 物の移動。太らせた箱からはみ出した時だけ入れ直す
+		/// </summary>
+		/// <returns>true:入れ直した</returns>
+		bool MoveProxy(uint32_t Proxy, const Aabb& Bounds);
+
+		/// <summary>
+		/// 葉の箱だけを書き換える（木の形と親の箱は Refit まで直さない）
+		/// </summary>
+		void RefitProxy(uint32_t Proxy, const Aabb& Bounds);
+
+		/// <summary>
+		/// 下から全ての節の箱を直し、回転で偏りを直す
+		/// </summary>
+		void Refit();
+
+		/// <summary>
+		/// 全ての削除
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// 視錐台に掛かる物の UserData を集める
+		/// </summary>
+		void QueryFrustum(const Frustum& View, std::vector<uint32_t>& Out) const;
+
+		/// <summary>
+		/// 箱に重なる物の UserData を集める（追記）
+		/// </summary>
+		void QueryAabb(const Aabb& Bounds, std::vector<uint32_t>& Out) const;
+
+		/// <summary>
+		/// 一番手前で光線が当たる物（太らせた箱での判定）
+		/// </summary>
+		RayHit Raycast(const Ray& Query) const;
+
+		/// <summary>
+		/// 複数の箱の検索を並列に行う
+		/// </summary>
+		void QueryAabbBatch(std::span<const Aabb> Queries, std::vector<std::vector<uint32_t>>& Out) const;
+
+		/// <summary>
+		/// 複数の光線の判定を並列に行う
+		/// </summary>
+		void RaycastBatch(std::span<const Ray> Queries, std::span<RayHit> Out) const;
+
+		/// <summary>
+		/// プロキシの UserData
+		/// </summary>
+		uint32_t GetUserData(uint32_t Proxy) const;
+
+		/// <summary>
+		/// プロキシの太らせた箱
+		/// </summary>
+		const Aabb& GetFatBounds(uint32_t Proxy) const;
+
+		/// <summary>
+		/// 木の高さ（葉だけなら0）
+		/// </summary>
+		int32_t GetHeight() const;
+
+		/// <summary>
+		/// 物の数
+		/// </summary>
+		uint32_t GetProxyCount() const;
+
+	private:
+		/// <summary>
+		/// 節（葉も同じ形）
+		/// </summary>
+		struct Node
+		{
+			//	箱（葉は太らせた箱）
+			Aabb Bounds;
+			//	親（空きの時は空きリストの次）
+			uint32_t Parent;
+			//	子（葉の時は INVALID_PROXY）
+			uint32_t Child1;
+			uint32_t Child2;
+			//	葉からの高さ（葉:0、空き:-1）
+			int32_t Height;
+			//	葉の UserData
+			uint32_t UserData;
+
+			bool IsLeaf() const { return Child1 == INVALID_PROXY; }
+		};
+
+		/// <summary>
+		/// 空きの節を取り出す
+		/// </summary>
+		uint32_t AllocateNode();
+
+		/// <summary>
+		/// 節を空きに戻す
+		/// </summary>
+		void FreeNode(uint32_t Index);
+
+		/// <summary>
+		/// 葉を木に入れる
+		/// </summary>
+		void InsertLeaf(uint32_t Leaf);
+
+		/// <summary>
+		/// 葉を木から抜く（節は残す）
+		/// </summary>
+		void RemoveLeaf(uint32_t Leaf);
+
+		/// <summary>
+		/// Index から根まで箱と高さを直しながら回転する
+		/// </summary>
+		void RefitAncestors(uint32_t Index);
+
+		/// <summary>
+		/// 子と孫を入れ替えて、箱の面積が減るなら回転する
+		/// </summary>
+		void Rotate(uint32_t Index);
+
+		/// <summary>
+		/// 太らせた箱
+		/// </summary>
+		Aabb Fatten(const Aabb& Bounds) const;
+
+	private:
+		/// <summary>
+		/// 節
+		/// </summary>
+		std::vector<Node> mNodes;
+		/// <summary>
+		/// 根
+		/// </summary>
+		uint32_t mRoot;
+		/// <summary>
+		/// 空きリストの先頭
+		/// </summary>
+		uint32_t mFreeList;
+		/// <summary>
+		/// 物の数
+		/// </summary>
+		uint32_t mProxyCount;
+		/// <summary>
+		/// 葉を太らせる量
+		/// </summary>
+		float mMargin;
+	};
+}
@@ -0,0 +1,140 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<DirectXMath.h>
+
+#include<array>
+#include<cstdint>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct RenderProxyBuffer;
+
+	/// <summary>
+	/// 視錐台（法線は内向き、ax + by + cz + d >= 0 が内側）
+	/// </summary>
+	struct Frustum
+	{
+		/// <summary>
+		/// 平面の並び
+		/// </summary>
+		enum EPlane : uint32_t
+		{
+			Left,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			PLANE_COUNT,
+		};
+
+		//	正規化済みの平面 (a, b, c, d)
+		std::array<DirectX::XMFLOAT4, PLANE_COUNT> Planes;
+
+		/// <summary>
+		/// ビュー×プロジェクション行列（行ベクトル、深度 0..1）から作成
+		/// </summary>
+		static Frustum FromViewProjection(const DirectX::XMFLOAT4X4& ViewProjection);
+	};
+
+	/// <summary>
+	/// 判定に使う形
+	/// </summary>
+	enum class ECullShape : uint8_t
+	{
+		//	包む球（速いが緩い）
+		Sphere,
+		//	AABB（少し重いが正確）
+		Aabb,
+	};
+
+	/// <summary>
+	/// 判定に使う命令セット
+	/// </summary>
+	enum class ESimdPath : uint8_t
+	{
+		Scalar,
+		//	4個ずつ
+		Sse,
+		//	8個ずつ
+		Avx,
+	};
+
+	/// <summary>
+	/// 直近のカリングの結果
+	/// </summary>
+	struct CullingStats
+	{
+		//	判定した数
+		uint32_t Tested = 0;
+		//	見えている数
+		uint32_t Visible = 0;
+		//	使ったスレッドの塊の数
+		uint32_t ChunkCount = 0;
+		//	かかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+		//	使った命令セット
+		ESimdPath Path = ESimdPath::Scalar;
+	};
+
+	/// <summary>
+	/// RenderProxyBuffer の境界を視錐台で判定し、見えているものの添字を集める
+	/// SoA の境界を8個（SSEは4個）ずつまとめて判定し、JobSystem があれば全コアに分ける。
+	/// カメラごとに1つ持つ想定。
+	/// </summary>
+	class ENGINE_API FrustumCuller
+	{
+	public:
+		/// <summary>
+		/// 1回にスレッドへ渡す要素数（8の倍数）
+		/// </summary>
+		static constexpr uint32_t CHUNK_SIZE = 4096;
+
+		FrustumCuller();
+
+		/// <summary>
+		/// 判定
+		/// </summary>
+		/// <param name="Proxies">描画対象</param>
+		/// <param name="View">視錐台</param>
+		/// <param name="Shape">判定に使う形</param>
+		/// <param name="OutVisible">見えている添字（昇順）</param>
+		void Cull(const RenderProxyBuffer& Proxies, const Frustum& View, ECullShape Shape, std::vector<uint32_t>& OutVisible);
+
+		/// <summary>
+		/// 使う命令セットの指定（CPUが対応していなければ対応している中で一番近いものになる）
+		/// </summary>
+		void SetSimdPath(ESimdPath Path);
+
+		/// <summary>
+		/// 使う命令セット
+		/// </summary>
+		ESimdPath GetSimdPath() const;
+
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		const CullingStats& GetLastStats() const;
+
+		/// <summary>
+		/// CPUが対応している一番速い命令セット
+		/// </summary>
+		static ESimdPath GetSupportedSimdPath();
+
+	private:
+		/// <summary>
+		/// 塊ごとの見えている添字
+		/// </summary>
+		std::vector<std::vector<uint32_t>> mChunkVisible;
+		/// <summary>
+		/// 使う命令セット
+		/// </summary>
+		ESimdPath mSimdPath;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		CullingStats mLastStats;
+	};
+}
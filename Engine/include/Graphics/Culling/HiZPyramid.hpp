@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include<algorithm>
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// CPU側の深度ピラミッド（各テクセルは下のミップで覆う範囲の最も奥の深度）
+	/// ミップ0は深度バッファの縦横を2の累乗に切り下げた大きさ。
+	/// Shader/HiZBuild.hlsl と同じ作り方をするので、GPUの結果の確認に使える。
+	/// </summary>
+	struct HiZPyramid
+	{
+		//	ミップ0の大きさ
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		//	ミップごとの深度（行ごとに詰める）
+		std::vector<std::vector<float>> Mips;
+
+		/// <summary>
+		/// 深度バッファから作る
+		/// </summary>
+		/// <param name="Depth">深度（行ごとに詰める）</param>
+		/// <param name="DepthWidth">深度バッファの幅</param>
+		/// <param name="DepthHeight">深度バッファの高さ</param>
+		void Build(std::span<const float> Depth, uint32_t DepthWidth, uint32_t DepthHeight);
+
+		/// <summary>
+		/// 深度バッファの大きさからミップ0の大きさ（2の累乗に切り下げ）
+		/// </summary>
+		static uint32_t GetBaseSize(uint32_t DepthSize);
+
+		/// <summary>
+		/// ミップ0の大きさからミップの数
+		/// </summary>
+		static uint32_t GetMipCount(uint32_t BaseWidth, uint32_t BaseHeight);
+
+		/// <summary>
+		/// 縮小先のテクセルが覆う縮小元の範囲 [Begin, End)
+		/// 大きさが割り切れなくても取りこぼさないよう、始まりは切り下げ・終わりは切り上げる。
+		/// </summary>
+		static void GetFootprint(uint32_t Dst, uint32_t SrcSize, uint32_t DstSize, uint32_t& OutBegin, uint32_t& OutEnd)
+		{
+			OutBegin = Dst * SrcSize / DstSize;
+			OutEnd = std::max(((Dst + 1) * SrcSize + DstSize - 1) / DstSize, OutBegin + 1);
+		}
+
+		/// <summary>
+		/// ミップの数
+		/// </summary>
+		uint32_t GetMipCount() const { return static_cast<uint32_t>(Mips.size()); }
+
+		/// <summary>
+		/// ミップの幅
+		/// </summary>
+		uint32_t GetMipWidth(uint32_t Mip) const { return std::max(1u, Width >> Mip); }
+
+		/// <summary>
+		/// ミップの高さ
+		/// </summary>
+		uint32_t GetMipHeight(uint32_t Mip) const { return std::max(1u, Height >> Mip); }
+
+		/// <summary>
+		/// 1テクセルの読み込み（範囲外は端に寄せる）
+		/// </summary>
+		float Load(uint32_t Mip, int32_t X, int32_t Y) const
+		{
+			const int32_t w = static_cast<int32_t>(GetMipWidth(Mip));
+			const int32_t h = static_cast<int32_t>(GetMipHeight(Mip));
+			X = std::clamp(X, 0, w - 1);
+			Y = std::clamp(Y, 0, h - 1);
+			return Mips[Mip][static_cast<size_t>(Y) * w + X];
+		}
+	};
+}
@@ -0,0 +1,204 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<DirectXMath.h>
+
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct RenderProxyBuffer;
+
+	/// <summary>
+	/// 直近の遮蔽判定の結果
+	/// </summary>
+	struct OcclusionStats
+	{
+		//	描いた遮蔽物の三角形数
+		uint32_t OccluderTriangles = 0;
+		//	判定した数
+		uint32_t Tested = 0;
+		//	隠れていた数
+		uint32_t Occluded = 0;
+		//	遮蔽物を描くのにかかった時間（ミリ秒）
+		double RasterizeMs = 0.0;
+		//	判定にかかった時間（ミリ秒）
+		double TestMs = 0.0;
+	};
+
+	/// <summary>
+	/// CPUで遮蔽物だけを描く低解像度の深度バッファ
+	/// 遮蔽物を描いた後、8x8 のタイルごとに一番奥の深度を持っておき、
+	/// 判定する箱の一番手前の深度より奥ならタイル丸ごと隠れているとみなす。
+	/// 深度は 0..1（小さいほど手前）。
+	/// </summary>
+	class ENGINE_API OcclusionBuffer
+	{
+	public:
+		/// <summary>
+		/// タイルの一辺のピクセル数（AVXの8レーンと揃える）
+		/// </summary>
+		static constexpr uint32_t TILE_SIZE = 8;
+
+		/// <summary>
+		/// 解像度は TILE_SIZE の倍数に切り上げる
+		/// </summary>
+		OcclusionBuffer(uint32_t Width = 320, uint32_t Height = 192);
+
+		/// <summary>
+		/// フレームの開始。遮蔽物をすべて捨てて視点を設定する
+		/// </summary>
+		/// <param name="ViewProjection">ビュー×プロジェクション行列（行ベクトル、深度 0..1）</param>
+		void BeginFrame(const DirectX::XMFLOAT4X4& ViewProjection);
+
+		/// <summary>
+		/// 遮蔽物のメッシュを追加（表裏は区別しない）
+		/// </summary>
+		/// <param name="World">ワールド行列</param>
+		/// <param name="Vertices">ローカル空間の頂点</param>
+		/// <param name="Indices">三角形リストの添字</param>
+		void AddOccluder(const DirectX::XMFLOAT4X4& World, std::span<const DirectX::XMFLOAT3> Vertices, std::span<const uint32_t> Indices);
+
+		/// <summary>
+		/// 箱の遮蔽物を追加
+		/// </summary>
+		/// <param name="World">ワールド行列</param>
+		/// <param name="Center">ローカル空間の中心</param>
+		/// <param name="Extents">ローカル空間の半分の大きさ</param>
+		void AddOccluderBox(const DirectX::XMFLOAT4X4& World, const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents);
+
+		/// <summary>
+		/// FLAG_OCCLUDER が付いたプロキシを箱の遮蔽物として追加
+		/// </summary>
+		void AddOccluders(const RenderProxyBuffer& Proxies);
+
+		/// <summary>
+		/// 追加した遮蔽物を描いてタイルの深度を作る（タイルの行ごとに並列）
+		/// </summary>
+		void Rasterize();
+
+		/// <summary>
+		/// ワールド空間のAABBが少しでも見えているか
+		/// </summary>
+		bool IsVisible(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents) const;
+
+		/// <summary>
+		/// 見えている添字のうち、隠れているものを取り除く（並列、順序は保つ）
+		/// 遮蔽物そのものは残す。
+		/// </summary>
+		/// <param name="Proxies">描画対象</param>
+		/// <param name="InOutVisible">視錐台カリング済みの添字</param>
+		void Cull(const RenderProxyBuffer& Proxies, std::vector<uint32_t>& InOutVisible);
+
+		/// <summary>
+		/// AVX2 を使うかどうか（CPUが対応していなければ常に使わない）
+		/// </summary>
+		void SetUseSimd(bool UseSimd);
+
+		/// <summary>
+		/// AVX2 を使っているか
+		/// </summary>
+		bool IsUsingSimd() const;
+
+		/// <summary>
+		/// 横幅
+		/// </summary>
+		uint32_t GetWidth() const;
+
+		/// <summary>
+		/// 縦幅
+		/// </summary>
+		uint32_t GetHeight() const;
+
+		/// <summary>
+		/// 深度（デバッグ表示用）
+		/// </summary>
+		const std::vector<float>& GetDepth() const;
+
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		const OcclusionStats& GetLastStats() const;
+
+	private:
+		/// <summary>
+		/// 画面座標に変換済みの三角形
+		/// </summary>
+		struct ScreenTriangle
+		{
+			//	ピクセル座標と深度
+			float X[3];
+			float Y[3];
+			float Z[3];
+			//	縦方向の範囲（タイル行の振り分け用）
+			float MinY;
+			float MaxY;
+		};
+
+		/// <summary>
+		/// タイル行 [Begin, End) の消去・描画・タイル深度の作成
+		/// </summary>
+		void RasterizeTileRows(uint32_t Begin, uint32_t End);
+
+		/// <summary>
+		/// 三角形をピクセル行 [RowBegin, RowEnd) の範囲だけ描く
+		/// </summary>
+		void RasterizeTriangle(const ScreenTriangle& Triangle, uint32_t RowBegin, uint32_t RowEnd);
+
+		/// <summary>
+		/// ワールド座標の頂点をクリップ空間へ
+		/// </summary>
+		DirectX::XMFLOAT4 ToClip(DirectX::FXMVECTOR Position, DirectX::CXMMATRIX Matrix) const;
+
+		/// <summary>
+		/// クリップ空間の三角形を追加（手前の面をまたぐものは捨てる）
+		/// </summary>
+		void AddClipTriangle(const DirectX::XMFLOAT4& A, const DirectX::XMFLOAT4& B, const DirectX::XMFLOAT4& C);
+
+	private:
+		/// <summary>
+		/// 解像度
+		/// </summary>
+		uint32_t mWidth;
+		uint32_t mHeight;
+		/// <summary>
+		/// タイル数
+		/// </summary>
+		uint32_t mTilesX;
+		uint32_t mTilesY;
+		/// <summary>
+		/// ビュー×プロジェクション行列
+		/// </summary>
+		DirectX::XMFLOAT4X4 mViewProjection;
+		/// <summary>
+		/// 描く予定の遮蔽物
+		/// </summary>
+		std::vector<ScreenTriangle> mTriangles;
+		/// <summary>
+		/// 変換途中の頂点（使い回し）
+		/// </summary>
+		std::vector<DirectX::XMFLOAT4> mClipVertices;
+		/// <summary>
+		/// ピクセルの深度
+		/// </summary>
+		std::vector<float> mDepth;
+		/// <summary>
+		/// タイルの一番奥の深度
+		/// </summary>
+		std::vector<float> mTileMax;
+		/// <summary>
+		/// Cull 中の判定結果（使い回し）
+		/// </summary>
+		std::vector<uint8_t> mVisibleFlags;
+		/// <summary>
+		/// AVX2 を使うか
+		/// </summary>
+		bool mUseSimd;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		OcclusionStats mLastStats;
+	};
+}
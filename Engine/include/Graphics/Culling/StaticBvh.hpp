@@ -0,0 +1,183 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Culling/BvhTypes.hpp>
+
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct Frustum;
+
+	/// <summary>
+	/// 動かない物の空間検索用の木
+	/// ビン分割のSAHで2分木を作ってから、子を4つずつ持つ節に潰して連続配列に並べる。
+	/// 子4つの箱は成分ごとに並べてあるので、SSEで1回に4つ判定できる。
+	/// 作成後は読むだけなので、検索はどのスレッドから呼んでもよい。
+	/// </summary>
+	class ENGINE_API StaticBvh
+	{
+	public:
+		/// <summary>
+		/// 葉に入れる最大数
+		/// </summary>
+		static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+		/// <summary>
+		/// SAHのビンの数
+		/// </summary>
+		static constexpr uint32_t BIN_COUNT = 16;
+
+		StaticBvh();
+
+		/// <summary>
+		/// 作成（以前の内容は捨てる）
+		/// </summary>
+		/// <param name="Bounds">物の箱。検索結果はこの添字で返る</param>
+		void Build(std::span<const Aabb> Bounds);
+
+		/// <summary>
+		/// 全ての削除
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// 視錐台に掛かる物を集める（上の方の枝ごとに並列）
+		/// </summary>
+		/// <param name="View">視錐台</param>
+		/// <param name="Out">掛かっている物の添字（順不同）</param>
+		void QueryFrustum(const Frustum& View, std::vector<uint32_t>& Out) const;
+
+		/// <summary>
+		/// 箱に重なる物を集める
+		/// </summary>
+		/// <param name="Bounds">調べる箱</param>
+		/// <param name="Out">重なっている物の添字（順不同、追記）</param>
+		void QueryAabb(const Aabb& Bounds, std::vector<uint32_t>& Out) const;
+
+		/// <summary>
+		/// 一番手前で光線が当たる物
+		/// </summary>
+		RayHit Raycast(const Ray& Query) const;
+
+		/// <summary>
+		/// 複数の箱の検索を並列に行う
+		/// </summary>
+		/// <param name="Queries">調べる箱</param>
+		/// <param name="Out">箱ごとの結果</param>
+		void QueryAabbBatch(std::span<const Aabb> Queries, std::vector<std::vector<uint32_t>>& Out) const;
+
+		/// <summary>
+		/// 複数の光線の判定を並列に行う
+		/// </summary>
+		/// <param name="Queries">光線</param>
+		/// <param name="Out">光線ごとの結果（Queries と同じ数）</param>
+		void RaycastBatch(std::span<const Ray> Queries, std::span<RayHit> Out) const;
+
+		/// <summary>
+		/// 節の数
+		/// </summary>
+		uint32_t GetNodeCount() const;
+
+		/// <summary>
+		/// 物の数
+		/// </summary>
+		uint32_t GetPrimitiveCount() const;
+
+		/// <summary>
+		/// 直近の Build にかかった時間（ミリ秒）
+		/// </summary>
+		double GetLastBuildMs() const;
+
+	private:
+		/// <summary>
+		/// 子を4つ持つ節
+		/// 空きの子は最小 > 最大の箱にしてあるので、どの判定にも掛からない
+		/// </summary>
+		struct alignas(16) Node4
+		{
+			float MinX[4];
+			float MinY[4];
+			float MinZ[4];
+			float MaxX[4];
+			float MaxY[4];
+			float MaxZ[4];
+			//	節の添字、または LEAF_BIT | 物の並びの先頭
+			uint32_t Child[4];
+			//	葉の時の物の数（0:節または空き）
+			uint32_t Count[4];
+		};
+
+		/// <summary>
+		/// 作成途中の2分木の節
+		/// </summary>
+		struct BuildNode
+		{
+			Aabb Bounds;
+			//	子（葉の時は INVALID）
+			uint32_t Left;
+			uint32_t Right;
+			//	葉の時の物の並びの範囲
+			uint32_t First;
+			uint32_t Count;
+		};
+
+		/// <summary>
+		/// Child が葉を指している印
+		/// </summary>
+		static constexpr uint32_t LEAF_BIT = 0x80000000u;
+
+		/// <summary>
+		/// 空きの子
+		/// </summary>
+		static constexpr uint32_t EMPTY_CHILD = 0xFFFFFFFFu;
+
+		/// <summary>
+		/// [First, First + Count) の物で2分木を作る
+		/// </summary>
+		/// <returns>作った節の添字</returns>
+		uint32_t BuildBinary(std::vector<BuildNode>& Nodes, std::span<const Aabb> Bounds, std::vector<DirectX::XMFLOAT3>& Centers, uint32_t First, uint32_t Count);
+
+		/// <summary>
+		/// 2分木の節を4分木の節へ潰す
+		/// </summary>
+		/// <returns>作った節の添字</returns>
+		uint32_t Collapse(const std::vector<BuildNode>& Nodes, uint32_t Binary);
+
+		/// <summary>
+		/// 枝以下の物を判定せずに全て集める
+		/// </summary>
+		void AppendAll(uint32_t Child, uint32_t Count, std::vector<uint32_t>& Out) const;
+
+		/// <summary>
+		/// 判定用に並べ替えた視錐台の平面
+		/// </summary>
+		struct PlaneSet;
+
+		/// <summary>
+		/// 節の子4つを視錐台で判定する
+		/// 丸ごと入っている子と掛かっている葉は Out へ、一部掛かっている節は Next へ積む
+		/// </summary>
+		void VisitFrustumNode(const PlaneSet& Planes, uint32_t Node, std::vector<uint32_t>& Out, std::vector<uint32_t>& Next) const;
+
+	private:
+		/// <summary>
+		/// 節（0番が根）
+		/// </summary>
+		std::vector<Node4> mNodes;
+		/// <summary>
+		/// 葉の順に並べた物の添字
+		/// </summary>
+		std::vector<uint32_t> mPrimitives;
+		/// <summary>
+		/// 物の箱（Build に渡された順）
+		/// </summary>
+		std::vector<Aabb> mBounds;
+		/// <summary>
+		/// 直近の Build にかかった時間
+		/// </summary>
+		double mLastBuildMs;
+	};
+}
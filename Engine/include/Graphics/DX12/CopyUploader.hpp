@@ -0,0 +1,163 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+
+#include<array>
+#include<cstdint>
+#include<deque>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// コピーキューとステージングリングの組
+	/// 送信ごとに「そこまでのステージングの位置」とフェンスの値を覚えておき、Poll でフェンスを覗いて
+	/// 完了した分だけリングを空ける。アロケーターはいくつかを順に使い、まだ転送中なら Begin が false を返すので、
+	/// 呼ぶ側は待たずに次のフレームへ回せる。
+	/// UploadRingBuffer が直接キューのフレームで空くのに対し、こちらはコピーキューのフェンスで空く。
+	/// </summary>
+	class ENGINE_API CopyUploader
+	{
+	public:
+		/// <summary>
+		/// アロケーターの数（これだけの送信が同時に転送中でいられる）
+		/// </summary>
+		static constexpr uint32_t ALLOCATOR_COUNT = 4;
+
+		/// <summary>
+		/// 切り出しに失敗した時の位置
+		/// </summary>
+		static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+
+		CopyUploader();
+		~CopyUploader();
+
+		CopyUploader(const CopyUploader&) = delete;
+		CopyUploader& operator=(const CopyUploader&) = delete;
+
+		/// <summary>
+		/// キュー・アロケーター・フェンス・ステージングの作成
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="StagingSize">ステージングリングの大きさ（バイト）</param>
+		/// <param name="Name">キューの名前（デバッグ用）</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, uint64_t StagingSize, const wchar_t* Name);
+
+		/// <summary>
+		/// 転送中のものを待ってから解放
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// フェンスを覗いて、完了した送信のステージングを空ける（待たない）
+		/// </summary>
+		/// <returns>完了したフェンスの値</returns>
+		uint64_t Poll();
+
+		/// <summary>
+		/// 記録を始める。次のアロケーターがまだ転送中なら false（既に記録中なら true）
+		/// </summary>
+		bool Begin();
+
+		/// <summary>
+		/// 記録中か
+		/// </summary>
+		bool IsRecording() const;
+
+		/// <summary>
+		/// ステージングからの切り出し（空きがなければ INVALID_OFFSET）
+		/// </summary>
+		/// <param name="Size">大きさ（バイト）</param>
+		/// <param name="Alignment">配置（2の累乗）</param>
+		uint64_t AllocateStaging(uint64_t Size, uint64_t Alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+		/// <summary>
+		/// 記録を閉じて送り、フェンスを進める（記録していなければフェンスだけ）
+		/// </summary>
+		/// <returns>この送信が終わった時のフェンスの値</returns>
+		uint64_t Submit();
+
+		/// <summary>
+		/// フェンスがその値になるまで待つ（初期化と終了の時だけ）
+		/// </summary>
+		void Wait(uint64_t FenceValue);
+
+		/// <summary>
+		/// 切り出した位置の書き込み先
+		/// </summary>
+		uint8_t* GetStagingPointer(uint64_t Offset) const;
+
+		/// <summary>
+		/// ステージング本体
+		/// </summary>
+		ID3D12Resource* GetStagingResource() const;
+
+		/// <summary>
+		/// 記録先（Begin と Submit の間だけ使える）
+		/// </summary>
+		ID3D12GraphicsCommandList* GetCommandList() const;
+
+		/// <summary>
+		/// コピーキュー（タイルの割り当てにも使う）
+		/// </summary>
+		ID3D12CommandQueue* GetQueue() const;
+
+		/// <summary>
+		/// 最後に送った分のフェンスの値
+		/// </summary>
+		uint64_t GetLastFenceValue() const;
+
+		/// <summary>
+		/// ステージング全体の大きさ
+		/// </summary>
+		uint64_t GetStagingSize() const;
+
+		/// <summary>
+		/// 転送待ちで使用中のステージングの大きさ
+		/// </summary>
+		uint64_t GetStagingUsed() const;
+
+	private:
+		/// <summary>
+		/// 転送中の送信
+		/// </summary>
+		struct InFlight
+		{
+			uint64_t FenceValue = 0;
+			uint64_t StagingEnd = 0;
+		};
+
+		/// <summary>
+		/// コピーキューと記録用
+		/// </summary>
+		CmdQueue mQueue;
+		std::array<CmdAlloc, ALLOCATOR_COUNT> mAllocators;
+		std::array<uint64_t, ALLOCATOR_COUNT> mAllocatorFences;
+		ComPtr<ID3D12GraphicsCommandList> mCmdList;
+		uint32_t mAllocatorIndex;
+		bool mIsRecording;
+		/// <summary>
+		/// フェンスと最後に送った値、直近に覗いた値
+		/// </summary>
+		Fence mFence;
+		uint64_t mFenceValue;
+		uint64_t mCompletedValue;
+		HANDLE mFenceEvent;
+		/// <summary>
+		/// 開きっぱなしのステージング（UPLOAD ヒープ）
+		/// </summary>
+		Resource mStaging;
+		uint8_t* mpStaging;
+		uint64_t mStagingSize;
+		/// <summary>
+		/// 次に切り出す位置と、転送中の最も古い位置（どちらも折り返さずに増え続ける）
+		/// </summary>
+		uint64_t mStagingHead;
+		uint64_t mStagingTail;
+		/// <summary>
+		/// 転送中の送信（古い順）
+		/// </summary>
+		std::deque<InFlight> mInFlight;
+	};
+}
@@ -6,6 +6,7 @@
 #include<Graphics/Color/Color.hpp>
 
 #include<array>
+#include<atomic>
 
 namespace Ecse::Graphics
 {
@@ -83,6 +84,30 @@ namespace Ecse::Graphics
 		/// <returns></returns>
 		ID3D12CommandQueue* GetCommandQueue();
 
+		/// <summary>
+		/// 記録中のフレームのインデックス
+		/// </summary>
+		/// <returns></returns>
+		UINT GetFrameIndex() const;
+
+		/// <summary>
+		/// 深度バッファの取得（状態は D3D12_RESOURCE_STATE_DEPTH_WRITE）
+		/// </summary>
+		/// <returns></returns>
+		ID3D12Resource* GetDepthBuffer() const;
+
+		/// <summary>
+		/// フレームの完了を知らせるフェンス
+		/// </summary>
+		/// <returns></returns>
+		ID3D12Fence* GetFence() const;
+
+		/// <summary>
+		/// 最後に Signal した値（どのスレッドからでも読める。フェンスがこの値に届けば、それまでに送った処理は全て終わっている）
+		/// </summary>
+		/// <returns></returns>
+		UINT64 GetLastSignaledFenceValue() const;
+
 	private:
 		/// <summary>
 		/// デバッグレイヤーの起動
@@ -209,9 +234,9 @@ namespace Ecse::Graphics
 		/// </summary>
 		HANDLE mWaitForGPUEventHandle;
 		/// <summary>
-		/// 次にSignalする値
+		/// 次にSignalする値（描画スレッドで増やし、他のスレッドからも読む）
 		/// </summary>
-		UINT64 mNextFenceValue;
+		std::atomic<UINT64> mNextFenceValue;
 		/// <summary>
 		/// 今のフレームのインデックス
 		/// </summary>
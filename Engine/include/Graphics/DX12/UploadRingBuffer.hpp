@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<Graphics/DX12/DX12.hpp>
+
+#include<array>
+#include<cstdint>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// アップロードリングから切り出した領域
+	/// </summary>
+	struct UploadAllocation
+	{
+		//	書き込み先（フレームの間ずっとマップしたまま）
+		void* pCpu = nullptr;
+		//	シェーダーから読むアドレス
+		D3D12_GPU_VIRTUAL_ADDRESS Gpu = 0;
+		//	バッファ先頭からの位置
+		uint64_t Offset = 0;
+		//	大きさ
+		uint64_t Size = 0;
+
+		/// <summary>
+		/// 確保できたかどうか
+		/// </summary>
+		bool IsValid() const { return pCpu != nullptr; }
+	};
+
+	/// <summary>
+	/// フレームごとに使い捨てる UPLOAD ヒープのリングバッファ
+	/// 先頭から順に切り出し、フレーム番号ごとに「そのフレームの終わりの位置」を覚えておく。
+	/// 同じフレーム番号が回ってきた時は DX12 がそのフレームの完了を待っているので、そこまでを再利用する。
+	/// </summary>
+	class ENGINE_API UploadRingBuffer
+	{
+	public:
+		/// <summary>
+		/// 既定の配置（定数バッファの境界）
+		/// </summary>
+		static constexpr uint64_t DEFAULT_ALIGNMENT = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+		UploadRingBuffer();
+		~UploadRingBuffer();
+
+		UploadRingBuffer(const UploadRingBuffer&) = delete;
+		UploadRingBuffer& operator=(const UploadRingBuffer&) = delete;
+
+		/// <summary>
+		/// バッファの作成とマップ
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="Size">リング全体の大きさ（バイト）</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, uint64_t Size);
+
+		/// <summary>
+		/// 解放
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// フレームの開始。DX12::BegineRendering の後に呼ぶ
+		/// </summary>
+		/// <param name="FrameIndex">DX12::GetFrameIndex</param>
+		void BeginFrame(uint32_t FrameIndex);
+
+		/// <summary>
+		/// 領域の切り出し（空きがなければ無効な値）
+		/// </summary>
+		/// <param name="Size">大きさ（バイト）</param>
+		/// <param name="Alignment">配置（2の累乗）</param>
+		UploadAllocation Allocate(uint64_t Size, uint64_t Alignment = DEFAULT_ALIGNMENT);
+
+		/// <summary>
+		/// バッファ本体
+		/// </summary>
+		ID3D12Resource* GetResource() const;
+
+		/// <summary>
+		/// リング全体の大きさ
+		/// </summary>
+		uint64_t GetSize() const;
+
+		/// <summary>
+		/// GPUの完了待ちで使用中の大きさ
+		/// </summary>
+		uint64_t GetUsedSize() const;
+
+		/// <summary>
+		/// 今のフレームで切り出した大きさ
+		/// </summary>
+		uint64_t GetFrameAllocatedSize() const;
+
+	private:
+		/// <summary>
+		/// バッファ本体
+		/// </summary>
+		Resource mResource;
+		/// <summary>
+		/// マップした先頭
+		/// </summary>
+		uint8_t* mpMapped;
+		/// <summary>
+		/// GPUアドレスの先頭
+		/// </summary>
+		D3D12_GPU_VIRTUAL_ADDRESS mGpuBase;
+		/// <summary>
+		/// リング全体の大きさ
+		/// </summary>
+		uint64_t mSize;
+		/// <summary>
+		/// 次に切り出す位置（折り返さずに増え続ける）
+		/// </summary>
+		uint64_t mHead;
+		/// <summary>
+		/// GPUがまだ使っているかもしれない最も古い位置
+		/// </summary>
+		uint64_t mTail;
+		/// <summary>
+		/// 今のフレームの開始時の mHead
+		/// </summary>
+		uint64_t mFrameStart;
+		/// <summary>
+		/// フレーム番号ごとの、そのフレームの終わりの mHead
+		/// </summary>
+		std::array<uint64_t, DX12::FRAME_COUNT> mFrameEnd;
+		/// <summary>
+		/// 今のフレーム番号
+		/// </summary>
+		uint32_t mFrameIndex;
+		/// <summary>
+		/// 一度でも BeginFrame したか
+		/// </summary>
+		bool mHasFrame;
+	};
+}
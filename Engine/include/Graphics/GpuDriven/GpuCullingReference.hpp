@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/GpuDriven/GpuDrivenTypes.hpp>
+
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct HiZPyramid;
+	struct RenderProxyBuffer;
+
+	/// <summary>
+	/// Shader/GpuCulling.hlsl と同じ判定・詰め方を CPU で行う参照実装
+	/// GPU の結果の確認と、GPU が使えない時の代わりに使う。
+	/// グループ内の並びは GPU では不定なので、比較する時は集合として比べる。
+	/// </summary>
+	class ENGINE_API GpuCullingReference
+	{
+	public:
+		/// <summary>
+		/// プロキシから GPU に置く描画対象を作る
+		/// </summary>
+		/// <param name="Proxies">描画対象</param>
+		/// <param name="pDest">Proxies.GetCount() 個分の書き込み先</param>
+		static void WriteObjects(const RenderProxyBuffer& Proxies, GpuObject* pDest);
+
+		/// <summary>
+		/// 1コマンド分の引数の作成
+		/// </summary>
+		static IndirectCommand MakeCommand(uint32_t ObjectIndex, const GpuMeshInfo& Mesh);
+
+		/// <summary>
+		/// AABBが視錐台に掛かっているか
+		/// </summary>
+		static bool IsInsideFrustum(const GpuObject& Object, const GpuCullConstants& Constants);
+
+		/// <summary>
+		/// AABBがピラミッドの深度より完全に奥にあるか
+		/// </summary>
+		static bool IsOccluded(const GpuObject& Object, const GpuCullConstants& Constants, const HiZPyramid& Pyramid);
+
+		/// <summary>
+		/// カリングしてコマンドを詰める
+		/// </summary>
+		/// <param name="Objects">描画対象</param>
+		/// <param name="Meshes">メッシュプール内の位置</param>
+		/// <param name="Constants">GPU に渡すものと同じ定数</param>
+		/// <param name="pPyramid">Hi-Z（nullptr なら Hi-Z の判定はしない）</param>
+		/// <param name="Visibility">描画対象ごとの前のフレームで見えていたかどうか（2段目が書き換える）</param>
+		/// <param name="OutCommands">詰めたコマンド（MaxCommands まで。CommandOffset は足さない）</param>
+		/// <returns>カウンタの値（見えた数。MaxCommands を超えることがある）</returns>
+		static uint32_t CullAndCompact(std::span<const GpuObject> Objects, std::span<const GpuMeshInfo> Meshes, const GpuCullConstants& Constants, const HiZPyramid* pPyramid, std::span<uint32_t> Visibility, std::vector<IndirectCommand>& OutCommands);
+	};
+}
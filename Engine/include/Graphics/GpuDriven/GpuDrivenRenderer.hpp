@@ -0,0 +1,219 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<Graphics/DX12/DX12.hpp>
+#include<Graphics/GpuDriven/GpuDrivenTypes.hpp>
+
+#include<array>
+#include<cstdint>
+#include<filesystem>
+#include<span>
+
+namespace Ecse::Graphics
+{
+	struct RenderProxyBuffer;
+	class UploadRingBuffer;
+
+	/// <summary>
+	/// GPU駆動の描画
+	/// 描画対象とメッシュの情報を GPU のバッファに置き、コンピュートシェーダーでカリングして
+	/// 見えたものだけのコマンドを詰め、カウントバッファ付きの ExecuteIndirect で描く。
+	/// CPU は見えている数に関係なく、1回の Dispatch と1回の ExecuteIndirect だけを記録する。
+	///
+	/// 描画側のルートシグネチャには「描画対象の添字を受け取るルート定数（1つ）」が必要で、
+	/// 頂点シェーダーはその添字で GetObjectBufferAddress の GpuObject を読む。
+	/// メッシュは全て同じ頂点・インデックスバッファ（メッシュプール）に入っている前提。
+	///
+	/// 2段階の遮蔽カリングは次の順に記録する。
+	///  1. Cull(Early) → Execute(Early)   前のフレームで見えていたものを描く
+	///  2. GpuHiZPyramid::Build           1 の深度からピラミッドを作る
+	///  3. Cull(Late, Hi-Z) → Execute(Late) 残りを判定して描き、見えていたかどうかを更新する
+	/// </summary>
+	class ENGINE_API GpuDrivenRenderer
+	{
+	public:
+		/// <summary>
+		/// カリング用ルートシグネチャの並び
+		/// </summary>
+		enum ERootParameter : uint32_t
+		{
+			//	b0 GpuCullConstants
+			RootConstants,
+			//	t0 GpuObject
+			RootObjects,
+			//	t1 GpuMeshInfo
+			RootMeshes,
+			//	u0 IndirectCommand
+			RootCommands,
+			//	u1 コマンドの数
+			RootCommandCount,
+			//	u2 前のフレームで見えていたかどうか
+			RootVisibility,
+			//	t2 Hi-Z（ディスクリプタテーブル）
+			RootHiZ,
+			ROOT_PARAMETER_COUNT,
+		};
+
+		GpuDrivenRenderer();
+		~GpuDrivenRenderer();
+
+		GpuDrivenRenderer(const GpuDrivenRenderer&) = delete;
+		GpuDrivenRenderer& operator=(const GpuDrivenRenderer&) = delete;
+
+		/// <summary>
+		/// 初期化
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="DrawRootSignature">ExecuteIndirect で使う描画側のルートシグネチャ</param>
+		/// <param name="ObjectIndexRootParameter">描画対象の添字を受け取るルート定数の番号</param>
+		/// <param name="MaxObjects">描画対象の最大数</param>
+		/// <param name="MaxMeshes">メッシュの最大数</param>
+		/// <param name="ShaderPath">GpuCulling.hlsl の場所</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, ID3D12RootSignature* DrawRootSignature, UINT ObjectIndexRootParameter, uint32_t MaxObjects, uint32_t MaxMeshes, const std::filesystem::path& ShaderPath);
+
+		/// <summary>
+		/// 解放
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// 描画対象を GPU のバッファへ送る（変わったフレームだけで良い）
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool UploadObjects(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const RenderProxyBuffer& Proxies);
+
+		/// <summary>
+		/// メッシュプール内の位置を GPU のバッファへ送る
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool UploadMeshes(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, std::span<const GpuMeshInfo> Meshes);
+
+		/// <summary>
+		/// カリングとコマンドの詰め込みを記録する
+		/// </summary>
+		/// <param name="CmdList">記録先</param>
+		/// <param name="Ring">定数の置き場所</param>
+		/// <param name="Constants">平面・Hi-Z の設定（数は中で埋める）</param>
+		/// <param name="FrameIndex">DX12::GetFrameIndex</param>
+		/// <param name="Pass">カリングの段</param>
+		/// <param name="HiZSrv">Hi-Z の SRV（ptr が 0 なら Hi-Z の判定はしない）</param>
+		/// <returns>true:成功</returns>
+		bool Cull(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const GpuCullConstants& Constants, uint32_t FrameIndex, EGpuCullPass Pass = EGpuCullPass::Single, D3D12_GPU_DESCRIPTOR_HANDLE HiZSrv = {});
+
+		/// <summary>
+		/// 詰めたコマンドで描く（描画側のルートシグネチャ・PSO・メッシュプールは設定済みであること）
+		/// </summary>
+		/// <param name="CmdList">記録先</param>
+		/// <param name="Pass">Cull に渡した段</param>
+		void Execute(ID3D12GraphicsCommandList* CmdList, EGpuCullPass Pass = EGpuCullPass::Single);
+
+		/// <summary>
+		/// 描画対象のバッファのアドレス（頂点シェーダーのルートSRVに渡す）
+		/// </summary>
+		D3D12_GPU_VIRTUAL_ADDRESS GetObjectBufferAddress() const;
+
+		/// <summary>
+		/// 送った描画対象の数
+		/// </summary>
+		uint32_t GetObjectCount() const;
+
+		/// <summary>
+		/// 同じフレーム番号の前回のカリングで描いた数（FRAME_COUNT フレーム遅れ）
+		/// </summary>
+		uint32_t GetLastVisibleCount() const;
+
+		/// <summary>
+		/// そのうち2段目で描いた数（前のフレームで見えていなかったもの）
+		/// </summary>
+		uint32_t GetLastLateCount() const;
+
+	private:
+		/// <summary>
+		/// カリング用のルートシグネチャと PSO の作成
+		/// </summary>
+		bool CreateCullPipeline(ID3D12Device* Device, const std::filesystem::path& ShaderPath);
+
+		/// <summary>
+		/// 状態が違えば遷移を記録する
+		/// </summary>
+		static void Transition(ID3D12GraphicsCommandList* CmdList, ID3D12Resource* Resource, D3D12_RESOURCE_STATES& State, D3D12_RESOURCE_STATES After);
+
+	private:
+		/// <summary>
+		/// カリング用
+		/// </summary>
+		RootSig mCullRootSignature;
+		/// <summary>
+		/// Hi-Z なし・ありの PSO
+		/// </summary>
+		std::array<PSO, 2> mCullPso;
+		/// <summary>
+		/// [ルート定数][DrawIndexed] のコマンドシグネチャ
+		/// </summary>
+		CmdSignature mCommandSignature;
+
+		/// <summary>
+		/// GpuObject の配列
+		/// </summary>
+		Resource mObjectBuffer;
+		/// <summary>
+		/// GpuMeshInfo の配列
+		/// </summary>
+		Resource mMeshBuffer;
+		/// <summary>
+		/// 詰めたコマンド（1段目の後ろに2段目を置くので最大数の2倍）
+		/// </summary>
+		Resource mCommandBuffer;
+		/// <summary>
+		/// 詰めたコマンドの数（1段目・2段目）
+		/// </summary>
+		Resource mCountBuffer;
+		/// <summary>
+		/// 描画対象ごとの前のフレームで見えていたかどうか
+		/// </summary>
+		Resource mVisibilityBuffer;
+		/// <summary>
+		/// 数の読み戻し先（フレーム番号ごとに1段目・2段目）
+		/// </summary>
+		Resource mReadbackBuffer;
+		/// <summary>
+		/// マップした読み戻し先
+		/// </summary>
+		const uint32_t* mpReadback;
+
+		/// <summary>
+		/// 各バッファの今の状態
+		/// </summary>
+		D3D12_RESOURCE_STATES mObjectState;
+		D3D12_RESOURCE_STATES mMeshState;
+		D3D12_RESOURCE_STATES mCommandState;
+		D3D12_RESOURCE_STATES mCountState;
+		D3D12_RESOURCE_STATES mVisibilityState;
+
+		/// <summary>
+		/// フレーム番号ごとに読み戻しを書いたかどうか
+		/// </summary>
+		std::array<bool, DX12::FRAME_COUNT> mIsReadbackWritten;
+
+		/// <summary>
+		/// 最大数
+		/// </summary>
+		uint32_t mMaxObjects;
+		uint32_t mMaxMeshes;
+		/// <summary>
+		/// 送った数
+		/// </summary>
+		uint32_t mObjectCount;
+		uint32_t mMeshCount;
+		/// <summary>
+		/// 読み戻した1段目・2段目の数
+		/// </summary>
+		std::array<uint32_t, 2> mLastCounts;
+		/// <summary>
+		/// 2段目を一度でも記録したか（mVisibilityBuffer が使える）
+		/// </summary>
+		bool mHasVisibility;
+	};
+}
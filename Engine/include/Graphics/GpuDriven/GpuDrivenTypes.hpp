@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include<DirectXMath.h>
+#include<cstdint>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// GPUに置く描画対象1つ分（Shader/GpuCulling.hlsl の GpuObject と同じ並び）
+	/// </summary>
+	struct GpuObject
+	{
+		//	ワールド行列
+		DirectX::XMFLOAT4X4 World;
+		//	ワールド空間のAABBの中心と、それを包む球の半径
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		//	ワールド空間のAABBの半分の大きさ
+		DirectX::XMFLOAT3 Extents;
+		//	メッシュのID（GpuMeshInfo の添字）
+		uint32_t Mesh;
+		//	マテリアルのID
+		uint32_t Material;
+		//	GPU_OBJECT_FLAG_ の組み合わせ
+		uint32_t Flags;
+		uint32_t Padding[2];
+	};
+	static_assert(sizeof(GpuObject) % 16 == 0, "GpuObject must be 16-byte aligned for structured buffers.");
+
+	/// <summary>
+	/// GpuObject::Flags のビット
+	/// </summary>
+	inline constexpr uint32_t GPU_OBJECT_FLAG_DISABLED = 1 << 0;
+
+	/// <summary>
+	/// メッシュプール内でのメッシュの位置（全メッシュで頂点・インデックスバッファを共有する）
+	/// </summary>
+	struct GpuMeshInfo
+	{
+		uint32_t IndexCount;
+		uint32_t StartIndex;
+		int32_t BaseVertex;
+		uint32_t Padding;
+	};
+
+	/// <summary>
+	/// D3D12_DRAW_INDEXED_ARGUMENTS と同じ並び
+	/// </summary>
+	struct IndirectDrawIndexedArgs
+	{
+		uint32_t IndexCountPerInstance;
+		uint32_t InstanceCount;
+		uint32_t StartIndexLocation;
+		int32_t BaseVertexLocation;
+		uint32_t StartInstanceLocation;
+	};
+
+	/// <summary>
+	/// ExecuteIndirect の1コマンド
+	/// コマンドシグネチャは [ルート定数 1つ（描画対象の添字）][DrawIndexed] の順
+	/// </summary>
+	struct IndirectCommand
+	{
+		//	描画対象の添字（頂点シェーダーがルート定数で受け取って GpuObject を読む）
+		uint32_t ObjectIndex;
+		IndirectDrawIndexedArgs Draw;
+	};
+	static_assert(sizeof(IndirectCommand) == 24, "IndirectCommand must match the command signature stride.");
+
+	/// <summary>
+	/// カリングの1グループのスレッド数（グループ内で詰めてから、グループ単位で全体の位置を取る）
+	/// </summary>
+	inline constexpr uint32_t GPU_CULL_GROUP_SIZE = 64;
+
+	/// <summary>
+	/// GpuCullConstants::Flags のビット
+	/// </summary>
+	inline constexpr uint32_t GPU_CULL_FLAG_FRUSTUM = 1 << 0;
+	inline constexpr uint32_t GPU_CULL_FLAG_HIZ = 1 << 1;
+	//	2段階カリングの1段目（前のフレームで見えていたものだけを Hi-Z なしで描く）
+	inline constexpr uint32_t GPU_CULL_FLAG_EARLY = 1 << 2;
+	//	2段階カリングの2段目（全てを Hi-Z で判定し、見えていて1段目で描いていないものを描く）
+	inline constexpr uint32_t GPU_CULL_FLAG_LATE = 1 << 3;
+	//	前のフレームの見えていたかどうかが書かれている
+	inline constexpr uint32_t GPU_CULL_FLAG_VISIBILITY_VALID = 1 << 4;
+
+	/// <summary>
+	/// カリングの段
+	/// </summary>
+	enum class EGpuCullPass : uint8_t
+	{
+		//	1回で判定して描く
+		Single,
+		//	前のフレームで見えていたものを描く
+		Early,
+		//	1段目の深度から作った Hi-Z で残りを判定して描く
+		Late,
+	};
+
+	/// <summary>
+	/// カリングの定数バッファ（Shader/GpuCulling.hlsl の CullConstants と同じ並び）
+	/// </summary>
+	struct GpuCullConstants
+	{
+		//	視錐台の6平面（内側が正）
+		DirectX::XMFLOAT4 Planes[6];
+		//	Hi-Z 用のビュープロジェクション行列（前のフレームのもの）
+		DirectX::XMFLOAT4X4 ViewProjection;
+		//	描画対象とメッシュの数
+		uint32_t ObjectCount;
+		uint32_t MeshCount;
+		//	書き込めるコマンドの最大数
+		uint32_t MaxCommands;
+		//	GPU_CULL_FLAG_ の組み合わせ
+		uint32_t Flags;
+		//	Hi-Z のミップ数
+		uint32_t HiZMipCount;
+		//	Hi-Z のミップ0の大きさ
+		uint32_t HiZWidth;
+		uint32_t HiZHeight;
+		//	コマンドの書き込み開始位置（2段目は1段目の後ろに書く）
+		uint32_t CommandOffset;
+	};
+	static_assert(sizeof(GpuCullConstants) % 16 == 0, "GpuCullConstants must be 16-byte aligned for constant buffers.");
+}
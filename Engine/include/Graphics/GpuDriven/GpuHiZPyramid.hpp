@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapInfo.hpp>
+#include<Graphics/GpuDriven/GpuDrivenTypes.hpp>
+
+#include<cstdint>
+#include<filesystem>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 深度バッファからコンピュートシェーダーで作る深度ピラミッド（Hi-Z）
+	/// 作り方は HiZPyramid::Build と同じで、ミップごとに1回 Dispatch する。
+	/// ディスクリプタは GDescriptorHeapManager から借りる。
+	/// </summary>
+	class ENGINE_API GpuHiZPyramid
+	{
+	public:
+		/// <summary>
+		/// ルートシグネチャの並び
+		/// </summary>
+		enum ERootParameter : uint32_t
+		{
+			//	b0 縮小元・縮小先の大きさ（ルート定数）
+			RootConstants,
+			//	t0 縮小元
+			RootSource,
+			//	u0 縮小先
+			RootDestination,
+			ROOT_PARAMETER_COUNT,
+		};
+
+		GpuHiZPyramid();
+		~GpuHiZPyramid();
+
+		GpuHiZPyramid(const GpuHiZPyramid&) = delete;
+		GpuHiZPyramid& operator=(const GpuHiZPyramid&) = delete;
+
+		/// <summary>
+		/// 初期化
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="DepthBuffer">R32_TYPELESS の深度バッファ（DX12::GetDepthBuffer）</param>
+		/// <param name="ShaderPath">HiZBuild.hlsl の場所</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, ID3D12Resource* DepthBuffer, const std::filesystem::path& ShaderPath);
+
+		/// <summary>
+		/// 解放
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// ピラミッドを作る（深度バッファは DEPTH_WRITE の状態で渡し、戻す）
+		/// </summary>
+		void Build(ID3D12GraphicsCommandList* CmdList);
+
+		/// <summary>
+		/// カリングの定数に Hi-Z の大きさとフラグを設定する
+		/// </summary>
+		void FillConstants(GpuCullConstants& Constants) const;
+
+		/// <summary>
+		/// 全ミップの SRV（GpuDrivenRenderer::Cull に渡す）
+		/// </summary>
+		D3D12_GPU_DESCRIPTOR_HANDLE GetSrv() const;
+
+		/// <summary>
+		/// ピラミッド本体
+		/// </summary>
+		ID3D12Resource* GetResource() const;
+
+		/// <summary>
+		/// ミップ0の大きさ
+		/// </summary>
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+
+		/// <summary>
+		/// ミップの数
+		/// </summary>
+		uint32_t GetMipCount() const;
+
+	private:
+		/// <summary>
+		/// ルートシグネチャと PSO の作成
+		/// </summary>
+		bool CreatePipeline(ID3D12Device* Device, const std::filesystem::path& ShaderPath);
+
+		/// <summary>
+		/// 借りたディスクリプタの Index 番目
+		/// </summary>
+		D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t Index) const;
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t Index) const;
+
+		/// <summary>
+		/// ディスクリプタの並び
+		/// [深度の SRV][ミップごとの SRV × MipCount][ミップごとの UAV × MipCount][全ミップの SRV]
+		/// </summary>
+		uint32_t GetDepthSrvIndex() const { return 0; }
+		uint32_t GetMipSrvIndex(uint32_t Mip) const { return 1 + Mip; }
+		uint32_t GetMipUavIndex(uint32_t Mip) const { return 1 + mMipCount + Mip; }
+		uint32_t GetFullSrvIndex() const { return 1 + mMipCount * 2; }
+
+	private:
+		/// <summary>
+		/// 縮小用
+		/// </summary>
+		RootSig mRootSignature;
+		PSO mPso;
+		/// <summary>
+		/// ピラミッド本体（R32_FLOAT、ミップ付き）
+		/// </summary>
+		Resource mPyramid;
+		/// <summary>
+		/// 読む深度バッファ（所有はしない）
+		/// </summary>
+		ID3D12Resource* mpDepthBuffer;
+		/// <summary>
+		/// 借りたディスクリプタ
+		/// </summary>
+		GDescritorHeapInfo mDescriptors;
+		/// <summary>
+		/// ディスクリプタ1つの大きさ
+		/// </summary>
+		uint32_t mDescriptorSize;
+		/// <summary>
+		/// ピラミッド全体の今の状態
+		/// </summary>
+		D3D12_RESOURCE_STATES mState;
+		/// <summary>
+		/// 深度バッファの大きさ
+		/// </summary>
+		uint32_t mDepthWidth;
+		uint32_t mDepthHeight;
+		/// <summary>
+		/// ミップ0の大きさ
+		/// </summary>
+		uint32_t mWidth;
+		uint32_t mHeight;
+		/// <summary>
+		/// ミップの数
+		/// </summary>
+		uint32_t mMipCount;
+	};
+}
@@ -0,0 +1,169 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<Graphics/Mesh/Meshlet.hpp>
+
+#include<cstdint>
+#include<filesystem>
+#include<span>
+
+namespace Ecse::Graphics
+{
+	class UploadRingBuffer;
+	class MeshAsset;
+
+	/// <summary>
+	/// メッシュレットの GPU カリング
+	/// コンピュートシェーダーで残ったメッシュレットの添字を詰め、そのまま DrawInstanced の
+	/// インスタンス数として使う（1インスタンス = 1メッシュレット、頂点は MESHLET_MAX_TRIANGLES * 3 個）。
+	/// 頂点シェーダーは Shader/MeshletCommon.hlsli の LoadMeshletVertex で頂点を引く。
+	///
+	/// 置けるメッシュは1つで、配置ごとに Cull → Execute を交互に記録すれば複数回描ける。
+	/// </summary>
+	class ENGINE_API GpuMeshletCuller
+	{
+	public:
+		/// <summary>
+		/// カリング用ルートシグネチャの並び
+		/// </summary>
+		enum ERootParameter : uint32_t
+		{
+			//	b0 MeshletCullConstants
+			RootConstants,
+			//	t0 MeshletBounds
+			RootBounds,
+			//	u0 残ったメッシュレットの添字
+			RootVisibleMeshlets,
+			//	u1 DrawInstanced の引数
+			RootDrawArgs,
+			ROOT_PARAMETER_COUNT,
+		};
+
+		GpuMeshletCuller();
+		~GpuMeshletCuller();
+
+		GpuMeshletCuller(const GpuMeshletCuller&) = delete;
+		GpuMeshletCuller& operator=(const GpuMeshletCuller&) = delete;
+
+		/// <summary>
+		/// 初期化
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="MaxMeshlets">メッシュレットの最大数</param>
+		/// <param name="ShaderPath">MeshletCulling.hlsl の場所</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, uint32_t MaxMeshlets, const std::filesystem::path& ShaderPath);
+
+		/// <summary>
+		/// 解放
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// メッシュレットを GPU のバッファへ送る（メッシュが変わった時だけで良い）
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool Upload(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshletMesh& Mesh);
+
+		/// <summary>
+		/// 焼いたメッシュのメッシュレットを、割り当てたファイルから直接送る
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool Upload(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshAsset& Asset);
+
+		/// <summary>
+		/// カリングを記録する
+		/// </summary>
+		/// <param name="CmdList">記録先</param>
+		/// <param name="Ring">定数の置き場所</param>
+		/// <param name="Constants">MeshletCulling::MakeConstants で作った定数（数は中で埋める）</param>
+		/// <returns>true:成功</returns>
+		bool Cull(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshletCullConstants& Constants);
+
+		/// <summary>
+		/// 残ったメッシュレットを描く（描画側のルートシグネチャ・PSO・頂点は設定済みであること）
+		/// </summary>
+		void Execute(ID3D12GraphicsCommandList* CmdList);
+
+		/// <summary>
+		/// 頂点シェーダーに渡すバッファのアドレス
+		/// </summary>
+		D3D12_GPU_VIRTUAL_ADDRESS GetMeshletBufferAddress() const;
+		D3D12_GPU_VIRTUAL_ADDRESS GetVertexBufferAddress() const;
+		D3D12_GPU_VIRTUAL_ADDRESS GetTriangleBufferAddress() const;
+		D3D12_GPU_VIRTUAL_ADDRESS GetVisibleBufferAddress() const;
+
+		/// <summary>
+		/// 送ったメッシュレットの数
+		/// </summary>
+		uint32_t GetMeshletCount() const;
+
+	private:
+		/// <summary>
+		/// カリング用のルートシグネチャと PSO の作成
+		/// </summary>
+		bool CreateCullPipeline(ID3D12Device* Device, const std::filesystem::path& ShaderPath);
+
+		/// <summary>
+		/// 4つのストリームを送る
+		/// </summary>
+		bool UploadStreams(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, std::span<const Meshlet> Meshlets, std::span<const MeshletBounds> Bounds, std::span<const uint32_t> Vertices, std::span<const uint32_t> Triangles);
+
+		/// <summary>
+		/// 配列を DEFAULT のバッファへ送る
+		/// </summary>
+		static bool UploadBuffer(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const void* pData, uint64_t Size, ID3D12Resource* Dest, D3D12_RESOURCE_STATES& State);
+
+		/// <summary>
+		/// 状態が違えば遷移を記録する
+		/// </summary>
+		static void Transition(ID3D12GraphicsCommandList* CmdList, ID3D12Resource* Resource, D3D12_RESOURCE_STATES& State, D3D12_RESOURCE_STATES After);
+
+	private:
+		/// <summary>
+		/// カリング用
+		/// </summary>
+		RootSig mCullRootSignature;
+		PSO mCullPso;
+		/// <summary>
+		/// [Draw] だけのコマンドシグネチャ
+		/// </summary>
+		CmdSignature mCommandSignature;
+
+		/// <summary>
+		/// Meshlet・MeshletBounds・頂点の添字・詰めた三角形
+		/// </summary>
+		Resource mMeshletBuffer;
+		Resource mBoundsBuffer;
+		Resource mVertexBuffer;
+		Resource mTriangleBuffer;
+		/// <summary>
+		/// 残ったメッシュレットの添字
+		/// </summary>
+		Resource mVisibleBuffer;
+		/// <summary>
+		/// DrawInstanced の引数
+		/// </summary>
+		Resource mDrawArgsBuffer;
+
+		/// <summary>
+		/// 各バッファの今の状態
+		/// </summary>
+		D3D12_RESOURCE_STATES mMeshletState;
+		D3D12_RESOURCE_STATES mBoundsState;
+		D3D12_RESOURCE_STATES mVertexState;
+		D3D12_RESOURCE_STATES mTriangleState;
+		D3D12_RESOURCE_STATES mVisibleState;
+		D3D12_RESOURCE_STATES mDrawArgsState;
+
+		/// <summary>
+		/// 最大数
+		/// </summary>
+		uint32_t mMaxMeshlets;
+		/// <summary>
+		/// 送った数
+		/// </summary>
+		uint32_t mMeshletCount;
+	};
+}
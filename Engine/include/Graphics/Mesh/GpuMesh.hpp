@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<Graphics/Mesh/MeshAsset.hpp>
+
+#include<cstdint>
+
+namespace Ecse::Graphics
+{
+	class UploadRingBuffer;
+
+	/// <summary>
+	/// 焼いたメッシュの GPU 側
+	/// ファイルのストリームの並びをそのまま1つの DEFAULT バッファに置くので、
+	/// 割り当てたファイルからアップロードリングへの memcpy と CopyBufferRegion が1回ずつで済む。
+	/// 各ストリームはバッファ先頭から (Offset - DataOffset) の位置にある。
+	/// </summary>
+	class ENGINE_API GpuMesh
+	{
+	public:
+		GpuMesh();
+		~GpuMesh();
+
+		GpuMesh(const GpuMesh&) = delete;
+		GpuMesh& operator=(const GpuMesh&) = delete;
+
+		/// <summary>
+		/// バッファを作り、コピーを記録する（ファイルはこの後すぐ閉じて良い）
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="CmdList">記録先</param>
+		/// <param name="Ring">コピー元の置き場所（全ストリームが1度に入る大きさが要る）</param>
+		/// <param name="Asset">開いたファイル</param>
+		/// <returns>true:成功</returns>
+		bool Upload(ID3D12Device* Device, ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshAsset& Asset);
+
+		/// <summary>
+		/// 解放
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// 送ったか
+		/// </summary>
+		bool IsValid() const;
+
+		/// <summary>
+		/// ストリームの GPU アドレス（無ければ 0）
+		/// </summary>
+		D3D12_GPU_VIRTUAL_ADDRESS GetStreamAddress(EMeshStream Stream) const;
+
+		/// <summary>
+		/// 頂点バッファのビュー（Position・Normal・TexCoord）
+		/// </summary>
+		D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView(EMeshStream Stream) const;
+
+		/// <summary>
+		/// インデックスバッファのビュー
+		/// </summary>
+		D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const;
+
+		/// <summary>
+		/// 送った時のヘッダー
+		/// </summary>
+		const MeshAssetHeader& GetHeader() const;
+
+	private:
+		/// <summary>
+		/// 全てのストリーム
+		/// </summary>
+		Resource mBuffer;
+		/// <summary>
+		/// 送った時のヘッダー
+		/// </summary>
+		MeshAssetHeader mHeader;
+	};
+}
@@ -0,0 +1,189 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/IO/MappedFile.hpp>
+#include<Graphics/Mesh/Meshlet.hpp>
+
+#include<DirectXMath.h>
+#include<array>
+#include<cstdint>
+#include<filesystem>
+#include<span>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 焼いたメッシュのファイルの目印（"EMSH"）と版
+	/// </summary>
+	inline constexpr uint32_t MESH_ASSET_MAGIC = 0x48534D45;
+	inline constexpr uint32_t MESH_ASSET_VERSION = 2;
+
+	/// <summary>
+	/// MeshAssetHeader::Flags のビット
+	/// </summary>
+	//	位置を AABB に対する 16bit の UNORM 4つにする（R16G16B16A16_UNORM）
+	inline constexpr uint32_t MESH_ASSET_FLAG_QUANTIZED_POSITION = 1 << 0;
+	//	法線を八面体に写した 16bit の SNORM 2つにする（R16G16_SNORM）
+	inline constexpr uint32_t MESH_ASSET_FLAG_QUANTIZED_NORMAL = 1 << 1;
+
+	/// <summary>
+	/// ストリームの先頭の配置
+	/// 割り当てたファイルはページ境界から始まるので、ファイル内で揃えておけばそのまま型として読める。
+	/// </summary>
+	inline constexpr uint64_t MESH_ASSET_ALIGNMENT = 64;
+
+	/// <summary>
+	/// ファイルに入っているストリーム（並びはファイル内の順）
+	/// </summary>
+	enum class EMeshStream : uint32_t
+	{
+		//	XMFLOAT3（MESH_ASSET_FLAG_QUANTIZED_POSITION なら uint16_t[4]）
+		Position,
+		//	XMFLOAT3（MESH_ASSET_FLAG_QUANTIZED_NORMAL なら int16_t[2]）
+		Normal,
+		//	XMFLOAT2
+		TexCoord,
+		//	uint32_t の三角形リスト（時計回りが表）
+		Index,
+		//	Meshlet
+		Meshlet,
+		//	MeshletBounds
+		MeshletBounds,
+		//	MeshletMesh::Vertices
+		MeshletVertex,
+		//	MeshletMesh::Triangles
+		MeshletTriangle,
+	};
+	inline constexpr uint32_t MESH_STREAM_COUNT = 8;
+
+	/// <summary>
+	/// ストリーム1つ分の場所
+	/// </summary>
+	struct MeshStreamDesc
+	{
+		//	ファイル先頭からの位置（MESH_ASSET_ALIGNMENT の倍数）
+		uint64_t Offset;
+		//	大きさ（Stride * Count）
+		uint64_t Size;
+		//	要素1つの大きさ
+		uint32_t Stride;
+		//	要素の数
+		uint32_t Count;
+	};
+	static_assert(sizeof(MeshStreamDesc) == 24, "MeshStreamDesc is part of the file format.");
+
+	/// <summary>
+	/// ファイルの先頭
+	/// ストリームはヘッダーの後ろに EMeshStream の順で隙間なく（配置の分だけ空けて）並ぶので、
+	/// [DataOffset, DataOffset + DataSize) を1回コピーすれば全てのストリームを GPU に送れる。
+	/// </summary>
+	struct MeshAssetHeader
+	{
+		//	MESH_ASSET_MAGIC
+		uint32_t Magic;
+		//	MESH_ASSET_VERSION
+		uint32_t Version;
+		//	ファイル全体の大きさ
+		uint64_t FileSize;
+		//	最初のストリームの位置と、そこからファイルの終わりまでの大きさ
+		uint64_t DataOffset;
+		uint64_t DataSize;
+		//	ローカル空間の AABB と頂点の数（量子化した位置はこの AABB に対する値）
+		DirectX::XMFLOAT3 BoundsMin;
+		uint32_t VertexCount;
+		DirectX::XMFLOAT3 BoundsMax;
+		uint32_t IndexCount;
+		//	ローカル空間の包む球
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		//	メッシュレットの数
+		uint32_t MeshletCount;
+		//	MESH_ASSET_FLAG_ の組み合わせ
+		uint32_t Flags;
+		uint32_t Reserved[2];
+		//	EMeshStream の順
+		std::array<MeshStreamDesc, MESH_STREAM_COUNT> Streams;
+	};
+	static_assert(sizeof(MeshAssetHeader) % 16 == 0, "MeshAssetHeader must be 16-byte aligned.");
+
+	/// <summary>
+	/// 焼いたメッシュのファイルを割り当てて、中のストリームをコピーせずに見せる
+	/// 読み込み用のバッファを持たないので、ストリームはアップロード用のメモリへ直接 memcpy する。
+	/// </summary>
+	class ENGINE_API MeshAsset
+	{
+	public:
+		MeshAsset();
+		~MeshAsset();
+
+		MeshAsset(const MeshAsset&) = delete;
+		MeshAsset& operator=(const MeshAsset&) = delete;
+
+		/// <summary>
+		/// 開いてヘッダーを確かめる
+		/// </summary>
+		/// <param name="Path">ファイルの場所</param>
+		/// <returns>true:成功</returns>
+		bool Open(const std::filesystem::path& Path);
+
+		/// <summary>
+		/// 閉じる
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// 開いているか
+		/// </summary>
+		bool IsOpen() const;
+
+		/// <summary>
+		/// ヘッダー（開いていること）
+		/// </summary>
+		const MeshAssetHeader& GetHeader() const;
+
+		/// <summary>
+		/// ストリームの中身（開いていなければ空）
+		/// </summary>
+		std::span<const uint8_t> GetStream(EMeshStream Stream) const;
+
+		/// <summary>
+		/// 全てのストリームをまとめた範囲（GPU へ1回で送る時に使う）
+		/// </summary>
+		std::span<const uint8_t> GetData() const;
+
+		/// <summary>
+		/// ストリームを型として見る（Stride が型と違えば空）
+		/// </summary>
+		template<typename T>
+		std::span<const T> GetStreamAs(EMeshStream Stream) const
+		{
+			const std::span<const uint8_t> bytes = GetStream(Stream);
+			if (bytes.empty() || GetHeader().Streams[static_cast<uint32_t>(Stream)].Stride != sizeof(T)) return {};
+			return { reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T) };
+		}
+
+		/// <summary>
+		/// 中身が正しい並びになっているか（ヘッダーと範囲だけを見る）
+		/// </summary>
+		/// <param name="Bytes">ファイル全体</param>
+		/// <returns>true:正しい</returns>
+		static bool Validate(std::span<const uint8_t> Bytes);
+
+		/// <summary>
+		/// ストリームの要素1つの大きさ（この版での値）
+		/// </summary>
+		/// <param name="Stream">ストリーム</param>
+		/// <param name="Flags">MESH_ASSET_FLAG_ の組み合わせ</param>
+		static uint32_t GetStreamStride(EMeshStream Stream, uint32_t Flags);
+
+	private:
+		/// <summary>
+		/// 割り当てたファイル
+		/// </summary>
+		System::MappedFile mFile;
+		/// <summary>
+		/// ファイル先頭のヘッダー
+		/// </summary>
+		const MeshAssetHeader* mpHeader;
+	};
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Mesh/Meshlet.hpp>
+#include<Graphics/Mesh/MeshOptimizer.hpp>
+
+#include<DirectXMath.h>
+#include<cstdint>
+#include<filesystem>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 焼く前のメッシュ（頂点はストリームごとに分けて持つ）
+	/// </summary>
+	struct MeshAssetData
+	{
+		//	位置
+		std::vector<DirectX::XMFLOAT3> Positions;
+		//	法線（空なら Cook で作る）
+		std::vector<DirectX::XMFLOAT3> Normals;
+		//	UV（空なら持たない）
+		std::vector<DirectX::XMFLOAT2> TexCoords;
+		//	三角形リスト（時計回りが表）
+		std::vector<uint32_t> Indices;
+		//	メッシュレット（空なら Cook で作る）
+		MeshletMesh Meshlets;
+	};
+
+	/// <summary>
+	/// 焼く時の設定
+	/// </summary>
+	struct MeshCookSettings
+	{
+		//	三角形を頂点キャッシュに乗る順に並べる
+		bool OptimizeVertexCache = true;
+		//	クラスタを外を向いた順に並べる（OptimizeVertexCache の時だけ）
+		bool OptimizeOverdraw = true;
+		//	OptimizeOverdraw でクラスタを分けても良い ACMR の悪化の割合
+		float OverdrawThreshold = 1.05f;
+		//	頂点を最初に使われる順に並べる
+		bool OptimizeVertexFetch = true;
+		//	MESH_ASSET_FLAG_ の組み合わせ（量子化）
+		uint32_t Flags = 0;
+	};
+
+	/// <summary>
+	/// 直近の焼いた結果
+	/// </summary>
+	struct MeshCookStats
+	{
+		//	頂点・三角形・メッシュレットの数
+		uint32_t VertexCount = 0;
+		uint32_t TriangleCount = 0;
+		uint32_t MeshletCount = 0;
+		//	並べ替える前と後の頂点キャッシュの効率
+		VertexCacheStats Before;
+		VertexCacheStats After;
+		//	書き出した大きさ（バイト）
+		uint64_t FileSize = 0;
+		//	かかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// メッシュを実行時にそのまま使える形（MeshAsset）に焼く
+	/// ツール（Tools/AssetCooker）から使う想定だが、CPU だけの処理なので実行時にも呼べる。
+	/// </summary>
+	class ENGINE_API MeshAssetCooker
+	{
+	public:
+		/// <summary>
+		/// 足りないもの（法線・メッシュレット）を作り、並べ替える
+		/// </summary>
+		/// <param name="Data">焼く前のメッシュ</param>
+		/// <param name="Settings">設定</param>
+		/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+		/// <returns>true:成功</returns>
+		static bool Cook(MeshAssetData& Data, const MeshCookSettings& Settings = {}, MeshCookStats* pStats = nullptr);
+
+		/// <summary>
+		/// ファイルの中身を作る
+		/// </summary>
+		/// <param name="Data">Cook 済みのメッシュ</param>
+		/// <param name="Flags">MESH_ASSET_FLAG_ の組み合わせ</param>
+		/// <param name="OutBytes">ファイル全体</param>
+		/// <returns>true:成功</returns>
+		static bool Serialize(const MeshAssetData& Data, uint32_t Flags, std::vector<uint8_t>& OutBytes);
+
+		/// <summary>
+		/// 焼いてファイルに書き出す
+		/// </summary>
+		/// <param name="Path">書き出し先</param>
+		/// <param name="Data">焼く前のメッシュ（足りないものは中で作る）</param>
+		/// <param name="Settings">設定</param>
+		/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+		/// <returns>true:成功</returns>
+		static bool Write(const std::filesystem::path& Path, MeshAssetData& Data, const MeshCookSettings& Settings = {}, MeshCookStats* pStats = nullptr);
+
+		/// <summary>
+		/// 面積で重み付けした頂点の法線を求める
+		/// </summary>
+		static void ComputeNormals(const std::vector<DirectX::XMFLOAT3>& Positions, const std::vector<uint32_t>& Indices, std::vector<DirectX::XMFLOAT3>& OutNormals);
+	};
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<DirectXMath.h>
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct MeshAssetData;
+
+	/// <summary>
+	/// 頂点キャッシュの効率
+	/// </summary>
+	struct VertexCacheStats
+	{
+		//	三角形1つあたりの頂点シェーダーの実行回数（0.5 に近いほど良い）
+		float Acmr = 0.0f;
+		//	使っている頂点1つあたりの頂点シェーダーの実行回数（1 が最良）
+		float Atvr = 0.0f;
+		//	キャッシュに無かった回数
+		uint32_t Misses = 0;
+	};
+
+	/// <summary>
+	/// 頂点シェーダーの負荷を下げるための並べ替えと量子化（焼く時に使う CPU だけの処理）
+	///
+	/// 1. OptimizeVertexCache : Tipsify（Sander 2007）で三角形を頂点キャッシュに乗る順に並べる
+	/// 2. OptimizeOverdraw    : キャッシュの効率を保てる範囲でクラスタに分け、外を向いたものから描く
+	/// 3. OptimizeVertexFetch : 頂点を最初に使われる順に並べ替え、頂点の読み込みを連続させる
+	///
+	/// 三角形の中の頂点の順（表裏）は変えない。
+	/// </summary>
+	class ENGINE_API MeshOptimizer
+	{
+	public:
+		/// <summary>
+		/// 並べ替えで想定する頂点キャッシュの大きさ（FIFO）
+		/// </summary>
+		static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+		/// <summary>
+		/// 頂点キャッシュに乗る順に三角形を並べ替える
+		/// </summary>
+		/// <param name="Indices">三角形リスト（並べ替える）</param>
+		/// <param name="VertexCount">頂点の数</param>
+		/// <param name="CacheSize">想定するキャッシュの大きさ</param>
+		/// <param name="pOutClusters">行き止まりで途切れた所で分けたクラスタの先頭の三角形（不要なら nullptr）</param>
+		static void OptimizeVertexCache(std::span<uint32_t> Indices, uint32_t VertexCount, uint32_t CacheSize = DEFAULT_CACHE_SIZE, std::vector<uint32_t>* pOutClusters = nullptr);
+
+		/// <summary>
+		/// クラスタを外を向いた順に並べ替え、奥の面が先に描かれるのを減らす
+		/// </summary>
+		/// <param name="Indices">OptimizeVertexCache 済みの三角形リスト（並べ替える）</param>
+		/// <param name="Positions">頂点の位置</param>
+		/// <param name="Clusters">OptimizeVertexCache が返したクラスタ</param>
+		/// <param name="Threshold">クラスタを細かく分けても良い ACMR の悪化の割合（1.05 なら 5%）</param>
+		/// <param name="CacheSize">想定するキャッシュの大きさ</param>
+		static void OptimizeOverdraw(std::span<uint32_t> Indices, std::span<const DirectX::XMFLOAT3> Positions, std::span<const uint32_t> Clusters, float Threshold = 1.05f, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+
+		/// <summary>
+		/// 頂点を最初に使われる順に並べ替える（使われない頂点は捨てる）
+		/// </summary>
+		/// <param name="Data">メッシュ（頂点のストリームと添字を書き換える）</param>
+		/// <returns>残った頂点の数</returns>
+		static uint32_t OptimizeVertexFetch(MeshAssetData& Data);
+
+		/// <summary>
+		/// FIFO の頂点キャッシュを真似て効率を測る
+		/// </summary>
+		static VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> Indices, uint32_t VertexCount, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+
+		/// <summary>
+		/// [Min, Max] の位置を 16bit の UNORM にする（w は 0）
+		/// </summary>
+		static void QuantizePosition(const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Min, const DirectX::XMFLOAT3& Max, uint16_t OutValue[4]);
+		static DirectX::XMFLOAT3 DequantizePosition(const uint16_t Value[4], const DirectX::XMFLOAT3& Min, const DirectX::XMFLOAT3& Max);
+
+		/// <summary>
+		/// 単位ベクトルを八面体に写して 16bit の SNORM 2つにする
+		/// </summary>
+		static void EncodeOctahedral(const DirectX::XMFLOAT3& Normal, int16_t OutValue[2]);
+		static DirectX::XMFLOAT3 DecodeOctahedral(const int16_t Value[2]);
+	};
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include<DirectXMath.h>
+#include<cstdint>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 1つのメッシュレットに入れられる頂点・三角形の最大数
+	/// 三角形は頂点をメッシュレット内の 8bit の添字で持つので、頂点は 256 を超えられない。
+	/// </summary>
+	inline constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	inline constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	/// <summary>
+	/// メッシュレット1つ分（Shader/MeshletCulling.hlsl の Meshlet と同じ並び）
+	/// </summary>
+	struct Meshlet
+	{
+		//	MeshletMesh::Vertices の中の開始位置
+		uint32_t VertexOffset;
+		//	MeshletMesh::Triangles の中の開始位置
+		uint32_t TriangleOffset;
+		//	頂点の数
+		uint32_t VertexCount;
+		//	三角形の数
+		uint32_t TriangleCount;
+	};
+	static_assert(sizeof(Meshlet) == 16, "Meshlet must match the HLSL layout.");
+
+	/// <summary>
+	/// メッシュレットのカリング用の形（Shader/MeshletCulling.hlsl の MeshletBounds と同じ並び）
+	/// 全てメッシュのローカル空間。
+	/// </summary>
+	struct MeshletBounds
+	{
+		//	包む球
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		//	三角形の法線を包むコーンの軸（表向きの法線の平均）
+		DirectX::XMFLOAT3 ConeAxis;
+		//	軸と法線の最大の開き θ の sin（1 ならコーンでは捨てない）
+		float ConeCutoff;
+	};
+	static_assert(sizeof(MeshletBounds) == 32, "MeshletBounds must match the HLSL layout.");
+
+	/// <summary>
+	/// メッシュレットに分けたメッシュ
+	/// 頂点そのものは元の頂点バッファのまま使い、メッシュレットはその添字だけを持つ。
+	/// </summary>
+	struct MeshletMesh
+	{
+		//	メッシュレット
+		std::vector<Meshlet> Meshlets;
+		//	メッシュレットごとの形（Meshlets と同じ並び）
+		std::vector<MeshletBounds> Bounds;
+		//	元の頂点バッファの添字（メッシュレットごとに詰める）
+		std::vector<uint32_t> Vertices;
+		//	メッシュレット内の頂点の添字を 8bit ずつ3つ詰めた三角形（i0 | i1 << 8 | i2 << 16）
+		std::vector<uint32_t> Triangles;
+
+		/// <summary>
+		/// 三角形の頂点を詰める
+		/// </summary>
+		static constexpr uint32_t PackTriangle(uint32_t I0, uint32_t I1, uint32_t I2)
+		{
+			return I0 | (I1 << 8) | (I2 << 16);
+		}
+
+		/// <summary>
+		/// 詰めた三角形の Corner 番目の頂点
+		/// </summary>
+		static constexpr uint32_t UnpackTriangle(uint32_t Packed, uint32_t Corner)
+		{
+			return (Packed >> (Corner * 8)) & 0xFF;
+		}
+
+		/// <summary>
+		/// 空にする
+		/// </summary>
+		void Clear()
+		{
+			Meshlets.clear();
+			Bounds.clear();
+			Vertices.clear();
+			Triangles.clear();
+		}
+	};
+
+	/// <summary>
+	/// MeshletCullConstants::Flags のビット
+	/// </summary>
+	inline constexpr uint32_t MESHLET_CULL_FLAG_FRUSTUM = 1 << 0;
+	inline constexpr uint32_t MESHLET_CULL_FLAG_CONE = 1 << 1;
+
+	/// <summary>
+	/// 1グループのスレッド数（Shader/MeshletCulling.hlsl の GROUP_SIZE）
+	/// </summary>
+	inline constexpr uint32_t MESHLET_CULL_GROUP_SIZE = 64;
+
+	/// <summary>
+	/// メッシュレットのカリングの定数（Shader/MeshletCulling.hlsl の cbuffer と同じ並び）
+	/// 判定はメッシュのローカル空間で行うので、平面とカメラは MeshletCulling::MakeConstants で変換しておく。
+	/// </summary>
+	struct MeshletCullConstants
+	{
+		//	ローカル空間の視錐台の平面（法線は内向き、正規化済み）
+		DirectX::XMFLOAT4 Planes[6];
+		//	ローカル空間のカメラの位置
+		DirectX::XMFLOAT3 CameraPosition;
+		//	メッシュレットの数
+		uint32_t MeshletCount;
+		//	MESHLET_CULL_FLAG_ の組み合わせ
+		uint32_t Flags;
+		uint32_t Padding[3];
+	};
+	static_assert(sizeof(MeshletCullConstants) % 16 == 0, "MeshletCullConstants must be 16-byte aligned.");
+
+	/// <summary>
+	/// D3D12_DRAW_ARGUMENTS と同じ並び
+	/// </summary>
+	struct IndirectDrawArgs
+	{
+		uint32_t VertexCountPerInstance;
+		uint32_t InstanceCount;
+		uint32_t StartVertexLocation;
+		uint32_t StartInstanceLocation;
+	};
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Mesh/Meshlet.hpp>
+
+#include<DirectXMath.h>
+#include<cstdint>
+#include<span>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 直近の分割の結果
+	/// </summary>
+	struct MeshletBuildStats
+	{
+		//	入力の三角形の数
+		uint32_t TriangleCount = 0;
+		//	作ったメッシュレットの数
+		uint32_t MeshletCount = 0;
+		//	コーンで捨てられるメッシュレットの数（法線がまとまっているもの）
+		uint32_t ConeCount = 0;
+		//	メッシュレット1つあたりの頂点・三角形の数の平均
+		float AverageVertices = 0.0f;
+		float AverageTriangles = 0.0f;
+		//	かかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// 三角形リストをメッシュレットに分ける（オフラインでもロード時でも使える CPU だけの処理）
+	/// 使っている頂点を共有する三角形を優先して足していくので、メッシュレットは空間的にまとまる。
+	/// 三角形は時計回りが表（D3D12 の既定）として法線のコーンを作る。
+	/// </summary>
+	class ENGINE_API MeshletBuilder
+	{
+	public:
+		/// <summary>
+		/// 分割する
+		/// </summary>
+		/// <param name="Positions">頂点の位置</param>
+		/// <param name="Indices">三角形リストのインデックス（3の倍数）</param>
+		/// <param name="OutMesh">結果</param>
+		/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+		/// <returns>true:成功</returns>
+		static bool Build(std::span<const DirectX::XMFLOAT3> Positions, std::span<const uint32_t> Indices, MeshletMesh& OutMesh, MeshletBuildStats* pStats = nullptr);
+
+		/// <summary>
+		/// メッシュレット1つ分の形を求める
+		/// </summary>
+		/// <param name="Positions">頂点の位置</param>
+		/// <param name="Mesh">分割済みのメッシュ</param>
+		/// <param name="MeshletIndex">メッシュレットの添字</param>
+		static MeshletBounds ComputeBounds(std::span<const DirectX::XMFLOAT3> Positions, const MeshletMesh& Mesh, uint32_t MeshletIndex);
+	};
+}
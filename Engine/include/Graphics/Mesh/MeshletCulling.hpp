@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Mesh/Meshlet.hpp>
+
+#include<DirectXMath.h>
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct Frustum;
+
+	/// <summary>
+	/// Shader/MeshletCulling.hlsl と同じ判定を CPU で行う参照実装
+	/// 視錐台の外と、全ての三角形が裏を向いているメッシュレットを捨てる。
+	/// </summary>
+	class ENGINE_API MeshletCulling
+	{
+	public:
+		/// <summary>
+		/// ワールド空間の視錐台とカメラをメッシュのローカル空間に移して定数を作る
+		/// 平面は行列で正確に移せるので、拡大縮小が入っていても判定は変わらない（鏡映は除く）。
+		/// </summary>
+		/// <param name="World">メッシュのワールド行列</param>
+		/// <param name="WorldFrustum">ワールド空間の視錐台</param>
+		/// <param name="CameraPosition">ワールド空間のカメラの位置</param>
+		/// <param name="MeshletCount">メッシュレットの数</param>
+		/// <param name="Flags">MESHLET_CULL_FLAG_ の組み合わせ</param>
+		static MeshletCullConstants MakeConstants(const DirectX::XMFLOAT4X4& World, const Frustum& WorldFrustum, const DirectX::XMFLOAT3& CameraPosition, uint32_t MeshletCount, uint32_t Flags = MESHLET_CULL_FLAG_FRUSTUM | MESHLET_CULL_FLAG_CONE);
+
+		/// <summary>
+		/// 包む球が視錐台に掛かっているか
+		/// </summary>
+		static bool IsInsideFrustum(const MeshletBounds& Bounds, const MeshletCullConstants& Constants);
+
+		/// <summary>
+		/// 球のどこから見ても全ての三角形が裏を向いているか
+		/// </summary>
+		static bool IsBackFacing(const MeshletBounds& Bounds, const MeshletCullConstants& Constants);
+
+		/// <summary>
+		/// 描く必要があるか
+		/// </summary>
+		static bool IsVisible(const MeshletBounds& Bounds, const MeshletCullConstants& Constants);
+
+		/// <summary>
+		/// 残ったメッシュレットの添字を集める
+		/// </summary>
+		/// <param name="Bounds">メッシュレットごとの形</param>
+		/// <param name="Constants">MakeConstants で作った定数</param>
+		/// <param name="OutVisible">残ったメッシュレットの添字（小さい順）</param>
+		/// <returns>残った数</returns>
+		static uint32_t Cull(std::span<const MeshletBounds> Bounds, const MeshletCullConstants& Constants, std::vector<uint32_t>& OutVisible);
+	};
+}
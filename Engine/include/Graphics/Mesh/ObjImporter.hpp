@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<filesystem>
+#include<string_view>
+
+namespace Ecse::Graphics
+{
+	struct MeshAssetData;
+
+	/// <summary>
+	/// Wavefront OBJ の読み込み（焼く時だけ使う）
+	/// v / vt / vn / f のみを読み、多角形は扇状に三角形へ分ける。
+	/// OBJ は右手系・反時計回りが表なので、Z と V を反転し、三角形の順を逆にして左手系・時計回りが表にする。
+	/// 位置・UV・法線の組が同じ頂点は1つにまとめる。
+	/// </summary>
+	class ENGINE_API ObjImporter
+	{
+	public:
+		/// <summary>
+		/// ファイルから読む
+		/// </summary>
+		/// <param name="Path">ファイルの場所</param>
+		/// <param name="OutData">結果（メッシュレットは空のまま）</param>
+		/// <returns>true:成功</returns>
+		static bool Load(const std::filesystem::path& Path, MeshAssetData& OutData);
+
+		/// <summary>
+		/// 文字列から読む
+		/// </summary>
+		/// <param name="Text">OBJ の中身</param>
+		/// <param name="OutData">結果（メッシュレットは空のまま）</param>
+		/// <returns>true:成功</returns>
+		static bool Parse(std::string_view Text, MeshAssetData& OutData);
+	};
+}
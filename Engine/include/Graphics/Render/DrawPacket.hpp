@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include<cstdint>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 1回の描画の依頼
+	/// Key の昇順に並べると、パス → 不透明/半透明 → 状態の変化が少ない順になる
+	/// </summary>
+	struct DrawPacket
+	{
+		//	並べ替えのキー（DrawKey で作る）
+		uint64_t Key;
+		//	RenderProxyBuffer の添字
+		uint32_t Proxy;
+		//	メッシュのID
+		uint32_t Mesh;
+	};
+
+	/// <summary>
+	/// 64ビットの並べ替えキーの詰め方
+	/// 
+	/// 不透明 : [パス 4][0][PSO 11][マテリアル 24][深度 24]  手前から奥へ
+	/// 半透明 : [パス 4][1][奥からの深度 24][PSO 11][マテリアル 24]  奥から手前へ
+	/// </summary>
+	struct DrawKey
+	{
+		static constexpr uint32_t PASS_BITS = 4;
+		static constexpr uint32_t TRANSLUCENT_BITS = 1;
+		static constexpr uint32_t PSO_BITS = 11;
+		static constexpr uint32_t MATERIAL_BITS = 24;
+		static constexpr uint32_t DEPTH_BITS = 24;
+		static_assert(PASS_BITS + TRANSLUCENT_BITS + PSO_BITS + MATERIAL_BITS + DEPTH_BITS == 64);
+
+		static constexpr uint32_t PASS_SHIFT = 64 - PASS_BITS;
+		static constexpr uint32_t TRANSLUCENT_SHIFT = PASS_SHIFT - TRANSLUCENT_BITS;
+
+		static constexpr uint64_t PASS_MASK = (1ull << PASS_BITS) - 1;
+		static constexpr uint64_t PSO_MASK = (1ull << PSO_BITS) - 1;
+		static constexpr uint64_t MATERIAL_MASK = (1ull << MATERIAL_BITS) - 1;
+		static constexpr uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+		/// <summary>
+		/// キーの作成（範囲を超えた値は切り詰める）
+		/// </summary>
+		/// <param name="Pass">描画パス</param>
+		/// <param name="IsTranslucent">半透明か</param>
+		/// <param name="Pso">パイプラインのID</param>
+		/// <param name="Material">マテリアルのID</param>
+		/// <param name="Depth01">手前 0 から奥 1 の深度</param>
+		static constexpr uint64_t Make(uint32_t Pass, bool IsTranslucent, uint32_t Pso, uint32_t Material, float Depth01)
+		{
+			const float clamped = Depth01 < 0.0f ? 0.0f : (Depth01 > 1.0f ? 1.0f : Depth01);
+			const uint64_t depth = static_cast<uint64_t>(clamped * static_cast<float>(DEPTH_MASK)) & DEPTH_MASK;
+
+			uint64_t key = (static_cast<uint64_t>(Pass) & PASS_MASK) << PASS_SHIFT;
+			if (IsTranslucent == false)
+			{
+				key |= (static_cast<uint64_t>(Pso) & PSO_MASK) << (MATERIAL_BITS + DEPTH_BITS);
+				key |= (static_cast<uint64_t>(Material) & MATERIAL_MASK) << DEPTH_BITS;
+				key |= depth;
+			}
+			else
+			{
+				key |= 1ull << TRANSLUCENT_SHIFT;
+				key |= (DEPTH_MASK - depth) << (PSO_BITS + MATERIAL_BITS);
+				key |= (static_cast<uint64_t>(Pso) & PSO_MASK) << MATERIAL_BITS;
+				key |= static_cast<uint64_t>(Material) & MATERIAL_MASK;
+			}
+			return key;
+		}
+
+		/// <summary>
+		/// 描画パス
+		/// </summary>
+		static constexpr uint32_t GetPass(uint64_t Key)
+		{
+			return static_cast<uint32_t>((Key >> PASS_SHIFT) & PASS_MASK);
+		}
+
+		/// <summary>
+		/// 半透明か
+		/// </summary>
+		static constexpr bool IsTranslucent(uint64_t Key)
+		{
+			return ((Key >> TRANSLUCENT_SHIFT) & 1) != 0;
+		}
+
+		/// <summary>
+		/// パイプラインのID
+		/// </summary>
+		static constexpr uint32_t GetPso(uint64_t Key)
+		{
+			const uint32_t shift = IsTranslucent(Key) ? MATERIAL_BITS : MATERIAL_BITS + DEPTH_BITS;
+			return static_cast<uint32_t>((Key >> shift) & PSO_MASK);
+		}
+
+		/// <summary>
+		/// マテリアルのID
+		/// </summary>
+		static constexpr uint32_t GetMaterial(uint64_t Key)
+		{
+			const uint32_t shift = IsTranslucent(Key) ? 0 : DEPTH_BITS;
+			return static_cast<uint32_t>((Key >> shift) & MATERIAL_MASK);
+		}
+	};
+}
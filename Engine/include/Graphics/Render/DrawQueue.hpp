@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Render/DrawPacket.hpp>
+#include<DirectXMath.h>
+
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct RenderProxyBuffer;
+
+	/// <summary>
+	/// 並べ替えの前後での状態の切り替え回数
+	/// </summary>
+	struct DrawQueueStats
+	{
+		//	描画の数
+		uint32_t PacketCount = 0;
+		//	並べ替え前の切り替え回数
+		uint32_t PsoChangesBefore = 0;
+		uint32_t MaterialChangesBefore = 0;
+		uint32_t MeshChangesBefore = 0;
+		//	並べ替え後の切り替え回数
+		uint32_t PsoChanges = 0;
+		uint32_t MaterialChanges = 0;
+		uint32_t MeshChanges = 0;
+		//	実際に行った桁の数（全てのキーで同じ桁は飛ばす）
+		uint32_t RadixPasses = 0;
+		//	並べ替えにかかった時間（ミリ秒）
+		double SortMs = 0.0;
+	};
+
+	/// <summary>
+	/// 描画の依頼を集めて、キーの順に並べ替える
+	/// 並べ替えは8ビットずつの LSD 基数ソートで、ヒストグラムと書き込みを JobSystem で分ける。
+	/// 安定ソートなのでキーが同じものは積んだ順を保つ。
+	/// </summary>
+	class ENGINE_API DrawQueue
+	{
+	public:
+		/// <summary>
+		/// 1スレッドが受け持つ最小の数
+		/// </summary>
+		static constexpr uint32_t CHUNK_SIZE = 16384;
+
+		DrawQueue();
+
+		/// <summary>
+		/// 全ての削除（確保したメモリは残す）
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// 依頼の追加
+		/// </summary>
+		void Push(const DrawPacket& Packet);
+
+		/// <summary>
+		/// 見えているプロキシの依頼をまとめて追加（並列）
+		/// </summary>
+		/// <param name="Proxies">描画対象</param>
+		/// <param name="Visible">カリング済みの添字</param>
+		/// <param name="View">ビュー行列（深度の計算に使う）</param>
+		/// <param name="NearZ">深度 0 にする距離</param>
+		/// <param name="FarZ">深度 1 にする距離</param>
+		/// <param name="Pass">描画パス</param>
+		/// <param name="Meshes">Visible と同じ並びの描くメッシュ（LodSelector::GetMeshes、空ならプロキシのメッシュ）</param>
+		void AddProxies(const RenderProxyBuffer& Proxies, std::span<const uint32_t> Visible, const DirectX::XMFLOAT4X4& View, float NearZ, float FarZ, uint32_t Pass, std::span<const uint32_t> Meshes = {});
+
+		/// <summary>
+		/// キーの昇順に並べ替えて、切り替え回数を数える
+		/// </summary>
+		void Sort();
+
+		/// <summary>
+		/// 依頼の並び
+		/// </summary>
+		std::span<const DrawPacket> GetPackets() const;
+
+		/// <summary>
+		/// 直近の Sort の結果
+		/// </summary>
+		const DrawQueueStats& GetStats() const;
+
+	private:
+		/// <summary>
+		/// 並びの状態の切り替え回数
+		/// </summary>
+		void CountChanges(uint32_t& OutPso, uint32_t& OutMaterial, uint32_t& OutMesh) const;
+
+	private:
+		/// <summary>
+		/// 依頼
+		/// </summary>
+		std::vector<DrawPacket> mPackets;
+		/// <summary>
+		/// 並べ替えの書き込み先
+		/// </summary>
+		std::vector<DrawPacket> mScratch;
+		/// <summary>
+		/// 塊ごとのヒストグラム（塊数 × 256）
+		/// </summary>
+		std::vector<uint32_t> mHistograms;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		DrawQueueStats mStats;
+	};
+}
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<Graphics/Render/DrawPacket.hpp>
+#include<DirectXMath.h>
+
+#include<cstdint>
+#include<functional>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct RenderProxyBuffer;
+	class UploadRingBuffer;
+
+	/// <summary>
+	/// インスタンスごとにシェーダーへ渡すデータ
+	/// 行ベクトル用の行列をそのまま詰めるので、HLSL 側は row_major で読む
+	/// </summary>
+	struct InstanceData
+	{
+		//	ワールド行列
+		DirectX::XMFLOAT4X4 World;
+	};
+
+	/// <summary>
+	/// 1回のインスタンス描画
+	/// </summary>
+	struct InstanceBatch
+	{
+		//	描画パス
+		uint32_t Pass;
+		//	パイプライン・マテリアル・メッシュのID
+		uint32_t Pso;
+		uint32_t Material;
+		uint32_t Mesh;
+		//	インスタンス配列の中での開始位置と数
+		uint32_t FirstInstance;
+		uint32_t InstanceCount;
+		//	このバッチの先頭インスタンスのGPUアドレス（D3D12_GPU_VIRTUAL_ADDRESS。Upload 前は 0）
+		uint64_t InstanceAddress;
+	};
+
+	/// <summary>
+	/// まとめた結果
+	/// </summary>
+	struct InstanceBatchStats
+	{
+		//	まとめる前の描画の数
+		uint32_t PacketCount = 0;
+		//	まとめた後の描画の数
+		uint32_t BatchCount = 0;
+		//	一番大きいバッチのインスタンス数
+		uint32_t LargestBatch = 0;
+		//	アップロードしたバイト数
+		uint64_t UploadBytes = 0;
+		//	まとめる・アップロード・記録にかかった時間（ミリ秒）
+		double BuildMs = 0.0;
+		double UploadMs = 0.0;
+		double RecordMs = 0.0;
+	};
+
+	/// <summary>
+	/// 並べ替え済みの描画の依頼から、同じメッシュ・マテリアル・PSO のものを1回のインスタンス描画にまとめる
+	/// 不透明は同じ状態の並びの中でメッシュごとに集める（メッシュは最初に出てきた順なので手前からの順はおおよそ保つ）。
+	/// 半透明は順番を崩せないので、隣り合っているものだけをまとめる。
+	/// SV_InstanceID は StartInstanceLocation を含まないので、バッチごとに先頭のアドレスをルートSRVとして渡す。
+	/// </summary>
+	class ENGINE_API InstanceBatcher
+	{
+	public:
+		/// <summary>
+		/// 1スレッドが受け持つ最小のインスタンス数
+		/// </summary>
+		static constexpr uint32_t CHUNK_SIZE = 8192;
+
+		InstanceBatcher();
+
+		/// <summary>
+		/// バッチの組み立て（インスタンスデータはまだ書かない）
+		/// </summary>
+		/// <param name="Packets">DrawQueue::Sort 済みの依頼</param>
+		/// <param name="Proxies">依頼の Proxy が指す描画対象</param>
+		void Build(std::span<const DrawPacket> Packets, const RenderProxyBuffer& Proxies);
+
+		/// <summary>
+		/// インスタンスデータの書き込み（並列）
+		/// </summary>
+		/// <param name="pDest">GetInstanceCount 個分の書き込み先</param>
+		void WriteInstances(InstanceData* pDest) const;
+
+#if defined(_WIN32)
+		/// <summary>
+		/// インスタンスデータをリングから切り出してアップロードし、バッチのアドレスを埋める
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool Upload(UploadRingBuffer& Ring);
+
+		/// <summary>
+		/// バッチの記録
+		/// </summary>
+		/// <param name="CmdList">記録先</param>
+		/// <param name="InstanceRootParameter">インスタンスデータのルートSRVの番号</param>
+		/// <param name="DrawFunc">メッシュとマテリアルを設定して DrawIndexedInstanced を呼ぶ処理</param>
+		void Record(ID3D12GraphicsCommandList* CmdList, UINT InstanceRootParameter, const std::function<void(ID3D12GraphicsCommandList*, const InstanceBatch&)>& DrawFunc);
+#endif
+
+		/// <summary>
+		/// まとめたバッチ
+		/// </summary>
+		std::span<const InstanceBatch> GetBatches() const;
+
+		/// <summary>
+		/// インスタンスの総数
+		/// </summary>
+		uint32_t GetInstanceCount() const;
+
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		const InstanceBatchStats& GetStats() const;
+
+	private:
+		/// <summary>
+		/// 不透明で状態が同じ並びをメッシュごとにまとめる
+		/// </summary>
+		void BuildOpaqueRun(std::span<const DrawPacket> Packets, uint32_t Begin, uint32_t End);
+
+	private:
+		/// <summary>
+		/// 直近の Build の描画対象
+		/// </summary>
+		const RenderProxyBuffer* mpProxies;
+		/// <summary>
+		/// まとめたバッチ
+		/// </summary>
+		std::vector<InstanceBatch> mBatches;
+		/// <summary>
+		/// インスタンスの並び順に、読むプロキシの添字
+		/// </summary>
+		std::vector<uint32_t> mInstanceProxies;
+		/// <summary>
+		/// メッシュIDごとの、今の並びでのバッチの添字
+		/// </summary>
+		std::vector<uint32_t> mMeshBatch;
+		/// <summary>
+		/// mMeshBatch がどの並びで書かれたか（毎回消さずに済ませる）
+		/// </summary>
+		std::vector<uint32_t> mMeshStamp;
+		/// <summary>
+		/// 並びの番号
+		/// </summary>
+		uint32_t mRunStamp;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		InstanceBatchStats mStats;
+	};
+}
@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<ECS/Component/LodComponent.hpp>
+#include<entt/entt.hpp>
+#include<DirectXMath.h>
+
+#include<array>
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	struct RenderProxyBuffer;
+
+	/// <summary>
+	/// 直近の選択の結果
+	/// </summary>
+	struct LodStats
+	{
+		//	判定した数（LOD を持たないものも含む）
+		uint32_t Tested = 0;
+		//	小さすぎて描かなくなった数
+		uint32_t Culled = 0;
+		//	前回からレベルが変わった数
+		uint32_t Changed = 0;
+		//	レベルごとの数
+		std::array<uint32_t, ECS::LodComponent::MAX_LEVELS> PerLevel = {};
+		//	閾値に掛けた倍率
+		float Scale = 1.0f;
+		//	かかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// 画面上の大きさから LOD のレベルを選ぶ
+	/// カリング済みの添字を受け取り、描くものだけの添字と描くメッシュを返す（DrawQueue::AddProxies に渡す）。
+	///
+	/// レベルの境目には幅（ヒステリシス）を持たせ、細かい側から粗い側へは閾値の (1 - h) 倍を、
+	/// 粗い側から細かい側へは (1 + h) 倍を越えた時だけ切り替えるので、境目でちらつかない。
+	/// 前回のレベルはエンティティの番号ごとに持つ。
+	///
+	/// フレーム時間が目標を超えると全ての閾値に掛ける倍率を上げ、早めに粗いレベルへ落とす。
+	/// </summary>
+	class ENGINE_API LodSelector
+	{
+	public:
+		/// <summary>
+		/// 1スレッドが受け持つ最小の数
+		/// </summary>
+		static constexpr uint32_t CHUNK_SIZE = 4096;
+
+		/// <summary>
+		/// 描かない時のレベル
+		/// </summary>
+		static constexpr uint8_t CULLED_LEVEL = 0xFF;
+
+		/// <summary>
+		/// 前回のレベルがない時（初めて見えた）
+		/// </summary>
+		static constexpr uint8_t UNKNOWN_LEVEL = 0xFE;
+
+		LodSelector();
+
+		/// <summary>
+		/// レベルを選ぶ（並列）
+		/// </summary>
+		/// <param name="Proxies">描画対象</param>
+		/// <param name="Visible">カリング済みの添字</param>
+		/// <param name="CameraPosition">ワールド空間のカメラの位置</param>
+		/// <param name="Projection">プロジェクション行列（_22 を使う）</param>
+		void Select(const RenderProxyBuffer& Proxies, std::span<const uint32_t> Visible, const DirectX::XMFLOAT3& CameraPosition, const DirectX::XMFLOAT4X4& Projection);
+
+		/// <summary>
+		/// 描くものだけの添字（Visible の順を保つ）
+		/// </summary>
+		std::span<const uint32_t> GetVisible() const;
+
+		/// <summary>
+		/// GetVisible と同じ並びの描くメッシュのID
+		/// </summary>
+		std::span<const uint32_t> GetMeshes() const;
+
+		/// <summary>
+		/// 境目の幅（0 以上 1 未満）
+		/// </summary>
+		void SetHysteresis(float Hysteresis);
+		float GetHysteresis() const;
+
+		/// <summary>
+		/// 目標のフレーム時間（ミリ秒、0 なら倍率を変えない）
+		/// </summary>
+		void SetTargetFrameTime(double TargetMs);
+
+		/// <summary>
+		/// 倍率の上限
+		/// </summary>
+		void SetMaxScale(float MaxScale);
+
+		/// <summary>
+		/// 直近のフレーム時間で倍率を更新する（フレームに1回）
+		/// 持ち主の描画の処理が Select の前に Engine::GetFrameStats().FrameMs を渡す。
+		/// </summary>
+		/// <param name="FrameMs">直近のフレーム時間（ミリ秒）</param>
+		void UpdateBudget(double FrameMs);
+
+		/// <summary>
+		/// 今の閾値の倍率
+		/// </summary>
+		float GetScale() const;
+
+		/// <summary>
+		/// 前回のレベルを全て忘れる（シーンの切り替えなど）
+		/// </summary>
+		void Reset();
+
+		/// <summary>
+		/// 直近の Select の結果
+		/// </summary>
+		const LodStats& GetStats() const;
+
+		/// <summary>
+		/// 画面上の大きさ（包む球の直径 / 画面の高さ）
+		/// </summary>
+		/// <param name="Radius">包む球の半径</param>
+		/// <param name="Distance">カメラからの距離</param>
+		/// <param name="ProjectionScale">プロジェクション行列の _22（1 / tan(縦の画角 / 2)）</param>
+		static float ComputeScreenSize(float Radius, float Distance, float ProjectionScale);
+
+		/// <summary>
+		/// ヒステリシス付きでレベルを選ぶ
+		/// </summary>
+		/// <param name="Lod">詳細度</param>
+		/// <param name="ScreenSize">画面上の大きさ</param>
+		/// <param name="Previous">前回のレベル（初めてなら UNKNOWN_LEVEL）</param>
+		/// <param name="Scale">閾値に掛ける倍率</param>
+		/// <param name="Hysteresis">境目の幅</param>
+		/// <returns>レベル（描かないなら CULLED_LEVEL）</returns>
+		static uint8_t SelectLevel(const ECS::LodComponent& Lod, float ScreenSize, uint8_t Previous, float Scale, float Hysteresis);
+
+	private:
+		/// <summary>
+		/// 描くものだけの添字
+		/// </summary>
+		std::vector<uint32_t> mVisible;
+		/// <summary>
+		/// 描くメッシュのID
+		/// </summary>
+		std::vector<uint32_t> mMeshes;
+		/// <summary>
+		/// 入力と同じ並びの選んだレベル
+		/// </summary>
+		std::vector<uint8_t> mSelected;
+		/// <summary>
+		/// エンティティの番号ごとの前回のレベルと、その時のエンティティ（世代の確認）
+		/// </summary>
+		std::vector<uint8_t> mPreviousLevels;
+		std::vector<entt::entity> mPreviousOwners;
+		/// <summary>
+		/// 境目の幅
+		/// </summary>
+		float mHysteresis;
+		/// <summary>
+		/// 閾値の倍率と上限
+		/// </summary>
+		float mScale;
+		float mMaxScale;
+		/// <summary>
+		/// 目標のフレーム時間（ミリ秒）
+		/// </summary>
+		double mTargetFrameMs;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		LodStats mStats;
+	};
+}
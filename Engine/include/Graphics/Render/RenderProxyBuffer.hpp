@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include<ECS/Component/LodComponent.hpp>
+
+#include<entt/entt.hpp>
+#include<DirectXMath.h>
+
+#include<cstdint>
+#include<vector>
+
+namespace Ecse::ECS
+{
+	struct TransformComponent;
+	struct MeshRendererComponent;
+}
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 描画に必要な状態だけを抜き出した連続配列（SoA）
+	/// カリング・ソート・記録はレジストリではなくこちらを読む。
+	/// 同じ添字が同じ描画対象を指す。
+	/// </summary>
+	struct RenderProxyBuffer
+	{
+		/// <summary>
+		/// 対応するプロキシがない時の値
+		/// </summary>
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		/// <summary>
+		/// Flags のビット
+		/// </summary>
+		static constexpr uint8_t FLAG_OCCLUDER = 1 << 0;
+		static constexpr uint8_t FLAG_TRANSLUCENT = 1 << 1;
+
+		//	元のエンティティ
+		std::vector<entt::entity> Entities;
+		//	ワールド行列
+		std::vector<DirectX::XMFLOAT4X4> World;
+		//	メッシュ・マテリアル・パイプラインのID
+		std::vector<uint32_t> Mesh;
+		std::vector<uint32_t> Material;
+		std::vector<uint32_t> Pipeline;
+		//	ワールド空間のAABB。SIMDで8個ずつ読めるように成分ごとに分ける
+		std::vector<float> CenterX;
+		std::vector<float> CenterY;
+		std::vector<float> CenterZ;
+		std::vector<float> ExtentX;
+		std::vector<float> ExtentY;
+		std::vector<float> ExtentZ;
+		//	AABBを包む球の半径（中心はAABBと同じ）
+		std::vector<float> Radius;
+		//	ローカル空間のAABB（遮蔽物として回転したまま箱を描く時に使う）
+		std::vector<DirectX::XMFLOAT3> LocalCenter;
+		std::vector<DirectX::XMFLOAT3> LocalExtents;
+		//	FLAG_ の組み合わせ
+		std::vector<uint8_t> Flags;
+		//	詳細度（LevelCount が 0 なら Mesh のまま）
+		std::vector<ECS::LodComponent> Lods;
+
+		//	エンティティの番号からプロキシの添字への対応
+		std::vector<uint32_t> Lookup;
+
+		/// <summary>
+		/// 描画対象の数
+		/// </summary>
+		uint32_t GetCount() const { return static_cast<uint32_t>(Entities.size()); }
+
+		/// <summary>
+		/// エンティティに対応する添字（INVALID_INDEX:なし）
+		/// </summary>
+		uint32_t Find(entt::entity Entity) const;
+
+		/// <summary>
+		/// 追加または上書き
+		/// </summary>
+		/// <param name="pLod">詳細度（なければ nullptr）</param>
+		/// <returns>書き込んだ添字</returns>
+		uint32_t Upsert(entt::entity Entity, const ECS::TransformComponent& Transform, const ECS::MeshRendererComponent& Renderer, uint8_t Flag = 0, const ECS::LodComponent* pLod = nullptr);
+
+		/// <summary>
+		/// 削除（末尾と入れ替えるので添字は詰まる）
+		/// </summary>
+		void Remove(entt::entity Entity);
+
+		/// <summary>
+		/// 全ての削除
+		/// </summary>
+		void Clear();
+	};
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/Thread/RenderThread.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+
+#include<entt/entt.hpp>
+#include<array>
+#include<mutex>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// レジストリから描画用の状態を抜き出す
+	/// 変更のあったエンティティだけを記録しておき、フレームごとに
+	/// スナップショット番号ごとのプロキシバッファへ反映する。
+	/// 抜き出した後はゲームスレッドがレジストリを書き換えても描画側に影響しない。
+	/// </summary>
+	class ENGINE_API RenderWorld : public System::ServiceProvider<RenderWorld>
+	{
+		ECSE_SERVICE_ACCESS(RenderWorld);
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// 初期化。変更検知のシグナルを繋ぐ
+		/// </summary>
+		/// <param name="Registry">監視するレジストリ</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(entt::registry& Registry);
+
+		/// <summary>
+		/// 変更のあったエンティティをプロキシバッファへ反映（ゲームスレッド）
+		/// </summary>
+		/// <param name="Slot">書き込むスナップショット番号</param>
+		void Extract(uint32_t Slot);
+
+		/// <summary>
+		/// 抜き出し済みのプロキシバッファ（描画スレッド）
+		/// </summary>
+		/// <param name="Slot">読み込むスナップショット番号</param>
+		const RenderProxyBuffer& GetProxies(uint32_t Slot) const;
+
+		/// <summary>
+		/// 直近の Extract で更新したエンティティ数
+		/// </summary>
+		uint32_t GetLastUpdatedCount() const;
+
+	private:
+		/// <summary>
+		/// 描画に関わるコンポーネントが変わった時に呼ばれる（SystemScheduler で同時に動くシステムから呼ばれることがある）
+		/// </summary>
+		void OnChanged(entt::registry& Registry, entt::entity Entity);
+
+		/// <summary>
+		/// 監視の解除
+		/// </summary>
+		void Disconnect();
+
+	private:
+		/// <summary>
+		/// 監視中のレジストリ
+		/// </summary>
+		entt::registry* mpRegistry;
+		/// <summary>
+		/// スナップショットごとのプロキシバッファ
+		/// </summary>
+		std::array<RenderProxyBuffer, System::FRAME_SNAPSHOT_COUNT> mBuffers;
+		/// <summary>
+		/// スナップショットごとの未反映エンティティ
+		/// </summary>
+		std::array<std::vector<entt::entity>, System::FRAME_SNAPSHOT_COUNT> mPending;
+		/// <summary>
+		/// エンティティ番号ごとの「どのスナップショットに未反映か」のビット（重複登録防止）
+		/// </summary>
+		std::vector<uint8_t> mPendingMask;
+		/// <summary>
+		/// OnChanged での mPending と mPendingMask を守る
+		/// </summary>
+		std::mutex mPendingMutex;
+		/// <summary>
+		/// 直近の Extract で更新したエンティティ数
+		/// </summary>
+		uint32_t mLastUpdatedCount;
+	};
+}
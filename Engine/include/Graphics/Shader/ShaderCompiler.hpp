@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+
+#include<filesystem>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// HLSL ファイルの実行時コンパイル
+	/// </summary>
+	class ENGINE_API ShaderCompiler
+	{
+	public:
+		/// <summary>
+		/// ファイルからコンパイル（失敗したらエラー内容をログに出して nullptr）
+		/// </summary>
+		/// <param name="Path">HLSL ファイル</param>
+		/// <param name="EntryPoint">関数名</param>
+		/// <param name="Target">"cs_5_1" など</param>
+		/// <param name="pDefines">末尾が { nullptr, nullptr } のマクロ定義（なければ nullptr）</param>
+		static Blob CompileFromFile(const std::filesystem::path& Path, const char* EntryPoint, const char* Target, const D3D_SHADER_MACRO* pDefines = nullptr);
+	};
+}
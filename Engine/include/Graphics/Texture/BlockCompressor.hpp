@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstdint>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// ブロック圧縮の形式
+	/// </summary>
+	enum class EBlockFormat : uint8_t
+	{
+		//	RGB（アルファなし）4bit/ピクセル
+		BC1,
+		//	RGBA（アルファは BC4 と同じ）8bit/ピクセル
+		BC3,
+		//	R だけ 4bit/ピクセル
+		BC4,
+		//	RG（法線マップ用）8bit/ピクセル
+		BC5,
+		//	RGBA 高画質 8bit/ピクセル
+		BC7,
+	};
+
+	/// <summary>
+	/// DirectXTex を使わないブロック圧縮
+	/// DirectXTex が無い環境（Linux のビルド機など）で焼くためのもの。速さと画質はそこそこで、
+	/// 色は主成分の向きで端点を決めてから最小二乗で詰める。BC7 はモード6（1区画・RGBA・4bit の番号）だけを使う。
+	/// 入力は RGBA8 の 4x4 ピクセル（行優先で 64 バイト）。
+	/// </summary>
+	class ENGINE_API BlockCompressor
+	{
+	public:
+		/// <summary>
+		/// 1ブロックの大きさ（バイト）
+		/// </summary>
+		static uint32_t GetBlockSize(EBlockFormat Format);
+
+		/// <summary>
+		/// 1ブロックを圧縮する
+		/// </summary>
+		/// <param name="Format">形式</param>
+		/// <param name="Rgba">4x4 ピクセル（RGBA8、行優先）</param>
+		/// <param name="Out">書き込み先（GetBlockSize バイト）</param>
+		static void EncodeBlock(EBlockFormat Format, const uint8_t* Rgba, uint8_t* Out);
+
+		/// <summary>
+		/// 画像のブロックの行をまとめて圧縮する（端は一番外のピクセルを繰り返す）
+		/// 行ごとに分けて並列に呼べる。
+		/// </summary>
+		/// <param name="Format">形式</param>
+		/// <param name="Pixels">画像の先頭（RGBA8）</param>
+		/// <param name="Width">幅</param>
+		/// <param name="Height">高さ</param>
+		/// <param name="RowPitch">画像の1行の大きさ（バイト）</param>
+		/// <param name="FirstBlockRow">最初のブロックの行</param>
+		/// <param name="BlockRowCount">ブロックの行の数</param>
+		/// <param name="Out">FirstBlockRow の行の先頭の書き込み先</param>
+		static void EncodeRows(EBlockFormat Format, const uint8_t* Pixels, uint32_t Width, uint32_t Height, uint64_t RowPitch,
+			uint32_t FirstBlockRow, uint32_t BlockRowCount, uint8_t* Out);
+
+		static void EncodeBC1(const uint8_t* Rgba, uint8_t* Out);
+		static void EncodeBC3(const uint8_t* Rgba, uint8_t* Out);
+		static void EncodeBC4(const uint8_t* Rgba, uint32_t Channel, uint8_t* Out);
+		static void EncodeBC5(const uint8_t* Rgba, uint8_t* Out);
+		static void EncodeBC7(const uint8_t* Rgba, uint8_t* Out);
+	};
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Graphics/Texture/BlockCompressor.hpp>
+
+#include<cstdint>
+#include<filesystem>
+#include<span>
+#include<string>
+#include<vector>
+
+namespace Ecse::System
+{
+	class DerivedDataCache;
+}
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 圧縮に使うもの
+	/// </summary>
+	enum class ETextureEncoder : uint8_t
+	{
+		//	DirectXTex があればそれ、なければ BlockCompressor
+		Auto,
+		//	DirectXTex（Windows のみ）
+		DirectXTex,
+		//	BlockCompressor（どこでも動く）
+		Portable,
+	};
+
+	/// <summary>
+	/// 焼く時の設定
+	/// </summary>
+	struct TextureCookSettings
+	{
+		//	形式（BC4 と BC5 は色ではないので Srgb を無視する）
+		EBlockFormat Format = EBlockFormat::BC7;
+		//	色を sRGB として扱う（ミップを作る時に線形で平均し、_SRGB の形式で書く）
+		bool Srgb = true;
+		//	ミップを一番下まで作る（元がミップを持っていても作り直す）
+		bool GenerateMips = true;
+		//	圧縮に使うもの
+		ETextureEncoder Encoder = ETextureEncoder::Auto;
+	};
+
+	/// <summary>
+	/// 直近の焼いた結果
+	/// </summary>
+	struct TextureCookStats
+	{
+		//	大きさとミップの数
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipCount = 0;
+		//	元と書き出したファイルの大きさ（バイト）
+		uint64_t SourceSize = 0;
+		uint64_t FileSize = 0;
+		//	派生データのキャッシュから取った（焼いていない）
+		bool CacheHit = false;
+		//	BlockCompressor で圧縮した
+		bool UsedPortableEncoder = false;
+		//	キャッシュのキー
+		std::string CacheKey;
+		//	かかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// テクスチャをミップ付きのブロック圧縮の DDS に焼く
+	/// 元の画像を RGBA8 にしてミップを作り、各ミップをブロックの行ごとに分けて JobSystem で並列に圧縮する
+	/// （JobSystem が無ければ呼んだスレッドだけで）。
+	/// DirectXTex がある所（Windows）では読み込み・ミップ・圧縮に DirectXTex を使い、無い所では
+	/// TGA と非圧縮の DDS だけを読み、ミップは箱フィルタ、圧縮は BlockCompressor で行う。
+	/// 書き出す DDS は常に DX10 拡張付きで、TextureStreamer と TextureLoader がそのまま読める。
+	/// </summary>
+	class ENGINE_API TextureCooker
+	{
+	public:
+		/// <summary>
+		/// 焼き方のバージョン（焼いた結果が変わる変更をしたら上げる。キャッシュのキーに入る）
+		/// </summary>
+		static constexpr uint32_t COOKER_VERSION = 1;
+
+		/// <summary>
+		/// DirectXTex が使えるか
+		/// </summary>
+		static bool IsDirectXTexAvailable();
+
+		/// <summary>
+		/// 焼き方を表す文字列（キャッシュのキーに使う）
+		/// </summary>
+		/// <param name="Settings">設定</param>
+		/// <param name="Extension">元のファイルの拡張子（読み方が変わるので含める）</param>
+		static std::string MakeRecipe(const TextureCookSettings& Settings, const std::filesystem::path& Extension);
+
+		/// <summary>
+		/// メモリ上の画像を焼く
+		/// </summary>
+		/// <param name="Source">元のファイルの中身</param>
+		/// <param name="Extension">元のファイルの拡張子（.dds .tga .png など）</param>
+		/// <param name="Settings">設定</param>
+		/// <param name="OutBytes">DDS ファイル全体</param>
+		/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+		/// <returns>true:成功</returns>
+		static bool Cook(std::span<const uint8_t> Source, const std::filesystem::path& Extension, const TextureCookSettings& Settings,
+			std::vector<uint8_t>& OutBytes, TextureCookStats* pStats = nullptr);
+
+		/// <summary>
+		/// ファイルを焼いて書き出す。キャッシュにあれば焼かずにそれを書く
+		/// </summary>
+		/// <param name="Input">元のファイル</param>
+		/// <param name="Output">書き出し先</param>
+		/// <param name="Settings">設定</param>
+		/// <param name="pCache">派生データのキャッシュ（使わないなら nullptr）</param>
+		/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+		/// <returns>true:成功</returns>
+		static bool Write(const std::filesystem::path& Input, const std::filesystem::path& Output, const TextureCookSettings& Settings,
+			const System::DerivedDataCache* pCache = nullptr, TextureCookStats* pStats = nullptr);
+	};
+}
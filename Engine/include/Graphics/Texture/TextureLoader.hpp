@@ -0,0 +1,355 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapInfo.hpp>
+#include<Graphics/DX12/CopyUploader.hpp>
+#include<DirectXTex/DirectXTex.h>
+
+#include<atomic>
+#include<cstdint>
+#include<deque>
+#include<filesystem>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// テクスチャのハンドル（下位16ビットがスロット番号、上位16ビットが世代。0 は無効）
+	/// </summary>
+	using TextureHandle = uint32_t;
+
+	/// <summary>
+	/// 無効なハンドル
+	/// </summary>
+	inline constexpr TextureHandle INVALID_TEXTURE_HANDLE = 0;
+
+	/// <summary>
+	/// テクスチャの状態
+	/// </summary>
+	enum class ETextureState : uint8_t
+	{
+		//	ハンドルが無効
+		Invalid,
+		//	ワーカーで読み込み・展開中
+		Loading,
+		//	展開済みでコピーキューへ送る順番待ち
+		Decoded,
+		//	コピーキューで転送中
+		Uploading,
+		//	転送が終わり、シェーダーから読める
+		Resident,
+		//	読み込みか転送に失敗した
+		Failed,
+	};
+
+	/// <summary>
+	/// 直近の Update の結果
+	/// </summary>
+	struct TextureLoaderStats
+	{
+		//	状態ごとの数
+		uint32_t Loading = 0;
+		uint32_t Uploading = 0;
+		uint32_t Resident = 0;
+		uint32_t Failed = 0;
+		//	このフレームでステージングへ書いた大きさ（バイト）
+		uint64_t UploadedBytes = 0;
+		//	転送待ちで使用中のステージングの大きさ（バイト）
+		uint64_t StagingUsed = 0;
+		//	Update にかかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// テクスチャの非同期読み込み
+	/// Load はハンドルを返すだけで、ファイルの読み込みと展開（DDS・TGA・HDR・WIC）、足りないミップの生成、
+	/// テクスチャの作成はワーカースレッドで行う。
+	/// Update（ゲームスレッドでフレームに1回）は展開済みのものをステージングリングへ書き、
+	/// コピーキューで CopyTextureRegion を送る。フェンスの完了は GetCompletedValue で覗くだけで待たないので、
+	/// リングやアロケーターが空いていなければ次のフレームへ回す。
+	///
+	/// 転送が終わるまでは GetGpuHandle がプレースホルダー（市松模様）のディスクリプタを返し、
+	/// 完了を確認したフレームで新しいディスクリプタに差し替えてコールバックを呼ぶ。
+	/// 描画中のディスクリプタを書き換えないように、使い終わったものは数フレーム遅らせて返す。
+	/// テクスチャは COMMON で作り、コピーキューの後は COMMON に戻るので、直接キューでは暗黙にシェーダーリソースへ移る。
+	/// </summary>
+	class ENGINE_API TextureLoader : public System::ServiceProvider<TextureLoader>
+	{
+		ECSE_SERVICE_ACCESS(TextureLoader);
+
+	public:
+		/// <summary>
+		/// 読み込みの完了時に呼ばれる（Update の中、ゲームスレッド）
+		/// </summary>
+		using Callback = std::function<void(TextureHandle Handle, bool Succeeded)>;
+
+		/// <summary>
+		/// 同時に持てるテクスチャの最大数
+		/// </summary>
+		static constexpr uint32_t MAX_TEXTURES = 1024;
+
+		/// <summary>
+		/// 既定のステージングリングの大きさ
+		/// </summary>
+		static constexpr uint64_t DEFAULT_STAGING_SIZE = 64ull * 1024 * 1024;
+
+		/// <summary>
+		/// 既定の1フレームにステージングへ書く上限（1枚目は上限を超えても書く）
+		/// </summary>
+		static constexpr uint64_t DEFAULT_FRAME_UPLOAD_BUDGET = 16ull * 1024 * 1024;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// コピーキューとステージングの作成、プレースホルダーの転送
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="StagingSize">ステージングリングの大きさ（バイト）</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, uint64_t StagingSize = DEFAULT_STAGING_SIZE);
+
+		/// <summary>
+		/// 読み込みを始める（すぐに返る）
+		/// </summary>
+		/// <param name="Path">ファイルの場所</param>
+		/// <param name="OnLoaded">完了時に呼ばれる（省略可）</param>
+		/// <returns>ハンドル（空きがなければ INVALID_TEXTURE_HANDLE）</returns>
+		TextureHandle Load(const std::filesystem::path& Path, Callback OnLoaded = nullptr);
+
+		/// <summary>
+		/// テクスチャを手放す。GPU が使い終わるまで数フレーム遅らせて解放する
+		/// </summary>
+		void Unload(TextureHandle Handle);
+
+		/// <summary>
+		/// 完了した転送の反映と、展開済みのものの送信（ゲームスレッドでフレームに1回）
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// 状態
+		/// </summary>
+		ETextureState GetState(TextureHandle Handle) const;
+
+		/// <summary>
+		/// シェーダーから読むディスクリプタ（転送が終わるまではプレースホルダー）
+		/// 解決済みの値を読むだけなので描画スレッドからも呼べる。
+		/// </summary>
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(TextureHandle Handle) const;
+
+		/// <summary>
+		/// ヒープの先頭からのディスクリプタの番号（バインドレス用。転送が終わるまではプレースホルダー）
+		/// </summary>
+		uint32_t GetDescriptorIndex(TextureHandle Handle) const;
+
+		/// <summary>
+		/// プレースホルダーのディスクリプタの番号（TextureStreamer も最初の転送までこれを見せる）
+		/// </summary>
+		uint32_t GetPlaceholderIndex() const;
+
+		/// <summary>
+		/// テクスチャ本体（転送が終わるまでは nullptr）
+		/// </summary>
+		ID3D12Resource* GetResource(TextureHandle Handle) const;
+
+		/// <summary>
+		/// 1フレームにステージングへ書く上限（バイト）
+		/// </summary>
+		void SetFrameUploadBudget(uint64_t Bytes);
+
+		/// <summary>
+		/// 直近の Update の結果
+		/// </summary>
+		const TextureLoaderStats& GetStats() const;
+
+	private:
+		/// <summary>
+		/// ワーカーで作った、送る直前までのテクスチャ
+		/// </summary>
+		struct DecodedTexture
+		{
+			//	どのスロットの分か
+			TextureHandle Handle = INVALID_TEXTURE_HANDLE;
+			//	展開した画像（ミップ込み）
+			DirectX::ScratchImage Image;
+			//	DirectXTex の画像をサブリソースの順に並べたもの
+			std::vector<D3D12_SUBRESOURCE_DATA> Subresources;
+			//	COMMON で作ったテクスチャ
+			Resource Texture;
+			//	ステージング上の配置
+			std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Layouts;
+			std::vector<UINT> RowCounts;
+			std::vector<UINT64> RowSizes;
+			uint64_t TotalSize = 0;
+			//	作るビュー
+			D3D12_SHADER_RESOURCE_VIEW_DESC SrvDesc = {};
+			//	false なら失敗（Texture などは空）
+			bool Succeeded = false;
+		};
+
+		/// <summary>
+		/// ワーカーから受け取る箱。ワーカーが自分より長生きしても良いように共有で持つ
+		/// </summary>
+		struct DecodeQueue
+		{
+			std::mutex Mutex;
+			std::vector<std::unique_ptr<DecodedTexture>> Items;
+		};
+
+		/// <summary>
+		/// 1つのテクスチャの管理情報
+		/// </summary>
+		struct Slot
+		{
+			//	テクスチャ本体（Resident になってから持つ）
+			Resource Texture;
+			//	自分のディスクリプタ（Resident になってから持つ）
+			GDescritorHeapInfo Srv;
+			//	完了時の通知先
+			Callback OnLoaded;
+			//	ファイルの場所（ログ用）
+			std::filesystem::path Path;
+			//	何回使い回されたか
+			uint16_t Generation = 1;
+			//	状態
+			ETextureState State = ETextureState::Invalid;
+		};
+
+		/// <summary>
+		/// 1回の送信
+		/// </summary>
+		struct Submission
+		{
+			//	完了したらこの値になる
+			uint64_t FenceValue = 0;
+			//	含まれるテクスチャ
+			std::vector<std::unique_ptr<DecodedTexture>> Textures;
+		};
+
+		/// <summary>
+		/// 数フレーム後に解放するもの
+		/// </summary>
+		struct PendingRelease
+		{
+			Resource Texture;
+			GDescritorHeapInfo Srv;
+			uint64_t Frame = 0;
+		};
+
+		/// <summary>
+		/// ファイルを読み込んで展開し、テクスチャとステージング上の配置まで作る（ワーカー）
+		/// </summary>
+		static bool Decode(ID3D12Device* Device, const std::filesystem::path& Path, DecodedTexture& Out);
+
+		/// <summary>
+		/// 展開済みの画像からテクスチャとステージング上の配置を作る（ワーカー）
+		/// </summary>
+		static bool Prepare(ID3D12Device* Device, DecodedTexture& Out);
+
+		/// <summary>
+		/// 市松模様のプレースホルダーを作って転送し、完了まで待つ（初期化の時だけ）
+		/// </summary>
+		bool CreatePlaceholder();
+
+		/// <summary>
+		/// 完了した送信の反映
+		/// </summary>
+		void Retire(uint64_t CompletedValue);
+
+		/// <summary>
+		/// 展開済みのものをステージングへ書いてコピーキューへ送る
+		/// </summary>
+		void Submit();
+
+		/// <summary>
+		/// ステージングへ書いてコピーを記録する
+		/// </summary>
+		/// <param name="Texture">送るテクスチャ</param>
+		/// <param name="Offset">CopyUploader::AllocateStaging で切り出した位置</param>
+		void Record(const DecodedTexture& Texture, uint64_t Offset);
+
+		/// <summary>
+		/// 転送の終わったテクスチャにディスクリプタを作って差し替える
+		/// </summary>
+		void MakeResident(DecodedTexture& Texture);
+
+		/// <summary>
+		/// 失敗として通知する
+		/// </summary>
+		void Fail(TextureHandle Handle);
+
+		/// <summary>
+		/// ハンドルが指す、今も使われているスロット（古いハンドルなら nullptr）
+		/// </summary>
+		Slot* Find(TextureHandle Handle);
+		const Slot* Find(TextureHandle Handle) const;
+
+	private:
+		/// <summary>
+		/// デバイス
+		/// </summary>
+		ComPtr<ID3D12Device> mDevice;
+		/// <summary>
+		/// コピーキューとステージング
+		/// </summary>
+		CopyUploader mUploader;
+		/// <summary>
+		/// 1フレームにステージングへ書く上限
+		/// </summary>
+		uint64_t mFrameUploadBudget;
+		/// <summary>
+		/// スロットと空いている番号
+		/// </summary>
+		std::vector<Slot> mSlots;
+		std::vector<uint16_t> mFreeSlots;
+		/// <summary>
+		/// スロットごとの今見せるディスクリプタ（上位32ビットがハンドル、下位32ビットが番号。描画スレッドからも読む）
+		/// </summary>
+		std::unique_ptr<std::atomic<uint64_t>[]> mResolved;
+		/// <summary>
+		/// プレースホルダー
+		/// </summary>
+		Resource mPlaceholder;
+		GDescritorHeapInfo mPlaceholderSrv;
+		/// <summary>
+		/// ワーカーからの受け取り口と、送る順番待ち
+		/// </summary>
+		std::shared_ptr<DecodeQueue> mDecodeQueue;
+		std::deque<std::unique_ptr<DecodedTexture>> mDecoded;
+		/// <summary>
+		/// 転送中の送信（古い順）
+		/// </summary>
+		std::deque<Submission> mInFlight;
+		/// <summary>
+		/// 遅らせて解放するもの
+		/// </summary>
+		std::vector<PendingRelease> mPendingReleases;
+		/// <summary>
+		/// Update を呼んだ回数
+		/// </summary>
+		uint64_t mFrame;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		TextureLoaderStats mStats;
+		/// <summary>
+		/// 初期化済みか
+		/// </summary>
+		bool mIsInitialized;
+	};
+}
@@ -0,0 +1,405 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<Utility/Types/EcseTypes.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/IO/MappedFile.hpp>
+#include<Graphics/DX12/CopyUploader.hpp>
+#include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapInfo.hpp>
+#include<Graphics/Texture/TextureLoader.hpp>
+#include<Graphics/Texture/TextureStreamingPolicy.hpp>
+
+#include<array>
+#include<atomic>
+#include<cstdint>
+#include<deque>
+#include<filesystem>
+#include<memory>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 直近の Update の結果
+	/// </summary>
+	struct TextureStreamerStats
+	{
+		//	登録されている数
+		uint32_t Textures = 0;
+		//	転送中の数
+		uint32_t Streaming = 0;
+		//	置いてあるミップの大きさの合計（バイト）
+		uint64_t ResidentBytes = 0;
+		//	このフレームでステージングへ書いた大きさ（バイト）
+		uint64_t UploadedBytes = 0;
+		//	予算の割り当ての結果
+		StreamingBudgetStats Budget;
+		//	予約リソース（タイル）を使っているか
+		bool UsesReservedResources = false;
+		//	Update にかかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// ミップ単位のテクスチャのストリーミング
+	/// 毎フレーム ReportUsage で受け取った画面上の面積から欲しいミップを求め、TextureStreamingPolicy で
+	/// 予算の中でどこまで置くかを決めて、細かいミップを読み込んだり外したりする。
+	///
+	/// タイルリソースに対応していれば予約リソースを作り、ミップごとにヒープを割り当てる。
+	/// 細かくする時は割り当ててからコピーし、完了を確認したら ResourceMinLODClamp を下げたディスクリプタに差し替える。
+	/// 粗くする時はすぐに差し替え、描画が使い終わるフレーム数待ってから割り当てを外してヒープを返す。
+	/// 対応していなければ、置く範囲だけのミップを持つテクスチャを作り直して差し替える。
+	///
+	/// ファイルは DDS（2D・配列なし）だけ。割り当てたファイルのミップをそのままステージングへ写すので、展開は要らない。
+	/// 最初の転送が終わるまでは TextureLoader のプレースホルダーを見せる。
+	/// </summary>
+	class ENGINE_API TextureStreamer : public System::ServiceProvider<TextureStreamer>
+	{
+		ECSE_SERVICE_ACCESS(TextureStreamer);
+
+	public:
+		/// <summary>
+		/// 同時に持てるテクスチャの最大数
+		/// </summary>
+		static constexpr uint32_t MAX_TEXTURES = 1024;
+
+		/// <summary>
+		/// 既定の予算
+		/// </summary>
+		static constexpr uint64_t DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+		/// <summary>
+		/// 既定のステージングリングの大きさ
+		/// </summary>
+		static constexpr uint64_t DEFAULT_STAGING_SIZE = 64ull * 1024 * 1024;
+
+		/// <summary>
+		/// 既定の1フレームにステージングへ書く上限（1つ目は上限を超えても書く）
+		/// </summary>
+		static constexpr uint64_t DEFAULT_FRAME_UPLOAD_BUDGET = 16ull * 1024 * 1024;
+
+		/// <summary>
+		/// 作り直す時に常に置いておくミップの一辺（これ以下のミップは外さない）
+		/// </summary>
+		static constexpr uint32_t FALLBACK_RESIDENT_SIZE = 128;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// コピーキューとステージングの作成、タイルリソースの対応の確認
+		/// </summary>
+		/// <param name="Device">デバイス</param>
+		/// <param name="BudgetBytes">予算（バイト）</param>
+		/// <param name="StagingSize">ステージングリングの大きさ（バイト）</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(ID3D12Device* Device, uint64_t BudgetBytes = DEFAULT_BUDGET, uint64_t StagingSize = DEFAULT_STAGING_SIZE);
+
+		/// <summary>
+		/// テクスチャを登録する。常駐の末尾は次の Update から転送する
+		/// </summary>
+		/// <param name="Path">DDS ファイルの場所</param>
+		/// <returns>ハンドル（読めなければ INVALID_TEXTURE_HANDLE）</returns>
+		TextureHandle Register(const std::filesystem::path& Path);
+
+		/// <summary>
+		/// 登録を外す。GPU が使い終わるまで数フレーム遅らせて解放する
+		/// </summary>
+		void Unregister(TextureHandle Handle);
+
+		/// <summary>
+		/// このフレームで画面に映った面積を伝える（ゲームスレッド。何度呼んでも大きい方が残る）
+		/// </summary>
+		/// <param name="Handle">ハンドル</param>
+		/// <param name="ScreenPixels">画面上の面積（ピクセル数）</param>
+		void ReportUsage(TextureHandle Handle, float ScreenPixels);
+
+		/// <summary>
+		/// 完了した転送の反映、予算の割り当て、読み込みと取り外し（ゲームスレッドでフレームに1回）
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// 予算（バイト）
+		/// </summary>
+		void SetBudget(uint64_t Bytes);
+		uint64_t GetBudget() const;
+
+		/// <summary>
+		/// 欲しいミップをずらす段数（正で粗く）
+		/// </summary>
+		void SetMipBias(int32_t Bias);
+
+		/// <summary>
+		/// 1フレームにステージングへ書く上限（バイト）
+		/// </summary>
+		void SetFrameUploadBudget(uint64_t Bytes);
+
+		/// <summary>
+		/// シェーダーから読むディスクリプタ（最初の転送が終わるまではプレースホルダー）
+		/// 解決済みの値を読むだけなので描画スレッドからも呼べる。
+		/// </summary>
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(TextureHandle Handle) const;
+
+		/// <summary>
+		/// ヒープの先頭からのディスクリプタの番号（バインドレス用）
+		/// </summary>
+		uint32_t GetDescriptorIndex(TextureHandle Handle) const;
+
+		/// <summary>
+		/// 今置いてある一番細かいミップ（何も置いていなければミップの数）
+		/// </summary>
+		uint32_t GetResidentMip(TextureHandle Handle) const;
+
+		/// <summary>
+		/// 予約リソース（タイル）を使っているか
+		/// </summary>
+		bool IsUsingReservedResources() const;
+
+		/// <summary>
+		/// 直近の Update の結果
+		/// </summary>
+		const TextureStreamerStats& GetStats() const;
+
+	private:
+		/// <summary>
+		/// ファイルの中のミップの位置
+		/// </summary>
+		struct MipSource
+		{
+			//	ファイル先頭からの位置
+			uint64_t Offset = 0;
+			//	ファイルの中の1行の大きさ
+			uint64_t RowPitch = 0;
+			//	ファイルの中の1枚の大きさ
+			uint64_t SlicePitch = 0;
+		};
+
+		/// <summary>
+		/// 1つのテクスチャの管理情報
+		/// </summary>
+		struct Entry
+		{
+			//	割り当てたファイル（登録の間ずっと開いておく）
+			std::unique_ptr<System::MappedFile> File;
+			//	ファイルの情報とミップの位置
+			DirectX::TexMetadata Metadata = {};
+			std::array<MipSource, StreamingTexture::MAX_MIPS> Mips = {};
+			//	予算の割り当てに渡す情報
+			StreamingTexture Streaming;
+			//	テクスチャ本体（予約リソースなら全てのミップを持つ）
+			Resource Texture;
+			//	ミップごとに割り当てたヒープ（予約リソースの時だけ。末尾はまとめて先頭の番号に置く）
+			std::array<ComPtr<ID3D12Heap>, StreamingTexture::MAX_MIPS> MipHeaps;
+			//	ミップごとのタイルの数（末尾はまとめて先頭の番号に置く）
+			std::array<uint32_t, StreamingTexture::MAX_MIPS> MipTiles = {};
+			//	末尾としてまとめられた最初のミップ（なければミップの数）
+			uint8_t PackedMip = 0;
+			//	自分のディスクリプタ
+			GDescritorHeapInfo Srv;
+			//	転送中の目標（転送中でなければ NO_MIP）
+			uint8_t PendingMip = 0;
+			//	このフレームで映った面積の最大
+			float FrameScreenPixels = 0.0f;
+			//	外すのを待っている割り当ての数（これが 0 になるまで細かくしない）
+			uint32_t PendingUnmaps = 0;
+			//	何回使い回されたか
+			uint16_t Generation = 1;
+			//	予約リソースか（false なら置く範囲を変える度に作り直す）
+			bool Reserved = false;
+			//	使われているか
+			bool InUse = false;
+		};
+
+		/// <summary>
+		/// 転送中の読み込み
+		/// </summary>
+		struct StreamOp
+		{
+			TextureHandle Handle = INVALID_TEXTURE_HANDLE;
+			//	完了したら置いてある一番細かいミップになる
+			uint8_t TargetMip = 0;
+			//	完了したらこの値になる
+			uint64_t FenceValue = 0;
+			//	作り直したテクスチャ（作り直す時だけ）
+			Resource Texture;
+		};
+
+		/// <summary>
+		/// 数フレーム後に外す割り当て（予約リソースの時だけ）
+		/// </summary>
+		struct PendingUnmap
+		{
+			TextureHandle Handle = INVALID_TEXTURE_HANDLE;
+			//	外すミップの範囲 [Begin, End)
+			uint8_t Begin = 0;
+			uint8_t End = 0;
+			//	この時まで待つ
+			uint64_t Frame = 0;
+		};
+
+		/// <summary>
+		/// 数フレーム後に、かつコピーキューが追いついてから解放するもの
+		/// </summary>
+		struct PendingRelease
+		{
+			Resource Texture;
+			std::vector<ComPtr<ID3D12Heap>> Heaps;
+			GDescritorHeapInfo Srv;
+			uint64_t Frame = 0;
+			uint64_t FenceValue = 0;
+		};
+
+		/// <summary>
+		/// 転送中でないことを表すミップ
+		/// </summary>
+		static constexpr uint8_t NO_MIP = 0xFF;
+
+		/// <summary>
+		/// DDS を読んでミップの位置と予算の情報を作る
+		/// </summary>
+		bool Parse(Entry& Target, const std::filesystem::path& Path);
+
+		/// <summary>
+		/// 予約リソースを作り、タイルの数と予算の情報を埋める
+		/// </summary>
+		bool CreateReserved(Entry& Target);
+
+		/// <summary>
+		/// 作り直す時の予算の情報を埋める
+		/// </summary>
+		void SetupFallback(Entry& Target);
+
+		/// <summary>
+		/// 細かくする（予約リソース）。入った所までを StreamOp にする
+		/// </summary>
+		bool StreamInReserved(Entry& Target, TextureHandle Handle, uint8_t TargetMip, std::vector<StreamOp>& OutOps, uint64_t& InOutBytes);
+
+		/// <summary>
+		/// 置く範囲を変えて作り直す（予約リソースが使えない時）
+		/// </summary>
+		bool Rebuild(Entry& Target, TextureHandle Handle, uint8_t TargetMip, std::vector<StreamOp>& OutOps, uint64_t& InOutBytes);
+
+		/// <summary>
+		/// 粗くする（予約リソース）。すぐに差し替え、割り当ては数フレーム後に外す
+		/// </summary>
+		void EvictReserved(Entry& Target, TextureHandle Handle, uint8_t TargetMip);
+
+		/// <summary>
+		/// ミップにヒープを割り当てる（末尾ならまとめて）
+		/// </summary>
+		bool MapMip(Entry& Target, uint32_t Mip);
+
+		/// <summary>
+		/// ファイルの続いたミップをまとめてステージングへ写し、コピーを記録する
+		/// 全て入るか何もしないかのどちらか。
+		/// </summary>
+		/// <param name="Target">テクスチャ</param>
+		/// <param name="Destination">コピー先</param>
+		/// <param name="FirstMip">ファイルの最初のミップ</param>
+		/// <param name="FirstSubresource">コピー先の最初のサブリソース</param>
+		/// <param name="Count">ミップの数</param>
+		/// <returns>書いた大きさ（入らなければ 0）</returns>
+		uint64_t CopyMips(const Entry& Target, ID3D12Resource* Destination, uint32_t FirstMip, uint32_t FirstSubresource, uint32_t Count);
+
+		/// <summary>
+		/// 完了した読み込みの反映
+		/// </summary>
+		void Complete(StreamOp& Op);
+
+		/// <summary>
+		/// 新しいディスクリプタを作って差し替え、古いものは遅らせて返す
+		/// </summary>
+		void UpdateView(Entry& Target, TextureHandle Handle, uint8_t ResidentMip);
+
+		/// <summary>
+		/// 遅らせて外す割り当ての処理
+		/// </summary>
+		/// <returns>キューに割り当ての変更を積んだか（積んだらフェンスを進める）</returns>
+		bool ProcessUnmaps();
+
+		/// <summary>
+		/// 遅らせて解放するものの処理
+		/// </summary>
+		void ProcessReleases(uint64_t CompletedValue);
+
+		/// <summary>
+		/// ハンドルが指す、今も使われているものの管理情報（古いハンドルなら nullptr）
+		/// </summary>
+		Entry* Find(TextureHandle Handle);
+		const Entry* Find(TextureHandle Handle) const;
+
+	private:
+		/// <summary>
+		/// デバイス
+		/// </summary>
+		ComPtr<ID3D12Device> mDevice;
+		/// <summary>
+		/// コピーキューとステージング
+		/// </summary>
+		CopyUploader mUploader;
+		/// <summary>
+		/// 予算の割り当て
+		/// </summary>
+		TextureStreamingPolicy mPolicy;
+		std::vector<StreamingTexture> mPolicyInputs;
+		std::vector<uint8_t> mPolicyTargets;
+		std::vector<uint32_t> mPolicyEntries;
+		/// <summary>
+		/// 管理情報と空いている番号
+		/// </summary>
+		std::vector<Entry> mEntries;
+		std::vector<uint16_t> mFreeEntries;
+		/// <summary>
+		/// 番号ごとの今見せるディスクリプタ（上位32ビットがハンドル、下位32ビットが番号。描画スレッドからも読む）
+		/// </summary>
+		std::unique_ptr<std::atomic<uint64_t>[]> mResolved;
+		/// <summary>
+		/// 転送中の読み込み（古い順）
+		/// </summary>
+		std::deque<StreamOp> mOps;
+		/// <summary>
+		/// 遅らせて外す割り当てと、遅らせて解放するもの
+		/// </summary>
+		std::vector<PendingUnmap> mPendingUnmaps;
+		std::vector<PendingRelease> mPendingReleases;
+		/// <summary>
+		/// 予算と1フレームの上限
+		/// </summary>
+		uint64_t mBudget;
+		uint64_t mFrameUploadBudget;
+		/// <summary>
+		/// 欲しいミップをずらす段数
+		/// </summary>
+		int32_t mMipBias;
+		/// <summary>
+		/// 最初の転送までに見せるディスクリプタ
+		/// </summary>
+		uint32_t mPlaceholderIndex;
+		/// <summary>
+		/// タイルリソースが使えるか
+		/// </summary>
+		bool mUseReserved;
+		/// <summary>
+		/// Update を呼んだ回数
+		/// </summary>
+		uint64_t mFrame;
+		/// <summary>
+		/// 直近の結果
+		/// </summary>
+		TextureStreamerStats mStats;
+		/// <summary>
+		/// 初期化済みか
+		/// </summary>
+		bool mIsInitialized;
+	};
+}
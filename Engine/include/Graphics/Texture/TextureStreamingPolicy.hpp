@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<array>
+#include<cstdint>
+#include<span>
+#include<vector>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 予算の割り当てに渡す1枚分の情報
+	/// ミップの番号は 0 が一番細かい。「ミップ m まで置く」は m 〜 MipCount - 1 を全て置くこと。
+	/// </summary>
+	struct StreamingTexture
+	{
+		//	持てるミップの最大数
+		static constexpr uint32_t MAX_MIPS = 16;
+
+		//	ミップごとに置くのに要る大きさ（バイト）。常駐の末尾はまとめて MinResidentMip に入れ、残りは 0
+		std::array<uint64_t, MAX_MIPS> MipBytes = {};
+		//	ミップの数
+		uint8_t MipCount = 0;
+		//	常に置いておく一番細かいミップ（これより粗いものは外さない）
+		uint8_t MinResidentMip = 0;
+		//	画面上の使われ方から求めた欲しいミップ
+		uint8_t RequestedMip = 0;
+		//	今置いてある一番細かいミップ
+		uint8_t ResidentMip = 0;
+		//	優先度（画面上の面積。ピクセル数）
+		float Priority = 0.0f;
+		//	最後に画面に映ったフレーム
+		uint64_t LastUsedFrame = 0;
+	};
+
+	/// <summary>
+	/// 直近の割り当ての結果
+	/// </summary>
+	struct StreamingBudgetStats
+	{
+		//	予算
+		uint64_t BudgetBytes = 0;
+		//	常駐の末尾だけで使う大きさ
+		uint64_t MandatoryBytes = 0;
+		//	全て欲しいだけ置いた時の大きさ
+		uint64_t RequestedBytes = 0;
+		//	割り当てた結果の大きさ
+		uint64_t TargetBytes = 0;
+		//	細かくする数と粗くする（外す）数
+		uint32_t Upgrades = 0;
+		uint32_t Evictions = 0;
+		//	欲しくはないが予算に余裕があるので残した数
+		uint32_t Retained = 0;
+		//	予算が足りず欲しいミップまで届かなかった数
+		uint32_t Starved = 0;
+	};
+
+	/// <summary>
+	/// 画面上の使われ方から欲しいミップを求め、予算の中でどこまで置くかを決める
+	/// GPU には触らないので、単体で確かめられる。
+	///
+	/// 1. 全てのテクスチャに常駐の末尾（MinResidentMip より粗い分）を置く
+	/// 2. 画面上の面積が大きい順に、欲しいミップまで1段ずつ細かくする。入らなければそのテクスチャはそこで止め、
+	///    小さいものが入る余地があれば次へ進む
+	/// 3. 余った予算で、今置いてあるが欲しくはない細かいミップを最近映った順に残す（すぐに戻ってくるものを外さない）
+	/// </summary>
+	class ENGINE_API TextureStreamingPolicy
+	{
+	public:
+		/// <summary>
+		/// 画面上の面積から欲しいミップ
+		/// テクセル数が画面上のピクセル数に並ぶ一番粗いミップを選ぶ（1段下がるとテクセル数は 1/4）。
+		/// </summary>
+		/// <param name="Width">テクスチャの幅</param>
+		/// <param name="Height">テクスチャの高さ</param>
+		/// <param name="MipCount">ミップの数</param>
+		/// <param name="ScreenPixels">画面上の面積（ピクセル数、0 以下なら映っていない）</param>
+		/// <param name="Bias">ずらす段数（正で粗く）</param>
+		/// <returns>欲しいミップ</returns>
+		static uint8_t ComputeRequiredMip(uint32_t Width, uint32_t Height, uint32_t MipCount, float ScreenPixels, int32_t Bias = 0);
+
+		/// <summary>
+		/// ミップ Mip まで置いた時の大きさ
+		/// </summary>
+		static uint64_t ComputeResidentBytes(const StreamingTexture& Texture, uint32_t Mip);
+
+		/// <summary>
+		/// 予算の中でどこまで置くかを決める
+		/// </summary>
+		/// <param name="Textures">全てのテクスチャ</param>
+		/// <param name="BudgetBytes">予算（バイト）</param>
+		/// <param name="OutTargets">テクスチャごとに置く一番細かいミップ（Textures と同じ数）</param>
+		/// <returns>結果</returns>
+		StreamingBudgetStats Resolve(std::span<const StreamingTexture> Textures, uint64_t BudgetBytes, std::span<uint8_t> OutTargets);
+
+	private:
+		/// <summary>
+		/// 作業用（毎フレーム確保しないように持っておく）
+		/// </summary>
+		std::vector<uint32_t> mOrder;
+	};
+}
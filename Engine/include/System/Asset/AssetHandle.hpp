@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstdint>
+#include<memory>
+#include<span>
+#include<string_view>
+#include<typeindex>
+#include<vector>
+
+namespace Ecse::System
+{
+	class AssetManager;
+
+	/// <summary>
+	/// 素材の状態
+	/// </summary>
+	enum class EAssetState : uint8_t
+	{
+		//	ハンドルが無効（解放済み）
+		Invalid,
+		//	読み込み中（依存の完了待ちも含む）
+		Loading,
+		//	自分と依存の全てが読めた
+		Ready,
+		//	自分か依存のどれかが読めなかった
+		Failed,
+	};
+
+	/// <summary>
+	/// 型付きの素材のハンドル（下位16ビットがスロット番号、上位16ビットが世代。0 は無効）
+	/// 参照カウントは自動では増減しないので、持つ側が AssetManager::AddRef と Unload で管理する。
+	/// </summary>
+	template<typename T>
+	struct AssetHandle
+	{
+		uint32_t Value = 0;
+
+		bool IsValid() const
+		{
+			return Value != 0;
+		}
+
+		bool operator==(const AssetHandle&) const = default;
+	};
+
+	/// <summary>
+	/// 読み込んだ素材の基底（AssetManager が持ち、参照が無くなったら破棄する）
+	/// </summary>
+	class IAsset
+	{
+	public:
+		virtual ~IAsset() = default;
+	};
+
+	/// <summary>
+	/// 読み込み1回分の情報（IAssetLoader::Load に渡す）
+	/// </summary>
+	class ENGINE_API AssetLoadContext
+	{
+		friend class AssetManager;
+
+	public:
+		/// <summary>
+		/// 素材のパス（区切りは '/'）
+		/// </summary>
+		std::string_view GetPath() const;
+
+		/// <summary>
+		/// ファイルの中身
+		/// </summary>
+		std::span<const uint8_t> GetBytes() const;
+
+		/// <summary>
+		/// 依存する素材を読み込む（すぐに返る）
+		/// 依存の読み込みは並列に進み、全てが Ready になってから自分も Ready になる。
+		/// 依存への参照は AssetManager が持ち、自分が解放される時に一緒に手放す。
+		/// </summary>
+		/// <param name="Path">依存する素材のパス</param>
+		template<typename T>
+		AssetHandle<T> AddDependency(std::string_view Path)
+		{
+			return { AddDependency(std::type_index(typeid(T)), Path) };
+		}
+
+	private:
+		AssetLoadContext(AssetManager* pManager, std::string_view Path, std::span<const uint8_t> Bytes);
+
+		/// <summary>
+		/// 型を消した AddDependency
+		/// </summary>
+		uint32_t AddDependency(std::type_index Type, std::string_view Path);
+
+	private:
+		/// <summary>
+		/// 読み込みを頼む先
+		/// </summary>
+		AssetManager* mpManager;
+		/// <summary>
+		/// 素材のパス
+		/// </summary>
+		std::string_view mPath;
+		/// <summary>
+		/// ファイルの中身
+		/// </summary>
+		std::span<const uint8_t> mBytes;
+		/// <summary>
+		/// 追加した依存（参照を1つずつ持つ）
+		/// </summary>
+		std::vector<uint32_t> mDependencies;
+	};
+
+	/// <summary>
+	/// 型ごとの読み方
+	/// </summary>
+	class IAssetLoader
+	{
+	public:
+		virtual ~IAssetLoader() = default;
+
+		/// <summary>
+		/// ファイルの中身から素材を作る（ワーカースレッドで呼ぶので、複数の読み込みが同時に呼ぶ）
+		/// </summary>
+		/// <returns>作った素材（失敗なら nullptr）</returns>
+		virtual std::unique_ptr<IAsset> Load(AssetLoadContext& Context) = 0;
+	};
+}
@@ -0,0 +1,169 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/IO/FileWatcher.hpp>
+#include<System/IO/DerivedDataCache.hpp>
+
+#include<chrono>
+#include<condition_variable>
+#include<cstdint>
+#include<filesystem>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 直近までの読み直しの数
+	/// </summary>
+	struct AssetHotReloadStats
+	{
+		//	落ち着いたファイルの変化
+		uint32_t Changes = 0;
+		//	焼き直した・焼き直せなかった
+		uint32_t Cooked = 0;
+		uint32_t CookFailed = 0;
+		//	差し替えた・差し替えられなかった
+		uint32_t Reloaded = 0;
+		uint32_t ReloadFailed = 0;
+		//	最後の差し替えの、ファイルの最後の変化からの時間（ミリ秒。まとめる時間と焼く時間を含む）
+		double LastReloadMs = 0.0;
+	};
+
+	/// <summary>
+	/// 素材のファイルを見張り、変わったものだけを焼き直して AssetManager で差し替える（開発用）
+	/// 元のフォルダ（.tga .obj など）の変化は、拡張子で決まる焼き方で焼いたフォルダへ書き出す。焼いたフォルダの変化は
+	/// 読み込み済みの素材だけを AssetManager::Reload で読み直し、フレームの区切り（AssetManager::Update）でハンドルの中身を差し替える。
+	/// 差し替えた素材に依存する素材は AssetManager が続けて読み直す。
+	/// 焼くのは JobSystem で行い、テクスチャは派生データのキャッシュを使うので、中身が同じなら焼かない。
+	/// 元のフォルダと焼いたフォルダは同じでもよい。
+	/// </summary>
+	class ENGINE_API AssetHotReloader : public ServiceProvider<AssetHotReloader>
+	{
+		ECSE_SERVICE_ACCESS(AssetHotReloader);
+
+	public:
+		/// <summary>
+		/// 焼き方（ワーカースレッドで呼ぶ）
+		/// </summary>
+		using CookFunction = std::function<bool(const std::filesystem::path& Input, const std::filesystem::path& Output)>;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// 見張り始め、テクスチャとメッシュの焼き方を登録する
+		/// </summary>
+		/// <param name="CookedRoot">焼いたフォルダ（AssetManager の Root と同じ）</param>
+		/// <param name="SourceRoot">元のフォルダ（空なら焼かずに CookedRoot だけを見張る）</param>
+		/// <param name="CacheRoot">派生データのキャッシュの場所</param>
+		/// <param name="DebounceMs">同じファイルの変化をまとめる時間（ミリ秒）</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(const std::filesystem::path& CookedRoot, const std::filesystem::path& SourceRoot = {},
+			const std::filesystem::path& CacheRoot = "DerivedDataCache", uint32_t DebounceMs = FileWatcher::DEFAULT_DEBOUNCE_MS);
+
+		/// <summary>
+		/// 焼き方を登録する（同じ拡張子なら置き換える）
+		/// </summary>
+		/// <param name="SourceExtension">元の拡張子（".tga" のように小文字で）</param>
+		/// <param name="CookedExtension">焼いた後の拡張子</param>
+		/// <param name="Cook">焼き方</param>
+		void AddCookRule(std::string SourceExtension, std::string CookedExtension, CookFunction Cook);
+
+		/// <summary>
+		/// 変化を取り出して焼き直しと読み直しを始める（ゲームスレッドでフレームに1回、AssetManager::Update の前に）
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// 焼いている途中のものが全て終わるまで待つ
+		/// </summary>
+		void WaitIdle();
+
+		/// <summary>
+		/// 直近までの読み直しの数
+		/// </summary>
+		AssetHotReloadStats GetStats() const;
+
+	private:
+		/// <summary>
+		/// 焼き方
+		/// </summary>
+		struct CookRule
+		{
+			//	焼いた後の拡張子
+			std::string CookedExtension;
+			//	焼き方
+			CookFunction Cook;
+		};
+
+		/// <summary>
+		/// 元のファイルを焼き直す（ワーカーへ送る）
+		/// </summary>
+		/// <param name="Path">元のフォルダからの相対パス</param>
+		void StartCook(const std::string& Path);
+
+		/// <summary>
+		/// 焼いたファイルを読み直す
+		/// </summary>
+		/// <param name="Path">焼いたフォルダからの相対パス</param>
+		/// <param name="ChangedAt">ファイルが最後に変化した時刻</param>
+		void StartReload(const std::string& Path, std::chrono::steady_clock::time_point ChangedAt);
+
+	private:
+		/// <summary>
+		/// 焼いたフォルダの見張り
+		/// </summary>
+		FileWatcher mCookedWatcher;
+		/// <summary>
+		/// 元のフォルダの見張り（焼いたフォルダと同じなら使わない）
+		/// </summary>
+		FileWatcher mSourceWatcher;
+		/// <summary>
+		/// 焼いたフォルダ
+		/// </summary>
+		std::filesystem::path mCookedRoot;
+		/// <summary>
+		/// 元のフォルダ（空なら焼かない）
+		/// </summary>
+		std::filesystem::path mSourceRoot;
+		/// <summary>
+		/// 派生データのキャッシュ
+		/// </summary>
+		std::unique_ptr<DerivedDataCache> mpCache;
+		/// <summary>
+		/// 拡張子ごとの焼き方
+		/// </summary>
+		std::unordered_map<std::string, CookRule> mRules;
+		/// <summary>
+		/// 以下を守る
+		/// </summary>
+		mutable std::mutex mMutex;
+		/// <summary>
+		/// 焼き終わった通知（WaitIdle 用）
+		/// </summary>
+		std::condition_variable mCondition;
+		/// <summary>
+		/// 焼いている途中のもの（true なら焼いている間にまた変わったので、終わったら焼き直す）
+		/// </summary>
+		std::unordered_map<std::string, bool> mCooking;
+		/// <summary>
+		/// 直近までの読み直しの数
+		/// </summary>
+		AssetHotReloadStats mStats;
+	};
+}
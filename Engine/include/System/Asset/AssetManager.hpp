@@ -0,0 +1,373 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/Asset/AssetHandle.hpp>
+#include<System/Thread/Task.hpp>
+
+#include<condition_variable>
+#include<cstdint>
+#include<filesystem>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<string_view>
+#include<typeindex>
+#include<unordered_map>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 今の状態ごとの数
+	/// </summary>
+	struct AssetManagerStats
+	{
+		uint32_t Loading = 0;
+		uint32_t Ready = 0;
+		uint32_t Failed = 0;
+		//	読み込み済みの素材の合計（依存も含む）
+		uint32_t Total = 0;
+	};
+
+	/// <summary>
+	/// 読み込んだ素材を一か所で持つ
+	/// 同じパス（PackArchive::NormalizePath で正規化した文字列のハッシュ）は1回だけ読み、2回目からは参照カウントを増やして
+	/// 同じハンドルを返す。参照カウントが 0 になったら破棄し、依存への参照も手放す。
+	/// ファイルは AsyncFileIO があればそれで、無ければワーカーで読み、型ごとの IAssetLoader でワーカーで素材にする。
+	/// 素材が依存を追加すると（マテリアル → テクスチャなど）依存の読み込みも並列に進み、全てが揃った時に Ready になる。
+	/// 循環した依存は Failed にする。
+	/// Reload は新しい版を裏で読み、揃ったら次の Update で同じスロットの中身だけを差し替える（ハンドルはそのまま使える）。
+	/// 差し替えた素材に依存する素材も続けて読み直す。
+	/// GPU に触らないので、ウィンドウも DX12 も無いテストからそのまま使える。
+	/// </summary>
+	class ENGINE_API AssetManager : public ServiceProvider<AssetManager>
+	{
+		ECSE_SERVICE_ACCESS(AssetManager);
+		friend class AssetLoadContext;
+
+	public:
+		/// <summary>
+		/// ファイルを読む関数（パックやテスト用のメモリ上のファイルから読む時に差し替える。ワーカーで呼ぶ）
+		/// </summary>
+		using Reader = std::function<bool(std::string_view Path, std::vector<uint8_t>& OutBytes)>;
+
+		/// <summary>
+		/// 同時に持てる素材の最大数
+		/// </summary>
+		static constexpr uint32_t MAX_ASSETS = 65535;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// 素材の置き場所を決める
+		/// </summary>
+		/// <param name="Root">パスの基準になるフォルダ</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(const std::filesystem::path& Root = {});
+
+		/// <summary>
+		/// 型ごとの読み方を登録する（読み込みを始める前に）
+		/// </summary>
+		template<typename T>
+		void RegisterLoader(std::unique_ptr<IAssetLoader> Loader)
+		{
+			static_assert(std::is_base_of_v<IAsset, T>, "T must derive from IAsset.");
+			RegisterLoader(std::type_index(typeid(T)), std::move(Loader));
+		}
+
+		/// <summary>
+		/// ファイルを読む関数を差し替える（nullptr で既定に戻す）
+		/// </summary>
+		void SetReader(Reader Read);
+
+		/// <summary>
+		/// 読み込みを始める（すぐに返る）。読み込み済みか読み込み中なら参照カウントを増やして同じハンドルを返す
+		/// </summary>
+		/// <param name="Path">パス（Root からの相対パス）</param>
+		/// <param name="OnLoaded">Ready か Failed になった後の Update で呼ばれる（省略可）</param>
+		/// <returns>ハンドル（型が違う・空きが無い時は無効）</returns>
+		template<typename T>
+		AssetHandle<T> Load(std::string_view Path, std::function<void(AssetHandle<T>, bool Succeeded)> OnLoaded = nullptr)
+		{
+			static_assert(std::is_base_of_v<IAsset, T>, "T must derive from IAsset.");
+			std::function<void(uint32_t, bool)> callback;
+			if (OnLoaded)
+			{
+				callback = [OnLoaded = std::move(OnLoaded)](uint32_t Handle, bool Succeeded) { OnLoaded({ Handle }, Succeeded); };
+			}
+			return { Load(std::type_index(typeid(T)), Path, std::move(callback)) };
+		}
+
+		/// <summary>
+		/// Task の中で co_await して読み込む（Ready か Failed になった後の Update で続く）
+		/// 参照カウントは Load と同じく 1 増える。Ready かどうかは GetState で確かめる。
+		/// </summary>
+		/// <param name="Path">パス（Root からの相対パス）</param>
+		/// <returns>ハンドルを返す待ち（型が違う・空きが無い時は無効なハンドルですぐに続く）</returns>
+		template<typename T>
+		CallbackAwaiter<AssetHandle<T>> LoadAsync(std::string_view Path)
+		{
+			return CallbackAwaiter<AssetHandle<T>>([this, Path = std::string(Path)](typename CallbackAwaiter<AssetHandle<T>>::ResumeFunction Resume)
+				{
+					const AssetHandle<T> handle = this->Load<T>(Path, [Resume](AssetHandle<T> Handle, bool) { Resume(Handle); });
+					//	無効な時はコールバックが呼ばれない
+					if (handle.IsValid() == false) Resume(handle);
+				});
+		}
+
+		/// <summary>
+		/// 読み込み済みの素材を読み直す（すぐに返る）
+		/// 新しい版と依存が揃ったら Update で差し替え、古い版を破棄する。失敗したら古い版を残す。
+		/// 差し替えの後、この素材に依存する素材も読み直す。
+		/// </summary>
+		/// <param name="Path">パス（Load と同じ規則で比べる）</param>
+		/// <param name="OnReloaded">差し替えた（true）か、失敗した（false）Update で呼ばれる（省略可）</param>
+		/// <returns>true:読み込み済み（読み直しを始めた）</returns>
+		bool Reload(std::string_view Path, std::function<void(bool Succeeded)> OnReloaded = nullptr);
+
+		/// <summary>
+		/// 参照カウントを増やす
+		/// </summary>
+		template<typename T>
+		void AddRef(AssetHandle<T> Handle)
+		{
+			AddRef(Handle.Value);
+		}
+
+		/// <summary>
+		/// 参照カウントを減らす（0 になったら破棄する。読み込み中なら終わってから）
+		/// </summary>
+		template<typename T>
+		void Unload(AssetHandle<T> Handle)
+		{
+			Unload(Handle.Value);
+		}
+
+		/// <summary>
+		/// 素材（Ready でなければ nullptr。Reload で差し替わるので、フレームをまたいで持たない）
+		/// </summary>
+		template<typename T>
+		const T* Get(AssetHandle<T> Handle) const
+		{
+			return static_cast<const T*>(Get(Handle.Value, std::type_index(typeid(T))));
+		}
+
+		/// <summary>
+		/// 状態
+		/// </summary>
+		template<typename T>
+		EAssetState GetState(AssetHandle<T> Handle) const
+		{
+			return GetState(Handle.Value);
+		}
+
+		/// <summary>
+		/// 参照カウント（無効なハンドルは 0）
+		/// </summary>
+		template<typename T>
+		uint32_t GetRefCount(AssetHandle<T> Handle) const
+		{
+			return GetRefCount(Handle.Value);
+		}
+
+		/// <summary>
+		/// Loading でなくなるまで待つ
+		/// </summary>
+		template<typename T>
+		EAssetState Wait(AssetHandle<T> Handle)
+		{
+			return Wait(Handle.Value);
+		}
+
+		/// <summary>
+		/// 全ての読み込みが終わるまで待つ
+		/// </summary>
+		void WaitIdle();
+
+		/// <summary>
+		/// 読み直した素材を差し替え、完了した読み込みのコールバックを呼ぶ（ゲームスレッドでフレームに1回）
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// 今の状態ごとの数
+		/// </summary>
+		AssetManagerStats GetStats() const;
+
+	private:
+		/// <summary>
+		/// 素材1つの管理情報
+		/// </summary>
+		struct Slot
+		{
+			//	素材（読み込みが終わってから持つ）
+			std::unique_ptr<IAsset> Asset;
+			//	正規化したパスとそのハッシュ
+			std::string Path;
+			uint64_t PathHash = 0;
+			//	読む時のパス（区切りだけ '/' にし、大文字小文字はそのまま）
+			std::string FilePath;
+			//	依存（参照を1つずつ持つ）
+			std::vector<uint32_t> Dependencies;
+			//	自分の完了を待っている素材
+			std::vector<uint32_t> Dependents;
+			//	完了時のコールバック
+			std::vector<std::function<void(uint32_t, bool)>> Callbacks;
+			//	読み直しの版なら差し替える先、そうでなければ 0
+			uint32_t ReloadTarget = 0;
+			//	差し替えを待っている一番新しい読み直しの版（古い版が後から揃っても使わない）
+			uint32_t ReloadSlot = 0;
+			//	参照カウント
+			uint32_t RefCount = 0;
+			//	完了を待っている依存の数
+			uint32_t PendingDependencies = 0;
+			//	型（mLoaders の番号）
+			uint16_t Type = 0;
+			//	何回使い回されたか
+			uint16_t Generation = 1;
+			//	状態
+			EAssetState State = EAssetState::Invalid;
+			//	自分の読み込みが終わった
+			bool IsDecoded = false;
+			//	自分か依存のどれかが失敗した
+			bool HasFailed = false;
+		};
+
+		/// <summary>
+		/// 完了の通知（Update で呼ぶ）
+		/// </summary>
+		struct Notification
+		{
+			std::function<void(uint32_t, bool)> Callback;
+			uint32_t Handle = 0;
+			bool Succeeded = false;
+		};
+
+		void RegisterLoader(std::type_index Type, std::unique_ptr<IAssetLoader> Loader);
+		uint32_t Load(std::type_index Type, std::string_view Path, std::function<void(uint32_t, bool)> OnLoaded);
+		void AddRef(uint32_t Handle);
+		void Unload(uint32_t Handle);
+		const IAsset* Get(uint32_t Handle, std::type_index Type) const;
+		EAssetState GetState(uint32_t Handle) const;
+		uint32_t GetRefCount(uint32_t Handle) const;
+		EAssetState Wait(uint32_t Handle);
+
+		/// <summary>
+		/// ハンドルの指すスロット（無効なら nullptr。mMutex を持って呼ぶ）
+		/// </summary>
+		Slot* FindSlot(uint32_t Handle);
+		const Slot* FindSlot(uint32_t Handle) const;
+
+		/// <summary>
+		/// ファイルを読んで素材にする（ワーカーへ送る）
+		/// </summary>
+		void StartLoad(uint32_t Handle, uint16_t Type, const std::string& Path);
+
+		/// <summary>
+		/// 読んだ中身から素材を作り、完了を反映する（ワーカー）
+		/// </summary>
+		void Decode(uint32_t Handle, uint16_t Type, const std::string& Path, const std::vector<uint8_t>* pBytes);
+
+		/// <summary>
+		/// 空いているスロットを取って読み込み中にする（空きが無ければ UINT32_MAX。mMutex を持って呼ぶ）
+		/// </summary>
+		uint32_t AllocateSlot(const std::string& Path, uint64_t PathHash, std::string_view FilePath, uint16_t Type);
+
+		/// <summary>
+		/// 揃った読み直しの版を差し替える（mMutex を持って呼ぶ）
+		/// </summary>
+		/// <param name="OutDependents">差し替えた素材に依存する素材の読む時のパス</param>
+		void ApplyReloads(std::vector<std::string>& OutDependents);
+
+		/// <summary>
+		/// 読み込みが終わり、依存も揃っていれば Ready か Failed にして、待っている素材へ伝える（mMutex を持って呼ぶ）
+		/// </summary>
+		void Resolve(uint32_t Handle);
+
+		/// <summary>
+		/// From の依存をたどって To に着くか（循環の検出。mMutex を持って呼ぶ）
+		/// </summary>
+		bool DependsOn(uint32_t From, uint32_t To) const;
+
+		/// <summary>
+		/// 参照カウントを減らし、0 なら破棄する（mMutex を持って呼ぶ）
+		/// </summary>
+		void UnloadLocked(uint32_t Handle);
+
+		/// <summary>
+		/// 素材を破棄してスロットを空け、依存への参照を手放す（mMutex を持って呼ぶ）
+		/// </summary>
+		void Destroy(uint32_t Handle);
+
+		/// <summary>
+		/// ワーカーで処理する（JobSystem が無ければその場で）
+		/// </summary>
+		void Dispatch(std::function<void()> Task);
+
+	private:
+		/// <summary>
+		/// パスの基準
+		/// </summary>
+		std::filesystem::path mRoot;
+		/// <summary>
+		/// 型ごとの読み方
+		/// </summary>
+		std::vector<std::pair<std::type_index, std::unique_ptr<IAssetLoader>>> mLoaders;
+		/// <summary>
+		/// ファイルを読む関数（空なら既定）
+		/// </summary>
+		Reader mReader;
+		/// <summary>
+		/// 以下の全てを守る
+		/// </summary>
+		mutable std::mutex mMutex;
+		/// <summary>
+		/// 状態が変わった通知（Wait と WaitIdle 用）
+		/// </summary>
+		std::condition_variable mCondition;
+		/// <summary>
+		/// 素材（増えるだけで、解放したスロットは使い回す）
+		/// </summary>
+		std::vector<Slot> mSlots;
+		/// <summary>
+		/// 空いているスロット
+		/// </summary>
+		std::vector<uint32_t> mFreeSlots;
+		/// <summary>
+		/// パスのハッシュからスロット
+		/// </summary>
+		std::unordered_map<uint64_t, uint32_t> mPathToSlot;
+		/// <summary>
+		/// Update で呼ぶ通知
+		/// </summary>
+		std::vector<Notification> mNotifications;
+		/// <summary>
+		/// 揃って差し替えを待っている読み直しの版
+		/// </summary>
+		std::vector<uint32_t> mReadyReloads;
+		/// <summary>
+		/// 読み込み中だったので次の Update でやり直す読み直し
+		/// </summary>
+		std::vector<std::pair<std::string, std::function<void(bool)>>> mDeferredReloads;
+		/// <summary>
+		/// Loading の数
+		/// </summary>
+		uint32_t mLoadingCount;
+		/// <summary>
+		/// 動いているワーカーの処理の数
+		/// </summary>
+		uint32_t mActiveJobs;
+	};
+}
@@ -2,27 +2,53 @@
 
 #include<Utility/Export/Export.hpp>
 #include<System/Service/ServiceProvider.hpp>
+#include<System/Thread/RenderThread.hpp>
+
+#include<array>
 
 namespace Ecse::Graphics
 {
 	class DX12;
+	class RenderWorld;
+	class TextureLoader;
+	class TextureStreamer;
 }
 
 namespace Ecse::Debug
 {
 	class ImGuiManager;
+	class Profiler;
 }
 
 namespace Ecse::ECS
 {
 	class EntityManager;
+	class SystemScheduler;
 }
 
 namespace Ecse::System
 {
 	class Window;
+	class AssetManager;
+	class AssetHotReloader;
+	class TaskScheduler;
 	struct EngineContext;
 
+	/// <summary>
+	/// 1フレームの時間の内訳（ミリ秒）
+	/// </summary>
+	struct FrameStats
+	{
+		//	Run 1回分の時間
+		double FrameMs;
+		//	ゲームスレッドでの更新時間
+		double GameMs;
+		//	コマンドの記録と送信の時間（描画スレッド使用時は描画スレッド側）
+		double RenderMs;
+		//	ゲームスレッドが描画スレッドを待った時間
+		double WaitMs;
+	};
+
 	/// <summary>
 	/// エンジン全体の管理クラス
 	/// </summary>
@@ -52,7 +78,32 @@ namespace Ecse::System
 		/// </summary>
 		void Shutdown();
 
+		/// <summary>
+		/// 直近のフレームの計測結果
+		/// </summary>
+		const FrameStats& GetFrameStats() const;
+
 	private:
+		/// <summary>
+		/// 1スレッドで更新と描画を順番に行う
+		/// </summary>
+		void RunSerial();
+
+		/// <summary>
+		/// 更新はこのスレッド、記録と送信は描画スレッドで行う
+		/// </summary>
+		void RunPipelined();
+
+		/// <summary>
+		/// 直列とパイプラインで共通の更新（素材、コルーチン、システム、テクスチャ）
+		/// </summary>
+		void UpdateStages();
+
+		/// <summary>
+		/// スナップショット1つ分の記録と送信（描画スレッド）
+		/// </summary>
+		void RenderSnapshot(uint32_t Slot);
+
 		/// <summary>
 		/// フレームの開始処理
 		/// </summary>
@@ -63,6 +114,33 @@ namespace Ecse::System
 		/// </summary>
 		void EndFrame();
 
+		/// <summary>
+		/// コマンドの記録開始
+		/// </summary>
+		void BeginRecording(int Width, int Height);
+
+		/// <summary>
+		/// コマンドの送信と画面のフリップ
+		/// </summary>
+		void EndRecording();
+
+	private:
+		/// <summary>
+		/// フレームの時間の内訳を足し込み、間隔ごとに平均をログに出す
+		/// </summary>
+		void AccumulateFrameStats();
+
+	private:
+		/// <summary>
+		/// 描画スレッドに渡すフレームの情報
+		/// </summary>
+		struct FrameSnapshot
+		{
+			//	描画サイズ
+			int Width;
+			int Height;
+		};
+
 	private:
 		/// <summary>
 		/// ウィンドウ
@@ -77,10 +155,70 @@ namespace Ecse::System
 		/// </summary>
 		Debug::ImGuiManager* mpImGui;
 		/// <summary>
+		/// CPU・GPUの区間計測
+		/// </summary>
+		Debug::Profiler* mpProfiler;
+		/// <summary>
 		/// ECSの管理
 		/// </summary>
 		ECS::EntityManager* mpEntityManager;
 		/// <summary>
+		/// ECS のシステムの並列実行
+		/// </summary>
+		ECS::SystemScheduler* mpSystemScheduler;
+		/// <summary>
+		/// 描画用の状態の抜き出し
+		/// </summary>
+		Graphics::RenderWorld* mpRenderWorld;
+		/// <summary>
+		/// テクスチャの非同期読み込み
+		/// </summary>
+		Graphics::TextureLoader* mpTextureLoader;
+		/// <summary>
+		/// ミップ単位のテクスチャのストリーミング
+		/// </summary>
+		Graphics::TextureStreamer* mpTextureStreamer;
+		/// <summary>
+		/// 素材の読み込みと参照カウント
+		/// </summary>
+		AssetManager* mpAssetManager;
+		/// <summary>
+		/// 素材の読み直し（開発用。使わない時は nullptr）
+		/// </summary>
+		AssetHotReloader* mpAssetHotReloader;
+		/// <summary>
+		/// コルーチンの待ち
+		/// </summary>
+		TaskScheduler* mpTaskScheduler;
+		/// <summary>
+		/// 描画スレッド（UseRenderThread の時だけ起動）
+		/// </summary>
+		RenderThread mRenderThread;
+		/// <summary>
+		/// ゲームスレッドと描画スレッドで受け渡すスナップショット
+		/// </summary>
+		std::array<FrameSnapshot, FRAME_SNAPSHOT_COUNT> mSnapshots;
+		/// <summary>
+		/// 次にゲームスレッドが書き込むスナップショット
+		/// </summary>
+		uint32_t mWriteSlot;
+		/// <summary>
+		/// 直近のフレームの計測結果
+		/// </summary>
+		FrameStats mFrameStats;
+		/// <summary>
+		/// ログに出すまでのフレームの時間の合計
+		/// </summary>
+		FrameStats mFrameStatsSum;
+		/// <summary>
+		/// mFrameStatsSum に足したフレーム数
+		/// </summary>
+		uint32_t mFrameStatsCount;
+		/// <summary>
+		/// 平均をログに出す間隔（フレーム数。0:出さない）
+		/// </summary>
+		uint32_t mFrameStatsLogInterval;
+		/// <summary>
 		/// 初期化を複数回通さないためのフラグ
 		/// </summary>
 		bool mIsInitialized;
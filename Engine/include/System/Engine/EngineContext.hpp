@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include<System/Window/WindowSetting.hpp>
+#include<cstdint>
+#include<filesystem>
 
 namespace Ecse::System
 {
@@ -11,6 +13,30 @@ namespace Ecse::System
 		//	ウィンドウの初期化設定
 		WindowSetting WinSetting;
 
+		//	描画スレッドを使うかどうか true:更新と描画を1フレームずらして並列に行う
+		bool UseRenderThread = false;
+
+		//	ワーカースレッドの数 0:論理コア数-1
+		uint32_t WorkerCount = 0;
+
+		//	JobSystem の仕事をファイバーで動かすか true:仕事の中の Wait でワーカーを止めずに他の仕事へ移る
+		bool UseJobFibers = false;
+
+		//	ECS のシステムを並列に動かすか false:登録順に1つずつ動かす（比べる時やデバッグ用）
+		bool UseParallelSystems = true;
+
+		//	テクスチャのストリーミングの予算（バイト）
+		uint64_t TextureBudget = 512ull * 1024 * 1024;
+
+		//	焼いた素材のフォルダ（AssetManager のパスの基準。空なら作業フォルダ）
+		std::filesystem::path AssetRoot;
+
+		//	焼く前の素材のフォルダ（開発用の読み直しで、変わったものを AssetRoot へ焼き直す。空なら焼かない）
+		std::filesystem::path AssetSourceRoot;
+
+		//	フレームの時間の内訳の平均をログに出す間隔（フレーム数） 0:出さない
+		uint32_t FrameStatsLogInterval = 0;
+
 		/*
 		* エンジンの初期化で追加する場合はここで追加。
 		*/
@@ -10,9 +10,15 @@
     #define ECSE_DEV_TOOL_ENABLED  (1)
     #define ECSE_ENABLE_ASSERT     (1)
     #define ECSE_DEBUG_DRAW_COLLISION (ECSE_DEV_TOOL_ENABLED)
+    #define ECSE_PROFILER_ENABLED  (1)
+    // 素材のファイルを見張って読み直す
+    #define ECSE_ASSET_HOT_RELOAD_ENABLED (ECSE_DEV_TOOL_ENABLED)
 #else
     // リリースビルドでも開発ツールを使いたい場合はここを (1) にする
     #define ECSE_DEV_TOOL_ENABLED  (0)
     #define ECSE_ENABLE_ASSERT     (0)
     #define ECSE_DEBUG_DRAW_COLLISION (0)
+    // リリースでも計測したい場合はここを (1) にする
+    #define ECSE_PROFILER_ENABLED  (0)
+    #define ECSE_ASSET_HOT_RELOAD_ENABLED (ECSE_DEV_TOOL_ENABLED)
 #endif
\ No newline at end of file
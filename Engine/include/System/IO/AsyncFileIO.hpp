@@ -0,0 +1,428 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+
+#include<atomic>
+#include<chrono>
+#include<condition_variable>
+#include<cstdint>
+#include<deque>
+#include<filesystem>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<span>
+#include<thread>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 開いたファイルのハンドル（下位16ビットがスロット番号、上位16ビットが世代。0 は無効）
+	/// </summary>
+	using AsyncFileHandle = uint32_t;
+
+	/// <summary>
+	/// 読み込み要求のハンドル（下位16ビットがスロット番号、上位16ビットが世代。0 は無効）
+	/// </summary>
+	using AsyncReadHandle = uint32_t;
+
+	/// <summary>
+	/// 無効なハンドル
+	/// </summary>
+	inline constexpr AsyncFileHandle INVALID_ASYNC_FILE_HANDLE = 0;
+	inline constexpr AsyncReadHandle INVALID_ASYNC_READ_HANDLE = 0;
+
+	/// <summary>
+	/// 読み込みを OS に渡す仕組み
+	/// </summary>
+	enum class EAsyncIOBackend : uint8_t
+	{
+		//	io_uring（Linux）か IOCP（Windows）、使えなければ Threads
+		Auto,
+		//	io_uring（Linux 5.6 以降）
+		IoUring,
+		//	I/O 完了ポート（Windows）
+		Iocp,
+		//	専用のスレッドで同期読み込み（どこでも動く）
+		Threads,
+	};
+
+	/// <summary>
+	/// 読み込みの優先度（高いものから OS に渡す。同じ優先度は来た順）
+	/// </summary>
+	enum class EAsyncIOPriority : uint8_t
+	{
+		//	今のフレームで待っているもの
+		Critical,
+		//	画面に出ている物
+		High,
+		//	普通の読み込み
+		Normal,
+		//	先読みなど、後回しで良いもの
+		Low,
+	};
+	inline constexpr uint32_t ASYNC_IO_PRIORITY_COUNT = 4;
+
+	/// <summary>
+	/// 読み込み要求の状態
+	/// </summary>
+	enum class EAsyncReadState : uint8_t
+	{
+		//	終わって片付けた（またはハンドルが無効）
+		Invalid,
+		//	OS に渡す順番待ち
+		Pending,
+		//	OS で読み込み中
+		InFlight,
+	};
+
+	/// <summary>
+	/// 読み込みの結果
+	/// </summary>
+	enum class EAsyncReadResult : uint8_t
+	{
+		//	読めた（ファイルの終わりに当たれば BytesRead は要求より短い）
+		Succeeded,
+		//	読めなかった
+		Failed,
+		//	Cancel された
+		Cancelled,
+	};
+
+	/// <summary>
+	/// 完了時にコールバックへ渡すもの
+	/// </summary>
+	struct AsyncReadCompletion
+	{
+		//	要求のハンドル
+		AsyncReadHandle Handle = INVALID_ASYNC_READ_HANDLE;
+		//	結果
+		EAsyncReadResult Result = EAsyncReadResult::Failed;
+		//	読めた大きさ（バイト）
+		uint64_t BytesRead = 0;
+		//	Read を呼んでから完了するまでの時間（ミリ秒。順番待ちも含む）
+		double LatencyMs = 0.0;
+	};
+
+	/// <summary>
+	/// 読み込み要求
+	/// </summary>
+	struct AsyncReadRequest
+	{
+		//	読むファイル
+		AsyncFileHandle File = INVALID_ASYNC_FILE_HANDLE;
+		//	ファイル先頭からの位置
+		uint64_t Offset = 0;
+		//	書き込み先（呼んだ側が持ち、完了するまで触らない・解放しない）
+		std::span<uint8_t> Buffer;
+		//	優先度
+		EAsyncIOPriority Priority = EAsyncIOPriority::Normal;
+		//	完了時に呼ばれる（I/O スレッドで呼ぶので重い処理は JobSystem へ回す。省略可）
+		std::function<void(const AsyncReadCompletion&)> OnComplete;
+	};
+
+	/// <summary>
+	/// 今までの合計
+	/// </summary>
+	struct AsyncFileIOStats
+	{
+		//	受け付けた要求の数
+		uint64_t Submitted = 0;
+		//	結果ごとの数
+		uint64_t Succeeded = 0;
+		uint64_t Failed = 0;
+		uint64_t Cancelled = 0;
+		//	読めた大きさの合計（バイト）
+		uint64_t BytesRead = 0;
+		//	今の順番待ちと読み込み中の数
+		uint32_t Pending = 0;
+		uint32_t InFlight = 0;
+	};
+
+	/// <summary>
+	/// OS の非同期読み込みの違いを隠すもの（AsyncFileIO の中だけで使う）
+	/// 要求はスロット番号で区別し、完了は I/O スレッドの WaitCompletions で受け取る。
+	/// </summary>
+	class IAsyncIOBackend
+	{
+	public:
+		/// <summary>
+		/// 完了1つ分
+		/// </summary>
+		struct Completion
+		{
+			//	要求のスロット番号
+			uint32_t Slot = 0;
+			//	読めた大きさ（負なら RESULT_FAILED か RESULT_CANCELLED）
+			int64_t Result = 0;
+		};
+		static constexpr int64_t RESULT_FAILED = -1;
+		static constexpr int64_t RESULT_CANCELLED = -2;
+
+		virtual ~IAsyncIOBackend() = default;
+
+		/// <summary>
+		/// 開いたファイルを登録する（IOCP は完了ポートに結び付ける）
+		/// </summary>
+		virtual bool Attach(intptr_t Native) = 0;
+
+		/// <summary>
+		/// 読み込みを渡す（すぐに返る）
+		/// </summary>
+		virtual bool Submit(uint32_t Slot, intptr_t Native, uint64_t Offset, uint8_t* pBuffer, uint32_t Size) = 0;
+
+		/// <summary>
+		/// 渡した読み込みを取り消す（間に合わなければ普通に完了する）
+		/// </summary>
+		virtual void Cancel(uint32_t Slot, intptr_t Native) = 0;
+
+		/// <summary>
+		/// 完了を1つ以上か Wake まで待って受け取る
+		/// </summary>
+		virtual void WaitCompletions(std::vector<Completion>& Out) = 0;
+
+		/// <summary>
+		/// WaitCompletions を起こす（どのスレッドからでも）
+		/// </summary>
+		virtual void Wake() = 0;
+	};
+
+	/// <summary>
+	/// ファイルの非同期読み込み
+	/// 呼んだ側が用意したバッファに読む要求を優先度ごとの列に積み、I/O スレッドが優先度の高いものから
+	/// 最大 QueueDepth 個まで OS に渡す。Linux は io_uring（使えなければ専用スレッドで pread）、
+	/// Windows は I/O 完了ポートで読み、完了したら I/O スレッドでコールバックを呼ぶ。
+	/// 要求は完了してコールバックを呼んだ時点で片付けるので、結果はコールバックで受け取る。
+	/// Read・Cancel・Wait はどのスレッドからでも呼べる。
+	/// </summary>
+	class ENGINE_API AsyncFileIO : public ServiceProvider<AsyncFileIO>
+	{
+		ECSE_SERVICE_ACCESS(AsyncFileIO);
+
+	public:
+		/// <summary>
+		/// 同時に受け付けられる要求の最大数（順番待ちも含む）
+		/// </summary>
+		static constexpr uint32_t MAX_REQUESTS = 16384;
+
+		/// <summary>
+		/// 同時に開けるファイルの最大数
+		/// </summary>
+		static constexpr uint32_t MAX_FILES = 4096;
+
+		/// <summary>
+		/// 既定の OS に同時に渡す数
+		/// </summary>
+		static constexpr uint32_t DEFAULT_QUEUE_DEPTH = 64;
+
+		/// <summary>
+		/// 1回で OS に渡す大きさの上限（大きな要求は I/O スレッドがこの大きさずつ渡し直す）
+		/// </summary>
+		static constexpr uint32_t MAX_READ_SIZE = 1u << 30;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// 仕組みを選んで I/O スレッドを起動する
+		/// </summary>
+		/// <param name="Backend">使う仕組み（使えなければ Threads にする）</param>
+		/// <param name="QueueDepth">OS に同時に渡す数</param>
+		/// <param name="ThreadCount">Threads の時の読み込みスレッドの数</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(EAsyncIOBackend Backend = EAsyncIOBackend::Auto, uint32_t QueueDepth = DEFAULT_QUEUE_DEPTH, uint32_t ThreadCount = 4);
+
+		/// <summary>
+		/// 読み込み用に開く
+		/// </summary>
+		/// <returns>ハンドル（開けなければ INVALID_ASYNC_FILE_HANDLE）</returns>
+		AsyncFileHandle OpenFile(const std::filesystem::path& Path);
+
+		/// <summary>
+		/// 閉じる（読み込み中の要求が無いこと）
+		/// </summary>
+		void CloseFile(AsyncFileHandle File);
+
+		/// <summary>
+		/// ファイルの大きさ（バイト）
+		/// </summary>
+		uint64_t GetFileSize(AsyncFileHandle File) const;
+
+		/// <summary>
+		/// 読み込みを要求する（すぐに返る）
+		/// </summary>
+		/// <returns>ハンドル（受け付けられなければ INVALID_ASYNC_READ_HANDLE）</returns>
+		AsyncReadHandle Read(AsyncReadRequest Request);
+
+		/// <summary>
+		/// まとめて要求する（ロックと I/O スレッドの起こし直しが1回で済む）
+		/// </summary>
+		/// <param name="Requests">要求</param>
+		/// <param name="OutHandles">それぞれのハンドル（Requests と同じ数。受け付けられなかったものは INVALID_ASYNC_READ_HANDLE）</param>
+		/// <returns>受け付けた数</returns>
+		uint32_t ReadBatch(std::span<AsyncReadRequest> Requests, std::span<AsyncReadHandle> OutHandles);
+
+		/// <summary>
+		/// 取り消す。順番待ちならすぐに、読み込み中なら OS が止められれば Cancelled で完了する
+		/// </summary>
+		/// <returns>true:まだ終わっていなかった</returns>
+		bool Cancel(AsyncReadHandle Handle);
+
+		/// <summary>
+		/// 状態
+		/// </summary>
+		EAsyncReadState GetState(AsyncReadHandle Handle) const;
+
+		/// <summary>
+		/// 完了する（コールバックを呼び終える）まで待つ（I/O スレッドのコールバックの中からは呼ばない）
+		/// </summary>
+		void Wait(AsyncReadHandle Handle);
+
+		/// <summary>
+		/// 全ての要求が完了するまで待つ
+		/// </summary>
+		void WaitIdle();
+
+		/// <summary>
+		/// 使っている仕組み
+		/// </summary>
+		EAsyncIOBackend GetBackend() const;
+
+		/// <summary>
+		/// 今までの合計
+		/// </summary>
+		AsyncFileIOStats GetStats() const;
+
+	private:
+		/// <summary>
+		/// 開いたファイル1つ
+		/// </summary>
+		struct FileSlot
+		{
+			//	OS のハンドル（Windows は HANDLE、それ以外は fd）
+			intptr_t Native = -1;
+			//	大きさ
+			uint64_t Size = 0;
+			//	何回使い回されたか
+			uint16_t Generation = 1;
+			//	開いているか
+			bool IsOpen = false;
+		};
+
+		/// <summary>
+		/// 要求1つ
+		/// </summary>
+		struct RequestSlot
+		{
+			//	要求の中身
+			intptr_t Native = -1;
+			uint64_t Offset = 0;
+			uint8_t* pBuffer = nullptr;
+			uint64_t Size = 0;
+			//	ここまで読めた大きさ（短く読めた時は残りを渡し直す）
+			uint64_t Done = 0;
+			std::function<void(const AsyncReadCompletion&)> OnComplete;
+			//	Read を呼んだ時刻
+			std::chrono::steady_clock::time_point QueuedAt;
+			//	何回使い回されたか
+			uint16_t Generation = 1;
+			//	状態
+			EAsyncReadState State = EAsyncReadState::Invalid;
+			//	取り消しを頼まれた
+			bool CancelRequested = false;
+		};
+
+		/// <summary>
+		/// 1つ受け付ける（mMutex を持って呼ぶ）
+		/// </summary>
+		AsyncReadHandle Enqueue(AsyncReadRequest& Request);
+
+		/// <summary>
+		/// I/O スレッド本体
+		/// </summary>
+		void IoThreadMain();
+
+		/// <summary>
+		/// I/O スレッドの停止とファイルを閉じる
+		/// </summary>
+		void Stop();
+
+	private:
+		/// <summary>
+		/// OS の非同期読み込み
+		/// </summary>
+		std::unique_ptr<IAsyncIOBackend> mpBackend;
+		/// <summary>
+		/// 使っている仕組み
+		/// </summary>
+		EAsyncIOBackend mBackendType;
+		/// <summary>
+		/// OS に同時に渡す数
+		/// </summary>
+		uint32_t mQueueDepth;
+		/// <summary>
+		/// 完了を待って OS に渡す I/O スレッド
+		/// </summary>
+		std::thread mIoThread;
+		/// <summary>
+		/// 以下の全てを守る
+		/// </summary>
+		mutable std::mutex mMutex;
+		/// <summary>
+		/// 要求の完了の通知（Wait と WaitIdle 用）
+		/// </summary>
+		std::condition_variable mCompletedCondition;
+		/// <summary>
+		/// 開いたファイル
+		/// </summary>
+		std::vector<FileSlot> mFiles;
+		/// <summary>
+		/// 空いているファイルのスロット
+		/// </summary>
+		std::vector<uint32_t> mFreeFiles;
+		/// <summary>
+		/// 要求（I/O スレッドが読み込み中に触るので大きさは変えない）
+		/// </summary>
+		std::vector<RequestSlot> mRequests;
+		/// <summary>
+		/// 空いている要求のスロット
+		/// </summary>
+		std::vector<uint32_t> mFreeRequests;
+		/// <summary>
+		/// 優先度ごとの順番待ち（スロット番号）
+		/// </summary>
+		std::deque<uint32_t> mPending[ASYNC_IO_PRIORITY_COUNT];
+		/// <summary>
+		/// 取り消しを頼まれたスロット（I/O スレッドが片付ける）
+		/// </summary>
+		std::vector<uint32_t> mCancelled;
+		/// <summary>
+		/// 順番待ちと読み込み中の数
+		/// </summary>
+		uint32_t mPendingCount;
+		uint32_t mInFlightCount;
+		/// <summary>
+		/// 今までの合計
+		/// </summary>
+		AsyncFileIOStats mStats;
+		/// <summary>
+		/// I/O スレッドを起こしてまだ起きていない（同じことを何度も OS に頼まないため）
+		/// </summary>
+		std::atomic<bool> mWakeRequested;
+		/// <summary>
+		/// 終了要求
+		/// </summary>
+		bool mIsExitRequested;
+	};
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstdint>
+#include<filesystem>
+#include<span>
+#include<string>
+#include<string_view>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 派生データのキー（元データと作り方の中身から求めた 128bit）
+	/// </summary>
+	struct DerivedDataKey
+	{
+		uint64_t High = 0;
+		uint64_t Low = 0;
+
+		/// <summary>
+		/// 32 文字の16進数
+		/// </summary>
+		std::string ToString() const;
+
+		bool operator==(const DerivedDataKey&) const = default;
+	};
+
+	/// <summary>
+	/// 元データから作ったもの（焼いたテクスチャなど）を、中身のハッシュをキーにしてディスクに置いておくキャッシュ
+	/// 元データか作り方が変わればキーが変わるので、古いものを消す必要はない。
+	/// 書き込みは一時ファイルに書いてから名前を変えるので、複数のプロセスやスレッドが同時に書いても壊れない。
+	/// 置き場所は Root/キーの先頭2文字/キー。
+	/// </summary>
+	class ENGINE_API DerivedDataCache
+	{
+	public:
+		/// <summary>
+		/// 置き場所を決める（フォルダは最初の書き込みで作る）
+		/// </summary>
+		explicit DerivedDataCache(const std::filesystem::path& Root);
+
+		/// <summary>
+		/// キーを求める
+		/// </summary>
+		/// <param name="Source">元データ</param>
+		/// <param name="Recipe">作り方（設定と作る側のバージョンを全て含めた文字列）</param>
+		static DerivedDataKey MakeKey(std::span<const uint8_t> Source, std::string_view Recipe);
+
+		/// <summary>
+		/// 置いてあるか
+		/// </summary>
+		bool Contains(const DerivedDataKey& Key) const;
+
+		/// <summary>
+		/// 読み込む（なければ false）
+		/// </summary>
+		bool Get(const DerivedDataKey& Key, std::vector<uint8_t>& OutBytes) const;
+
+		/// <summary>
+		/// 書き込む（既にあれば何もしない）
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool Put(const DerivedDataKey& Key, std::span<const uint8_t> Bytes) const;
+
+		/// <summary>
+		/// キーに対応するファイルの場所
+		/// </summary>
+		std::filesystem::path GetPath(const DerivedDataKey& Key) const;
+
+		/// <summary>
+		/// 置き場所
+		/// </summary>
+		const std::filesystem::path& GetRoot() const;
+
+	private:
+		/// <summary>
+		/// 置き場所
+		/// </summary>
+		std::filesystem::path mRoot;
+	};
+}
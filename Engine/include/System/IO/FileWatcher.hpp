@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<filesystem>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<unordered_map>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// ファイルの変化の種類
+	/// </summary>
+	enum class EFileChange : uint8_t
+	{
+		//	作られた・書き換えられた・名前を変えてここへ来た
+		Modified,
+		//	消された・名前を変えてここから出た
+		Removed,
+	};
+
+	/// <summary>
+	/// 落ち着いたファイルの変化
+	/// </summary>
+	struct FileChangeEvent
+	{
+		//	見ているフォルダからの相対パス（区切りは '/'）
+		std::string Path;
+		//	最後の変化の種類
+		EFileChange Type = EFileChange::Modified;
+		//	最後に変化した時刻
+		std::chrono::steady_clock::time_point Time;
+	};
+
+	/// <summary>
+	/// フォルダの下（サブフォルダも含む）のファイルの変化を見張る
+	/// Linux は inotify、Windows は ReadDirectoryChangesW を専用のスレッドで待つ。
+	/// エディタは1回の保存で何度も書いたり一時ファイルから名前を変えたりするので、同じファイルの変化は
+	/// 最後の変化から Debounce の間だけ静かになるまでまとめ、Poll で1つにして返す。
+	/// </summary>
+	class ENGINE_API FileWatcher
+	{
+	public:
+		/// <summary>
+		/// 既定のまとめる時間（ミリ秒）
+		/// </summary>
+		static constexpr uint32_t DEFAULT_DEBOUNCE_MS = 100;
+
+		FileWatcher();
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		/// <summary>
+		/// 見張り始める
+		/// </summary>
+		/// <param name="Root">見張るフォルダ</param>
+		/// <param name="DebounceMs">同じファイルの変化をまとめる時間（ミリ秒）</param>
+		/// <returns>true:成功</returns>
+		bool Start(const std::filesystem::path& Root, uint32_t DebounceMs = DEFAULT_DEBOUNCE_MS);
+
+		/// <summary>
+		/// 見張りをやめる（まだ落ち着いていない変化は捨てる）
+		/// </summary>
+		void Stop();
+
+		/// <summary>
+		/// 見張っているか
+		/// </summary>
+		bool IsWatching() const;
+
+		/// <summary>
+		/// 見張っているフォルダ
+		/// </summary>
+		const std::filesystem::path& GetRoot() const;
+
+		/// <summary>
+		/// 落ち着いた変化を取り出す（ゲームスレッドでフレームに1回）
+		/// </summary>
+		/// <param name="OutChanges">後ろに足す</param>
+		/// <returns>足した数</returns>
+		uint32_t Poll(std::vector<FileChangeEvent>& OutChanges);
+
+	private:
+		/// <summary>
+		/// 変化を受け取って待つスレッド
+		/// </summary>
+		void WatchThreadMain();
+
+		/// <summary>
+		/// 変化を記録する（同じファイルなら時刻を更新する）
+		/// </summary>
+		void Push(std::string Path, EFileChange Type);
+
+		/// <summary>
+		/// フォルダとその下を全て見張りに加える（inotify はフォルダごとに登録がいる）
+		/// </summary>
+		/// <param name="Directory">Root からの相対パス（空か '/' で終わる）</param>
+		/// <param name="IsNew">見張る前に作られたファイルを変化として報告する</param>
+		void AddWatchRecursive(const std::string& Directory, bool IsNew);
+
+	private:
+		/// <summary>
+		/// 落ち着くのを待っている変化
+		/// </summary>
+		struct PendingChange
+		{
+			EFileChange Type = EFileChange::Modified;
+			std::chrono::steady_clock::time_point Time;
+		};
+
+		/// <summary>
+		/// 見張っているフォルダ
+		/// </summary>
+		std::filesystem::path mRoot;
+		/// <summary>
+		/// 同じファイルの変化をまとめる時間
+		/// </summary>
+		std::chrono::milliseconds mDebounce;
+		/// <summary>
+		/// 見張りのスレッド
+		/// </summary>
+		std::thread mWatchThread;
+		/// <summary>
+		/// mPending を守る
+		/// </summary>
+		mutable std::mutex mMutex;
+		/// <summary>
+		/// 落ち着くのを待っている変化（相対パスから）
+		/// </summary>
+		std::unordered_map<std::string, PendingChange> mPending;
+		/// <summary>
+		/// inotify の登録からフォルダの相対パス（見張りのスレッドだけが触る）
+		/// </summary>
+		std::unordered_map<int, std::string> mWatches;
+		/// <summary>
+		/// OS の見張り（inotify の fd か、フォルダの HANDLE。無効なら -1）
+		/// </summary>
+		intptr_t mNative;
+		/// <summary>
+		/// 見張りのスレッドを起こすもの（eventfd か、イベントの HANDLE。無効なら -1）
+		/// </summary>
+		intptr_t mWake;
+		/// <summary>
+		/// 終了要求
+		/// </summary>
+		std::atomic<bool> mIsExitRequested;
+	};
+}
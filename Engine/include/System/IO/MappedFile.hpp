@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstdint>
+#include<filesystem>
+#include<span>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 読み込み専用でメモリに割り当てたファイル
+	/// 読み込み用のバッファを持たず、OS のページキャッシュをそのまま指す。
+	/// Windows は CreateFileMapping、それ以外は mmap。割り当てた後はハンドルを閉じても中身は残るので、先頭と大きさだけを持つ。
+	/// </summary>
+	class ENGINE_API MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/// <summary>
+		/// ファイルを開いて割り当てる（大きさ 0 のファイルは割り当てられないので失敗）
+		/// </summary>
+		/// <param name="Path">ファイルの場所</param>
+		/// <returns>true:成功</returns>
+		bool Open(const std::filesystem::path& Path);
+
+		/// <summary>
+		/// 割り当てを外して閉じる
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// 先頭から順に読むことを OS に伝え、先読みさせる
+		/// </summary>
+		void Prefetch() const;
+
+		/// <summary>
+		/// 開いているか
+		/// </summary>
+		bool IsOpen() const;
+
+		/// <summary>
+		/// 中身（開いていなければ空）
+		/// </summary>
+		std::span<const uint8_t> GetBytes() const;
+
+		/// <summary>
+		/// 大きさ（バイト）
+		/// </summary>
+		uint64_t GetSize() const;
+
+	private:
+		/// <summary>
+		/// 割り当てた先頭
+		/// </summary>
+		const uint8_t* mpData;
+		/// <summary>
+		/// 大きさ
+		/// </summary>
+		uint64_t mSize;
+	};
+}
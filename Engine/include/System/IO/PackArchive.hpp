@@ -0,0 +1,215 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/IO/MappedFile.hpp>
+
+#include<cstdint>
+#include<filesystem>
+#include<span>
+#include<string>
+#include<string_view>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// パックファイルの目印（"EPAK"）と版
+	/// </summary>
+	inline constexpr uint32_t PACK_MAGIC = 0x4B415045;
+	inline constexpr uint32_t PACK_VERSION = 1;
+
+	/// <summary>
+	/// 中身を分けて圧縮する単位（最後のチャンクだけ短い）
+	/// 1つずつ別々に展開できるので、大きなファイルはチャンクごとにワーカーへ分けられる。
+	/// </summary>
+	inline constexpr uint32_t PACK_CHUNK_SIZE = 64 * 1024;
+
+	/// <summary>
+	/// 各ファイルの中身の先頭の配置
+	/// セクタとページの大きさの倍数なので、OS のキャッシュを通さない読み込み（FILE_FLAG_NO_BUFFERING / O_DIRECT）でも
+	/// ファイル1つ分をそのまま1回で読める。
+	/// </summary>
+	inline constexpr uint64_t PACK_ALIGNMENT = 4096;
+
+	/// <summary>
+	/// ファイルの先頭
+	/// ヘッダーの後ろに目次（PackEntry）、チャンクの表（PackChunk）、パスの文字列が並び、
+	/// PACK_ALIGNMENT に揃えた DataOffset から各ファイルの中身が続く。
+	/// </summary>
+	struct PackHeader
+	{
+		//	PACK_MAGIC
+		uint32_t Magic;
+		//	PACK_VERSION
+		uint32_t Version;
+		//	ファイルの数
+		uint32_t EntryCount;
+		//	チャンクの数
+		uint32_t ChunkCount;
+		//	PACK_CHUNK_SIZE
+		uint32_t ChunkSize;
+		uint32_t Reserved;
+		//	目次の位置（PathHash の順に並ぶ）
+		uint64_t EntryOffset;
+		//	チャンクの表の位置
+		uint64_t ChunkOffset;
+		//	パスの文字列の位置と大きさ（終端の 0 は無い）
+		uint64_t PathOffset;
+		uint64_t PathSize;
+		//	中身の先頭（PACK_ALIGNMENT の倍数）
+		uint64_t DataOffset;
+		//	ファイル全体の大きさ
+		uint64_t FileSize;
+	};
+	static_assert(sizeof(PackHeader) == 72, "PackHeader is part of the file format.");
+
+	/// <summary>
+	/// 目次の1行（ファイル1つ分）
+	/// </summary>
+	struct PackEntry
+	{
+		//	PackArchive::HashPath の値
+		uint64_t PathHash;
+		//	展開した大きさ
+		uint64_t Size;
+		//	最初のチャンクと数（チャンクはファイル内で続けて並ぶ）
+		uint32_t FirstChunk;
+		uint32_t ChunkCount;
+		//	パスの文字列の中の位置と長さ
+		uint32_t PathOffset;
+		uint32_t PathLength;
+	};
+	static_assert(sizeof(PackEntry) == 32, "PackEntry is part of the file format.");
+
+	/// <summary>
+	/// チャンクの表の1行
+	/// </summary>
+	struct PackChunk
+	{
+		//	ファイル先頭からの位置
+		uint64_t Offset;
+		//	圧縮した大きさ（Size と同じなら圧縮せずにそのまま入っている）
+		uint32_t CompressedSize;
+		//	展開した大きさ
+		uint32_t Size;
+	};
+	static_assert(sizeof(PackChunk) == 16, "PackChunk is part of the file format.");
+
+	/// <summary>
+	/// 多数の素材を1つにまとめたパックファイル
+	/// ファイル全体を MappedFile で割り当てるので、開く時に読むのは目次の分だけで、個々のファイルを開き直すこともない。
+	/// 目次はパスのハッシュの順に並んでいるので、探すのは二分探索（同じハッシュはパスも比べる）。
+	/// 中身は PACK_CHUNK_SIZE ごとに LZ4 で圧縮されていて、読む時はチャンクを JobSystem で並列に展開する。
+	/// 開いた後は読むだけなので、どのスレッドからでも同時に呼べる。
+	/// </summary>
+	class ENGINE_API PackArchive
+	{
+	public:
+		PackArchive();
+		~PackArchive();
+
+		PackArchive(const PackArchive&) = delete;
+		PackArchive& operator=(const PackArchive&) = delete;
+
+		/// <summary>
+		/// 開いて目次を確かめる
+		/// </summary>
+		/// <param name="Path">ファイルの場所</param>
+		/// <returns>true:成功</returns>
+		bool Open(const std::filesystem::path& Path);
+
+		/// <summary>
+		/// 閉じる
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// 開いているか
+		/// </summary>
+		bool IsOpen() const;
+
+		/// <summary>
+		/// 探す（なければ nullptr）
+		/// </summary>
+		/// <param name="Path">パス（NormalizePath と同じ規則で比べる）</param>
+		const PackEntry* Find(std::string_view Path) const;
+
+		/// <summary>
+		/// 目次（PathHash の順）
+		/// </summary>
+		std::span<const PackEntry> GetEntries() const;
+
+		/// <summary>
+		/// 目次の行のパス（NormalizePath した形）
+		/// </summary>
+		std::string_view GetPath(const PackEntry& Entry) const;
+
+		/// <summary>
+		/// 1つ読む
+		/// </summary>
+		/// <param name="Entry">目次の行</param>
+		/// <param name="Out">書き込み先（Entry.Size バイト）</param>
+		/// <returns>true:成功</returns>
+		bool Read(const PackEntry& Entry, std::span<uint8_t> Out) const;
+
+		/// <summary>
+		/// パスで探して読む
+		/// </summary>
+		/// <param name="Path">パス</param>
+		/// <param name="OutBytes">中身</param>
+		/// <returns>true:成功</returns>
+		bool Read(std::string_view Path, std::vector<uint8_t>& OutBytes) const;
+
+		/// <summary>
+		/// まとめて読む
+		/// 全てのファイルのチャンクを1度に並列に展開するので、小さなファイルが多い時（起動時など）に速い。
+		/// </summary>
+		/// <param name="Entries">目次の行</param>
+		/// <param name="Outs">それぞれの書き込み先（Entry.Size バイト）</param>
+		/// <returns>true:全て成功</returns>
+		bool ReadBatch(std::span<const PackEntry* const> Entries, std::span<const std::span<uint8_t>> Outs) const;
+
+		/// <summary>
+		/// パスを目次の形にする（'\' を '/' に、英字を小文字に、先頭の "./" と "/" を取る）
+		/// </summary>
+		static std::string NormalizePath(std::string_view Path);
+
+		/// <summary>
+		/// 目次に使うパスのハッシュ（NormalizePath した後の文字列の Hash64）
+		/// </summary>
+		static uint64_t HashPath(std::string_view Path);
+
+		/// <summary>
+		/// ファイルの中身が正しいか（目次とチャンクの表が範囲内か）
+		/// </summary>
+		static bool Validate(std::span<const uint8_t> Bytes);
+
+	private:
+		/// <summary>
+		/// チャンクを1つ展開する
+		/// </summary>
+		bool ReadChunk(uint32_t Index, uint8_t* Out) const;
+
+	private:
+		/// <summary>
+		/// 割り当てたファイル
+		/// </summary>
+		MappedFile mFile;
+		/// <summary>
+		/// ヘッダー（開いていなければ nullptr）
+		/// </summary>
+		const PackHeader* mpHeader;
+		/// <summary>
+		/// 目次
+		/// </summary>
+		std::span<const PackEntry> mEntries;
+		/// <summary>
+		/// チャンクの表
+		/// </summary>
+		std::span<const PackChunk> mChunks;
+		/// <summary>
+		/// パスの文字列
+		/// </summary>
+		std::string_view mPaths;
+	};
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstdint>
+#include<filesystem>
+#include<string>
+#include<string_view>
+#include<unordered_set>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 直近の書き出しの結果
+	/// </summary>
+	struct PackWriteStats
+	{
+		//	ファイルとチャンクの数
+		uint32_t EntryCount = 0;
+		uint32_t ChunkCount = 0;
+		//	圧縮しても小さくならず、そのまま入れたチャンクの数
+		uint32_t StoredChunkCount = 0;
+		//	元の合計と書き出したファイルの大きさ（バイト）
+		uint64_t SourceSize = 0;
+		uint64_t FileSize = 0;
+		//	かかった時間（ミリ秒）
+		double ElapsedMs = 0.0;
+	};
+
+	/// <summary>
+	/// PackArchive で読むパックファイルを作る
+	/// 追加した時はパスと大きさだけを覚え、書き出す時にファイルを1つずつ読んで
+	/// チャンクを JobSystem で並列に圧縮する（全部をメモリに載せない）。
+	/// </summary>
+	class ENGINE_API PackWriter
+	{
+	public:
+		/// <summary>
+		/// メモリ上のデータを追加する
+		/// </summary>
+		/// <param name="Path">パック内のパス</param>
+		/// <param name="Bytes">中身</param>
+		/// <returns>true:成功（同じパスが既にあれば false）</returns>
+		bool Add(std::string_view Path, std::vector<uint8_t> Bytes);
+
+		/// <summary>
+		/// ファイルを追加する
+		/// </summary>
+		/// <param name="Path">パック内のパス</param>
+		/// <param name="Source">読むファイル</param>
+		/// <returns>true:成功</returns>
+		bool AddFile(std::string_view Path, const std::filesystem::path& Source);
+
+		/// <summary>
+		/// フォルダの下のファイルを全て追加する（パック内のパスは Root からの相対パス）
+		/// </summary>
+		/// <param name="Root">フォルダ</param>
+		/// <returns>追加した数</returns>
+		uint32_t AddDirectory(const std::filesystem::path& Root);
+
+		/// <summary>
+		/// 圧縮するか（しなければ全てのチャンクをそのまま入れる）
+		/// </summary>
+		void SetCompression(bool Enable);
+
+		/// <summary>
+		/// 書き出す
+		/// </summary>
+		/// <param name="Output">書き出し先</param>
+		/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+		/// <returns>true:成功</returns>
+		bool Write(const std::filesystem::path& Output, PackWriteStats* pStats = nullptr) const;
+
+	private:
+		/// <summary>
+		/// 追加したもの1つ
+		/// </summary>
+		struct PendingEntry
+		{
+			//	NormalizePath したパス
+			std::string Path;
+			uint64_t PathHash = 0;
+			//	大きさ
+			uint64_t Size = 0;
+			//	読むファイル（空なら Bytes）
+			std::filesystem::path Source;
+			std::vector<uint8_t> Bytes;
+		};
+
+	private:
+		/// <summary>
+		/// 追加したもの
+		/// </summary>
+		std::vector<PendingEntry> mEntries;
+		/// <summary>
+		/// 追加したパス（同じものを2回入れないため）
+		/// </summary>
+		std::unordered_set<std::string> mPaths;
+		/// <summary>
+		/// 圧縮するか
+		/// </summary>
+		bool mCompress = true;
+	};
+}
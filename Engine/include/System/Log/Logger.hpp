@@ -5,6 +5,7 @@
 
 #include<cstdint>
 #include<cstdio>
+#include<Utility/Format/Format.hpp>
 #include<string>
 #include<string_view>
 #include<mutex>
@@ -101,7 +102,7 @@ namespace Ecse::System
 		{
 			try
 			{
-				std::string message = std::vformat(Fmt, std::make_format_args(std::forward<Args>(args)...));				
+				std::string message = std::vformat(Fmt, std::make_format_args(args...));				
 				LogInternal(Location.file_name(), static_cast<int>(Location.line()), Level, message);
 			}
 			catch (const std::format_error& e)
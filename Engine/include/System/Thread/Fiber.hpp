@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstddef>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 自分のスタックを持ち、好きな所で止めて別のファイバーへ切り替えられる実行の流れ
+	/// Windows はネイティブのファイバー、Linux は ucontext を使う。
+	/// 切り替えは協調的で、止めたファイバーは誰かが Switch で戻すまで止まったまま（別のスレッドから戻してもよい）。
+	/// スレッドのスタックそのものも ConvertCurrentThread で切り替え元・切り替え先にできる。
+	/// </summary>
+	class ENGINE_API Fiber
+	{
+		friend struct FiberEntry;
+
+	public:
+		/// <summary>
+		/// ファイバーの入口（戻ってはいけない。終わったら他のファイバーへ切り替える）
+		/// </summary>
+		using EntryFunction = void(*)(void* pUserData);
+
+		Fiber();
+		~Fiber();
+
+		Fiber(const Fiber&) = delete;
+		Fiber& operator=(const Fiber&) = delete;
+
+		/// <summary>
+		/// 自分のスタックを持つファイバーを作る（最初に切り替えた時に Entry から動き出す）
+		/// </summary>
+		/// <param name="StackSize">スタックの大きさ（バイト）</param>
+		/// <param name="Entry">入口</param>
+		/// <param name="pUserData">Entry に渡す値</param>
+		/// <returns>true:成功</returns>
+		bool Create(size_t StackSize, EntryFunction Entry, void* pUserData);
+
+		/// <summary>
+		/// 呼んだスレッドを、今の続きを表すファイバーにする（既にファイバーならそれを使う）
+		/// </summary>
+		/// <returns>true:成功</returns>
+		bool ConvertCurrentThread();
+
+		/// <summary>
+		/// 破棄する（ConvertCurrentThread したものは、そのスレッドで呼ぶと元のスレッドに戻る）
+		/// 動いている途中のファイバーは破棄できない。
+		/// </summary>
+		void Destroy();
+
+		/// <summary>
+		/// 作られているか
+		/// </summary>
+		bool IsValid() const;
+
+		/// <summary>
+		/// 今動いている From を止めて To へ切り替える（From へ戻ってきたら、ここから続く）
+		/// </summary>
+		static void Switch(Fiber& From, Fiber& To);
+
+	private:
+		/// <summary>
+		/// OS のファイバー（Windows はファイバーのアドレス、Linux は ucontext_t）
+		/// </summary>
+		void* mpNative;
+		/// <summary>
+		/// Linux で確保したスタック
+		/// </summary>
+		void* mpStack;
+		/// <summary>
+		/// 入口
+		/// </summary>
+		EntryFunction mEntry;
+		/// <summary>
+		/// 入口に渡す値
+		/// </summary>
+		void* mpUserData;
+		/// <summary>
+		/// スレッドのスタックを表しているか
+		/// </summary>
+		bool mIsThread;
+		/// <summary>
+		/// ConvertCurrentThread でスレッドをファイバーに変えたか（破棄する時に戻す）
+		/// </summary>
+		bool mIsConverted;
+	};
+}
@@ -0,0 +1,369 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/Thread/Fiber.hpp>
+#include<System/Thread/WorkStealingQueue.hpp>
+
+#include<atomic>
+#include<condition_variable>
+#include<cstdint>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// JobSystem の1つの仕事（JobSystem の中だけで使う）
+	/// </summary>
+	struct Job;
+
+	/// <summary>
+	/// JobSystem が仕事を動かすファイバー（JobSystem の中だけで使う）
+	/// </summary>
+	struct JobFiber;
+
+	/// <summary>
+	/// 仕事の動かし方
+	/// </summary>
+	enum class EJobExecution : uint8_t
+	{
+		//	ワーカーのスタックでそのまま動かす（Wait は他の仕事をその上に積んで手伝う）
+		Thread,
+		//	仕事ごとにファイバーで動かす（Wait は仕事を止めてワーカーを空け、0 になったらどれかのワーカーで続きから動かす）
+		Fiber,
+	};
+
+	/// <summary>
+	/// 仕事の完了を数えるカウンター
+	/// Run に渡すと積んだ時に 1 増え、終わった時に 1 減る。0 なら全て終わっている。
+	/// 他の仕事の「後で」動かす印にも使える（Run の After）。
+	/// 減らしたスレッドが触り終わるまで IsDone は true にならないので、IsDone か JobSystem::Wait の後なら破棄してよい。
+	/// </summary>
+	class ENGINE_API JobCounter
+	{
+		friend class JobSystem;
+
+	public:
+		JobCounter();
+		~JobCounter();
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		/// <summary>
+		/// 全て終わっているか
+		/// </summary>
+		bool IsDone() const;
+
+		/// <summary>
+		/// 残りの数
+		/// </summary>
+		uint32_t GetValue() const;
+
+	private:
+		/// <summary>
+		/// 残りの数
+		/// </summary>
+		std::atomic<uint32_t> mValue;
+		/// <summary>
+		/// 減らしている途中のスレッドの数（減らす前に増やすので、mValue が 0 でもこれが 0 になるまでは触られる）
+		/// </summary>
+		std::atomic<uint32_t> mReleasing;
+		/// <summary>
+		/// mWaiters を守る
+		/// </summary>
+		std::mutex mMutex;
+		/// <summary>
+		/// 0 になるのを待って積まれる仕事
+		/// </summary>
+		std::vector<Job*> mWaiters;
+	};
+
+	/// <summary>
+	/// 直近までの数（ワーカーとメインスレッドの分）
+	/// </summary>
+	struct JobSystemStats
+	{
+		//	実行した仕事
+		uint64_t Executed = 0;
+		//	他のスレッドのキューから盗んだ仕事
+		uint64_t Stolen = 0;
+		//	ParallelFor で範囲を半分に分けた回数
+		uint64_t Splits = 0;
+		//	ワーカーが仕事が無くて眠った回数
+		uint64_t Sleeps = 0;
+		//	ファイバーを止めて待った回数
+		uint64_t Suspends = 0;
+		//	空いたファイバーが無く、スレッドのスタックでそのまま動かした仕事
+		uint64_t InlineRuns = 0;
+	};
+
+	/// <summary>
+	/// 盗み合う仕事のスケジューラ
+	/// ワーカーと Initialize を呼んだスレッド（メインスレッド）がそれぞれ Chase-Lev のキューを持ち、自分のキューの後ろから取り、
+	/// 空なら他のキューの前から盗む。それ以外のスレッドから積んだ仕事は共有のキューへ入る。
+	/// Wait はカウンターが 0 になるまで他の仕事を手伝うので、メインスレッドやワーカーの中から待っても止まらない。
+	/// ParallelFor は範囲を小さな塊ずつ処理し、自分のキューが空になった（盗まれた＝手の空いたスレッドがいる）時だけ残りを半分に分けて積む。
+	/// 処理の重さが偏っていても、分ける回数はスレッド数に応じた分だけで済む。
+	/// EJobExecution::Fiber にすると、仕事の中の Wait は積み重ねて手伝う代わりにファイバーごと止まる。
+	/// 読み込み → 展開 → 転送のように長く待つ鎖でも、ワーカーのスタックが深くならず、先に終わったものから続きが動く。
+	/// エンジンのワーカースレッドはこれだけで、並列に分ける処理と裏で動かす処理は全てここへ積む。
+	/// </summary>
+	class ENGINE_API JobSystem : public ServiceProvider<JobSystem>
+	{
+		ECSE_SERVICE_ACCESS(JobSystem);
+
+	public:
+		/// <summary>
+		/// 仕事を積んだスレッドを表す番号が無い（ワーカーでもメインスレッドでもない）
+		/// </summary>
+		static constexpr uint32_t INVALID_THREAD_INDEX = UINT32_MAX;
+		/// <summary>
+		/// 既定のファイバーの数（全て止まっている時はスレッドのスタックでそのまま動かす）
+		/// </summary>
+		static constexpr uint32_t DEFAULT_FIBER_COUNT = 128;
+		/// <summary>
+		/// ファイバー1つのスタックの大きさ（バイト）
+		/// </summary>
+		static constexpr size_t FIBER_STACK_SIZE = 256 * 1024;
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// ワーカーを起動する（呼んだスレッドをメインスレッドとして番号 0 にする）
+		/// </summary>
+		/// <param name="WorkerCount">ワーカー数（0:論理コア数-1）</param>
+		/// <param name="Execution">仕事の動かし方</param>
+		/// <param name="FiberCount">EJobExecution::Fiber の時に作るファイバーの数</param>
+		/// <returns>true:成功</returns>
+		bool Initialize(uint32_t WorkerCount = 0, EJobExecution Execution = EJobExecution::Thread, uint32_t FiberCount = DEFAULT_FIBER_COUNT);
+
+		/// <summary>
+		/// 仕事を積む（完了は待たない）
+		/// </summary>
+		/// <param name="Func">仕事</param>
+		/// <param name="pCounter">完了を数えるカウンター（不要なら nullptr）</param>
+		void Run(std::function<void()> Func, JobCounter* pCounter = nullptr);
+
+		/// <summary>
+		/// After が 0 になってから仕事を積む（既に 0 ならすぐ積む）
+		/// </summary>
+		/// <param name="Func">仕事</param>
+		/// <param name="pCounter">完了を数えるカウンター（不要なら nullptr）</param>
+		/// <param name="After">先に終わっていてほしい仕事のカウンター</param>
+		void Run(std::function<void()> Func, JobCounter* pCounter, JobCounter& After);
+
+		/// <summary>
+		/// カウンターが 0 になるまで待つ
+		/// ファイバーで動いている仕事の中ならファイバーを止めてワーカーを空け、それ以外は他の仕事を手伝いながら待つ。
+		/// </summary>
+		void Wait(JobCounter& Counter);
+
+		/// <summary>
+		/// JobSystem の外の処理（I/O など）の完了を待つためにカウンターを増やす（終わったら Complete を呼ぶ）
+		/// </summary>
+		void AddPending(JobCounter& Counter, uint32_t Count = 1);
+
+		/// <summary>
+		/// AddPending した処理が1つ終わった（どのスレッドから呼んでもよい）
+		/// </summary>
+		void Complete(JobCounter& Counter);
+
+		/// <summary>
+		/// [0, Count) を分けて並列に処理し、全て終わるまで待つ（呼んだスレッドも処理する）
+		/// </summary>
+		/// <param name="Count">要素数</param>
+		/// <param name="Func">[Begin, End) を処理する関数</param>
+		/// <param name="MinGrain">1回に処理する最小の要素数（1要素が軽い時に大きくする）</param>
+		void ParallelFor(uint32_t Count, const std::function<void(uint32_t, uint32_t)>& Func, uint32_t MinGrain = 1);
+
+		/// <summary>
+		/// JobSystem があれば ParallelFor で分け、なければ呼んだスレッドで [0, Count) をまとめて処理する
+		/// </summary>
+		/// <param name="Count">要素数</param>
+		/// <param name="Func">[Begin, End) を処理する関数</param>
+		/// <param name="MinGrain">1回に処理する最小の要素数（1要素が軽い時に大きくする）</param>
+		static void ParallelForOrInline(uint32_t Count, const std::function<void(uint32_t, uint32_t)>& Func, uint32_t MinGrain = 1);
+
+		/// <summary>
+		/// ワーカー数（メインスレッドは含まない）
+		/// </summary>
+		uint32_t GetWorkerCount() const;
+
+		/// <summary>
+		/// 呼んだスレッドの番号（0:メインスレッド、1～:ワーカー、それ以外は INVALID_THREAD_INDEX）
+		/// ファイバーで動いている仕事は Wait の後で別のスレッドに移っていることがある。
+		/// </summary>
+		uint32_t GetThreadIndex() const;
+
+		/// <summary>
+		/// 仕事の動かし方
+		/// </summary>
+		EJobExecution GetExecution() const;
+
+		/// <summary>
+		/// 直近までの数
+		/// </summary>
+		JobSystemStats GetStats() const;
+
+	private:
+		/// <summary>
+		/// スレッドごとの状態
+		/// </summary>
+		struct ThreadState
+		{
+			//	自分のキュー
+			WorkStealingQueue<Job*> Queue;
+			//	盗む相手を選ぶ乱数
+			uint32_t Random = 0;
+			//	数（他のスレッドは GetStats でだけ読む）
+			std::atomic<uint64_t> Executed = 0;
+			std::atomic<uint64_t> Stolen = 0;
+			std::atomic<uint64_t> Splits = 0;
+			std::atomic<uint64_t> Sleeps = 0;
+			std::atomic<uint64_t> Suspends = 0;
+			std::atomic<uint64_t> InlineRuns = 0;
+		};
+
+		/// <summary>
+		/// ワーカー本体
+		/// </summary>
+		void WorkerMain(uint32_t Index);
+
+		/// <summary>
+		/// ワーカーの停止（残っている仕事は流し切る）
+		/// </summary>
+		void Stop();
+
+		/// <summary>
+		/// 仕事をキューへ入れ、眠っているワーカーがいれば起こす
+		/// </summary>
+		void Push(Job* pJob);
+
+		/// <summary>
+		/// 次の仕事を探す（自分のキュー → 共有のキュー → 他のスレッドのキュー）
+		/// </summary>
+		/// <returns>見つからなければ nullptr</returns>
+		Job* FindJob(uint32_t Index);
+
+		/// <summary>
+		/// 仕事を実行する（ファイバーで動かすか、止まっていたファイバーの続きを動かす）
+		/// </summary>
+		void Execute(Job* pJob, uint32_t Index);
+
+		/// <summary>
+		/// 仕事の関数を呼び、カウンターを減らす
+		/// </summary>
+		void RunJob(Job* pJob);
+
+		/// <summary>
+		/// スレッドのスタックからファイバーへ切り替え、戻ってきたら止まった理由に応じて片付ける
+		/// </summary>
+		void SwitchToFiber(JobFiber* pFiber);
+
+		/// <summary>
+		/// 今動いているファイバーを止め、Counter が 0 になったら続きを積むようにする
+		/// </summary>
+		void Suspend(JobCounter& Counter);
+
+		/// <summary>
+		/// ファイバーの入口（仕事を1つ動かすごとにスレッドのスタックへ戻る）
+		/// </summary>
+		static void FiberMain(void* pUserData);
+
+		/// <summary>
+		/// 空いたファイバーを取る（無ければ nullptr）
+		/// </summary>
+		JobFiber* AcquireFiber();
+
+		/// <summary>
+		/// 仕事を終えたファイバーを返す
+		/// </summary>
+		void ReleaseFiber(JobFiber* pFiber);
+
+		/// <summary>
+		/// カウンターが 0 になるのを待つ仕事に加える
+		/// </summary>
+		/// <returns>false:既に 0 だった（加えていない）</returns>
+		bool AddWaiter(JobCounter& Counter, Job* pJob);
+
+		/// <summary>
+		/// カウンターを 1 減らし、0 になったら待っていた仕事を積む
+		/// </summary>
+		void Decrement(JobCounter& Counter);
+
+		/// <summary>
+		/// ParallelFor の範囲を処理する（盗まれていたら残りを半分に分けて積む）
+		/// </summary>
+		void RunRange(const std::function<void(uint32_t, uint32_t)>& Func, JobCounter& Counter, uint32_t Grain, uint32_t Begin, uint32_t End);
+
+	private:
+		/// <summary>
+		/// ワーカースレッド
+		/// </summary>
+		std::vector<std::thread> mWorkers;
+		/// <summary>
+		/// スレッドごとの状態（0 がメインスレッド、1～がワーカー）
+		/// </summary>
+		std::vector<std::unique_ptr<ThreadState>> mThreads;
+		/// <summary>
+		/// ワーカーでもメインスレッドでもないスレッドから積んだ仕事
+		/// </summary>
+		std::deque<Job*> mSharedJobs;
+		/// <summary>
+		/// mSharedJobs を守る
+		/// </summary>
+		std::mutex mSharedMutex;
+		/// <summary>
+		/// キューに入っている仕事の数（眠るか決める目安）
+		/// </summary>
+		std::atomic<int64_t> mQueuedCount;
+		/// <summary>
+		/// 眠っているワーカーの数
+		/// </summary>
+		std::atomic<uint32_t> mSleepingCount;
+		/// <summary>
+		/// 眠る・起こすの保護
+		/// </summary>
+		std::mutex mSleepMutex;
+		/// <summary>
+		/// 仕事の追加・終了要求の通知
+		/// </summary>
+		std::condition_variable mCondition;
+		/// <summary>
+		/// 終了要求
+		/// </summary>
+		std::atomic<bool> mIsExitRequested;
+		/// <summary>
+		/// 仕事の動かし方
+		/// </summary>
+		EJobExecution mExecution;
+		/// <summary>
+		/// 作った全てのファイバー
+		/// </summary>
+		std::vector<JobFiber*> mFibers;
+		/// <summary>
+		/// 空いているファイバー（スレッドごとに1つは手元に置くので、ここに無いこともある）
+		/// </summary>
+		std::vector<JobFiber*> mFreeFibers;
+		/// <summary>
+		/// mFreeFibers を守る
+		/// </summary>
+		std::mutex mFiberMutex;
+	};
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstdint>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<atomic>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// ゲームスレッドと描画スレッドで受け渡すスナップショットの数（ダブルバッファ）
+	/// </summary>
+	inline constexpr uint32_t FRAME_SNAPSHOT_COUNT = 2;
+
+	/// <summary>
+	/// 描画の記録と送信だけを行うスレッド
+	/// ゲームスレッドが N+1 フレーム目を更新している間に N フレーム目を記録する。
+	/// </summary>
+	class ENGINE_API RenderThread
+	{
+	public:
+		RenderThread();
+		~RenderThread();
+
+		RenderThread(const RenderThread&) = delete;
+		RenderThread& operator=(const RenderThread&) = delete;
+
+		/// <summary>
+		/// スレッドの開始
+		/// </summary>
+		/// <param name="RenderFunc">スナップショット番号を受け取って1フレーム分を記録・送信する処理</param>
+		/// <returns>true:成功</returns>
+		bool Start(std::function<void(uint32_t)> RenderFunc);
+
+		/// <summary>
+		/// スナップショットの描画を依頼する
+		/// 前のフレームの描画が終わるまで待つので、戻った時点でもう片方のスナップショットは書き込み可能
+		/// </summary>
+		/// <param name="Slot">描画するスナップショット番号</param>
+		void Kick(uint32_t Slot);
+
+		/// <summary>
+		/// 依頼済みのフレームの描画完了まで待つ
+		/// </summary>
+		void WaitIdle();
+
+		/// <summary>
+		/// スレッドの停止（依頼済みのフレームは描画してから止める）
+		/// </summary>
+		void Stop();
+
+		/// <summary>
+		/// 起動しているかどうか
+		/// </summary>
+		bool IsRunning() const;
+
+		/// <summary>
+		/// 直近のフレームの記録・送信にかかった時間（ミリ秒）
+		/// </summary>
+		double GetLastRenderMs() const;
+
+		/// <summary>
+		/// 直近の Kick で描画スレッドを待った時間（ミリ秒）
+		/// </summary>
+		double GetLastWaitMs() const;
+
+	private:
+		/// <summary>
+		/// スレッド本体
+		/// </summary>
+		void ThreadMain();
+
+	private:
+		/// <summary>
+		/// 描画スレッド
+		/// </summary>
+		std::thread mThread;
+		/// <summary>
+		/// 依頼状態の保護
+		/// </summary>
+		std::mutex mMutex;
+		/// <summary>
+		/// 依頼・完了の通知
+		/// </summary>
+		std::condition_variable mCondition;
+		/// <summary>
+		/// 1フレーム分の描画処理
+		/// </summary>
+		std::function<void(uint32_t)> mRenderFunc;
+		/// <summary>
+		/// 依頼されたスナップショット番号
+		/// </summary>
+		uint32_t mSlot;
+		/// <summary>
+		/// 未処理の依頼があるか
+		/// </summary>
+		bool mHasWork;
+		/// <summary>
+		/// 描画中かどうか
+		/// </summary>
+		bool mIsBusy;
+		/// <summary>
+		/// 終了要求
+		/// </summary>
+		bool mIsExitRequested;
+		/// <summary>
+		/// 直近の描画時間
+		/// </summary>
+		std::atomic<double> mLastRenderMs;
+		/// <summary>
+		/// 直近の待ち時間（ゲームスレッドからしか触らない）
+		/// </summary>
+		double mLastWaitMs;
+	};
+}
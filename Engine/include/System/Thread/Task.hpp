@@ -0,0 +1,407 @@
+﻿#pragma once
+
+#include<System/Thread/TaskFrameAllocator.hpp>
+
+#include<atomic>
+#include<coroutine>
+#include<cstdint>
+#include<exception>
+#include<functional>
+#include<optional>
+#include<type_traits>
+#include<utility>
+
+namespace Ecse::System
+{
+	template<typename T>
+	class Task;
+
+	/// <summary>
+	/// Task のプロミスの共通部分
+	/// フレームは TaskFrameAllocator から取り、終わった時に待っているコルーチン（続き）へそのまま切り替える。
+	/// mState は 0:動いている、1:終わった、2:手放された（終わったら自分で破棄する）、それ以外:続きのアドレス。
+	/// </summary>
+	class TaskPromiseBase
+	{
+		template<typename T>
+		friend class Task;
+
+	public:
+		static constexpr uintptr_t STATE_RUNNING = 0;
+		static constexpr uintptr_t STATE_DONE = 1;
+		static constexpr uintptr_t STATE_DETACHED = 2;
+
+		/// <summary>
+		/// 終わった時に続きへ切り替える
+		/// </summary>
+		struct FinalAwaiter
+		{
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			template<typename TPromise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> Handle) noexcept
+			{
+				const uintptr_t state = Handle.promise().mState.exchange(STATE_DONE, std::memory_order_acq_rel);
+				if (state == STATE_DETACHED)
+				{
+					Handle.destroy();
+					return std::noop_coroutine();
+				}
+				if (state != STATE_RUNNING) return std::coroutine_handle<>::from_address(reinterpret_cast<void*>(state));
+				return std::noop_coroutine();
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+		};
+
+		static void* operator new(size_t Size)
+		{
+			return TaskFrameAllocator::Allocate(Size);
+		}
+
+		static void operator delete(void* pFrame, size_t Size)
+		{
+			TaskFrameAllocator::Free(pFrame, Size);
+		}
+
+		//	Start か co_await されるまで動かない
+		std::suspend_always initial_suspend() const noexcept
+		{
+			return {};
+		}
+
+		FinalAwaiter final_suspend() const noexcept
+		{
+			return {};
+		}
+
+		//	例外は使わない
+		void unhandled_exception() const noexcept
+		{
+			std::terminate();
+		}
+
+	protected:
+		std::atomic<uintptr_t> mState = STATE_RUNNING;
+	};
+
+	/// <summary>
+	/// 値を返す Task のプロミス
+	/// </summary>
+	template<typename T>
+	class TaskPromise : public TaskPromiseBase
+	{
+	public:
+		Task<T> get_return_object() noexcept;
+
+		template<typename U>
+		void return_value(U&& Value)
+		{
+			mValue.emplace(std::forward<U>(Value));
+		}
+
+		T& GetValue()
+		{
+			return *mValue;
+		}
+
+	private:
+		std::optional<T> mValue;
+	};
+
+	/// <summary>
+	/// 値を返さない Task のプロミス
+	/// </summary>
+	template<>
+	class TaskPromise<void> : public TaskPromiseBase
+	{
+	public:
+		Task<void> get_return_object() noexcept;
+
+		void return_void() const noexcept
+		{
+		}
+
+		void GetValue() const noexcept
+		{
+		}
+	};
+
+	/// <summary>
+	/// C++20 のコルーチンで書いた非同期の処理
+	/// 作っただけでは動かず、co_await されるか Start で動き出す。途中の co_await で止まった所からは、
+	/// 待っていたもの（JobSystem の仕事・ファイルの読み込み・GPU のフェンス・次のフレーム）が終わったスレッドで続く。
+	/// 終わったら、co_await して待っているコルーチンへそのまま切り替える（スタックを積まない）。
+	/// 読み込み → 展開 → 転送のような、コールバックを継ぎ足していた処理を上から順に書ける。
+	/// 持ち主が居なくなっても動き続けてほしい時は Detach する（終わったら自分で片付く）。
+	/// 動いている途中で破棄しても Detach と同じになる。一度も動かさずに破棄したら動かない。
+	/// </summary>
+	template<typename T = void>
+	class Task
+	{
+	public:
+		using promise_type = TaskPromise<T>;
+
+		/// <summary>
+		/// co_await で終わるまで待つ（結果はムーブで取り出す）
+		/// </summary>
+		class Awaiter
+		{
+		public:
+			explicit Awaiter(Task& Owner) noexcept
+				:mOwner(Owner)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return mOwner.IsDone();
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> Continuation) noexcept
+			{
+				TaskPromiseBase& promise = mOwner.mHandle.promise();
+				const uintptr_t continuation = reinterpret_cast<uintptr_t>(Continuation.address());
+
+				//	まだ動いていなければ続きを覚えてからそのまま動かす
+				if (mOwner.mIsStarted == false)
+				{
+					mOwner.mIsStarted = true;
+					promise.mState.store(continuation, std::memory_order_relaxed);
+					return mOwner.mHandle;
+				}
+
+				//	既に終わっていたら止まらずに続ける
+				uintptr_t expected = TaskPromiseBase::STATE_RUNNING;
+				if (promise.mState.compare_exchange_strong(expected, continuation, std::memory_order_acq_rel) == false)
+				{
+					return Continuation;
+				}
+				return std::noop_coroutine();
+			}
+
+			T await_resume()
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					return;
+				}
+				else
+				{
+					return std::move(mOwner.mHandle.promise().GetValue());
+				}
+			}
+
+		private:
+			Task& mOwner;
+		};
+
+		Task() noexcept
+			:mHandle(nullptr)
+			, mIsStarted(false)
+		{
+		}
+
+		explicit Task(std::coroutine_handle<promise_type> Handle) noexcept
+			:mHandle(Handle)
+			, mIsStarted(false)
+		{
+		}
+
+		Task(Task&& Other) noexcept
+			:mHandle(std::exchange(Other.mHandle, nullptr))
+			, mIsStarted(Other.mIsStarted)
+		{
+		}
+
+		Task& operator=(Task&& Other) noexcept
+		{
+			if (this != &Other)
+			{
+				this->Reset();
+				mHandle = std::exchange(Other.mHandle, nullptr);
+				mIsStarted = Other.mIsStarted;
+			}
+			return *this;
+		}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		~Task()
+		{
+			this->Reset();
+		}
+
+		/// <summary>
+		/// コルーチンを持っているか
+		/// </summary>
+		bool IsValid() const noexcept
+		{
+			return mHandle != nullptr;
+		}
+
+		/// <summary>
+		/// 終わったか
+		/// </summary>
+		bool IsDone() const noexcept
+		{
+			return mIsStarted == true && mHandle.promise().mState.load(std::memory_order_acquire) == TaskPromiseBase::STATE_DONE;
+		}
+
+		/// <summary>
+		/// 動かす（最初の co_await で止まるまで、呼んだスレッドで動く）
+		/// </summary>
+		void Start()
+		{
+			if (mHandle == nullptr || mIsStarted == true) return;
+			mIsStarted = true;
+			mHandle.resume();
+		}
+
+		/// <summary>
+		/// 手放す（動いていなければ動かす。終わったらフレームは自分で片付く）
+		/// </summary>
+		void Detach()
+		{
+			if (mHandle == nullptr) return;
+			std::coroutine_handle<promise_type> handle = std::exchange(mHandle, nullptr);
+			TaskPromiseBase& promise = handle.promise();
+
+			if (mIsStarted == false)
+			{
+				promise.mState.store(TaskPromiseBase::STATE_DETACHED, std::memory_order_relaxed);
+				handle.resume();
+				return;
+			}
+
+			//	既に終わっていたらここで片付ける
+			uintptr_t expected = TaskPromiseBase::STATE_RUNNING;
+			if (promise.mState.compare_exchange_strong(expected, TaskPromiseBase::STATE_DETACHED, std::memory_order_acq_rel) == false
+				&& expected == TaskPromiseBase::STATE_DONE)
+			{
+				handle.destroy();
+			}
+		}
+
+		/// <summary>
+		/// 結果（IsDone の後だけ）
+		/// </summary>
+		decltype(auto) GetResult()
+		{
+			return mHandle.promise().GetValue();
+		}
+
+		Awaiter operator co_await() noexcept
+		{
+			return Awaiter(*this);
+		}
+
+	private:
+		/// <summary>
+		/// 持っているコルーチンを手放す（動いていなければ破棄する）
+		/// </summary>
+		void Reset()
+		{
+			if (mHandle == nullptr) return;
+			if (mIsStarted == false)
+			{
+				mHandle.destroy();
+				mHandle = nullptr;
+				return;
+			}
+			this->Detach();
+		}
+
+	private:
+		/// <summary>
+		/// コルーチン
+		/// </summary>
+		std::coroutine_handle<promise_type> mHandle;
+		/// <summary>
+		/// 動かしたか
+		/// </summary>
+		bool mIsStarted;
+	};
+
+	template<typename T>
+	Task<T> TaskPromise<T>::get_return_object() noexcept
+	{
+		return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+	}
+
+	inline Task<void> TaskPromise<void>::get_return_object() noexcept
+	{
+		return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+	}
+
+	/// <summary>
+	/// 完了をコールバックで知らせる処理を co_await で待てるようにする
+	/// 作る時に渡した関数へ「再開する関数」を渡して処理を始め、それが結果と共に呼ばれたら続きを動かす。
+	/// 再開する関数はどのスレッドから呼んでもよく、処理を始めた関数の中でそのまま呼んでもよい（その時は止まらずに続く）。
+	/// </summary>
+	template<typename TResult>
+	class CallbackAwaiter
+	{
+	public:
+		using ResumeFunction = std::function<void(TResult)>;
+		using StartFunction = std::function<void(ResumeFunction)>;
+
+		explicit CallbackAwaiter(StartFunction Start)
+			:mStart(std::move(Start))
+			, mResult()
+			, mHandle(nullptr)
+			, mIsArrived(false)
+		{
+		}
+
+		CallbackAwaiter(const CallbackAwaiter&) = delete;
+		CallbackAwaiter& operator=(const CallbackAwaiter&) = delete;
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		bool await_suspend(std::coroutine_handle<> Handle)
+		{
+			mHandle = Handle;
+			mStart([this](TResult Result)
+				{
+					mResult.emplace(std::move(Result));
+					//	後から来た方が続きを動かす（これより後は this に触らない）
+					if (mIsArrived.exchange(true, std::memory_order_acq_rel) == true) mHandle.resume();
+				});
+			//	Start の中で既に呼ばれていたら止まらない
+			return mIsArrived.exchange(true, std::memory_order_acq_rel) == false;
+		}
+
+		TResult await_resume()
+		{
+			return std::move(*mResult);
+		}
+
+	private:
+		/// <summary>
+		/// 処理を始める関数
+		/// </summary>
+		StartFunction mStart;
+		/// <summary>
+		/// 結果
+		/// </summary>
+		std::optional<TResult> mResult;
+		/// <summary>
+		/// 待っているコルーチン
+		/// </summary>
+		std::coroutine_handle<> mHandle;
+		/// <summary>
+		/// 結果が届いたか、await_suspend が処理を始め終えたか（後の方が続きを動かす）
+		/// </summary>
+		std::atomic<bool> mIsArrived;
+	};
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstddef>
+#include<cstdint>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 直近までの数
+	/// </summary>
+	struct TaskFrameStats
+	{
+		//	確保した回数
+		uint64_t Allocations = 0;
+		//	そのうち使い終わったフレームを使い回した回数
+		uint64_t Reused = 0;
+		//	大きすぎてプールを通さなかった回数
+		uint64_t Large = 0;
+	};
+
+	/// <summary>
+	/// Task のコルーチンのフレームを確保する
+	/// 大きさを 64 バイトから倍ずつの段に丸め、解放されたフレームはスレッドごとの段の空きに戻して次の確保で使い回す。
+	/// フレームは読み込みや待ちのたびに作っては捨てるので、ヒープに毎回取りに行かないようにする。
+	/// 確保したスレッドと別のスレッドで解放してもよい（解放したスレッドの空きに入る）。
+	/// </summary>
+	class ENGINE_API TaskFrameAllocator
+	{
+	public:
+		/// <summary>
+		/// 段の数（64 ～ 4096 バイト）
+		/// </summary>
+		static constexpr uint32_t SIZE_CLASS_COUNT = 7;
+		/// <summary>
+		/// 一番小さい段の大きさ（バイト）
+		/// </summary>
+		static constexpr size_t MIN_SIZE = 64;
+		/// <summary>
+		/// プールを通す一番大きな大きさ（バイト。超えたら普通に確保する）
+		/// </summary>
+		static constexpr size_t MAX_SIZE = MIN_SIZE << (SIZE_CLASS_COUNT - 1);
+		/// <summary>
+		/// スレッドごとに段ごとに取っておく数
+		/// </summary>
+		static constexpr size_t MAX_CACHED_PER_CLASS = 256;
+
+		/// <summary>
+		/// 確保する
+		/// </summary>
+		static void* Allocate(size_t Size);
+
+		/// <summary>
+		/// 解放する（Size は Allocate と同じもの）
+		/// </summary>
+		static void Free(void* pFrame, size_t Size);
+
+		/// <summary>
+		/// 直近までの数
+		/// </summary>
+		static TaskFrameStats GetStats();
+	};
+}
@@ -0,0 +1,259 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+#include<System/Service/ServiceProvider.hpp>
+#include<System/Thread/Task.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<System/IO/AsyncFileIO.hpp>
+
+#include<coroutine>
+#include<cstdint>
+#include<mutex>
+#include<span>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 直近までの待ちの数
+	/// </summary>
+	struct TaskSchedulerStats
+	{
+		//	今 GPU のフェンスを待っている数
+		uint32_t WaitingFences = 0;
+		//	今次のフレームを待っている数
+		uint32_t WaitingFrames = 0;
+		//	Update で再開した数の合計
+		uint64_t Resumed = 0;
+		//	Update を呼んだ回数
+		uint64_t Frames = 0;
+	};
+
+	/// <summary>
+	/// Task の中で co_await する待ちをまとめたもの
+	/// ワーカーへ移る・JobSystem の仕事を待つ・ファイルを読む（AsyncFileIO）は JobSystem のワーカーで続きを動かす。
+	/// GPU のフェンスと次のフレームは Update（ゲームスレッドでフレームに1回）で確かめ、ゲームスレッドで続きを動かす。
+	/// 待っている間はスレッドを止めないので、読み込みやストリーミングを上から順に書いても、ワーカーもゲームスレッドも空いたまま。
+	/// </summary>
+	class ENGINE_API TaskScheduler : public ServiceProvider<TaskScheduler>
+	{
+		ECSE_SERVICE_ACCESS(TaskScheduler);
+
+	public:
+		/// <summary>
+		/// JobSystem のワーカーへ移る（After があれば 0 になってから。既に 0 ならそのまま続ける）
+		/// </summary>
+		class JobAwaiter
+		{
+		public:
+			JobAwaiter(TaskScheduler& Scheduler, JobCounter* pAfter) noexcept
+				:mScheduler(Scheduler)
+				, mpAfter(pAfter)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return mpAfter != nullptr && mpAfter->IsDone();
+			}
+
+			bool await_suspend(std::coroutine_handle<> Handle)
+			{
+				return mScheduler.ResumeOnWorker(Handle, mpAfter);
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+
+		private:
+			TaskScheduler& mScheduler;
+			JobCounter* mpAfter;
+		};
+
+#if defined(_WIN32)
+		/// <summary>
+		/// GPU がフェンスの値に届くまで待つ（Update で再開する。DirectX12 のある Windows だけ）
+		/// </summary>
+		class FenceAwaiter
+		{
+		public:
+			FenceAwaiter(TaskScheduler& Scheduler, ID3D12Fence* pFence, uint64_t Value) noexcept
+				:mScheduler(Scheduler)
+				, mpFence(pFence)
+				, mValue(Value)
+			{
+			}
+
+			bool await_ready() const
+			{
+				return mpFence == nullptr || mpFence->GetCompletedValue() >= mValue;
+			}
+
+			void await_suspend(std::coroutine_handle<> Handle)
+			{
+				mScheduler.AddFenceWaiter(mpFence, mValue, Handle);
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+
+		private:
+			TaskScheduler& mScheduler;
+			ID3D12Fence* mpFence;
+			uint64_t mValue;
+		};
+#endif
+
+		/// <summary>
+		/// 次のフレームの Update まで待つ
+		/// </summary>
+		class FrameAwaiter
+		{
+		public:
+			explicit FrameAwaiter(TaskScheduler& Scheduler) noexcept
+				:mScheduler(Scheduler)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> Handle)
+			{
+				mScheduler.AddFrameWaiter(Handle);
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+
+		private:
+			TaskScheduler& mScheduler;
+		};
+
+	protected:
+		/// <summary>
+		/// 初期化（実質コンストラクタ）
+		/// </summary>
+		void OnCreate()override;
+
+		/// <summary>
+		/// 終了処理（実質デストラクタ）
+		/// </summary>
+		void OnDestroy()override;
+
+	public:
+		/// <summary>
+		/// JobSystem のワーカーへ移って続ける（JobSystem が無ければそのまま続ける）
+		/// </summary>
+		JobAwaiter Schedule();
+
+		/// <summary>
+		/// カウンターが 0 になってから、JobSystem のワーカーで続ける（既に 0 ならそのまま続ける）
+		/// </summary>
+		JobAwaiter WaitFor(JobCounter& Counter);
+
+		/// <summary>
+		/// ファイルを読み、読み終わったら JobSystem のワーカーで続ける
+		/// </summary>
+		/// <param name="File">AsyncFileIO で開いたファイル</param>
+		/// <param name="Buffer">書き込み先（読み終わるまで持っておく）</param>
+		/// <param name="Offset">ファイル先頭からの位置</param>
+		/// <param name="Priority">優先度</param>
+		/// <returns>読み込みの結果を返す待ち（受け付けられなければ Failed ですぐに続く）</returns>
+		CallbackAwaiter<AsyncReadCompletion> Read(AsyncFileHandle File, std::span<uint8_t> Buffer, uint64_t Offset = 0, EAsyncIOPriority Priority = EAsyncIOPriority::Normal);
+
+#if defined(_WIN32)
+		/// <summary>
+		/// GPU がフェンスの値に届いたら、ゲームスレッドの Update で続ける
+		/// </summary>
+		FenceAwaiter WaitForFence(ID3D12Fence* pFence, uint64_t Value);
+
+		/// <summary>
+		/// ここまでに DX12 が積んだ GPU の処理が終わったら、ゲームスレッドの Update で続ける（DX12 が無ければそのまま続ける）
+		/// </summary>
+		FenceAwaiter WaitForGPU();
+#endif
+
+		/// <summary>
+		/// 次のフレームの Update で続ける
+		/// </summary>
+		FrameAwaiter NextFrame();
+
+		/// <summary>
+		/// フェンスに届いたものと、次のフレームを待っていたものを再開する（ゲームスレッドでフレームに1回）
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// 直近までの待ちの数
+		/// </summary>
+		TaskSchedulerStats GetStats() const;
+
+	private:
+#if defined(_WIN32)
+		/// <summary>
+		/// GPU のフェンスを待っているもの
+		/// </summary>
+		struct FenceWaiter
+		{
+			//	フェンス
+			ID3D12Fence* pFence = nullptr;
+			//	届いてほしい値
+			uint64_t Value = 0;
+			//	続き
+			std::coroutine_handle<> Handle;
+		};
+#endif
+
+		/// <summary>
+		/// JobSystem のワーカーで続きを動かす
+		/// </summary>
+		/// <returns>true:止まる（JobSystem が無ければ false でそのまま続ける）</returns>
+		bool ResumeOnWorker(std::coroutine_handle<> Handle, JobCounter* pAfter);
+
+#if defined(_WIN32)
+		/// <summary>
+		/// フェンスの待ちを加える
+		/// </summary>
+		void AddFenceWaiter(ID3D12Fence* pFence, uint64_t Value, std::coroutine_handle<> Handle);
+#endif
+
+		/// <summary>
+		/// 次のフレームの待ちを加える
+		/// </summary>
+		void AddFrameWaiter(std::coroutine_handle<> Handle);
+
+	private:
+		/// <summary>
+		/// mFenceWaiters と mFrameWaiters を守る
+		/// </summary>
+		mutable std::mutex mMutex;
+#if defined(_WIN32)
+		/// <summary>
+		/// GPU のフェンスを待っているもの
+		/// </summary>
+		std::vector<FenceWaiter> mFenceWaiters;
+#endif
+		/// <summary>
+		/// 次のフレームを待っているもの
+		/// </summary>
+		std::vector<std::coroutine_handle<>> mFrameWaiters;
+		/// <summary>
+		/// Update で再開するもの（毎フレーム確保しないように使い回す）
+		/// </summary>
+		std::vector<std::coroutine_handle<>> mResumes;
+		/// <summary>
+		/// Update で再開した数の合計
+		/// </summary>
+		uint64_t mResumedCount;
+		/// <summary>
+		/// Update を呼んだ回数
+		/// </summary>
+		uint64_t mFrameCount;
+	};
+}
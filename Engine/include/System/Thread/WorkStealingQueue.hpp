@@ -0,0 +1,174 @@
+﻿#pragma once
+
+#include<atomic>
+#include<cstdint>
+#include<memory>
+#include<type_traits>
+#include<vector>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// Chase-Lev の盗めるキュー
+	/// 持ち主のスレッドだけが後ろへ積み（Push）後ろから取り（Pop）、他のスレッドは前から盗む（Steal）。
+	/// 持ち主の出し入れはほぼ普通の読み書きで済み、取り合いになるのは最後の1つだけ。
+	/// 満杯になったら倍の大きさへ移す。盗んでいる途中のスレッドが古い配列を読むかもしれないので、古い配列は破棄まで残す。
+	/// メモリの順序は Lê らの "Correct and Efficient Work-Stealing for Weak Memory Models" に従う。
+	/// </summary>
+	template<typename T>
+	class WorkStealingQueue
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
+
+	public:
+		/// <param name="Capacity">最初の大きさ（2の累乗）</param>
+		explicit WorkStealingQueue(int64_t Capacity = 1024)
+			:mTop(0)
+			, mBottom(0)
+			, mBuffer(nullptr)
+			, mBuffers()
+		{
+			mBuffers.push_back(std::make_unique<Buffer>(Capacity));
+			mBuffer.store(mBuffers.back().get(), std::memory_order_relaxed);
+		}
+
+		WorkStealingQueue(const WorkStealingQueue&) = delete;
+		WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+		/// <summary>
+		/// 後ろへ積む（持ち主だけ）
+		/// </summary>
+		void Push(T Item)
+		{
+			const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+			const int64_t top = mTop.load(std::memory_order_acquire);
+			Buffer* pBuffer = mBuffer.load(std::memory_order_relaxed);
+			if (bottom - top > pBuffer->Capacity - 1)
+			{
+				pBuffer = Grow(pBuffer, top, bottom);
+			}
+			pBuffer->Put(bottom, Item);
+			std::atomic_thread_fence(std::memory_order_release);
+			mBottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// 後ろから取る（持ち主だけ）
+		/// </summary>
+		/// <returns>true:取れた</returns>
+		bool Pop(T& OutItem)
+		{
+			const int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+			Buffer* pBuffer = mBuffer.load(std::memory_order_relaxed);
+			mBottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = mTop.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				//	空だった
+				mBottom.store(bottom + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			OutItem = pBuffer->Get(bottom);
+			if (top == bottom)
+			{
+				//	最後の1つは盗みに来たスレッドと取り合う
+				const bool isWon = mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				mBottom.store(bottom + 1, std::memory_order_relaxed);
+				return isWon;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// 前から盗む（どのスレッドからでも）
+		/// </summary>
+		/// <returns>true:盗めた（空か、他のスレッドに先を越されたら false）</returns>
+		bool Steal(T& OutItem)
+		{
+			int64_t top = mTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t bottom = mBottom.load(std::memory_order_acquire);
+			if (top >= bottom) return false;
+
+			const Buffer* pBuffer = mBuffer.load(std::memory_order_acquire);
+			const T item = pBuffer->Get(top);
+			if (mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false) return false;
+			OutItem = item;
+			return true;
+		}
+
+		/// <summary>
+		/// 大体の数（他のスレッドが出し入れしている間は目安）
+		/// </summary>
+		int64_t GetSize() const
+		{
+			const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+			const int64_t top = mTop.load(std::memory_order_relaxed);
+			return bottom > top ? bottom - top : 0;
+		}
+
+	private:
+		/// <summary>
+		/// 輪になった配列
+		/// </summary>
+		struct Buffer
+		{
+			int64_t Capacity;
+			int64_t Mask;
+			std::unique_ptr<std::atomic<T>[]> Items;
+
+			explicit Buffer(int64_t InCapacity)
+				:Capacity(InCapacity)
+				, Mask(InCapacity - 1)
+				, Items(std::make_unique<std::atomic<T>[]>(static_cast<size_t>(InCapacity)))
+			{
+			}
+
+			T Get(int64_t Index) const
+			{
+				return Items[static_cast<size_t>(Index & Mask)].load(std::memory_order_relaxed);
+			}
+
+			void Put(int64_t Index, T Item)
+			{
+				Items[static_cast<size_t>(Index & Mask)].store(Item, std::memory_order_relaxed);
+			}
+		};
+
+		/// <summary>
+		/// 倍の大きさの配列へ移す（持ち主だけ）
+		/// </summary>
+		Buffer* Grow(Buffer* pOld, int64_t Top, int64_t Bottom)
+		{
+			mBuffers.push_back(std::make_unique<Buffer>(pOld->Capacity * 2));
+			Buffer* pBuffer = mBuffers.back().get();
+			for (int64_t i = Top; i < Bottom; ++i)
+			{
+				pBuffer->Put(i, pOld->Get(i));
+			}
+			mBuffer.store(pBuffer, std::memory_order_release);
+			return pBuffer;
+		}
+
+	private:
+		/// <summary>
+		/// 盗む側が進める前の位置（持ち主と別のキャッシュラインに置く）
+		/// </summary>
+		alignas(64) std::atomic<int64_t> mTop;
+		/// <summary>
+		/// 持ち主が進める後ろの位置
+		/// </summary>
+		alignas(64) std::atomic<int64_t> mBottom;
+		/// <summary>
+		/// 今の配列
+		/// </summary>
+		alignas(64) std::atomic<Buffer*> mBuffer;
+		/// <summary>
+		/// 今までの全ての配列（盗んでいる途中のスレッドのために残す。持ち主だけが触る）
+		/// </summary>
+		std::vector<std::unique_ptr<Buffer>> mBuffers;
+	};
+}
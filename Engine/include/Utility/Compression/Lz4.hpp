@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstddef>
+#include<cstdint>
+
+namespace Ecse::Utility
+{
+	/// <summary>
+	/// Lz4Compress が最悪の場合に書く大きさ（圧縮できないデータでもこれを超えない）
+	/// </summary>
+	/// <param name="Size">元の大きさ（バイト）</param>
+	constexpr size_t Lz4CompressBound(size_t Size)
+	{
+		return Size + Size / 255 + 16;
+	}
+
+	/// <summary>
+	/// LZ4 のブロック形式で圧縮する（フレームのヘッダーは付けない）
+	/// 4 バイトのハッシュで直前 64KB から一致を探す貪欲な作り方で、圧縮率より速さを優先する。
+	/// 出力は公式の LZ4 で展開できる。
+	/// </summary>
+	/// <param name="Source">元のデータ</param>
+	/// <param name="SourceSize">元の大きさ（バイト）</param>
+	/// <param name="Destination">書き込み先</param>
+	/// <param name="Capacity">書き込み先の大きさ（Lz4CompressBound 以上なら必ず収まる）</param>
+	/// <returns>書いた大きさ（収まらなければ 0）</returns>
+	ENGINE_API size_t Lz4Compress(const void* Source, size_t SourceSize, void* Destination, size_t Capacity);
+
+	/// <summary>
+	/// LZ4 のブロック形式を展開する
+	/// 壊れたデータでも書き込み先の外には触れない。
+	/// </summary>
+	/// <param name="Source">圧縮したデータ</param>
+	/// <param name="SourceSize">圧縮したデータの大きさ（バイト）</param>
+	/// <param name="Destination">書き込み先</param>
+	/// <param name="DestinationSize">展開後の大きさ（ちょうどこの大きさにならなければ失敗）</param>
+	/// <returns>true:成功</returns>
+	ENGINE_API bool Lz4Decompress(const void* Source, size_t SourceSize, void* Destination, size_t DestinationSize);
+}
@@ -0,0 +1,23 @@
+﻿#pragma once
+
+/*
+* std::format を使うためのヘッダー
+* <format> の無い標準ライブラリ（GCC 12 など）では、spdlog に同梱の fmt を std の同じ名前で使う。
+* エンジンで使う format / vformat / make_format_args / format_error だけを置く。
+*/
+#if __has_include(<format>)
+#include<format>
+#else
+#ifndef FMT_HEADER_ONLY
+#define FMT_HEADER_ONLY
+#endif
+#include<spdlog/fmt/bundled/format.h>
+
+namespace std
+{
+	using fmt::format;
+	using fmt::vformat;
+	using fmt::make_format_args;
+	using fmt::format_error;
+}
+#endif
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+#include<cstddef>
+#include<cstdint>
+#include<span>
+#include<string_view>
+
+namespace Ecse::Utility
+{
+	/// <summary>
+	/// 中身から求める 64bit のハッシュ（XXH64 と同じ値）
+	/// 暗号用ではない。派生データのキャッシュのキーなど、大きなデータを速く区別したい時に使う。
+	/// </summary>
+	/// <param name="Data">先頭</param>
+	/// <param name="Size">大きさ（バイト）</param>
+	/// <param name="Seed">種（同じデータから別のハッシュが欲しい時に変える）</param>
+	ENGINE_API uint64_t Hash64(const void* Data, size_t Size, uint64_t Seed = 0);
+
+	/// <summary>
+	/// バイト列のハッシュ
+	/// </summary>
+	inline uint64_t Hash64(std::span<const uint8_t> Bytes, uint64_t Seed = 0)
+	{
+		return Hash64(Bytes.data(), Bytes.size(), Seed);
+	}
+
+	/// <summary>
+	/// 文字列のハッシュ
+	/// </summary>
+	inline uint64_t Hash64(std::string_view Text, uint64_t Seed = 0)
+	{
+		return Hash64(Text.data(), Text.size(), Seed);
+	}
+}
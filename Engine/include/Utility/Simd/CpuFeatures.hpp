@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include<Utility/Export/Export.hpp>
+
+/*
+* 実行時のCPU拡張命令の判定と、関数単位で拡張命令を有効にする指定
+* MSVC はそのまま組み込み関数を使えるので何もしない。
+*/
+#if defined(_MSC_VER)
+#define ECSE_TARGET_AVX
+#define ECSE_TARGET_AVX2
+#else
+#define ECSE_TARGET_AVX __attribute__((target("avx")))
+#define ECSE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+namespace Ecse::Utility
+{
+	/// <summary>
+	/// 使用できる拡張命令
+	/// </summary>
+	struct CpuFeatures
+	{
+		//	SSE4.1
+		bool Sse41 = false;
+		//	AVX（OSが YMM レジスタを保存する場合のみ true）
+		bool Avx = false;
+		//	AVX2
+		bool Avx2 = false;
+		//	FMA3
+		bool Fma = false;
+	};
+
+	/// <summary>
+	/// 実行中のCPUの拡張命令（初回呼び出し時に判定して以降は使い回す）
+	/// </summary>
+	ENGINE_API const CpuFeatures& GetCpuFeatures();
+}
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+//	DirectX12 の型の別名（Windows の時だけ）
+#if defined(_WIN32)
 #include<d3d12.h>
 #include <dxgi1_6.h>
 #include <wrl.h>
@@ -26,6 +28,8 @@ namespace Ecse
 	using RootSig = ComPtr<ID3D12RootSignature>;
 	using PSO = ComPtr<ID3D12PipelineState>;
 	using Blob = ComPtr<ID3DBlob>;
+	using QueryHeap = ComPtr<ID3D12QueryHeap>;
+	using CmdSignature = ComPtr<ID3D12CommandSignature>;
 
 	// 同期デバッグ
 	using Fence = ComPtr<ID3D12Fence>;
@@ -34,4 +38,5 @@ namespace Ecse
 	//	デバック
 	using DebugDevice = ComPtr<ID3D12DebugDevice2>;
 	using InfoQueue = ComPtr<ID3D12InfoQueue1>;
-}
\ No newline at end of file
+}
+#endif
@@ -18,13 +18,20 @@ namespace Ecse::Debug
     {
     }
 
-    ImGuiManager::~ImGuiManager() = default;
+    ImGuiManager::~ImGuiManager()
+    {
+        for (auto& snapshot : mSnapshots)
+        {
+            ClearSnapshot(snapshot);
+        }
+    }
 
     /// <summary>
     /// 初期化
     /// </summary>
+    /// <param name="EnableViewports">マルチビューポートを有効にするか（描画スレッド使用時は無効にする）</param>
     /// <returns>true:成功</returns>
-    bool ImGuiManager::Initialize()
+    bool ImGuiManager::Initialize(bool EnableViewports)
     {
         //  必要なパーツを全て取得
         auto dx12 = System::ServiceLocator::Get<Graphics::DX12>();
@@ -48,7 +55,11 @@ namespace Ecse::Debug
         ImGuiIO& io = ImGui::GetIO();
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard; // キーボード操作有効
         io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;      // ドッキング有効
-        io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;    // マルチビューポート有効
+        //  ビューポートの描画はメインスレッドのキュー操作になるので描画スレッドとは併用しない
+        if (EnableViewports == true)
+        {
+            io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;    // マルチビューポート有効
+        }
 
         // スタイル設定
         ImGui::StyleColorsDark();
@@ -121,6 +132,69 @@ namespace Ecse::Debug
         //  描画データの作成
         ImGui::Render();
 
+        RecordDrawData(ImGui::GetDrawData());
+
+        if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+        {
+            ImGui::UpdatePlatformWindows();
+            ImGui::RenderPlatformWindowsDefault();
+        }
+
+    }
+
+    /// <summary>
+    /// 描画データを確定してスナップショットへ複製する（ゲームスレッド）
+    /// </summary>
+    /// <param name="Slot">書き込むスナップショット番号</param>
+    void ImGuiManager::CaptureDrawData(uint32_t Slot)
+    {
+        ImGui::Render();
+        ImDrawData* source = ImGui::GetDrawData();
+
+        //  テクスチャの更新はImGuiのコンテキストを触るのでこちらのスレッドで済ませる
+        if (source->Textures != nullptr)
+        {
+            for (ImTextureData* tex : *source->Textures)
+            {
+                if (tex->Status != ImTextureStatus_OK) ImGui_ImplDX12_UpdateTexture(tex);
+            }
+        }
+
+        //  次の NewFrame で中身が破棄されるのでリストごと複製する
+        ImDrawData& snapshot = mSnapshots[Slot];
+        ClearSnapshot(snapshot);
+        snapshot.Valid = source->Valid;
+        snapshot.TotalIdxCount = source->TotalIdxCount;
+        snapshot.TotalVtxCount = source->TotalVtxCount;
+        snapshot.DisplayPos = source->DisplayPos;
+        snapshot.DisplaySize = source->DisplaySize;
+        snapshot.FramebufferScale = source->FramebufferScale;
+        snapshot.OwnerViewport = source->OwnerViewport;
+        snapshot.Textures = nullptr;
+        for (ImDrawList* list : source->CmdLists)
+        {
+            snapshot.CmdLists.push_back(list->CloneOutput());
+        }
+        snapshot.CmdListsCount = snapshot.CmdLists.Size;
+    }
+
+    /// <summary>
+    /// 複製済みの描画データを記録する（描画スレッド）
+    /// </summary>
+    /// <param name="Slot">読み込むスナップショット番号</param>
+    void ImGuiManager::RenderCapturedDrawData(uint32_t Slot)
+    {
+        ImDrawData& snapshot = mSnapshots[Slot];
+        if (snapshot.Valid == false) return;
+
+        RecordDrawData(&snapshot);
+    }
+
+    /// <summary>
+    /// 描画データをフレームのコマンドリストに記録
+    /// </summary>
+    void ImGuiManager::RecordDrawData(ImDrawData* DrawData)
+    {
         auto dx12 = System::ServiceLocator::Get<Graphics::DX12>();
         auto gdhManager = System::ServiceLocator::Get<Graphics::GDescriptorHeapManager>();
 
@@ -132,14 +206,19 @@ namespace Ecse::Debug
         ID3D12DescriptorHeap* heaps[] = { gdhManager->GetNativeHeap() };
         cmdList->SetDescriptorHeaps(_countof(heaps), heaps);
 
-        ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), cmdList);
+        ImGui_ImplDX12_RenderDrawData(DrawData, cmdList);
+    }
 
-        if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+    /// <summary>
+    /// スナップショットが持っている複製の破棄
+    /// </summary>
+    void ImGuiManager::ClearSnapshot(ImDrawData& Snapshot)
+    {
+        for (ImDrawList* list : Snapshot.CmdLists)
         {
-            ImGui::UpdatePlatformWindows();
-            ImGui::RenderPlatformWindowsDefault();
+            IM_DELETE(list);
         }
-
+        Snapshot.Clear();
     }
 
     /// <summary>
@@ -149,6 +228,12 @@ namespace Ecse::Debug
     {
         if (mIsInitialized == false)return;
 
+        //  複製した描画データを先に破棄
+        for (auto& snapshot : mSnapshots)
+        {
+            ClearSnapshot(snapshot);
+        }
+
         //  バックエンドの終了
         ImGui_ImplDX12_Shutdown();
         ImGui_ImplWin32_Shutdown();
@@ -0,0 +1,274 @@
+﻿#include "pch.h"
+#include<Debug/Profiler/ProfileTree.hpp>
+
+namespace Ecse::Debug
+{
+	ProfileScopeRecorder::ProfileScopeRecorder()
+		:mScopes()
+		, mStack()
+		, mMaxScopes(0)
+		, mDroppedCount(0)
+	{
+	}
+
+	/// <summary>
+	/// 記録できる区間数の設定
+	/// </summary>
+	/// <param name="MaxScopes">1フレームの最大区間数</param>
+	void ProfileScopeRecorder::Reserve(uint32_t MaxScopes)
+	{
+		mMaxScopes = MaxScopes;
+		mScopes.reserve(MaxScopes);
+		mStack.reserve(MaxScopes);
+	}
+
+	/// <summary>
+	/// 記録の破棄
+	/// </summary>
+	void ProfileScopeRecorder::Reset()
+	{
+		mScopes.clear();
+		mStack.clear();
+		mDroppedCount = 0;
+	}
+
+	/// <summary>
+	/// 区間の開始
+	/// </summary>
+	/// <param name="Name">区間名</param>
+	/// <returns>開始タイムスタンプの書き込み先 INVALID_INDEX:上限超過</returns>
+	uint32_t ProfileScopeRecorder::Begin(const char* Name)
+	{
+		//	上限超過でも End と対応させるためにスタックには積む
+		if (mScopes.size() >= mMaxScopes)
+		{
+			mStack.push_back(INVALID_INDEX);
+			mDroppedCount++;
+			return INVALID_INDEX;
+		}
+
+		//	親は開いている区間のうち有効な一番内側
+		int32_t parent = -1;
+		for (auto it = mStack.rbegin(); it != mStack.rend(); ++it)
+		{
+			if (*it == INVALID_INDEX) continue;
+			parent = static_cast<int32_t>(*it);
+			break;
+		}
+
+		const uint32_t index = static_cast<uint32_t>(mScopes.size());
+		mScopes.push_back({ Name, parent, static_cast<uint32_t>(mStack.size()) });
+		mStack.push_back(index);
+		return index * 2;
+	}
+
+	/// <summary>
+	/// 直近に開始した区間の終了
+	/// </summary>
+	/// <returns>終了タイムスタンプの書き込み先 INVALID_INDEX:上限超過or対応する開始がない</returns>
+	uint32_t ProfileScopeRecorder::End()
+	{
+		if (mStack.empty()) return INVALID_INDEX;
+
+		const uint32_t index = mStack.back();
+		mStack.pop_back();
+		if (index == INVALID_INDEX) return INVALID_INDEX;
+
+		return index * 2 + 1;
+	}
+
+	/// <summary>
+	/// 記録された区間の取得
+	/// </summary>
+	std::span<const ProfileScope> ProfileScopeRecorder::GetScopes() const
+	{
+		return mScopes;
+	}
+
+	/// <summary>
+	/// 解決が必要なタイムスタンプの数
+	/// </summary>
+	uint32_t ProfileScopeRecorder::GetTimestampCount() const
+	{
+		return static_cast<uint32_t>(mScopes.size()) * 2;
+	}
+
+	/// <summary>
+	/// 開始と終了の対応がとれているかどうか
+	/// </summary>
+	/// <returns>true:全て閉じている</returns>
+	bool ProfileScopeRecorder::IsBalanced() const
+	{
+		return mStack.empty();
+	}
+
+	/// <summary>
+	/// 上限超過で捨てた区間数
+	/// </summary>
+	uint32_t ProfileScopeRecorder::GetDroppedCount() const
+	{
+		return mDroppedCount;
+	}
+
+	ProfileTree::ProfileTree()
+		:mNodes()
+		, mFirstRoot(-1)
+	{
+	}
+
+	/// <summary>
+	/// 全ノードの破棄
+	/// </summary>
+	void ProfileTree::Clear()
+	{
+		mNodes.clear();
+		mFirstRoot = -1;
+	}
+
+	/// <summary>
+	/// CPU区間の結果を追加
+	/// </summary>
+	void ProfileTree::AddCpu(std::span<const ProfileScope> Scopes, std::span<const uint64_t> Ticks, uint64_t Frequency)
+	{
+		Merge(Scopes, Ticks, Frequency, false);
+	}
+
+	/// <summary>
+	/// GPU区間の結果を追加
+	/// </summary>
+	void ProfileTree::AddGpu(std::span<const ProfileScope> Scopes, std::span<const uint64_t> Ticks, uint64_t Frequency)
+	{
+		Merge(Scopes, Ticks, Frequency, true);
+	}
+
+	/// <summary>
+	/// ノードの取得
+	/// </summary>
+	std::span<const ProfileNode> ProfileTree::GetNodes() const
+	{
+		return mNodes;
+	}
+
+	/// <summary>
+	/// 最初のルートノード（-1:空）
+	/// </summary>
+	int32_t ProfileTree::GetFirstRoot() const
+	{
+		return mFirstRoot;
+	}
+
+	/// <summary>
+	/// 名前の経路でノードを検索
+	/// </summary>
+	const ProfileNode* ProfileTree::Find(std::initializer_list<std::string_view> Path) const
+	{
+		int32_t current = mFirstRoot;
+		const ProfileNode* found = nullptr;
+
+		for (auto name : Path)
+		{
+			found = nullptr;
+			for (int32_t i = current; i >= 0; i = mNodes[i].NextSibling)
+			{
+				if (mNodes[i].Name != name) continue;
+				found = &mNodes[i];
+				break;
+			}
+			if (found == nullptr) return nullptr;
+			current = found->FirstChild;
+		}
+
+		return found;
+	}
+
+	/// <summary>
+	/// CPU・GPU共通のマージ処理
+	/// </summary>
+	void ProfileTree::Merge(std::span<const ProfileScope> Scopes, std::span<const uint64_t> Ticks, uint64_t Frequency, bool IsGpu)
+	{
+		if (Scopes.empty() || Frequency == 0) return;
+
+		//	フレーム先頭は最初に開始した区間
+		uint64_t base = UINT64_MAX;
+		for (size_t i = 0; i < Scopes.size() && i * 2 < Ticks.size(); ++i)
+		{
+			base = (std::min)(base, Ticks[i * 2]);
+		}
+		if (base == UINT64_MAX) return;
+
+		const double toMs = 1000.0 / static_cast<double>(Frequency);
+
+		//	区間番号からノード番号への対応（親は必ず先に出てくる）
+		std::vector<int32_t> scopeToNode(Scopes.size(), -1);
+
+		for (size_t i = 0; i < Scopes.size(); ++i)
+		{
+			//	タイムスタンプが足りない区間は捨てる
+			if (i * 2 + 1 >= Ticks.size()) break;
+
+			const ProfileScope& scope = Scopes[i];
+			const int32_t parent = scope.Parent >= 0 ? scopeToNode[scope.Parent] : -1;
+			const int32_t nodeIndex = FindOrAddChild(parent, scope.Name, scope.Depth);
+			scopeToNode[i] = nodeIndex;
+
+			//	GPUはキューをまたぐと逆転することがあるので0に丸める
+			const uint64_t begin = Ticks[i * 2];
+			const uint64_t end = Ticks[i * 2 + 1];
+			const double start = static_cast<double>(begin - base) * toMs;
+			const double duration = end > begin ? static_cast<double>(end - begin) * toMs : 0.0;
+
+			ProfileNode& node = mNodes[nodeIndex];
+			double& nodeStart = IsGpu ? node.GpuStartMs : node.CpuStartMs;
+			double& nodeMs = IsGpu ? node.GpuMs : node.CpuMs;
+			uint32_t& calls = IsGpu ? node.GpuCalls : node.CpuCalls;
+
+			//	同じ階層で複数回呼ばれた区間は合計する
+			if (calls == 0)
+			{
+				nodeStart = start;
+				nodeMs = duration;
+			}
+			else
+			{
+				nodeStart = (std::min)(nodeStart, start);
+				nodeMs += duration;
+			}
+			calls++;
+		}
+	}
+
+	/// <summary>
+	/// 親の下から同名の子を探して、なければ追加
+	/// </summary>
+	int32_t ProfileTree::FindOrAddChild(int32_t Parent, const char* Name, uint32_t Depth)
+	{
+		int32_t* link = Parent >= 0 ? &mNodes[Parent].FirstChild : &mFirstRoot;
+
+		//	兄弟を順に見て同名があればそれを使う。なければ末尾に繋ぐ
+		while (*link >= 0)
+		{
+			if (mNodes[*link].Name == Name) return *link;
+			link = &mNodes[*link].NextSibling;
+		}
+
+		const int32_t index = static_cast<int32_t>(mNodes.size());
+		*link = index;
+
+		ProfileNode node = {};
+		node.Name = Name;
+		node.Parent = Parent;
+		node.FirstChild = -1;
+		node.NextSibling = -1;
+		node.Depth = Depth;
+		node.CpuStartMs = -1.0;
+		node.CpuMs = -1.0;
+		node.GpuStartMs = -1.0;
+		node.GpuMs = -1.0;
+		node.CpuCalls = 0;
+		node.GpuCalls = 0;
+
+		//	push_back で再確保されると link が無効になるので先に繋いでおく
+		mNodes.push_back(std::move(node));
+		return index;
+	}
+}
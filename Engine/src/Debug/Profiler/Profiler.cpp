@@ -0,0 +1,503 @@
+﻿#include "pch.h"
+#include<Debug/Profiler/Profiler.hpp>
+#include<Debug/ImGui/ImGuiManager.hpp>
+
+namespace Ecse::Debug
+{
+	namespace
+	{
+		/// <summary>
+		/// 1枠あたりのクエリ数
+		/// </summary>
+		constexpr UINT QUERIES_PER_FRAME = Profiler::MAX_SCOPES * 2;
+
+		/// <summary>
+		/// CPUのタイムスタンプ（ナノ秒）
+		/// </summary>
+		uint64_t GetCpuTicks()
+		{
+			using namespace std::chrono;
+			return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+		}
+
+		/// <summary>
+		/// CPUのタイムスタンプ周波数
+		/// </summary>
+		constexpr uint64_t CPU_FREQUENCY = 1000000000ull;
+
+		/// <summary>
+		/// 名前を付けていないスレッドの表示名
+		/// </summary>
+		constexpr const char* DEFAULT_THREAD_NAME = "Worker";
+
+		/// <summary>
+		/// スレッドごとの記録の状態
+		/// </summary>
+		struct ThreadState
+		{
+			//	Profiler の中でのスレッドの番号（UINT32_MAX:まだ割り当てていない）
+			uint32_t Index = UINT32_MAX;
+			//	一番外の区間を開いた時の枠（閉じるまで同じ枠に書く）
+			UINT Slot = 0;
+			//	開いている区間の数
+			uint32_t Depth = 0;
+		};
+
+		thread_local ThreadState tThreadState;
+
+		/// <summary>
+		/// 割り当てたスレッドの番号の数
+		/// </summary>
+		std::atomic<uint32_t> sThreadCount = 0;
+
+		/// <summary>
+		/// 呼び出したスレッドの状態（初めて呼ばれた時に番号を割り当てる）
+		/// </summary>
+		ThreadState& GetThreadState()
+		{
+			if (tThreadState.Index == UINT32_MAX)
+			{
+				tThreadState.Index = sThreadCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			return tThreadState;
+		}
+
+		/// <summary>
+		/// 記録したことのあるスレッドの数
+		/// </summary>
+		uint32_t GetUsedThreadCount()
+		{
+			return (std::min)(sThreadCount.load(std::memory_order_relaxed), Profiler::MAX_THREADS);
+		}
+
+		/// <summary>
+		/// 計測ツリーの1ノードを表として表示
+		/// </summary>
+		void DrawNode(const ProfileTree& Tree, int32_t Index)
+		{
+			auto nodes = Tree.GetNodes();
+			for (int32_t i = Index; i >= 0; i = nodes[i].NextSibling)
+			{
+				const ProfileNode& node = nodes[i];
+
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+
+				ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+				if (node.FirstChild < 0) flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+
+				ImGui::PushID(i);
+				const bool isOpen = ImGui::TreeNodeEx(node.Name.c_str(), flags);
+
+				ImGui::TableSetColumnIndex(1);
+				if (node.CpuCalls > 0) ImGui::Text("%.3f", node.CpuMs);
+				else ImGui::TextDisabled("-");
+
+				ImGui::TableSetColumnIndex(2);
+				if (node.GpuCalls > 0) ImGui::Text("%.3f", node.GpuMs);
+				else ImGui::TextDisabled("-");
+
+				if (isOpen && node.FirstChild >= 0)
+				{
+					DrawNode(Tree, node.FirstChild);
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+		}
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void Profiler::OnCreate()
+	{
+		mQueryHeap = nullptr;
+		mReadback = nullptr;
+		mGpuFrequency = 0;
+		for (auto& name : mThreadNames)
+		{
+			name.store(nullptr, std::memory_order_relaxed);
+		}
+		mFrameIndex.store(0, std::memory_order_relaxed);
+		mpCmdList = nullptr;
+		mFrameThread.store(std::thread::id());
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void Profiler::OnDestroy()
+	{
+		mReadback.Reset();
+		mQueryHeap.Reset();
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="Device">クエリヒープと読み戻しバッファを作るデバイス</param>
+	/// <param name="Queue">タイムスタンプ周波数の取得元</param>
+	/// <returns>true:成功</returns>
+	bool Profiler::Initialize(ID3D12Device* Device, ID3D12CommandQueue* Queue)
+	{
+		if (Device == nullptr || Queue == nullptr) return false;
+
+		constexpr UINT queryCount = QUERIES_PER_FRAME * Graphics::DX12::FRAME_COUNT;
+
+		//	タイムスタンプ用クエリヒープ
+		D3D12_QUERY_HEAP_DESC heapDesc = {};
+		heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		heapDesc.Count = queryCount;
+		heapDesc.NodeMask = 0;
+		HRESULT hr = Device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&mQueryHeap));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Profiler: Failed CreateQueryHeap.");
+			return false;
+		}
+
+		//	CPUから読むための読み戻しバッファ
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_READBACK;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC bufferDesc = {};
+		bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		bufferDesc.Width = static_cast<UINT64>(queryCount) * sizeof(UINT64);
+		bufferDesc.Height = 1;
+		bufferDesc.DepthOrArraySize = 1;
+		bufferDesc.MipLevels = 1;
+		bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+		bufferDesc.SampleDesc.Count = 1;
+		bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+		hr = Device->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&mReadback)
+		);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Profiler: Failed CreateReadbackBuffer.");
+			return false;
+		}
+
+		//	GPUのTickを時間に直すための周波数
+		if (FAILED(Queue->GetTimestampFrequency(&mGpuFrequency)))
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "Profiler: GetTimestampFrequency failed. GPU timing disabled.");
+			mGpuFrequency = 0;
+		}
+
+		//	CPU区間はスレッドが初めて書く時に確保する
+		for (auto& slot : mSlots)
+		{
+			slot.Gpu.Reserve(MAX_SCOPES);
+			slot.FrameThread = MAX_THREADS;
+			slot.IsPending = false;
+		}
+
+#if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
+		if (auto imgui = System::ServiceLocator::Get<ImGuiManager>())
+		{
+			imgui->AddDebugUI([this]() { DrawDebugUI(); });
+		}
+#endif
+
+		mIsInitialized = true;
+		return true;
+	}
+
+	/// <summary>
+	/// フレームの開始
+	/// </summary>
+	/// <param name="FrameIndex">DX12のフレームインデックス</param>
+	/// <param name="CmdList">記録中のコマンドリスト</param>
+	void Profiler::BeginFrame(UINT FrameIndex, ID3D12GraphicsCommandList* CmdList)
+	{
+		if (mIsInitialized == false) return;
+
+		//	フェンス待ち済みなので、この枠の前回分はGPUで完了している
+		ResolveSlot(FrameIndex);
+
+		FrameSlot& slot = mSlots[FrameIndex];
+		slot.Gpu.Reset();
+		const uint32_t threadCount = GetUsedThreadCount();
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			std::lock_guard<std::mutex> lock(slot.Threads[i].Mutex);
+			slot.Threads[i].Cpu.Reset();
+		}
+		slot.FrameThread = GetThreadState().Index;
+		slot.IsPending = false;
+
+		//	他のスレッドはここから新しい枠に書く
+		mFrameIndex.store(FrameIndex, std::memory_order_release);
+		mpCmdList = CmdList;
+		mFrameThread.store(std::this_thread::get_id(), std::memory_order_release);
+
+		BeginCpuScope("Frame");
+		BeginGpuScope("Frame");
+	}
+
+	/// <summary>
+	/// フレームの終了。クエリを読み戻しバッファへ解決する命令を積む
+	/// </summary>
+	/// <param name="CmdList">記録中のコマンドリスト（Close前）</param>
+	void Profiler::EndFrame(ID3D12GraphicsCommandList* CmdList)
+	{
+		if (mIsInitialized == false || mpCmdList == nullptr) return;
+
+		EndGpuScope(CmdList);
+		EndCpuScope();
+
+		const UINT frameIndex = mFrameIndex.load(std::memory_order_relaxed);
+		FrameSlot& slot = mSlots[frameIndex];
+
+		//	他のスレッドは区間を開いたままでもよい（閉じるまで同じ枠に書く）
+		bool isBalanced = slot.Gpu.IsBalanced();
+		if (slot.FrameThread < MAX_THREADS)
+		{
+			std::lock_guard<std::mutex> lock(slot.Threads[slot.FrameThread].Mutex);
+			isBalanced = isBalanced && slot.Threads[slot.FrameThread].Cpu.IsBalanced();
+		}
+		if (isBalanced == false)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "Profiler: Unbalanced scope in frame.");
+		}
+
+		const UINT count = slot.Gpu.GetTimestampCount();
+		if (count > 0)
+		{
+			const UINT base = frameIndex * QUERIES_PER_FRAME;
+			CmdList->ResolveQueryData(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, base, count, mReadback.Get(), static_cast<UINT64>(base) * sizeof(UINT64));
+		}
+
+		slot.IsPending = true;
+		mpCmdList = nullptr;
+		mFrameThread.store(std::thread::id(), std::memory_order_release);
+	}
+
+	/// <summary>
+	/// CPU区間の開始
+	/// </summary>
+	void Profiler::BeginCpuScope(const char* Name)
+	{
+		if (mIsInitialized == false) return;
+
+		ThreadScopes* pScopes = GetThreadScopes(true);
+		if (pScopes == nullptr) return;
+
+		std::lock_guard<std::mutex> lock(pScopes->Mutex);
+		if (pScopes->Ticks.empty())
+		{
+			pScopes->Cpu.Reserve(MAX_SCOPES);
+			pScopes->Ticks.assign(QUERIES_PER_FRAME, 0);
+		}
+		const uint32_t index = pScopes->Cpu.Begin(Name);
+		if (index == ProfileScopeRecorder::INVALID_INDEX) return;
+		pScopes->Ticks[index] = GetCpuTicks();
+	}
+
+	/// <summary>
+	/// CPU区間の終了
+	/// </summary>
+	void Profiler::EndCpuScope()
+	{
+		if (mIsInitialized == false) return;
+
+		const uint64_t ticks = GetCpuTicks();
+		ThreadScopes* pScopes = GetThreadScopes(false);
+		if (pScopes == nullptr) return;
+
+		std::lock_guard<std::mutex> lock(pScopes->Mutex);
+		const uint32_t index = pScopes->Cpu.End();
+		if (index == ProfileScopeRecorder::INVALID_INDEX) return;
+		pScopes->Ticks[index] = ticks;
+	}
+
+	/// <summary>
+	/// 呼び出したスレッドの表示名
+	/// </summary>
+	/// <param name="Name">スレッド名（文字列リテラル）</param>
+	void Profiler::SetThreadName(const char* Name)
+	{
+		const uint32_t index = GetThreadState().Index;
+		if (index >= MAX_THREADS) return;
+		mThreadNames[index].store(Name, std::memory_order_release);
+	}
+
+	/// <summary>
+	/// GPU区間の開始
+	/// </summary>
+	void Profiler::BeginGpuScope(const char* Name, ID3D12GraphicsCommandList* CmdList)
+	{
+		if (IsRecordingThread() == false) return;
+
+		auto list = CmdList != nullptr ? CmdList : mpCmdList;
+		if (list == nullptr) return;
+
+		const UINT frameIndex = mFrameIndex.load(std::memory_order_relaxed);
+		const uint32_t index = mSlots[frameIndex].Gpu.Begin(Name);
+		if (index == ProfileScopeRecorder::INVALID_INDEX) return;
+		list->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * QUERIES_PER_FRAME + index);
+	}
+
+	/// <summary>
+	/// GPU区間の終了
+	/// </summary>
+	void Profiler::EndGpuScope(ID3D12GraphicsCommandList* CmdList)
+	{
+		if (IsRecordingThread() == false) return;
+
+		auto list = CmdList != nullptr ? CmdList : mpCmdList;
+		if (list == nullptr) return;
+
+		const UINT frameIndex = mFrameIndex.load(std::memory_order_relaxed);
+		const uint32_t index = mSlots[frameIndex].Gpu.End();
+		if (index == ProfileScopeRecorder::INVALID_INDEX) return;
+		list->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * QUERIES_PER_FRAME + index);
+	}
+
+	/// <summary>
+	/// 最後に解決できたフレームの計測結果
+	/// </summary>
+	const ProfileTree& Profiler::GetLatestTree() const
+	{
+		return mLatest;
+	}
+
+	/// <summary>
+	/// 計測結果のデバッグ表示
+	/// </summary>
+	void Profiler::DrawDebugUI()
+	{
+		if (ImGui::Begin("Profiler") == false)
+		{
+			ImGui::End();
+			return;
+		}
+
+		constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+		if (ImGui::BeginTable("ProfilerTree", 3, tableFlags))
+		{
+			ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_NoHide);
+			ImGui::TableSetupColumn("CPU(ms)", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+			ImGui::TableSetupColumn("GPU(ms)", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+			ImGui::TableHeadersRow();
+
+			if (mLatest.GetFirstRoot() >= 0) DrawNode(mLatest, mLatest.GetFirstRoot());
+
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
+
+	/// <summary>
+	/// 枠に残っている前回分の計測結果を読み戻す
+	/// </summary>
+	void Profiler::ResolveSlot(UINT FrameIndex)
+	{
+		FrameSlot& slot = mSlots[FrameIndex];
+		if (slot.IsPending == false) return;
+
+		mLatest.Clear();
+
+		//	記録を行うスレッドを先に足して "Frame" を最初のルートにする
+		const uint32_t threadCount = GetUsedThreadCount();
+		if (slot.FrameThread < threadCount)
+		{
+			ThreadScopes& scopes = slot.Threads[slot.FrameThread];
+			std::lock_guard<std::mutex> lock(scopes.Mutex);
+			mLatest.AddCpu(scopes.Cpu.GetScopes(), scopes.Ticks, CPU_FREQUENCY);
+		}
+
+		//	他のスレッドはスレッド名の区間の下に入れる（名前のないワーカーは1つにまとまる）
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			if (i == slot.FrameThread) continue;
+
+			ThreadScopes& scopes = slot.Threads[i];
+			std::lock_guard<std::mutex> lock(scopes.Mutex);
+			const std::span<const ProfileScope> source = scopes.Cpu.GetScopes();
+			if (source.empty()) continue;
+
+			const char* name = mThreadNames[i].load(std::memory_order_acquire);
+			mThreadScopes.assign(1, ProfileScope{ name != nullptr ? name : DEFAULT_THREAD_NAME, -1, 0 });
+			mThreadTicks.assign(2, 0);
+			uint64_t begin = UINT64_MAX;
+			uint64_t end = 0;
+			for (size_t s = 0; s < source.size(); ++s)
+			{
+				const ProfileScope& scope = source[s];
+				mThreadScopes.push_back({ scope.Name, scope.Parent + 1, scope.Depth + 1 });
+				mThreadTicks.push_back(scopes.Ticks[s * 2]);
+				mThreadTicks.push_back(scopes.Ticks[s * 2 + 1]);
+				if (scope.Parent >= 0) continue;
+				begin = (std::min)(begin, scopes.Ticks[s * 2]);
+				end = (std::max)(end, scopes.Ticks[s * 2 + 1]);
+			}
+			mThreadTicks[0] = begin;
+			mThreadTicks[1] = (std::max)(begin, end);
+			mLatest.AddCpu(mThreadScopes, mThreadTicks, CPU_FREQUENCY);
+		}
+
+		const UINT count = slot.Gpu.GetTimestampCount();
+		if (count > 0 && mGpuFrequency > 0)
+		{
+			const SIZE_T offset = static_cast<SIZE_T>(FrameIndex) * QUERIES_PER_FRAME * sizeof(UINT64);
+			D3D12_RANGE readRange = { offset, offset + static_cast<SIZE_T>(count) * sizeof(UINT64) };
+
+			void* mapped = nullptr;
+			if (SUCCEEDED(mReadback->Map(0, &readRange, &mapped)))
+			{
+				const UINT64* ticks = reinterpret_cast<const UINT64*>(static_cast<const uint8_t*>(mapped) + offset);
+				mLatest.AddGpu(slot.Gpu.GetScopes(), std::span<const uint64_t>(ticks, count), mGpuFrequency);
+
+				//	CPUからは書き込んでいない
+				D3D12_RANGE writeRange = { 0, 0 };
+				mReadback->Unmap(0, &writeRange);
+			}
+		}
+
+		slot.IsPending = false;
+	}
+
+	/// <summary>
+	/// 呼び出したスレッドが書き込む枠のCPU区間
+	/// </summary>
+	/// <param name="IsBegin">true:区間の開始</param>
+	Profiler::ThreadScopes* Profiler::GetThreadScopes(bool IsBegin)
+	{
+		ThreadState& state = GetThreadState();
+		if (state.Index >= MAX_THREADS) return nullptr;
+
+		//	一番外の区間を開く時に枠を決め、閉じるまでは同じ枠に書く
+		if (IsBegin)
+		{
+			if (state.Depth == 0) state.Slot = mFrameIndex.load(std::memory_order_acquire);
+			state.Depth++;
+		}
+		else
+		{
+			if (state.Depth == 0) return nullptr;
+			state.Depth--;
+		}
+		return &mSlots[state.Slot].Threads[state.Index];
+	}
+
+	/// <summary>
+	/// 呼び出し元がフレームを記録中のスレッドかどうか
+	/// </summary>
+	bool Profiler::IsRecordingThread() const
+	{
+		return mFrameThread.load(std::memory_order_acquire) == std::this_thread::get_id();
+	}
+}
@@ -0,0 +1,329 @@
+﻿#include "pch.h"
+#include<ECS/System/SystemScheduler.hpp>
+#include<System/Service/ServiceLocator.hpp>
+
+namespace Ecse::ECS
+{
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void SystemScheduler::OnCreate()
+	{
+		mpRegistry = nullptr;
+		mSystems.clear();
+		mComponentBits.clear();
+		mOrder.clear();
+		mCriticalPath.clear();
+		mFrameStart = {};
+		mDeltaTime = 0.0f;
+		mIsParallel = true;
+		mIsUpdating = false;
+		mStats = {};
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void SystemScheduler::OnDestroy()
+	{
+		mSystems.clear();
+		mComponentBits.clear();
+		mOrder.clear();
+		mCriticalPath.clear();
+		mpRegistry = nullptr;
+	}
+
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="Registry">システムに渡すレジストリ</param>
+	/// <param name="IsParallel">false:登録順に呼んだスレッドで動かす（比べる時やデバッグ用）</param>
+	/// <returns>true:成功</returns>
+	bool SystemScheduler::Initialize(entt::registry& Registry, bool IsParallel)
+	{
+		mpRegistry = &Registry;
+		mIsParallel = IsParallel;
+		return true;
+	}
+
+	/// <summary>
+	/// システムを加える（Update の外で）
+	/// </summary>
+	/// <param name="Name">名前（計測の表示用）</param>
+	/// <param name="Access">触るコンポーネント</param>
+	/// <param name="Function">処理</param>
+	/// <returns>番号（コンポーネントの型が多すぎる時は INVALID_SYSTEM_ID）</returns>
+	SystemId SystemScheduler::AddSystem(std::string Name, const SystemAccess& Access, SystemFunction Function)
+	{
+		if (mpRegistry == nullptr || mIsUpdating == true)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "SystemScheduler: cannot add {} now.", Name);
+			return INVALID_SYSTEM_ID;
+		}
+
+		ComponentSet reads;
+		ComponentSet writes;
+		for (const SystemAccess::Component& component : Access.GetComponents())
+		{
+			const uint32_t bit = this->GetComponentBit(component.Type);
+			if (bit == UINT32_MAX)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "SystemScheduler: too many component types ({}).", Name);
+				return INVALID_SYSTEM_ID;
+			}
+			if (component.IsWrite == true) writes.set(bit);
+			else reads.set(bit);
+
+			//	同時に動いている間に registry の storage が増えないように先に作る
+			component.Assure(*mpRegistry);
+		}
+
+		const SystemId id = static_cast<SystemId>(mSystems.size());
+		SystemEntry& entry = mSystems.emplace_back();
+		entry.Name = std::move(Name);
+		entry.Function = std::move(Function);
+		entry.Reads = reads & ~writes;
+		entry.Writes = writes;
+		entry.IsExclusive = Access.IsExclusive();
+		return id;
+	}
+
+	/// <summary>
+	/// 有効・無効を切り替える（次の Update から）
+	/// </summary>
+	void SystemScheduler::SetEnabled(SystemId Id, bool IsEnabled)
+	{
+		if (Id >= mSystems.size()) return;
+		mSystems[Id].IsEnabled = IsEnabled;
+	}
+
+	/// <summary>
+	/// 有効か
+	/// </summary>
+	bool SystemScheduler::IsEnabled(SystemId Id) const
+	{
+		return Id < mSystems.size() && mSystems[Id].IsEnabled;
+	}
+
+	/// <summary>
+	/// 並列に動かすかを切り替える（次の Update から）
+	/// </summary>
+	void SystemScheduler::SetParallel(bool IsParallel)
+	{
+		mIsParallel = IsParallel;
+	}
+
+	/// <summary>
+	/// 依存を作り直して全ての有効なシステムを動かし、終わるまで待つ（ゲームスレッドでフレームに1回）
+	/// </summary>
+	void SystemScheduler::Update(float DeltaTime)
+	{
+		if (mpRegistry == nullptr || mIsUpdating == true) return;
+		mIsUpdating = true;
+		mDeltaTime = DeltaTime;
+
+		this->BuildGraph();
+
+		mFrameStart = std::chrono::steady_clock::now();
+		System::JobSystem* pJobs = System::ServiceLocator::Get<System::JobSystem>();
+		if (mIsParallel == false || pJobs == nullptr)
+		{
+			//	依存は登録順にしか張らないので、登録順に動かせば必ず先のシステムが終わっている
+			for (const SystemId id : mOrder)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				mSystems[id].Function(*mpRegistry, mDeltaTime);
+				const auto end = std::chrono::steady_clock::now();
+
+				SystemTiming& timing = mSystems[id].Timing;
+				timing.StartMs = std::chrono::duration<double, std::milli>(start - mFrameStart).count();
+				timing.EndMs = std::chrono::duration<double, std::milli>(end - mFrameStart).count();
+				timing.Ms = timing.EndMs - timing.StartMs;
+				timing.ThreadIndex = pJobs != nullptr ? pJobs->GetThreadIndex() : 0;
+			}
+		}
+		else
+		{
+			//	先のシステムが無いものから積み、残りは先のシステムが終わったワーカーが積む
+			for (const SystemId id : mOrder)
+			{
+				if (mSystems[id].Predecessors.empty() == false) continue;
+				pJobs->Run([this, id]() { this->RunSystem(id); }, &mFrameCounter);
+			}
+			pJobs->Wait(mFrameCounter);
+		}
+
+		mStats.FrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mFrameStart).count();
+		this->ComputeCriticalPath();
+		mIsUpdating = false;
+	}
+
+	/// <summary>
+	/// 加えたシステムの数
+	/// </summary>
+	uint32_t SystemScheduler::GetSystemCount() const
+	{
+		return static_cast<uint32_t>(mSystems.size());
+	}
+
+	/// <summary>
+	/// 名前
+	/// </summary>
+	std::string_view SystemScheduler::GetName(SystemId Id) const
+	{
+		if (Id >= mSystems.size()) return {};
+		return mSystems[Id].Name;
+	}
+
+	/// <summary>
+	/// 直近のフレームでの計測結果（無効なシステムは 0）
+	/// </summary>
+	const SystemTiming& SystemScheduler::GetTiming(SystemId Id) const
+	{
+		static const SystemTiming empty;
+		if (Id >= mSystems.size()) return empty;
+		return mSystems[Id].Timing;
+	}
+
+	/// <summary>
+	/// 直近のフレームのクリティカルパス（動いた順）
+	/// </summary>
+	std::span<const SystemId> SystemScheduler::GetCriticalPath() const
+	{
+		return mCriticalPath;
+	}
+
+	/// <summary>
+	/// 直近のフレームの計測結果
+	/// </summary>
+	SystemSchedulerStats SystemScheduler::GetStats() const
+	{
+		return mStats;
+	}
+
+	/// <summary>
+	/// 同時に動かせないか
+	/// </summary>
+	bool SystemScheduler::IsConflicting(const SystemEntry& First, const SystemEntry& Second)
+	{
+		if (First.IsExclusive == true || Second.IsExclusive == true) return true;
+		//	片方が書くものをもう片方が読むか書く
+		if ((First.Writes & (Second.Reads | Second.Writes)).any()) return true;
+		return (Second.Writes & First.Reads).any();
+	}
+
+	/// <summary>
+	/// 有効なシステムの依存を作り直す
+	/// </summary>
+	void SystemScheduler::BuildGraph()
+	{
+		mOrder.clear();
+		mStats.Edges = 0;
+		for (SystemId id = 0; id < mSystems.size(); ++id)
+		{
+			SystemEntry& entry = mSystems[id];
+			entry.Predecessors.clear();
+			entry.Successors.clear();
+			entry.Timing = {};
+			if (entry.IsEnabled == false) continue;
+
+			//	先に登録されたシステムと競合するなら、その後に動かす
+			for (const SystemId before : mOrder)
+			{
+				if (IsConflicting(mSystems[before], entry) == false) continue;
+				mSystems[before].Successors.push_back(id);
+				entry.Predecessors.push_back(before);
+				mStats.Edges++;
+			}
+			entry.Remaining.store(static_cast<uint32_t>(entry.Predecessors.size()), std::memory_order_relaxed);
+			mOrder.push_back(id);
+		}
+		mStats.Systems = static_cast<uint32_t>(mOrder.size());
+	}
+
+	/// <summary>
+	/// システムを動かし、動けるようになった後のシステムを積む（1つはそのまま続けて動かす）
+	/// </summary>
+	void SystemScheduler::RunSystem(SystemId Id)
+	{
+		System::JobSystem* pJobs = System::ServiceLocator::Get<System::JobSystem>();
+		while (Id != INVALID_SYSTEM_ID)
+		{
+			SystemEntry& entry = mSystems[Id];
+			const auto start = std::chrono::steady_clock::now();
+			entry.Function(*mpRegistry, mDeltaTime);
+			const auto end = std::chrono::steady_clock::now();
+
+			entry.Timing.StartMs = std::chrono::duration<double, std::milli>(start - mFrameStart).count();
+			entry.Timing.EndMs = std::chrono::duration<double, std::milli>(end - mFrameStart).count();
+			entry.Timing.Ms = entry.Timing.EndMs - entry.Timing.StartMs;
+			entry.Timing.ThreadIndex = pJobs->GetThreadIndex();
+
+			//	最後の先のシステムだったものを動かす。1つ目は積まずにこのワーカーで続ける
+			SystemId next = INVALID_SYSTEM_ID;
+			for (const SystemId successor : entry.Successors)
+			{
+				if (mSystems[successor].Remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+				if (next == INVALID_SYSTEM_ID)
+				{
+					next = successor;
+					continue;
+				}
+				pJobs->Run([this, successor]() { this->RunSystem(successor); }, &mFrameCounter);
+			}
+			Id = next;
+		}
+	}
+
+	/// <summary>
+	/// 計測結果からクリティカルパスを求める
+	/// </summary>
+	void SystemScheduler::ComputeCriticalPath()
+	{
+		mCriticalPath.clear();
+		mStats.TotalMs = 0.0;
+		mStats.CriticalPathMs = 0.0;
+		if (mOrder.empty()) return;
+
+		//	登録順は依存の順にもなっているので、前から「そこで終わる一番長い道のり」を求める
+		std::vector<double> finishMs(mSystems.size(), 0.0);
+		std::vector<SystemId> longest(mSystems.size(), INVALID_SYSTEM_ID);
+		SystemId last = INVALID_SYSTEM_ID;
+		for (const SystemId id : mOrder)
+		{
+			const SystemEntry& entry = mSystems[id];
+			double startMs = 0.0;
+			for (const SystemId before : entry.Predecessors)
+			{
+				if (finishMs[before] <= startMs) continue;
+				startMs = finishMs[before];
+				longest[id] = before;
+			}
+			finishMs[id] = startMs + entry.Timing.Ms;
+			mStats.TotalMs += entry.Timing.Ms;
+			if (last == INVALID_SYSTEM_ID || finishMs[id] > finishMs[last]) last = id;
+		}
+
+		mStats.CriticalPathMs = finishMs[last];
+		for (SystemId id = last; id != INVALID_SYSTEM_ID; id = longest[id])
+		{
+			mSystems[id].Timing.IsOnCriticalPath = true;
+			mCriticalPath.push_back(id);
+		}
+		std::reverse(mCriticalPath.begin(), mCriticalPath.end());
+	}
+
+	/// <summary>
+	/// コンポーネントの型のビット（足りなければ UINT32_MAX）
+	/// </summary>
+	uint32_t SystemScheduler::GetComponentBit(entt::id_type Type)
+	{
+		const auto it = mComponentBits.find(Type);
+		if (it != mComponentBits.end()) return it->second;
+		if (mComponentBits.size() >= MAX_COMPONENT_TYPES) return UINT32_MAX;
+
+		const uint32_t bit = static_cast<uint32_t>(mComponentBits.size());
+		mComponentBits.emplace(Type, bit);
+		return bit;
+	}
+}
@@ -0,0 +1,603 @@
+﻿#include "pch.h"
+#include<Graphics/Culling/DynamicBvh.hpp>
+#include<Graphics/Culling/FrustumCulling.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 0 で割った時の代わりの値（inf * 0 の NaN を避ける）
+		/// </summary>
+		constexpr float INV_DIRECTION_LIMIT = 1e30f;
+
+		/// <summary>
+		/// 箱と視錐台の関係
+		/// </summary>
+		enum class EFrustumTest : uint8_t
+		{
+			Outside,
+			Intersect,
+			Inside,
+		};
+
+		/// <summary>
+		/// 箱1つと視錐台
+		/// </summary>
+		EFrustumTest TestFrustum(const Frustum& View, const Aabb& Bounds)
+		{
+			const DirectX::XMFLOAT3 center = Bounds.Center();
+			const DirectX::XMFLOAT3 extents((Bounds.Max.x - Bounds.Min.x) * 0.5f, (Bounds.Max.y - Bounds.Min.y) * 0.5f, (Bounds.Max.z - Bounds.Min.z) * 0.5f);
+
+			EFrustumTest result = EFrustumTest::Inside;
+			for (const auto& pl : View.Planes)
+			{
+				const float dist = pl.x * center.x + pl.y * center.y + pl.z * center.z + pl.w;
+				const float reach = std::fabs(pl.x) * extents.x + std::fabs(pl.y) * extents.y + std::fabs(pl.z) * extents.z;
+				if (dist + reach < 0.0f) return EFrustumTest::Outside;
+				if (dist - reach < 0.0f) result = EFrustumTest::Intersect;
+			}
+			return result;
+		}
+
+		/// <summary>
+		/// 箱1つと光線（当たった距離、外れたら負）
+		/// </summary>
+		float IntersectRay(const Aabb& Bounds, const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& InvDirection, float MaxT)
+		{
+			const float tx1 = (Bounds.Min.x - Origin.x) * InvDirection.x;
+			const float tx2 = (Bounds.Max.x - Origin.x) * InvDirection.x;
+			const float ty1 = (Bounds.Min.y - Origin.y) * InvDirection.y;
+			const float ty2 = (Bounds.Max.y - Origin.y) * InvDirection.y;
+			const float tz1 = (Bounds.Min.z - Origin.z) * InvDirection.z;
+			const float tz2 = (Bounds.Max.z - Origin.z) * InvDirection.z;
+
+			const float tMin = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+			const float tMax = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), MaxT });
+			return tMin <= tMax ? tMin : -1.0f;
+		}
+	}
+
+	/// <param name="Margin">葉の箱を太らせる量</param>
+	DynamicBvh::DynamicBvh(float Margin)
+		:mNodes()
+		, mRoot(INVALID_PROXY)
+		, mFreeList(INVALID_PROXY)
+		, mProxyCount(0)
+		, mMargin(Margin)
+	{
+	}
+
+	/// <summary>
+	/// 物の追加
+	/// </summary>
+	uint32_t DynamicBvh::CreateProxy(const Aabb& Bounds, uint32_t UserData)
+	{
+		const uint32_t proxy = AllocateNode();
+		Node& node = mNodes[proxy];
+		node.Bounds = Fatten(Bounds);
+		node.UserData = UserData;
+		node.Height = 0;
+
+		InsertLeaf(proxy);
+		mProxyCount++;
+		return proxy;
+	}
+
+	/// <summary>
+	/// 物の削除
+	/// </summary>
+	void DynamicBvh::DestroyProxy(uint32_t Proxy)
+	{
+		assert(Proxy < mNodes.size() && mNodes[Proxy].IsLeaf());
+
+		RemoveLeaf(Proxy);
+		FreeNode(Proxy);
+		mProxyCount--;
+	}
+
+	/// <summary>
+	/// 物の移動。太らせた箱からはみ出した時だけ入れ直す
+	/// </summary>
+	bool DynamicBvh::MoveProxy(uint32_t Proxy, const Aabb& Bounds)
+	{
+		assert(Proxy < mNodes.size() && mNodes[Proxy].IsLeaf());
+
+		if (mNodes[Proxy].Bounds.Contains(Bounds)) return false;
+
+		RemoveLeaf(Proxy);
+		mNodes[Proxy].Bounds = Fatten(Bounds);
+		InsertLeaf(Proxy);
+		return true;
+	}
+
+	/// <summary>
+	/// 葉の箱だけを書き換える（木の形と親の箱は Refit まで直さない）
+	/// </summary>
+	void DynamicBvh::RefitProxy(uint32_t Proxy, const Aabb& Bounds)
+	{
+		assert(Proxy < mNodes.size() && mNodes[Proxy].IsLeaf());
+
+		if (mNodes[Proxy].Bounds.Contains(Bounds)) return;
+		mNodes[Proxy].Bounds = Fatten(Bounds);
+	}
+
+	/// <summary>
+	/// 下から全ての節の箱を直し、回転で偏りを直す
+	/// </summary>
+	void DynamicBvh::Refit()
+	{
+		if (mRoot == INVALID_PROXY) return;
+
+		//	先行順に並べて逆から処理すれば、子が必ず親より先になる
+		std::vector<uint32_t> order;
+		order.reserve(mNodes.size());
+		std::vector<uint32_t> stack = { mRoot };
+		while (stack.empty() == false)
+		{
+			const uint32_t index = stack.back();
+			stack.pop_back();
+
+			const Node& node = mNodes[index];
+			if (node.IsLeaf()) continue;
+
+			order.push_back(index);
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+
+		for (auto it = order.rbegin(); it != order.rend(); ++it)
+		{
+			Node& node = mNodes[*it];
+			const Node& child1 = mNodes[node.Child1];
+			const Node& child2 = mNodes[node.Child2];
+			node.Bounds = Aabb::Union(child1.Bounds, child2.Bounds);
+			node.Height = 1 + std::max(child1.Height, child2.Height);
+			Rotate(*it);
+		}
+	}
+
+	/// <summary>
+	/// 全ての削除
+	/// </summary>
+	void DynamicBvh::Clear()
+	{
+		mNodes.clear();
+		mRoot = INVALID_PROXY;
+		mFreeList = INVALID_PROXY;
+		mProxyCount = 0;
+	}
+
+	/// <summary>
+	/// 視錐台に掛かる物の UserData を集める
+	/// </summary>
+	void DynamicBvh::QueryFrustum(const Frustum& View, std::vector<uint32_t>& Out) const
+	{
+		Out.clear();
+		if (mRoot == INVALID_PROXY) return;
+
+		//	丸ごと入っている枝は判定せずに葉を集める
+		std::vector<uint32_t> stack = { mRoot };
+		std::vector<uint32_t> all;
+		while (stack.empty() == false)
+		{
+			const uint32_t index = stack.back();
+			stack.pop_back();
+
+			const Node& node = mNodes[index];
+			const EFrustumTest test = TestFrustum(View, node.Bounds);
+			if (test == EFrustumTest::Outside) continue;
+
+			if (node.IsLeaf())
+			{
+				Out.push_back(node.UserData);
+				continue;
+			}
+
+			if (test == EFrustumTest::Inside)
+			{
+				all.push_back(index);
+				while (all.empty() == false)
+				{
+					const Node& inner = mNodes[all.back()];
+					all.pop_back();
+					if (inner.IsLeaf())
+					{
+						Out.push_back(inner.UserData);
+						continue;
+					}
+					all.push_back(inner.Child1);
+					all.push_back(inner.Child2);
+				}
+				continue;
+			}
+
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+	}
+
+	/// <summary>
+	/// 箱に重なる物の UserData を集める（追記）
+	/// </summary>
+	void DynamicBvh::QueryAabb(const Aabb& Bounds, std::vector<uint32_t>& Out) const
+	{
+		if (mRoot == INVALID_PROXY) return;
+
+		std::vector<uint32_t> stack;
+		stack.reserve(64);
+		stack.push_back(mRoot);
+		while (stack.empty() == false)
+		{
+			const Node& node = mNodes[stack.back()];
+			stack.pop_back();
+
+			if (node.Bounds.Overlaps(Bounds) == false) continue;
+
+			if (node.IsLeaf())
+			{
+				Out.push_back(node.UserData);
+				continue;
+			}
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+	}
+
+	/// <summary>
+	/// 一番手前で光線が当たる物（太らせた箱での判定）
+	/// </summary>
+	RayHit DynamicBvh::Raycast(const Ray& Query) const
+	{
+		RayHit hit;
+		if (mRoot == INVALID_PROXY) return hit;
+
+		auto inv = [](float V)
+			{
+				if (std::fabs(V) < 1.0f / INV_DIRECTION_LIMIT) return std::signbit(V) ? -INV_DIRECTION_LIMIT : INV_DIRECTION_LIMIT;
+				return 1.0f / V;
+			};
+		const DirectX::XMFLOAT3 invDirection(inv(Query.Direction.x), inv(Query.Direction.y), inv(Query.Direction.z));
+
+		float best = Query.MaxT;
+		if (IntersectRay(mNodes[mRoot].Bounds, Query.Origin, invDirection, best) < 0.0f) return hit;
+
+		//	節の添字と、そこに入った距離
+		std::vector<std::pair<uint32_t, float>> stack;
+		stack.reserve(64);
+		stack.emplace_back(mRoot, 0.0f);
+		while (stack.empty() == false)
+		{
+			const auto [index, entry] = stack.back();
+			stack.pop_back();
+			if (entry > best) continue;
+
+			const Node& node = mNodes[index];
+			if (node.IsLeaf())
+			{
+				hit.Index = node.UserData;
+				hit.T = entry;
+				best = entry;
+				continue;
+			}
+
+			const float t1 = IntersectRay(mNodes[node.Child1].Bounds, Query.Origin, invDirection, best);
+			const float t2 = IntersectRay(mNodes[node.Child2].Bounds, Query.Origin, invDirection, best);
+
+			//	奥から積んで手前を先に調べる
+			if (t1 >= 0.0f && t2 >= 0.0f)
+			{
+				const bool firstIsNear = t1 <= t2;
+				stack.emplace_back(firstIsNear ? node.Child2 : node.Child1, firstIsNear ? t2 : t1);
+				stack.emplace_back(firstIsNear ? node.Child1 : node.Child2, firstIsNear ? t1 : t2);
+			}
+			else if (t1 >= 0.0f)
+			{
+				stack.emplace_back(node.Child1, t1);
+			}
+			else if (t2 >= 0.0f)
+			{
+				stack.emplace_back(node.Child2, t2);
+			}
+		}
+
+		return hit;
+	}
+
+	/// <summary>
+	/// 複数の箱の検索を並列に行う
+	/// </summary>
+	void DynamicBvh::QueryAabbBatch(std::span<const Aabb> Queries, std::vector<std::vector<uint32_t>>& Out) const
+	{
+		Out.resize(Queries.size());
+
+		auto query = [this, &Queries, &Out](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					Out[i].clear();
+					QueryAabb(Queries[i], Out[i]);
+				}
+			};
+
+		constexpr uint32_t GRAIN = 64;
+		System::JobSystem::ParallelForOrInline(static_cast<uint32_t>(Queries.size()), query, GRAIN);
+	}
+
+	/// <summary>
+	/// 複数の光線の判定を並列に行う
+	/// </summary>
+	void DynamicBvh::RaycastBatch(std::span<const Ray> Queries, std::span<RayHit> Out) const
+	{
+		assert(Out.size() >= Queries.size());
+
+		auto cast = [this, &Queries, &Out](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					Out[i] = Raycast(Queries[i]);
+				}
+			};
+
+		constexpr uint32_t GRAIN = 64;
+		System::JobSystem::ParallelForOrInline(static_cast<uint32_t>(Queries.size()), cast, GRAIN);
+	}
+
+	/// <summary>
+	/// プロキシの UserData
+	/// </summary>
+	uint32_t DynamicBvh::GetUserData(uint32_t Proxy) const
+	{
+		return mNodes[Proxy].UserData;
+	}
+
+	/// <summary>
+	/// プロキシの太らせた箱
+	/// </summary>
+	const Aabb& DynamicBvh::GetFatBounds(uint32_t Proxy) const
+	{
+		return mNodes[Proxy].Bounds;
+	}
+
+	/// <summary>
+	/// 木の高さ（葉だけなら0）
+	/// </summary>
+	int32_t DynamicBvh::GetHeight() const
+	{
+		return mRoot == INVALID_PROXY ? 0 : mNodes[mRoot].Height;
+	}
+
+	/// <summary>
+	/// 物の数
+	/// </summary>
+	uint32_t DynamicBvh::GetProxyCount() const
+	{
+		return mProxyCount;
+	}
+
+	/// <summary>
+	/// 空きの節を取り出す
+	/// </summary>
+	uint32_t DynamicBvh::AllocateNode()
+	{
+		uint32_t index = mFreeList;
+		if (index == INVALID_PROXY)
+		{
+			index = static_cast<uint32_t>(mNodes.size());
+			mNodes.emplace_back();
+		}
+		else
+		{
+			mFreeList = mNodes[index].Parent;
+		}
+
+		Node& node = mNodes[index];
+		node.Bounds = {};
+		node.Parent = INVALID_PROXY;
+		node.Child1 = INVALID_PROXY;
+		node.Child2 = INVALID_PROXY;
+		node.Height = 0;
+		node.UserData = 0;
+		return index;
+	}
+
+	/// <summary>
+	/// 節を空きに戻す
+	/// </summary>
+	void DynamicBvh::FreeNode(uint32_t Index)
+	{
+		mNodes[Index].Parent = mFreeList;
+		mNodes[Index].Height = -1;
+		mFreeList = Index;
+	}
+
+	/// <summary>
+	/// 葉を木に入れる
+	/// </summary>
+	void DynamicBvh::InsertLeaf(uint32_t Leaf)
+	{
+		if (mRoot == INVALID_PROXY)
+		{
+			mRoot = Leaf;
+			mNodes[Leaf].Parent = INVALID_PROXY;
+			return;
+		}
+
+		//	増える面積が一番少ない兄弟を探す
+		const Aabb leafBounds = mNodes[Leaf].Bounds;
+		uint32_t index = mRoot;
+		while (mNodes[index].IsLeaf() == false)
+		{
+			const Node& node = mNodes[index];
+			const float area = node.Bounds.SurfaceArea();
+			const float combined = Aabb::Union(node.Bounds, leafBounds).SurfaceArea();
+
+			//	ここに兄弟として付ける場合
+			const float cost = 2.0f * combined;
+			//	下に降りる場合に、ここから上の箱が広がる分
+			const float inheritance = 2.0f * (combined - area);
+
+			auto descendCost = [this, &leafBounds, inheritance](uint32_t Child)
+				{
+					const Node& child = mNodes[Child];
+					const float grown = Aabb::Union(child.Bounds, leafBounds).SurfaceArea();
+					return (child.IsLeaf() ? grown : grown - child.Bounds.SurfaceArea()) + inheritance;
+				};
+			const float cost1 = descendCost(node.Child1);
+			const float cost2 = descendCost(node.Child2);
+
+			if (cost < cost1 && cost < cost2) break;
+			index = cost1 < cost2 ? node.Child1 : node.Child2;
+		}
+
+		const uint32_t sibling = index;
+		const uint32_t oldParent = mNodes[sibling].Parent;
+		const uint32_t newParent = AllocateNode();
+
+		Node& parent = mNodes[newParent];
+		parent.Parent = oldParent;
+		parent.Bounds = Aabb::Union(leafBounds, mNodes[sibling].Bounds);
+		parent.Height = mNodes[sibling].Height + 1;
+		parent.Child1 = sibling;
+		parent.Child2 = Leaf;
+
+		if (oldParent != INVALID_PROXY)
+		{
+			Node& grand = mNodes[oldParent];
+			if (grand.Child1 == sibling) grand.Child1 = newParent;
+			else grand.Child2 = newParent;
+		}
+		else
+		{
+			mRoot = newParent;
+		}
+		mNodes[sibling].Parent = newParent;
+		mNodes[Leaf].Parent = newParent;
+
+		RefitAncestors(newParent);
+	}
+
+	/// <summary>
+	/// 葉を木から抜く（節は残す）
+	/// </summary>
+	void DynamicBvh::RemoveLeaf(uint32_t Leaf)
+	{
+		if (Leaf == mRoot)
+		{
+			mRoot = INVALID_PROXY;
+			return;
+		}
+
+		const uint32_t parent = mNodes[Leaf].Parent;
+		const uint32_t grand = mNodes[parent].Parent;
+		const uint32_t sibling = mNodes[parent].Child1 == Leaf ? mNodes[parent].Child2 : mNodes[parent].Child1;
+
+		//	親を消して兄弟を繰り上げる
+		if (grand != INVALID_PROXY)
+		{
+			Node& node = mNodes[grand];
+			if (node.Child1 == parent) node.Child1 = sibling;
+			else node.Child2 = sibling;
+			mNodes[sibling].Parent = grand;
+			FreeNode(parent);
+			RefitAncestors(grand);
+		}
+		else
+		{
+			mRoot = sibling;
+			mNodes[sibling].Parent = INVALID_PROXY;
+			FreeNode(parent);
+		}
+	}
+
+	/// <summary>
+	/// Index から根まで箱と高さを直しながら回転する
+	/// </summary>
+	void DynamicBvh::RefitAncestors(uint32_t Index)
+	{
+		while (Index != INVALID_PROXY)
+		{
+			Node& node = mNodes[Index];
+			const Node& child1 = mNodes[node.Child1];
+			const Node& child2 = mNodes[node.Child2];
+			node.Bounds = Aabb::Union(child1.Bounds, child2.Bounds);
+			node.Height = 1 + std::max(child1.Height, child2.Height);
+
+			Rotate(Index);
+			Index = mNodes[Index].Parent;
+		}
+	}
+
+	/// <summary>
+	/// 子と孫を入れ替えて、箱の面積が減るなら回転する
+	/// </summary>
+	void DynamicBvh::Rotate(uint32_t Index)
+	{
+		const Node& a = mNodes[Index];
+		if (a.IsLeaf() || a.Height < 2) return;
+
+		const uint32_t b = a.Child1;
+		const uint32_t c = a.Child2;
+
+		//	入れ替え候補（A の子 X と、もう片方の子 P の子 Y）
+		uint32_t bestX = INVALID_PROXY;
+		uint32_t bestP = INVALID_PROXY;
+		uint32_t bestY = INVALID_PROXY;
+		float bestGain = 0.0f;
+
+		auto consider = [this, &bestX, &bestP, &bestY, &bestGain](uint32_t X, uint32_t P)
+			{
+				const Node& p = mNodes[P];
+				if (p.IsLeaf()) return;
+
+				const float area = p.Bounds.SurfaceArea();
+				//	X と Y を入れ替えると P は X と残った方の孫を包む箱になる
+				const float swap1 = Aabb::Union(mNodes[X].Bounds, mNodes[p.Child2].Bounds).SurfaceArea();
+				const float swap2 = Aabb::Union(mNodes[X].Bounds, mNodes[p.Child1].Bounds).SurfaceArea();
+				if (area - swap1 > bestGain)
+				{
+					bestGain = area - swap1;
+					bestX = X;
+					bestP = P;
+					bestY = p.Child1;
+				}
+				if (area - swap2 > bestGain)
+				{
+					bestGain = area - swap2;
+					bestX = X;
+					bestP = P;
+					bestY = p.Child2;
+				}
+			};
+		consider(b, c);
+		consider(c, b);
+
+		if (bestX == INVALID_PROXY) return;
+
+		//	A の X の位置に Y、P の Y の位置に X
+		Node& nodeA = mNodes[Index];
+		if (nodeA.Child1 == bestX) nodeA.Child1 = bestY;
+		else nodeA.Child2 = bestY;
+		mNodes[bestY].Parent = Index;
+
+		Node& nodeP = mNodes[bestP];
+		if (nodeP.Child1 == bestY) nodeP.Child1 = bestX;
+		else nodeP.Child2 = bestX;
+		mNodes[bestX].Parent = bestP;
+
+		nodeP.Bounds = Aabb::Union(mNodes[nodeP.Child1].Bounds, mNodes[nodeP.Child2].Bounds);
+		nodeP.Height = 1 + std::max(mNodes[nodeP.Child1].Height, mNodes[nodeP.Child2].Height);
+		nodeA.Height = 1 + std::max(mNodes[nodeA.Child1].Height, mNodes[nodeA.Child2].Height);
+	}
+
+	/// <summary>
+	/// 太らせた箱
+	/// </summary>
+	Aabb DynamicBvh::Fatten(const Aabb& Bounds) const
+	{
+		return {
+			{ Bounds.Min.x - mMargin, Bounds.Min.y - mMargin, Bounds.Min.z - mMargin },
+			{ Bounds.Max.x + mMargin, Bounds.Max.y + mMargin, Bounds.Max.z + mMargin } };
+	}
+}
@@ -0,0 +1,339 @@
+﻿#include "pch.h"
+#include<Graphics/Culling/FrustumCulling.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<Utility/Simd/CpuFeatures.hpp>
+
+#include<immintrin.h>
+#include<bit>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 判定に使う平面を成分ごとに分けたもの
+		/// </summary>
+		struct PlaneSoA
+		{
+			float Nx[Frustum::PLANE_COUNT];
+			float Ny[Frustum::PLANE_COUNT];
+			float Nz[Frustum::PLANE_COUNT];
+			float D[Frustum::PLANE_COUNT];
+			//	AABBの押し出し量に使う法線の絶対値
+			float AbsNx[Frustum::PLANE_COUNT];
+			float AbsNy[Frustum::PLANE_COUNT];
+			float AbsNz[Frustum::PLANE_COUNT];
+		};
+
+		/// <summary>
+		/// 判定の入力
+		/// </summary>
+		struct CullInput
+		{
+			const float* pCx;
+			const float* pCy;
+			const float* pCz;
+			const float* pEx;
+			const float* pEy;
+			const float* pEz;
+			const float* pRadius;
+			const PlaneSoA* pPlanes;
+			ECullShape Shape;
+		};
+
+		/// <summary>
+		/// 1つずつ判定
+		/// </summary>
+		void CullScalar(const CullInput& In, uint32_t Begin, uint32_t End, std::vector<uint32_t>& Out)
+		{
+			const PlaneSoA& pl = *In.pPlanes;
+			for (uint32_t i = Begin; i < End; ++i)
+			{
+				bool visible = true;
+				for (uint32_t p = 0; p < Frustum::PLANE_COUNT && visible; ++p)
+				{
+					const float dist = pl.Nx[p] * In.pCx[i] + pl.Ny[p] * In.pCy[i] + pl.Nz[p] * In.pCz[i] + pl.D[p];
+					const float reach = In.Shape == ECullShape::Sphere ?
+						In.pRadius[i] :
+						pl.AbsNx[p] * In.pEx[i] + pl.AbsNy[p] * In.pEy[i] + pl.AbsNz[p] * In.pEz[i];
+					visible = dist + reach >= 0.0f;
+				}
+				if (visible) Out.push_back(i);
+			}
+		}
+
+		/// <summary>
+		/// 4個ずつ判定（SSE2 は x64 なら必ずある）
+		/// </summary>
+		uint32_t CullSse(const CullInput& In, uint32_t Begin, uint32_t End, std::vector<uint32_t>& Out)
+		{
+			const PlaneSoA& pl = *In.pPlanes;
+			const __m128 zero = _mm_setzero_ps();
+
+			uint32_t i = Begin;
+			for (; i + 4 <= End; i += 4)
+			{
+				const __m128 cx = _mm_loadu_ps(In.pCx + i);
+				const __m128 cy = _mm_loadu_ps(In.pCy + i);
+				const __m128 cz = _mm_loadu_ps(In.pCz + i);
+				__m128 ex = zero, ey = zero, ez = zero, radius = zero;
+				if (In.Shape == ECullShape::Sphere)
+				{
+					radius = _mm_loadu_ps(In.pRadius + i);
+				}
+				else
+				{
+					ex = _mm_loadu_ps(In.pEx + i);
+					ey = _mm_loadu_ps(In.pEy + i);
+					ez = _mm_loadu_ps(In.pEz + i);
+				}
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+				{
+					__m128 dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.Nx[p]), cx), _mm_set1_ps(pl.D[p]));
+					dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(pl.Ny[p]), cy));
+					dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(pl.Nz[p]), cz));
+
+					__m128 reach = radius;
+					if (In.Shape == ECullShape::Aabb)
+					{
+						reach = _mm_mul_ps(_mm_set1_ps(pl.AbsNx[p]), ex);
+						reach = _mm_add_ps(reach, _mm_mul_ps(_mm_set1_ps(pl.AbsNy[p]), ey));
+						reach = _mm_add_ps(reach, _mm_mul_ps(_mm_set1_ps(pl.AbsNz[p]), ez));
+					}
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, reach), zero));
+				}
+
+				uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+				while (mask != 0)
+				{
+					Out.push_back(i + static_cast<uint32_t>(std::countr_zero(mask)));
+					mask &= mask - 1;
+				}
+			}
+			return i;
+		}
+
+		/// <summary>
+		/// 8個ずつ判定
+		/// </summary>
+		ECSE_TARGET_AVX uint32_t CullAvx(const CullInput& In, uint32_t Begin, uint32_t End, std::vector<uint32_t>& Out)
+		{
+			const PlaneSoA& pl = *In.pPlanes;
+			const __m256 zero = _mm256_setzero_ps();
+
+			uint32_t i = Begin;
+			for (; i + 8 <= End; i += 8)
+			{
+				const __m256 cx = _mm256_loadu_ps(In.pCx + i);
+				const __m256 cy = _mm256_loadu_ps(In.pCy + i);
+				const __m256 cz = _mm256_loadu_ps(In.pCz + i);
+				__m256 ex = zero, ey = zero, ez = zero, radius = zero;
+				if (In.Shape == ECullShape::Sphere)
+				{
+					radius = _mm256_loadu_ps(In.pRadius + i);
+				}
+				else
+				{
+					ex = _mm256_loadu_ps(In.pEx + i);
+					ey = _mm256_loadu_ps(In.pEy + i);
+					ez = _mm256_loadu_ps(In.pEz + i);
+				}
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+				{
+					__m256 dist = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl.Nx[p]), cx), _mm256_set1_ps(pl.D[p]));
+					dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(pl.Ny[p]), cy));
+					dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(pl.Nz[p]), cz));
+
+					__m256 reach = radius;
+					if (In.Shape == ECullShape::Aabb)
+					{
+						reach = _mm256_mul_ps(_mm256_set1_ps(pl.AbsNx[p]), ex);
+						reach = _mm256_add_ps(reach, _mm256_mul_ps(_mm256_set1_ps(pl.AbsNy[p]), ey));
+						reach = _mm256_add_ps(reach, _mm256_mul_ps(_mm256_set1_ps(pl.AbsNz[p]), ez));
+					}
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, reach), zero, _CMP_GE_OQ));
+				}
+
+				uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+				while (mask != 0)
+				{
+					Out.push_back(i + static_cast<uint32_t>(std::countr_zero(mask)));
+					mask &= mask - 1;
+				}
+			}
+			return i;
+		}
+
+		/// <summary>
+		/// [Begin, End) の判定。割り切れない端は1つずつ
+		/// </summary>
+		void CullRange(ESimdPath Path, const CullInput& In, uint32_t Begin, uint32_t End, std::vector<uint32_t>& Out)
+		{
+			uint32_t rest = Begin;
+			switch (Path)
+			{
+			case ESimdPath::Avx:
+				rest = CullAvx(In, Begin, End, Out);
+				break;
+			case ESimdPath::Sse:
+				rest = CullSse(In, Begin, End, Out);
+				break;
+			default:
+				break;
+			}
+			CullScalar(In, rest, End, Out);
+		}
+	}
+
+	/// <summary>
+	/// ビュー×プロジェクション行列（行ベクトル、深度 0..1）から作成
+	/// </summary>
+	Frustum Frustum::FromViewProjection(const DirectX::XMFLOAT4X4& ViewProjection)
+	{
+		const auto& m = ViewProjection;
+
+		//	clip = v * M なので、列 j は (m._1j, m._2j, m._3j, m._4j)
+		const float c1[4] = { m._11, m._21, m._31, m._41 };
+		const float c2[4] = { m._12, m._22, m._32, m._42 };
+		const float c3[4] = { m._13, m._23, m._33, m._43 };
+		const float c4[4] = { m._14, m._24, m._34, m._44 };
+
+		Frustum frustum;
+		auto set = [&frustum](EPlane Plane, float A, float B, float C, float D)
+			{
+				const float length = std::sqrt(A * A + B * B + C * C);
+				const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+				frustum.Planes[Plane] = DirectX::XMFLOAT4(A * inv, B * inv, C * inv, D * inv);
+			};
+
+		//	-w <= x <= w, -w <= y <= w, 0 <= z <= w
+		set(Left, c4[0] + c1[0], c4[1] + c1[1], c4[2] + c1[2], c4[3] + c1[3]);
+		set(Right, c4[0] - c1[0], c4[1] - c1[1], c4[2] - c1[2], c4[3] - c1[3]);
+		set(Bottom, c4[0] + c2[0], c4[1] + c2[1], c4[2] + c2[2], c4[3] + c2[3]);
+		set(Top, c4[0] - c2[0], c4[1] - c2[1], c4[2] - c2[2], c4[3] - c2[3]);
+		set(Near, c3[0], c3[1], c3[2], c3[3]);
+		set(Far, c4[0] - c3[0], c4[1] - c3[1], c4[2] - c3[2], c4[3] - c3[3]);
+
+		return frustum;
+	}
+
+	FrustumCuller::FrustumCuller()
+		:mChunkVisible()
+		, mSimdPath(GetSupportedSimdPath())
+		, mLastStats()
+	{
+	}
+
+	/// <summary>
+	/// 判定
+	/// </summary>
+	void FrustumCuller::Cull(const RenderProxyBuffer& Proxies, const Frustum& View, ECullShape Shape, std::vector<uint32_t>& OutVisible)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		OutVisible.clear();
+
+		const uint32_t count = Proxies.GetCount();
+		const uint32_t chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+		PlaneSoA planes;
+		for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+		{
+			planes.Nx[p] = View.Planes[p].x;
+			planes.Ny[p] = View.Planes[p].y;
+			planes.Nz[p] = View.Planes[p].z;
+			planes.D[p] = View.Planes[p].w;
+			planes.AbsNx[p] = std::fabs(View.Planes[p].x);
+			planes.AbsNy[p] = std::fabs(View.Planes[p].y);
+			planes.AbsNz[p] = std::fabs(View.Planes[p].z);
+		}
+
+		const CullInput input =
+		{
+			Proxies.CenterX.data(),
+			Proxies.CenterY.data(),
+			Proxies.CenterZ.data(),
+			Proxies.ExtentX.data(),
+			Proxies.ExtentY.data(),
+			Proxies.ExtentZ.data(),
+			Proxies.Radius.data(),
+			&planes,
+			Shape,
+		};
+
+		//	塊ごとに書き込み先を分けておけば同期がいらない
+		if (mChunkVisible.size() < chunkCount)
+		{
+			mChunkVisible.resize(chunkCount);
+		}
+
+		const ESimdPath path = mSimdPath;
+		auto cullChunks = [this, &input, path, count](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t chunk = Begin; chunk < End; ++chunk)
+				{
+					auto& out = mChunkVisible[chunk];
+					out.clear();
+					const uint32_t first = chunk * CHUNK_SIZE;
+					CullRange(path, input, first, std::min(first + CHUNK_SIZE, count), out);
+				}
+			};
+
+		System::JobSystem::ParallelForOrInline(chunkCount, cullChunks);
+
+		//	塊の順に繋げるので添字は昇順のまま
+		size_t visibleCount = 0;
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			visibleCount += mChunkVisible[chunk].size();
+		}
+		OutVisible.reserve(visibleCount);
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			OutVisible.insert(OutVisible.end(), mChunkVisible[chunk].begin(), mChunkVisible[chunk].end());
+		}
+
+		mLastStats.Tested = count;
+		mLastStats.Visible = static_cast<uint32_t>(OutVisible.size());
+		mLastStats.ChunkCount = chunkCount;
+		mLastStats.Path = path;
+		mLastStats.ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// 使う命令セットの指定（CPUが対応していなければ対応している中で一番近いものになる）
+	/// </summary>
+	void FrustumCuller::SetSimdPath(ESimdPath Path)
+	{
+		mSimdPath = std::min(Path, GetSupportedSimdPath());
+	}
+
+	/// <summary>
+	/// 使う命令セット
+	/// </summary>
+	ESimdPath FrustumCuller::GetSimdPath() const
+	{
+		return mSimdPath;
+	}
+
+	/// <summary>
+	/// 直近の結果
+	/// </summary>
+	const CullingStats& FrustumCuller::GetLastStats() const
+	{
+		return mLastStats;
+	}
+
+	/// <summary>
+	/// CPUが対応している一番速い命令セット
+	/// </summary>
+	ESimdPath FrustumCuller::GetSupportedSimdPath()
+	{
+		return Utility::GetCpuFeatures().Avx ? ESimdPath::Avx : ESimdPath::Sse;
+	}
+}
@@ -0,0 +1,90 @@
+﻿#include "pch.h"
+#include<Graphics/Culling/HiZPyramid.hpp>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 深度バッファから作る
+	/// </summary>
+	/// <param name="Depth">深度（行ごとに詰める）</param>
+	/// <param name="DepthWidth">深度バッファの幅</param>
+	/// <param name="DepthHeight">深度バッファの高さ</param>
+	void HiZPyramid::Build(std::span<const float> Depth, uint32_t DepthWidth, uint32_t DepthHeight)
+	{
+		Mips.clear();
+		Width = 0;
+		Height = 0;
+		if (DepthWidth == 0 || DepthHeight == 0 || Depth.size() < static_cast<size_t>(DepthWidth) * DepthHeight) return;
+
+		Width = GetBaseSize(DepthWidth);
+		Height = GetBaseSize(DepthHeight);
+		Mips.resize(GetMipCount(Width, Height));
+
+		//	ミップ0は深度バッファから、それより上は1つ下のミップから縮小する
+		const float* src = Depth.data();
+		uint32_t srcWidth = DepthWidth;
+		uint32_t srcHeight = DepthHeight;
+
+		for (uint32_t mip = 0; mip < GetMipCount(); ++mip)
+		{
+			const uint32_t dstWidth = GetMipWidth(mip);
+			const uint32_t dstHeight = GetMipHeight(mip);
+			auto& dst = Mips[mip];
+			dst.resize(static_cast<size_t>(dstWidth) * dstHeight);
+
+			for (uint32_t y = 0; y < dstHeight; ++y)
+			{
+				uint32_t y0, y1;
+				GetFootprint(y, srcHeight, dstHeight, y0, y1);
+
+				for (uint32_t x = 0; x < dstWidth; ++x)
+				{
+					uint32_t x0, x1;
+					GetFootprint(x, srcWidth, dstWidth, x0, x1);
+
+					float depth = 0.0f;
+					for (uint32_t sy = y0; sy < y1; ++sy)
+					{
+						for (uint32_t sx = x0; sx < x1; ++sx)
+						{
+							depth = std::max(depth, src[static_cast<size_t>(sy) * srcWidth + sx]);
+						}
+					}
+					dst[static_cast<size_t>(y) * dstWidth + x] = depth;
+				}
+			}
+
+			src = dst.data();
+			srcWidth = dstWidth;
+			srcHeight = dstHeight;
+		}
+	}
+
+	/// <summary>
+	/// 深度バッファの大きさからミップ0の大きさ（2の累乗に切り下げ）
+	/// </summary>
+	uint32_t HiZPyramid::GetBaseSize(uint32_t DepthSize)
+	{
+		uint32_t size = 1;
+		while (size * 2 <= DepthSize)
+		{
+			size *= 2;
+		}
+		return size;
+	}
+
+	/// <summary>
+	/// ミップ0の大きさからミップの数
+	/// </summary>
+	uint32_t HiZPyramid::GetMipCount(uint32_t BaseWidth, uint32_t BaseHeight)
+	{
+		uint32_t count = 1;
+		uint32_t size = std::max(BaseWidth, BaseHeight);
+		while (size > 1)
+		{
+			size /= 2;
+			count++;
+		}
+		return count;
+	}
+}
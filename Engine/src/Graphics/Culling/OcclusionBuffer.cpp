@@ -0,0 +1,526 @@
+﻿#include "pch.h"
+#include<Graphics/Culling/OcclusionBuffer.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<Utility/Simd/CpuFeatures.hpp>
+
+#include<immintrin.h>
+#include<cfloat>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// これより w が小さい頂点は手前の面をまたいでいるとみなす
+		/// </summary>
+		constexpr float NEAR_W = 1e-4f;
+
+		/// <summary>
+		/// 三角形の辺関数と深度の平面（値 = A * x + B * y + C）
+		/// </summary>
+		struct TriangleSetup
+		{
+			float EdgeA[3];
+			float EdgeB[3];
+			float EdgeC[3];
+			float DepthA;
+			float DepthB;
+			float DepthC;
+		};
+
+		/// <summary>
+		/// 箱の三角形（角の番号は x,y,z のビットが + 側）
+		/// </summary>
+		constexpr uint32_t BOX_INDICES[36] =
+		{
+			0, 2, 3, 0, 3, 1,	//	-z
+			4, 5, 7, 4, 7, 6,	//	+z
+			0, 4, 6, 0, 6, 2,	//	-x
+			1, 3, 7, 1, 7, 5,	//	+x
+			0, 1, 5, 0, 5, 4,	//	-y
+			2, 6, 7, 2, 7, 3,	//	+y
+		};
+
+		/// <summary>
+		/// 1ピクセルずつ描く
+		/// </summary>
+		void FillScalar(const TriangleSetup& Setup, float* pDepth, uint32_t Width, uint32_t X0, uint32_t X1, uint32_t Y0, uint32_t Y1)
+		{
+			for (uint32_t y = Y0; y <= Y1; ++y)
+			{
+				const float py = static_cast<float>(y) + 0.5f;
+				float* row = pDepth + static_cast<size_t>(y) * Width;
+				for (uint32_t x = X0; x <= X1; ++x)
+				{
+					const float px = static_cast<float>(x) + 0.5f;
+					const float e0 = Setup.EdgeA[0] * px + Setup.EdgeB[0] * py + Setup.EdgeC[0];
+					const float e1 = Setup.EdgeA[1] * px + Setup.EdgeB[1] * py + Setup.EdgeC[1];
+					const float e2 = Setup.EdgeA[2] * px + Setup.EdgeB[2] * py + Setup.EdgeC[2];
+					if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) continue;
+
+					const float z = Setup.DepthA * px + Setup.DepthB * py + Setup.DepthC;
+					row[x] = std::min(row[x], z);
+				}
+			}
+		}
+
+		/// <summary>
+		/// 横8ピクセルずつ描く（幅は8の倍数なので端の処理はいらない）
+		/// </summary>
+		ECSE_TARGET_AVX2 void FillAvx2(const TriangleSetup& Setup, float* pDepth, uint32_t Width, uint32_t X0, uint32_t X1, uint32_t Y0, uint32_t Y1)
+		{
+			const __m256 lane = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 a0 = _mm256_set1_ps(Setup.EdgeA[0]);
+			const __m256 a1 = _mm256_set1_ps(Setup.EdgeA[1]);
+			const __m256 a2 = _mm256_set1_ps(Setup.EdgeA[2]);
+			const __m256 az = _mm256_set1_ps(Setup.DepthA);
+
+			const uint32_t xStart = X0 & ~(OcclusionBuffer::TILE_SIZE - 1);
+			for (uint32_t y = Y0; y <= Y1; ++y)
+			{
+				const float py = static_cast<float>(y) + 0.5f;
+				const __m256 r0 = _mm256_set1_ps(Setup.EdgeB[0] * py + Setup.EdgeC[0]);
+				const __m256 r1 = _mm256_set1_ps(Setup.EdgeB[1] * py + Setup.EdgeC[1]);
+				const __m256 r2 = _mm256_set1_ps(Setup.EdgeB[2] * py + Setup.EdgeC[2]);
+				const __m256 rz = _mm256_set1_ps(Setup.DepthB * py + Setup.DepthC);
+				float* row = pDepth + static_cast<size_t>(y) * Width;
+
+				for (uint32_t x = xStart; x <= X1; x += 8)
+				{
+					const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane);
+					const __m256 e0 = _mm256_fmadd_ps(a0, px, r0);
+					const __m256 e1 = _mm256_fmadd_ps(a1, px, r1);
+					const __m256 e2 = _mm256_fmadd_ps(a2, px, r2);
+					__m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+					if (_mm256_movemask_ps(inside) == 0) continue;
+
+					const __m256 z = _mm256_fmadd_ps(az, px, rz);
+					const __m256 depth = _mm256_loadu_ps(row + x);
+					_mm256_storeu_ps(row + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+				}
+			}
+		}
+
+		/// <summary>
+		/// タイル内の1行のうち [X0, X1] に Z 以上（より奥）の深度があるか
+		/// </summary>
+		ECSE_TARGET_AVX2 bool AnyFartherAvx2(const float* pRow, uint32_t TileX, uint32_t X0, uint32_t X1, float Z)
+		{
+			const __m256 lane = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(TileX)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+			const __m256 inRange = _mm256_and_ps(
+				_mm256_cmp_ps(lane, _mm256_set1_ps(static_cast<float>(X0)), _CMP_GE_OQ),
+				_mm256_cmp_ps(lane, _mm256_set1_ps(static_cast<float>(X1)), _CMP_LE_OQ));
+			const __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(pRow + TileX), _mm256_set1_ps(Z), _CMP_GE_OQ);
+			return _mm256_movemask_ps(_mm256_and_ps(inRange, farther)) != 0;
+		}
+
+		/// <summary>
+		/// 1ピクセルずつ
+		/// </summary>
+		bool AnyFartherScalar(const float* pRow, uint32_t X0, uint32_t X1, float Z)
+		{
+			for (uint32_t x = X0; x <= X1; ++x)
+			{
+				if (pRow[x] >= Z) return true;
+			}
+			return false;
+		}
+	}
+
+	/// <summary>
+	/// 解像度は TILE_SIZE の倍数に切り上げる
+	/// </summary>
+	OcclusionBuffer::OcclusionBuffer(uint32_t Width, uint32_t Height)
+		:mWidth((std::max(Width, 1u) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE)
+		, mHeight((std::max(Height, 1u) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE)
+		, mTilesX(mWidth / TILE_SIZE)
+		, mTilesY(mHeight / TILE_SIZE)
+		, mViewProjection()
+		, mTriangles()
+		, mClipVertices()
+		, mDepth(static_cast<size_t>(mWidth) * mHeight, 1.0f)
+		, mTileMax(static_cast<size_t>(mTilesX) * mTilesY, 1.0f)
+		, mVisibleFlags()
+		, mUseSimd(Utility::GetCpuFeatures().Avx2 && Utility::GetCpuFeatures().Fma)
+		, mLastStats()
+	{
+		DirectX::XMStoreFloat4x4(&mViewProjection, DirectX::XMMatrixIdentity());
+	}
+
+	/// <summary>
+	/// フレームの開始。遮蔽物をすべて捨てて視点を設定する
+	/// </summary>
+	void OcclusionBuffer::BeginFrame(const DirectX::XMFLOAT4X4& ViewProjection)
+	{
+		mViewProjection = ViewProjection;
+		mTriangles.clear();
+		mLastStats = {};
+	}
+
+	/// <summary>
+	/// 遮蔽物のメッシュを追加（表裏は区別しない）
+	/// </summary>
+	void OcclusionBuffer::AddOccluder(const DirectX::XMFLOAT4X4& World, std::span<const DirectX::XMFLOAT3> Vertices, std::span<const uint32_t> Indices)
+	{
+		using namespace DirectX;
+
+		const XMMATRIX matrix = XMLoadFloat4x4(&World) * XMLoadFloat4x4(&mViewProjection);
+
+		mClipVertices.resize(Vertices.size());
+		for (size_t i = 0; i < Vertices.size(); ++i)
+		{
+			mClipVertices[i] = ToClip(XMLoadFloat3(&Vertices[i]), matrix);
+		}
+
+		for (size_t i = 0; i + 2 < Indices.size(); i += 3)
+		{
+			AddClipTriangle(mClipVertices[Indices[i]], mClipVertices[Indices[i + 1]], mClipVertices[Indices[i + 2]]);
+		}
+	}
+
+	/// <summary>
+	/// 箱の遮蔽物を追加
+	/// </summary>
+	void OcclusionBuffer::AddOccluderBox(const DirectX::XMFLOAT4X4& World, const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents)
+	{
+		using namespace DirectX;
+
+		const XMMATRIX matrix = XMLoadFloat4x4(&World) * XMLoadFloat4x4(&mViewProjection);
+
+		XMFLOAT4 corners[8];
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			const XMVECTOR corner = XMVectorSet(
+				Center.x + ((i & 1) ? Extents.x : -Extents.x),
+				Center.y + ((i & 2) ? Extents.y : -Extents.y),
+				Center.z + ((i & 4) ? Extents.z : -Extents.z),
+				1.0f);
+			corners[i] = ToClip(corner, matrix);
+		}
+
+		for (uint32_t i = 0; i < 36; i += 3)
+		{
+			AddClipTriangle(corners[BOX_INDICES[i]], corners[BOX_INDICES[i + 1]], corners[BOX_INDICES[i + 2]]);
+		}
+	}
+
+	/// <summary>
+	/// FLAG_OCCLUDER が付いたプロキシを箱の遮蔽物として追加
+	/// </summary>
+	void OcclusionBuffer::AddOccluders(const RenderProxyBuffer& Proxies)
+	{
+		for (uint32_t i = 0; i < Proxies.GetCount(); ++i)
+		{
+			if ((Proxies.Flags[i] & RenderProxyBuffer::FLAG_OCCLUDER) == 0) continue;
+			AddOccluderBox(Proxies.World[i], Proxies.LocalCenter[i], Proxies.LocalExtents[i]);
+		}
+	}
+
+	/// <summary>
+	/// 追加した遮蔽物を描いてタイルの深度を作る（タイルの行ごとに並列）
+	/// </summary>
+	void OcclusionBuffer::Rasterize()
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		//	タイル行ごとに書き込み先が分かれるので同期はいらない
+		auto rasterize = [this](uint32_t Begin, uint32_t End) { RasterizeTileRows(Begin, End); };
+		System::JobSystem::ParallelForOrInline(mTilesY, rasterize);
+
+		mLastStats.OccluderTriangles = static_cast<uint32_t>(mTriangles.size());
+		mLastStats.RasterizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// ワールド空間のAABBが少しでも見えているか
+	/// </summary>
+	bool OcclusionBuffer::IsVisible(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents) const
+	{
+		using namespace DirectX;
+
+		const XMMATRIX matrix = XMLoadFloat4x4(&mViewProjection);
+
+		float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+		float maxX = -FLT_MAX, maxY = -FLT_MAX;
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			const XMVECTOR corner = XMVectorSet(
+				Center.x + ((i & 1) ? Extents.x : -Extents.x),
+				Center.y + ((i & 2) ? Extents.y : -Extents.y),
+				Center.z + ((i & 4) ? Extents.z : -Extents.z),
+				1.0f);
+			const XMFLOAT4 clip = ToClip(corner, matrix);
+
+			//	カメラの手前にはみ出している物は判定できないので見えている扱い
+			if (clip.w <= NEAR_W) return true;
+
+			const float invW = 1.0f / clip.w;
+			const float sx = (clip.x * invW * 0.5f + 0.5f) * static_cast<float>(mWidth);
+			const float sy = (0.5f - clip.y * invW * 0.5f) * static_cast<float>(mHeight);
+			minX = std::min(minX, sx);
+			maxX = std::max(maxX, sx);
+			minY = std::min(minY, sy);
+			maxY = std::max(maxY, sy);
+			minZ = std::min(minZ, clip.z * invW);
+		}
+
+		if (minZ <= 0.0f) return true;
+
+		//	画面外は視錐台カリングに任せる
+		if (maxX <= 0.0f || maxY <= 0.0f || minX >= static_cast<float>(mWidth) || minY >= static_cast<float>(mHeight)) return true;
+
+		//	少しでも掛かるピクセルは全て調べる
+		const uint32_t x0 = static_cast<uint32_t>(std::max(std::floor(minX), 0.0f));
+		const uint32_t y0 = static_cast<uint32_t>(std::max(std::floor(minY), 0.0f));
+		const uint32_t x1 = static_cast<uint32_t>(std::min(std::ceil(maxX), static_cast<float>(mWidth))) - 1;
+		const uint32_t y1 = static_cast<uint32_t>(std::min(std::ceil(maxY), static_cast<float>(mHeight))) - 1;
+
+		for (uint32_t ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ++ty)
+		{
+			for (uint32_t tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; ++tx)
+			{
+				//	タイルの一番奥より手前の遮蔽物に覆われている
+				if (mTileMax[static_cast<size_t>(ty) * mTilesX + tx] < minZ) continue;
+
+				const uint32_t tileX = tx * TILE_SIZE;
+				const uint32_t rowBegin = std::max(ty * TILE_SIZE, y0);
+				const uint32_t rowEnd = std::min(ty * TILE_SIZE + TILE_SIZE - 1, y1);
+				const uint32_t colBegin = std::max(tileX, x0);
+				const uint32_t colEnd = std::min(tileX + TILE_SIZE - 1, x1);
+
+				for (uint32_t y = rowBegin; y <= rowEnd; ++y)
+				{
+					const float* row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+					const bool farther = mUseSimd ?
+						AnyFartherAvx2(row, tileX, colBegin, colEnd, minZ) :
+						AnyFartherScalar(row, colBegin, colEnd, minZ);
+					if (farther) return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	/// <summary>
+	/// 見えている添字のうち、隠れているものを取り除く（並列、順序は保つ）
+	/// </summary>
+	void OcclusionBuffer::Cull(const RenderProxyBuffer& Proxies, std::vector<uint32_t>& InOutVisible)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const uint32_t count = static_cast<uint32_t>(InOutVisible.size());
+		mVisibleFlags.resize(count);
+
+		auto test = [this, &Proxies, &InOutVisible](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					const uint32_t index = InOutVisible[i];
+					if (Proxies.Flags[index] & RenderProxyBuffer::FLAG_OCCLUDER)
+					{
+						mVisibleFlags[i] = 1;
+						continue;
+					}
+
+					const DirectX::XMFLOAT3 center(Proxies.CenterX[index], Proxies.CenterY[index], Proxies.CenterZ[index]);
+					const DirectX::XMFLOAT3 extents(Proxies.ExtentX[index], Proxies.ExtentY[index], Proxies.ExtentZ[index]);
+					mVisibleFlags[i] = IsVisible(center, extents) ? 1 : 0;
+				}
+			};
+
+		constexpr uint32_t GRAIN = 1024;
+		System::JobSystem::ParallelForOrInline(count, test, GRAIN);
+
+		//	順序を保ったまま詰める
+		uint32_t write = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (mVisibleFlags[i] != 0) InOutVisible[write++] = InOutVisible[i];
+		}
+		InOutVisible.resize(write);
+
+		mLastStats.Tested = count;
+		mLastStats.Occluded = count - write;
+		mLastStats.TestMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// AVX2 を使うかどうか（CPUが対応していなければ常に使わない）
+	/// </summary>
+	void OcclusionBuffer::SetUseSimd(bool UseSimd)
+	{
+		mUseSimd = UseSimd && Utility::GetCpuFeatures().Avx2 && Utility::GetCpuFeatures().Fma;
+	}
+
+	/// <summary>
+	/// AVX2 を使っているか
+	/// </summary>
+	bool OcclusionBuffer::IsUsingSimd() const
+	{
+		return mUseSimd;
+	}
+
+	/// <summary>
+	/// 横幅
+	/// </summary>
+	uint32_t OcclusionBuffer::GetWidth() const
+	{
+		return mWidth;
+	}
+
+	/// <summary>
+	/// 縦幅
+	/// </summary>
+	uint32_t OcclusionBuffer::GetHeight() const
+	{
+		return mHeight;
+	}
+
+	/// <summary>
+	/// 深度（デバッグ表示用）
+	/// </summary>
+	const std::vector<float>& OcclusionBuffer::GetDepth() const
+	{
+		return mDepth;
+	}
+
+	/// <summary>
+	/// 直近の結果
+	/// </summary>
+	const OcclusionStats& OcclusionBuffer::GetLastStats() const
+	{
+		return mLastStats;
+	}
+
+	/// <summary>
+	/// タイル行 [Begin, End) の消去・描画・タイル深度の作成
+	/// </summary>
+	void OcclusionBuffer::RasterizeTileRows(uint32_t Begin, uint32_t End)
+	{
+		const uint32_t rowBegin = Begin * TILE_SIZE;
+		const uint32_t rowEnd = End * TILE_SIZE;
+
+		std::fill(mDepth.begin() + static_cast<size_t>(rowBegin) * mWidth, mDepth.begin() + static_cast<size_t>(rowEnd) * mWidth, 1.0f);
+
+		const float bandTop = static_cast<float>(rowBegin);
+		const float bandBottom = static_cast<float>(rowEnd);
+		for (const auto& triangle : mTriangles)
+		{
+			if (triangle.MaxY < bandTop || triangle.MinY > bandBottom) continue;
+			RasterizeTriangle(triangle, rowBegin, rowEnd);
+		}
+
+		//	タイルの一番奥の深度
+		for (uint32_t ty = Begin; ty < End; ++ty)
+		{
+			for (uint32_t tx = 0; tx < mTilesX; ++tx)
+			{
+				float farthest = 0.0f;
+				for (uint32_t y = 0; y < TILE_SIZE; ++y)
+				{
+					const float* row = mDepth.data() + static_cast<size_t>(ty * TILE_SIZE + y) * mWidth + tx * TILE_SIZE;
+					farthest = std::max(farthest, *std::max_element(row, row + TILE_SIZE));
+				}
+				mTileMax[static_cast<size_t>(ty) * mTilesX + tx] = farthest;
+			}
+		}
+	}
+
+	/// <summary>
+	/// 三角形をピクセル行 [RowBegin, RowEnd) の範囲だけ描く
+	/// </summary>
+	void OcclusionBuffer::RasterizeTriangle(const ScreenTriangle& Triangle, uint32_t RowBegin, uint32_t RowEnd)
+	{
+		float x[3] = { Triangle.X[0], Triangle.X[1], Triangle.X[2] };
+		float y[3] = { Triangle.Y[0], Triangle.Y[1], Triangle.Y[2] };
+		float z[3] = { Triangle.Z[0], Triangle.Z[1], Triangle.Z[2] };
+
+		//	表裏を問わず面積が正になる向きに揃える
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		if (area < 0.0f)
+		{
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+		if (area < 1e-6f) return;
+
+		//	辺 i は頂点 i の向かい側（値は頂点 i の重み×面積）
+		TriangleSetup setup;
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			const uint32_t a = (i + 1) % 3;
+			const uint32_t b = (i + 2) % 3;
+			setup.EdgeA[i] = y[a] - y[b];
+			setup.EdgeB[i] = x[b] - x[a];
+			setup.EdgeC[i] = -(setup.EdgeA[i] * x[a] + setup.EdgeB[i] * y[a]);
+		}
+
+		const float invArea = 1.0f / area;
+		setup.DepthA = (z[0] * setup.EdgeA[0] + z[1] * setup.EdgeA[1] + z[2] * setup.EdgeA[2]) * invArea;
+		setup.DepthB = (z[0] * setup.EdgeB[0] + z[1] * setup.EdgeB[1] + z[2] * setup.EdgeB[2]) * invArea;
+		setup.DepthC = (z[0] * setup.EdgeC[0] + z[1] * setup.EdgeC[1] + z[2] * setup.EdgeC[2]) * invArea;
+
+		//	ピクセル中心が入る範囲
+		const float minX = std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f);
+		const float maxX = std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f);
+		const float minY = std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f);
+		const float maxY = std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f);
+		if (maxX < 0.0f || maxY < static_cast<float>(RowBegin)) return;
+		if (minX >= static_cast<float>(mWidth) || minY >= static_cast<float>(RowEnd)) return;
+
+		const uint32_t x0 = static_cast<uint32_t>(std::max(minX, 0.0f));
+		const uint32_t x1 = static_cast<uint32_t>(std::min(maxX, static_cast<float>(mWidth - 1)));
+		const uint32_t y0 = static_cast<uint32_t>(std::max(minY, static_cast<float>(RowBegin)));
+		const uint32_t y1 = static_cast<uint32_t>(std::min(maxY, static_cast<float>(RowEnd - 1)));
+		if (x0 > x1 || y0 > y1) return;
+
+		if (mUseSimd)
+		{
+			FillAvx2(setup, mDepth.data(), mWidth, x0, x1, y0, y1);
+		}
+		else
+		{
+			FillScalar(setup, mDepth.data(), mWidth, x0, x1, y0, y1);
+		}
+	}
+
+	/// <summary>
+	/// ワールド座標の頂点をクリップ空間へ
+	/// </summary>
+	DirectX::XMFLOAT4 OcclusionBuffer::ToClip(DirectX::FXMVECTOR Position, DirectX::CXMMATRIX Matrix) const
+	{
+		DirectX::XMFLOAT4 clip;
+		DirectX::XMStoreFloat4(&clip, DirectX::XMVector3Transform(Position, Matrix));
+		return clip;
+	}
+
+	/// <summary>
+	/// クリップ空間の三角形を追加（手前の面をまたぐものは捨てる）
+	/// </summary>
+	void OcclusionBuffer::AddClipTriangle(const DirectX::XMFLOAT4& A, const DirectX::XMFLOAT4& B, const DirectX::XMFLOAT4& C)
+	{
+		//	遮蔽物は描かなくても見え過ぎるだけなので、切り取らずに捨てる
+		if (A.w <= NEAR_W || B.w <= NEAR_W || C.w <= NEAR_W) return;
+		if (A.z < 0.0f || B.z < 0.0f || C.z < 0.0f) return;
+
+		ScreenTriangle triangle;
+		const DirectX::XMFLOAT4* vertices[3] = { &A, &B, &C };
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			const float invW = 1.0f / vertices[i]->w;
+			triangle.X[i] = (vertices[i]->x * invW * 0.5f + 0.5f) * static_cast<float>(mWidth);
+			triangle.Y[i] = (0.5f - vertices[i]->y * invW * 0.5f) * static_cast<float>(mHeight);
+			triangle.Z[i] = vertices[i]->z * invW;
+		}
+		triangle.MinY = std::min({ triangle.Y[0], triangle.Y[1], triangle.Y[2] });
+		triangle.MaxY = std::max({ triangle.Y[0], triangle.Y[1], triangle.Y[2] });
+
+		mTriangles.push_back(triangle);
+	}
+}
@@ -0,0 +1,670 @@
+﻿#include "pch.h"
+#include<Graphics/Culling/StaticBvh.hpp>
+#include<Graphics/Culling/FrustumCulling.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<immintrin.h>
+#include<bit>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// 判定用に並べ替えた視錐台の平面
+	/// </summary>
+	struct StaticBvh::PlaneSet
+	{
+		__m128 Nx[Frustum::PLANE_COUNT];
+		__m128 Ny[Frustum::PLANE_COUNT];
+		__m128 Nz[Frustum::PLANE_COUNT];
+		__m128 D[Frustum::PLANE_COUNT];
+		__m128 AbsNx[Frustum::PLANE_COUNT];
+		__m128 AbsNy[Frustum::PLANE_COUNT];
+		__m128 AbsNz[Frustum::PLANE_COUNT];
+		//	葉の中の物を1つずつ判定する用
+		DirectX::XMFLOAT4 Planes[Frustum::PLANE_COUNT];
+	};
+
+	namespace
+	{
+		/// <summary>
+		/// 0 で割った時の代わりの値（inf * 0 の NaN を避ける）
+		/// </summary>
+		constexpr float INV_DIRECTION_LIMIT = 1e30f;
+
+		/// <summary>
+		/// 空きでない子のレーン
+		/// </summary>
+		__m128 ValidMask(const uint32_t* pChild, uint32_t EmptyChild)
+		{
+			const __m128i child = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pChild));
+			const __m128i empty = _mm_cmpeq_epi32(child, _mm_set1_epi32(static_cast<int>(EmptyChild)));
+			return _mm_castsi128_ps(_mm_andnot_si128(empty, _mm_set1_epi32(-1)));
+		}
+
+		/// <summary>
+		/// 箱1つと視錐台
+		/// </summary>
+		bool IntersectsFrustum(const DirectX::XMFLOAT4* pPlanes, const Aabb& Bounds)
+		{
+			const DirectX::XMFLOAT3 center = Bounds.Center();
+			const DirectX::XMFLOAT3 extents((Bounds.Max.x - Bounds.Min.x) * 0.5f, (Bounds.Max.y - Bounds.Min.y) * 0.5f, (Bounds.Max.z - Bounds.Min.z) * 0.5f);
+			for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+			{
+				const auto& pl = pPlanes[p];
+				const float dist = pl.x * center.x + pl.y * center.y + pl.z * center.z + pl.w;
+				const float reach = std::fabs(pl.x) * extents.x + std::fabs(pl.y) * extents.y + std::fabs(pl.z) * extents.z;
+				if (dist + reach < 0.0f) return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// 箱1つと光線（当たった距離、外れたら負）
+		/// </summary>
+		float IntersectRay(const Aabb& Bounds, const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& InvDirection, float MaxT)
+		{
+			const float tx1 = (Bounds.Min.x - Origin.x) * InvDirection.x;
+			const float tx2 = (Bounds.Max.x - Origin.x) * InvDirection.x;
+			const float ty1 = (Bounds.Min.y - Origin.y) * InvDirection.y;
+			const float ty2 = (Bounds.Max.y - Origin.y) * InvDirection.y;
+			const float tz1 = (Bounds.Min.z - Origin.z) * InvDirection.z;
+			const float tz2 = (Bounds.Max.z - Origin.z) * InvDirection.z;
+
+			const float tMin = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+			const float tMax = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), MaxT });
+			return tMin <= tMax ? tMin : -1.0f;
+		}
+
+		/// <summary>
+		/// 光線の向きの逆数
+		/// </summary>
+		DirectX::XMFLOAT3 InverseDirection(const DirectX::XMFLOAT3& Direction)
+		{
+			auto inv = [](float V)
+				{
+					if (std::fabs(V) < 1.0f / INV_DIRECTION_LIMIT) return std::signbit(V) ? -INV_DIRECTION_LIMIT : INV_DIRECTION_LIMIT;
+					return 1.0f / V;
+				};
+			return { inv(Direction.x), inv(Direction.y), inv(Direction.z) };
+		}
+	}
+
+	StaticBvh::StaticBvh()
+		:mNodes()
+		, mPrimitives()
+		, mBounds()
+		, mLastBuildMs(0.0)
+	{
+	}
+
+	/// <summary>
+	/// 作成（以前の内容は捨てる）
+	/// </summary>
+	void StaticBvh::Build(std::span<const Aabb> Bounds)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		Clear();
+		if (Bounds.empty() == true) return;
+
+		const uint32_t count = static_cast<uint32_t>(Bounds.size());
+		mBounds.assign(Bounds.begin(), Bounds.end());
+		mPrimitives.resize(count);
+		std::iota(mPrimitives.begin(), mPrimitives.end(), 0u);
+
+		std::vector<DirectX::XMFLOAT3> centers(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			centers[i] = Bounds[i].Center();
+		}
+
+		std::vector<BuildNode> binary;
+		binary.reserve(static_cast<size_t>(count) * 2 / MAX_LEAF_SIZE + 1);
+		const uint32_t root = BuildBinary(binary, Bounds, centers, 0, count);
+
+		mNodes.reserve(binary.size() / 3 + 1);
+		Collapse(binary, root);
+
+		mLastBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// 全ての削除
+	/// </summary>
+	void StaticBvh::Clear()
+	{
+		mNodes.clear();
+		mPrimitives.clear();
+		mBounds.clear();
+	}
+
+	/// <summary>
+	/// 視錐台に掛かる物を集める（上の方の枝ごとに並列）
+	/// </summary>
+	void StaticBvh::QueryFrustum(const Frustum& View, std::vector<uint32_t>& Out) const
+	{
+		Out.clear();
+		if (mNodes.empty() == true) return;
+
+		PlaneSet planes;
+		for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+		{
+			const auto& pl = View.Planes[p];
+			planes.Nx[p] = _mm_set1_ps(pl.x);
+			planes.Ny[p] = _mm_set1_ps(pl.y);
+			planes.Nz[p] = _mm_set1_ps(pl.z);
+			planes.D[p] = _mm_set1_ps(pl.w);
+			planes.AbsNx[p] = _mm_set1_ps(std::fabs(pl.x));
+			planes.AbsNy[p] = _mm_set1_ps(std::fabs(pl.y));
+			planes.AbsNz[p] = _mm_set1_ps(std::fabs(pl.z));
+			planes.Planes[p] = pl;
+		}
+
+		auto* pJobs = System::ServiceLocator::Get<System::JobSystem>();
+		const uint32_t taskTarget = pJobs != nullptr ? (pJobs->GetWorkerCount() + 1) * 4 : 1;
+
+		//	上の方は1スレッドで広げて、枝が十分に増えたら並列に分ける
+		std::vector<uint32_t> frontier = { 0 };
+		std::vector<uint32_t> next;
+		while (frontier.empty() == false && frontier.size() < taskTarget)
+		{
+			next.clear();
+			for (uint32_t node : frontier)
+			{
+				VisitFrustumNode(planes, node, Out, next);
+			}
+			frontier.swap(next);
+		}
+		if (frontier.empty() == true) return;
+
+		std::vector<std::vector<uint32_t>> results(frontier.size());
+		auto traverse = [this, &planes, &frontier, &results](uint32_t Begin, uint32_t End)
+			{
+				std::vector<uint32_t> stack;
+				stack.reserve(64);
+				for (uint32_t task = Begin; task < End; ++task)
+				{
+					stack.push_back(frontier[task]);
+					while (stack.empty() == false)
+					{
+						const uint32_t node = stack.back();
+						stack.pop_back();
+						VisitFrustumNode(planes, node, results[task], stack);
+					}
+				}
+			};
+
+		if (pJobs != nullptr)
+		{
+			pJobs->ParallelFor(static_cast<uint32_t>(frontier.size()), traverse);
+		}
+		else
+		{
+			traverse(0, static_cast<uint32_t>(frontier.size()));
+		}
+
+		for (const auto& result : results)
+		{
+			Out.insert(Out.end(), result.begin(), result.end());
+		}
+	}
+
+	/// <summary>
+	/// 箱に重なる物を集める
+	/// </summary>
+	void StaticBvh::QueryAabb(const Aabb& Bounds, std::vector<uint32_t>& Out) const
+	{
+		if (mNodes.empty() == true) return;
+
+		const __m128 qMinX = _mm_set1_ps(Bounds.Min.x), qMinY = _mm_set1_ps(Bounds.Min.y), qMinZ = _mm_set1_ps(Bounds.Min.z);
+		const __m128 qMaxX = _mm_set1_ps(Bounds.Max.x), qMaxY = _mm_set1_ps(Bounds.Max.y), qMaxZ = _mm_set1_ps(Bounds.Max.z);
+
+		std::vector<uint32_t> stack;
+		stack.reserve(64);
+		stack.push_back(0);
+		while (stack.empty() == false)
+		{
+			const Node4& node = mNodes[stack.back()];
+			stack.pop_back();
+
+			__m128 overlap = ValidMask(node.Child, EMPTY_CHILD);
+			overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_load_ps(node.MinX), qMaxX));
+			overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_load_ps(node.MinY), qMaxY));
+			overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_load_ps(node.MinZ), qMaxZ));
+			overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_load_ps(node.MaxX), qMinX));
+			overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_load_ps(node.MaxY), qMinY));
+			overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_load_ps(node.MaxZ), qMinZ));
+
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(overlap));
+			while (mask != 0)
+			{
+				const uint32_t lane = static_cast<uint32_t>(std::countr_zero(mask));
+				mask &= mask - 1;
+
+				if (node.Count[lane] == 0)
+				{
+					stack.push_back(node.Child[lane]);
+					continue;
+				}
+
+				const uint32_t first = node.Child[lane] & ~LEAF_BIT;
+				for (uint32_t i = first; i < first + node.Count[lane]; ++i)
+				{
+					if (mBounds[mPrimitives[i]].Overlaps(Bounds)) Out.push_back(mPrimitives[i]);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// 一番手前で光線が当たる物
+	/// </summary>
+	RayHit StaticBvh::Raycast(const Ray& Query) const
+	{
+		RayHit hit;
+		hit.T = Query.MaxT;
+		if (mNodes.empty() == true) return { RayHit::INVALID_INDEX, FLT_MAX };
+
+		const DirectX::XMFLOAT3 invDirection = InverseDirection(Query.Direction);
+		const __m128 ox = _mm_set1_ps(Query.Origin.x), oy = _mm_set1_ps(Query.Origin.y), oz = _mm_set1_ps(Query.Origin.z);
+		const __m128 ix = _mm_set1_ps(invDirection.x), iy = _mm_set1_ps(invDirection.y), iz = _mm_set1_ps(invDirection.z);
+
+		//	節の添字と、そこに入った距離
+		std::vector<std::pair<uint32_t, float>> stack;
+		stack.reserve(64);
+		stack.emplace_back(0, 0.0f);
+		while (stack.empty() == false)
+		{
+			const auto [index, entry] = stack.back();
+			stack.pop_back();
+			if (entry > hit.T) continue;
+
+			const Node4& node = mNodes[index];
+			const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinX), ox), ix);
+			const __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxX), ox), ix);
+			const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinY), oy), iy);
+			const __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxY), oy), iy);
+			const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinZ), oz), iz);
+			const __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxZ), oz), iz);
+
+			__m128 tMin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_max_ps(_mm_min_ps(tz1, tz2), _mm_setzero_ps()));
+			__m128 tMax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_min_ps(_mm_max_ps(tz1, tz2), _mm_set1_ps(hit.T)));
+			const __m128 hitMask = _mm_and_ps(ValidMask(node.Child, EMPTY_CHILD), _mm_cmple_ps(tMin, tMax));
+
+			alignas(16) float entries[4];
+			_mm_store_ps(entries, tMin);
+
+			//	奥の節から積んで、手前の節を先に調べる
+			uint32_t lanes[4];
+			uint32_t laneCount = 0;
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(hitMask));
+			while (mask != 0)
+			{
+				lanes[laneCount++] = static_cast<uint32_t>(std::countr_zero(mask));
+				mask &= mask - 1;
+			}
+			std::sort(lanes, lanes + laneCount, [&entries](uint32_t A, uint32_t B) { return entries[A] > entries[B]; });
+
+			for (uint32_t l = 0; l < laneCount; ++l)
+			{
+				const uint32_t lane = lanes[l];
+				if (node.Count[lane] == 0)
+				{
+					stack.emplace_back(node.Child[lane], entries[lane]);
+					continue;
+				}
+
+				const uint32_t first = node.Child[lane] & ~LEAF_BIT;
+				for (uint32_t i = first; i < first + node.Count[lane]; ++i)
+				{
+					const float t = IntersectRay(mBounds[mPrimitives[i]], Query.Origin, invDirection, hit.T);
+					if (t >= 0.0f && (hit.IsHit() == false || t < hit.T))
+					{
+						hit.Index = mPrimitives[i];
+						hit.T = t;
+					}
+				}
+			}
+		}
+
+		if (hit.IsHit() == false) hit.T = FLT_MAX;
+		return hit;
+	}
+
+	/// <summary>
+	/// 複数の箱の検索を並列に行う
+	/// </summary>
+	void StaticBvh::QueryAabbBatch(std::span<const Aabb> Queries, std::vector<std::vector<uint32_t>>& Out) const
+	{
+		Out.resize(Queries.size());
+
+		auto query = [this, &Queries, &Out](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					Out[i].clear();
+					QueryAabb(Queries[i], Out[i]);
+				}
+			};
+
+		constexpr uint32_t GRAIN = 64;
+		System::JobSystem::ParallelForOrInline(static_cast<uint32_t>(Queries.size()), query, GRAIN);
+	}
+
+	/// <summary>
+	/// 複数の光線の判定を並列に行う
+	/// </summary>
+	void StaticBvh::RaycastBatch(std::span<const Ray> Queries, std::span<RayHit> Out) const
+	{
+		assert(Out.size() >= Queries.size());
+
+		auto cast = [this, &Queries, &Out](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					Out[i] = Raycast(Queries[i]);
+				}
+			};
+
+		constexpr uint32_t GRAIN = 64;
+		System::JobSystem::ParallelForOrInline(static_cast<uint32_t>(Queries.size()), cast, GRAIN);
+	}
+
+	/// <summary>
+	/// 節の数
+	/// </summary>
+	uint32_t StaticBvh::GetNodeCount() const
+	{
+		return static_cast<uint32_t>(mNodes.size());
+	}
+
+	/// <summary>
+	/// 物の数
+	/// </summary>
+	uint32_t StaticBvh::GetPrimitiveCount() const
+	{
+		return static_cast<uint32_t>(mPrimitives.size());
+	}
+
+	/// <summary>
+	/// 直近の Build にかかった時間（ミリ秒）
+	/// </summary>
+	double StaticBvh::GetLastBuildMs() const
+	{
+		return mLastBuildMs;
+	}
+
+	/// <summary>
+	/// [First, First + Count) の物で2分木を作る
+	/// </summary>
+	uint32_t StaticBvh::BuildBinary(std::vector<BuildNode>& Nodes, std::span<const Aabb> Bounds, std::vector<DirectX::XMFLOAT3>& Centers, uint32_t First, uint32_t Count)
+	{
+		const uint32_t index = static_cast<uint32_t>(Nodes.size());
+		Nodes.push_back({ {}, EMPTY_CHILD, EMPTY_CHILD, First, Count });
+
+		Aabb bounds;
+		Aabb centerBounds;
+		for (uint32_t i = First; i < First + Count; ++i)
+		{
+			const uint32_t prim = mPrimitives[i];
+			bounds = Aabb::Union(bounds, Bounds[prim]);
+			centerBounds = Aabb::Union(centerBounds, { Centers[prim], Centers[prim] });
+		}
+		Nodes[index].Bounds = bounds;
+
+		if (Count <= MAX_LEAF_SIZE) return index;
+
+		//	3軸それぞれビンに分けて、一番安い分け方を探す
+		struct Bin
+		{
+			Aabb Bounds;
+			uint32_t Count = 0;
+		};
+
+		const float centerMin[3] = { centerBounds.Min.x, centerBounds.Min.y, centerBounds.Min.z };
+		const float centerMax[3] = { centerBounds.Max.x, centerBounds.Max.y, centerBounds.Max.z };
+
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float extent = centerMax[axis] - centerMin[axis];
+			if (extent <= 0.0f) continue;
+
+			const float scale = static_cast<float>(BIN_COUNT) / extent;
+			std::array<Bin, BIN_COUNT> bins;
+			for (uint32_t i = First; i < First + Count; ++i)
+			{
+				const uint32_t prim = mPrimitives[i];
+				const float c = (&Centers[prim].x)[axis];
+				const uint32_t b = std::min(static_cast<uint32_t>((c - centerMin[axis]) * scale), BIN_COUNT - 1);
+				bins[b].Bounds = Aabb::Union(bins[b].Bounds, Bounds[prim]);
+				bins[b].Count++;
+			}
+
+			//	右から累積した面積と数
+			std::array<float, BIN_COUNT> rightArea;
+			std::array<uint32_t, BIN_COUNT> rightCount;
+			Aabb acc;
+			uint32_t accCount = 0;
+			for (uint32_t b = BIN_COUNT - 1; b > 0; --b)
+			{
+				acc = Aabb::Union(acc, bins[b].Bounds);
+				accCount += bins[b].Count;
+				rightArea[b] = acc.SurfaceArea();
+				rightCount[b] = accCount;
+			}
+
+			acc = {};
+			accCount = 0;
+			for (uint32_t b = 0; b < BIN_COUNT - 1; ++b)
+			{
+				acc = Aabb::Union(acc, bins[b].Bounds);
+				accCount += bins[b].Count;
+				if (accCount == 0 || rightCount[b + 1] == 0) continue;
+
+				const float cost = acc.SurfaceArea() * static_cast<float>(accCount) + rightArea[b + 1] * static_cast<float>(rightCount[b + 1]);
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		uint32_t mid = First + Count / 2;
+		if (bestAxis >= 0)
+		{
+			const float scale = static_cast<float>(BIN_COUNT) / (centerMax[bestAxis] - centerMin[bestAxis]);
+			const float minimum = centerMin[bestAxis];
+			auto begin = mPrimitives.begin() + First;
+			auto it = std::partition(begin, begin + Count, [&](uint32_t Prim)
+				{
+					const float c = (&Centers[Prim].x)[bestAxis];
+					return std::min(static_cast<uint32_t>((c - minimum) * scale), BIN_COUNT - 1) <= bestSplit;
+				});
+			mid = static_cast<uint32_t>(it - mPrimitives.begin());
+		}
+
+		//	中心が全て同じ位置などで分けられない時は半分にする
+		if (mid == First || mid == First + Count)
+		{
+			mid = First + Count / 2;
+		}
+
+		const uint32_t left = BuildBinary(Nodes, Bounds, Centers, First, mid - First);
+		const uint32_t right = BuildBinary(Nodes, Bounds, Centers, mid, First + Count - mid);
+		Nodes[index].Left = left;
+		Nodes[index].Right = right;
+		return index;
+	}
+
+	/// <summary>
+	/// 2分木の節を4分木の節へ潰す
+	/// </summary>
+	uint32_t StaticBvh::Collapse(const std::vector<BuildNode>& Nodes, uint32_t Binary)
+	{
+		const uint32_t index = static_cast<uint32_t>(mNodes.size());
+		mNodes.emplace_back();
+
+		auto isLeaf = [&Nodes](uint32_t Node) { return Nodes[Node].Left == EMPTY_CHILD; };
+
+		//	子が4つになるまで、一番大きい節を孫に開く
+		uint32_t children[4] = {};
+		uint32_t childCount = 0;
+		if (isLeaf(Binary))
+		{
+			children[childCount++] = Binary;
+		}
+		else
+		{
+			children[childCount++] = Nodes[Binary].Left;
+			children[childCount++] = Nodes[Binary].Right;
+		}
+
+		while (childCount < 4)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (uint32_t i = 0; i < childCount; ++i)
+			{
+				if (isLeaf(children[i])) continue;
+				const float area = Nodes[children[i]].Bounds.SurfaceArea();
+				if (area > largestArea)
+				{
+					largestArea = area;
+					largest = static_cast<int>(i);
+				}
+			}
+			if (largest < 0) break;
+
+			const uint32_t opened = children[largest];
+			children[largest] = Nodes[opened].Left;
+			children[childCount++] = Nodes[opened].Right;
+		}
+
+		//	子の節を先に作るので、mNodes の再確保後に書き込む
+		uint32_t childIndex[4] = { EMPTY_CHILD, EMPTY_CHILD, EMPTY_CHILD, EMPTY_CHILD };
+		for (uint32_t i = 0; i < childCount; ++i)
+		{
+			if (isLeaf(children[i]) == false)
+			{
+				childIndex[i] = Collapse(Nodes, children[i]);
+			}
+		}
+
+		Node4& node = mNodes[index];
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i >= childCount)
+			{
+				node.MinX[i] = node.MinY[i] = node.MinZ[i] = FLT_MAX;
+				node.MaxX[i] = node.MaxY[i] = node.MaxZ[i] = -FLT_MAX;
+				node.Child[i] = EMPTY_CHILD;
+				node.Count[i] = 0;
+				continue;
+			}
+
+			const BuildNode& child = Nodes[children[i]];
+			node.MinX[i] = child.Bounds.Min.x;
+			node.MinY[i] = child.Bounds.Min.y;
+			node.MinZ[i] = child.Bounds.Min.z;
+			node.MaxX[i] = child.Bounds.Max.x;
+			node.MaxY[i] = child.Bounds.Max.y;
+			node.MaxZ[i] = child.Bounds.Max.z;
+			if (isLeaf(children[i]))
+			{
+				node.Child[i] = LEAF_BIT | child.First;
+				node.Count[i] = child.Count;
+			}
+			else
+			{
+				node.Child[i] = childIndex[i];
+				node.Count[i] = 0;
+			}
+		}
+
+		return index;
+	}
+
+	/// <summary>
+	/// 枝以下の物を判定せずに全て集める
+	/// </summary>
+	void StaticBvh::AppendAll(uint32_t Child, uint32_t Count, std::vector<uint32_t>& Out) const
+	{
+		if (Count != 0)
+		{
+			const uint32_t first = Child & ~LEAF_BIT;
+			Out.insert(Out.end(), mPrimitives.begin() + first, mPrimitives.begin() + first + Count);
+			return;
+		}
+
+		const Node4& node = mNodes[Child];
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (node.Child[i] == EMPTY_CHILD) continue;
+			AppendAll(node.Child[i], node.Count[i], Out);
+		}
+	}
+
+	/// <summary>
+	/// 節の子4つを視錐台で判定する
+	/// </summary>
+	void StaticBvh::VisitFrustumNode(const PlaneSet& Planes, uint32_t Node, std::vector<uint32_t>& Out, std::vector<uint32_t>& Next) const
+	{
+		const Node4& node = mNodes[Node];
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 minX = _mm_load_ps(node.MinX), maxX = _mm_load_ps(node.MaxX);
+		const __m128 minY = _mm_load_ps(node.MinY), maxY = _mm_load_ps(node.MaxY);
+		const __m128 minZ = _mm_load_ps(node.MinZ), maxZ = _mm_load_ps(node.MaxZ);
+		const __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half), ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+		const __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half), ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+		const __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half), ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+		const __m128 zero = _mm_setzero_ps();
+
+		const __m128 valid = ValidMask(node.Child, EMPTY_CHILD);
+		__m128 intersect = valid;
+		__m128 inside = valid;
+		for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+		{
+			__m128 dist = _mm_add_ps(_mm_mul_ps(Planes.Nx[p], cx), Planes.D[p]);
+			dist = _mm_add_ps(dist, _mm_mul_ps(Planes.Ny[p], cy));
+			dist = _mm_add_ps(dist, _mm_mul_ps(Planes.Nz[p], cz));
+			__m128 reach = _mm_mul_ps(Planes.AbsNx[p], ex);
+			reach = _mm_add_ps(reach, _mm_mul_ps(Planes.AbsNy[p], ey));
+			reach = _mm_add_ps(reach, _mm_mul_ps(Planes.AbsNz[p], ez));
+
+			intersect = _mm_and_ps(intersect, _mm_cmpge_ps(_mm_add_ps(dist, reach), zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_sub_ps(dist, reach), zero));
+		}
+
+		const uint32_t insideMask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(intersect));
+		while (mask != 0)
+		{
+			const uint32_t lane = static_cast<uint32_t>(std::countr_zero(mask));
+			mask &= mask - 1;
+
+			//	丸ごと入っている枝はもう判定しない
+			if (insideMask & (1u << lane))
+			{
+				AppendAll(node.Child[lane], node.Count[lane], Out);
+				continue;
+			}
+
+			if (node.Count[lane] == 0)
+			{
+				Next.push_back(node.Child[lane]);
+				continue;
+			}
+
+			const uint32_t first = node.Child[lane] & ~LEAF_BIT;
+			for (uint32_t i = first; i < first + node.Count[lane]; ++i)
+			{
+				if (IntersectsFrustum(Planes.Planes, mBounds[mPrimitives[i]])) Out.push_back(mPrimitives[i]);
+			}
+		}
+	}
+}
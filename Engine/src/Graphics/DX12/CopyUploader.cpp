@@ -0,0 +1,372 @@
+﻿#include "pch.h"
+#include<Graphics/DX12/CopyUploader.hpp>
+
+namespace Ecse::Graphics
+{
+	CopyUploader::CopyUploader()
+		:mQueue(nullptr)
+		, mAllocators()
+		, mAllocatorFences()
+		, mCmdList(nullptr)
+		, mAllocatorIndex(0)
+		, mIsRecording(false)
+		, mFence(nullptr)
+		, mFenceValue(0)
+		, mCompletedValue(0)
+		, mFenceEvent(nullptr)
+		, mStaging(nullptr)
+		, mpStaging(nullptr)
+		, mStagingSize(0)
+		, mStagingHead(0)
+		, mStagingTail(0)
+		, mInFlight()
+	{
+		mAllocatorFences.fill(0);
+	}
+
+	CopyUploader::~CopyUploader()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// キュー・アロケーター・フェンス・ステージングの作成
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="StagingSize">ステージングリングの大きさ（バイト）</param>
+	/// <param name="Name">キューの名前（デバッグ用）</param>
+	/// <returns>true:成功</returns>
+	bool CopyUploader::Initialize(ID3D12Device* Device, uint64_t StagingSize, const wchar_t* Name)
+	{
+		Release();
+		if (Device == nullptr || StagingSize == 0) return false;
+
+		D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+		queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+		queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		HRESULT hr = Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&mQueue));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommandQueue (CopyUploader).");
+			return false;
+		}
+		if (Name != nullptr) mQueue->SetName(Name);
+
+		for (auto& allocator : mAllocators)
+		{
+			hr = Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator));
+			if (FAILED(hr))
+			{
+				ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommandAllocator (CopyUploader).");
+				Release();
+				return false;
+			}
+		}
+
+		hr = Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, mAllocators[0].Get(), nullptr, IID_PPV_ARGS(&mCmdList));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommandList (CopyUploader).");
+			Release();
+			return false;
+		}
+		//	Begin で開き直す
+		mCmdList->Close();
+
+		hr = Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateFence (CopyUploader).");
+			Release();
+			return false;
+		}
+		mFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (mFenceEvent == nullptr)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateEvent (CopyUploader).");
+			Release();
+			return false;
+		}
+
+		//	切り出す位置が常に配置の境界になるように丸める
+		const uint64_t alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+		const uint64_t size = (StagingSize + alignment - 1) & ~(alignment - 1);
+
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = size;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		hr = Device->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mStaging)
+		);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommittedResource (CopyUploader Staging).");
+			Release();
+			return false;
+		}
+
+		D3D12_RANGE readRange = { 0, 0 };
+		void* mapped = nullptr;
+		hr = mStaging->Map(0, &readRange, &mapped);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed Map (CopyUploader Staging).");
+			Release();
+			return false;
+		}
+
+		mpStaging = static_cast<uint8_t*>(mapped);
+		mStagingSize = size;
+		mStagingHead = 0;
+		mStagingTail = 0;
+		return true;
+	}
+
+	/// <summary>
+	/// 転送中のものを待ってから解放
+	/// </summary>
+	void CopyUploader::Release()
+	{
+		if (mFence != nullptr && mFenceEvent != nullptr)
+		{
+			Wait(mFenceValue);
+		}
+
+		if (mIsRecording == true && mCmdList != nullptr)
+		{
+			mCmdList->Close();
+		}
+		mIsRecording = false;
+
+		if (mStaging != nullptr && mpStaging != nullptr)
+		{
+			mStaging->Unmap(0, nullptr);
+		}
+		mStaging.Reset();
+		mpStaging = nullptr;
+		mStagingSize = 0;
+		mStagingHead = 0;
+		mStagingTail = 0;
+		mInFlight.clear();
+
+		if (mFenceEvent != nullptr)
+		{
+			CloseHandle(mFenceEvent);
+			mFenceEvent = nullptr;
+		}
+		mFence.Reset();
+		mFenceValue = 0;
+		mCompletedValue = 0;
+
+		mCmdList.Reset();
+		for (auto& allocator : mAllocators)
+		{
+			allocator.Reset();
+		}
+		mAllocatorFences.fill(0);
+		mAllocatorIndex = 0;
+		mQueue.Reset();
+	}
+
+	/// <summary>
+	/// フェンスを覗いて、完了した送信のステージングを空ける（待たない）
+	/// </summary>
+	/// <returns>完了したフェンスの値</returns>
+	uint64_t CopyUploader::Poll()
+	{
+		if (mFence == nullptr) return 0;
+
+		mCompletedValue = mFence->GetCompletedValue();
+		while (mInFlight.empty() == false && mInFlight.front().FenceValue <= mCompletedValue)
+		{
+			mStagingTail = mInFlight.front().StagingEnd;
+			mInFlight.pop_front();
+		}
+		return mCompletedValue;
+	}
+
+	/// <summary>
+	/// 記録を始める。次のアロケーターがまだ転送中なら false（既に記録中なら true）
+	/// </summary>
+	bool CopyUploader::Begin()
+	{
+		if (mIsRecording == true) return true;
+		if (mCmdList == nullptr) return false;
+
+		//	直近に覗いた値で判断する。待たない
+		if (mAllocatorFences[mAllocatorIndex] > mCompletedValue) return false;
+
+		mAllocators[mAllocatorIndex]->Reset();
+		mCmdList->Reset(mAllocators[mAllocatorIndex].Get(), nullptr);
+		mIsRecording = true;
+		return true;
+	}
+
+	/// <summary>
+	/// 記録中か
+	/// </summary>
+	bool CopyUploader::IsRecording() const
+	{
+		return mIsRecording;
+	}
+
+	/// <summary>
+	/// ステージングからの切り出し（空きがなければ INVALID_OFFSET）
+	/// </summary>
+	/// <param name="Size">大きさ（バイト）</param>
+	/// <param name="Alignment">配置（2の累乗）</param>
+	uint64_t CopyUploader::AllocateStaging(uint64_t Size, uint64_t Alignment)
+	{
+		if (mpStaging == nullptr || Size == 0 || Size > mStagingSize) return INVALID_OFFSET;
+		if (Alignment == 0) Alignment = 1;
+
+		uint64_t head = mStagingHead;
+		uint64_t offset = ((head % mStagingSize) + Alignment - 1) & ~(Alignment - 1);
+
+		//	末尾に収まらなければ先頭まで読み飛ばす
+		if (offset + Size > mStagingSize)
+		{
+			head += mStagingSize - (head % mStagingSize);
+			offset = 0;
+		}
+		else
+		{
+			head += offset - (head % mStagingSize);
+		}
+
+		//	転送中の領域に追いついたら失敗。呼ぶ側は次のフレームへ回す
+		if (head + Size - mStagingTail > mStagingSize) return INVALID_OFFSET;
+
+		mStagingHead = head + Size;
+		return offset;
+	}
+
+	/// <summary>
+	/// 記録を閉じて送り、フェンスを進める（記録していなければフェンスだけ）
+	/// </summary>
+	/// <returns>この送信が終わった時のフェンスの値</returns>
+	uint64_t CopyUploader::Submit()
+	{
+		if (mFence == nullptr) return 0;
+
+		//	記録していなくてもフェンスは進める（キューに積んだタイルの割り当ての完了を知るため）
+		const bool recorded = mIsRecording;
+		if (recorded == true)
+		{
+			mIsRecording = false;
+
+			const HRESULT hr = mCmdList->Close();
+			if (FAILED(hr))
+			{
+				ECSE_LOG(System::ELogLevel::Error, "Failed Close (CopyUploader).");
+			}
+			else
+			{
+				ID3D12CommandList* lists[] = { mCmdList.Get() };
+				mQueue->ExecuteCommandLists(1, lists);
+			}
+		}
+
+		//	失敗しても値は進めて、待っている側が止まらないようにする
+		mFenceValue++;
+		mQueue->Signal(mFence.Get(), mFenceValue);
+
+		if (recorded == true)
+		{
+			mAllocatorFences[mAllocatorIndex] = mFenceValue;
+			mAllocatorIndex = (mAllocatorIndex + 1) % ALLOCATOR_COUNT;
+		}
+		mInFlight.push_back({ mFenceValue, mStagingHead });
+		return mFenceValue;
+	}
+
+	/// <summary>
+	/// フェンスがその値になるまで待つ（初期化と終了の時だけ）
+	/// </summary>
+	void CopyUploader::Wait(uint64_t FenceValue)
+	{
+		if (mFence == nullptr) return;
+
+		if (mFence->GetCompletedValue() < FenceValue)
+		{
+			mFence->SetEventOnCompletion(FenceValue, mFenceEvent);
+			WaitForSingleObject(mFenceEvent, INFINITE);
+		}
+		Poll();
+	}
+
+	/// <summary>
+	/// 切り出した位置の書き込み先
+	/// </summary>
+	uint8_t* CopyUploader::GetStagingPointer(uint64_t Offset) const
+	{
+		return mpStaging + Offset;
+	}
+
+	/// <summary>
+	/// ステージング本体
+	/// </summary>
+	ID3D12Resource* CopyUploader::GetStagingResource() const
+	{
+		return mStaging.Get();
+	}
+
+	/// <summary>
+	/// 記録先（Begin と Submit の間だけ使える）
+	/// </summary>
+	ID3D12GraphicsCommandList* CopyUploader::GetCommandList() const
+	{
+		return mCmdList.Get();
+	}
+
+	/// <summary>
+	/// コピーキュー（タイルの割り当てにも使う）
+	/// </summary>
+	ID3D12CommandQueue* CopyUploader::GetQueue() const
+	{
+		return mQueue.Get();
+	}
+
+	/// <summary>
+	/// 最後に送った分のフェンスの値
+	/// </summary>
+	uint64_t CopyUploader::GetLastFenceValue() const
+	{
+		return mFenceValue;
+	}
+
+	/// <summary>
+	/// ステージング全体の大きさ
+	/// </summary>
+	uint64_t CopyUploader::GetStagingSize() const
+	{
+		return mStagingSize;
+	}
+
+	/// <summary>
+	/// 転送待ちで使用中のステージングの大きさ
+	/// </summary>
+	uint64_t CopyUploader::GetStagingUsed() const
+	{
+		return mStagingHead - mStagingTail;
+	}
+}
@@ -273,6 +273,42 @@ namespace Ecse::Graphics
 		return mCmdQueue.Get();
 	}
 
+	/// <summary>
+	/// 記録中のフレームのインデックス
+	/// </summary>
+	/// <returns></returns>
+	UINT DX12::GetFrameIndex() const
+	{
+		return mFrameIndex;
+	}
+
+	/// <summary>
+	/// 深度バッファの取得（状態は D3D12_RESOURCE_STATE_DEPTH_WRITE）
+	/// </summary>
+	/// <returns></returns>
+	ID3D12Resource* DX12::GetDepthBuffer() const
+	{
+		return mDepthBuffer.Get();
+	}
+
+	/// <summary>
+	/// フレームの完了を知らせるフェンス
+	/// </summary>
+	/// <returns></returns>
+	ID3D12Fence* DX12::GetFence() const
+	{
+		return mFence.Get();
+	}
+
+	/// <summary>
+	/// 最後に Signal した値（どのスレッドからでも読める。フェンスがこの値に届けば、それまでに送った処理は全て終わっている）
+	/// </summary>
+	/// <returns></returns>
+	UINT64 DX12::GetLastSignaledFenceValue() const
+	{
+		return mNextFenceValue.load(std::memory_order_acquire);
+	}
+
 	/// <summary>
 	/// デバッグレイヤーの起動
 	/// </summary>
@@ -530,7 +566,8 @@ namespace Ecse::Graphics
 		depthDesc.Height = Height;
 		depthDesc.DepthOrArraySize = 1;
 		depthDesc.MipLevels = 1;
-		depthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		//	Hi-Z 作成のために SRV (R32_FLOAT) としても読めるよう型なしで作る
+		depthDesc.Format = DXGI_FORMAT_R32_TYPELESS;
 		depthDesc.SampleDesc.Count = 1;
 		depthDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
@@ -560,8 +597,13 @@ namespace Ecse::Graphics
 			return false;
 		}
 
-		//	DSVの作成
-		mDevice->CreateDepthStencilView(mDepthBuffer.Get(), nullptr, mDsvHeap->GetCPUDescriptorHandleForHeapStart());
+		//	DSVの作成（型なしなのでフォーマットを指定する）
+		D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+		dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
+		dsvDesc.Texture2D.MipSlice = 0;
+		mDevice->CreateDepthStencilView(mDepthBuffer.Get(), &dsvDesc, mDsvHeap->GetCPUDescriptorHandleForHeapStart());
 
 		return true;
 	}
@@ -0,0 +1,203 @@
+﻿#include "pch.h"
+#include<Graphics/DX12/UploadRingBuffer.hpp>
+
+namespace Ecse::Graphics
+{
+	UploadRingBuffer::UploadRingBuffer()
+		:mResource(nullptr)
+		, mpMapped(nullptr)
+		, mGpuBase(0)
+		, mSize(0)
+		, mHead(0)
+		, mTail(0)
+		, mFrameStart(0)
+		, mFrameEnd()
+		, mFrameIndex(0)
+		, mHasFrame(false)
+	{
+		mFrameEnd.fill(0);
+	}
+
+	UploadRingBuffer::~UploadRingBuffer()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// バッファの作成とマップ
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="Size">リング全体の大きさ（バイト）</param>
+	/// <returns>true:成功</returns>
+	bool UploadRingBuffer::Initialize(ID3D12Device* Device, uint64_t Size)
+	{
+		Release();
+		if (Device == nullptr || Size == 0) return false;
+
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = Size;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		HRESULT hr = Device->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mResource)
+		);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateUploadRingBuffer.");
+			return false;
+		}
+
+		//	UPLOAD ヒープは開きっぱなしで良い（CPUからは読まないので範囲は空）
+		D3D12_RANGE readRange = { 0, 0 };
+		void* mapped = nullptr;
+		hr = mResource->Map(0, &readRange, &mapped);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed MapUploadRingBuffer.");
+			mResource.Reset();
+			return false;
+		}
+
+		mpMapped = static_cast<uint8_t*>(mapped);
+		mGpuBase = mResource->GetGPUVirtualAddress();
+		mSize = Size;
+		mHead = 0;
+		mTail = 0;
+		mFrameStart = 0;
+		mFrameEnd.fill(0);
+		mHasFrame = false;
+		return true;
+	}
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void UploadRingBuffer::Release()
+	{
+		if (mResource != nullptr && mpMapped != nullptr)
+		{
+			mResource->Unmap(0, nullptr);
+		}
+		mResource.Reset();
+		mpMapped = nullptr;
+		mGpuBase = 0;
+		mSize = 0;
+		mHead = 0;
+		mTail = 0;
+		mFrameStart = 0;
+	}
+
+	/// <summary>
+	/// フレームの開始。DX12::BegineRendering の後に呼ぶ
+	/// </summary>
+	/// <param name="FrameIndex">DX12::GetFrameIndex</param>
+	void UploadRingBuffer::BeginFrame(uint32_t FrameIndex)
+	{
+		//	前のフレームの終わりを記録
+		if (mHasFrame == true)
+		{
+			mFrameEnd[mFrameIndex] = mHead;
+		}
+
+		//	このフレーム番号を前回使った時の分まではGPUが読み終わっている
+		//	フレームは順番に完了するので、それより古い領域も全て空いている
+		mFrameIndex = FrameIndex % DX12::FRAME_COUNT;
+		if (mFrameEnd[mFrameIndex] > mTail)
+		{
+			mTail = mFrameEnd[mFrameIndex];
+		}
+
+		mFrameStart = mHead;
+		mHasFrame = true;
+	}
+
+	/// <summary>
+	/// 領域の切り出し（空きがなければ無効な値）
+	/// </summary>
+	/// <param name="Size">大きさ（バイト）</param>
+	/// <param name="Alignment">配置（2の累乗）</param>
+	UploadAllocation UploadRingBuffer::Allocate(uint64_t Size, uint64_t Alignment)
+	{
+		UploadAllocation allocation;
+		if (mpMapped == nullptr || Size == 0 || Size > mSize) return allocation;
+		if (Alignment == 0) Alignment = 1;
+
+		uint64_t head = mHead;
+		uint64_t offset = ((head % mSize) + Alignment - 1) & ~(Alignment - 1);
+
+		//	末尾に収まらなければ先頭まで読み飛ばす
+		if (offset + Size > mSize)
+		{
+			head += mSize - (head % mSize);
+			offset = 0;
+		}
+		else
+		{
+			head += offset - (head % mSize);
+		}
+
+		//	GPUが使っている領域に追いついたら失敗
+		if (head + Size - mTail > mSize)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "UploadRingBuffer is full. Request:{} Used:{} Size:{}", Size, mHead - mTail, mSize);
+			return allocation;
+		}
+
+		mHead = head + Size;
+
+		allocation.pCpu = mpMapped + offset;
+		allocation.Gpu = mGpuBase + offset;
+		allocation.Offset = offset;
+		allocation.Size = Size;
+		return allocation;
+	}
+
+	/// <summary>
+	/// バッファ本体
+	/// </summary>
+	ID3D12Resource* UploadRingBuffer::GetResource() const
+	{
+		return mResource.Get();
+	}
+
+	/// <summary>
+	/// リング全体の大きさ
+	/// </summary>
+	uint64_t UploadRingBuffer::GetSize() const
+	{
+		return mSize;
+	}
+
+	/// <summary>
+	/// GPUの完了待ちで使用中の大きさ
+	/// </summary>
+	uint64_t UploadRingBuffer::GetUsedSize() const
+	{
+		return mHead - mTail;
+	}
+
+	/// <summary>
+	/// 今のフレームで切り出した大きさ
+	/// </summary>
+	uint64_t UploadRingBuffer::GetFrameAllocatedSize() const
+	{
+		return mHead - mFrameStart;
+	}
+}
@@ -0,0 +1,196 @@
+﻿#include "pch.h"
+#include<Graphics/GpuDriven/GpuCullingReference.hpp>
+#include<Graphics/Culling/HiZPyramid.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// プロキシから GPU に置く描画対象を作る
+	/// </summary>
+	/// <param name="Proxies">描画対象</param>
+	/// <param name="pDest">Proxies.GetCount() 個分の書き込み先</param>
+	void GpuCullingReference::WriteObjects(const RenderProxyBuffer& Proxies, GpuObject* pDest)
+	{
+		if (pDest == nullptr) return;
+
+		const uint32_t count = Proxies.GetCount();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			GpuObject object = {};
+			object.World = Proxies.World[i];
+			object.Center = DirectX::XMFLOAT3(Proxies.CenterX[i], Proxies.CenterY[i], Proxies.CenterZ[i]);
+			object.Radius = Proxies.Radius[i];
+			object.Extents = DirectX::XMFLOAT3(Proxies.ExtentX[i], Proxies.ExtentY[i], Proxies.ExtentZ[i]);
+			object.Mesh = Proxies.Mesh[i];
+			object.Material = Proxies.Material[i];
+			object.Flags = 0;
+			pDest[i] = object;
+		}
+	}
+
+	/// <summary>
+	/// 1コマンド分の引数の作成
+	/// </summary>
+	IndirectCommand GpuCullingReference::MakeCommand(uint32_t ObjectIndex, const GpuMeshInfo& Mesh)
+	{
+		IndirectCommand command = {};
+		command.ObjectIndex = ObjectIndex;
+		command.Draw.IndexCountPerInstance = Mesh.IndexCount;
+		command.Draw.InstanceCount = 1;
+		command.Draw.StartIndexLocation = Mesh.StartIndex;
+		command.Draw.BaseVertexLocation = Mesh.BaseVertex;
+		command.Draw.StartInstanceLocation = 0;
+		return command;
+	}
+
+	/// <summary>
+	/// AABBが視錐台に掛かっているか
+	/// </summary>
+	bool GpuCullingReference::IsInsideFrustum(const GpuObject& Object, const GpuCullConstants& Constants)
+	{
+		for (const auto& plane : Constants.Planes)
+		{
+			const float d = plane.x * Object.Center.x + plane.y * Object.Center.y + plane.z * Object.Center.z + plane.w;
+			const float r = std::fabs(plane.x) * Object.Extents.x + std::fabs(plane.y) * Object.Extents.y + std::fabs(plane.z) * Object.Extents.z;
+			if (d + r < 0.0f) return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// AABBがピラミッドの深度より完全に奥にあるか
+	/// </summary>
+	bool GpuCullingReference::IsOccluded(const GpuObject& Object, const GpuCullConstants& Constants, const HiZPyramid& Pyramid)
+	{
+		if (Pyramid.GetMipCount() == 0) return false;
+
+		const auto& m = Constants.ViewProjection;
+		float ndcMinX = 1.0f, ndcMinY = 1.0f;
+		float ndcMaxX = -1.0f, ndcMaxY = -1.0f;
+		float nearestZ = 1.0f;
+
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			const float x = Object.Center.x + Object.Extents.x * ((i & 1) ? 1.0f : -1.0f);
+			const float y = Object.Center.y + Object.Extents.y * ((i & 2) ? 1.0f : -1.0f);
+			const float z = Object.Center.z + Object.Extents.z * ((i & 4) ? 1.0f : -1.0f);
+
+			const float cx = x * m._11 + y * m._21 + z * m._31 + m._41;
+			const float cy = x * m._12 + y * m._22 + z * m._32 + m._42;
+			const float cz = x * m._13 + y * m._23 + z * m._33 + m._43;
+			const float cw = x * m._14 + y * m._24 + z * m._34 + m._44;
+
+			//	近平面をまたぐものは判定できないので見えている扱い
+			if (cw <= 0.0f) return false;
+
+			const float inv = 1.0f / cw;
+			ndcMinX = std::min(ndcMinX, cx * inv);
+			ndcMinY = std::min(ndcMinY, cy * inv);
+			ndcMaxX = std::max(ndcMaxX, cx * inv);
+			ndcMaxY = std::max(ndcMaxY, cy * inv);
+			nearestZ = std::min(nearestZ, cz * inv);
+		}
+
+		//	NDC からテクスチャ座標へ（y は反転）
+		const float uvMinX = std::clamp(ndcMinX * 0.5f + 0.5f, 0.0f, 1.0f);
+		const float uvMinY = std::clamp(0.5f - ndcMaxY * 0.5f, 0.0f, 1.0f);
+		const float uvMaxX = std::clamp(ndcMaxX * 0.5f + 0.5f, 0.0f, 1.0f);
+		const float uvMaxY = std::clamp(0.5f - ndcMinY * 0.5f, 0.0f, 1.0f);
+
+		//	矩形が 1 テクセルに収まるミップを選ぶと、読むのは 2x2 で足りる
+		const float sizeX = (uvMaxX - uvMinX) * static_cast<float>(Pyramid.Width);
+		const float sizeY = (uvMaxY - uvMinY) * static_cast<float>(Pyramid.Height);
+		const uint32_t mip = std::min(static_cast<uint32_t>(std::ceil(std::log2(std::max(std::max(sizeX, sizeY), 1.0f)))), Pyramid.GetMipCount() - 1);
+
+		const int32_t mipWidth = static_cast<int32_t>(Pyramid.GetMipWidth(mip));
+		const int32_t mipHeight = static_cast<int32_t>(Pyramid.GetMipHeight(mip));
+		const int32_t x0 = std::clamp(static_cast<int32_t>(std::floor(uvMinX * mipWidth)), 0, mipWidth - 1);
+		const int32_t y0 = std::clamp(static_cast<int32_t>(std::floor(uvMinY * mipHeight)), 0, mipHeight - 1);
+		const int32_t x1 = std::clamp(static_cast<int32_t>(std::floor(uvMaxX * mipWidth)), 0, mipWidth - 1);
+		const int32_t y1 = std::clamp(static_cast<int32_t>(std::floor(uvMaxY * mipHeight)), 0, mipHeight - 1);
+
+		const float depth = std::max(
+			std::max(Pyramid.Load(mip, x0, y0), Pyramid.Load(mip, x1, y0)),
+			std::max(Pyramid.Load(mip, x0, y1), Pyramid.Load(mip, x1, y1)));
+
+		return nearestZ > depth;
+	}
+
+	/// <summary>
+	/// カリングしてコマンドを詰める
+	/// </summary>
+	/// <param name="Objects">描画対象</param>
+	/// <param name="Meshes">メッシュプール内の位置</param>
+	/// <param name="Constants">GPU に渡すものと同じ定数</param>
+	/// <param name="pPyramid">Hi-Z（nullptr なら Hi-Z の判定はしない）</param>
+	/// <param name="Visibility">描画対象ごとの前のフレームで見えていたかどうか（2段目が書き換える）</param>
+	/// <param name="OutCommands">詰めたコマンド（MaxCommands まで。CommandOffset は足さない）</param>
+	/// <returns>カウンタの値（見えた数。MaxCommands を超えることがある）</returns>
+	uint32_t GpuCullingReference::CullAndCompact(std::span<const GpuObject> Objects, std::span<const GpuMeshInfo> Meshes, const GpuCullConstants& Constants, const HiZPyramid* pPyramid, std::span<uint32_t> Visibility, std::vector<IndirectCommand>& OutCommands)
+	{
+		OutCommands.clear();
+
+		const uint32_t objectCount = std::min(Constants.ObjectCount, static_cast<uint32_t>(Objects.size()));
+		const uint32_t meshCount = std::min(Constants.MeshCount, static_cast<uint32_t>(Meshes.size()));
+		const bool useFrustum = (Constants.Flags & GPU_CULL_FLAG_FRUSTUM) != 0;
+		const bool useHiZ = (Constants.Flags & GPU_CULL_FLAG_HIZ) != 0 && pPyramid != nullptr;
+		const bool isEarly = (Constants.Flags & GPU_CULL_FLAG_EARLY) != 0;
+		const bool isLate = (Constants.Flags & GPU_CULL_FLAG_LATE) != 0;
+		const bool hasVisibility = (Constants.Flags & GPU_CULL_FLAG_VISIBILITY_VALID) != 0;
+
+		//	GPU と同じくグループ単位でカウンタを進める
+		uint32_t counter = 0;
+		for (uint32_t groupStart = 0; groupStart < objectCount; groupStart += GPU_CULL_GROUP_SIZE)
+		{
+			const uint32_t groupEnd = std::min(groupStart + GPU_CULL_GROUP_SIZE, objectCount);
+			const uint32_t groupBase = counter;
+			uint32_t localCount = 0;
+
+			for (uint32_t index = groupStart; index < groupEnd; ++index)
+			{
+				const GpuObject& object = Objects[index];
+
+				bool visible = (object.Flags & GPU_OBJECT_FLAG_DISABLED) == 0 && object.Mesh < meshCount;
+				if (visible && useFrustum)
+				{
+					visible = IsInsideFrustum(object, Constants);
+				}
+
+				const bool wasVisible = hasVisibility && index < Visibility.size() && Visibility[index] != 0;
+
+				if (isEarly)
+				{
+					//	1段目は前のフレームで見えていたものだけ（Hi-Z はまだない）
+					visible = visible && wasVisible;
+				}
+				else
+				{
+					if (visible && useHiZ)
+					{
+						visible = IsOccluded(object, Constants, *pPyramid) == false;
+					}
+
+					//	2段目は結果を次のフレームのために残し、1段目で描いたものは描かない
+					if (isLate)
+					{
+						if (index < Visibility.size())
+						{
+							Visibility[index] = visible ? 1 : 0;
+						}
+						visible = visible && wasVisible == false;
+					}
+				}
+				if (visible == false) continue;
+
+				const uint32_t slot = groupBase + localCount++;
+				if (slot < Constants.MaxCommands)
+				{
+					OutCommands.push_back(MakeCommand(index, Meshes[object.Mesh]));
+				}
+			}
+			counter += localCount;
+		}
+		return counter;
+	}
+}
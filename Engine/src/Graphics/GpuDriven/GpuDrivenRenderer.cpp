@@ -0,0 +1,510 @@
+﻿#include "pch.h"
+#include<Graphics/GpuDriven/GpuDrivenRenderer.hpp>
+#include<Graphics/GpuDriven/GpuCullingReference.hpp>
+#include<Graphics/DX12/UploadRingBuffer.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<Graphics/Shader/ShaderCompiler.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// バッファの作成
+		/// </summary>
+		bool CreateBuffer(ID3D12Device* Device, uint64_t Size, D3D12_HEAP_TYPE HeapType, D3D12_RESOURCE_FLAGS Flags, D3D12_RESOURCE_STATES State, Resource& OutResource)
+		{
+			D3D12_HEAP_PROPERTIES heapProp = {};
+			heapProp.Type = HeapType;
+			heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			desc.Width = Size;
+			desc.Height = 1;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = 1;
+			desc.Format = DXGI_FORMAT_UNKNOWN;
+			desc.SampleDesc.Count = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			desc.Flags = Flags;
+
+			const HRESULT hr = Device->CreateCommittedResource(
+				&heapProp,
+				D3D12_HEAP_FLAG_NONE,
+				&desc,
+				State,
+				nullptr,
+				IID_PPV_ARGS(&OutResource)
+			);
+			return SUCCEEDED(hr);
+		}
+	}
+
+	static_assert(sizeof(IndirectDrawIndexedArgs) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "IndirectDrawIndexedArgs must match D3D12_DRAW_INDEXED_ARGUMENTS.");
+
+	GpuDrivenRenderer::GpuDrivenRenderer()
+		:mCullRootSignature(nullptr)
+		, mCullPso()
+		, mCommandSignature(nullptr)
+		, mObjectBuffer(nullptr)
+		, mMeshBuffer(nullptr)
+		, mCommandBuffer(nullptr)
+		, mCountBuffer(nullptr)
+		, mVisibilityBuffer(nullptr)
+		, mReadbackBuffer(nullptr)
+		, mpReadback(nullptr)
+		, mObjectState(D3D12_RESOURCE_STATE_COMMON)
+		, mMeshState(D3D12_RESOURCE_STATE_COMMON)
+		, mCommandState(D3D12_RESOURCE_STATE_COMMON)
+		, mCountState(D3D12_RESOURCE_STATE_COMMON)
+		, mVisibilityState(D3D12_RESOURCE_STATE_COMMON)
+		, mIsReadbackWritten()
+		, mMaxObjects(0)
+		, mMaxMeshes(0)
+		, mObjectCount(0)
+		, mMeshCount(0)
+		, mLastCounts()
+		, mHasVisibility(false)
+	{
+		mIsReadbackWritten.fill(false);
+		mLastCounts.fill(0);
+	}
+
+	GpuDrivenRenderer::~GpuDrivenRenderer()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="DrawRootSignature">ExecuteIndirect で使う描画側のルートシグネチャ</param>
+	/// <param name="ObjectIndexRootParameter">描画対象の添字を受け取るルート定数の番号</param>
+	/// <param name="MaxObjects">描画対象の最大数</param>
+	/// <param name="MaxMeshes">メッシュの最大数</param>
+	/// <param name="ShaderPath">GpuCulling.hlsl の場所</param>
+	/// <returns>true:成功</returns>
+	bool GpuDrivenRenderer::Initialize(ID3D12Device* Device, ID3D12RootSignature* DrawRootSignature, UINT ObjectIndexRootParameter, uint32_t MaxObjects, uint32_t MaxMeshes, const std::filesystem::path& ShaderPath)
+	{
+		Release();
+		if (Device == nullptr || DrawRootSignature == nullptr || MaxObjects == 0 || MaxMeshes == 0) return false;
+
+		if (CreateCullPipeline(Device, ShaderPath) == false) return false;
+
+		//	[描画対象の添字][DrawIndexed] の順に並んだコマンド
+		std::array<D3D12_INDIRECT_ARGUMENT_DESC, 2> arguments = {};
+		arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+		arguments[0].Constant.RootParameterIndex = ObjectIndexRootParameter;
+		arguments[0].Constant.DestOffsetIn32BitValues = 0;
+		arguments[0].Constant.Num32BitValuesToSet = 1;
+		arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+		signatureDesc.ByteStride = sizeof(IndirectCommand);
+		signatureDesc.NumArgumentDescs = static_cast<UINT>(arguments.size());
+		signatureDesc.pArgumentDescs = arguments.data();
+		signatureDesc.NodeMask = 0;
+
+		HRESULT hr = Device->CreateCommandSignature(&signatureDesc, DrawRootSignature, IID_PPV_ARGS(&mCommandSignature));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommandSignature.");
+			Release();
+			return false;
+		}
+
+		//	GPU専用のバッファ
+		const bool isCreated =
+			CreateBuffer(Device, static_cast<uint64_t>(MaxObjects) * sizeof(GpuObject), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, mObjectBuffer) &&
+			CreateBuffer(Device, static_cast<uint64_t>(MaxMeshes) * sizeof(GpuMeshInfo), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, mMeshBuffer) &&
+			CreateBuffer(Device, static_cast<uint64_t>(MaxObjects) * sizeof(IndirectCommand) * 2, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, mCommandBuffer) &&
+			CreateBuffer(Device, sizeof(uint32_t) * 2, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, mCountBuffer) &&
+			CreateBuffer(Device, static_cast<uint64_t>(MaxObjects) * sizeof(uint32_t), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, mVisibilityBuffer) &&
+			CreateBuffer(Device, sizeof(uint32_t) * 2 * DX12::FRAME_COUNT, D3D12_HEAP_TYPE_READBACK, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, mReadbackBuffer);
+		if (isCreated == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateGpuDrivenBuffers.");
+			Release();
+			return false;
+		}
+
+		//	読み戻し先は開きっぱなし
+		void* mapped = nullptr;
+		hr = mReadbackBuffer->Map(0, nullptr, &mapped);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed MapGpuDrivenReadback.");
+			Release();
+			return false;
+		}
+		mpReadback = static_cast<const uint32_t*>(mapped);
+
+		mMaxObjects = MaxObjects;
+		mMaxMeshes = MaxMeshes;
+		return true;
+	}
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void GpuDrivenRenderer::Release()
+	{
+		if (mReadbackBuffer != nullptr && mpReadback != nullptr)
+		{
+			D3D12_RANGE writeRange = { 0, 0 };
+			mReadbackBuffer->Unmap(0, &writeRange);
+		}
+		mpReadback = nullptr;
+
+		mCullRootSignature.Reset();
+		for (auto& pso : mCullPso)
+		{
+			pso.Reset();
+		}
+		mCommandSignature.Reset();
+		mObjectBuffer.Reset();
+		mMeshBuffer.Reset();
+		mCommandBuffer.Reset();
+		mCountBuffer.Reset();
+		mVisibilityBuffer.Reset();
+		mReadbackBuffer.Reset();
+
+		mObjectState = D3D12_RESOURCE_STATE_COMMON;
+		mMeshState = D3D12_RESOURCE_STATE_COMMON;
+		mCommandState = D3D12_RESOURCE_STATE_COMMON;
+		mCountState = D3D12_RESOURCE_STATE_COMMON;
+		mVisibilityState = D3D12_RESOURCE_STATE_COMMON;
+		mIsReadbackWritten.fill(false);
+
+		mMaxObjects = 0;
+		mMaxMeshes = 0;
+		mObjectCount = 0;
+		mMeshCount = 0;
+		mLastCounts.fill(0);
+		mHasVisibility = false;
+	}
+
+	/// <summary>
+	/// 描画対象を GPU のバッファへ送る（変わったフレームだけで良い）
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool GpuDrivenRenderer::UploadObjects(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const RenderProxyBuffer& Proxies)
+	{
+		if (CmdList == nullptr || mObjectBuffer == nullptr) return false;
+
+		uint32_t count = Proxies.GetCount();
+		if (count > mMaxObjects)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "GpuDrivenRenderer: too many objects. {} > {}", count, mMaxObjects);
+			count = mMaxObjects;
+		}
+
+		mObjectCount = count;
+		if (count == 0) return true;
+
+		const uint64_t size = static_cast<uint64_t>(count) * sizeof(GpuObject);
+		const UploadAllocation allocation = Ring.Allocate(size);
+		if (allocation.IsValid() == false) return false;
+
+		//	上限を超えた分は切り捨てる
+		if (count == Proxies.GetCount())
+		{
+			GpuCullingReference::WriteObjects(Proxies, static_cast<GpuObject*>(allocation.pCpu));
+		}
+		else
+		{
+			std::vector<GpuObject> objects(Proxies.GetCount());
+			GpuCullingReference::WriteObjects(Proxies, objects.data());
+			std::memcpy(allocation.pCpu, objects.data(), size);
+		}
+
+		Transition(CmdList, mObjectBuffer.Get(), mObjectState, D3D12_RESOURCE_STATE_COPY_DEST);
+		CmdList->CopyBufferRegion(mObjectBuffer.Get(), 0, Ring.GetResource(), allocation.Offset, size);
+		Transition(CmdList, mObjectBuffer.Get(), mObjectState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		return true;
+	}
+
+	/// <summary>
+	/// メッシュプール内の位置を GPU のバッファへ送る
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool GpuDrivenRenderer::UploadMeshes(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, std::span<const GpuMeshInfo> Meshes)
+	{
+		if (CmdList == nullptr || mMeshBuffer == nullptr) return false;
+
+		uint32_t count = static_cast<uint32_t>(Meshes.size());
+		if (count > mMaxMeshes)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "GpuDrivenRenderer: too many meshes. {} > {}", count, mMaxMeshes);
+			count = mMaxMeshes;
+		}
+
+		mMeshCount = count;
+		if (count == 0) return true;
+
+		const uint64_t size = static_cast<uint64_t>(count) * sizeof(GpuMeshInfo);
+		const UploadAllocation allocation = Ring.Allocate(size);
+		if (allocation.IsValid() == false) return false;
+
+		std::memcpy(allocation.pCpu, Meshes.data(), size);
+
+		Transition(CmdList, mMeshBuffer.Get(), mMeshState, D3D12_RESOURCE_STATE_COPY_DEST);
+		CmdList->CopyBufferRegion(mMeshBuffer.Get(), 0, Ring.GetResource(), allocation.Offset, size);
+		Transition(CmdList, mMeshBuffer.Get(), mMeshState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		return true;
+	}
+
+	/// <summary>
+	/// カリングとコマンドの詰め込みを記録する
+	/// </summary>
+	/// <param name="CmdList">記録先</param>
+	/// <param name="Ring">定数の置き場所</param>
+	/// <param name="Constants">平面・Hi-Z の設定（数は中で埋める）</param>
+	/// <param name="FrameIndex">DX12::GetFrameIndex</param>
+	/// <param name="Pass">カリングの段</param>
+	/// <param name="HiZSrv">Hi-Z の SRV（ptr が 0 なら Hi-Z の判定はしない）</param>
+	/// <returns>true:成功</returns>
+	bool GpuDrivenRenderer::Cull(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const GpuCullConstants& Constants, uint32_t FrameIndex, EGpuCullPass Pass, D3D12_GPU_DESCRIPTOR_HANDLE HiZSrv)
+	{
+		if (CmdList == nullptr || mCountBuffer == nullptr) return false;
+
+		//	同じフレーム番号の前回分は DX12 が完了を待っているので読める
+		const uint32_t slot = FrameIndex % DX12::FRAME_COUNT;
+		if (Pass != EGpuCullPass::Late && mIsReadbackWritten[slot] == true)
+		{
+			mLastCounts[0] = mpReadback[slot * 2 + 0];
+			mLastCounts[1] = mpReadback[slot * 2 + 1];
+		}
+
+		//	1段目はまだ今のフレームの深度がないので Hi-Z は使わない
+		const bool isLate = Pass == EGpuCullPass::Late;
+		const bool useHiZ = Pass != EGpuCullPass::Early && HiZSrv.ptr != 0 && (Constants.Flags & GPU_CULL_FLAG_HIZ) != 0;
+
+		GpuCullConstants constants = Constants;
+		constants.ObjectCount = mObjectCount;
+		constants.MeshCount = mMeshCount;
+		constants.MaxCommands = mMaxObjects;
+		constants.CommandOffset = isLate ? mMaxObjects : 0;
+		constants.Flags &= ~(GPU_CULL_FLAG_EARLY | GPU_CULL_FLAG_LATE | GPU_CULL_FLAG_VISIBILITY_VALID);
+		if (useHiZ == false)
+		{
+			constants.Flags &= ~GPU_CULL_FLAG_HIZ;
+		}
+		if (Pass == EGpuCullPass::Early)
+		{
+			constants.Flags |= GPU_CULL_FLAG_EARLY;
+		}
+		if (isLate)
+		{
+			constants.Flags |= GPU_CULL_FLAG_LATE;
+		}
+		if (mHasVisibility)
+		{
+			constants.Flags |= GPU_CULL_FLAG_VISIBILITY_VALID;
+		}
+
+		//	1回目のカリングで両方のカウンタを 0 に戻し、2段目は自分の分だけ戻す
+		const uint32_t resetOffset = isLate ? sizeof(uint32_t) : 0;
+		const uint32_t resetSize = isLate ? sizeof(uint32_t) : sizeof(uint32_t) * 2;
+
+		const UploadAllocation constantAllocation = Ring.Allocate(sizeof(GpuCullConstants));
+		const UploadAllocation zeroAllocation = Ring.Allocate(sizeof(uint32_t) * 2, sizeof(uint32_t));
+		if (constantAllocation.IsValid() == false || zeroAllocation.IsValid() == false) return false;
+
+		std::memcpy(constantAllocation.pCpu, &constants, sizeof(GpuCullConstants));
+		std::memset(zeroAllocation.pCpu, 0, sizeof(uint32_t) * 2);
+
+		Transition(CmdList, mCountBuffer.Get(), mCountState, D3D12_RESOURCE_STATE_COPY_DEST);
+		CmdList->CopyBufferRegion(mCountBuffer.Get(), resetOffset, Ring.GetResource(), zeroAllocation.Offset, resetSize);
+		Transition(CmdList, mCountBuffer.Get(), mCountState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		Transition(CmdList, mCommandBuffer.Get(), mCommandState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		Transition(CmdList, mVisibilityBuffer.Get(), mVisibilityState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		//	前の段の読み書きが終わってから触る
+		D3D12_RESOURCE_BARRIER visibilityBarrier = {};
+		visibilityBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+		visibilityBarrier.UAV.pResource = mVisibilityBuffer.Get();
+		CmdList->ResourceBarrier(1, &visibilityBarrier);
+
+		if (mObjectCount > 0 && mMeshCount > 0)
+		{
+			CmdList->SetComputeRootSignature(mCullRootSignature.Get());
+			CmdList->SetPipelineState(mCullPso[useHiZ ? 1 : 0].Get());
+			CmdList->SetComputeRootConstantBufferView(RootConstants, constantAllocation.Gpu);
+			CmdList->SetComputeRootShaderResourceView(RootObjects, mObjectBuffer->GetGPUVirtualAddress());
+			CmdList->SetComputeRootShaderResourceView(RootMeshes, mMeshBuffer->GetGPUVirtualAddress());
+			CmdList->SetComputeRootUnorderedAccessView(RootCommands, mCommandBuffer->GetGPUVirtualAddress());
+			CmdList->SetComputeRootUnorderedAccessView(RootCommandCount, mCountBuffer->GetGPUVirtualAddress());
+			CmdList->SetComputeRootUnorderedAccessView(RootVisibility, mVisibilityBuffer->GetGPUVirtualAddress());
+			if (useHiZ == true)
+			{
+				CmdList->SetComputeRootDescriptorTable(RootHiZ, HiZSrv);
+			}
+
+			CmdList->Dispatch((mObjectCount + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE, 1, 1);
+
+			if (isLate)
+			{
+				mHasVisibility = true;
+			}
+		}
+
+		//	描いた数を読み戻す（2段目の後に上書きされるので、最後の段の値が残る）
+		Transition(CmdList, mCountBuffer.Get(), mCountState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		CmdList->CopyBufferRegion(mReadbackBuffer.Get(), sizeof(uint32_t) * 2 * slot, mCountBuffer.Get(), 0, sizeof(uint32_t) * 2);
+		mIsReadbackWritten[slot] = true;
+
+		Transition(CmdList, mCountBuffer.Get(), mCountState, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+		Transition(CmdList, mCommandBuffer.Get(), mCommandState, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+		return true;
+	}
+
+	/// <summary>
+	/// 詰めたコマンドで描く（描画側のルートシグネチャ・PSO・メッシュプールは設定済みであること）
+	/// </summary>
+	/// <param name="CmdList">記録先</param>
+	/// <param name="Pass">Cull に渡した段</param>
+	void GpuDrivenRenderer::Execute(ID3D12GraphicsCommandList* CmdList, EGpuCullPass Pass)
+	{
+		if (CmdList == nullptr || mCommandSignature == nullptr) return;
+		if (mCommandState != D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT) return;
+
+		const bool isLate = Pass == EGpuCullPass::Late;
+		const uint64_t argumentOffset = isLate ? static_cast<uint64_t>(mMaxObjects) * sizeof(IndirectCommand) : 0;
+		const uint64_t countOffset = isLate ? sizeof(uint32_t) : 0;
+
+		CmdList->ExecuteIndirect(mCommandSignature.Get(), mMaxObjects, mCommandBuffer.Get(), argumentOffset, mCountBuffer.Get(), countOffset);
+	}
+
+	/// <summary>
+	/// 描画対象のバッファのアドレス（頂点シェーダーのルートSRVに渡す）
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GpuDrivenRenderer::GetObjectBufferAddress() const
+	{
+		return mObjectBuffer != nullptr ? mObjectBuffer->GetGPUVirtualAddress() : 0;
+	}
+
+	/// <summary>
+	/// 送った描画対象の数
+	/// </summary>
+	uint32_t GpuDrivenRenderer::GetObjectCount() const
+	{
+		return mObjectCount;
+	}
+
+	/// <summary>
+	/// 同じフレーム番号の前回のカリングで描いた数（FRAME_COUNT フレーム遅れ）
+	/// </summary>
+	uint32_t GpuDrivenRenderer::GetLastVisibleCount() const
+	{
+		return mLastCounts[0] + mLastCounts[1];
+	}
+
+	/// <summary>
+	/// そのうち2段目で描いた数（前のフレームで見えていなかったもの）
+	/// </summary>
+	uint32_t GpuDrivenRenderer::GetLastLateCount() const
+	{
+		return mLastCounts[1];
+	}
+
+	/// <summary>
+	/// カリング用のルートシグネチャと PSO の作成
+	/// </summary>
+	bool GpuDrivenRenderer::CreateCullPipeline(ID3D12Device* Device, const std::filesystem::path& ShaderPath)
+	{
+		//	Hi-Z は SRV 1つのテーブル
+		D3D12_DESCRIPTOR_RANGE hiZRange = {};
+		hiZRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		hiZRange.NumDescriptors = 1;
+		hiZRange.BaseShaderRegister = 2;
+		hiZRange.RegisterSpace = 0;
+		hiZRange.OffsetInDescriptorsFromTableStart = 0;
+
+		std::array<D3D12_ROOT_PARAMETER, ROOT_PARAMETER_COUNT> parameters = {};
+		parameters[RootConstants].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		parameters[RootConstants].Descriptor.ShaderRegister = 0;
+		parameters[RootObjects].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		parameters[RootObjects].Descriptor.ShaderRegister = 0;
+		parameters[RootMeshes].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		parameters[RootMeshes].Descriptor.ShaderRegister = 1;
+		parameters[RootCommands].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		parameters[RootCommands].Descriptor.ShaderRegister = 0;
+		parameters[RootCommandCount].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		parameters[RootCommandCount].Descriptor.ShaderRegister = 1;
+		parameters[RootVisibility].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		parameters[RootVisibility].Descriptor.ShaderRegister = 2;
+		parameters[RootHiZ].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		parameters[RootHiZ].DescriptorTable.NumDescriptorRanges = 1;
+		parameters[RootHiZ].DescriptorTable.pDescriptorRanges = &hiZRange;
+		for (auto& parameter : parameters)
+		{
+			parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		}
+
+		D3D12_ROOT_SIGNATURE_DESC rootDesc = {};
+		rootDesc.NumParameters = static_cast<UINT>(parameters.size());
+		rootDesc.pParameters = parameters.data();
+		rootDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+		Blob signature = nullptr;
+		Blob error = nullptr;
+		HRESULT hr = D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed SerializeRootSignature (GpuCulling). {}", error != nullptr ? static_cast<const char*>(error->GetBufferPointer()) : "");
+			return false;
+		}
+
+		hr = Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mCullRootSignature));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateRootSignature (GpuCulling).");
+			return false;
+		}
+
+		//	Hi-Z なし・ありの2種類
+		const std::array<const char*, 2> hiZValues = { "0", "1" };
+		for (size_t i = 0; i < mCullPso.size(); ++i)
+		{
+			const D3D_SHADER_MACRO defines[] = { { "HIZ_ENABLED", hiZValues[i] }, { nullptr, nullptr } };
+			Blob shader = ShaderCompiler::CompileFromFile(ShaderPath, "CSMain", "cs_5_1", defines);
+			if (shader == nullptr) return false;
+
+			D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+			psoDesc.pRootSignature = mCullRootSignature.Get();
+			psoDesc.CS.pShaderBytecode = shader->GetBufferPointer();
+			psoDesc.CS.BytecodeLength = shader->GetBufferSize();
+
+			hr = Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&mCullPso[i]));
+			if (FAILED(hr))
+			{
+				ECSE_LOG(System::ELogLevel::Error, "Failed CreateComputePipelineState (GpuCulling).");
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 状態が違えば遷移を記録する
+	/// </summary>
+	void GpuDrivenRenderer::Transition(ID3D12GraphicsCommandList* CmdList, ID3D12Resource* Resource, D3D12_RESOURCE_STATES& State, D3D12_RESOURCE_STATES After)
+	{
+		if (State == After) return;
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = Resource;
+		barrier.Transition.StateBefore = State;
+		barrier.Transition.StateAfter = After;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		CmdList->ResourceBarrier(1, &barrier);
+
+		State = After;
+	}
+}
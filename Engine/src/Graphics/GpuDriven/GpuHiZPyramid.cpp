@@ -0,0 +1,373 @@
+﻿#include "pch.h"
+#include<Graphics/GpuDriven/GpuHiZPyramid.hpp>
+#include<Graphics/Culling/HiZPyramid.hpp>
+#include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapManager.hpp>
+#include<Graphics/Shader/ShaderCompiler.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 1グループの縦横のスレッド数（Shader/HiZBuild.hlsl の GROUP_SIZE）
+		/// </summary>
+		constexpr uint32_t GROUP_SIZE = 8;
+	}
+
+	GpuHiZPyramid::GpuHiZPyramid()
+		:mRootSignature(nullptr)
+		, mPso(nullptr)
+		, mPyramid(nullptr)
+		, mpDepthBuffer(nullptr)
+		, mDescriptors()
+		, mDescriptorSize(0)
+		, mState(D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+		, mDepthWidth(0)
+		, mDepthHeight(0)
+		, mWidth(0)
+		, mHeight(0)
+		, mMipCount(0)
+	{
+	}
+
+	GpuHiZPyramid::~GpuHiZPyramid()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="DepthBuffer">R32_TYPELESS の深度バッファ（DX12::GetDepthBuffer）</param>
+	/// <param name="ShaderPath">HiZBuild.hlsl の場所</param>
+	/// <returns>true:成功</returns>
+	bool GpuHiZPyramid::Initialize(ID3D12Device* Device, ID3D12Resource* DepthBuffer, const std::filesystem::path& ShaderPath)
+	{
+		Release();
+		if (Device == nullptr || DepthBuffer == nullptr) return false;
+
+		auto* heapManager = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		if (heapManager == nullptr) return false;
+
+		if (CreatePipeline(Device, ShaderPath) == false)
+		{
+			Release();
+			return false;
+		}
+
+		const D3D12_RESOURCE_DESC depthDesc = DepthBuffer->GetDesc();
+		mpDepthBuffer = DepthBuffer;
+		mDepthWidth = static_cast<uint32_t>(depthDesc.Width);
+		mDepthHeight = depthDesc.Height;
+		mWidth = HiZPyramid::GetBaseSize(mDepthWidth);
+		mHeight = HiZPyramid::GetBaseSize(mDepthHeight);
+		mMipCount = HiZPyramid::GetMipCount(mWidth, mHeight);
+
+		//	ピラミッド本体。ミップごとに UAV で書いて SRV で読む
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Width = mWidth;
+		desc.Height = mHeight;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = static_cast<UINT16>(mMipCount);
+		desc.Format = DXGI_FORMAT_R32_FLOAT;
+		desc.SampleDesc.Count = 1;
+		desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		HRESULT hr = Device->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nullptr,
+			IID_PPV_ARGS(&mPyramid)
+		);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateHiZPyramid.");
+			Release();
+			return false;
+		}
+		mState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+		mDescriptors = heapManager->Issuance(2 + mMipCount * 2);
+		if (mDescriptors.IsValid() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed IssuanceHiZDescriptors.");
+			Release();
+			return false;
+		}
+		mDescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		//	深度は R32_FLOAT として読む
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = 1;
+		Device->CreateShaderResourceView(mpDepthBuffer, &srvDesc, GetCpuHandle(GetDepthSrvIndex()));
+
+		for (uint32_t mip = 0; mip < mMipCount; ++mip)
+		{
+			srvDesc.Texture2D.MostDetailedMip = mip;
+			srvDesc.Texture2D.MipLevels = 1;
+			Device->CreateShaderResourceView(mPyramid.Get(), &srvDesc, GetCpuHandle(GetMipSrvIndex(mip)));
+
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+			uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+			uavDesc.Texture2D.MipSlice = mip;
+			Device->CreateUnorderedAccessView(mPyramid.Get(), nullptr, &uavDesc, GetCpuHandle(GetMipUavIndex(mip)));
+		}
+
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = mMipCount;
+		Device->CreateShaderResourceView(mPyramid.Get(), &srvDesc, GetCpuHandle(GetFullSrvIndex()));
+
+		return true;
+	}
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void GpuHiZPyramid::Release()
+	{
+		if (mDescriptors.IsValid())
+		{
+			if (auto* heapManager = System::ServiceLocator::Get<GDescriptorHeapManager>())
+			{
+				heapManager->Discard(mDescriptors);
+			}
+		}
+		mDescriptors = GDescritorHeapInfo();
+
+		mRootSignature.Reset();
+		mPso.Reset();
+		mPyramid.Reset();
+		mpDepthBuffer = nullptr;
+		mState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		mDepthWidth = 0;
+		mDepthHeight = 0;
+		mWidth = 0;
+		mHeight = 0;
+		mMipCount = 0;
+	}
+
+	/// <summary>
+	/// ピラミッドを作る（深度バッファは DEPTH_WRITE の状態で渡し、戻す）
+	/// </summary>
+	void GpuHiZPyramid::Build(ID3D12GraphicsCommandList* CmdList)
+	{
+		if (CmdList == nullptr || mPyramid == nullptr) return;
+
+		auto* heapManager = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		if (heapManager == nullptr) return;
+
+		ID3D12DescriptorHeap* heaps[] = { heapManager->GetNativeHeap() };
+		CmdList->SetDescriptorHeaps(1, heaps);
+
+		//	深度を読めるようにし、ピラミッドは全ミップを書き込みへ
+		std::array<D3D12_RESOURCE_BARRIER, 2> barriers = {};
+		barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barriers[0].Transition.pResource = mpDepthBuffer;
+		barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+		barriers[0].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barriers[1].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barriers[1].Transition.pResource = mPyramid.Get();
+		barriers[1].Transition.StateBefore = mState;
+		barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		barriers[1].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		CmdList->ResourceBarrier(mState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS ? 1 : 2, barriers.data());
+
+		CmdList->SetComputeRootSignature(mRootSignature.Get());
+		CmdList->SetPipelineState(mPso.Get());
+
+		uint32_t srcWidth = mDepthWidth;
+		uint32_t srcHeight = mDepthHeight;
+		for (uint32_t mip = 0; mip < mMipCount; ++mip)
+		{
+			const uint32_t dstWidth = std::max(1u, mWidth >> mip);
+			const uint32_t dstHeight = std::max(1u, mHeight >> mip);
+			const uint32_t constants[4] = { srcWidth, srcHeight, dstWidth, dstHeight };
+
+			//	ミップ0は深度バッファ、それ以外は1つ下のミップから
+			const uint32_t source = mip == 0 ? GetDepthSrvIndex() : GetMipSrvIndex(mip - 1);
+			CmdList->SetComputeRoot32BitConstants(RootConstants, 4, constants, 0);
+			CmdList->SetComputeRootDescriptorTable(RootSource, GetGpuHandle(source));
+			CmdList->SetComputeRootDescriptorTable(RootDestination, GetGpuHandle(GetMipUavIndex(mip)));
+			CmdList->Dispatch((dstWidth + GROUP_SIZE - 1) / GROUP_SIZE, (dstHeight + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+			//	書き終えたミップは次のミップの縮小元とカリングのために読み込みへ
+			D3D12_RESOURCE_BARRIER barrier = {};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			barrier.Transition.pResource = mPyramid.Get();
+			barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+			barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+			barrier.Transition.Subresource = mip;
+			CmdList->ResourceBarrier(1, &barrier);
+
+			srcWidth = dstWidth;
+			srcHeight = dstHeight;
+		}
+		mState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+		//	深度は元に戻す（2段目の描画で続けて使う）
+		barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+		barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		CmdList->ResourceBarrier(1, &barriers[0]);
+	}
+
+	/// <summary>
+	/// カリングの定数に Hi-Z の大きさとフラグを設定する
+	/// </summary>
+	void GpuHiZPyramid::FillConstants(GpuCullConstants& Constants) const
+	{
+		Constants.HiZWidth = mWidth;
+		Constants.HiZHeight = mHeight;
+		Constants.HiZMipCount = mMipCount;
+		if (mMipCount > 0)
+		{
+			Constants.Flags |= GPU_CULL_FLAG_HIZ;
+		}
+	}
+
+	/// <summary>
+	/// 全ミップの SRV（GpuDrivenRenderer::Cull に渡す）
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuHiZPyramid::GetSrv() const
+	{
+		if (mDescriptors.IsValid() == false) return {};
+		return GetGpuHandle(GetFullSrvIndex());
+	}
+
+	/// <summary>
+	/// ピラミッド本体
+	/// </summary>
+	ID3D12Resource* GpuHiZPyramid::GetResource() const
+	{
+		return mPyramid.Get();
+	}
+
+	/// <summary>
+	/// ミップ0の幅
+	/// </summary>
+	uint32_t GpuHiZPyramid::GetWidth() const
+	{
+		return mWidth;
+	}
+
+	/// <summary>
+	/// ミップ0の高さ
+	/// </summary>
+	uint32_t GpuHiZPyramid::GetHeight() const
+	{
+		return mHeight;
+	}
+
+	/// <summary>
+	/// ミップの数
+	/// </summary>
+	uint32_t GpuHiZPyramid::GetMipCount() const
+	{
+		return mMipCount;
+	}
+
+	/// <summary>
+	/// ルートシグネチャと PSO の作成
+	/// </summary>
+	bool GpuHiZPyramid::CreatePipeline(ID3D12Device* Device, const std::filesystem::path& ShaderPath)
+	{
+		D3D12_DESCRIPTOR_RANGE sourceRange = {};
+		sourceRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		sourceRange.NumDescriptors = 1;
+		sourceRange.BaseShaderRegister = 0;
+
+		D3D12_DESCRIPTOR_RANGE destinationRange = {};
+		destinationRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+		destinationRange.NumDescriptors = 1;
+		destinationRange.BaseShaderRegister = 0;
+
+		std::array<D3D12_ROOT_PARAMETER, ROOT_PARAMETER_COUNT> parameters = {};
+		parameters[RootConstants].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		parameters[RootConstants].Constants.ShaderRegister = 0;
+		parameters[RootConstants].Constants.Num32BitValues = 4;
+		parameters[RootSource].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		parameters[RootSource].DescriptorTable.NumDescriptorRanges = 1;
+		parameters[RootSource].DescriptorTable.pDescriptorRanges = &sourceRange;
+		parameters[RootDestination].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		parameters[RootDestination].DescriptorTable.NumDescriptorRanges = 1;
+		parameters[RootDestination].DescriptorTable.pDescriptorRanges = &destinationRange;
+		for (auto& parameter : parameters)
+		{
+			parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		}
+
+		D3D12_ROOT_SIGNATURE_DESC rootDesc = {};
+		rootDesc.NumParameters = static_cast<UINT>(parameters.size());
+		rootDesc.pParameters = parameters.data();
+		rootDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+		Blob signature = nullptr;
+		Blob error = nullptr;
+		HRESULT hr = D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed SerializeRootSignature (HiZBuild). {}", error != nullptr ? static_cast<const char*>(error->GetBufferPointer()) : "");
+			return false;
+		}
+
+		hr = Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mRootSignature));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateRootSignature (HiZBuild).");
+			return false;
+		}
+
+		Blob shader = ShaderCompiler::CompileFromFile(ShaderPath, "CSMain", "cs_5_1");
+		if (shader == nullptr) return false;
+
+		D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+		psoDesc.pRootSignature = mRootSignature.Get();
+		psoDesc.CS.pShaderBytecode = shader->GetBufferPointer();
+		psoDesc.CS.BytecodeLength = shader->GetBufferSize();
+
+		hr = Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&mPso));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateComputePipelineState (HiZBuild).");
+			return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 借りたディスクリプタの Index 番目（CPU）
+	/// </summary>
+	D3D12_CPU_DESCRIPTOR_HANDLE GpuHiZPyramid::GetCpuHandle(uint32_t Index) const
+	{
+		auto* heapManager = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		D3D12_CPU_DESCRIPTOR_HANDLE handle = heapManager->GetCpuHandle(mDescriptors);
+		handle.ptr += static_cast<SIZE_T>(Index) * mDescriptorSize;
+		return handle;
+	}
+
+	/// <summary>
+	/// 借りたディスクリプタの Index 番目（GPU）
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuHiZPyramid::GetGpuHandle(uint32_t Index) const
+	{
+		auto* heapManager = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		D3D12_GPU_DESCRIPTOR_HANDLE handle = heapManager->GetGpuHandle(mDescriptors);
+		handle.ptr += static_cast<UINT64>(Index) * mDescriptorSize;
+		return handle;
+	}
+}
@@ -0,0 +1,392 @@
+﻿#include "pch.h"
+#include<Graphics/GpuDriven/GpuMeshletCuller.hpp>
+#include<Graphics/DX12/UploadRingBuffer.hpp>
+#include<Graphics/Mesh/MeshAsset.hpp>
+#include<Graphics/Shader/ShaderCompiler.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// バッファの作成
+		/// </summary>
+		bool CreateBuffer(ID3D12Device* Device, uint64_t Size, D3D12_RESOURCE_FLAGS Flags, Resource& OutResource)
+		{
+			D3D12_HEAP_PROPERTIES heapProp = {};
+			heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+			heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			desc.Width = Size;
+			desc.Height = 1;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = 1;
+			desc.Format = DXGI_FORMAT_UNKNOWN;
+			desc.SampleDesc.Count = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			desc.Flags = Flags;
+
+			const HRESULT hr = Device->CreateCommittedResource(
+				&heapProp,
+				D3D12_HEAP_FLAG_NONE,
+				&desc,
+				D3D12_RESOURCE_STATE_COMMON,
+				nullptr,
+				IID_PPV_ARGS(&OutResource)
+			);
+			return SUCCEEDED(hr);
+		}
+	}
+
+	static_assert(sizeof(IndirectDrawArgs) == sizeof(D3D12_DRAW_ARGUMENTS), "IndirectDrawArgs must match D3D12_DRAW_ARGUMENTS.");
+
+	GpuMeshletCuller::GpuMeshletCuller()
+		:mCullRootSignature(nullptr)
+		, mCullPso(nullptr)
+		, mCommandSignature(nullptr)
+		, mMeshletBuffer(nullptr)
+		, mBoundsBuffer(nullptr)
+		, mVertexBuffer(nullptr)
+		, mTriangleBuffer(nullptr)
+		, mVisibleBuffer(nullptr)
+		, mDrawArgsBuffer(nullptr)
+		, mMeshletState(D3D12_RESOURCE_STATE_COMMON)
+		, mBoundsState(D3D12_RESOURCE_STATE_COMMON)
+		, mVertexState(D3D12_RESOURCE_STATE_COMMON)
+		, mTriangleState(D3D12_RESOURCE_STATE_COMMON)
+		, mVisibleState(D3D12_RESOURCE_STATE_COMMON)
+		, mDrawArgsState(D3D12_RESOURCE_STATE_COMMON)
+		, mMaxMeshlets(0)
+		, mMeshletCount(0)
+	{
+	}
+
+	GpuMeshletCuller::~GpuMeshletCuller()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="MaxMeshlets">メッシュレットの最大数</param>
+	/// <param name="ShaderPath">MeshletCulling.hlsl の場所</param>
+	/// <returns>true:成功</returns>
+	bool GpuMeshletCuller::Initialize(ID3D12Device* Device, uint32_t MaxMeshlets, const std::filesystem::path& ShaderPath)
+	{
+		Release();
+		if (Device == nullptr || MaxMeshlets == 0) return false;
+
+		if (CreateCullPipeline(Device, ShaderPath) == false) return false;
+
+		//	引数は Draw だけなので描画側のルートシグネチャは要らない
+		D3D12_INDIRECT_ARGUMENT_DESC argument = {};
+		argument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+
+		D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+		signatureDesc.ByteStride = sizeof(IndirectDrawArgs);
+		signatureDesc.NumArgumentDescs = 1;
+		signatureDesc.pArgumentDescs = &argument;
+		signatureDesc.NodeMask = 0;
+
+		const HRESULT hr = Device->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(&mCommandSignature));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommandSignature (Meshlet).");
+			Release();
+			return false;
+		}
+
+		const uint64_t maxMeshlets = MaxMeshlets;
+		const bool isCreated =
+			CreateBuffer(Device, maxMeshlets * sizeof(Meshlet), D3D12_RESOURCE_FLAG_NONE, mMeshletBuffer) &&
+			CreateBuffer(Device, maxMeshlets * sizeof(MeshletBounds), D3D12_RESOURCE_FLAG_NONE, mBoundsBuffer) &&
+			CreateBuffer(Device, maxMeshlets * MESHLET_MAX_VERTICES * sizeof(uint32_t), D3D12_RESOURCE_FLAG_NONE, mVertexBuffer) &&
+			CreateBuffer(Device, maxMeshlets * MESHLET_MAX_TRIANGLES * sizeof(uint32_t), D3D12_RESOURCE_FLAG_NONE, mTriangleBuffer) &&
+			CreateBuffer(Device, maxMeshlets * sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, mVisibleBuffer) &&
+			CreateBuffer(Device, sizeof(IndirectDrawArgs), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, mDrawArgsBuffer);
+		if (isCreated == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateMeshletBuffers.");
+			Release();
+			return false;
+		}
+
+		mMaxMeshlets = MaxMeshlets;
+		return true;
+	}
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void GpuMeshletCuller::Release()
+	{
+		mCullRootSignature.Reset();
+		mCullPso.Reset();
+		mCommandSignature.Reset();
+		mMeshletBuffer.Reset();
+		mBoundsBuffer.Reset();
+		mVertexBuffer.Reset();
+		mTriangleBuffer.Reset();
+		mVisibleBuffer.Reset();
+		mDrawArgsBuffer.Reset();
+
+		mMeshletState = D3D12_RESOURCE_STATE_COMMON;
+		mBoundsState = D3D12_RESOURCE_STATE_COMMON;
+		mVertexState = D3D12_RESOURCE_STATE_COMMON;
+		mTriangleState = D3D12_RESOURCE_STATE_COMMON;
+		mVisibleState = D3D12_RESOURCE_STATE_COMMON;
+		mDrawArgsState = D3D12_RESOURCE_STATE_COMMON;
+
+		mMaxMeshlets = 0;
+		mMeshletCount = 0;
+	}
+
+	/// <summary>
+	/// メッシュレットを GPU のバッファへ送る（メッシュが変わった時だけで良い）
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool GpuMeshletCuller::Upload(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshletMesh& Mesh)
+	{
+		return UploadStreams(CmdList, Ring, Mesh.Meshlets, Mesh.Bounds, Mesh.Vertices, Mesh.Triangles);
+	}
+
+	/// <summary>
+	/// 焼いたメッシュのメッシュレットを、割り当てたファイルから直接送る
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool GpuMeshletCuller::Upload(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshAsset& Asset)
+	{
+		if (Asset.IsOpen() == false) return false;
+
+		return UploadStreams(CmdList, Ring,
+			Asset.GetStreamAs<Meshlet>(EMeshStream::Meshlet),
+			Asset.GetStreamAs<MeshletBounds>(EMeshStream::MeshletBounds),
+			Asset.GetStreamAs<uint32_t>(EMeshStream::MeshletVertex),
+			Asset.GetStreamAs<uint32_t>(EMeshStream::MeshletTriangle));
+	}
+
+	/// <summary>
+	/// 4つのストリームを送る
+	/// </summary>
+	bool GpuMeshletCuller::UploadStreams(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, std::span<const Meshlet> Meshlets, std::span<const MeshletBounds> Bounds, std::span<const uint32_t> Vertices, std::span<const uint32_t> Triangles)
+	{
+		if (CmdList == nullptr || mMeshletBuffer == nullptr) return false;
+
+		const uint32_t count = static_cast<uint32_t>(Meshlets.size());
+		if (count > mMaxMeshlets)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "GpuMeshletCuller: too many meshlets. {} > {}", count, mMaxMeshlets);
+			return false;
+		}
+
+		mMeshletCount = 0;
+		if (count == 0) return true;
+
+		const bool isUploaded =
+			UploadBuffer(CmdList, Ring, Meshlets.data(), Meshlets.size_bytes(), mMeshletBuffer.Get(), mMeshletState) &&
+			UploadBuffer(CmdList, Ring, Bounds.data(), Bounds.size_bytes(), mBoundsBuffer.Get(), mBoundsState) &&
+			UploadBuffer(CmdList, Ring, Vertices.data(), Vertices.size_bytes(), mVertexBuffer.Get(), mVertexState) &&
+			UploadBuffer(CmdList, Ring, Triangles.data(), Triangles.size_bytes(), mTriangleBuffer.Get(), mTriangleState);
+		if (isUploaded == false) return false;
+
+		mMeshletCount = count;
+		return true;
+	}
+
+	/// <summary>
+	/// カリングを記録する
+	/// </summary>
+	/// <param name="CmdList">記録先</param>
+	/// <param name="Ring">定数の置き場所</param>
+	/// <param name="Constants">MeshletCulling::MakeConstants で作った定数（数は中で埋める）</param>
+	/// <returns>true:成功</returns>
+	bool GpuMeshletCuller::Cull(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshletCullConstants& Constants)
+	{
+		if (CmdList == nullptr || mDrawArgsBuffer == nullptr) return false;
+
+		MeshletCullConstants constants = Constants;
+		constants.MeshletCount = mMeshletCount;
+
+		const UploadAllocation constantAllocation = Ring.Allocate(sizeof(MeshletCullConstants));
+		const UploadAllocation argsAllocation = Ring.Allocate(sizeof(IndirectDrawArgs), sizeof(uint32_t));
+		if (constantAllocation.IsValid() == false || argsAllocation.IsValid() == false) return false;
+
+		std::memcpy(constantAllocation.pCpu, &constants, sizeof(MeshletCullConstants));
+
+		//	インスタンス数だけをシェーダーが数える
+		IndirectDrawArgs args = {};
+		args.VertexCountPerInstance = MESHLET_MAX_TRIANGLES * 3;
+		args.InstanceCount = 0;
+		std::memcpy(argsAllocation.pCpu, &args, sizeof(IndirectDrawArgs));
+
+		Transition(CmdList, mDrawArgsBuffer.Get(), mDrawArgsState, D3D12_RESOURCE_STATE_COPY_DEST);
+		CmdList->CopyBufferRegion(mDrawArgsBuffer.Get(), 0, Ring.GetResource(), argsAllocation.Offset, sizeof(IndirectDrawArgs));
+		Transition(CmdList, mDrawArgsBuffer.Get(), mDrawArgsState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		Transition(CmdList, mVisibleBuffer.Get(), mVisibleState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		if (mMeshletCount > 0)
+		{
+			CmdList->SetComputeRootSignature(mCullRootSignature.Get());
+			CmdList->SetPipelineState(mCullPso.Get());
+			CmdList->SetComputeRootConstantBufferView(RootConstants, constantAllocation.Gpu);
+			CmdList->SetComputeRootShaderResourceView(RootBounds, mBoundsBuffer->GetGPUVirtualAddress());
+			CmdList->SetComputeRootUnorderedAccessView(RootVisibleMeshlets, mVisibleBuffer->GetGPUVirtualAddress());
+			CmdList->SetComputeRootUnorderedAccessView(RootDrawArgs, mDrawArgsBuffer->GetGPUVirtualAddress());
+			CmdList->Dispatch((mMeshletCount + MESHLET_CULL_GROUP_SIZE - 1) / MESHLET_CULL_GROUP_SIZE, 1, 1);
+		}
+
+		Transition(CmdList, mDrawArgsBuffer.Get(), mDrawArgsState, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+		Transition(CmdList, mVisibleBuffer.Get(), mVisibleState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		return true;
+	}
+
+	/// <summary>
+	/// 残ったメッシュレットを描く（描画側のルートシグネチャ・PSO・頂点は設定済みであること）
+	/// </summary>
+	void GpuMeshletCuller::Execute(ID3D12GraphicsCommandList* CmdList)
+	{
+		if (CmdList == nullptr || mCommandSignature == nullptr) return;
+		if (mDrawArgsState != D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT) return;
+
+		CmdList->ExecuteIndirect(mCommandSignature.Get(), 1, mDrawArgsBuffer.Get(), 0, nullptr, 0);
+	}
+
+	/// <summary>
+	/// Meshlet の配列のアドレス
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GpuMeshletCuller::GetMeshletBufferAddress() const
+	{
+		return mMeshletBuffer != nullptr ? mMeshletBuffer->GetGPUVirtualAddress() : 0;
+	}
+
+	/// <summary>
+	/// 頂点の添字の配列のアドレス
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GpuMeshletCuller::GetVertexBufferAddress() const
+	{
+		return mVertexBuffer != nullptr ? mVertexBuffer->GetGPUVirtualAddress() : 0;
+	}
+
+	/// <summary>
+	/// 詰めた三角形の配列のアドレス
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GpuMeshletCuller::GetTriangleBufferAddress() const
+	{
+		return mTriangleBuffer != nullptr ? mTriangleBuffer->GetGPUVirtualAddress() : 0;
+	}
+
+	/// <summary>
+	/// 残ったメッシュレットの添字の配列のアドレス
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GpuMeshletCuller::GetVisibleBufferAddress() const
+	{
+		return mVisibleBuffer != nullptr ? mVisibleBuffer->GetGPUVirtualAddress() : 0;
+	}
+
+	/// <summary>
+	/// 送ったメッシュレットの数
+	/// </summary>
+	uint32_t GpuMeshletCuller::GetMeshletCount() const
+	{
+		return mMeshletCount;
+	}
+
+	/// <summary>
+	/// カリング用のルートシグネチャと PSO の作成
+	/// </summary>
+	bool GpuMeshletCuller::CreateCullPipeline(ID3D12Device* Device, const std::filesystem::path& ShaderPath)
+	{
+		std::array<D3D12_ROOT_PARAMETER, ROOT_PARAMETER_COUNT> parameters = {};
+		parameters[RootConstants].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		parameters[RootConstants].Descriptor.ShaderRegister = 0;
+		parameters[RootBounds].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		parameters[RootBounds].Descriptor.ShaderRegister = 0;
+		parameters[RootVisibleMeshlets].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		parameters[RootVisibleMeshlets].Descriptor.ShaderRegister = 0;
+		parameters[RootDrawArgs].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		parameters[RootDrawArgs].Descriptor.ShaderRegister = 1;
+		for (auto& parameter : parameters)
+		{
+			parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		}
+
+		D3D12_ROOT_SIGNATURE_DESC rootDesc = {};
+		rootDesc.NumParameters = static_cast<UINT>(parameters.size());
+		rootDesc.pParameters = parameters.data();
+		rootDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+		Blob signature = nullptr;
+		Blob error = nullptr;
+		HRESULT hr = D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed SerializeRootSignature (MeshletCulling). {}", error != nullptr ? static_cast<const char*>(error->GetBufferPointer()) : "");
+			return false;
+		}
+
+		hr = Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mCullRootSignature));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateRootSignature (MeshletCulling).");
+			return false;
+		}
+
+		Blob shader = ShaderCompiler::CompileFromFile(ShaderPath, "CSMain", "cs_5_1");
+		if (shader == nullptr) return false;
+
+		D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+		psoDesc.pRootSignature = mCullRootSignature.Get();
+		psoDesc.CS.pShaderBytecode = shader->GetBufferPointer();
+		psoDesc.CS.BytecodeLength = shader->GetBufferSize();
+
+		hr = Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&mCullPso));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateComputePipelineState (MeshletCulling).");
+			return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 配列を DEFAULT のバッファへ送る
+	/// </summary>
+	bool GpuMeshletCuller::UploadBuffer(ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const void* pData, uint64_t Size, ID3D12Resource* Dest, D3D12_RESOURCE_STATES& State)
+	{
+		if (Size == 0) return true;
+
+		const UploadAllocation allocation = Ring.Allocate(Size);
+		if (allocation.IsValid() == false) return false;
+
+		std::memcpy(allocation.pCpu, pData, Size);
+
+		Transition(CmdList, Dest, State, D3D12_RESOURCE_STATE_COPY_DEST);
+		CmdList->CopyBufferRegion(Dest, 0, Ring.GetResource(), allocation.Offset, Size);
+		Transition(CmdList, Dest, State, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		return true;
+	}
+
+	/// <summary>
+	/// 状態が違えば遷移を記録する
+	/// </summary>
+	void GpuMeshletCuller::Transition(ID3D12GraphicsCommandList* CmdList, ID3D12Resource* Resource, D3D12_RESOURCE_STATES& State, D3D12_RESOURCE_STATES After)
+	{
+		if (State == After) return;
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = Resource;
+		barrier.Transition.StateBefore = State;
+		barrier.Transition.StateAfter = After;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		CmdList->ResourceBarrier(1, &barrier);
+
+		State = After;
+	}
+}
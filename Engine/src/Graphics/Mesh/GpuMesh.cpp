@@ -0,0 +1,157 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/GpuMesh.hpp>
+#include<Graphics/DX12/UploadRingBuffer.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 頂点・インデックス・シェーダーから読む状態をまとめたもの
+		/// </summary>
+		constexpr D3D12_RESOURCE_STATES MESH_READ_STATE =
+			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER |
+			D3D12_RESOURCE_STATE_INDEX_BUFFER |
+			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	}
+
+	GpuMesh::GpuMesh()
+		:mBuffer(nullptr)
+		, mHeader()
+	{
+	}
+
+	GpuMesh::~GpuMesh()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// バッファを作り、コピーを記録する（ファイルはこの後すぐ閉じて良い）
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="CmdList">記録先</param>
+	/// <param name="Ring">コピー元の置き場所（全ストリームが1度に入る大きさが要る）</param>
+	/// <param name="Asset">開いたファイル</param>
+	/// <returns>true:成功</returns>
+	bool GpuMesh::Upload(ID3D12Device* Device, ID3D12GraphicsCommandList* CmdList, UploadRingBuffer& Ring, const MeshAsset& Asset)
+	{
+		Release();
+		if (Device == nullptr || CmdList == nullptr || Asset.IsOpen() == false) return false;
+
+		const std::span<const uint8_t> data = Asset.GetData();
+		const UploadAllocation allocation = Ring.Allocate(data.size());
+		if (allocation.IsValid() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "GpuMesh: upload ring is full. size={}", data.size());
+			return false;
+		}
+
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = data.size();
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		//	バッファは COMMON から暗黙にコピー先へ移れる
+		const HRESULT hr = Device->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&mBuffer)
+		);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommittedResource (GpuMesh).");
+			return false;
+		}
+
+		//	割り当てたページキャッシュから直接アップロードリングへ
+		std::memcpy(allocation.pCpu, data.data(), data.size());
+		CmdList->CopyBufferRegion(mBuffer.Get(), 0, Ring.GetResource(), allocation.Offset, data.size());
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = mBuffer.Get();
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barrier.Transition.StateAfter = MESH_READ_STATE;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		CmdList->ResourceBarrier(1, &barrier);
+
+		mHeader = Asset.GetHeader();
+		return true;
+	}
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void GpuMesh::Release()
+	{
+		mBuffer.Reset();
+		mHeader = {};
+	}
+
+	/// <summary>
+	/// 送ったか
+	/// </summary>
+	bool GpuMesh::IsValid() const
+	{
+		return mBuffer != nullptr;
+	}
+
+	/// <summary>
+	/// ストリームの GPU アドレス（無ければ 0）
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GpuMesh::GetStreamAddress(EMeshStream Stream) const
+	{
+		const MeshStreamDesc& desc = mHeader.Streams[static_cast<uint32_t>(Stream)];
+		if (mBuffer == nullptr || desc.Size == 0) return 0;
+		return mBuffer->GetGPUVirtualAddress() + (desc.Offset - mHeader.DataOffset);
+	}
+
+	/// <summary>
+	/// 頂点バッファのビュー（Position・Normal・TexCoord）
+	/// </summary>
+	D3D12_VERTEX_BUFFER_VIEW GpuMesh::GetVertexBufferView(EMeshStream Stream) const
+	{
+		const MeshStreamDesc& desc = mHeader.Streams[static_cast<uint32_t>(Stream)];
+
+		D3D12_VERTEX_BUFFER_VIEW view = {};
+		view.BufferLocation = GetStreamAddress(Stream);
+		view.SizeInBytes = static_cast<UINT>(desc.Size);
+		view.StrideInBytes = desc.Stride;
+		return view;
+	}
+
+	/// <summary>
+	/// インデックスバッファのビュー
+	/// </summary>
+	D3D12_INDEX_BUFFER_VIEW GpuMesh::GetIndexBufferView() const
+	{
+		D3D12_INDEX_BUFFER_VIEW view = {};
+		view.BufferLocation = GetStreamAddress(EMeshStream::Index);
+		view.SizeInBytes = static_cast<UINT>(mHeader.Streams[static_cast<uint32_t>(EMeshStream::Index)].Size);
+		view.Format = DXGI_FORMAT_R32_UINT;
+		return view;
+	}
+
+	/// <summary>
+	/// 送った時のヘッダー
+	/// </summary>
+	const MeshAssetHeader& GpuMesh::GetHeader() const
+	{
+		return mHeader;
+	}
+}
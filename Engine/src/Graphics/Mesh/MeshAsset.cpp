@@ -0,0 +1,147 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/MeshAsset.hpp>
+
+namespace Ecse::Graphics
+{
+	MeshAsset::MeshAsset()
+		:mFile()
+		, mpHeader(nullptr)
+	{
+	}
+
+	MeshAsset::~MeshAsset()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// 開いてヘッダーを確かめる
+	/// </summary>
+	/// <param name="Path">ファイルの場所</param>
+	/// <returns>true:成功</returns>
+	bool MeshAsset::Open(const std::filesystem::path& Path)
+	{
+		Release();
+
+		if (mFile.Open(Path) == false) return false;
+
+		if (Validate(mFile.GetBytes()) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAsset: invalid file. ({})", Path.string());
+			Release();
+			return false;
+		}
+
+		//	この後はすぐに全体を読むので先読みさせておく
+		mFile.Prefetch();
+		mpHeader = reinterpret_cast<const MeshAssetHeader*>(mFile.GetBytes().data());
+		return true;
+	}
+
+	/// <summary>
+	/// 閉じる
+	/// </summary>
+	void MeshAsset::Release()
+	{
+		mFile.Release();
+		mpHeader = nullptr;
+	}
+
+	/// <summary>
+	/// 開いているか
+	/// </summary>
+	bool MeshAsset::IsOpen() const
+	{
+		return mpHeader != nullptr;
+	}
+
+	/// <summary>
+	/// ヘッダー（開いていること）
+	/// </summary>
+	const MeshAssetHeader& MeshAsset::GetHeader() const
+	{
+		assert(mpHeader != nullptr);
+		return *mpHeader;
+	}
+
+	/// <summary>
+	/// ストリームの中身（開いていなければ空）
+	/// </summary>
+	std::span<const uint8_t> MeshAsset::GetStream(EMeshStream Stream) const
+	{
+		if (mpHeader == nullptr) return {};
+
+		const MeshStreamDesc& desc = mpHeader->Streams[static_cast<uint32_t>(Stream)];
+		return mFile.GetBytes().subspan(static_cast<size_t>(desc.Offset), static_cast<size_t>(desc.Size));
+	}
+
+	/// <summary>
+	/// 全てのストリームをまとめた範囲（GPU へ1回で送る時に使う）
+	/// </summary>
+	std::span<const uint8_t> MeshAsset::GetData() const
+	{
+		if (mpHeader == nullptr) return {};
+		return mFile.GetBytes().subspan(static_cast<size_t>(mpHeader->DataOffset), static_cast<size_t>(mpHeader->DataSize));
+	}
+
+	/// <summary>
+	/// 中身が正しい並びになっているか（ヘッダーと範囲だけを見る）
+	/// </summary>
+	/// <param name="Bytes">ファイル全体</param>
+	/// <returns>true:正しい</returns>
+	bool MeshAsset::Validate(std::span<const uint8_t> Bytes)
+	{
+		if (Bytes.size() < sizeof(MeshAssetHeader)) return false;
+
+		MeshAssetHeader header;
+		std::memcpy(&header, Bytes.data(), sizeof(header));
+
+		if (header.Magic != MESH_ASSET_MAGIC || header.Version != MESH_ASSET_VERSION) return false;
+		if (header.FileSize != Bytes.size()) return false;
+		if (header.DataOffset < sizeof(MeshAssetHeader) || header.DataOffset % MESH_ASSET_ALIGNMENT != 0) return false;
+		if (header.DataOffset + header.DataSize != header.FileSize) return false;
+
+		//	ストリームは順に並び、データの範囲からはみ出さない
+		uint64_t end = header.DataOffset;
+		for (uint32_t i = 0; i < MESH_STREAM_COUNT; ++i)
+		{
+			const MeshStreamDesc& desc = header.Streams[i];
+			if (desc.Stride != GetStreamStride(static_cast<EMeshStream>(i), header.Flags)) return false;
+			if (desc.Offset < end || desc.Offset % MESH_ASSET_ALIGNMENT != 0) return false;
+			if (desc.Size != static_cast<uint64_t>(desc.Stride) * desc.Count) return false;
+			if (desc.Offset + desc.Size > header.FileSize) return false;
+			end = desc.Offset + desc.Size;
+		}
+
+		//	数はヘッダーとストリームで揃っている
+		const auto count = [&header](EMeshStream Stream) { return header.Streams[static_cast<uint32_t>(Stream)].Count; };
+		if (count(EMeshStream::Position) != header.VertexCount || count(EMeshStream::Index) != header.IndexCount) return false;
+		if (count(EMeshStream::Normal) != 0 && count(EMeshStream::Normal) != header.VertexCount) return false;
+		if (count(EMeshStream::TexCoord) != 0 && count(EMeshStream::TexCoord) != header.VertexCount) return false;
+		if (count(EMeshStream::Meshlet) != header.MeshletCount || count(EMeshStream::MeshletBounds) != header.MeshletCount) return false;
+		if (header.IndexCount % 3 != 0) return false;
+
+		return true;
+	}
+
+	/// <summary>
+	/// ストリームの要素1つの大きさ（この版での値）
+	/// </summary>
+	/// <param name="Stream">ストリーム</param>
+	/// <param name="Flags">MESH_ASSET_FLAG_ の組み合わせ</param>
+	uint32_t MeshAsset::GetStreamStride(EMeshStream Stream, uint32_t Flags)
+	{
+		switch (Stream)
+		{
+		case EMeshStream::Position: return (Flags & MESH_ASSET_FLAG_QUANTIZED_POSITION) != 0 ? sizeof(uint16_t) * 4 : sizeof(DirectX::XMFLOAT3);
+		case EMeshStream::Normal: return (Flags & MESH_ASSET_FLAG_QUANTIZED_NORMAL) != 0 ? sizeof(int16_t) * 2 : sizeof(DirectX::XMFLOAT3);
+		case EMeshStream::TexCoord: return sizeof(DirectX::XMFLOAT2);
+		case EMeshStream::Index: return sizeof(uint32_t);
+		case EMeshStream::Meshlet: return sizeof(Meshlet);
+		case EMeshStream::MeshletBounds: return sizeof(MeshletBounds);
+		case EMeshStream::MeshletVertex: return sizeof(uint32_t);
+		case EMeshStream::MeshletTriangle: return sizeof(uint32_t);
+		}
+		return 0;
+	}
+}
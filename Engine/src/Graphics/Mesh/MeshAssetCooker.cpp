@@ -0,0 +1,273 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/MeshAssetCooker.hpp>
+#include<Graphics/Mesh/MeshAsset.hpp>
+#include<Graphics/Mesh/MeshletBuilder.hpp>
+
+#include<cfloat>
+
+using namespace DirectX;
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// Alignment の倍数に切り上げる
+		/// </summary>
+		constexpr uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+		{
+			return (Value + Alignment - 1) & ~(Alignment - 1);
+		}
+	}
+
+	/// <summary>
+	/// 足りないもの（法線・メッシュレット）を作り、並べ替える
+	/// </summary>
+	/// <param name="Data">焼く前のメッシュ</param>
+	/// <param name="Settings">設定</param>
+	/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+	/// <returns>true:成功</returns>
+	bool MeshAssetCooker::Cook(MeshAssetData& Data, const MeshCookSettings& Settings, MeshCookStats* pStats)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		if (Data.Positions.empty() || Data.Indices.empty() || Data.Indices.size() % 3 != 0)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAssetCooker: empty or broken mesh. vertices={} indices={}", Data.Positions.size(), Data.Indices.size());
+			return false;
+		}
+		if (Data.TexCoords.empty() == false && Data.TexCoords.size() != Data.Positions.size())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAssetCooker: texcoord count mismatch. {} != {}", Data.TexCoords.size(), Data.Positions.size());
+			return false;
+		}
+		const uint32_t sourceVertexCount = static_cast<uint32_t>(Data.Positions.size());
+		if (std::any_of(Data.Indices.begin(), Data.Indices.end(), [sourceVertexCount](uint32_t Index) { return Index >= sourceVertexCount; }))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAssetCooker: index out of range. vertices={}", sourceVertexCount);
+			return false;
+		}
+
+		if (Data.Normals.size() != Data.Positions.size())
+		{
+			ComputeNormals(Data.Positions, Data.Indices, Data.Normals);
+		}
+
+		const VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(Data.Indices, sourceVertexCount);
+
+		//	三角形の順 → 頂点の順の順に決める（頂点の順は三角形の順で決まるため）
+		if (Settings.OptimizeVertexCache)
+		{
+			std::vector<uint32_t> clusters;
+			MeshOptimizer::OptimizeVertexCache(Data.Indices, sourceVertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, &clusters);
+			if (Settings.OptimizeOverdraw)
+			{
+				MeshOptimizer::OptimizeOverdraw(Data.Indices, Data.Positions, clusters, Settings.OverdrawThreshold);
+			}
+			Data.Meshlets.Clear();
+		}
+		if (Settings.OptimizeVertexFetch)
+		{
+			MeshOptimizer::OptimizeVertexFetch(Data);
+		}
+
+		if (Data.Meshlets.Meshlets.empty())
+		{
+			if (MeshletBuilder::Build(Data.Positions, Data.Indices, Data.Meshlets) == false) return false;
+		}
+
+		if (pStats != nullptr)
+		{
+			pStats->VertexCount = static_cast<uint32_t>(Data.Positions.size());
+			pStats->TriangleCount = static_cast<uint32_t>(Data.Indices.size() / 3);
+			pStats->MeshletCount = static_cast<uint32_t>(Data.Meshlets.Meshlets.size());
+			pStats->Before = before;
+			pStats->After = MeshOptimizer::AnalyzeVertexCache(Data.Indices, pStats->VertexCount);
+			pStats->ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// ファイルの中身を作る
+	/// </summary>
+	/// <param name="Data">Cook 済みのメッシュ</param>
+	/// <param name="Flags">MESH_ASSET_FLAG_ の組み合わせ</param>
+	/// <param name="OutBytes">ファイル全体</param>
+	/// <returns>true:成功</returns>
+	bool MeshAssetCooker::Serialize(const MeshAssetData& Data, uint32_t Flags, std::vector<uint8_t>& OutBytes)
+	{
+		OutBytes.clear();
+
+		const uint32_t vertexCount = static_cast<uint32_t>(Data.Positions.size());
+		const uint32_t meshletCount = static_cast<uint32_t>(Data.Meshlets.Meshlets.size());
+		if (vertexCount == 0 || Data.Normals.size() != vertexCount || Data.Meshlets.Bounds.size() != meshletCount)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAssetCooker: mesh is not cooked.");
+			return false;
+		}
+
+		MeshAssetHeader header = {};
+		header.Magic = MESH_ASSET_MAGIC;
+		header.Version = MESH_ASSET_VERSION;
+		header.VertexCount = vertexCount;
+		header.IndexCount = static_cast<uint32_t>(Data.Indices.size());
+		header.MeshletCount = meshletCount;
+		header.Flags = Flags;
+		header.DataOffset = AlignUp(sizeof(MeshAssetHeader), MESH_ASSET_ALIGNMENT);
+
+		//	包む AABB と、その中心からの球
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+		for (const XMFLOAT3& position : Data.Positions)
+		{
+			const XMVECTOR p = XMLoadFloat3(&position);
+			minimum = XMVectorMin(minimum, p);
+			maximum = XMVectorMax(maximum, p);
+		}
+		const XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+		float radiusSq = 0.0f;
+		for (const XMFLOAT3& position : Data.Positions)
+		{
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&position), center))));
+		}
+		XMStoreFloat3(&header.BoundsMin, minimum);
+		XMStoreFloat3(&header.BoundsMax, maximum);
+		XMStoreFloat3(&header.Center, center);
+		header.Radius = std::sqrt(radiusSq);
+
+		//	量子化は AABB が決まってから
+		std::vector<std::array<uint16_t, 4>> quantizedPositions;
+		std::vector<MeshletBounds> quantizedBounds;
+		if ((Flags & MESH_ASSET_FLAG_QUANTIZED_POSITION) != 0)
+		{
+			quantizedPositions.resize(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				MeshOptimizer::QuantizePosition(Data.Positions[i], header.BoundsMin, header.BoundsMax, quantizedPositions[i].data());
+			}
+
+			//	頂点は最大で半目盛りずれるので、その分だけメッシュレットの球を広げて判定を保守的に保つ
+			const float error = 0.5f * XMVectorGetX(XMVector3Length(XMVectorScale(XMVectorSubtract(maximum, minimum), 1.0f / 65535.0f)));
+			quantizedBounds = Data.Meshlets.Bounds;
+			for (MeshletBounds& bounds : quantizedBounds)
+			{
+				bounds.Radius += error;
+			}
+		}
+		std::vector<std::array<int16_t, 2>> quantizedNormals;
+		if ((Flags & MESH_ASSET_FLAG_QUANTIZED_NORMAL) != 0)
+		{
+			quantizedNormals.resize(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				MeshOptimizer::EncodeOctahedral(Data.Normals[i], quantizedNormals[i].data());
+			}
+		}
+
+		//	EMeshStream の順に並べる
+		const std::array<std::pair<const void*, uint32_t>, MESH_STREAM_COUNT> sources = { {
+			{ quantizedPositions.empty() ? static_cast<const void*>(Data.Positions.data()) : quantizedPositions.data(), vertexCount },
+			{ quantizedNormals.empty() ? static_cast<const void*>(Data.Normals.data()) : quantizedNormals.data(), vertexCount },
+			{ Data.TexCoords.data(), static_cast<uint32_t>(Data.TexCoords.size()) },
+			{ Data.Indices.data(), static_cast<uint32_t>(Data.Indices.size()) },
+			{ Data.Meshlets.Meshlets.data(), meshletCount },
+			{ quantizedBounds.empty() ? Data.Meshlets.Bounds.data() : quantizedBounds.data(), meshletCount },
+			{ Data.Meshlets.Vertices.data(), static_cast<uint32_t>(Data.Meshlets.Vertices.size()) },
+			{ Data.Meshlets.Triangles.data(), static_cast<uint32_t>(Data.Meshlets.Triangles.size()) },
+		} };
+
+		uint64_t offset = header.DataOffset;
+		for (uint32_t i = 0; i < MESH_STREAM_COUNT; ++i)
+		{
+			MeshStreamDesc& desc = header.Streams[i];
+			desc.Stride = MeshAsset::GetStreamStride(static_cast<EMeshStream>(i), Flags);
+			desc.Count = sources[i].second;
+			desc.Size = static_cast<uint64_t>(desc.Stride) * desc.Count;
+			desc.Offset = AlignUp(offset, MESH_ASSET_ALIGNMENT);
+			offset = desc.Offset + desc.Size;
+		}
+		header.FileSize = AlignUp(offset, MESH_ASSET_ALIGNMENT);
+		header.DataSize = header.FileSize - header.DataOffset;
+
+		//	隙間は 0 で埋まる
+		OutBytes.resize(static_cast<size_t>(header.FileSize));
+		std::memcpy(OutBytes.data(), &header, sizeof(header));
+		for (uint32_t i = 0; i < MESH_STREAM_COUNT; ++i)
+		{
+			const MeshStreamDesc& desc = header.Streams[i];
+			if (desc.Size == 0) continue;
+			std::memcpy(OutBytes.data() + desc.Offset, sources[i].first, static_cast<size_t>(desc.Size));
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 焼いてファイルに書き出す
+	/// </summary>
+	/// <param name="Path">書き出し先</param>
+	/// <param name="Data">焼く前のメッシュ（足りないものは中で作る）</param>
+	/// <param name="Settings">設定</param>
+	/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+	/// <returns>true:成功</returns>
+	bool MeshAssetCooker::Write(const std::filesystem::path& Path, MeshAssetData& Data, const MeshCookSettings& Settings, MeshCookStats* pStats)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		if (Cook(Data, Settings, pStats) == false) return false;
+
+		std::vector<uint8_t> bytes;
+		if (Serialize(Data, Settings.Flags, bytes) == false) return false;
+
+		std::ofstream file(Path, std::ios::binary | std::ios::trunc);
+		if (file.is_open() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAssetCooker: failed to open. ({})", Path.string());
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		if (file.good() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshAssetCooker: failed to write. ({})", Path.string());
+			return false;
+		}
+
+		if (pStats != nullptr)
+		{
+			pStats->FileSize = bytes.size();
+			pStats->ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 面積で重み付けした頂点の法線を求める
+	/// </summary>
+	void MeshAssetCooker::ComputeNormals(const std::vector<XMFLOAT3>& Positions, const std::vector<uint32_t>& Indices, std::vector<XMFLOAT3>& OutNormals)
+	{
+		OutNormals.assign(Positions.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+		for (size_t i = 0; i + 2 < Indices.size(); i += 3)
+		{
+			const uint32_t i0 = Indices[i + 0];
+			const uint32_t i1 = Indices[i + 1];
+			const uint32_t i2 = Indices[i + 2];
+			if (i0 >= Positions.size() || i1 >= Positions.size() || i2 >= Positions.size()) continue;
+
+			//	時計回りが表なので (p1 - p0) x (p2 - p0) が表の向き。長さは面積の2倍
+			const XMVECTOR p0 = XMLoadFloat3(&Positions[i0]);
+			const XMVECTOR faceNormal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&Positions[i1]), p0), XMVectorSubtract(XMLoadFloat3(&Positions[i2]), p0));
+			for (const uint32_t index : { i0, i1, i2 })
+			{
+				XMStoreFloat3(&OutNormals[index], XMVectorAdd(XMLoadFloat3(&OutNormals[index]), faceNormal));
+			}
+		}
+
+		for (XMFLOAT3& normal : OutNormals)
+		{
+			const XMVECTOR n = XMLoadFloat3(&normal);
+			const float length = XMVectorGetX(XMVector3Length(n));
+			XMStoreFloat3(&normal, length > 0.0f ? XMVectorScale(n, 1.0f / length) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		}
+	}
+}
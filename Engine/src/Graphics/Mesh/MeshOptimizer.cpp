@@ -0,0 +1,429 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/MeshOptimizer.hpp>
+#include<Graphics/Mesh/MeshAssetCooker.hpp>
+
+using namespace DirectX;
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 次に扇を広げる頂点がない
+		/// </summary>
+		constexpr uint32_t INVALID_VERTEX = ~0u;
+
+		/// <summary>
+		/// FIFO の頂点キャッシュ
+		/// 入れた時刻を頂点ごとに持ち、CacheSize 回以内に入れたものをキャッシュにあるとみなす。
+		/// </summary>
+		class FifoCache
+		{
+		public:
+			FifoCache(uint32_t VertexCount, uint32_t CacheSize)
+				:mTimestamps(VertexCount, 0)
+				, mTime(CacheSize + 1)
+				, mCacheSize(CacheSize)
+			{
+			}
+
+			/// <summary>
+			/// 頂点を使う
+			/// </summary>
+			/// <returns>true:キャッシュに無かった</returns>
+			bool Access(uint32_t Vertex)
+			{
+				if (mTime - mTimestamps[Vertex] <= mCacheSize) return false;
+				mTimestamps[Vertex] = mTime++;
+				return true;
+			}
+
+			/// <summary>
+			/// 空にする
+			/// </summary>
+			void Flush()
+			{
+				mTime += mCacheSize + 1;
+			}
+
+		private:
+			std::vector<uint32_t> mTimestamps;
+			uint32_t mTime;
+			uint32_t mCacheSize;
+		};
+
+		/// <summary>
+		/// 三角形の重心と面積で重み付けした法線（長さは面積の2倍）
+		/// </summary>
+		void GetTriangleShape(std::span<const uint32_t> Indices, std::span<const XMFLOAT3> Positions, size_t Triangle, XMVECTOR& OutCentroid, XMVECTOR& OutNormal)
+		{
+			const XMVECTOR a = XMLoadFloat3(&Positions[Indices[Triangle * 3 + 0]]);
+			const XMVECTOR b = XMLoadFloat3(&Positions[Indices[Triangle * 3 + 1]]);
+			const XMVECTOR c = XMLoadFloat3(&Positions[Indices[Triangle * 3 + 2]]);
+			OutCentroid = XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), 1.0f / 3.0f);
+			OutNormal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+		}
+	}
+
+	/// <summary>
+	/// 頂点キャッシュに乗る順に三角形を並べ替える
+	/// </summary>
+	/// <param name="Indices">三角形リスト（並べ替える）</param>
+	/// <param name="VertexCount">頂点の数</param>
+	/// <param name="CacheSize">想定するキャッシュの大きさ</param>
+	/// <param name="pOutClusters">行き止まりで途切れた所で分けたクラスタの先頭の三角形（不要なら nullptr）</param>
+	void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> Indices, uint32_t VertexCount, uint32_t CacheSize, std::vector<uint32_t>* pOutClusters)
+	{
+		if (pOutClusters != nullptr) pOutClusters->clear();
+
+		const uint32_t triangleCount = static_cast<uint32_t>(Indices.size() / 3);
+		if (triangleCount == 0 || VertexCount == 0) return;
+
+		//	頂点ごとの三角形の一覧（詰めた配列）と、まだ出していない三角形の数
+		std::vector<uint32_t> liveCounts(VertexCount, 0);
+		for (size_t i = 0; i < static_cast<size_t>(triangleCount) * 3; ++i)
+		{
+			liveCounts[Indices[i]]++;
+		}
+		std::vector<uint32_t> offsets(VertexCount + 1, 0);
+		for (uint32_t v = 0; v < VertexCount; ++v)
+		{
+			offsets[v + 1] = offsets[v] + liveCounts[v];
+		}
+		std::vector<uint32_t> adjacency(offsets[VertexCount]);
+		{
+			std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+			for (uint32_t t = 0; t < triangleCount; ++t)
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					adjacency[cursors[Indices[t * 3 + corner]]++] = t;
+				}
+			}
+		}
+
+		std::vector<uint32_t> timestamps(VertexCount, 0);
+		std::vector<uint8_t> isEmitted(triangleCount, 0);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		deadEnds.reserve(static_cast<size_t>(triangleCount) * 3);
+		output.reserve(static_cast<size_t>(triangleCount) * 3);
+
+		uint32_t time = CacheSize + 1;
+		uint32_t cursor = 0;
+		uint32_t fanning = 0;
+		bool isNewCluster = true;
+		while (fanning != INVALID_VERTEX)
+		{
+			const uint32_t emitted = static_cast<uint32_t>(output.size() / 3);
+			if (isNewCluster && pOutClusters != nullptr && (pOutClusters->empty() || pOutClusters->back() != emitted))
+			{
+				pOutClusters->push_back(emitted);
+			}
+
+			//	扇の中心の残りの三角形を全て出す
+			candidates.clear();
+			for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; ++i)
+			{
+				const uint32_t t = adjacency[i];
+				if (isEmitted[t] != 0) continue;
+
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t v = Indices[t * 3 + corner];
+					output.push_back(v);
+					deadEnds.push_back(v);
+					candidates.push_back(v);
+					liveCounts[v]--;
+					if (time - timestamps[v] > CacheSize)
+					{
+						timestamps[v] = time++;
+					}
+				}
+				isEmitted[t] = 1;
+			}
+
+			//	扇を広げてもキャッシュから落ちない頂点のうち、一番古いものを次の中心にする
+			uint32_t next = INVALID_VERTEX;
+			int64_t bestPriority = -1;
+			for (const uint32_t v : candidates)
+			{
+				if (liveCounts[v] == 0) continue;
+
+				int64_t priority = 0;
+				if (time - timestamps[v] + 2 * liveCounts[v] <= CacheSize)
+				{
+					priority = time - timestamps[v];
+				}
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = v;
+				}
+			}
+
+			//	行き止まり。最近使った頂点から戻り、それも無ければ先頭から探す
+			isNewCluster = next == INVALID_VERTEX;
+			while (next == INVALID_VERTEX && deadEnds.empty() == false)
+			{
+				const uint32_t v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveCounts[v] > 0) next = v;
+			}
+			while (next == INVALID_VERTEX && cursor < VertexCount)
+			{
+				if (liveCounts[cursor] > 0) next = cursor;
+				++cursor;
+			}
+
+			fanning = next;
+		}
+
+		std::copy(output.begin(), output.end(), Indices.begin());
+	}
+
+	/// <summary>
+	/// クラスタを外を向いた順に並べ替え、奥の面が先に描かれるのを減らす
+	/// </summary>
+	/// <param name="Indices">OptimizeVertexCache 済みの三角形リスト（並べ替える）</param>
+	/// <param name="Positions">頂点の位置</param>
+	/// <param name="Clusters">OptimizeVertexCache が返したクラスタ</param>
+	/// <param name="Threshold">クラスタを細かく分けても良い ACMR の悪化の割合（1.05 なら 5%）</param>
+	/// <param name="CacheSize">想定するキャッシュの大きさ</param>
+	void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> Indices, std::span<const XMFLOAT3> Positions, std::span<const uint32_t> Clusters, float Threshold, uint32_t CacheSize)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(Indices.size() / 3);
+		const uint32_t vertexCount = static_cast<uint32_t>(Positions.size());
+		if (triangleCount == 0 || Clusters.empty()) return;
+
+		//	行き止まりのクラスタを、ACMR がクラスタ全体の Threshold 倍以下に収まった所でさらに分ける
+		std::vector<uint32_t> boundaries;
+		FifoCache cache(vertexCount, CacheSize);
+		for (size_t c = 0; c < Clusters.size(); ++c)
+		{
+			const uint32_t begin = Clusters[c];
+			const uint32_t end = c + 1 < Clusters.size() ? Clusters[c + 1] : triangleCount;
+			if (begin >= end) continue;
+
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					clusterMisses += cache.Access(Indices[t * 3 + corner]) ? 1 : 0;
+				}
+			}
+			const float limit = Threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			boundaries.push_back(begin);
+			cache.Flush();
+			uint32_t start = begin;
+			uint32_t misses = 0;
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					misses += cache.Access(Indices[t * 3 + corner]) ? 1 : 0;
+				}
+
+				//	ここで切っても、切った先はキャッシュが空から始まる分だけしか悪くならない
+				if (t + 1 < end && static_cast<float>(misses) <= limit * static_cast<float>(t + 1 - start))
+				{
+					boundaries.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.Flush();
+				}
+			}
+		}
+		boundaries.push_back(triangleCount);
+
+		//	メッシュ全体の重心（面積で重み付け）
+		XMVECTOR meshCentroid = XMVectorZero();
+		float meshArea = 0.0f;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			XMVECTOR centroid, normal;
+			GetTriangleShape(Indices, Positions, t, centroid, normal);
+			const float area = XMVectorGetX(XMVector3Length(normal));
+			meshCentroid = XMVectorAdd(meshCentroid, XMVectorScale(centroid, area));
+			meshArea += area;
+		}
+		if (meshArea > 0.0f) meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+		//	クラスタの重心が、クラスタの向きにどれだけ外へ出ているか
+		struct ClusterKey
+		{
+			uint32_t Begin;
+			uint32_t End;
+			float Sort;
+		};
+		std::vector<ClusterKey> keys;
+		keys.reserve(boundaries.size() - 1);
+		for (size_t c = 0; c + 1 < boundaries.size(); ++c)
+		{
+			XMVECTOR clusterCentroid = XMVectorZero();
+			XMVECTOR clusterNormal = XMVectorZero();
+			float clusterArea = 0.0f;
+			for (uint32_t t = boundaries[c]; t < boundaries[c + 1]; ++t)
+			{
+				XMVECTOR centroid, normal;
+				GetTriangleShape(Indices, Positions, t, centroid, normal);
+				const float area = XMVectorGetX(XMVector3Length(normal));
+				clusterCentroid = XMVectorAdd(clusterCentroid, XMVectorScale(centroid, area));
+				clusterNormal = XMVectorAdd(clusterNormal, normal);
+				clusterArea += area;
+			}
+			if (clusterArea > 0.0f) clusterCentroid = XMVectorScale(clusterCentroid, 1.0f / clusterArea);
+
+			const float sort = XMVectorGetX(XMVector3Dot(XMVectorSubtract(clusterCentroid, meshCentroid), XMVector3Normalize(clusterNormal)));
+			keys.push_back({ boundaries[c], boundaries[c + 1], sort });
+		}
+
+		//	外を向いたクラスタは手前の面を隠すことが多いので先に描く
+		std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey& A, const ClusterKey& B) { return A.Sort > B.Sort; });
+
+		std::vector<uint32_t> output;
+		output.reserve(Indices.size());
+		for (const ClusterKey& key : keys)
+		{
+			output.insert(output.end(), Indices.begin() + key.Begin * 3, Indices.begin() + key.End * 3);
+		}
+		std::copy(output.begin(), output.end(), Indices.begin());
+	}
+
+	/// <summary>
+	/// 頂点を最初に使われる順に並べ替える（使われない頂点は捨てる）
+	/// </summary>
+	/// <param name="Data">メッシュ（頂点のストリームと添字を書き換える）</param>
+	/// <returns>残った頂点の数</returns>
+	uint32_t MeshOptimizer::OptimizeVertexFetch(MeshAssetData& Data)
+	{
+		const size_t vertexCount = Data.Positions.size();
+		std::vector<uint32_t> remap(vertexCount, INVALID_VERTEX);
+
+		uint32_t next = 0;
+		for (uint32_t& index : Data.Indices)
+		{
+			if (remap[index] == INVALID_VERTEX) remap[index] = next++;
+			index = remap[index];
+		}
+
+		const auto reorder = [&remap, next](auto& Stream)
+			{
+				if (Stream.empty()) return;
+
+				std::remove_reference_t<decltype(Stream)> reordered(next);
+				for (size_t v = 0; v < remap.size(); ++v)
+				{
+					if (remap[v] != INVALID_VERTEX) reordered[remap[v]] = Stream[v];
+				}
+				Stream.swap(reordered);
+			};
+		reorder(Data.Positions);
+		reorder(Data.Normals);
+		reorder(Data.TexCoords);
+
+		//	頂点の添字が変わったので作り直す
+		Data.Meshlets.Clear();
+		return next;
+	}
+
+	/// <summary>
+	/// FIFO の頂点キャッシュを真似て効率を測る
+	/// </summary>
+	VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> Indices, uint32_t VertexCount, uint32_t CacheSize)
+	{
+		VertexCacheStats stats;
+		const size_t triangleCount = Indices.size() / 3;
+		if (triangleCount == 0 || VertexCount == 0) return stats;
+
+		FifoCache cache(VertexCount, CacheSize);
+		std::vector<uint8_t> isUsed(VertexCount, 0);
+		uint32_t usedCount = 0;
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			const uint32_t v = Indices[i];
+			stats.Misses += cache.Access(v) ? 1 : 0;
+			usedCount += isUsed[v] == 0 ? 1 : 0;
+			isUsed[v] = 1;
+		}
+
+		stats.Acmr = static_cast<float>(stats.Misses) / static_cast<float>(triangleCount);
+		stats.Atvr = static_cast<float>(stats.Misses) / static_cast<float>(usedCount);
+		return stats;
+	}
+
+	/// <summary>
+	/// [Min, Max] の位置を 16bit の UNORM にする（w は 0）
+	/// </summary>
+	void MeshOptimizer::QuantizePosition(const XMFLOAT3& Position, const XMFLOAT3& Min, const XMFLOAT3& Max, uint16_t OutValue[4])
+	{
+		const auto quantize = [](float Value, float Low, float High)
+			{
+				const float range = High - Low;
+				const float t = range > 0.0f ? std::clamp((Value - Low) / range, 0.0f, 1.0f) : 0.0f;
+				return static_cast<uint16_t>(t * 65535.0f + 0.5f);
+			};
+		OutValue[0] = quantize(Position.x, Min.x, Max.x);
+		OutValue[1] = quantize(Position.y, Min.y, Max.y);
+		OutValue[2] = quantize(Position.z, Min.z, Max.z);
+		OutValue[3] = 0;
+	}
+
+	/// <summary>
+	/// QuantizePosition の逆（R16G16B16A16_UNORM で読んだ値に (Max - Min) を掛けて Min を足すのと同じ）
+	/// </summary>
+	XMFLOAT3 MeshOptimizer::DequantizePosition(const uint16_t Value[4], const XMFLOAT3& Min, const XMFLOAT3& Max)
+	{
+		return XMFLOAT3(
+			Min.x + (Max.x - Min.x) * (Value[0] / 65535.0f),
+			Min.y + (Max.y - Min.y) * (Value[1] / 65535.0f),
+			Min.z + (Max.z - Min.z) * (Value[2] / 65535.0f));
+	}
+
+	/// <summary>
+	/// 単位ベクトルを八面体に写して 16bit の SNORM 2つにする
+	/// </summary>
+	void MeshOptimizer::EncodeOctahedral(const XMFLOAT3& Normal, int16_t OutValue[2])
+	{
+		const float length = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+		float x = length > 0.0f ? Normal.x / length : 0.0f;
+		float y = length > 0.0f ? Normal.y / length : 0.0f;
+
+		//	下半分は対角線で折り返して外側の三角形に置く
+		if (Normal.z < 0.0f)
+		{
+			const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		OutValue[0] = static_cast<int16_t>(std::round(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+		OutValue[1] = static_cast<int16_t>(std::round(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	/// <summary>
+	/// EncodeOctahedral の逆（Shader/MeshletCommon.hlsli の DecodeOctahedral と同じ）
+	/// </summary>
+	XMFLOAT3 MeshOptimizer::DecodeOctahedral(const int16_t Value[2])
+	{
+		float x = std::max(Value[0] / 32767.0f, -1.0f);
+		float y = std::max(Value[1] / 32767.0f, -1.0f);
+		const float z = 1.0f - std::abs(x) - std::abs(y);
+		if (z < 0.0f)
+		{
+			const float unfoldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float unfoldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+		return normal;
+	}
+}
@@ -0,0 +1,326 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/MeshletBuilder.hpp>
+
+#include<cfloat>
+
+using namespace DirectX;
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// まだメッシュレットに入っていない頂点
+		/// </summary>
+		constexpr uint8_t NO_LOCAL_INDEX = 0xFF;
+
+		/// <summary>
+		/// 選べる三角形がない
+		/// </summary>
+		constexpr uint32_t INVALID_TRIANGLE = ~0u;
+
+		/// <summary>
+		/// 法線のコーンが開きすぎていて捨てられない時の ConeCutoff
+		/// </summary>
+		constexpr float NO_CONE_CUTOFF = 1.0f;
+
+		static_assert(MESHLET_MAX_VERTICES < NO_LOCAL_INDEX, "Local vertex indices must fit in 8 bits.");
+	}
+
+	/// <summary>
+	/// 分割する
+	/// </summary>
+	/// <param name="Positions">頂点の位置</param>
+	/// <param name="Indices">三角形リストのインデックス（3の倍数）</param>
+	/// <param name="OutMesh">結果</param>
+	/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+	/// <returns>true:成功</returns>
+	bool MeshletBuilder::Build(std::span<const XMFLOAT3> Positions, std::span<const uint32_t> Indices, MeshletMesh& OutMesh, MeshletBuildStats* pStats)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		OutMesh.Clear();
+		if (Indices.size() % 3 != 0)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "MeshletBuilder: index count must be a multiple of 3. {}", Indices.size());
+			return false;
+		}
+
+		const uint32_t vertexCount = static_cast<uint32_t>(Positions.size());
+		const uint32_t triangleCount = static_cast<uint32_t>(Indices.size() / 3);
+		for (const uint32_t index : Indices)
+		{
+			if (index >= vertexCount)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "MeshletBuilder: index out of range. {} >= {}", index, vertexCount);
+				return false;
+			}
+		}
+
+		//	頂点ごとに使っている三角形の一覧
+		std::vector<uint32_t> adjacencyOffsets(static_cast<size_t>(vertexCount) + 1, 0);
+		for (const uint32_t index : Indices)
+		{
+			adjacencyOffsets[index + 1]++;
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		std::vector<uint32_t> adjacency(Indices.size());
+		{
+			std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t t = 0; t < triangleCount; ++t)
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					adjacency[cursor[Indices[t * 3 + c]]++] = t;
+				}
+			}
+		}
+
+		std::vector<uint8_t> isEmitted(triangleCount, 0);
+		std::vector<uint8_t> localIndex(vertexCount, NO_LOCAL_INDEX);
+		//	今のメッシュレットの頂点に隣り合う三角形（重複や入れ済みのものも混ざる）
+		std::vector<uint32_t> candidates;
+		candidates.reserve(MESHLET_MAX_VERTICES * 8);
+
+		Meshlet current = {};
+		XMVECTOR positionSum = XMVectorZero();
+
+		OutMesh.Meshlets.reserve(triangleCount / MESHLET_MAX_TRIANGLES + 1);
+		OutMesh.Vertices.reserve(Indices.size() / 2);
+		OutMesh.Triangles.reserve(triangleCount);
+
+		//	三角形を足すと増える頂点の数
+		auto countNewVertices = [&](uint32_t Triangle)
+		{
+			const uint32_t a = Indices[Triangle * 3 + 0];
+			const uint32_t b = Indices[Triangle * 3 + 1];
+			const uint32_t c = Indices[Triangle * 3 + 2];
+			uint32_t count = localIndex[a] == NO_LOCAL_INDEX ? 1 : 0;
+			count += (localIndex[b] == NO_LOCAL_INDEX && b != a) ? 1 : 0;
+			count += (localIndex[c] == NO_LOCAL_INDEX && c != a && c != b) ? 1 : 0;
+			return count;
+		};
+
+		//	今のメッシュレットを確定して次を始める
+		auto flush = [&]()
+		{
+			if (current.TriangleCount == 0) return;
+
+			for (uint32_t i = 0; i < current.VertexCount; ++i)
+			{
+				localIndex[OutMesh.Vertices[current.VertexOffset + i]] = NO_LOCAL_INDEX;
+			}
+			OutMesh.Meshlets.push_back(current);
+
+			current = {};
+			current.VertexOffset = static_cast<uint32_t>(OutMesh.Vertices.size());
+			current.TriangleOffset = static_cast<uint32_t>(OutMesh.Triangles.size());
+			positionSum = XMVectorZero();
+			candidates.clear();
+		};
+
+		//	三角形を今のメッシュレットに足す
+		auto append = [&](uint32_t Triangle)
+		{
+			uint32_t local[3] = {};
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint32_t v = Indices[Triangle * 3 + c];
+				if (localIndex[v] == NO_LOCAL_INDEX)
+				{
+					localIndex[v] = static_cast<uint8_t>(current.VertexCount++);
+					OutMesh.Vertices.push_back(v);
+					positionSum = XMVectorAdd(positionSum, XMLoadFloat3(&Positions[v]));
+
+					for (uint32_t i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; ++i)
+					{
+						if (isEmitted[adjacency[i]] == 0)
+						{
+							candidates.push_back(adjacency[i]);
+						}
+					}
+				}
+				local[c] = localIndex[v];
+			}
+
+			OutMesh.Triangles.push_back(MeshletMesh::PackTriangle(local[0], local[1], local[2]));
+			current.TriangleCount++;
+			isEmitted[Triangle] = 1;
+		};
+
+		//	隣り合う三角形から、増える頂点が少なく今のメッシュレットの中心に近いものを選ぶ
+		auto pickCandidate = [&](uint32_t& OutFallback)
+		{
+			OutFallback = INVALID_TRIANGLE;
+			uint32_t best = INVALID_TRIANGLE;
+			uint32_t bestNew = 4;
+			float bestDistance = FLT_MAX;
+			const XMVECTOR centroid = XMVectorScale(positionSum, 1.0f / static_cast<float>(std::max(current.VertexCount, 1u)));
+
+			for (size_t i = 0; i < candidates.size();)
+			{
+				const uint32_t triangle = candidates[i];
+				if (isEmitted[triangle] != 0)
+				{
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				++i;
+
+				OutFallback = triangle;
+				const uint32_t newCount = countNewVertices(triangle);
+				if (current.VertexCount + newCount > MESHLET_MAX_VERTICES) continue;
+				if (newCount > bestNew) continue;
+
+				const XMVECTOR a = XMLoadFloat3(&Positions[Indices[triangle * 3 + 0]]);
+				const XMVECTOR b = XMLoadFloat3(&Positions[Indices[triangle * 3 + 1]]);
+				const XMVECTOR c = XMLoadFloat3(&Positions[Indices[triangle * 3 + 2]]);
+				const XMVECTOR center = XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), 1.0f / 3.0f);
+				const float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(center, centroid)));
+
+				if (newCount < bestNew || distance < bestDistance)
+				{
+					best = triangle;
+					bestNew = newCount;
+					bestDistance = distance;
+				}
+			}
+			return best;
+		};
+
+		uint32_t seedCursor = 0;
+		for (uint32_t emitted = 0; emitted < triangleCount; ++emitted)
+		{
+			uint32_t fallback = INVALID_TRIANGLE;
+			uint32_t triangle = pickCandidate(fallback);
+
+			if (triangle == INVALID_TRIANGLE)
+			{
+				if (fallback != INVALID_TRIANGLE)
+				{
+					//	隣はあるが入らない。隣から次のメッシュレットを始めるとまとまりが続く
+					flush();
+					triangle = fallback;
+				}
+				else
+				{
+					//	隣がない（つながっていない部分）。並び順で次の三角形から始める
+					while (isEmitted[seedCursor] != 0)
+					{
+						seedCursor++;
+					}
+					triangle = seedCursor;
+					if (current.VertexCount + countNewVertices(triangle) > MESHLET_MAX_VERTICES)
+					{
+						flush();
+					}
+				}
+			}
+
+			append(triangle);
+			if (current.TriangleCount == MESHLET_MAX_TRIANGLES)
+			{
+				flush();
+			}
+		}
+		flush();
+
+		const uint32_t meshletCount = static_cast<uint32_t>(OutMesh.Meshlets.size());
+		OutMesh.Bounds.resize(meshletCount);
+		uint32_t coneCount = 0;
+		for (uint32_t i = 0; i < meshletCount; ++i)
+		{
+			OutMesh.Bounds[i] = ComputeBounds(Positions, OutMesh, i);
+			coneCount += OutMesh.Bounds[i].ConeCutoff < NO_CONE_CUTOFF ? 1 : 0;
+		}
+
+		if (pStats != nullptr)
+		{
+			pStats->TriangleCount = triangleCount;
+			pStats->MeshletCount = meshletCount;
+			pStats->ConeCount = coneCount;
+			pStats->AverageVertices = meshletCount > 0 ? static_cast<float>(OutMesh.Vertices.size()) / meshletCount : 0.0f;
+			pStats->AverageTriangles = meshletCount > 0 ? static_cast<float>(triangleCount) / meshletCount : 0.0f;
+			pStats->ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// メッシュレット1つ分の形を求める
+	/// </summary>
+	/// <param name="Positions">頂点の位置</param>
+	/// <param name="Mesh">分割済みのメッシュ</param>
+	/// <param name="MeshletIndex">メッシュレットの添字</param>
+	MeshletBounds MeshletBuilder::ComputeBounds(std::span<const XMFLOAT3> Positions, const MeshletMesh& Mesh, uint32_t MeshletIndex)
+	{
+		const Meshlet& meshlet = Mesh.Meshlets[MeshletIndex];
+		const uint32_t* vertices = Mesh.Vertices.data() + meshlet.VertexOffset;
+		const uint32_t* triangles = Mesh.Triangles.data() + meshlet.TriangleOffset;
+
+		MeshletBounds bounds = {};
+
+		//	AABB の中心から一番遠い頂点までを半径にする
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			const XMVECTOR p = XMLoadFloat3(&Positions[vertices[i]]);
+			minimum = XMVectorMin(minimum, p);
+			maximum = XMVectorMax(maximum, p);
+		}
+		const XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+		float radiusSq = 0.0f;
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			const XMVECTOR p = XMLoadFloat3(&Positions[vertices[i]]);
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, center))));
+		}
+		XMStoreFloat3(&bounds.Center, center);
+		bounds.Radius = std::sqrt(radiusSq);
+
+		//	法線の平均を軸にし、軸から一番開いた法線でコーンの広さを決める
+		std::array<XMFLOAT3, MESHLET_MAX_TRIANGLES> normals = {};
+		uint32_t normalCount = 0;
+		XMVECTOR normalSum = XMVectorZero();
+		for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const XMVECTOR a = XMLoadFloat3(&Positions[vertices[MeshletMesh::UnpackTriangle(triangles[t], 0)]]);
+			const XMVECTOR b = XMLoadFloat3(&Positions[vertices[MeshletMesh::UnpackTriangle(triangles[t], 1)]]);
+			const XMVECTOR c = XMLoadFloat3(&Positions[vertices[MeshletMesh::UnpackTriangle(triangles[t], 2)]]);
+			const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+
+			//	面積のない三角形は描かれないので無視する
+			const float length = XMVectorGetX(XMVector3Length(normal));
+			if (length <= FLT_EPSILON) continue;
+
+			const XMVECTOR unit = XMVectorScale(normal, 1.0f / length);
+			XMStoreFloat3(&normals[normalCount++], unit);
+			normalSum = XMVectorAdd(normalSum, unit);
+		}
+
+		bounds.ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		bounds.ConeCutoff = NO_CONE_CUTOFF;
+
+		const float sumLength = XMVectorGetX(XMVector3Length(normalSum));
+		if (normalCount == 0 || sumLength <= FLT_EPSILON) return bounds;
+
+		const XMVECTOR axis = XMVectorScale(normalSum, 1.0f / sumLength);
+		float minDot = 1.0f;
+		for (uint32_t i = 0; i < normalCount; ++i)
+		{
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[i]), axis)));
+		}
+
+		//	半球以上に開いていると、どこから見ても表の三角形がある
+		if (minDot <= 0.0f) return bounds;
+
+		XMStoreFloat3(&bounds.ConeAxis, axis);
+		bounds.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+		return bounds;
+	}
+}
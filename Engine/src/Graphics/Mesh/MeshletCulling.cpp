@@ -0,0 +1,115 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/MeshletCulling.hpp>
+#include<Graphics/Culling/FrustumCulling.hpp>
+
+using namespace DirectX;
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// ワールド空間の視錐台とカメラをメッシュのローカル空間に移して定数を作る
+	/// </summary>
+	/// <param name="World">メッシュのワールド行列</param>
+	/// <param name="WorldFrustum">ワールド空間の視錐台</param>
+	/// <param name="CameraPosition">ワールド空間のカメラの位置</param>
+	/// <param name="MeshletCount">メッシュレットの数</param>
+	/// <param name="Flags">MESHLET_CULL_FLAG_ の組み合わせ</param>
+	MeshletCullConstants MeshletCulling::MakeConstants(const XMFLOAT4X4& World, const Frustum& WorldFrustum, const XMFLOAT3& CameraPosition, uint32_t MeshletCount, uint32_t Flags)
+	{
+		MeshletCullConstants constants = {};
+		constants.MeshletCount = MeshletCount;
+		constants.Flags = Flags;
+
+		//	行ベクトルなので p_world = p_local * World、平面は World * plane でローカル空間へ移る
+		const XMMATRIX world = XMLoadFloat4x4(&World);
+		const XMMATRIX worldT = XMMatrixTranspose(world);
+		for (uint32_t i = 0; i < Frustum::PLANE_COUNT; ++i)
+		{
+			const XMVECTOR plane = XMVector4Transform(XMLoadFloat4(&WorldFrustum.Planes[i]), worldT);
+			const float length = XMVectorGetX(XMVector3Length(plane));
+			XMStoreFloat4(&constants.Planes[i], length > 0.0f ? XMVectorScale(plane, 1.0f / length) : plane);
+		}
+
+		XMVECTOR determinant;
+		const XMMATRIX inverse = XMMatrixInverse(&determinant, world);
+		XMStoreFloat3(&constants.CameraPosition, XMVector3TransformCoord(XMLoadFloat3(&CameraPosition), inverse));
+
+		//	鏡映されていると表裏が入れ替わるのでコーンは使わない
+		if (XMVectorGetX(determinant) <= 0.0f)
+		{
+			constants.Flags &= ~MESHLET_CULL_FLAG_CONE;
+		}
+		return constants;
+	}
+
+	/// <summary>
+	/// 包む球が視錐台に掛かっているか
+	/// </summary>
+	bool MeshletCulling::IsInsideFrustum(const MeshletBounds& Bounds, const MeshletCullConstants& Constants)
+	{
+		for (const auto& plane : Constants.Planes)
+		{
+			const float distance = plane.x * Bounds.Center.x + plane.y * Bounds.Center.y + plane.z * Bounds.Center.z + plane.w;
+			if (distance < -Bounds.Radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 球のどこから見ても全ての三角形が裏を向いているか
+	/// </summary>
+	bool MeshletCulling::IsBackFacing(const MeshletBounds& Bounds, const MeshletCullConstants& Constants)
+	{
+		if (Bounds.ConeCutoff >= 1.0f) return false;
+
+		const float dx = Bounds.Center.x - Constants.CameraPosition.x;
+		const float dy = Bounds.Center.y - Constants.CameraPosition.y;
+		const float dz = Bounds.Center.z - Constants.CameraPosition.z;
+		const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		const float alignment = dx * Bounds.ConeAxis.x + dy * Bounds.ConeAxis.y + dz * Bounds.ConeAxis.z;
+
+		//	視線と軸の角度が 90°- θ より小さければ、コーン内のどの法線も視線と同じ向き
+		return alignment >= Bounds.ConeCutoff * distance + Bounds.Radius;
+	}
+
+	/// <summary>
+	/// 描く必要があるか
+	/// </summary>
+	bool MeshletCulling::IsVisible(const MeshletBounds& Bounds, const MeshletCullConstants& Constants)
+	{
+		if ((Constants.Flags & MESHLET_CULL_FLAG_FRUSTUM) != 0 && IsInsideFrustum(Bounds, Constants) == false)
+		{
+			return false;
+		}
+		if ((Constants.Flags & MESHLET_CULL_FLAG_CONE) != 0 && IsBackFacing(Bounds, Constants))
+		{
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 残ったメッシュレットの添字を集める
+	/// </summary>
+	/// <param name="Bounds">メッシュレットごとの形</param>
+	/// <param name="Constants">MakeConstants で作った定数</param>
+	/// <param name="OutVisible">残ったメッシュレットの添字（小さい順）</param>
+	/// <returns>残った数</returns>
+	uint32_t MeshletCulling::Cull(std::span<const MeshletBounds> Bounds, const MeshletCullConstants& Constants, std::vector<uint32_t>& OutVisible)
+	{
+		OutVisible.clear();
+
+		const uint32_t count = std::min(Constants.MeshletCount, static_cast<uint32_t>(Bounds.size()));
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (IsVisible(Bounds[i], Constants))
+			{
+				OutVisible.push_back(i);
+			}
+		}
+		return static_cast<uint32_t>(OutVisible.size());
+	}
+}
@@ -0,0 +1,240 @@
+﻿#include "pch.h"
+#include<Graphics/Mesh/ObjImporter.hpp>
+#include<Graphics/Mesh/MeshAssetCooker.hpp>
+
+#include<charconv>
+
+using namespace DirectX;
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 空白を飛ばす
+		/// </summary>
+		void SkipSpaces(std::string_view& Text)
+		{
+			while (Text.empty() == false && (Text.front() == ' ' || Text.front() == '\t'))
+			{
+				Text.remove_prefix(1);
+			}
+		}
+
+		/// <summary>
+		/// 空白で区切られた次の語を取り出す
+		/// </summary>
+		std::string_view NextToken(std::string_view& Text)
+		{
+			SkipSpaces(Text);
+			size_t length = 0;
+			while (length < Text.size() && Text[length] != ' ' && Text[length] != '\t')
+			{
+				++length;
+			}
+			const std::string_view token = Text.substr(0, length);
+			Text.remove_prefix(length);
+			return token;
+		}
+
+		/// <summary>
+		/// 次の語を数値として読む
+		/// </summary>
+		bool ParseFloat(std::string_view& Text, float& OutValue)
+		{
+			const std::string_view token = NextToken(Text);
+			const auto result = std::from_chars(token.data(), token.data() + token.size(), OutValue);
+			return result.ec == std::errc() && token.empty() == false;
+		}
+
+		/// <summary>
+		/// 1始まり（負なら末尾から）の添字を 0 始まりにする。無ければ -1
+		/// </summary>
+		bool ParseIndex(std::string_view Token, size_t Count, int64_t& OutIndex)
+		{
+			OutIndex = -1;
+			if (Token.empty()) return true;
+
+			int64_t value = 0;
+			const auto result = std::from_chars(Token.data(), Token.data() + Token.size(), value);
+			if (result.ec != std::errc() || value == 0) return false;
+
+			OutIndex = value > 0 ? value - 1 : static_cast<int64_t>(Count) + value;
+			return OutIndex >= 0 && OutIndex < static_cast<int64_t>(Count);
+		}
+
+		/// <summary>
+		/// 位置・UV・法線の組（まとめる時の鍵）
+		/// </summary>
+		struct ObjCorner
+		{
+			int64_t Position;
+			int64_t TexCoord;
+			int64_t Normal;
+
+			bool operator==(const ObjCorner&) const = default;
+		};
+
+		struct ObjCornerHash
+		{
+			size_t operator()(const ObjCorner& Corner) const
+			{
+				const uint64_t hash = static_cast<uint64_t>(Corner.Position) * 0x9E3779B97F4A7C15ull
+					^ static_cast<uint64_t>(Corner.TexCoord) * 0xC2B2AE3D27D4EB4Full
+					^ static_cast<uint64_t>(Corner.Normal) * 0x165667B19E3779F9ull;
+				return static_cast<size_t>(hash ^ (hash >> 32));
+			}
+		};
+	}
+
+	/// <summary>
+	/// ファイルから読む
+	/// </summary>
+	/// <param name="Path">ファイルの場所</param>
+	/// <param name="OutData">結果（メッシュレットは空のまま）</param>
+	/// <returns>true:成功</returns>
+	bool ObjImporter::Load(const std::filesystem::path& Path, MeshAssetData& OutData)
+	{
+		std::ifstream file(Path, std::ios::binary);
+		if (file.is_open() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "ObjImporter: failed to open. ({})", Path.string());
+			return false;
+		}
+
+		const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (Parse(text, OutData) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "ObjImporter: failed to parse. ({})", Path.string());
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 文字列から読む
+	/// </summary>
+	/// <param name="Text">OBJ の中身</param>
+	/// <param name="OutData">結果（メッシュレットは空のまま）</param>
+	/// <returns>true:成功</returns>
+	bool ObjImporter::Parse(std::string_view Text, MeshAssetData& OutData)
+	{
+		OutData = {};
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> texCoords;
+		std::vector<XMFLOAT3> normals;
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> cornerToVertex;
+		std::vector<ObjCorner> corners;
+		std::vector<uint32_t> face;
+		bool hasTexCoord = false;
+		bool hasNormal = false;
+
+		size_t lineNumber = 0;
+		while (Text.empty() == false)
+		{
+			const size_t lineEnd = Text.find('\n');
+			std::string_view line = Text.substr(0, lineEnd);
+			Text.remove_prefix(lineEnd == std::string_view::npos ? Text.size() : lineEnd + 1);
+			++lineNumber;
+
+			if (line.empty() == false && line.back() == '\r') line.remove_suffix(1);
+			const std::string_view command = NextToken(line);
+
+			if (command == "v")
+			{
+				XMFLOAT3 p = {};
+				if (ParseFloat(line, p.x) == false || ParseFloat(line, p.y) == false || ParseFloat(line, p.z) == false)
+				{
+					ECSE_LOG(System::ELogLevel::Error, "ObjImporter: broken vertex. line={}", lineNumber);
+					return false;
+				}
+				positions.push_back({ p.x, p.y, -p.z });
+			}
+			else if (command == "vt")
+			{
+				XMFLOAT2 uv = {};
+				if (ParseFloat(line, uv.x) == false || ParseFloat(line, uv.y) == false)
+				{
+					ECSE_LOG(System::ELogLevel::Error, "ObjImporter: broken texcoord. line={}", lineNumber);
+					return false;
+				}
+				texCoords.push_back({ uv.x, 1.0f - uv.y });
+			}
+			else if (command == "vn")
+			{
+				XMFLOAT3 n = {};
+				if (ParseFloat(line, n.x) == false || ParseFloat(line, n.y) == false || ParseFloat(line, n.z) == false)
+				{
+					ECSE_LOG(System::ELogLevel::Error, "ObjImporter: broken normal. line={}", lineNumber);
+					return false;
+				}
+				normals.push_back({ n.x, n.y, -n.z });
+			}
+			else if (command == "f")
+			{
+				face.clear();
+				for (std::string_view token = NextToken(line); token.empty() == false; token = NextToken(line))
+				{
+					//	v, v/vt, v//vn, v/vt/vn
+					const size_t slash0 = token.find('/');
+					const size_t slash1 = slash0 == std::string_view::npos ? std::string_view::npos : token.find('/', slash0 + 1);
+					const std::string_view positionToken = token.substr(0, slash0);
+					const std::string_view texCoordToken = slash0 == std::string_view::npos ? std::string_view() : token.substr(slash0 + 1, slash1 == std::string_view::npos ? std::string_view::npos : slash1 - slash0 - 1);
+					const std::string_view normalToken = slash1 == std::string_view::npos ? std::string_view() : token.substr(slash1 + 1);
+
+					ObjCorner corner = {};
+					if (positionToken.empty() ||
+						ParseIndex(positionToken, positions.size(), corner.Position) == false ||
+						ParseIndex(texCoordToken, texCoords.size(), corner.TexCoord) == false ||
+						ParseIndex(normalToken, normals.size(), corner.Normal) == false)
+					{
+						ECSE_LOG(System::ELogLevel::Error, "ObjImporter: broken face. line={}", lineNumber);
+						return false;
+					}
+					hasTexCoord |= corner.TexCoord >= 0;
+					hasNormal |= corner.Normal >= 0;
+
+					const auto [it, isInserted] = cornerToVertex.try_emplace(corner, static_cast<uint32_t>(corners.size()));
+					if (isInserted) corners.push_back(corner);
+					face.push_back(it->second);
+				}
+
+				//	扇状に分ける。Z を反転しても画面上の回り方は変わらないので、順を逆にして時計回りにする
+				for (size_t i = 2; i < face.size(); ++i)
+				{
+					OutData.Indices.push_back(face[0]);
+					OutData.Indices.push_back(face[i]);
+					OutData.Indices.push_back(face[i - 1]);
+				}
+			}
+			//	それ以外（コメント・マテリアル・グループなど）は読まない
+		}
+
+		OutData.Positions.reserve(corners.size());
+		for (const ObjCorner& corner : corners)
+		{
+			OutData.Positions.push_back(positions[static_cast<size_t>(corner.Position)]);
+		}
+
+		//	一部の頂点にしか無い UV・法線は 0 で埋め、法線が揃わなければ Cook で作り直す
+		if (hasTexCoord)
+		{
+			OutData.TexCoords.reserve(corners.size());
+			for (const ObjCorner& corner : corners)
+			{
+				OutData.TexCoords.push_back(corner.TexCoord >= 0 ? texCoords[static_cast<size_t>(corner.TexCoord)] : XMFLOAT2(0.0f, 0.0f));
+			}
+		}
+		if (hasNormal && std::all_of(corners.begin(), corners.end(), [](const ObjCorner& Corner) { return Corner.Normal >= 0; }))
+		{
+			OutData.Normals.reserve(corners.size());
+			for (const ObjCorner& corner : corners)
+			{
+				OutData.Normals.push_back(normals[static_cast<size_t>(corner.Normal)]);
+			}
+		}
+
+		return OutData.Positions.empty() == false && OutData.Indices.empty() == false;
+	}
+}
@@ -0,0 +1,206 @@
+﻿#include "pch.h"
+#include<Graphics/Render/DrawQueue.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 1桁のビット数
+		/// </summary>
+		constexpr uint32_t RADIX_BITS = 8;
+		constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+		constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+	}
+
+	DrawQueue::DrawQueue()
+		:mPackets()
+		, mScratch()
+		, mHistograms()
+		, mStats()
+	{
+	}
+
+	/// <summary>
+	/// 全ての削除（確保したメモリは残す）
+	/// </summary>
+	void DrawQueue::Clear()
+	{
+		mPackets.clear();
+	}
+
+	/// <summary>
+	/// 依頼の追加
+	/// </summary>
+	void DrawQueue::Push(const DrawPacket& Packet)
+	{
+		mPackets.push_back(Packet);
+	}
+
+	/// <summary>
+	/// 見えているプロキシの依頼をまとめて追加（並列）
+	/// </summary>
+	void DrawQueue::AddProxies(const RenderProxyBuffer& Proxies, std::span<const uint32_t> Visible, const DirectX::XMFLOAT4X4& View, float NearZ, float FarZ, uint32_t Pass, std::span<const uint32_t> Meshes)
+	{
+		const bool hasMeshes = Meshes.size() == Visible.size();
+
+		const size_t base = mPackets.size();
+		const uint32_t count = static_cast<uint32_t>(Visible.size());
+		mPackets.resize(base + count);
+
+		const float invRange = FarZ > NearZ ? 1.0f / (FarZ - NearZ) : 0.0f;
+		auto fill = [this, &Proxies, &Visible, &Meshes, &View, base, NearZ, invRange, Pass, hasMeshes](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					const uint32_t index = Visible[i];
+
+					//	ビュー空間の z だけを求める
+					const float viewZ = Proxies.CenterX[index] * View._13 + Proxies.CenterY[index] * View._23 + Proxies.CenterZ[index] * View._33 + View._43;
+					const bool translucent = (Proxies.Flags[index] & RenderProxyBuffer::FLAG_TRANSLUCENT) != 0;
+
+					DrawPacket& packet = mPackets[base + i];
+					packet.Key = DrawKey::Make(Pass, translucent, Proxies.Pipeline[index], Proxies.Material[index], (viewZ - NearZ) * invRange);
+					packet.Proxy = index;
+					packet.Mesh = hasMeshes ? Meshes[i] : Proxies.Mesh[index];
+				}
+			};
+
+		System::JobSystem::ParallelForOrInline(count, fill, CHUNK_SIZE);
+	}
+
+	/// <summary>
+	/// キーの昇順に並べ替えて、切り替え回数を数える
+	/// </summary>
+	void DrawQueue::Sort()
+	{
+		mStats = {};
+		const uint32_t count = static_cast<uint32_t>(mPackets.size());
+		mStats.PacketCount = count;
+		CountChanges(mStats.PsoChangesBefore, mStats.MaterialChangesBefore, mStats.MeshChangesBefore);
+		if (count < 2) return;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		//	全てのキーで同じ桁は並べ替える必要がない
+		uint64_t differ = 0;
+		const uint64_t firstKey = mPackets[0].Key;
+		for (const auto& packet : mPackets)
+		{
+			differ |= packet.Key ^ firstKey;
+		}
+
+		const uint32_t chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		mScratch.resize(count);
+		mHistograms.resize(static_cast<size_t>(chunkCount) * RADIX_SIZE);
+
+		DrawPacket* src = mPackets.data();
+		DrawPacket* dst = mScratch.data();
+		for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+		{
+			const uint32_t shift = pass * RADIX_BITS;
+			if (((differ >> shift) & (RADIX_SIZE - 1)) == 0) continue;
+
+			//	塊ごとのヒストグラム
+			System::JobSystem::ParallelForOrInline(chunkCount, [this, src, shift, count](uint32_t Begin, uint32_t End)
+				{
+					for (uint32_t chunk = Begin; chunk < End; ++chunk)
+					{
+						uint32_t* histogram = mHistograms.data() + static_cast<size_t>(chunk) * RADIX_SIZE;
+						std::fill(histogram, histogram + RADIX_SIZE, 0u);
+
+						const uint32_t last = std::min((chunk + 1) * CHUNK_SIZE, count);
+						for (uint32_t i = chunk * CHUNK_SIZE; i < last; ++i)
+						{
+							histogram[(src[i].Key >> shift) & (RADIX_SIZE - 1)]++;
+						}
+					}
+				});
+
+			//	桁の値 → 塊 の順に累積すると、塊ごとの書き込み開始位置になる（安定）
+			uint32_t offset = 0;
+			for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+			{
+				for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+				{
+					uint32_t& slot = mHistograms[static_cast<size_t>(chunk) * RADIX_SIZE + digit];
+					const uint32_t value = slot;
+					slot = offset;
+					offset += value;
+				}
+			}
+
+			//	書き込み先は塊ごとに重ならないので同期はいらない
+			System::JobSystem::ParallelForOrInline(chunkCount, [this, src, dst, shift, count](uint32_t Begin, uint32_t End)
+				{
+					for (uint32_t chunk = Begin; chunk < End; ++chunk)
+					{
+						uint32_t* cursor = mHistograms.data() + static_cast<size_t>(chunk) * RADIX_SIZE;
+
+						const uint32_t last = std::min((chunk + 1) * CHUNK_SIZE, count);
+						for (uint32_t i = chunk * CHUNK_SIZE; i < last; ++i)
+						{
+							dst[cursor[(src[i].Key >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+						}
+					}
+				});
+
+			std::swap(src, dst);
+			mStats.RadixPasses++;
+		}
+
+		//	奇数回だと結果は mScratch 側にある
+		if (src != mPackets.data())
+		{
+			mPackets.swap(mScratch);
+		}
+
+		mStats.SortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		CountChanges(mStats.PsoChanges, mStats.MaterialChanges, mStats.MeshChanges);
+	}
+
+	/// <summary>
+	/// 依頼の並び
+	/// </summary>
+	std::span<const DrawPacket> DrawQueue::GetPackets() const
+	{
+		return mPackets;
+	}
+
+	/// <summary>
+	/// 直近の Sort の結果
+	/// </summary>
+	const DrawQueueStats& DrawQueue::GetStats() const
+	{
+		return mStats;
+	}
+
+	/// <summary>
+	/// 並びの状態の切り替え回数
+	/// </summary>
+	void DrawQueue::CountChanges(uint32_t& OutPso, uint32_t& OutMaterial, uint32_t& OutMesh) const
+	{
+		OutPso = 0;
+		OutMaterial = 0;
+		OutMesh = 0;
+		if (mPackets.empty() == true) return;
+
+		//	最初の1回も切り替えとして数える
+		uint32_t pso = UINT32_MAX;
+		uint32_t material = UINT32_MAX;
+		uint32_t mesh = UINT32_MAX;
+		for (const auto& packet : mPackets)
+		{
+			const uint32_t nextPso = DrawKey::GetPso(packet.Key);
+			const uint32_t nextMaterial = DrawKey::GetMaterial(packet.Key);
+			if (nextPso != pso) OutPso++;
+			if (nextMaterial != material) OutMaterial++;
+			if (packet.Mesh != mesh) OutMesh++;
+			pso = nextPso;
+			material = nextMaterial;
+			mesh = packet.Mesh;
+		}
+	}
+}
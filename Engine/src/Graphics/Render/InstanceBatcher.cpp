@@ -0,0 +1,241 @@
+﻿#include "pch.h"
+#include<Graphics/Render/InstanceBatcher.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#if defined(_WIN32)
+#include<Graphics/DX12/UploadRingBuffer.hpp>
+#endif
+#include<System/Thread/JobSystem.hpp>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 不透明のキーから深度を除いた部分（パス・PSO・マテリアル）
+		/// </summary>
+		constexpr uint64_t OpaqueState(uint64_t Key)
+		{
+			return Key >> DrawKey::DEPTH_BITS;
+		}
+
+		/// <summary>
+		/// 半透明のキーから深度を除いた部分（パス・PSO・マテリアル）
+		/// </summary>
+		constexpr uint64_t TranslucentState(uint64_t Key)
+		{
+			constexpr uint64_t depthMask = DrawKey::DEPTH_MASK << (DrawKey::PSO_BITS + DrawKey::MATERIAL_BITS);
+			return Key & ~depthMask;
+		}
+	}
+
+	InstanceBatcher::InstanceBatcher()
+		:mpProxies(nullptr)
+		, mBatches()
+		, mInstanceProxies()
+		, mMeshBatch()
+		, mMeshStamp()
+		, mRunStamp(0)
+		, mStats()
+	{
+	}
+
+	/// <summary>
+	/// バッチの組み立て（インスタンスデータはまだ書かない）
+	/// </summary>
+	/// <param name="Packets">DrawQueue::Sort 済みの依頼</param>
+	/// <param name="Proxies">依頼の Proxy が指す描画対象</param>
+	void InstanceBatcher::Build(std::span<const DrawPacket> Packets, const RenderProxyBuffer& Proxies)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const uint32_t count = static_cast<uint32_t>(Packets.size());
+		mpProxies = &Proxies;
+		mBatches.clear();
+		mInstanceProxies.resize(count);
+
+		uint32_t i = 0;
+		while (i < count)
+		{
+			const uint64_t key = Packets[i].Key;
+			uint32_t end = i + 1;
+
+			if (DrawKey::IsTranslucent(key) == false)
+			{
+				//	状態が同じ並びは深度の順なので、メッシュが違っても入れ替えて良い
+				const uint64_t state = OpaqueState(key);
+				while (end < count && OpaqueState(Packets[end].Key) == state) ++end;
+				BuildOpaqueRun(Packets, i, end);
+			}
+			else
+			{
+				//	半透明は隣り合っている同じメッシュだけ
+				const uint64_t state = TranslucentState(key);
+				const uint32_t mesh = Packets[i].Mesh;
+				while (end < count && TranslucentState(Packets[end].Key) == state && Packets[end].Mesh == mesh) ++end;
+
+				const uint32_t first = mBatches.empty() ? 0 : mBatches.back().FirstInstance + mBatches.back().InstanceCount;
+				for (uint32_t k = i; k < end; ++k)
+				{
+					mInstanceProxies[first + (k - i)] = Packets[k].Proxy;
+				}
+				mBatches.push_back({ DrawKey::GetPass(key), DrawKey::GetPso(key), DrawKey::GetMaterial(key), mesh, first, end - i, 0 });
+			}
+			i = end;
+		}
+
+		mStats.PacketCount = count;
+		mStats.BatchCount = static_cast<uint32_t>(mBatches.size());
+		mStats.LargestBatch = 0;
+		for (const auto& batch : mBatches)
+		{
+			mStats.LargestBatch = std::max(mStats.LargestBatch, batch.InstanceCount);
+		}
+		mStats.UploadBytes = 0;
+		mStats.BuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// インスタンスデータの書き込み（並列）
+	/// </summary>
+	/// <param name="pDest">GetInstanceCount 個分の書き込み先</param>
+	void InstanceBatcher::WriteInstances(InstanceData* pDest) const
+	{
+		if (pDest == nullptr || mpProxies == nullptr) return;
+
+		const auto& world = mpProxies->World;
+		const uint32_t* indices = mInstanceProxies.data();
+
+		//	アップロードヒープは書き込み結合なので先頭から順に埋める
+		System::JobSystem::ParallelForOrInline(GetInstanceCount(), [&](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					pDest[i].World = world[indices[i]];
+				}
+			}, CHUNK_SIZE);
+	}
+
+#if defined(_WIN32)
+	/// <summary>
+	/// インスタンスデータをリングから切り出してアップロードし、バッチのアドレスを埋める
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool InstanceBatcher::Upload(UploadRingBuffer& Ring)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const uint32_t count = GetInstanceCount();
+		if (count == 0) return true;
+
+		const uint64_t size = static_cast<uint64_t>(count) * sizeof(InstanceData);
+		const UploadAllocation allocation = Ring.Allocate(size);
+		if (allocation.IsValid() == false) return false;
+
+		WriteInstances(static_cast<InstanceData*>(allocation.pCpu));
+
+		for (auto& batch : mBatches)
+		{
+			batch.InstanceAddress = allocation.Gpu + static_cast<uint64_t>(batch.FirstInstance) * sizeof(InstanceData);
+		}
+
+		mStats.UploadBytes = size;
+		mStats.UploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+
+	/// <summary>
+	/// バッチの記録
+	/// </summary>
+	/// <param name="CmdList">記録先</param>
+	/// <param name="InstanceRootParameter">インスタンスデータのルートSRVの番号</param>
+	/// <param name="DrawFunc">メッシュとマテリアルを設定して DrawIndexedInstanced を呼ぶ処理</param>
+	void InstanceBatcher::Record(ID3D12GraphicsCommandList* CmdList, UINT InstanceRootParameter, const std::function<void(ID3D12GraphicsCommandList*, const InstanceBatch&)>& DrawFunc)
+	{
+		if (CmdList == nullptr || DrawFunc == nullptr) return;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for (const auto& batch : mBatches)
+		{
+			CmdList->SetGraphicsRootShaderResourceView(InstanceRootParameter, batch.InstanceAddress);
+			DrawFunc(CmdList, batch);
+		}
+
+		mStats.RecordMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+#endif
+
+	/// <summary>
+	/// まとめたバッチ
+	/// </summary>
+	std::span<const InstanceBatch> InstanceBatcher::GetBatches() const
+	{
+		return mBatches;
+	}
+
+	/// <summary>
+	/// インスタンスの総数
+	/// </summary>
+	uint32_t InstanceBatcher::GetInstanceCount() const
+	{
+		return static_cast<uint32_t>(mInstanceProxies.size());
+	}
+
+	/// <summary>
+	/// 直近の結果
+	/// </summary>
+	const InstanceBatchStats& InstanceBatcher::GetStats() const
+	{
+		return mStats;
+	}
+
+	/// <summary>
+	/// 不透明で状態が同じ並びをメッシュごとにまとめる
+	/// </summary>
+	void InstanceBatcher::BuildOpaqueRun(std::span<const DrawPacket> Packets, uint32_t Begin, uint32_t End)
+	{
+		const uint64_t key = Packets[Begin].Key;
+		const uint32_t firstBatch = static_cast<uint32_t>(mBatches.size());
+		const uint32_t firstInstance = mBatches.empty() ? 0 : mBatches.back().FirstInstance + mBatches.back().InstanceCount;
+
+		//	1周したら印を全て消す
+		if (++mRunStamp == 0)
+		{
+			std::fill(mMeshStamp.begin(), mMeshStamp.end(), 0u);
+			mRunStamp = 1;
+		}
+
+		//	メッシュごとのバッチを最初に出てきた順に作り、数を数える
+		for (uint32_t i = Begin; i < End; ++i)
+		{
+			const uint32_t mesh = Packets[i].Mesh;
+			if (mesh >= mMeshStamp.size())
+			{
+				mMeshStamp.resize(static_cast<size_t>(mesh) + 1, 0);
+				mMeshBatch.resize(static_cast<size_t>(mesh) + 1, 0);
+			}
+			if (mMeshStamp[mesh] != mRunStamp)
+			{
+				mMeshStamp[mesh] = mRunStamp;
+				mMeshBatch[mesh] = static_cast<uint32_t>(mBatches.size());
+				mBatches.push_back({ DrawKey::GetPass(key), DrawKey::GetPso(key), DrawKey::GetMaterial(key), mesh, 0, 0, 0 });
+			}
+			mBatches[mMeshBatch[mesh]].InstanceCount++;
+		}
+
+		//	開始位置を決めて、数え直しながら詰める（バッチの中は手前からの順のまま）
+		uint32_t offset = firstInstance;
+		for (uint32_t b = firstBatch; b < mBatches.size(); ++b)
+		{
+			mBatches[b].FirstInstance = offset;
+			offset += mBatches[b].InstanceCount;
+			mBatches[b].InstanceCount = 0;
+		}
+		for (uint32_t i = Begin; i < End; ++i)
+		{
+			auto& batch = mBatches[mMeshBatch[Packets[i].Mesh]];
+			mInstanceProxies[batch.FirstInstance + batch.InstanceCount] = Packets[i].Proxy;
+			batch.InstanceCount++;
+		}
+	}
+}
@@ -0,0 +1,274 @@
+﻿#include "pch.h"
+#include<Graphics/Render/LodSelector.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<cfloat>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 目標を超えたフレームで倍率に掛ける値と、余裕のあるフレームで掛ける値
+		/// 上げる時は早く、戻す時はゆっくり
+		/// </summary>
+		constexpr float SCALE_UP = 1.05f;
+		constexpr float SCALE_DOWN = 0.98f;
+
+		/// <summary>
+		/// 目標のこの割合を下回ったら倍率を戻し始める
+		/// </summary>
+		constexpr double RECOVER_RATIO = 0.85;
+	}
+
+	LodSelector::LodSelector()
+		:mVisible()
+		, mMeshes()
+		, mSelected()
+		, mPreviousLevels()
+		, mPreviousOwners()
+		, mHysteresis(0.1f)
+		, mScale(1.0f)
+		, mMaxScale(4.0f)
+		, mTargetFrameMs(0.0)
+		, mStats()
+	{
+	}
+
+	/// <summary>
+	/// レベルを選ぶ（並列）
+	/// </summary>
+	/// <param name="Proxies">描画対象</param>
+	/// <param name="Visible">カリング済みの添字</param>
+	/// <param name="CameraPosition">ワールド空間のカメラの位置</param>
+	/// <param name="Projection">プロジェクション行列（_22 を使う）</param>
+	void LodSelector::Select(const RenderProxyBuffer& Proxies, std::span<const uint32_t> Visible, const DirectX::XMFLOAT3& CameraPosition, const DirectX::XMFLOAT4X4& Projection)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const uint32_t count = static_cast<uint32_t>(Visible.size());
+		mSelected.resize(count);
+
+		//	並列に書き込むので先に広げておく
+		if (mPreviousLevels.size() < Proxies.Lookup.size())
+		{
+			mPreviousLevels.resize(Proxies.Lookup.size(), UNKNOWN_LEVEL);
+			mPreviousOwners.resize(Proxies.Lookup.size(), entt::null);
+		}
+
+		const float projectionScale = Projection._22;
+		const float scale = mScale;
+		const float hysteresis = mHysteresis;
+		std::atomic<uint32_t> changed = 0;
+
+		auto select = [this, &Proxies, &Visible, &CameraPosition, &changed, projectionScale, scale, hysteresis](uint32_t Begin, uint32_t End)
+			{
+				uint32_t localChanged = 0;
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					const uint32_t index = Visible[i];
+					const ECS::LodComponent& lod = Proxies.Lods[index];
+					if (lod.LevelCount == 0)
+					{
+						mSelected[i] = 0;
+						continue;
+					}
+
+					const float dx = Proxies.CenterX[index] - CameraPosition.x;
+					const float dy = Proxies.CenterY[index] - CameraPosition.y;
+					const float dz = Proxies.CenterZ[index] - CameraPosition.z;
+					const float screenSize = ComputeScreenSize(Proxies.Radius[index], std::sqrt(dx * dx + dy * dy + dz * dz), projectionScale);
+
+					//	番号が同じでも世代が違えば別のエンティティ
+					const entt::entity entity = Proxies.Entities[index];
+					const auto key = static_cast<size_t>(entt::to_entity(entity));
+					const uint8_t previous = mPreviousOwners[key] == entity ? mPreviousLevels[key] : UNKNOWN_LEVEL;
+
+					const uint8_t level = SelectLevel(lod, screenSize, previous, scale, hysteresis);
+					localChanged += (previous != UNKNOWN_LEVEL && previous != level) ? 1 : 0;
+
+					mSelected[i] = level;
+					mPreviousLevels[key] = level;
+					mPreviousOwners[key] = entity;
+				}
+				changed.fetch_add(localChanged, std::memory_order_relaxed);
+			};
+
+		System::JobSystem::ParallelForOrInline(count, select, CHUNK_SIZE);
+
+		//	描くものだけを順に詰める
+		mStats = {};
+		mVisible.clear();
+		mMeshes.clear();
+		mVisible.reserve(count);
+		mMeshes.reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint8_t level = mSelected[i];
+			if (level == CULLED_LEVEL)
+			{
+				mStats.Culled++;
+				continue;
+			}
+
+			const uint32_t index = Visible[i];
+			const ECS::LodComponent& lod = Proxies.Lods[index];
+			mVisible.push_back(index);
+			mMeshes.push_back(lod.LevelCount > 0 ? lod.Meshes[level] : Proxies.Mesh[index]);
+			mStats.PerLevel[level]++;
+		}
+
+		mStats.Tested = count;
+		mStats.Changed = changed.load(std::memory_order_relaxed);
+		mStats.Scale = mScale;
+		mStats.ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// 描くものだけの添字（Visible の順を保つ）
+	/// </summary>
+	std::span<const uint32_t> LodSelector::GetVisible() const
+	{
+		return mVisible;
+	}
+
+	/// <summary>
+	/// GetVisible と同じ並びの描くメッシュのID
+	/// </summary>
+	std::span<const uint32_t> LodSelector::GetMeshes() const
+	{
+		return mMeshes;
+	}
+
+	/// <summary>
+	/// 境目の幅（0 以上 1 未満）
+	/// </summary>
+	void LodSelector::SetHysteresis(float Hysteresis)
+	{
+		mHysteresis = std::clamp(Hysteresis, 0.0f, 0.99f);
+	}
+
+	/// <summary>
+	/// 境目の幅
+	/// </summary>
+	float LodSelector::GetHysteresis() const
+	{
+		return mHysteresis;
+	}
+
+	/// <summary>
+	/// 目標のフレーム時間（ミリ秒、0 なら倍率を変えない）
+	/// </summary>
+	void LodSelector::SetTargetFrameTime(double TargetMs)
+	{
+		mTargetFrameMs = std::max(TargetMs, 0.0);
+		if (mTargetFrameMs <= 0.0)
+		{
+			mScale = 1.0f;
+		}
+	}
+
+	/// <summary>
+	/// 倍率の上限
+	/// </summary>
+	void LodSelector::SetMaxScale(float MaxScale)
+	{
+		mMaxScale = std::max(MaxScale, 1.0f);
+		mScale = std::min(mScale, mMaxScale);
+	}
+
+	/// <summary>
+	/// 直近のフレーム時間で倍率を更新する（フレームに1回）
+	/// 持ち主の描画の処理が Select の前に Engine::GetFrameStats().FrameMs を渡す。
+	/// </summary>
+	/// <param name="FrameMs">直近のフレーム時間（ミリ秒）</param>
+	void LodSelector::UpdateBudget(double FrameMs)
+	{
+		if (mTargetFrameMs <= 0.0) return;
+
+		if (FrameMs > mTargetFrameMs)
+		{
+			mScale = std::min(mScale * SCALE_UP, mMaxScale);
+		}
+		else if (FrameMs < mTargetFrameMs * RECOVER_RATIO)
+		{
+			mScale = std::max(mScale * SCALE_DOWN, 1.0f);
+		}
+	}
+
+	/// <summary>
+	/// 今の閾値の倍率
+	/// </summary>
+	float LodSelector::GetScale() const
+	{
+		return mScale;
+	}
+
+	/// <summary>
+	/// 前回のレベルを全て忘れる（シーンの切り替えなど）
+	/// </summary>
+	void LodSelector::Reset()
+	{
+		mPreviousLevels.clear();
+		mPreviousOwners.clear();
+		mScale = 1.0f;
+	}
+
+	/// <summary>
+	/// 直近の Select の結果
+	/// </summary>
+	const LodStats& LodSelector::GetStats() const
+	{
+		return mStats;
+	}
+
+	/// <summary>
+	/// 画面上の大きさ（包む球の直径 / 画面の高さ）
+	/// </summary>
+	/// <param name="Radius">包む球の半径</param>
+	/// <param name="Distance">カメラからの距離</param>
+	/// <param name="ProjectionScale">プロジェクション行列の _22（1 / tan(縦の画角 / 2)）</param>
+	float LodSelector::ComputeScreenSize(float Radius, float Distance, float ProjectionScale)
+	{
+		//	球の中にカメラがある
+		if (Distance <= Radius) return FLT_MAX;
+
+		//	投影した半径 r * cot / d は NDC（高さ 2）での値なので、そのまま直径 / 高さになる
+		return Radius * ProjectionScale / Distance;
+	}
+
+	/// <summary>
+	/// ヒステリシス付きでレベルを選ぶ
+	/// </summary>
+	/// <param name="Lod">詳細度</param>
+	/// <param name="ScreenSize">画面上の大きさ</param>
+	/// <param name="Previous">前回のレベル（初めてなら UNKNOWN_LEVEL）</param>
+	/// <param name="Scale">閾値に掛ける倍率</param>
+	/// <param name="Hysteresis">境目の幅</param>
+	/// <returns>レベル（描かないなら CULLED_LEVEL）</returns>
+	uint8_t LodSelector::SelectLevel(const ECS::LodComponent& Lod, float ScreenSize, uint8_t Previous, float Scale, float Hysteresis)
+	{
+		const uint32_t levelCount = std::min<uint32_t>(Lod.LevelCount, ECS::LodComponent::MAX_LEVELS);
+		if (levelCount == 0) return 0;
+
+		//	細かい方から境目を越えていく。境目 i はレベル i と i + 1（最後は描かない）の間
+		uint32_t level = 0;
+		for (uint32_t i = 0; i < levelCount; ++i)
+		{
+			const float threshold = Lod.ScreenSizes[i] * Scale;
+
+			//	前回が境目より細かい側なら下に、粗い側（描かないも含む）なら上にずらす
+			float band = threshold;
+			if (Previous != UNKNOWN_LEVEL)
+			{
+				band = Previous <= i ? threshold * (1.0f - Hysteresis) : threshold * (1.0f + Hysteresis);
+			}
+
+			if (ScreenSize >= band) break;
+			level = i + 1;
+		}
+
+		return level >= levelCount ? CULLED_LEVEL : static_cast<uint8_t>(level);
+	}
+}
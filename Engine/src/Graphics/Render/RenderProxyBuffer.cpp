@@ -0,0 +1,170 @@
+﻿#include "pch.h"
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<ECS/Component/TransformComponent.hpp>
+#include<ECS/Component/MeshRendererComponent.hpp>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// エンティティに対応する添字（INVALID_INDEX:なし）
+	/// </summary>
+	uint32_t RenderProxyBuffer::Find(entt::entity Entity) const
+	{
+		const auto key = static_cast<size_t>(entt::to_entity(Entity));
+		if (key >= Lookup.size()) return INVALID_INDEX;
+
+		const uint32_t index = Lookup[key];
+		if (index == INVALID_INDEX || Entities[index] != Entity) return INVALID_INDEX;
+
+		return index;
+	}
+
+	/// <summary>
+	/// 追加または上書き
+	/// </summary>
+	/// <param name="pLod">詳細度（なければ nullptr）</param>
+	/// <returns>書き込んだ添字</returns>
+	uint32_t RenderProxyBuffer::Upsert(entt::entity Entity, const ECS::TransformComponent& Transform, const ECS::MeshRendererComponent& Renderer, uint8_t Flag, const ECS::LodComponent* pLod)
+	{
+		using namespace DirectX;
+
+		const auto key = static_cast<size_t>(entt::to_entity(Entity));
+		if (key >= Lookup.size())
+		{
+			Lookup.resize(key + 1, INVALID_INDEX);
+		}
+
+		//	同じ番号の古い世代が残っていたら上書きする
+		uint32_t index = Lookup[key];
+		if (index == INVALID_INDEX)
+		{
+			index = GetCount();
+			Lookup[key] = index;
+			Entities.push_back(Entity);
+			World.emplace_back();
+			Mesh.push_back(0);
+			Material.push_back(0);
+			Pipeline.push_back(0);
+			CenterX.push_back(0.0f);
+			CenterY.push_back(0.0f);
+			CenterZ.push_back(0.0f);
+			ExtentX.push_back(0.0f);
+			ExtentY.push_back(0.0f);
+			ExtentZ.push_back(0.0f);
+			Radius.push_back(0.0f);
+			LocalCenter.emplace_back();
+			LocalExtents.emplace_back();
+			Flags.push_back(0);
+			Lods.emplace_back();
+		}
+		Entities[index] = Entity;
+
+		//	ワールド行列 S * R * T
+		const XMMATRIX world =
+			XMMatrixScalingFromVector(XMLoadFloat3(&Transform.Scale)) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&Transform.Rotation)) *
+			XMMatrixTranslationFromVector(XMLoadFloat3(&Transform.Position));
+		XMStoreFloat4x4(&World[index], world);
+
+		Mesh[index] = Renderer.Mesh;
+		Material[index] = Renderer.Material;
+		Pipeline[index] = Renderer.Pipeline;
+
+		//	ローカルAABBをワールドへ（中心は変換、大きさは行列の絶対値で広げる）
+		XMFLOAT3 center;
+		XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&Renderer.BoundsCenter), world));
+
+		const XMFLOAT4X4& m = World[index];
+		const XMFLOAT3& e = Renderer.BoundsExtents;
+		const float ex = std::fabs(m._11) * e.x + std::fabs(m._21) * e.y + std::fabs(m._31) * e.z;
+		const float ey = std::fabs(m._12) * e.x + std::fabs(m._22) * e.y + std::fabs(m._32) * e.z;
+		const float ez = std::fabs(m._13) * e.x + std::fabs(m._23) * e.y + std::fabs(m._33) * e.z;
+
+		CenterX[index] = center.x;
+		CenterY[index] = center.y;
+		CenterZ[index] = center.z;
+		ExtentX[index] = ex;
+		ExtentY[index] = ey;
+		ExtentZ[index] = ez;
+		Radius[index] = std::sqrt(ex * ex + ey * ey + ez * ez);
+		LocalCenter[index] = Renderer.BoundsCenter;
+		LocalExtents[index] = Renderer.BoundsExtents;
+		Flags[index] = static_cast<uint8_t>(Flag | (Renderer.IsTranslucent ? FLAG_TRANSLUCENT : 0));
+		Lods[index] = pLod != nullptr ? *pLod : ECS::LodComponent();
+
+		return index;
+	}
+
+	/// <summary>
+	/// 削除（末尾と入れ替えるので添字は詰まる）
+	/// </summary>
+	void RenderProxyBuffer::Remove(entt::entity Entity)
+	{
+		const uint32_t index = Find(Entity);
+		if (index == INVALID_INDEX) return;
+
+		const uint32_t last = GetCount() - 1;
+		if (index != last)
+		{
+			Entities[index] = Entities[last];
+			World[index] = World[last];
+			Mesh[index] = Mesh[last];
+			Material[index] = Material[last];
+			Pipeline[index] = Pipeline[last];
+			CenterX[index] = CenterX[last];
+			CenterY[index] = CenterY[last];
+			CenterZ[index] = CenterZ[last];
+			ExtentX[index] = ExtentX[last];
+			ExtentY[index] = ExtentY[last];
+			ExtentZ[index] = ExtentZ[last];
+			Radius[index] = Radius[last];
+			LocalCenter[index] = LocalCenter[last];
+			LocalExtents[index] = LocalExtents[last];
+			Flags[index] = Flags[last];
+			Lods[index] = Lods[last];
+			Lookup[static_cast<size_t>(entt::to_entity(Entities[index]))] = index;
+		}
+
+		Lookup[static_cast<size_t>(entt::to_entity(Entity))] = INVALID_INDEX;
+		Entities.pop_back();
+		World.pop_back();
+		Mesh.pop_back();
+		Material.pop_back();
+		Pipeline.pop_back();
+		CenterX.pop_back();
+		CenterY.pop_back();
+		CenterZ.pop_back();
+		ExtentX.pop_back();
+		ExtentY.pop_back();
+		ExtentZ.pop_back();
+		Radius.pop_back();
+		LocalCenter.pop_back();
+		LocalExtents.pop_back();
+		Flags.pop_back();
+		Lods.pop_back();
+	}
+
+	/// <summary>
+	/// 全ての削除
+	/// </summary>
+	void RenderProxyBuffer::Clear()
+	{
+		Entities.clear();
+		World.clear();
+		Mesh.clear();
+		Material.clear();
+		Pipeline.clear();
+		CenterX.clear();
+		CenterY.clear();
+		CenterZ.clear();
+		ExtentX.clear();
+		ExtentY.clear();
+		ExtentZ.clear();
+		Radius.clear();
+		LocalCenter.clear();
+		LocalExtents.clear();
+		Flags.clear();
+		Lods.clear();
+		Lookup.clear();
+	}
+}
@@ -0,0 +1,179 @@
+﻿#include "pch.h"
+#include<Graphics/Render/RenderWorld.hpp>
+#include<ECS/Tag/SceneTags.hpp>
+#include<ECS/Component/TransformComponent.hpp>
+#include<ECS/Component/MeshRendererComponent.hpp>
+#include<ECS/Component/LodComponent.hpp>
+
+namespace Ecse::Graphics
+{
+	static_assert(System::FRAME_SNAPSHOT_COUNT <= 8, "mPendingMask is 8 bits.");
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void RenderWorld::OnCreate()
+	{
+		mpRegistry = nullptr;
+		mLastUpdatedCount = 0;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void RenderWorld::OnDestroy()
+	{
+		Disconnect();
+		for (auto& buffer : mBuffers)
+		{
+			buffer.Clear();
+		}
+	}
+
+	/// <summary>
+	/// 初期化。変更検知のシグナルを繋ぐ
+	/// </summary>
+	/// <param name="Registry">監視するレジストリ</param>
+	/// <returns>true:成功</returns>
+	bool RenderWorld::Initialize(entt::registry& Registry)
+	{
+		using namespace ECS;
+
+		Disconnect();
+		mpRegistry = &Registry;
+
+		//	描画対象の条件になる3つと詳細度のどれかが 追加・更新・削除 されたら記録
+		Registry.on_construct<RenderableTag>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_destroy<RenderableTag>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_construct<OccluderTag>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_destroy<OccluderTag>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_construct<TransformComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_update<TransformComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_destroy<TransformComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_construct<MeshRendererComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_update<MeshRendererComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_destroy<MeshRendererComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_construct<LodComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_update<LodComponent>().connect<&RenderWorld::OnChanged>(*this);
+		Registry.on_destroy<LodComponent>().connect<&RenderWorld::OnChanged>(*this);
+
+		//	既に存在している描画対象も拾う
+		auto view = Registry.view<RenderableTag, TransformComponent, MeshRendererComponent>();
+		for (auto entity : view)
+		{
+			OnChanged(Registry, entity);
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 変更のあったエンティティをプロキシバッファへ反映（ゲームスレッド）
+	/// </summary>
+	/// <param name="Slot">書き込むスナップショット番号</param>
+	void RenderWorld::Extract(uint32_t Slot)
+	{
+		using namespace ECS;
+
+		mLastUpdatedCount = 0;
+		if (mpRegistry == nullptr) return;
+
+		RenderProxyBuffer& buffer = mBuffers[Slot];
+		auto& pending = mPending[Slot];
+		const uint8_t bit = static_cast<uint8_t>(1u << Slot);
+
+		for (auto entity : pending)
+		{
+			mPendingMask[static_cast<size_t>(entt::to_entity(entity))] &= static_cast<uint8_t>(~bit);
+
+			//	削除済みならプロキシから外し、同じ番号を使い回した今のエンティティを代わりに反映する
+			//	（同じフレームで作り直されると、新しい方の OnChanged は印が付いているので積まれない）
+			if (mpRegistry->valid(entity) == false)
+			{
+				buffer.Remove(entity);
+				entity = entt::entt_traits<entt::entity>::construct(entt::to_entity(entity), mpRegistry->current(entity));
+				if (mpRegistry->valid(entity) == false) continue;
+			}
+
+			//	条件が崩れたものはプロキシから外す
+			if (mpRegistry->all_of<RenderableTag, TransformComponent, MeshRendererComponent>(entity) == false)
+			{
+				buffer.Remove(entity);
+				continue;
+			}
+
+			const uint8_t flag = mpRegistry->all_of<OccluderTag>(entity) ? RenderProxyBuffer::FLAG_OCCLUDER : 0;
+			buffer.Upsert(entity, mpRegistry->get<TransformComponent>(entity), mpRegistry->get<MeshRendererComponent>(entity), flag, mpRegistry->try_get<LodComponent>(entity));
+			mLastUpdatedCount++;
+		}
+		pending.clear();
+	}
+
+	/// <summary>
+	/// 抜き出し済みのプロキシバッファ（描画スレッド）
+	/// </summary>
+	/// <param name="Slot">読み込むスナップショット番号</param>
+	const RenderProxyBuffer& RenderWorld::GetProxies(uint32_t Slot) const
+	{
+		return mBuffers[Slot];
+	}
+
+	/// <summary>
+	/// 直近の Extract で更新したエンティティ数
+	/// </summary>
+	uint32_t RenderWorld::GetLastUpdatedCount() const
+	{
+		return mLastUpdatedCount;
+	}
+
+	/// <summary>
+	/// 描画に関わるコンポーネントが変わった時に呼ばれる（SystemScheduler で同時に動くシステムから呼ばれることがある）
+	/// </summary>
+	void RenderWorld::OnChanged(entt::registry& Registry, entt::entity Entity)
+	{
+		(void)Registry;
+
+		//	別々のコンポーネントを書き換えるシステムが同時に呼ぶことがある
+		std::lock_guard<std::mutex> lock(mPendingMutex);
+
+		const auto key = static_cast<size_t>(entt::to_entity(Entity));
+		if (key >= mPendingMask.size())
+		{
+			mPendingMask.resize(key + 1, 0);
+		}
+
+		//	まだ未反映になっていないスナップショットにだけ積む
+		for (uint32_t slot = 0; slot < System::FRAME_SNAPSHOT_COUNT; ++slot)
+		{
+			const uint8_t bit = static_cast<uint8_t>(1u << slot);
+			if (mPendingMask[key] & bit) continue;
+
+			mPendingMask[key] |= bit;
+			mPending[slot].push_back(Entity);
+		}
+	}
+
+	/// <summary>
+	/// 監視の解除
+	/// </summary>
+	void RenderWorld::Disconnect()
+	{
+		if (mpRegistry == nullptr) return;
+
+		using namespace ECS;
+		mpRegistry->on_construct<RenderableTag>().disconnect(this);
+		mpRegistry->on_destroy<RenderableTag>().disconnect(this);
+		mpRegistry->on_construct<OccluderTag>().disconnect(this);
+		mpRegistry->on_destroy<OccluderTag>().disconnect(this);
+		mpRegistry->on_construct<TransformComponent>().disconnect(this);
+		mpRegistry->on_update<TransformComponent>().disconnect(this);
+		mpRegistry->on_destroy<TransformComponent>().disconnect(this);
+		mpRegistry->on_construct<MeshRendererComponent>().disconnect(this);
+		mpRegistry->on_update<MeshRendererComponent>().disconnect(this);
+		mpRegistry->on_destroy<MeshRendererComponent>().disconnect(this);
+		mpRegistry->on_construct<LodComponent>().disconnect(this);
+		mpRegistry->on_update<LodComponent>().disconnect(this);
+		mpRegistry->on_destroy<LodComponent>().disconnect(this);
+		mpRegistry = nullptr;
+	}
+}
@@ -0,0 +1,50 @@
+﻿#include "pch.h"
+#include<Graphics/Shader/ShaderCompiler.hpp>
+
+namespace Ecse::Graphics
+{
+	/// <summary>
+	/// ファイルからコンパイル（失敗したらエラー内容をログに出して nullptr）
+	/// </summary>
+	/// <param name="Path">HLSL ファイル</param>
+	/// <param name="EntryPoint">関数名</param>
+	/// <param name="Target">"cs_5_1" など</param>
+	/// <param name="pDefines">末尾が { nullptr, nullptr } のマクロ定義（なければ nullptr）</param>
+	Blob ShaderCompiler::CompileFromFile(const std::filesystem::path& Path, const char* EntryPoint, const char* Target, const D3D_SHADER_MACRO* pDefines)
+	{
+#if defined(_DEBUG)
+		const UINT flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_ENABLE_STRICTNESS;
+#else
+		const UINT flags = D3DCOMPILE_OPTIMIZATION_LEVEL3 | D3DCOMPILE_ENABLE_STRICTNESS;
+#endif
+
+		Blob shader = nullptr;
+		Blob error = nullptr;
+		const HRESULT hr = D3DCompileFromFile(
+			Path.c_str(),
+			pDefines,
+			D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			EntryPoint,
+			Target,
+			flags,
+			0,
+			&shader,
+			&error
+		);
+
+		if (FAILED(hr))
+		{
+			if (error != nullptr)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "Failed CompileShader. {} {}", Path.string(), static_cast<const char*>(error->GetBufferPointer()));
+			}
+			else
+			{
+				ECSE_LOG(System::ELogLevel::Error, "Failed CompileShader. {} (hr:{:#x})", Path.string(), static_cast<uint32_t>(hr));
+			}
+			return nullptr;
+		}
+
+		return shader;
+	}
+}
@@ -0,0 +1,555 @@
+﻿#include "pch.h"
+#include<Graphics/Texture/BlockCompressor.hpp>
+
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<cstring>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// ブロックのピクセル数
+		/// </summary>
+		constexpr uint32_t BLOCK_PIXELS = 16;
+
+		/// <summary>
+		/// BC7 の 4bit の番号の重み（/64）
+		/// </summary>
+		constexpr int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		/// <summary>
+		/// 主成分の向きに並べた時の両端を求める（N はチャンネル数）
+		/// </summary>
+		template<int N>
+		void ComputeEndpoints(const float (&Pixels)[BLOCK_PIXELS][N], float (&OutMin)[N], float (&OutMax)[N])
+		{
+			float mean[N] = {};
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				for (int c = 0; c < N; ++c) mean[c] += Pixels[i][c];
+			}
+			for (int c = 0; c < N; ++c) mean[c] /= BLOCK_PIXELS;
+
+			float covariance[N][N] = {};
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				for (int a = 0; a < N; ++a)
+				{
+					const float da = Pixels[i][a] - mean[a];
+					for (int b = 0; b < N; ++b) covariance[a][b] += da * (Pixels[i][b] - mean[b]);
+				}
+			}
+
+			//	べき乗法で一番広がっている向きを求める
+			float axis[N];
+			for (int c = 0; c < N; ++c) axis[c] = 1.0f;
+			for (int iteration = 0; iteration < 8; ++iteration)
+			{
+				float next[N] = {};
+				float length = 0.0f;
+				for (int a = 0; a < N; ++a)
+				{
+					for (int b = 0; b < N; ++b) next[a] += covariance[a][b] * axis[b];
+					length = std::max(length, std::abs(next[a]));
+				}
+				if (length <= 1e-8f) break;
+				for (int c = 0; c < N; ++c) axis[c] = next[c] / length;
+			}
+
+			float minT = FLT_MAX;
+			float maxT = -FLT_MAX;
+			float axisLength = 0.0f;
+			for (int c = 0; c < N; ++c) axisLength += axis[c] * axis[c];
+			if (axisLength <= 1e-8f) axisLength = 1.0f;
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < N; ++c) t += (Pixels[i][c] - mean[c]) * axis[c];
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			for (int c = 0; c < N; ++c)
+			{
+				OutMin[c] = std::clamp(mean[c] + axis[c] * minT / axisLength, 0.0f, 255.0f);
+				OutMax[c] = std::clamp(mean[c] + axis[c] * maxT / axisLength, 0.0f, 255.0f);
+			}
+		}
+
+		/// <summary>
+		/// 565 の色
+		/// </summary>
+		uint16_t Pack565(const float (&Color)[3])
+		{
+			const uint32_t r = static_cast<uint32_t>(std::lround(std::clamp(Color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+			const uint32_t g = static_cast<uint32_t>(std::lround(std::clamp(Color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+			const uint32_t b = static_cast<uint32_t>(std::lround(std::clamp(Color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		void Unpack565(uint16_t Packed, int (&OutColor)[3])
+		{
+			const int r = (Packed >> 11) & 31;
+			const int g = (Packed >> 5) & 63;
+			const int b = Packed & 31;
+			OutColor[0] = (r << 3) | (r >> 2);
+			OutColor[1] = (g << 2) | (g >> 4);
+			OutColor[2] = (b << 3) | (b >> 2);
+		}
+
+		/// <summary>
+		/// 端点から4色を作り、一番近い番号を選ぶ
+		/// </summary>
+		/// <returns>二乗誤差の合計</returns>
+		uint32_t SelectBC1Indices(const float (&Pixels)[BLOCK_PIXELS][3], uint16_t C0, uint16_t C1, uint8_t (&OutIndices)[BLOCK_PIXELS])
+		{
+			int palette[4][3];
+			Unpack565(C0, palette[0]);
+			Unpack565(C1, palette[1]);
+			for (int c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			uint32_t total = 0;
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				uint32_t best = UINT32_MAX;
+				for (uint8_t k = 0; k < 4; ++k)
+				{
+					uint32_t error = 0;
+					for (int c = 0; c < 3; ++c)
+					{
+						const int d = static_cast<int>(Pixels[i][c]) - palette[k][c];
+						error += static_cast<uint32_t>(d * d);
+					}
+					if (error < best)
+					{
+						best = error;
+						OutIndices[i] = k;
+					}
+				}
+				total += best;
+			}
+			return total;
+		}
+
+		/// <summary>
+		/// 番号を固定して端点を最小二乗で求め直す
+		/// Weights[k] は番号 k の時の1つ目の端点の割合。
+		/// </summary>
+		/// <returns>false:解けない（全て同じ番号など）</returns>
+		template<int N>
+		bool RefineEndpoints(const float (&Pixels)[BLOCK_PIXELS][N], const uint8_t (&Indices)[BLOCK_PIXELS], const float* Weights, float (&OutA)[N], float (&OutB)[N])
+		{
+			float aa = 0.0f;
+			float ab = 0.0f;
+			float bb = 0.0f;
+			float ax[N] = {};
+			float bx[N] = {};
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				const float alpha = Weights[Indices[i]];
+				const float beta = 1.0f - alpha;
+				aa += alpha * alpha;
+				ab += alpha * beta;
+				bb += beta * beta;
+				for (int c = 0; c < N; ++c)
+				{
+					ax[c] += alpha * Pixels[i][c];
+					bx[c] += beta * Pixels[i][c];
+				}
+			}
+
+			const float determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) < 1e-6f) return false;
+			const float inverse = 1.0f / determinant;
+			for (int c = 0; c < N; ++c)
+			{
+				OutA[c] = std::clamp((ax[c] * bb - bx[c] * ab) * inverse, 0.0f, 255.0f);
+				OutB[c] = std::clamp((bx[c] * aa - ax[c] * ab) * inverse, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// BC1 の色の部分（BC3 でも使う）
+		/// </summary>
+		void EncodeColorBlock(const uint8_t* Rgba, uint8_t* Out)
+		{
+			float pixels[BLOCK_PIXELS][3];
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				for (int c = 0; c < 3; ++c) pixels[i][c] = Rgba[i * 4 + c];
+			}
+
+			float minColor[3];
+			float maxColor[3];
+			ComputeEndpoints(pixels, minColor, maxColor);
+
+			uint16_t c0 = Pack565(maxColor);
+			uint16_t c1 = Pack565(minColor);
+			uint8_t indices[BLOCK_PIXELS];
+			uint32_t error = SelectBC1Indices(pixels, c0, c1, indices);
+
+			//	番号を固定して端点を詰め直す（良くなる間だけ）
+			constexpr float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+			for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+			{
+				float a[3];
+				float b[3];
+				if (RefineEndpoints(pixels, indices, WEIGHTS, a, b) == false) break;
+
+				const uint16_t n0 = Pack565(a);
+				const uint16_t n1 = Pack565(b);
+				uint8_t nextIndices[BLOCK_PIXELS];
+				const uint32_t nextError = SelectBC1Indices(pixels, n0, n1, nextIndices);
+				if (nextError >= error) break;
+
+				c0 = n0;
+				c1 = n1;
+				error = nextError;
+				std::memcpy(indices, nextIndices, sizeof(indices));
+			}
+
+			//	c0 > c1 で4色になる。逆なら入れ替え、同じなら全て 0 番
+			if (c0 < c1)
+			{
+				std::swap(c0, c1);
+				for (auto& index : indices) index ^= 1;
+			}
+			else if (c0 == c1)
+			{
+				std::memset(indices, 0, sizeof(indices));
+			}
+
+			uint32_t bits = 0;
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+			}
+			Out[0] = static_cast<uint8_t>(c0);
+			Out[1] = static_cast<uint8_t>(c0 >> 8);
+			Out[2] = static_cast<uint8_t>(c1);
+			Out[3] = static_cast<uint8_t>(c1 >> 8);
+			std::memcpy(Out + 4, &bits, sizeof(bits));
+		}
+
+		/// <summary>
+		/// 128bit のビット列への書き込み（下位から順に詰める）
+		/// </summary>
+		struct BitWriter
+		{
+			uint8_t* Out;
+			uint32_t Position;
+
+			void Write(uint32_t Value, uint32_t Bits)
+			{
+				for (uint32_t i = 0; i < Bits; ++i, ++Position)
+				{
+					if ((Value >> i) & 1) Out[Position >> 3] |= static_cast<uint8_t>(1u << (Position & 7));
+				}
+			}
+		};
+
+		/// <summary>
+		/// BC7 モード6の端点（7bit + 共通の下位1bit）
+		/// </summary>
+		struct Bc7Endpoints
+		{
+			uint8_t Quantized[2][4];
+			uint8_t PBits[2];
+		};
+
+		/// <summary>
+		/// 下位 1bit を決めた時の端点
+		/// </summary>
+		void QuantizeBC7(const float (&A)[4], const float (&B)[4], uint8_t P0, uint8_t P1, Bc7Endpoints& Out)
+		{
+			Out.PBits[0] = P0;
+			Out.PBits[1] = P1;
+			for (int c = 0; c < 4; ++c)
+			{
+				Out.Quantized[0][c] = static_cast<uint8_t>(std::clamp<long>(std::lround((A[c] - P0) * 0.5f), 0, 127));
+				Out.Quantized[1][c] = static_cast<uint8_t>(std::clamp<long>(std::lround((B[c] - P1) * 0.5f), 0, 127));
+			}
+		}
+
+		/// <summary>
+		/// モード6の端点から一番近い番号を選ぶ
+		/// </summary>
+		/// <returns>二乗誤差の合計</returns>
+		uint32_t SelectBC7Indices(const float (&Pixels)[BLOCK_PIXELS][4], const Bc7Endpoints& Endpoints, uint8_t (&OutIndices)[BLOCK_PIXELS])
+		{
+			int e[2][4];
+			for (int k = 0; k < 2; ++k)
+			{
+				for (int c = 0; c < 4; ++c) e[k][c] = (Endpoints.Quantized[k][c] << 1) | Endpoints.PBits[k];
+			}
+			int palette[16][4];
+			for (int k = 0; k < 16; ++k)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					palette[k][c] = ((64 - BC7_WEIGHTS4[k]) * e[0][c] + BC7_WEIGHTS4[k] * e[1][c] + 32) >> 6;
+				}
+			}
+
+			uint32_t total = 0;
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				uint32_t best = UINT32_MAX;
+				for (uint8_t k = 0; k < 16; ++k)
+				{
+					uint32_t error = 0;
+					for (int c = 0; c < 4; ++c)
+					{
+						const int d = static_cast<int>(Pixels[i][c]) - palette[k][c];
+						error += static_cast<uint32_t>(d * d);
+					}
+					if (error < best)
+					{
+						best = error;
+						OutIndices[i] = k;
+					}
+				}
+				total += best;
+			}
+			return total;
+		}
+
+		/// <summary>
+		/// 4通りの下位 1bit を全て試し、一番良いものを選ぶ
+		/// </summary>
+		uint32_t FitBC7(const float (&Pixels)[BLOCK_PIXELS][4], const float (&A)[4], const float (&B)[4], Bc7Endpoints& OutEndpoints, uint8_t (&OutIndices)[BLOCK_PIXELS])
+		{
+			uint32_t best = UINT32_MAX;
+			for (uint8_t p = 0; p < 4; ++p)
+			{
+				Bc7Endpoints endpoints;
+				QuantizeBC7(A, B, p & 1, p >> 1, endpoints);
+				uint8_t indices[BLOCK_PIXELS];
+				const uint32_t error = SelectBC7Indices(Pixels, endpoints, indices);
+				if (error < best)
+				{
+					best = error;
+					OutEndpoints = endpoints;
+					std::memcpy(OutIndices, indices, sizeof(indices));
+				}
+			}
+			return best;
+		}
+	}
+
+	/// <summary>
+	/// 1ブロックの大きさ（バイト）
+	/// </summary>
+	uint32_t BlockCompressor::GetBlockSize(EBlockFormat Format)
+	{
+		return (Format == EBlockFormat::BC1 || Format == EBlockFormat::BC4) ? 8 : 16;
+	}
+
+	/// <summary>
+	/// 1ブロックを圧縮する
+	/// </summary>
+	/// <param name="Format">形式</param>
+	/// <param name="Rgba">4x4 ピクセル（RGBA8、行優先）</param>
+	/// <param name="Out">書き込み先（GetBlockSize バイト）</param>
+	void BlockCompressor::EncodeBlock(EBlockFormat Format, const uint8_t* Rgba, uint8_t* Out)
+	{
+		switch (Format)
+		{
+		case EBlockFormat::BC1: EncodeBC1(Rgba, Out); break;
+		case EBlockFormat::BC3: EncodeBC3(Rgba, Out); break;
+		case EBlockFormat::BC4: EncodeBC4(Rgba, 0, Out); break;
+		case EBlockFormat::BC5: EncodeBC5(Rgba, Out); break;
+		case EBlockFormat::BC7: EncodeBC7(Rgba, Out); break;
+		}
+	}
+
+	/// <summary>
+	/// 画像のブロックの行をまとめて圧縮する（端は一番外のピクセルを繰り返す）
+	/// </summary>
+	/// <param name="Format">形式</param>
+	/// <param name="Pixels">画像の先頭（RGBA8）</param>
+	/// <param name="Width">幅</param>
+	/// <param name="Height">高さ</param>
+	/// <param name="RowPitch">画像の1行の大きさ（バイト）</param>
+	/// <param name="FirstBlockRow">最初のブロックの行</param>
+	/// <param name="BlockRowCount">ブロックの行の数</param>
+	/// <param name="Out">FirstBlockRow の行の先頭の書き込み先</param>
+	void BlockCompressor::EncodeRows(EBlockFormat Format, const uint8_t* Pixels, uint32_t Width, uint32_t Height, uint64_t RowPitch,
+		uint32_t FirstBlockRow, uint32_t BlockRowCount, uint8_t* Out)
+	{
+		const uint32_t blockSize = GetBlockSize(Format);
+		const uint32_t blocksX = (Width + 3) / 4;
+
+		uint8_t block[BLOCK_PIXELS * 4];
+		for (uint32_t by = FirstBlockRow; by < FirstBlockRow + BlockRowCount; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocksX; ++bx)
+			{
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const uint32_t sy = std::min(by * 4 + y, Height - 1);
+					const uint8_t* row = Pixels + sy * RowPitch;
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						const uint32_t sx = std::min(bx * 4 + x, Width - 1);
+						std::memcpy(block + (y * 4 + x) * 4, row + sx * 4, 4);
+					}
+				}
+				EncodeBlock(Format, block, Out);
+				Out += blockSize;
+			}
+		}
+	}
+
+	/// <summary>
+	/// BC1（アルファは無視する）
+	/// </summary>
+	void BlockCompressor::EncodeBC1(const uint8_t* Rgba, uint8_t* Out)
+	{
+		EncodeColorBlock(Rgba, Out);
+	}
+
+	/// <summary>
+	/// BC3（アルファ + 色）
+	/// </summary>
+	void BlockCompressor::EncodeBC3(const uint8_t* Rgba, uint8_t* Out)
+	{
+		EncodeBC4(Rgba, 3, Out);
+		EncodeColorBlock(Rgba, Out + 8);
+	}
+
+	/// <summary>
+	/// BC4（1チャンネル。8段階のモードだけを使う）
+	/// </summary>
+	/// <param name="Rgba">4x4 ピクセル</param>
+	/// <param name="Channel">使うチャンネル（0:R 〜 3:A）</param>
+	/// <param name="Out">書き込み先（8バイト）</param>
+	void BlockCompressor::EncodeBC4(const uint8_t* Rgba, uint32_t Channel, uint8_t* Out)
+	{
+		uint8_t values[BLOCK_PIXELS];
+		uint8_t minValue = 255;
+		uint8_t maxValue = 0;
+		for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+		{
+			values[i] = Rgba[i * 4 + Channel];
+			minValue = std::min(minValue, values[i]);
+			maxValue = std::max(maxValue, values[i]);
+		}
+
+		Out[0] = maxValue;
+		Out[1] = minValue;
+		uint64_t bits = 0;
+
+		//	全て同じなら a0 == a1 で全て 0 番
+		if (maxValue != minValue)
+		{
+			int palette[8];
+			palette[0] = maxValue;
+			palette[1] = minValue;
+			for (int k = 2; k < 8; ++k)
+			{
+				palette[k] = ((8 - k) * maxValue + (k - 1) * minValue) / 7;
+			}
+
+			for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+			{
+				int best = INT32_MAX;
+				uint64_t index = 0;
+				for (uint64_t k = 0; k < 8; ++k)
+				{
+					const int d = std::abs(static_cast<int>(values[i]) - palette[k]);
+					if (d < best)
+					{
+						best = d;
+						index = k;
+					}
+				}
+				bits |= index << (i * 3);
+			}
+		}
+
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			Out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+		}
+	}
+
+	/// <summary>
+	/// BC5（R と G をそれぞれ BC4 で）
+	/// </summary>
+	void BlockCompressor::EncodeBC5(const uint8_t* Rgba, uint8_t* Out)
+	{
+		EncodeBC4(Rgba, 0, Out);
+		EncodeBC4(Rgba, 1, Out + 8);
+	}
+
+	/// <summary>
+	/// BC7（モード6だけ）
+	/// </summary>
+	void BlockCompressor::EncodeBC7(const uint8_t* Rgba, uint8_t* Out)
+	{
+		float pixels[BLOCK_PIXELS][4];
+		for (uint32_t i = 0; i < BLOCK_PIXELS; ++i)
+		{
+			for (int c = 0; c < 4; ++c) pixels[i][c] = Rgba[i * 4 + c];
+		}
+
+		float minColor[4];
+		float maxColor[4];
+		ComputeEndpoints(pixels, minColor, maxColor);
+
+		Bc7Endpoints endpoints;
+		uint8_t indices[BLOCK_PIXELS];
+		uint32_t error = FitBC7(pixels, minColor, maxColor, endpoints, indices);
+
+		//	番号を固定して端点を詰め直す（良くなる間だけ）
+		float weights[16];
+		for (int k = 0; k < 16; ++k) weights[k] = 1.0f - BC7_WEIGHTS4[k] / 64.0f;
+		for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+		{
+			float a[4];
+			float b[4];
+			if (RefineEndpoints(pixels, indices, weights, a, b) == false) break;
+
+			Bc7Endpoints nextEndpoints;
+			uint8_t nextIndices[BLOCK_PIXELS];
+			const uint32_t nextError = FitBC7(pixels, a, b, nextEndpoints, nextIndices);
+			if (nextError >= error) break;
+
+			endpoints = nextEndpoints;
+			error = nextError;
+			std::memcpy(indices, nextIndices, sizeof(indices));
+		}
+
+		//	最初のピクセルの番号の最上位は 0 と決まっているので、そうでなければ端点を入れ替える
+		if (indices[0] >= 8)
+		{
+			for (int c = 0; c < 4; ++c) std::swap(endpoints.Quantized[0][c], endpoints.Quantized[1][c]);
+			std::swap(endpoints.PBits[0], endpoints.PBits[1]);
+			for (auto& index : indices) index = static_cast<uint8_t>(15 - index);
+		}
+
+		std::memset(Out, 0, 16);
+		BitWriter writer = { Out, 0 };
+		writer.Write(1u << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(endpoints.Quantized[0][c], 7);
+			writer.Write(endpoints.Quantized[1][c], 7);
+		}
+		writer.Write(endpoints.PBits[0], 1);
+		writer.Write(endpoints.PBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (uint32_t i = 1; i < BLOCK_PIXELS; ++i)
+		{
+			writer.Write(indices[i], 4);
+		}
+	}
+}
@@ -0,0 +1,717 @@
+﻿#include "pch.h"
+#include<Graphics/Texture/TextureCooker.hpp>
+#include<System/IO/DerivedDataCache.hpp>
+#include<System/IO/MappedFile.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<fstream>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// DXGI_FORMAT の値（DirectXTex の無い所でも書けるように数字で持つ）
+		/// </summary>
+		constexpr uint32_t FORMAT_R8G8B8A8_UNORM = 28;
+		constexpr uint32_t FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+		constexpr uint32_t FORMAT_BC1_UNORM = 71;
+		constexpr uint32_t FORMAT_BC1_UNORM_SRGB = 72;
+		constexpr uint32_t FORMAT_BC3_UNORM = 77;
+		constexpr uint32_t FORMAT_BC3_UNORM_SRGB = 78;
+		constexpr uint32_t FORMAT_BC4_UNORM = 80;
+		constexpr uint32_t FORMAT_BC5_UNORM = 83;
+		constexpr uint32_t FORMAT_B8G8R8A8_UNORM = 87;
+		constexpr uint32_t FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+		constexpr uint32_t FORMAT_BC7_UNORM = 98;
+		constexpr uint32_t FORMAT_BC7_UNORM_SRGB = 99;
+
+		/// <summary>
+		/// DDS のヘッダー
+		/// </summary>
+		constexpr uint32_t DDS_MAGIC = 0x20534444;
+		constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844;
+		constexpr uint64_t DDS_HEADER_SIZE = 4 + 124;
+		constexpr uint64_t DDS_DX10_HEADER_SIZE = 20;
+		constexpr uint32_t DDSD_CAPS = 0x1;
+		constexpr uint32_t DDSD_HEIGHT = 0x2;
+		constexpr uint32_t DDSD_WIDTH = 0x4;
+		constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+		constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+		constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+		constexpr uint32_t DDPF_ALPHAPIXELS = 0x1;
+		constexpr uint32_t DDPF_FOURCC = 0x4;
+		constexpr uint32_t DDPF_RGB = 0x40;
+		constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+		constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+		constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+		constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+		/// <summary>
+		/// 1回の並列処理で受け持つブロックの行の数
+		/// </summary>
+		constexpr uint32_t STRIP_BLOCK_ROWS = 8;
+
+		/// <summary>
+		/// RGBA8 の画像（行の間に隙間なし）
+		/// </summary>
+		struct RgbaImage
+		{
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			std::vector<uint8_t> Pixels;
+		};
+
+		/// <summary>
+		/// 並列に圧縮する1つ分（あるミップのブロックの行の範囲）
+		/// </summary>
+		struct CompressTask
+		{
+			uint32_t Mip;
+			uint32_t FirstBlockRow;
+			uint32_t BlockRowCount;
+		};
+
+		uint32_t Read32(const uint8_t* p)
+		{
+			uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		uint16_t Read16(const uint8_t* p)
+		{
+			return static_cast<uint16_t>(p[0] | (p[1] << 8));
+		}
+
+		void Write32(std::vector<uint8_t>& Out, uint64_t Offset, uint32_t Value)
+		{
+			std::memcpy(Out.data() + Offset, &Value, sizeof(Value));
+		}
+
+		std::string ToLowerExtension(const std::filesystem::path& Extension)
+		{
+			std::string text = Extension.string();
+			if (text.empty() == false && text.front() != '.') text.insert(text.begin(), '.');
+			std::transform(text.begin(), text.end(), text.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+			return text;
+		}
+
+		/// <summary>
+		/// Auto を実際に使うものにする
+		/// </summary>
+		ETextureEncoder ResolveEncoder(ETextureEncoder Encoder)
+		{
+			if (Encoder != ETextureEncoder::Auto) return Encoder;
+			return TextureCooker::IsDirectXTexAvailable() ? ETextureEncoder::DirectXTex : ETextureEncoder::Portable;
+		}
+
+		/// <summary>
+		/// BC4 と BC5 は色ではないので sRGB にしない
+		/// </summary>
+		bool IsSrgb(const TextureCookSettings& Settings)
+		{
+			return Settings.Srgb && Settings.Format != EBlockFormat::BC5 && Settings.Format != EBlockFormat::BC4;
+		}
+
+		uint32_t GetDxgiFormat(EBlockFormat Format, bool Srgb)
+		{
+			switch (Format)
+			{
+			case EBlockFormat::BC1: return Srgb ? FORMAT_BC1_UNORM_SRGB : FORMAT_BC1_UNORM;
+			case EBlockFormat::BC3: return Srgb ? FORMAT_BC3_UNORM_SRGB : FORMAT_BC3_UNORM;
+			case EBlockFormat::BC4: return FORMAT_BC4_UNORM;
+			case EBlockFormat::BC5: return FORMAT_BC5_UNORM;
+			case EBlockFormat::BC7: return Srgb ? FORMAT_BC7_UNORM_SRGB : FORMAT_BC7_UNORM;
+			}
+			return 0;
+		}
+
+		/// <summary>
+		/// TGA（True Color / グレースケール、非圧縮と RLE）を読む
+		/// </summary>
+		bool DecodeTga(std::span<const uint8_t> Source, RgbaImage& Out)
+		{
+			if (Source.size() < 18) return false;
+			const uint8_t idLength = Source[0];
+			const uint8_t colorMapType = Source[1];
+			const uint8_t imageType = Source[2];
+			const uint32_t width = Read16(&Source[12]);
+			const uint32_t height = Read16(&Source[14]);
+			const uint32_t bitsPerPixel = Source[16];
+			const uint8_t descriptor = Source[17];
+
+			const bool rle = imageType == 10 || imageType == 11;
+			const bool gray = imageType == 3 || imageType == 11;
+			if (colorMapType != 0 || (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11)) return false;
+			if (gray ? bitsPerPixel != 8 : (bitsPerPixel != 24 && bitsPerPixel != 32)) return false;
+			if (width == 0 || height == 0) return false;
+
+			const uint32_t bytesPerPixel = bitsPerPixel / 8;
+			const uint64_t pixelCount = static_cast<uint64_t>(width) * height;
+			size_t position = 18 + idLength;
+
+			Out.Width = width;
+			Out.Height = height;
+			Out.Pixels.resize(pixelCount * 4);
+
+			auto store = [&](uint64_t Index, const uint8_t* Pixel)
+				{
+					uint8_t* dst = &Out.Pixels[Index * 4];
+					if (gray)
+					{
+						dst[0] = dst[1] = dst[2] = Pixel[0];
+						dst[3] = 255;
+						return;
+					}
+					dst[0] = Pixel[2];
+					dst[1] = Pixel[1];
+					dst[2] = Pixel[0];
+					dst[3] = bytesPerPixel == 4 ? Pixel[3] : 255;
+				};
+
+			uint64_t index = 0;
+			while (index < pixelCount)
+			{
+				if (rle == false)
+				{
+					if (position + bytesPerPixel > Source.size()) return false;
+					store(index++, &Source[position]);
+					position += bytesPerPixel;
+					continue;
+				}
+
+				//	上位ビットが立っていれば同じピクセルの繰り返し、そうでなければそのまま並ぶ
+				if (position >= Source.size()) return false;
+				const uint8_t packet = Source[position++];
+				const uint32_t count = (packet & 0x7F) + 1u;
+				if (index + count > pixelCount) return false;
+				if (packet & 0x80)
+				{
+					if (position + bytesPerPixel > Source.size()) return false;
+					for (uint32_t i = 0; i < count; ++i) store(index++, &Source[position]);
+					position += bytesPerPixel;
+				}
+				else
+				{
+					if (position + static_cast<size_t>(count) * bytesPerPixel > Source.size()) return false;
+					for (uint32_t i = 0; i < count; ++i)
+					{
+						store(index++, &Source[position]);
+						position += bytesPerPixel;
+					}
+				}
+			}
+
+			//	既定は左下が原点なので上下を入れ替える
+			if ((descriptor & 0x20) == 0)
+			{
+				const size_t rowSize = static_cast<size_t>(width) * 4;
+				for (uint32_t y = 0; y < height / 2; ++y)
+				{
+					std::swap_ranges(Out.Pixels.begin() + y * rowSize, Out.Pixels.begin() + (y + 1) * rowSize, Out.Pixels.begin() + (height - 1 - y) * rowSize);
+				}
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// 非圧縮 32bit（RGBA / BGRA）の DDS の一番上のミップを読む
+		/// </summary>
+		bool DecodeDds(std::span<const uint8_t> Source, RgbaImage& Out)
+		{
+			if (Source.size() < DDS_HEADER_SIZE || Read32(&Source[0]) != DDS_MAGIC) return false;
+			const uint32_t height = Read32(&Source[12]);
+			const uint32_t width = Read32(&Source[16]);
+			const uint32_t pixelFlags = Read32(&Source[80]);
+			const uint32_t fourCC = Read32(&Source[84]);
+			const uint32_t bitCount = Read32(&Source[88]);
+			const uint32_t redMask = Read32(&Source[92]);
+			const uint32_t alphaMask = Read32(&Source[104]);
+
+			uint64_t offset = DDS_HEADER_SIZE;
+			bool bgra = false;
+			bool hasAlpha = true;
+			if ((pixelFlags & DDPF_FOURCC) != 0)
+			{
+				if (fourCC != DDS_FOURCC_DX10 || Source.size() < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE) return false;
+				const uint32_t format = Read32(&Source[DDS_HEADER_SIZE]);
+				const uint32_t dimension = Read32(&Source[DDS_HEADER_SIZE + 4]);
+				if (dimension != DDS_DIMENSION_TEXTURE2D) return false;
+				if (format == FORMAT_B8G8R8A8_UNORM || format == FORMAT_B8G8R8A8_UNORM_SRGB) bgra = true;
+				else if (format != FORMAT_R8G8B8A8_UNORM && format != FORMAT_R8G8B8A8_UNORM_SRGB) return false;
+				offset += DDS_DX10_HEADER_SIZE;
+			}
+			else
+			{
+				if ((pixelFlags & DDPF_RGB) == 0 || bitCount != 32) return false;
+				if (redMask == 0x00FF0000) bgra = true;
+				else if (redMask != 0x000000FF) return false;
+				hasAlpha = (pixelFlags & DDPF_ALPHAPIXELS) != 0 && alphaMask == 0xFF000000;
+			}
+
+			const uint64_t size = static_cast<uint64_t>(width) * height * 4;
+			if (width == 0 || height == 0 || offset + size > Source.size()) return false;
+
+			Out.Width = width;
+			Out.Height = height;
+			Out.Pixels.assign(Source.begin() + offset, Source.begin() + offset + size);
+			for (size_t i = 0; i < Out.Pixels.size(); i += 4)
+			{
+				if (bgra) std::swap(Out.Pixels[i], Out.Pixels[i + 2]);
+				if (hasAlpha == false) Out.Pixels[i + 3] = 255;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// sRGB → 線形（0〜1）
+		/// </summary>
+		const std::array<float, 256>& GetSrgbToLinear()
+		{
+			static const std::array<float, 256> table = []()
+				{
+					std::array<float, 256> values = {};
+					for (int i = 0; i < 256; ++i)
+					{
+						const float c = i / 255.0f;
+						values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+					}
+					return values;
+				}();
+			return table;
+		}
+
+		uint8_t LinearToSrgb(float Value)
+		{
+			const float c = std::clamp(Value, 0.0f, 1.0f);
+			const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+			return static_cast<uint8_t>(std::lround(s * 255.0f));
+		}
+
+		/// <summary>
+		/// 2x2 の平均で一番下までミップを作る（奇数の端は同じピクセルを使う）
+		/// </summary>
+		void GenerateBoxMips(std::vector<RgbaImage>& Mips, bool Srgb)
+		{
+			const auto& toLinear = GetSrgbToLinear();
+			while (Mips.back().Width > 1 || Mips.back().Height > 1)
+			{
+				const RgbaImage& source = Mips.back();
+				RgbaImage next;
+				next.Width = std::max(source.Width / 2, 1u);
+				next.Height = std::max(source.Height / 2, 1u);
+				next.Pixels.resize(static_cast<size_t>(next.Width) * next.Height * 4);
+
+				for (uint32_t y = 0; y < next.Height; ++y)
+				{
+					const uint32_t y0 = std::min(y * 2, source.Height - 1);
+					const uint32_t y1 = std::min(y * 2 + 1, source.Height - 1);
+					for (uint32_t x = 0; x < next.Width; ++x)
+					{
+						const uint32_t x0 = std::min(x * 2, source.Width - 1);
+						const uint32_t x1 = std::min(x * 2 + 1, source.Width - 1);
+						const uint8_t* p[4] = {
+							&source.Pixels[(static_cast<size_t>(y0) * source.Width + x0) * 4],
+							&source.Pixels[(static_cast<size_t>(y0) * source.Width + x1) * 4],
+							&source.Pixels[(static_cast<size_t>(y1) * source.Width + x0) * 4],
+							&source.Pixels[(static_cast<size_t>(y1) * source.Width + x1) * 4],
+						};
+						uint8_t* dst = &next.Pixels[(static_cast<size_t>(y) * next.Width + x) * 4];
+						for (int c = 0; c < 4; ++c)
+						{
+							//	色は線形で平均する（アルファはそのまま）
+							if (Srgb && c < 3)
+							{
+								dst[c] = LinearToSrgb((toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]]) * 0.25f);
+							}
+							else
+							{
+								dst[c] = static_cast<uint8_t>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+							}
+						}
+					}
+				}
+				Mips.push_back(std::move(next));
+			}
+		}
+
+		/// <summary>
+		/// DirectXTex を使わずに読み込み、ミップを作る
+		/// </summary>
+		bool DecodePortable(std::span<const uint8_t> Source, const std::string& Extension, const TextureCookSettings& Settings, std::vector<RgbaImage>& OutMips)
+		{
+			RgbaImage image;
+			bool decoded = false;
+			if (Extension == ".tga") decoded = DecodeTga(Source, image);
+			else if (Extension == ".dds") decoded = DecodeDds(Source, image);
+			else
+			{
+				ECSE_LOG(System::ELogLevel::Error, "TextureCooker: {} needs DirectXTex. Only .tga and uncompressed .dds are supported here.", Extension);
+				return false;
+			}
+			if (decoded == false)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Unsupported or broken {} file.", Extension);
+				return false;
+			}
+
+			OutMips.clear();
+			OutMips.push_back(std::move(image));
+			if (Settings.GenerateMips) GenerateBoxMips(OutMips, IsSrgb(Settings));
+			return true;
+		}
+
+#if defined(_WIN32)
+		/// <summary>
+		/// DirectXTex で読み込み、RGBA8 にしてミップを作る
+		/// </summary>
+		bool DecodeDirectXTex(std::span<const uint8_t> Source, const std::string& Extension, const TextureCookSettings& Settings, std::vector<RgbaImage>& OutMips)
+		{
+			DirectX::ScratchImage image;
+			HRESULT hr = E_FAIL;
+			if (Extension == ".dds")
+			{
+				hr = DirectX::LoadFromDDSMemory(Source.data(), Source.size(), DirectX::DDS_FLAGS_NONE, nullptr, image);
+			}
+			else if (Extension == ".tga")
+			{
+				hr = DirectX::LoadFromTGAMemory(Source.data(), Source.size(), DirectX::TGA_FLAGS_NONE, nullptr, image);
+			}
+			else if (Extension == ".hdr")
+			{
+				hr = DirectX::LoadFromHDRMemory(Source.data(), Source.size(), nullptr, image);
+			}
+			else
+			{
+				//	WIC は呼んだスレッドで COM が要る
+				const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+				hr = DirectX::LoadFromWICMemory(Source.data(), Source.size(), DirectX::WIC_FLAGS_NONE, nullptr, image);
+				if (SUCCEEDED(com)) CoUninitialize();
+			}
+			if (FAILED(hr))
+			{
+				ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Failed to decode {} (0x{:08X})", Extension, static_cast<uint32_t>(hr));
+				return false;
+			}
+			if (image.GetMetadata().dimension != DirectX::TEX_DIMENSION_TEXTURE2D || image.GetMetadata().arraySize != 1)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Only single 2D textures can be cooked.");
+				return false;
+			}
+
+			//	圧縮済みなら一度戻す
+			if (DirectX::IsCompressed(image.GetMetadata().format))
+			{
+				DirectX::ScratchImage decompressed;
+				hr = DirectX::Decompress(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DXGI_FORMAT_UNKNOWN, decompressed);
+				if (FAILED(hr)) return false;
+				image = std::move(decompressed);
+			}
+
+			const bool srgb = IsSrgb(Settings);
+			const DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+			if (image.GetMetadata().format != format)
+			{
+				DirectX::ScratchImage converted;
+				hr = DirectX::Convert(image.GetImages(), image.GetImageCount(), image.GetMetadata(), format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+				if (FAILED(hr)) return false;
+				image = std::move(converted);
+			}
+
+			if (Settings.GenerateMips)
+			{
+				DirectX::ScratchImage mipChain;
+				hr = DirectX::GenerateMipMaps(*image.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, mipChain);
+				if (FAILED(hr)) return false;
+				image = std::move(mipChain);
+			}
+
+			OutMips.clear();
+			for (size_t mip = 0; mip < image.GetMetadata().mipLevels; ++mip)
+			{
+				const DirectX::Image* source = image.GetImage(mip, 0, 0);
+				RgbaImage rgba;
+				rgba.Width = static_cast<uint32_t>(source->width);
+				rgba.Height = static_cast<uint32_t>(source->height);
+				rgba.Pixels.resize(static_cast<size_t>(rgba.Width) * rgba.Height * 4);
+				for (uint32_t y = 0; y < rgba.Height; ++y)
+				{
+					std::memcpy(&rgba.Pixels[static_cast<size_t>(y) * rgba.Width * 4], source->pixels + y * source->rowPitch, static_cast<size_t>(rgba.Width) * 4);
+				}
+				OutMips.push_back(std::move(rgba));
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// DirectXTex でブロックの行の範囲を圧縮する
+		/// </summary>
+		bool CompressDirectXTex(const RgbaImage& Mip, EBlockFormat Format, bool Srgb, uint32_t FirstBlockRow, uint32_t BlockRowCount, uint8_t* Out, size_t OutSize)
+		{
+			const uint32_t firstRow = FirstBlockRow * 4;
+			const uint32_t rowCount = std::min(BlockRowCount * 4, Mip.Height - firstRow);
+
+			DirectX::Image strip = {};
+			strip.width = Mip.Width;
+			strip.height = rowCount;
+			strip.format = Srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+			strip.rowPitch = static_cast<size_t>(Mip.Width) * 4;
+			strip.slicePitch = strip.rowPitch * rowCount;
+			strip.pixels = const_cast<uint8_t*>(Mip.Pixels.data()) + firstRow * strip.rowPitch;
+
+			DirectX::ScratchImage compressed;
+			const HRESULT hr = DirectX::Compress(strip, static_cast<DXGI_FORMAT>(GetDxgiFormat(Format, Srgb)),
+				DirectX::TEX_COMPRESS_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, compressed);
+			if (FAILED(hr) || compressed.GetPixelsSize() != OutSize) return false;
+
+			std::memcpy(Out, compressed.GetPixels(), OutSize);
+			return true;
+		}
+#endif
+
+		/// <summary>
+		/// 全てのミップをブロックの行ごとに分けて並列に圧縮する
+		/// </summary>
+		bool CompressMips(const std::vector<RgbaImage>& Mips, EBlockFormat Format, [[maybe_unused]] bool Srgb, [[maybe_unused]] bool UseDirectXTex, std::vector<std::vector<uint8_t>>& OutBlocks)
+		{
+			const uint32_t blockSize = BlockCompressor::GetBlockSize(Format);
+
+			std::vector<CompressTask> tasks;
+			OutBlocks.resize(Mips.size());
+			for (uint32_t mip = 0; mip < Mips.size(); ++mip)
+			{
+				const uint32_t blocksX = (Mips[mip].Width + 3) / 4;
+				const uint32_t blocksY = (Mips[mip].Height + 3) / 4;
+				OutBlocks[mip].resize(static_cast<size_t>(blocksX) * blocksY * blockSize);
+				for (uint32_t row = 0; row < blocksY; row += STRIP_BLOCK_ROWS)
+				{
+					tasks.push_back({ mip, row, std::min(STRIP_BLOCK_ROWS, blocksY - row) });
+				}
+			}
+
+			std::atomic<bool> succeeded = true;
+			auto run = [&](uint32_t Begin, uint32_t End)
+				{
+					for (uint32_t i = Begin; i < End; ++i)
+					{
+						const CompressTask& task = tasks[i];
+						const RgbaImage& mip = Mips[task.Mip];
+						const size_t rowBytes = static_cast<size_t>((mip.Width + 3) / 4) * blockSize;
+						uint8_t* out = OutBlocks[task.Mip].data() + task.FirstBlockRow * rowBytes;
+#if defined(_WIN32)
+						if (UseDirectXTex)
+						{
+							if (CompressDirectXTex(mip, Format, Srgb, task.FirstBlockRow, task.BlockRowCount, out, rowBytes * task.BlockRowCount) == false)
+							{
+								succeeded.store(false, std::memory_order_relaxed);
+							}
+							continue;
+						}
+#endif
+						BlockCompressor::EncodeRows(Format, mip.Pixels.data(), mip.Width, mip.Height, static_cast<uint64_t>(mip.Width) * 4,
+							task.FirstBlockRow, task.BlockRowCount, out);
+					}
+				};
+
+			System::JobSystem::ParallelForOrInline(static_cast<uint32_t>(tasks.size()), run);
+			return succeeded.load();
+		}
+
+		/// <summary>
+		/// DX10 拡張付きの DDS にまとめる
+		/// </summary>
+		void WriteDds(const std::vector<RgbaImage>& Mips, const std::vector<std::vector<uint8_t>>& Blocks, uint32_t Format, std::vector<uint8_t>& OutBytes)
+		{
+			uint64_t dataSize = 0;
+			for (const auto& blocks : Blocks) dataSize += blocks.size();
+
+			OutBytes.assign(DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE + dataSize, 0);
+			const uint32_t mipCount = static_cast<uint32_t>(Mips.size());
+
+			Write32(OutBytes, 0, DDS_MAGIC);
+			Write32(OutBytes, 4, 124);
+			Write32(OutBytes, 8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+			Write32(OutBytes, 12, Mips[0].Height);
+			Write32(OutBytes, 16, Mips[0].Width);
+			Write32(OutBytes, 20, static_cast<uint32_t>(Blocks[0].size()));
+			Write32(OutBytes, 28, mipCount);
+			//	ピクセル形式は DX10 拡張に書く
+			Write32(OutBytes, 76, 32);
+			Write32(OutBytes, 80, DDPF_FOURCC);
+			Write32(OutBytes, 84, DDS_FOURCC_DX10);
+			Write32(OutBytes, 108, DDSCAPS_TEXTURE | (mipCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+
+			Write32(OutBytes, DDS_HEADER_SIZE, Format);
+			Write32(OutBytes, DDS_HEADER_SIZE + 4, DDS_DIMENSION_TEXTURE2D);
+			Write32(OutBytes, DDS_HEADER_SIZE + 12, 1);
+
+			uint64_t offset = DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE;
+			for (const auto& blocks : Blocks)
+			{
+				std::memcpy(OutBytes.data() + offset, blocks.data(), blocks.size());
+				offset += blocks.size();
+			}
+		}
+	}
+
+	/// <summary>
+	/// DirectXTex が使えるか
+	/// </summary>
+	bool TextureCooker::IsDirectXTexAvailable()
+	{
+#if defined(_WIN32)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/// <summary>
+	/// 焼き方を表す文字列（キャッシュのキーに使う）
+	/// </summary>
+	/// <param name="Settings">設定</param>
+	/// <param name="Extension">元のファイルの拡張子（読み方が変わるので含める）</param>
+	std::string TextureCooker::MakeRecipe(const TextureCookSettings& Settings, const std::filesystem::path& Extension)
+	{
+		//	使うものによって結果が変わるので、Auto は実際に使う方にしてから入れる
+		const ETextureEncoder encoder = ResolveEncoder(Settings.Encoder);
+		return std::format("TextureCooker/{} format={} srgb={} mips={} encoder={} source={}",
+			COOKER_VERSION, static_cast<uint32_t>(Settings.Format), IsSrgb(Settings), Settings.GenerateMips,
+			encoder == ETextureEncoder::DirectXTex ? "DirectXTex" : "Portable", ToLowerExtension(Extension));
+	}
+
+	/// <summary>
+	/// メモリ上の画像を焼く
+	/// </summary>
+	/// <param name="Source">元のファイルの中身</param>
+	/// <param name="Extension">元のファイルの拡張子（.dds .tga .png など）</param>
+	/// <param name="Settings">設定</param>
+	/// <param name="OutBytes">DDS ファイル全体</param>
+	/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+	/// <returns>true:成功</returns>
+	bool TextureCooker::Cook(std::span<const uint8_t> Source, const std::filesystem::path& Extension, const TextureCookSettings& Settings,
+		std::vector<uint8_t>& OutBytes, TextureCookStats* pStats)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const ETextureEncoder encoder = ResolveEncoder(Settings.Encoder);
+		if (encoder == ETextureEncoder::DirectXTex && IsDirectXTexAvailable() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureCooker: DirectXTex is not available on this platform.");
+			return false;
+		}
+		const bool useDirectXTex = encoder == ETextureEncoder::DirectXTex;
+		const std::string extension = ToLowerExtension(Extension);
+		const bool srgb = IsSrgb(Settings);
+
+		std::vector<RgbaImage> mips;
+#if defined(_WIN32)
+		const bool decoded = useDirectXTex ? DecodeDirectXTex(Source, extension, Settings, mips) : DecodePortable(Source, extension, Settings, mips);
+#else
+		const bool decoded = DecodePortable(Source, extension, Settings, mips);
+#endif
+		if (decoded == false) return false;
+		if (mips.size() > 16)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Too large. {}x{}", mips[0].Width, mips[0].Height);
+			return false;
+		}
+
+		std::vector<std::vector<uint8_t>> blocks;
+		if (CompressMips(mips, Settings.Format, srgb, useDirectXTex, blocks) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Failed to compress.");
+			return false;
+		}
+
+		WriteDds(mips, blocks, GetDxgiFormat(Settings.Format, srgb), OutBytes);
+
+		if (pStats != nullptr)
+		{
+			pStats->Width = mips[0].Width;
+			pStats->Height = mips[0].Height;
+			pStats->MipCount = static_cast<uint32_t>(mips.size());
+			pStats->SourceSize = Source.size();
+			pStats->FileSize = OutBytes.size();
+			pStats->CacheHit = false;
+			pStats->UsedPortableEncoder = useDirectXTex == false;
+			pStats->ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// ファイルを焼いて書き出す。キャッシュにあれば焼かずにそれを書く
+	/// </summary>
+	/// <param name="Input">元のファイル</param>
+	/// <param name="Output">書き出し先</param>
+	/// <param name="Settings">設定</param>
+	/// <param name="pCache">派生データのキャッシュ（使わないなら nullptr）</param>
+	/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+	/// <returns>true:成功</returns>
+	bool TextureCooker::Write(const std::filesystem::path& Input, const std::filesystem::path& Output, const TextureCookSettings& Settings,
+		const System::DerivedDataCache* pCache, TextureCookStats* pStats)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		System::MappedFile file;
+		if (file.Open(Input) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Failed to open. {}", Input.string());
+			return false;
+		}
+		const std::span<const uint8_t> source = file.GetBytes();
+
+		TextureCookStats stats;
+		std::vector<uint8_t> bytes;
+		System::DerivedDataKey key;
+		bool cacheHit = false;
+		if (pCache != nullptr)
+		{
+			key = System::DerivedDataCache::MakeKey(source, MakeRecipe(Settings, Input.extension()));
+			stats.CacheKey = key.ToString();
+			cacheHit = pCache->Get(key, bytes) && bytes.size() >= DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE;
+		}
+
+		if (cacheHit == false)
+		{
+			if (Cook(source, Input.extension(), Settings, bytes, &stats) == false)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Failed to cook. {}", Input.string());
+				return false;
+			}
+			if (pCache != nullptr) pCache->Put(key, bytes);
+		}
+		else
+		{
+			//	中身はヘッダーから取る
+			stats.Height = Read32(&bytes[12]);
+			stats.Width = Read32(&bytes[16]);
+			stats.MipCount = Read32(&bytes[28]);
+			stats.UsedPortableEncoder = ResolveEncoder(Settings.Encoder) == ETextureEncoder::Portable;
+		}
+
+		std::error_code error;
+		if (Output.has_parent_path()) std::filesystem::create_directories(Output.parent_path(), error);
+		std::ofstream out(Output, std::ios::binary | std::ios::trunc);
+		if (out.is_open() == false || out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())).good() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureCooker: Failed to write. {}", Output.string());
+			return false;
+		}
+
+		if (pStats != nullptr)
+		{
+			*pStats = std::move(stats);
+			pStats->SourceSize = source.size();
+			pStats->FileSize = bytes.size();
+			pStats->CacheHit = cacheHit;
+			pStats->ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return true;
+	}
+}
@@ -0,0 +1,753 @@
+﻿#include "pch.h"
+#include<Graphics/Texture/TextureLoader.hpp>
+#include<Graphics/DX12/DX12.hpp>
+#include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapManager.hpp>
+#include<System/IO/MappedFile.hpp>
+#include<System/Thread/RenderThread.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<algorithm>
+#include<cwctype>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 手放したディスクリプタとテクスチャを返すまでのフレーム数
+		/// 描画スレッドが抱えているスナップショットと、GPU が処理中のフレームの分だけ待つ
+		/// </summary>
+		constexpr uint64_t RELEASE_DELAY = DX12::FRAME_COUNT + System::FRAME_SNAPSHOT_COUNT;
+
+		/// <summary>
+		/// スロット番号と世代の取り出し
+		/// </summary>
+		constexpr uint32_t SLOT_BITS = 16;
+		constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+		/// <summary>
+		/// プレースホルダーの一辺と、市松模様のマスの一辺
+		/// </summary>
+		constexpr uint32_t PLACEHOLDER_SIZE = 8;
+		constexpr uint32_t PLACEHOLDER_CELL = 4;
+
+		TextureHandle MakeHandle(uint32_t Index, uint16_t Generation)
+		{
+			return (static_cast<uint32_t>(Generation) << SLOT_BITS) | Index;
+		}
+
+		uint64_t PackResolved(TextureHandle Handle, int DescriptorIndex)
+		{
+			return (static_cast<uint64_t>(Handle) << 32) | static_cast<uint32_t>(DescriptorIndex);
+		}
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void TextureLoader::OnCreate()
+	{
+		mDevice = nullptr;
+		mFrameUploadBudget = DEFAULT_FRAME_UPLOAD_BUDGET;
+		mPlaceholderSrv = {};
+		mFrame = 0;
+		mStats = {};
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// 直接キューの完了は呼ぶ側で待っておくこと
+	/// </summary>
+	void TextureLoader::OnDestroy()
+	{
+		if (mIsInitialized == false) return;
+
+		//	コピーキューが書いている最中のステージングとテクスチャを消さない
+		mUploader.Wait(mUploader.GetLastFenceValue());
+
+		//	ワーカーがこの後に積んでも受け取り口だけが残る
+		{
+			std::lock_guard lock(mDecodeQueue->Mutex);
+			mDecodeQueue->Items.clear();
+		}
+		mDecodeQueue.reset();
+		mDecoded.clear();
+		mInFlight.clear();
+
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		if (gdh != nullptr)
+		{
+			for (auto& pending : mPendingReleases)
+			{
+				gdh->Discard(pending.Srv);
+			}
+			for (auto& slot : mSlots)
+			{
+				gdh->Discard(slot.Srv);
+			}
+			gdh->Discard(mPlaceholderSrv);
+		}
+		mPendingReleases.clear();
+		mSlots.clear();
+		mFreeSlots.clear();
+		mResolved.reset();
+		mPlaceholder.Reset();
+
+		mUploader.Release();
+		mDevice.Reset();
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// コピーキューとステージングの作成、プレースホルダーの転送
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="StagingSize">ステージングリングの大きさ（バイト）</param>
+	/// <returns>true:成功</returns>
+	bool TextureLoader::Initialize(ID3D12Device* Device, uint64_t StagingSize)
+	{
+		if (mIsInitialized == true || Device == nullptr || StagingSize == 0) return false;
+
+		mDevice = Device;
+		if (mUploader.Initialize(Device, StagingSize, L"TextureLoader Copy Queue") == false) return false;
+
+		mSlots.resize(MAX_TEXTURES);
+		mFreeSlots.resize(MAX_TEXTURES);
+		for (uint32_t i = 0; i < MAX_TEXTURES; ++i)
+		{
+			//	小さい番号から使うように後ろから積む
+			mFreeSlots[i] = static_cast<uint16_t>(MAX_TEXTURES - 1 - i);
+		}
+		mResolved = std::make_unique<std::atomic<uint64_t>[]>(MAX_TEXTURES);
+		mDecodeQueue = std::make_shared<DecodeQueue>();
+
+		mIsInitialized = true;
+		if (CreatePlaceholder() == false)
+		{
+			this->OnDestroy();
+			return false;
+		}
+
+		ECSE_LOG(System::ELogLevel::Log, "TextureLoader: Initialized. Staging={}MB", mUploader.GetStagingSize() / (1024 * 1024));
+		return true;
+	}
+
+	/// <summary>
+	/// 読み込みを始める（すぐに返る）
+	/// </summary>
+	/// <param name="Path">ファイルの場所</param>
+	/// <param name="OnLoaded">完了時に呼ばれる（省略可）</param>
+	/// <returns>ハンドル（空きがなければ INVALID_TEXTURE_HANDLE）</returns>
+	TextureHandle TextureLoader::Load(const std::filesystem::path& Path, Callback OnLoaded)
+	{
+		if (mIsInitialized == false) return INVALID_TEXTURE_HANDLE;
+		if (mFreeSlots.empty())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureLoader: Out of slots. {}", Path.string());
+			return INVALID_TEXTURE_HANDLE;
+		}
+
+		const uint32_t index = mFreeSlots.back();
+		mFreeSlots.pop_back();
+
+		Slot& slot = mSlots[index];
+		slot.State = ETextureState::Loading;
+		slot.OnLoaded = std::move(OnLoaded);
+		slot.Path = Path;
+
+		const TextureHandle handle = MakeHandle(index, slot.Generation);
+		mResolved[index].store(PackResolved(handle, mPlaceholderSrv.Index), std::memory_order_release);
+
+		//	ワーカーは受け取り口とデバイスを共有で持つので、先にこちらが消えても問題ない
+		auto task = [device = mDevice, queue = mDecodeQueue, Path, handle]()
+			{
+				auto texture = std::make_unique<DecodedTexture>();
+				texture->Handle = handle;
+				texture->Succeeded = Decode(device.Get(), Path, *texture);
+
+				std::lock_guard lock(queue->Mutex);
+				queue->Items.push_back(std::move(texture));
+			};
+
+		if (auto* pJobs = System::ServiceLocator::Get<System::JobSystem>())
+		{
+			pJobs->Run(std::move(task));
+		}
+		else
+		{
+			task();
+		}
+		return handle;
+	}
+
+	/// <summary>
+	/// テクスチャを手放す。GPU が使い終わるまで数フレーム遅らせて解放する
+	/// 読み込み中・転送中のものは世代が変わるので、終わった時に捨てられる。
+	/// </summary>
+	void TextureLoader::Unload(TextureHandle Handle)
+	{
+		Slot* slot = Find(Handle);
+		if (slot == nullptr) return;
+
+		const uint32_t index = Handle & SLOT_MASK;
+
+		//	描画スレッドには先にプレースホルダーを見せる
+		mResolved[index].store(PackResolved(INVALID_TEXTURE_HANDLE, mPlaceholderSrv.Index), std::memory_order_release);
+
+		if (slot->Texture != nullptr || slot->Srv.IsValid())
+		{
+			mPendingReleases.push_back({ std::move(slot->Texture), slot->Srv, mFrame + RELEASE_DELAY });
+		}
+
+		slot->Texture.Reset();
+		slot->Srv = {};
+		slot->OnLoaded = nullptr;
+		slot->Path.clear();
+		slot->State = ETextureState::Invalid;
+
+		//	0 にすると INVALID_TEXTURE_HANDLE と区別できなくなる
+		slot->Generation++;
+		if (slot->Generation == 0) slot->Generation = 1;
+
+		mFreeSlots.push_back(static_cast<uint16_t>(index));
+	}
+
+	/// <summary>
+	/// 完了した転送の反映と、展開済みのものの送信（ゲームスレッドでフレームに1回）
+	/// </summary>
+	void TextureLoader::Update()
+	{
+		if (mIsInitialized == false) return;
+
+		const auto start = std::chrono::steady_clock::now();
+		mStats.UploadedBytes = 0;
+
+		//	待たずに覗くだけ
+		const uint64_t completed = mUploader.Poll();
+		Retire(completed);
+
+		//	遅らせていた解放
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		std::erase_if(mPendingReleases, [this, gdh](PendingRelease& Pending)
+			{
+				if (Pending.Frame > mFrame) return false;
+				gdh->Discard(Pending.Srv);
+				return true;
+			});
+
+		//	ワーカーからの受け取り
+		std::vector<std::unique_ptr<DecodedTexture>> received;
+		{
+			std::lock_guard lock(mDecodeQueue->Mutex);
+			received.swap(mDecodeQueue->Items);
+		}
+		for (auto& texture : received)
+		{
+			Slot* slot = Find(texture->Handle);
+
+			//	読み込み中に手放された
+			if (slot == nullptr) continue;
+
+			if (texture->Succeeded == false)
+			{
+				Fail(texture->Handle);
+				continue;
+			}
+			slot->State = ETextureState::Decoded;
+			mDecoded.push_back(std::move(texture));
+		}
+
+		Submit();
+
+		mStats.Loading = 0;
+		mStats.Uploading = 0;
+		mStats.Resident = 0;
+		mStats.Failed = 0;
+		for (const auto& slot : mSlots)
+		{
+			switch (slot.State)
+			{
+			case ETextureState::Loading:
+			case ETextureState::Decoded:
+				mStats.Loading++;
+				break;
+			case ETextureState::Uploading:
+				mStats.Uploading++;
+				break;
+			case ETextureState::Resident:
+				mStats.Resident++;
+				break;
+			case ETextureState::Failed:
+				mStats.Failed++;
+				break;
+			default:
+				break;
+			}
+		}
+		mStats.StagingUsed = mUploader.GetStagingUsed();
+
+		mFrame++;
+		mStats.ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// 状態
+	/// </summary>
+	ETextureState TextureLoader::GetState(TextureHandle Handle) const
+	{
+		const Slot* slot = Find(Handle);
+		return slot != nullptr ? slot->State : ETextureState::Invalid;
+	}
+
+	/// <summary>
+	/// シェーダーから読むディスクリプタ（転送が終わるまではプレースホルダー）
+	/// 解決済みの値を読むだけなので描画スレッドからも呼べる。
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE TextureLoader::GetGpuHandle(TextureHandle Handle) const
+	{
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		if (gdh == nullptr) return { 0 };
+
+		GDescritorHeapInfo info = {};
+		info.Index = static_cast<int>(GetDescriptorIndex(Handle));
+		info.Size = 1;
+		return gdh->GetGpuHandle(info);
+	}
+
+	/// <summary>
+	/// ヒープの先頭からのディスクリプタの番号（バインドレス用。転送が終わるまではプレースホルダー）
+	/// </summary>
+	uint32_t TextureLoader::GetDescriptorIndex(TextureHandle Handle) const
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		if (mResolved == nullptr || index >= MAX_TEXTURES) return static_cast<uint32_t>(mPlaceholderSrv.Index);
+
+		//	古いハンドルなら上位が一致しない
+		const uint64_t resolved = mResolved[index].load(std::memory_order_acquire);
+		if (static_cast<TextureHandle>(resolved >> 32) != Handle) return static_cast<uint32_t>(mPlaceholderSrv.Index);
+		return static_cast<uint32_t>(resolved);
+	}
+
+	/// <summary>
+	/// プレースホルダーのディスクリプタの番号（TextureStreamer も最初の転送までこれを見せる）
+	/// </summary>
+	uint32_t TextureLoader::GetPlaceholderIndex() const
+	{
+		return static_cast<uint32_t>(mPlaceholderSrv.Index);
+	}
+
+	/// <summary>
+	/// テクスチャ本体（転送が終わるまでは nullptr）
+	/// </summary>
+	ID3D12Resource* TextureLoader::GetResource(TextureHandle Handle) const
+	{
+		const Slot* slot = Find(Handle);
+		return slot != nullptr ? slot->Texture.Get() : nullptr;
+	}
+
+	/// <summary>
+	/// 1フレームにステージングへ書く上限（バイト）
+	/// </summary>
+	void TextureLoader::SetFrameUploadBudget(uint64_t Bytes)
+	{
+		mFrameUploadBudget = Bytes;
+	}
+
+	/// <summary>
+	/// 直近の Update の結果
+	/// </summary>
+	const TextureLoaderStats& TextureLoader::GetStats() const
+	{
+		return mStats;
+	}
+
+	/// <summary>
+	/// ファイルを読み込んで展開し、テクスチャとステージング上の配置まで作る（ワーカー）
+	/// </summary>
+	bool TextureLoader::Decode(ID3D12Device* Device, const std::filesystem::path& Path, DecodedTexture& Out)
+	{
+		System::MappedFile file;
+		if (file.Open(Path) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureLoader: Failed to open. {}", Path.string());
+			return false;
+		}
+		const std::span<const uint8_t> bytes = file.GetBytes();
+
+		std::wstring extension = Path.extension().wstring();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+
+		HRESULT hr = E_FAIL;
+		if (extension == L".dds")
+		{
+			hr = DirectX::LoadFromDDSMemory(bytes.data(), bytes.size(), DirectX::DDS_FLAGS_NONE, nullptr, Out.Image);
+		}
+		else if (extension == L".tga")
+		{
+			hr = DirectX::LoadFromTGAMemory(bytes.data(), bytes.size(), DirectX::TGA_FLAGS_NONE, nullptr, Out.Image);
+		}
+		else if (extension == L".hdr")
+		{
+			hr = DirectX::LoadFromHDRMemory(bytes.data(), bytes.size(), nullptr, Out.Image);
+		}
+		else
+		{
+			//	WIC は呼んだスレッドで COM が要る（ワーカーは初期化していない）
+			const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+			hr = DirectX::LoadFromWICMemory(bytes.data(), bytes.size(), DirectX::WIC_FLAGS_NONE, nullptr, Out.Image);
+			if (SUCCEEDED(com)) CoUninitialize();
+		}
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureLoader: Failed to decode. {} (0x{:08X})", Path.string(), static_cast<uint32_t>(hr));
+			return false;
+		}
+
+		//	圧縮されていない 2D でミップが無ければ作る
+		const DirectX::TexMetadata& metadata = Out.Image.GetMetadata();
+		if (metadata.mipLevels == 1 && metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE3D &&
+			DirectX::IsCompressed(metadata.format) == false && (metadata.width > 1 || metadata.height > 1))
+		{
+			DirectX::ScratchImage mipChain;
+			hr = DirectX::GenerateMipMaps(Out.Image.GetImages(), Out.Image.GetImageCount(), metadata, DirectX::TEX_FILTER_DEFAULT, 0, mipChain);
+			if (SUCCEEDED(hr))
+			{
+				Out.Image = std::move(mipChain);
+			}
+			else
+			{
+				ECSE_LOG(System::ELogLevel::Warning, "TextureLoader: Failed GenerateMipMaps. {}", Path.string());
+			}
+		}
+
+		if (Prepare(Device, Out) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureLoader: Failed to create texture. {}", Path.string());
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 展開済みの画像からテクスチャとステージング上の配置を作る（ワーカー）
+	/// デバイスはスレッドセーフなので、作成もワーカーで済ませてゲームスレッドの仕事を減らす。
+	/// </summary>
+	bool TextureLoader::Prepare(ID3D12Device* Device, DecodedTexture& Out)
+	{
+		const DirectX::TexMetadata& metadata = Out.Image.GetMetadata();
+
+		HRESULT hr = DirectX::PrepareUpload(Device, Out.Image.GetImages(), Out.Image.GetImageCount(), metadata, Out.Subresources);
+		if (FAILED(hr)) return false;
+
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		//	TEX_DIMENSION は D3D12_RESOURCE_DIMENSION と同じ値
+		const bool is3D = metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE3D;
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = static_cast<D3D12_RESOURCE_DIMENSION>(metadata.dimension);
+		desc.Width = metadata.width;
+		desc.Height = static_cast<UINT>(metadata.height);
+		desc.DepthOrArraySize = static_cast<UINT16>(is3D ? metadata.depth : metadata.arraySize);
+		desc.MipLevels = static_cast<UINT16>(metadata.mipLevels);
+		desc.Format = metadata.format;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		//	コピーキューの後は COMMON に戻り、直接キューで暗黙にシェーダーリソースへ移る
+		hr = Device->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&Out.Texture)
+		);
+		if (FAILED(hr)) return false;
+
+		const UINT count = static_cast<UINT>(Out.Subresources.size());
+		Out.Layouts.resize(count);
+		Out.RowCounts.resize(count);
+		Out.RowSizes.resize(count);
+		Device->GetCopyableFootprints(&desc, 0, count, 0, Out.Layouts.data(), Out.RowCounts.data(), Out.RowSizes.data(), &Out.TotalSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC& srv = Out.SrvDesc;
+		srv.Format = metadata.format;
+		srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		const UINT mipLevels = static_cast<UINT>(metadata.mipLevels);
+		const UINT arraySize = static_cast<UINT>(metadata.arraySize);
+		switch (metadata.dimension)
+		{
+		case DirectX::TEX_DIMENSION_TEXTURE1D:
+			if (arraySize > 1)
+			{
+				srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1DARRAY;
+				srv.Texture1DArray.MipLevels = mipLevels;
+				srv.Texture1DArray.ArraySize = arraySize;
+			}
+			else
+			{
+				srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1D;
+				srv.Texture1D.MipLevels = mipLevels;
+			}
+			break;
+		case DirectX::TEX_DIMENSION_TEXTURE3D:
+			srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+			srv.Texture3D.MipLevels = mipLevels;
+			break;
+		default:
+			if (metadata.IsCubemap() && arraySize > 6)
+			{
+				srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+				srv.TextureCubeArray.MipLevels = mipLevels;
+				srv.TextureCubeArray.NumCubes = arraySize / 6;
+			}
+			else if (metadata.IsCubemap())
+			{
+				srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+				srv.TextureCube.MipLevels = mipLevels;
+			}
+			else if (arraySize > 1)
+			{
+				srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+				srv.Texture2DArray.MipLevels = mipLevels;
+				srv.Texture2DArray.ArraySize = arraySize;
+			}
+			else
+			{
+				srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+				srv.Texture2D.MipLevels = mipLevels;
+			}
+			break;
+		}
+
+		Out.Succeeded = true;
+		return true;
+	}
+
+	/// <summary>
+	/// 市松模様のプレースホルダーを作って転送し、完了まで待つ（初期化の時だけ）
+	/// </summary>
+	bool TextureLoader::CreatePlaceholder()
+	{
+		DecodedTexture texture;
+		if (FAILED(texture.Image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, PLACEHOLDER_SIZE, PLACEHOLDER_SIZE, 1, 1))) return false;
+
+		//	マゼンタと黒
+		const DirectX::Image* image = texture.Image.GetImage(0, 0, 0);
+		for (uint32_t y = 0; y < PLACEHOLDER_SIZE; ++y)
+		{
+			uint32_t* row = reinterpret_cast<uint32_t*>(image->pixels + y * image->rowPitch);
+			for (uint32_t x = 0; x < PLACEHOLDER_SIZE; ++x)
+			{
+				row[x] = (((x / PLACEHOLDER_CELL) ^ (y / PLACEHOLDER_CELL)) & 1) != 0 ? 0xFFFF00FF : 0xFF000000;
+			}
+		}
+
+		if (Prepare(mDevice.Get(), texture) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreatePlaceholder (TextureLoader).");
+			return false;
+		}
+
+		if (mUploader.Begin() == false) return false;
+		const uint64_t offset = mUploader.AllocateStaging(texture.TotalSize);
+		if (offset == CopyUploader::INVALID_OFFSET) return false;
+
+		Record(texture, offset);
+
+		//	初期化の時だけは待つ。以降のテクスチャはこれが見えている間に届く
+		mUploader.Wait(mUploader.Submit());
+
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		mPlaceholderSrv = gdh->Issuance(1);
+		if (mPlaceholderSrv.IsValid() == false) return false;
+
+		mPlaceholder = std::move(texture.Texture);
+		mDevice->CreateShaderResourceView(mPlaceholder.Get(), &texture.SrvDesc, gdh->GetCpuHandle(mPlaceholderSrv));
+		return true;
+	}
+
+	/// <summary>
+	/// 完了した送信の反映
+	/// </summary>
+	void TextureLoader::Retire(uint64_t CompletedValue)
+	{
+		while (mInFlight.empty() == false && mInFlight.front().FenceValue <= CompletedValue)
+		{
+			//	コールバックの中で Load や Unload が呼ばれても良いように先に取り出す
+			Submission submission = std::move(mInFlight.front());
+			mInFlight.pop_front();
+
+			for (auto& texture : submission.Textures)
+			{
+				MakeResident(*texture);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 展開済みのものをステージングへ書いてコピーキューへ送る
+	/// </summary>
+	void TextureLoader::Submit()
+	{
+		if (mDecoded.empty()) return;
+
+		//	次のアロケーターがまだ転送中なら次のフレームへ
+		if (mUploader.Begin() == false) return;
+
+		Submission submission;
+		uint64_t written = 0;
+		while (mDecoded.empty() == false)
+		{
+			DecodedTexture& texture = *mDecoded.front();
+
+			//	送る前に手放された
+			if (Find(texture.Handle) == nullptr)
+			{
+				mDecoded.pop_front();
+				continue;
+			}
+
+			//	リング全体より大きいものはいつまでも入らない
+			if (texture.TotalSize > mUploader.GetStagingSize())
+			{
+				ECSE_LOG(System::ELogLevel::Error, "TextureLoader: Texture is larger than staging. size={} staging={}", texture.TotalSize, mUploader.GetStagingSize());
+				Fail(texture.Handle);
+				mDecoded.pop_front();
+				continue;
+			}
+
+			//	1枚目は必ず書いて、どれだけ大きくても進むようにする
+			if (written > 0 && written + texture.TotalSize > mFrameUploadBudget) break;
+
+			const uint64_t offset = mUploader.AllocateStaging(texture.TotalSize);
+			if (offset == CopyUploader::INVALID_OFFSET) break;
+
+			Record(texture, offset);
+			written += texture.TotalSize;
+
+			Find(texture.Handle)->State = ETextureState::Uploading;
+			submission.Textures.push_back(std::move(mDecoded.front()));
+			mDecoded.pop_front();
+		}
+
+		//	開いた記録は空でも閉じて送る（アロケーターを持ったままにしない）
+		submission.FenceValue = mUploader.Submit();
+		if (submission.Textures.empty()) return;
+
+		mInFlight.push_back(std::move(submission));
+
+		mStats.UploadedBytes = written;
+	}
+
+	/// <summary>
+	/// ステージングへ書いてコピーを記録する
+	/// </summary>
+	/// <param name="Texture">送るテクスチャ</param>
+	/// <param name="Offset">CopyUploader::AllocateStaging で切り出した位置</param>
+	void TextureLoader::Record(const DecodedTexture& Texture, uint64_t Offset)
+	{
+		const UINT count = static_cast<UINT>(Texture.Layouts.size());
+		for (UINT i = 0; i < count; ++i)
+		{
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = Texture.Layouts[i];
+			const D3D12_SUBRESOURCE_DATA& source = Texture.Subresources[i];
+			const UINT rowCount = Texture.RowCounts[i];
+			const uint64_t rowPitch = layout.Footprint.RowPitch;
+			uint8_t* destination = mUploader.GetStagingPointer(Offset + layout.Offset);
+
+			//	行ごとの詰め方が違うので1行ずつ
+			for (UINT z = 0; z < layout.Footprint.Depth; ++z)
+			{
+				const uint8_t* sourceSlice = static_cast<const uint8_t*>(source.pData) + z * source.SlicePitch;
+				uint8_t* destinationSlice = destination + z * rowPitch * rowCount;
+				for (UINT row = 0; row < rowCount; ++row)
+				{
+					std::memcpy(destinationSlice + row * rowPitch, sourceSlice + row * source.RowPitch, Texture.RowSizes[i]);
+				}
+			}
+
+			D3D12_TEXTURE_COPY_LOCATION src = {};
+			src.pResource = mUploader.GetStagingResource();
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint = layout;
+			src.PlacedFootprint.Offset += Offset;
+
+			D3D12_TEXTURE_COPY_LOCATION dst = {};
+			dst.pResource = Texture.Texture.Get();
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = i;
+
+			mUploader.GetCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+	}
+
+	/// <summary>
+	/// 転送の終わったテクスチャにディスクリプタを作って差し替える
+	/// 描画中のディスクリプタは書き換えず、新しく発行したものに向け直す
+	/// </summary>
+	void TextureLoader::MakeResident(DecodedTexture& Texture)
+	{
+		//	転送中に手放された。直接キューでは使っていないのでそのまま消して良い
+		Slot* slot = Find(Texture.Handle);
+		if (slot == nullptr) return;
+
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		GDescritorHeapInfo srv = gdh->Issuance(1);
+		if (srv.IsValid() == false)
+		{
+			Fail(Texture.Handle);
+			return;
+		}
+
+		mDevice->CreateShaderResourceView(Texture.Texture.Get(), &Texture.SrvDesc, gdh->GetCpuHandle(srv));
+		slot->Texture = std::move(Texture.Texture);
+		slot->Srv = srv;
+		slot->State = ETextureState::Resident;
+
+		const uint32_t index = Texture.Handle & SLOT_MASK;
+		mResolved[index].store(PackResolved(Texture.Handle, srv.Index), std::memory_order_release);
+
+		Callback callback = std::move(slot->OnLoaded);
+		slot->OnLoaded = nullptr;
+		if (callback) callback(Texture.Handle, true);
+	}
+
+	/// <summary>
+	/// 失敗として通知する
+	/// </summary>
+	void TextureLoader::Fail(TextureHandle Handle)
+	{
+		Slot* slot = Find(Handle);
+		if (slot == nullptr) return;
+
+		slot->State = ETextureState::Failed;
+
+		Callback callback = std::move(slot->OnLoaded);
+		slot->OnLoaded = nullptr;
+		if (callback) callback(Handle, false);
+	}
+
+	/// <summary>
+	/// ハンドルが指す、今も使われているスロット（古いハンドルなら nullptr）
+	/// </summary>
+	TextureLoader::Slot* TextureLoader::Find(TextureHandle Handle)
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		if (Handle == INVALID_TEXTURE_HANDLE || index >= mSlots.size()) return nullptr;
+
+		Slot& slot = mSlots[index];
+		if (slot.State == ETextureState::Invalid || slot.Generation != static_cast<uint16_t>(Handle >> SLOT_BITS)) return nullptr;
+		return &slot;
+	}
+
+	const TextureLoader::Slot* TextureLoader::Find(TextureHandle Handle) const
+	{
+		return const_cast<TextureLoader*>(this)->Find(Handle);
+	}
+}
@@ -0,0 +1,967 @@
+﻿#include "pch.h"
+#include<Graphics/Texture/TextureStreamer.hpp>
+#include<Graphics/DX12/DX12.hpp>
+#include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapManager.hpp>
+#include<System/Thread/RenderThread.hpp>
+
+#include<algorithm>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// 差し替えたディスクリプタや外したミップを返すまでのフレーム数
+		/// 描画スレッドが抱えているスナップショットと、GPU が処理中のフレームの分だけ待つ
+		/// </summary>
+		constexpr uint64_t RELEASE_DELAY = DX12::FRAME_COUNT + System::FRAME_SNAPSHOT_COUNT;
+
+		/// <summary>
+		/// 番号と世代の取り出し
+		/// </summary>
+		constexpr uint32_t SLOT_BITS = 16;
+		constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+		/// <summary>
+		/// DDS のヘッダー（マジック + DDS_HEADER）と DX10 拡張の大きさ、ピクセル形式の位置
+		/// </summary>
+		constexpr uint64_t DDS_HEADER_SIZE = 4 + 124;
+		constexpr uint64_t DDS_DX10_HEADER_SIZE = 20;
+		constexpr uint64_t DDS_PIXEL_FORMAT_FLAGS_OFFSET = 4 + 76;
+		constexpr uint64_t DDS_FOURCC_OFFSET = 4 + 80;
+		constexpr uint32_t DDS_PIXEL_FORMAT_FOURCC = 0x00000004;
+		constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844;
+
+		TextureHandle MakeHandle(uint32_t Index, uint16_t Generation)
+		{
+			return (static_cast<uint32_t>(Generation) << SLOT_BITS) | Index;
+		}
+
+		uint64_t PackResolved(TextureHandle Handle, int DescriptorIndex)
+		{
+			return (static_cast<uint64_t>(Handle) << 32) | static_cast<uint32_t>(DescriptorIndex);
+		}
+
+		/// <summary>
+		/// ファイルの情報から 2D テクスチャの設定を作る
+		/// </summary>
+		/// <param name="Metadata">ファイルの情報</param>
+		/// <param name="TopMip">一番上に置くミップ</param>
+		D3D12_RESOURCE_DESC MakeDesc(const DirectX::TexMetadata& Metadata, uint32_t TopMip)
+		{
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+			desc.Width = std::max<uint64_t>(Metadata.width >> TopMip, 1);
+			desc.Height = static_cast<UINT>(std::max<size_t>(Metadata.height >> TopMip, 1));
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = static_cast<UINT16>(Metadata.mipLevels - TopMip);
+			desc.Format = Metadata.format;
+			desc.SampleDesc.Count = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+			desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+			return desc;
+		}
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void TextureStreamer::OnCreate()
+	{
+		mDevice = nullptr;
+		mBudget = DEFAULT_BUDGET;
+		mFrameUploadBudget = DEFAULT_FRAME_UPLOAD_BUDGET;
+		mMipBias = 0;
+		mPlaceholderIndex = UINT32_MAX;
+		mUseReserved = false;
+		mFrame = 0;
+		mStats = {};
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// 直接キューの完了は呼ぶ側で待っておくこと
+	/// </summary>
+	void TextureStreamer::OnDestroy()
+	{
+		if (mIsInitialized == false) return;
+
+		//	コピーキューが書いている最中のものを消さない
+		mUploader.Wait(mUploader.GetLastFenceValue());
+		mOps.clear();
+		mPendingUnmaps.clear();
+
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		if (gdh != nullptr)
+		{
+			for (auto& pending : mPendingReleases)
+			{
+				gdh->Discard(pending.Srv);
+			}
+			for (auto& entry : mEntries)
+			{
+				gdh->Discard(entry.Srv);
+			}
+		}
+		mPendingReleases.clear();
+		mEntries.clear();
+		mFreeEntries.clear();
+		mResolved.reset();
+
+		mUploader.Release();
+		mDevice.Reset();
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// コピーキューとステージングの作成、タイルリソースの対応の確認
+	/// </summary>
+	/// <param name="Device">デバイス</param>
+	/// <param name="BudgetBytes">予算（バイト）</param>
+	/// <param name="StagingSize">ステージングリングの大きさ（バイト）</param>
+	/// <returns>true:成功</returns>
+	bool TextureStreamer::Initialize(ID3D12Device* Device, uint64_t BudgetBytes, uint64_t StagingSize)
+	{
+		if (mIsInitialized == true || Device == nullptr) return false;
+
+		mDevice = Device;
+		if (mUploader.Initialize(Device, StagingSize, L"TextureStreamer Copy Queue") == false) return false;
+
+		//	Tier 1 でも外したタイルを読まなければ良い（ResourceMinLODClamp で読ませない）
+		D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+		if (SUCCEEDED(Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))))
+		{
+			mUseReserved = options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_1;
+		}
+
+		mBudget = BudgetBytes;
+
+		mEntries.resize(MAX_TEXTURES);
+		mFreeEntries.resize(MAX_TEXTURES);
+		for (uint32_t i = 0; i < MAX_TEXTURES; ++i)
+		{
+			//	小さい番号から使うように後ろから積む
+			mFreeEntries[i] = static_cast<uint16_t>(MAX_TEXTURES - 1 - i);
+		}
+		mResolved = std::make_unique<std::atomic<uint64_t>[]>(MAX_TEXTURES);
+
+		//	最初の転送までは TextureLoader のプレースホルダーを見せる
+		if (auto* loader = System::ServiceLocator::Get<TextureLoader>())
+		{
+			mPlaceholderIndex = loader->GetPlaceholderIndex();
+		}
+
+		mIsInitialized = true;
+		ECSE_LOG(System::ELogLevel::Log, "TextureStreamer: Initialized. Reserved={} Budget={}MB", mUseReserved, mBudget / (1024 * 1024));
+		return true;
+	}
+
+	/// <summary>
+	/// テクスチャを登録する。常駐の末尾は次の Update から転送する
+	/// </summary>
+	/// <param name="Path">DDS ファイルの場所</param>
+	/// <returns>ハンドル（読めなければ INVALID_TEXTURE_HANDLE）</returns>
+	TextureHandle TextureStreamer::Register(const std::filesystem::path& Path)
+	{
+		if (mIsInitialized == false) return INVALID_TEXTURE_HANDLE;
+		if (mFreeEntries.empty())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureStreamer: Out of slots. {}", Path.string());
+			return INVALID_TEXTURE_HANDLE;
+		}
+
+		const uint32_t index = mFreeEntries.back();
+		Entry& entry = mEntries[index];
+		if (Parse(entry, Path) == false)
+		{
+			entry.File.reset();
+			return INVALID_TEXTURE_HANDLE;
+		}
+
+		//	タイルに並べられない形式もあるので、作れなければこのテクスチャだけ作り直す方へ
+		entry.Reserved = mUseReserved && CreateReserved(entry);
+		if (entry.Reserved == false)
+		{
+			SetupFallback(entry);
+		}
+
+		entry.Streaming.ResidentMip = entry.Streaming.MipCount;
+		entry.Streaming.RequestedMip = static_cast<uint8_t>(entry.Streaming.MipCount - 1);
+		entry.Streaming.LastUsedFrame = mFrame;
+		entry.PendingMip = NO_MIP;
+		entry.InUse = true;
+		mFreeEntries.pop_back();
+
+		const TextureHandle handle = MakeHandle(index, entry.Generation);
+		mResolved[index].store(PackResolved(handle, static_cast<int>(mPlaceholderIndex)), std::memory_order_release);
+		return handle;
+	}
+
+	/// <summary>
+	/// 登録を外す。GPU が使い終わるまで数フレーム遅らせて解放する
+	/// 転送中の読み込みは世代が変わるので、終わった時に捨てられる。
+	/// </summary>
+	void TextureStreamer::Unregister(TextureHandle Handle)
+	{
+		Entry* entry = Find(Handle);
+		if (entry == nullptr) return;
+
+		const uint32_t index = Handle & SLOT_MASK;
+		mResolved[index].store(PackResolved(INVALID_TEXTURE_HANDLE, static_cast<int>(mPlaceholderIndex)), std::memory_order_release);
+
+		//	描画とコピーキューの両方が使い終わってから返す
+		PendingRelease release;
+		release.Texture = std::move(entry->Texture);
+		for (auto& heap : entry->MipHeaps)
+		{
+			if (heap != nullptr) release.Heaps.push_back(std::move(heap));
+		}
+		release.Srv = entry->Srv;
+		release.Frame = mFrame + RELEASE_DELAY;
+		release.FenceValue = mUploader.GetLastFenceValue();
+		mPendingReleases.push_back(std::move(release));
+
+		const uint16_t generation = entry->Generation;
+		*entry = Entry();
+
+		//	0 にすると INVALID_TEXTURE_HANDLE と区別できなくなる
+		entry->Generation = static_cast<uint16_t>(generation + 1);
+		if (entry->Generation == 0) entry->Generation = 1;
+
+		mFreeEntries.push_back(static_cast<uint16_t>(index));
+	}
+
+	/// <summary>
+	/// このフレームで画面に映った面積を伝える（ゲームスレッド。何度呼んでも大きい方が残る）
+	/// </summary>
+	/// <param name="Handle">ハンドル</param>
+	/// <param name="ScreenPixels">画面上の面積（ピクセル数）</param>
+	void TextureStreamer::ReportUsage(TextureHandle Handle, float ScreenPixels)
+	{
+		Entry* entry = Find(Handle);
+		if (entry == nullptr) return;
+		entry->FrameScreenPixels = std::max(entry->FrameScreenPixels, ScreenPixels);
+	}
+
+	/// <summary>
+	/// 完了した転送の反映、予算の割り当て、読み込みと取り外し（ゲームスレッドでフレームに1回）
+	/// </summary>
+	void TextureStreamer::Update()
+	{
+		if (mIsInitialized == false) return;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		//	待たずに覗くだけ
+		const uint64_t completed = mUploader.Poll();
+		while (mOps.empty() == false && mOps.front().FenceValue <= completed)
+		{
+			StreamOp op = std::move(mOps.front());
+			mOps.pop_front();
+			Complete(op);
+		}
+
+		const bool unmapped = ProcessUnmaps();
+		ProcessReleases(completed);
+
+		//	このフレームの使われ方から欲しいミップを求める
+		mPolicyInputs.clear();
+		mPolicyEntries.clear();
+		for (uint32_t i = 0; i < MAX_TEXTURES; ++i)
+		{
+			Entry& entry = mEntries[i];
+			if (entry.InUse == false) continue;
+
+			StreamingTexture& streaming = entry.Streaming;
+			const float pixels = entry.FrameScreenPixels;
+			streaming.RequestedMip = TextureStreamingPolicy::ComputeRequiredMip(
+				static_cast<uint32_t>(entry.Metadata.width), static_cast<uint32_t>(entry.Metadata.height), streaming.MipCount, pixels, mMipBias);
+			streaming.Priority = pixels;
+			if (pixels > 0.0f) streaming.LastUsedFrame = mFrame;
+			entry.FrameScreenPixels = 0.0f;
+
+			mPolicyInputs.push_back(streaming);
+			mPolicyEntries.push_back(i);
+		}
+
+		const uint32_t count = static_cast<uint32_t>(mPolicyInputs.size());
+		mPolicyTargets.resize(count);
+		mStats.Budget = mPolicy.Resolve(mPolicyInputs, mBudget, mPolicyTargets);
+
+		//	画面上の面積が大きい順に反映する（1フレームの上限で切れても大きいものが先に届く）
+		std::vector<uint32_t> order(count);
+		for (uint32_t i = 0; i < count; ++i) order[i] = i;
+		std::sort(order.begin(), order.end(), [this](uint32_t A, uint32_t B)
+			{
+				if (mPolicyInputs[A].Priority != mPolicyInputs[B].Priority) return mPolicyInputs[A].Priority > mPolicyInputs[B].Priority;
+				return A < B;
+			});
+
+		std::vector<StreamOp> ops;
+		uint64_t written = 0;
+		bool canUpload = true;
+		for (const uint32_t k : order)
+		{
+			const uint32_t index = mPolicyEntries[k];
+			Entry& entry = mEntries[index];
+			const uint8_t target = mPolicyTargets[k];
+			const uint8_t resident = entry.Streaming.ResidentMip;
+			if (entry.PendingMip != NO_MIP || target == resident) continue;
+
+			const TextureHandle handle = MakeHandle(index, entry.Generation);
+
+			//	外すのは転送が要らないので上限に関わらずすぐ
+			if (entry.Reserved == true && target > resident)
+			{
+				EvictReserved(entry, handle, target);
+				continue;
+			}
+
+			if (canUpload == false) continue;
+			if (written > 0 && written >= mFrameUploadBudget)
+			{
+				canUpload = false;
+				continue;
+			}
+			if (mUploader.Begin() == false)
+			{
+				canUpload = false;
+				continue;
+			}
+
+			if (entry.Reserved == true)
+			{
+				//	外している途中のミップを割り当て直さない
+				if (entry.PendingUnmaps > 0) continue;
+				canUpload = StreamInReserved(entry, handle, target, ops, written);
+			}
+			else
+			{
+				canUpload = Rebuild(entry, handle, target, ops, written);
+			}
+		}
+
+		if (mUploader.IsRecording() == true || unmapped == true)
+		{
+			const uint64_t fenceValue = mUploader.Submit();
+			for (auto& op : ops)
+			{
+				op.FenceValue = fenceValue;
+				mOps.push_back(std::move(op));
+			}
+		}
+
+		mStats.Textures = count;
+		mStats.Streaming = static_cast<uint32_t>(mOps.size());
+		mStats.UploadedBytes = written;
+		mStats.ResidentBytes = 0;
+		for (const auto& input : mPolicyInputs)
+		{
+			mStats.ResidentBytes += TextureStreamingPolicy::ComputeResidentBytes(input, input.ResidentMip);
+		}
+		mStats.UsesReservedResources = mUseReserved;
+
+		mFrame++;
+		mStats.ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// 予算（バイト）
+	/// </summary>
+	void TextureStreamer::SetBudget(uint64_t Bytes)
+	{
+		mBudget = Bytes;
+	}
+
+	/// <summary>
+	/// 予算（バイト）
+	/// </summary>
+	uint64_t TextureStreamer::GetBudget() const
+	{
+		return mBudget;
+	}
+
+	/// <summary>
+	/// 欲しいミップをずらす段数（正で粗く）
+	/// </summary>
+	void TextureStreamer::SetMipBias(int32_t Bias)
+	{
+		mMipBias = Bias;
+	}
+
+	/// <summary>
+	/// 1フレームにステージングへ書く上限（バイト）
+	/// </summary>
+	void TextureStreamer::SetFrameUploadBudget(uint64_t Bytes)
+	{
+		mFrameUploadBudget = Bytes;
+	}
+
+	/// <summary>
+	/// シェーダーから読むディスクリプタ（最初の転送が終わるまではプレースホルダー）
+	/// 解決済みの値を読むだけなので描画スレッドからも呼べる。
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE TextureStreamer::GetGpuHandle(TextureHandle Handle) const
+	{
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		const uint32_t index = GetDescriptorIndex(Handle);
+		if (gdh == nullptr || index == UINT32_MAX) return { 0 };
+
+		GDescritorHeapInfo info = {};
+		info.Index = static_cast<int>(index);
+		info.Size = 1;
+		return gdh->GetGpuHandle(info);
+	}
+
+	/// <summary>
+	/// ヒープの先頭からのディスクリプタの番号（バインドレス用）
+	/// </summary>
+	uint32_t TextureStreamer::GetDescriptorIndex(TextureHandle Handle) const
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		if (mResolved == nullptr || index >= MAX_TEXTURES) return mPlaceholderIndex;
+
+		//	古いハンドルなら上位が一致しない
+		const uint64_t resolved = mResolved[index].load(std::memory_order_acquire);
+		if (static_cast<TextureHandle>(resolved >> 32) != Handle) return mPlaceholderIndex;
+		return static_cast<uint32_t>(resolved);
+	}
+
+	/// <summary>
+	/// 今置いてある一番細かいミップ（何も置いていなければミップの数）
+	/// </summary>
+	uint32_t TextureStreamer::GetResidentMip(TextureHandle Handle) const
+	{
+		const Entry* entry = Find(Handle);
+		return entry != nullptr ? entry->Streaming.ResidentMip : 0;
+	}
+
+	/// <summary>
+	/// 予約リソース（タイル）を使っているか
+	/// </summary>
+	bool TextureStreamer::IsUsingReservedResources() const
+	{
+		return mUseReserved;
+	}
+
+	/// <summary>
+	/// 直近の Update の結果
+	/// </summary>
+	const TextureStreamerStats& TextureStreamer::GetStats() const
+	{
+		return mStats;
+	}
+
+	/// <summary>
+	/// DDS を読んでミップの位置と予算の情報を作る
+	/// </summary>
+	bool TextureStreamer::Parse(Entry& Target, const std::filesystem::path& Path)
+	{
+		auto file = std::make_unique<System::MappedFile>();
+		if (file->Open(Path) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureStreamer: Failed to open. {}", Path.string());
+			return false;
+		}
+		const std::span<const uint8_t> bytes = file->GetBytes();
+
+		DirectX::TexMetadata metadata = {};
+		HRESULT hr = DirectX::GetMetadataFromDDSMemory(bytes.data(), bytes.size(), DirectX::DDS_FLAGS_NONE, metadata);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureStreamer: Not a DDS file. {}", Path.string());
+			return false;
+		}
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1 || metadata.IsCubemap() ||
+			metadata.mipLevels == 0 || metadata.mipLevels > StreamingTexture::MAX_MIPS)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureStreamer: Only single 2D textures can be streamed. {}", Path.string());
+			return false;
+		}
+
+		//	ミップは DX10 拡張があればその後ろから、大きい順に隙間なく並ぶ
+		uint32_t flags = 0;
+		uint32_t fourCC = 0;
+		std::memcpy(&flags, bytes.data() + DDS_PIXEL_FORMAT_FLAGS_OFFSET, sizeof(flags));
+		std::memcpy(&fourCC, bytes.data() + DDS_FOURCC_OFFSET, sizeof(fourCC));
+		uint64_t offset = DDS_HEADER_SIZE;
+		if ((flags & DDS_PIXEL_FORMAT_FOURCC) != 0 && fourCC == DDS_FOURCC_DX10)
+		{
+			offset += DDS_DX10_HEADER_SIZE;
+		}
+
+		for (uint32_t mip = 0; mip < metadata.mipLevels; ++mip)
+		{
+			size_t rowPitch = 0;
+			size_t slicePitch = 0;
+			hr = DirectX::ComputePitch(metadata.format, std::max<size_t>(metadata.width >> mip, 1), std::max<size_t>(metadata.height >> mip, 1), rowPitch, slicePitch);
+			if (FAILED(hr)) return false;
+
+			Target.Mips[mip] = { offset, rowPitch, slicePitch };
+			offset += slicePitch;
+		}
+
+		//	読み込み時に変換が要る古い形式は並びが合わない
+		if (offset > bytes.size())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "TextureStreamer: Legacy DDS layout needs conversion. Re-cook it. {}", Path.string());
+			return false;
+		}
+
+		file->Prefetch();
+		Target.File = std::move(file);
+		Target.Metadata = metadata;
+		Target.Streaming = {};
+		Target.Streaming.MipCount = static_cast<uint8_t>(metadata.mipLevels);
+		return true;
+	}
+
+	/// <summary>
+	/// 予約リソースを作り、タイルの数と予算の情報を埋める
+	/// </summary>
+	bool TextureStreamer::CreateReserved(Entry& Target)
+	{
+		D3D12_RESOURCE_DESC desc = MakeDesc(Target.Metadata, 0);
+		desc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+
+		HRESULT hr = mDevice->CreateReservedResource(&desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&Target.Texture));
+		if (FAILED(hr)) return false;
+
+		UINT tileCount = 0;
+		D3D12_PACKED_MIP_INFO packed = {};
+		D3D12_TILE_SHAPE shape = {};
+		UINT subresourceCount = Target.Streaming.MipCount;
+		std::array<D3D12_SUBRESOURCE_TILING, StreamingTexture::MAX_MIPS> tilings = {};
+		mDevice->GetResourceTiling(Target.Texture.Get(), &tileCount, &packed, &shape, &subresourceCount, 0, tilings.data());
+
+		const uint32_t mipCount = Target.Streaming.MipCount;
+		Target.PackedMip = static_cast<uint8_t>(packed.NumPackedMips > 0 ? packed.NumStandardMips : mipCount);
+		for (uint32_t mip = 0; mip < std::min<uint32_t>(Target.PackedMip, mipCount); ++mip)
+		{
+			Target.MipTiles[mip] = tilings[mip].WidthInTiles * tilings[mip].HeightInTiles * tilings[mip].DepthInTiles;
+		}
+		if (Target.PackedMip < mipCount)
+		{
+			Target.MipTiles[Target.PackedMip] = packed.NumTilesForPackedMips;
+		}
+
+		//	末尾（まとめられたミップ）は外せないので常に置く
+		Target.Streaming.MinResidentMip = static_cast<uint8_t>(std::min<uint32_t>(Target.PackedMip, mipCount - 1));
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			Target.Streaming.MipBytes[mip] = static_cast<uint64_t>(Target.MipTiles[mip]) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 作り直す時の予算の情報を埋める
+	/// </summary>
+	void TextureStreamer::SetupFallback(Entry& Target)
+	{
+		Target.Texture.Reset();
+		Target.PackedMip = Target.Streaming.MipCount;
+
+		const uint32_t mipCount = Target.Streaming.MipCount;
+		const D3D12_RESOURCE_DESC desc = MakeDesc(Target.Metadata, 0);
+		std::array<D3D12_PLACED_SUBRESOURCE_FOOTPRINT, StreamingTexture::MAX_MIPS> layouts = {};
+		uint64_t total = 0;
+		mDevice->GetCopyableFootprints(&desc, 0, mipCount, 0, layouts.data(), nullptr, nullptr, &total);
+
+		//	一辺が FALLBACK_RESIDENT_SIZE 以下になるミップから下は常に置く
+		uint32_t minResident = mipCount - 1;
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			const uint64_t width = std::max<uint64_t>(Target.Metadata.width >> mip, 1);
+			const uint64_t height = std::max<uint64_t>(Target.Metadata.height >> mip, 1);
+			if (std::max(width, height) <= FALLBACK_RESIDENT_SIZE)
+			{
+				minResident = mip;
+				break;
+			}
+		}
+
+		//	圧縮形式は一番上の大きさが4の倍数でないと作れないので、作れない段があればストリーミングしない
+		if (DirectX::IsCompressed(Target.Metadata.format))
+		{
+			for (uint32_t mip = 0; mip <= minResident; ++mip)
+			{
+				const uint64_t width = std::max<uint64_t>(Target.Metadata.width >> mip, 1);
+				const uint64_t height = std::max<uint64_t>(Target.Metadata.height >> mip, 1);
+				if (width % 4 != 0 || height % 4 != 0)
+				{
+					minResident = 0;
+					break;
+				}
+			}
+		}
+
+		Target.Streaming.MinResidentMip = static_cast<uint8_t>(minResident);
+		Target.Streaming.MipBytes = {};
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			const uint64_t end = mip + 1 < mipCount ? layouts[mip + 1].Offset : total;
+			const uint64_t bytes = end - layouts[mip].Offset;
+
+			//	末尾はまとめて先頭の番号に入れる
+			Target.Streaming.MipBytes[std::min(mip, minResident)] += bytes;
+		}
+	}
+
+	/// <summary>
+	/// 細かくする（予約リソース）。入った所までを StreamOp にする
+	/// </summary>
+	bool TextureStreamer::StreamInReserved(Entry& Target, TextureHandle Handle, uint8_t TargetMip, std::vector<StreamOp>& OutOps, uint64_t& InOutBytes)
+	{
+		const uint32_t mipCount = Target.Streaming.MipCount;
+		const uint32_t minResident = Target.Streaming.MinResidentMip;
+		uint32_t achieved = Target.Streaming.ResidentMip;
+
+		//	まだ何も置いていなければ、末尾をまとめて
+		if (achieved >= mipCount)
+		{
+			for (uint32_t mip = minResident; mip < mipCount; ++mip)
+			{
+				if (MapMip(Target, mip) == false) return false;
+			}
+			const uint64_t bytes = CopyMips(Target, Target.Texture.Get(), minResident, minResident, mipCount - minResident);
+			if (bytes == 0) return false;
+			InOutBytes += bytes;
+			achieved = minResident;
+		}
+
+		//	1段ずつ割り当ててコピーする。ステージングか1フレームの上限で止まったらそこまで
+		bool canContinue = true;
+		while (achieved > TargetMip)
+		{
+			if (InOutBytes >= mFrameUploadBudget && achieved != Target.Streaming.ResidentMip) break;
+
+			const uint32_t mip = achieved - 1;
+			if (MapMip(Target, mip) == false)
+			{
+				canContinue = false;
+				break;
+			}
+			const uint64_t bytes = CopyMips(Target, Target.Texture.Get(), mip, mip, 1);
+			if (bytes == 0)
+			{
+				canContinue = false;
+				break;
+			}
+			InOutBytes += bytes;
+			achieved = mip;
+		}
+
+		if (achieved >= Target.Streaming.ResidentMip) return false;
+
+		StreamOp op;
+		op.Handle = Handle;
+		op.TargetMip = static_cast<uint8_t>(achieved);
+		OutOps.push_back(std::move(op));
+		Target.PendingMip = static_cast<uint8_t>(achieved);
+		return canContinue;
+	}
+
+	/// <summary>
+	/// 置く範囲を変えて作り直す（予約リソースが使えない時）
+	/// 置いてあるミップも含めて、割り当てたファイルから全て写し直す。
+	/// </summary>
+	bool TextureStreamer::Rebuild(Entry& Target, TextureHandle Handle, uint8_t TargetMip, std::vector<StreamOp>& OutOps, uint64_t& InOutBytes)
+	{
+		const uint32_t mipCount = Target.Streaming.MipCount;
+		const D3D12_RESOURCE_DESC desc = MakeDesc(Target.Metadata, TargetMip);
+
+		D3D12_HEAP_PROPERTIES heapProp = {};
+		heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		Resource texture;
+		const HRESULT hr = mDevice->CreateCommittedResource(
+			&heapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&texture)
+		);
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateCommittedResource (TextureStreamer).");
+			return true;
+		}
+
+		const uint64_t bytes = CopyMips(Target, texture.Get(), TargetMip, 0, mipCount - TargetMip);
+		if (bytes == 0) return false;
+		InOutBytes += bytes;
+
+		StreamOp op;
+		op.Handle = Handle;
+		op.TargetMip = TargetMip;
+		op.Texture = std::move(texture);
+		OutOps.push_back(std::move(op));
+		Target.PendingMip = TargetMip;
+		return true;
+	}
+
+	/// <summary>
+	/// 粗くする（予約リソース）。すぐに差し替え、割り当ては数フレーム後に外す
+	/// </summary>
+	void TextureStreamer::EvictReserved(Entry& Target, TextureHandle Handle, uint8_t TargetMip)
+	{
+		const uint8_t resident = Target.Streaming.ResidentMip;
+		UpdateView(Target, Handle, TargetMip);
+		Target.Streaming.ResidentMip = TargetMip;
+
+		PendingUnmap unmap;
+		unmap.Handle = Handle;
+		unmap.Begin = resident;
+		unmap.End = TargetMip;
+		unmap.Frame = mFrame + RELEASE_DELAY;
+		mPendingUnmaps.push_back(unmap);
+		Target.PendingUnmaps++;
+	}
+
+	/// <summary>
+	/// ミップにヒープを割り当てる（末尾ならまとめて）
+	/// キューに積むので、同じキューで後から送るコピーより先に割り当たる。
+	/// </summary>
+	bool TextureStreamer::MapMip(Entry& Target, uint32_t Mip)
+	{
+		const uint32_t slot = std::min<uint32_t>(Mip, Target.PackedMip);
+		if (Target.MipHeaps[slot] != nullptr) return true;
+
+		UINT tiles = Target.MipTiles[slot];
+		if (tiles == 0) return true;
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = static_cast<uint64_t>(tiles) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+		heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES;
+
+		const HRESULT hr = mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&Target.MipHeaps[slot]));
+		if (FAILED(hr))
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateHeap (TextureStreamer).");
+			return false;
+		}
+
+		D3D12_TILED_RESOURCE_COORDINATE coordinate = {};
+		coordinate.Subresource = slot;
+		D3D12_TILE_REGION_SIZE region = {};
+		region.NumTiles = tiles;
+		region.UseBox = FALSE;
+		const D3D12_TILE_RANGE_FLAGS rangeFlags = D3D12_TILE_RANGE_FLAG_NONE;
+		const UINT heapOffset = 0;
+
+		mUploader.GetQueue()->UpdateTileMappings(
+			Target.Texture.Get(), 1, &coordinate, &region,
+			Target.MipHeaps[slot].Get(), 1, &rangeFlags, &heapOffset, &tiles,
+			D3D12_TILE_MAPPING_FLAG_NONE);
+		return true;
+	}
+
+	/// <summary>
+	/// ファイルの続いたミップをまとめてステージングへ写し、コピーを記録する
+	/// 全て入るか何もしないかのどちらか。
+	/// </summary>
+	/// <param name="Target">テクスチャ</param>
+	/// <param name="Destination">コピー先</param>
+	/// <param name="FirstMip">ファイルの最初のミップ</param>
+	/// <param name="FirstSubresource">コピー先の最初のサブリソース</param>
+	/// <param name="Count">ミップの数</param>
+	/// <returns>書いた大きさ（入らなければ 0）</returns>
+	uint64_t TextureStreamer::CopyMips(const Entry& Target, ID3D12Resource* Destination, uint32_t FirstMip, uint32_t FirstSubresource, uint32_t Count)
+	{
+		const D3D12_RESOURCE_DESC desc = Destination->GetDesc();
+		std::array<D3D12_PLACED_SUBRESOURCE_FOOTPRINT, StreamingTexture::MAX_MIPS> layouts = {};
+		std::array<UINT, StreamingTexture::MAX_MIPS> rowCounts = {};
+		std::array<UINT64, StreamingTexture::MAX_MIPS> rowSizes = {};
+		uint64_t total = 0;
+		mDevice->GetCopyableFootprints(&desc, FirstSubresource, Count, 0, layouts.data(), rowCounts.data(), rowSizes.data(), &total);
+
+		const uint64_t offset = mUploader.AllocateStaging(total);
+		if (offset == CopyUploader::INVALID_OFFSET) return 0;
+
+		const uint8_t* file = Target.File->GetBytes().data();
+		ID3D12GraphicsCommandList* cmdList = mUploader.GetCommandList();
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts[i];
+			const MipSource& source = Target.Mips[FirstMip + i];
+			const uint8_t* src = file + source.Offset;
+			uint8_t* dst = mUploader.GetStagingPointer(offset + layout.Offset);
+
+			//	割り当てたファイルからそのまま。行の詰め方が違うので1行ずつ
+			const uint64_t rowSize = std::min<uint64_t>(rowSizes[i], source.RowPitch);
+			for (UINT row = 0; row < rowCounts[i]; ++row)
+			{
+				std::memcpy(dst + row * layout.Footprint.RowPitch, src + row * source.RowPitch, rowSize);
+			}
+
+			D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+			srcLocation.pResource = mUploader.GetStagingResource();
+			srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			srcLocation.PlacedFootprint = layout;
+			srcLocation.PlacedFootprint.Offset += offset;
+
+			D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+			dstLocation.pResource = Destination;
+			dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dstLocation.SubresourceIndex = FirstSubresource + i;
+
+			cmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+		}
+		return total;
+	}
+
+	/// <summary>
+	/// 完了した読み込みの反映
+	/// </summary>
+	void TextureStreamer::Complete(StreamOp& Op)
+	{
+		//	転送中に登録を外された。作り直したテクスチャは直接キューで使っていないのでそのまま消して良い
+		Entry* entry = Find(Op.Handle);
+		if (entry == nullptr) return;
+
+		entry->PendingMip = NO_MIP;
+		if (entry->Reserved == false)
+		{
+			if (entry->Texture != nullptr)
+			{
+				PendingRelease release;
+				release.Texture = std::move(entry->Texture);
+				release.Frame = mFrame + RELEASE_DELAY;
+				mPendingReleases.push_back(std::move(release));
+			}
+			entry->Texture = std::move(Op.Texture);
+		}
+
+		entry->Streaming.ResidentMip = Op.TargetMip;
+		UpdateView(*entry, Op.Handle, Op.TargetMip);
+	}
+
+	/// <summary>
+	/// 新しいディスクリプタを作って差し替え、古いものは遅らせて返す
+	/// 描画中のディスクリプタは書き換えない
+	/// </summary>
+	void TextureStreamer::UpdateView(Entry& Target, TextureHandle Handle, uint8_t ResidentMip)
+	{
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		GDescritorHeapInfo srv = gdh->Issuance(1);
+		if (srv.IsValid() == false) return;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+		desc.Format = Target.Metadata.format;
+		desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		desc.Texture2D.MostDetailedMip = 0;
+		if (Target.Reserved == true)
+		{
+			//	置いていないミップはサンプラーに読ませない
+			desc.Texture2D.MipLevels = Target.Streaming.MipCount;
+			desc.Texture2D.ResourceMinLODClamp = static_cast<float>(ResidentMip);
+		}
+		else
+		{
+			desc.Texture2D.MipLevels = Target.Texture->GetDesc().MipLevels;
+		}
+		mDevice->CreateShaderResourceView(Target.Texture.Get(), &desc, gdh->GetCpuHandle(srv));
+
+		if (Target.Srv.IsValid())
+		{
+			PendingRelease release;
+			release.Srv = Target.Srv;
+			release.Frame = mFrame + RELEASE_DELAY;
+			mPendingReleases.push_back(std::move(release));
+		}
+		Target.Srv = srv;
+
+		const uint32_t index = Handle & SLOT_MASK;
+		mResolved[index].store(PackResolved(Handle, srv.Index), std::memory_order_release);
+	}
+
+	/// <summary>
+	/// 遅らせて外す割り当ての処理
+	/// </summary>
+	/// <returns>キューに割り当ての変更を積んだか（積んだらフェンスを進める）</returns>
+	bool TextureStreamer::ProcessUnmaps()
+	{
+		bool queued = false;
+		std::erase_if(mPendingUnmaps, [this, &queued](const PendingUnmap& Unmap)
+			{
+				if (Unmap.Frame > mFrame) return false;
+
+				//	登録を外されていればヒープごと返しているので何もしない
+				Entry* entry = Find(Unmap.Handle);
+				if (entry == nullptr) return true;
+				entry->PendingUnmaps--;
+
+				//	ヒープはキューが割り当てを外し終わってから返す（この後の Submit で進む値）
+				PendingRelease release;
+				release.Frame = mFrame;
+				release.FenceValue = mUploader.GetLastFenceValue() + 1;
+				for (uint32_t mip = Unmap.Begin; mip < Unmap.End; ++mip)
+				{
+					if (entry->MipHeaps[mip] == nullptr) continue;
+
+					D3D12_TILED_RESOURCE_COORDINATE coordinate = {};
+					coordinate.Subresource = mip;
+					D3D12_TILE_REGION_SIZE region = {};
+					region.NumTiles = entry->MipTiles[mip];
+					region.UseBox = FALSE;
+					const D3D12_TILE_RANGE_FLAGS rangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+					const UINT heapOffset = 0;
+					const UINT tiles = entry->MipTiles[mip];
+
+					mUploader.GetQueue()->UpdateTileMappings(
+						entry->Texture.Get(), 1, &coordinate, &region,
+						nullptr, 1, &rangeFlags, &heapOffset, &tiles,
+						D3D12_TILE_MAPPING_FLAG_NONE);
+					release.Heaps.push_back(std::move(entry->MipHeaps[mip]));
+				}
+
+				if (release.Heaps.empty() == false)
+				{
+					mPendingReleases.push_back(std::move(release));
+					queued = true;
+				}
+				return true;
+			});
+		return queued;
+	}
+
+	/// <summary>
+	/// 遅らせて解放するものの処理
+	/// </summary>
+	void TextureStreamer::ProcessReleases(uint64_t CompletedValue)
+	{
+		auto gdh = System::ServiceLocator::Get<GDescriptorHeapManager>();
+		std::erase_if(mPendingReleases, [this, gdh, CompletedValue](PendingRelease& Release)
+			{
+				if (Release.Frame > mFrame || Release.FenceValue > CompletedValue) return false;
+				gdh->Discard(Release.Srv);
+				return true;
+			});
+	}
+
+	/// <summary>
+	/// ハンドルが指す、今も使われているものの管理情報（古いハンドルなら nullptr）
+	/// </summary>
+	TextureStreamer::Entry* TextureStreamer::Find(TextureHandle Handle)
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		if (Handle == INVALID_TEXTURE_HANDLE || index >= mEntries.size()) return nullptr;
+
+		Entry& entry = mEntries[index];
+		if (entry.InUse == false || entry.Generation != static_cast<uint16_t>(Handle >> SLOT_BITS)) return nullptr;
+		return &entry;
+	}
+
+	const TextureStreamer::Entry* TextureStreamer::Find(TextureHandle Handle) const
+	{
+		return const_cast<TextureStreamer*>(this)->Find(Handle);
+	}
+}
@@ -0,0 +1,170 @@
+﻿#include "pch.h"
+#include<Graphics/Texture/TextureStreamingPolicy.hpp>
+
+#include<algorithm>
+#include<cmath>
+
+namespace Ecse::Graphics
+{
+	namespace
+	{
+		/// <summary>
+		/// ミップの数を MAX_MIPS に収める
+		/// </summary>
+		uint32_t ClampMipCount(const StreamingTexture& Texture)
+		{
+			return std::min<uint32_t>(Texture.MipCount, StreamingTexture::MAX_MIPS);
+		}
+
+		/// <summary>
+		/// 常駐の末尾より粗くならないようにする
+		/// </summary>
+		uint8_t ClampMip(const StreamingTexture& Texture, uint32_t Mip)
+		{
+			const uint32_t count = ClampMipCount(Texture);
+			if (count == 0) return 0;
+			const uint32_t minResident = std::min<uint32_t>(Texture.MinResidentMip, count - 1);
+			return static_cast<uint8_t>(std::min(Mip, minResident));
+		}
+	}
+
+	/// <summary>
+	/// 画面上の面積から欲しいミップ
+	/// テクセル数が画面上のピクセル数に並ぶ一番粗いミップを選ぶ（1段下がるとテクセル数は 1/4）。
+	/// </summary>
+	/// <param name="Width">テクスチャの幅</param>
+	/// <param name="Height">テクスチャの高さ</param>
+	/// <param name="MipCount">ミップの数</param>
+	/// <param name="ScreenPixels">画面上の面積（ピクセル数、0 以下なら映っていない）</param>
+	/// <param name="Bias">ずらす段数（正で粗く）</param>
+	/// <returns>欲しいミップ</returns>
+	uint8_t TextureStreamingPolicy::ComputeRequiredMip(uint32_t Width, uint32_t Height, uint32_t MipCount, float ScreenPixels, int32_t Bias)
+	{
+		if (MipCount == 0) return 0;
+		const int32_t coarsest = static_cast<int32_t>(MipCount) - 1;
+
+		//	映っていなければ一番粗いもので良い
+		if (ScreenPixels <= 0.0f) return static_cast<uint8_t>(coarsest);
+
+		//	texels / 4^m >= pixels となる一番大きい m（画面のピクセルより粗くならない範囲で一番粗いミップ）
+		const double texels = static_cast<double>(Width) * static_cast<double>(Height);
+		const double ratio = texels / static_cast<double>(ScreenPixels);
+		int32_t mip = ratio > 1.0 ? static_cast<int32_t>(std::floor(0.5 * std::log2(ratio))) : 0;
+
+		mip += Bias;
+		return static_cast<uint8_t>(std::clamp(mip, 0, coarsest));
+	}
+
+	/// <summary>
+	/// ミップ Mip まで置いた時の大きさ
+	/// </summary>
+	uint64_t TextureStreamingPolicy::ComputeResidentBytes(const StreamingTexture& Texture, uint32_t Mip)
+	{
+		const uint32_t count = ClampMipCount(Texture);
+		uint64_t bytes = 0;
+		for (uint32_t i = Mip; i < count; ++i)
+		{
+			bytes += Texture.MipBytes[i];
+		}
+		return bytes;
+	}
+
+	/// <summary>
+	/// 予算の中でどこまで置くかを決める
+	/// </summary>
+	/// <param name="Textures">全てのテクスチャ</param>
+	/// <param name="BudgetBytes">予算（バイト）</param>
+	/// <param name="OutTargets">テクスチャごとに置く一番細かいミップ（Textures と同じ数）</param>
+	/// <returns>結果</returns>
+	StreamingBudgetStats TextureStreamingPolicy::Resolve(std::span<const StreamingTexture> Textures, uint64_t BudgetBytes, std::span<uint8_t> OutTargets)
+	{
+		StreamingBudgetStats stats;
+		stats.BudgetBytes = BudgetBytes;
+
+		const uint32_t count = static_cast<uint32_t>(std::min(Textures.size(), OutTargets.size()));
+
+		//	1. 常駐の末尾は予算に関わらず置く
+		uint64_t used = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const StreamingTexture& texture = Textures[i];
+			OutTargets[i] = ClampMip(texture, texture.MinResidentMip);
+			used += ComputeResidentBytes(texture, OutTargets[i]);
+			stats.RequestedBytes += ComputeResidentBytes(texture, ClampMip(texture, texture.RequestedMip));
+		}
+		stats.MandatoryBytes = used;
+
+		//	2. 画面上の面積が大きい順に、欲しいミップまで細かくする
+		mOrder.clear();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (ClampMip(Textures[i], Textures[i].RequestedMip) < OutTargets[i])
+			{
+				mOrder.push_back(i);
+			}
+		}
+		std::sort(mOrder.begin(), mOrder.end(), [&Textures](uint32_t A, uint32_t B)
+			{
+				if (Textures[A].Priority != Textures[B].Priority) return Textures[A].Priority > Textures[B].Priority;
+				return A < B;
+			});
+
+		for (const uint32_t index : mOrder)
+		{
+			const StreamingTexture& texture = Textures[index];
+			const uint8_t requested = ClampMip(texture, texture.RequestedMip);
+			while (OutTargets[index] > requested)
+			{
+				const uint64_t extra = texture.MipBytes[OutTargets[index] - 1];
+				if (used + extra > BudgetBytes) break;
+				used += extra;
+				OutTargets[index]--;
+			}
+			if (OutTargets[index] > requested)
+			{
+				stats.Starved++;
+			}
+		}
+
+		//	3. 余った予算で、置いてあるが欲しくはないミップを最近映った順に残す
+		mOrder.clear();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (Textures[i].ResidentMip < OutTargets[i])
+			{
+				mOrder.push_back(i);
+			}
+		}
+		std::sort(mOrder.begin(), mOrder.end(), [&Textures](uint32_t A, uint32_t B)
+			{
+				if (Textures[A].LastUsedFrame != Textures[B].LastUsedFrame) return Textures[A].LastUsedFrame > Textures[B].LastUsedFrame;
+				if (Textures[A].Priority != Textures[B].Priority) return Textures[A].Priority > Textures[B].Priority;
+				return A < B;
+			});
+
+		for (const uint32_t index : mOrder)
+		{
+			const StreamingTexture& texture = Textures[index];
+			const uint8_t before = OutTargets[index];
+			while (OutTargets[index] > texture.ResidentMip)
+			{
+				const uint64_t extra = texture.MipBytes[OutTargets[index] - 1];
+				if (used + extra > BudgetBytes) break;
+				used += extra;
+				OutTargets[index]--;
+			}
+			if (OutTargets[index] != before)
+			{
+				stats.Retained++;
+			}
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (OutTargets[i] < Textures[i].ResidentMip) stats.Upgrades++;
+			if (OutTargets[i] > Textures[i].ResidentMip) stats.Evictions++;
+		}
+		stats.TargetBytes = used;
+		return stats;
+	}
+}
@@ -0,0 +1,264 @@
+﻿#include "pch.h"
+#include<System/Asset/AssetHotReloader.hpp>
+#include<System/Asset/AssetManager.hpp>
+#include<System/IO/DerivedDataCache.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<Graphics/Texture/TextureCooker.hpp>
+#include<Graphics/Mesh/MeshAssetCooker.hpp>
+#include<Graphics/Mesh/ObjImporter.hpp>
+
+#include<algorithm>
+#include<cctype>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		//	小文字の拡張子（".tga" など）
+		std::string GetExtension(const std::string& Path)
+		{
+			const size_t slash = Path.find_last_of('/');
+			const size_t dot = Path.find_last_of('.');
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return {};
+			std::string extension = Path.substr(dot);
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return extension;
+		}
+
+		//	'/' 区切りの相対パスから、フォルダの下のパス
+		std::filesystem::path ToPath(const std::filesystem::path& Root, const std::string& Path)
+		{
+			return Root / std::filesystem::path(std::u8string(Path.begin(), Path.end()));
+		}
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void AssetHotReloader::OnCreate()
+	{
+		mpCache = nullptr;
+		mStats = {};
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void AssetHotReloader::OnDestroy()
+	{
+		mCookedWatcher.Stop();
+		mSourceWatcher.Stop();
+		this->WaitIdle();
+		mRules.clear();
+		mpCache.reset();
+	}
+
+	/// <summary>
+	/// 見張り始め、テクスチャとメッシュの焼き方を登録する
+	/// </summary>
+	/// <param name="CookedRoot">焼いたフォルダ（AssetManager の Root と同じ）</param>
+	/// <param name="SourceRoot">元のフォルダ（空なら焼かずに CookedRoot だけを見張る）</param>
+	/// <param name="CacheRoot">派生データのキャッシュの場所</param>
+	/// <param name="DebounceMs">同じファイルの変化をまとめる時間（ミリ秒）</param>
+	/// <returns>true:成功</returns>
+	bool AssetHotReloader::Initialize(const std::filesystem::path& CookedRoot, const std::filesystem::path& SourceRoot,
+		const std::filesystem::path& CacheRoot, uint32_t DebounceMs)
+	{
+		if (mCookedWatcher.IsWatching() == true) return false;
+		if (mCookedWatcher.Start(CookedRoot, DebounceMs) == false) return false;
+		mCookedRoot = CookedRoot;
+		mSourceRoot = SourceRoot;
+
+		std::error_code error;
+		if (mSourceRoot.empty() == false && std::filesystem::equivalent(mSourceRoot, mCookedRoot, error) == false)
+		{
+			if (mSourceWatcher.Start(mSourceRoot, DebounceMs) == false)
+			{
+				mCookedWatcher.Stop();
+				return false;
+			}
+		}
+		mpCache = std::make_unique<DerivedDataCache>(CacheRoot);
+
+		//	テクスチャは AssetCooker の texture と同じ既定の設定（BC7・sRGB・ミップあり）で焼く
+		const CookFunction cookTexture = [this](const std::filesystem::path& Input, const std::filesystem::path& Output)
+			{
+				return Graphics::TextureCooker::Write(Input, Output, Graphics::TextureCookSettings(), mpCache.get());
+			};
+		for (const char* extension : { ".tga", ".png", ".jpg", ".jpeg", ".bmp" })
+		{
+			AddCookRule(extension, ".dds", cookTexture);
+		}
+		AddCookRule(".obj", ".emesh", [](const std::filesystem::path& Input, const std::filesystem::path& Output)
+			{
+				Graphics::MeshAssetData data;
+				if (Graphics::ObjImporter::Load(Input, data) == false) return false;
+				return Graphics::MeshAssetCooker::Write(Output, data);
+			});
+
+		ECSE_LOG(System::ELogLevel::Log, "AssetHotReloader: watching {}{}", mCookedRoot.string(),
+			mSourceWatcher.IsWatching() ? " and " + mSourceRoot.string() : std::string());
+		return true;
+	}
+
+	/// <summary>
+	/// 焼き方を登録する（同じ拡張子なら置き換える）
+	/// </summary>
+	/// <param name="SourceExtension">元の拡張子（".tga" のように小文字で）</param>
+	/// <param name="CookedExtension">焼いた後の拡張子</param>
+	/// <param name="Cook">焼き方</param>
+	void AssetHotReloader::AddCookRule(std::string SourceExtension, std::string CookedExtension, CookFunction Cook)
+	{
+		std::lock_guard lock(mMutex);
+		mRules[std::move(SourceExtension)] = { std::move(CookedExtension), std::move(Cook) };
+	}
+
+	/// <summary>
+	/// 変化を取り出して焼き直しと読み直しを始める（ゲームスレッドでフレームに1回、AssetManager::Update の前に）
+	/// </summary>
+	void AssetHotReloader::Update()
+	{
+		std::vector<FileChangeEvent> cookedChanges;
+		std::vector<FileChangeEvent> sourceChanges;
+		mCookedWatcher.Poll(cookedChanges);
+		mSourceWatcher.Poll(sourceChanges);
+		if (cookedChanges.empty() == true && sourceChanges.empty() == true) return;
+
+		{
+			std::lock_guard lock(mMutex);
+			mStats.Changes += static_cast<uint32_t>(cookedChanges.size() + sourceChanges.size());
+		}
+
+		//	消えたファイルは読み込み済みの版を残す
+		for (const FileChangeEvent& change : sourceChanges)
+		{
+			if (change.Type == EFileChange::Modified) StartCook(change.Path);
+		}
+		for (const FileChangeEvent& change : cookedChanges)
+		{
+			if (change.Type != EFileChange::Modified) continue;
+			//	元のフォルダが同じなら、焼いたフォルダの元のファイルも焼く
+			if (mSourceWatcher.IsWatching() == false && mSourceRoot.empty() == false) StartCook(change.Path);
+			StartReload(change.Path, change.Time);
+		}
+	}
+
+	/// <summary>
+	/// 焼いている途中のものが全て終わるまで待つ
+	/// </summary>
+	void AssetHotReloader::WaitIdle()
+	{
+		std::unique_lock lock(mMutex);
+		mCondition.wait(lock, [this]() { return mCooking.empty(); });
+	}
+
+	/// <summary>
+	/// 直近までの読み直しの数
+	/// </summary>
+	AssetHotReloadStats AssetHotReloader::GetStats() const
+	{
+		std::lock_guard lock(mMutex);
+		return mStats;
+	}
+
+	/// <summary>
+	/// 元のファイルを焼き直す（ワーカーへ送る）
+	/// 同じファイルを同時に焼かないように、焼いている間の変化は印だけ付けて、終わった後に同じワーカーで焼き直す。
+	/// 書き出したファイルは焼いたフォルダの見張りが拾って読み直す。
+	/// </summary>
+	/// <param name="Path">元のフォルダからの相対パス</param>
+	void AssetHotReloader::StartCook(const std::string& Path)
+	{
+		CookRule rule;
+		{
+			std::lock_guard lock(mMutex);
+			const auto it = mRules.find(GetExtension(Path));
+			if (it == mRules.end()) return;
+			rule = it->second;
+
+			const auto [cooking, isInserted] = mCooking.emplace(Path, false);
+			if (isInserted == false)
+			{
+				cooking->second = true;
+				return;
+			}
+		}
+
+		const std::filesystem::path input = ToPath(mSourceRoot, Path);
+		std::filesystem::path output = ToPath(mCookedRoot, Path);
+		output.replace_extension(std::filesystem::path(std::u8string(rule.CookedExtension.begin(), rule.CookedExtension.end())));
+
+		auto cook = [this, rule, input, output, Path]()
+			{
+				while (true)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					std::error_code error;
+					std::filesystem::create_directories(output.parent_path(), error);
+					const bool isCooked = rule.Cook(input, output);
+					const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+					if (isCooked == true)
+					{
+						ECSE_LOG(System::ELogLevel::Log, "AssetHotReloader: cooked {} ({:.1f} ms)", Path, elapsedMs);
+					}
+					else
+					{
+						ECSE_LOG(System::ELogLevel::Warning, "AssetHotReloader: failed to cook {}.", Path);
+					}
+
+					std::lock_guard lock(mMutex);
+					(isCooked ? mStats.Cooked : mStats.CookFailed)++;
+					auto it = mCooking.find(Path);
+					if (it->second == true)
+					{
+						it->second = false;
+						continue;
+					}
+					mCooking.erase(it);
+					mCondition.notify_all();
+					return;
+				}
+			};
+
+		auto* pJobs = ServiceLocator::Get<JobSystem>();
+		if (pJobs != nullptr)
+		{
+			pJobs->Run(std::move(cook));
+		}
+		else
+		{
+			cook();
+		}
+	}
+
+	/// <summary>
+	/// 焼いたファイルを読み直す（読み込まれていなければ何もしない）
+	/// </summary>
+	/// <param name="Path">焼いたフォルダからの相対パス</param>
+	/// <param name="ChangedAt">ファイルが最後に変化した時刻</param>
+	void AssetHotReloader::StartReload(const std::string& Path, std::chrono::steady_clock::time_point ChangedAt)
+	{
+		auto* manager = ServiceLocator::Get<AssetManager>();
+		if (manager == nullptr) return;
+
+		//	差し替えは AssetManager::Update の中で呼ばれる。その時にまだ自分がいるとは限らないので引き直す
+		manager->Reload(Path, [Path, ChangedAt](bool Succeeded)
+			{
+				auto* reloader = ServiceLocator::Get<AssetHotReloader>();
+				if (reloader == nullptr) return;
+
+				const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ChangedAt).count();
+				std::lock_guard lock(reloader->mMutex);
+				if (Succeeded == true)
+				{
+					reloader->mStats.Reloaded++;
+					reloader->mStats.LastReloadMs = elapsedMs;
+					ECSE_LOG(System::ELogLevel::Log, "AssetHotReloader: reloaded {} ({:.1f} ms after the last change)", Path, elapsedMs);
+				}
+				else
+				{
+					reloader->mStats.ReloadFailed++;
+				}
+			});
+	}
+}
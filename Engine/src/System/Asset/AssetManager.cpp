@@ -0,0 +1,774 @@
+﻿#include "pch.h"
+#include<System/Asset/AssetManager.hpp>
+#include<System/IO/AsyncFileIO.hpp>
+#include<System/IO/PackArchive.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<algorithm>
+#include<fstream>
+#include<unordered_set>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		//	ハンドルの下位ビットがスロット番号、上位ビットが世代
+		constexpr uint32_t SLOT_BITS = 16;
+		constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+		uint32_t MakeHandle(uint32_t Index, uint16_t Generation)
+		{
+			return (static_cast<uint32_t>(Generation) << SLOT_BITS) | Index;
+		}
+
+		//	読む時のパス（区切りを '/' にして先頭の "./" と "/" を取る。大文字小文字は変えない）
+		std::string ToFilePath(std::string_view Path)
+		{
+			std::string path(Path);
+			std::replace(path.begin(), path.end(), '\\', '/');
+			size_t begin = 0;
+			while (true)
+			{
+				if (path.compare(begin, 2, "./") == 0) begin += 2;
+				else if (path.compare(begin, 1, "/") == 0) begin += 1;
+				else break;
+			}
+			return path.substr(begin);
+		}
+
+		//	ファイルを丸ごと読む（AsyncFileIO が無い時）
+		bool ReadWholeFile(const std::filesystem::path& Path, std::vector<uint8_t>& OutBytes)
+		{
+			std::ifstream file(Path, std::ios::binary | std::ios::ate);
+			if (file.is_open() == false) return false;
+			const std::streamoff size = file.tellg();
+			if (size < 0) return false;
+			OutBytes.resize(static_cast<size_t>(size));
+			file.seekg(0);
+			return file.read(reinterpret_cast<char*>(OutBytes.data()), size).good() || size == 0;
+		}
+	}
+
+	AssetLoadContext::AssetLoadContext(AssetManager* pManager, std::string_view Path, std::span<const uint8_t> Bytes)
+		:mpManager(pManager)
+		, mPath(Path)
+		, mBytes(Bytes)
+		, mDependencies()
+	{
+	}
+
+	/// <summary>
+	/// 素材のパス（区切りは '/'）
+	/// </summary>
+	std::string_view AssetLoadContext::GetPath() const
+	{
+		return mPath;
+	}
+
+	/// <summary>
+	/// ファイルの中身
+	/// </summary>
+	std::span<const uint8_t> AssetLoadContext::GetBytes() const
+	{
+		return mBytes;
+	}
+
+	/// <summary>
+	/// 型を消した AddDependency
+	/// </summary>
+	uint32_t AssetLoadContext::AddDependency(std::type_index Type, std::string_view Path)
+	{
+		//	失敗して 0 が返っても覚えておき、自分を Failed にする
+		const uint32_t handle = mpManager->Load(Type, Path, nullptr);
+		mDependencies.push_back(handle);
+		return handle;
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void AssetManager::OnCreate()
+	{
+		mLoadingCount = 0;
+		mActiveJobs = 0;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void AssetManager::OnDestroy()
+	{
+		//	ワーカーが this を触らなくなるまで待ってから全て捨てる
+		{
+			std::unique_lock lock(mMutex);
+			mCondition.wait(lock, [this]() { return mActiveJobs == 0; });
+		}
+
+		if (mPathToSlot.empty() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "AssetManager: {} assets are still referenced at shutdown.", mPathToSlot.size());
+		}
+		mNotifications.clear();
+		mReadyReloads.clear();
+		mDeferredReloads.clear();
+		mPathToSlot.clear();
+		mFreeSlots.clear();
+		mSlots.clear();
+		mLoaders.clear();
+	}
+
+	/// <summary>
+	/// 素材の置き場所を決める
+	/// </summary>
+	/// <param name="Root">パスの基準になるフォルダ</param>
+	/// <returns>true:成功</returns>
+	bool AssetManager::Initialize(const std::filesystem::path& Root)
+	{
+		std::error_code error;
+		if (Root.empty() == false && std::filesystem::is_directory(Root, error) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "AssetManager: root directory not found. ({})", Root.string());
+			return false;
+		}
+		mRoot = Root;
+		return true;
+	}
+
+	/// <summary>
+	/// ファイルを読む関数を差し替える（nullptr で既定に戻す）
+	/// </summary>
+	void AssetManager::SetReader(Reader Read)
+	{
+		std::lock_guard lock(mMutex);
+		mReader = std::move(Read);
+	}
+
+	/// <summary>
+	/// 全ての読み込みが終わるまで待つ
+	/// </summary>
+	void AssetManager::WaitIdle()
+	{
+		std::unique_lock lock(mMutex);
+		mCondition.wait(lock, [this]() { return mLoadingCount == 0 && mActiveJobs == 0; });
+	}
+
+	/// <summary>
+	/// 完了した読み込みのコールバックを呼ぶ（ゲームスレッドでフレームに1回）
+	/// </summary>
+	void AssetManager::Update()
+	{
+		std::vector<Notification> notifications;
+		std::vector<std::string> dependents;
+		std::vector<std::pair<std::string, std::function<void(bool)>>> deferred;
+		{
+			std::lock_guard lock(mMutex);
+			ApplyReloads(dependents);
+			deferred.swap(mDeferredReloads);
+			notifications.swap(mNotifications);
+		}
+
+		//	差し替えた素材に依存する素材と、読み込み中で待たせた読み直しを始める
+		for (const std::string& path : dependents)
+		{
+			Reload(path);
+		}
+		for (auto& [path, callback] : deferred)
+		{
+			Reload(path, std::move(callback));
+		}
+
+		//	コールバックの中から Load や Unload を呼べるように、ロックの外で呼ぶ
+		for (Notification& notification : notifications)
+		{
+			notification.Callback(notification.Handle, notification.Succeeded);
+		}
+	}
+
+	/// <summary>
+	/// 今の状態ごとの数
+	/// </summary>
+	AssetManagerStats AssetManager::GetStats() const
+	{
+		std::lock_guard lock(mMutex);
+		AssetManagerStats stats;
+		for (const Slot& slot : mSlots)
+		{
+			if (slot.ReloadTarget != 0) continue;
+			switch (slot.State)
+			{
+			case EAssetState::Loading: stats.Loading++; break;
+			case EAssetState::Ready: stats.Ready++; break;
+			case EAssetState::Failed: stats.Failed++; break;
+			default: continue;
+			}
+			stats.Total++;
+		}
+		return stats;
+	}
+
+	/// <summary>
+	/// 型ごとの読み方を登録する
+	/// </summary>
+	void AssetManager::RegisterLoader(std::type_index Type, std::unique_ptr<IAssetLoader> Loader)
+	{
+		std::lock_guard lock(mMutex);
+		for (auto& [type, loader] : mLoaders)
+		{
+			if (type == Type)
+			{
+				loader = std::move(Loader);
+				return;
+			}
+		}
+		mLoaders.emplace_back(Type, std::move(Loader));
+	}
+
+	/// <summary>
+	/// 読み込みを始める（型を消したもの）
+	/// </summary>
+	uint32_t AssetManager::Load(std::type_index Type, std::string_view Path, std::function<void(uint32_t, bool)> OnLoaded)
+	{
+		std::string path = PackArchive::NormalizePath(Path);
+		const uint64_t pathHash = PackArchive::HashPath(path);
+
+		std::unique_lock lock(mMutex);
+
+		uint16_t type = 0;
+		while (type < mLoaders.size() && mLoaders[type].first != Type) type++;
+		if (type == mLoaders.size())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "AssetManager: no loader registered for {}. ({})", Type.name(), path);
+			return 0;
+		}
+
+		//	読み込み済みか読み込み中なら同じものを返す
+		if (auto it = mPathToSlot.find(pathHash); it != mPathToSlot.end())
+		{
+			Slot& slot = mSlots[it->second];
+			if (slot.Path != path)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "AssetManager: path hash collision. ({} and {})", slot.Path, path);
+				return 0;
+			}
+			if (slot.Type != type)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "AssetManager: {} is already loaded as {}.", path, mLoaders[slot.Type].first.name());
+				return 0;
+			}
+
+			const uint32_t handle = MakeHandle(it->second, slot.Generation);
+			slot.RefCount++;
+			if (OnLoaded)
+			{
+				if (slot.State == EAssetState::Loading)
+				{
+					slot.Callbacks.push_back(std::move(OnLoaded));
+				}
+				else
+				{
+					mNotifications.push_back({ std::move(OnLoaded), handle, slot.State == EAssetState::Ready });
+				}
+			}
+			return handle;
+		}
+
+		const uint32_t index = AllocateSlot(path, pathHash, Path, type);
+		if (index == UINT32_MAX) return 0;
+
+		Slot& slot = mSlots[index];
+		if (OnLoaded) slot.Callbacks.push_back(std::move(OnLoaded));
+		mPathToSlot.emplace(pathHash, index);
+
+		const uint32_t handle = MakeHandle(index, slot.Generation);
+		const std::string filePath = slot.FilePath;
+		lock.unlock();
+
+		StartLoad(handle, type, filePath);
+		return handle;
+	}
+
+	/// <summary>
+	/// 読み込み済みの素材を読み直す（すぐに返る）
+	/// 新しい版は Path を持つが mPathToSlot には載せない別のスロットで読み、揃ったら ApplyReloads で中身を入れ替えて、
+	/// 古い版を持った別のスロットを破棄する。
+	/// </summary>
+	/// <param name="Path">パス（Load と同じ規則で比べる）</param>
+	/// <param name="OnReloaded">差し替えた（true）か、失敗した（false）Update で呼ばれる（省略可）</param>
+	/// <returns>true:読み込み済み（読み直しを始めた）</returns>
+	bool AssetManager::Reload(std::string_view Path, std::function<void(bool)> OnReloaded)
+	{
+		const std::string path = PackArchive::NormalizePath(Path);
+		const uint64_t pathHash = PackArchive::HashPath(path);
+
+		std::unique_lock lock(mMutex);
+		const auto it = mPathToSlot.find(pathHash);
+		if (it == mPathToSlot.end() || mSlots[it->second].Path != path) return false;
+
+		const uint32_t targetIndex = it->second;
+		if (mSlots[targetIndex].State == EAssetState::Loading)
+		{
+			//	最初の読み込みが終わってからやり直す
+			mDeferredReloads.emplace_back(std::string(Path), std::move(OnReloaded));
+			return true;
+		}
+
+		const uint16_t type = mSlots[targetIndex].Type;
+		const std::string filePath = mSlots[targetIndex].FilePath;
+		const uint32_t index = AllocateSlot(path, pathHash, filePath, type);
+		if (index == UINT32_MAX) return false;
+
+		Slot& slot = mSlots[index];
+		const uint32_t handle = MakeHandle(index, slot.Generation);
+		slot.ReloadTarget = MakeHandle(targetIndex, mSlots[targetIndex].Generation);
+		if (OnReloaded)
+		{
+			slot.Callbacks.push_back([OnReloaded = std::move(OnReloaded)](uint32_t, bool Succeeded) { OnReloaded(Succeeded); });
+		}
+		mSlots[targetIndex].ReloadSlot = handle;
+		lock.unlock();
+
+		StartLoad(handle, type, filePath);
+		return true;
+	}
+
+	/// <summary>
+	/// 参照カウントを増やす
+	/// </summary>
+	void AssetManager::AddRef(uint32_t Handle)
+	{
+		std::lock_guard lock(mMutex);
+		if (Slot* pSlot = FindSlot(Handle)) pSlot->RefCount++;
+	}
+
+	/// <summary>
+	/// 参照カウントを減らす（0 になったら破棄する。読み込み中なら終わってから）
+	/// </summary>
+	void AssetManager::Unload(uint32_t Handle)
+	{
+		std::lock_guard lock(mMutex);
+		UnloadLocked(Handle);
+	}
+
+	/// <summary>
+	/// 素材（Ready で型が合う時だけ）
+	/// </summary>
+	const IAsset* AssetManager::Get(uint32_t Handle, std::type_index Type) const
+	{
+		std::lock_guard lock(mMutex);
+		const Slot* pSlot = FindSlot(Handle);
+		if (pSlot == nullptr || pSlot->State != EAssetState::Ready) return nullptr;
+		if (mLoaders[pSlot->Type].first != Type) return nullptr;
+		return pSlot->Asset.get();
+	}
+
+	/// <summary>
+	/// 状態
+	/// </summary>
+	EAssetState AssetManager::GetState(uint32_t Handle) const
+	{
+		std::lock_guard lock(mMutex);
+		const Slot* pSlot = FindSlot(Handle);
+		return pSlot != nullptr ? pSlot->State : EAssetState::Invalid;
+	}
+
+	/// <summary>
+	/// 参照カウント（無効なハンドルは 0）
+	/// </summary>
+	uint32_t AssetManager::GetRefCount(uint32_t Handle) const
+	{
+		std::lock_guard lock(mMutex);
+		const Slot* pSlot = FindSlot(Handle);
+		return pSlot != nullptr ? pSlot->RefCount : 0;
+	}
+
+	/// <summary>
+	/// Loading でなくなるまで待つ
+	/// </summary>
+	EAssetState AssetManager::Wait(uint32_t Handle)
+	{
+		std::unique_lock lock(mMutex);
+		EAssetState state = EAssetState::Invalid;
+		mCondition.wait(lock, [&]()
+			{
+				const Slot* pSlot = FindSlot(Handle);
+				state = pSlot != nullptr ? pSlot->State : EAssetState::Invalid;
+				return state != EAssetState::Loading;
+			});
+		return state;
+	}
+
+	/// <summary>
+	/// ハンドルの指すスロット（無効なら nullptr。mMutex を持って呼ぶ）
+	/// </summary>
+	AssetManager::Slot* AssetManager::FindSlot(uint32_t Handle)
+	{
+		return const_cast<Slot*>(std::as_const(*this).FindSlot(Handle));
+	}
+
+	const AssetManager::Slot* AssetManager::FindSlot(uint32_t Handle) const
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		if (Handle == 0 || index >= mSlots.size()) return nullptr;
+		const Slot& slot = mSlots[index];
+		if (slot.State == EAssetState::Invalid || slot.Generation != static_cast<uint16_t>(Handle >> SLOT_BITS)) return nullptr;
+		return &slot;
+	}
+
+	/// <summary>
+	/// ファイルを読んで素材にする（ワーカーへ送る）
+	/// 差し替えた読み方 → AsyncFileIO → ワーカーで ifstream の順に使う。
+	/// </summary>
+	void AssetManager::StartLoad(uint32_t Handle, uint16_t Type, const std::string& Path)
+	{
+		Reader reader;
+		{
+			std::lock_guard lock(mMutex);
+			reader = mReader;
+		}
+
+		if (reader)
+		{
+			Dispatch([this, reader = std::move(reader), Handle, Type, Path]()
+				{
+					std::vector<uint8_t> bytes;
+					const bool isRead = reader(Path, bytes);
+					Decode(Handle, Type, Path, isRead ? &bytes : nullptr);
+				});
+			return;
+		}
+
+		const std::filesystem::path fullPath = mRoot / std::filesystem::path(std::u8string(Path.begin(), Path.end()));
+
+		auto* io = ServiceLocator::Get<AsyncFileIO>();
+		if (io == nullptr)
+		{
+			Dispatch([this, fullPath, Handle, Type, Path]()
+				{
+					std::vector<uint8_t> bytes;
+					const bool isRead = ReadWholeFile(fullPath, bytes);
+					Decode(Handle, Type, Path, isRead ? &bytes : nullptr);
+				});
+			return;
+		}
+
+		const AsyncFileHandle file = io->OpenFile(fullPath);
+		if (file == INVALID_ASYNC_FILE_HANDLE)
+		{
+			Decode(Handle, Type, Path, nullptr);
+			return;
+		}
+
+		auto bytes = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(io->GetFileSize(file)));
+		if (bytes->empty() == true)
+		{
+			io->CloseFile(file);
+			Dispatch([this, bytes, Handle, Type, Path]() { Decode(Handle, Type, Path, bytes.get()); });
+			return;
+		}
+
+		AsyncReadRequest request;
+		request.File = file;
+		request.Buffer = *bytes;
+		//	完了は I/O スレッドで来るので、素材にするのはワーカーへ回す
+		request.OnComplete = [this, io, file, bytes, Handle, Type, Path](const AsyncReadCompletion& Completion)
+			{
+				io->CloseFile(file);
+				const bool isRead = Completion.Result == EAsyncReadResult::Succeeded && Completion.BytesRead == bytes->size();
+				Dispatch([this, bytes, isRead, Handle, Type, Path]() { Decode(Handle, Type, Path, isRead ? bytes.get() : nullptr); });
+			};
+		if (io->Read(std::move(request)) == INVALID_ASYNC_READ_HANDLE)
+		{
+			io->CloseFile(file);
+			Decode(Handle, Type, Path, nullptr);
+		}
+	}
+
+	/// <summary>
+	/// 読んだ中身から素材を作り、完了を反映する（ワーカー）
+	/// </summary>
+	void AssetManager::Decode(uint32_t Handle, uint16_t Type, const std::string& Path, const std::vector<uint8_t>* pBytes)
+	{
+		std::unique_ptr<IAsset> asset;
+		AssetLoadContext context(this, Path, pBytes != nullptr ? std::span<const uint8_t>(*pBytes) : std::span<const uint8_t>());
+		if (pBytes == nullptr)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "AssetManager: failed to read {}.", Path);
+		}
+		else
+		{
+			//	ロックの外で呼ぶ（中で AddDependency から Load が呼ばれる）
+			asset = mLoaders[Type].second->Load(context);
+			if (asset == nullptr)
+			{
+				ECSE_LOG(System::ELogLevel::Warning, "AssetManager: failed to load {}.", Path);
+			}
+		}
+
+		std::lock_guard lock(mMutex);
+		const uint32_t index = Handle & SLOT_MASK;
+		//	読み直しの版は、差し替える先への循環も調べる
+		const uint32_t target = mSlots[index].ReloadTarget;
+		mSlots[index].Asset = std::move(asset);
+		mSlots[index].IsDecoded = true;
+		if (mSlots[index].Asset == nullptr) mSlots[index].HasFailed = true;
+
+		//	依存をつなぐ（まだ読み込み中のものは、終わった時にこちらへ知らせてもらう）
+		for (uint32_t dependency : context.mDependencies)
+		{
+			Slot* pDependency = FindSlot(dependency);
+			if (pDependency == nullptr)
+			{
+				mSlots[index].HasFailed = true;
+				continue;
+			}
+			if (dependency == Handle || DependsOn(dependency, Handle) == true ||
+				(target != 0 && (dependency == target || DependsOn(dependency, target) == true)))
+			{
+				ECSE_LOG(System::ELogLevel::Error, "AssetManager: circular dependency. ({} -> {})", Path, pDependency->Path);
+				mSlots[index].HasFailed = true;
+				UnloadLocked(dependency);
+				continue;
+			}
+
+			mSlots[index].Dependencies.push_back(dependency);
+			if (pDependency->State == EAssetState::Loading)
+			{
+				pDependency->Dependents.push_back(Handle);
+				mSlots[index].PendingDependencies++;
+			}
+			else if (pDependency->State == EAssetState::Failed)
+			{
+				mSlots[index].HasFailed = true;
+			}
+		}
+
+		Resolve(Handle);
+		mActiveJobs--;
+		mCondition.notify_all();
+	}
+
+	/// <summary>
+	/// 空いているスロットを取って読み込み中にする（空きが無ければ UINT32_MAX。mMutex を持って呼ぶ）
+	/// </summary>
+	uint32_t AssetManager::AllocateSlot(const std::string& Path, uint64_t PathHash, std::string_view FilePath, uint16_t Type)
+	{
+		uint32_t index = 0;
+		if (mFreeSlots.empty() == false)
+		{
+			index = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		}
+		else
+		{
+			if (mSlots.size() >= MAX_ASSETS)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "AssetManager: too many assets. ({})", Path);
+				return UINT32_MAX;
+			}
+			index = static_cast<uint32_t>(mSlots.size());
+			mSlots.emplace_back();
+		}
+
+		Slot& slot = mSlots[index];
+		slot.Path = Path;
+		slot.PathHash = PathHash;
+		slot.FilePath = ToFilePath(FilePath);
+		slot.RefCount = 1;
+		slot.PendingDependencies = 0;
+		slot.Type = Type;
+		slot.State = EAssetState::Loading;
+		slot.IsDecoded = false;
+		slot.HasFailed = false;
+		mLoadingCount++;
+		mActiveJobs++;
+		return index;
+	}
+
+	/// <summary>
+	/// 揃った読み直しの版を差し替える（mMutex を持って呼ぶ）
+	/// 中身と依存を入れ替えるので、破棄する読み直しのスロットが古い版と古い依存への参照を持って消える。
+	/// </summary>
+	/// <param name="OutDependents">差し替えた素材に依存する素材の読む時のパス</param>
+	void AssetManager::ApplyReloads(std::vector<std::string>& OutDependents)
+	{
+		std::vector<uint32_t> replaced;
+		for (uint32_t reload : mReadyReloads)
+		{
+			Slot* pReload = FindSlot(reload);
+			if (pReload == nullptr) continue;
+
+			const uint32_t target = pReload->ReloadTarget;
+			Slot* pTarget = FindSlot(target);
+			bool isSucceeded = pReload->State == EAssetState::Ready;
+			if (pTarget == nullptr || pTarget->ReloadSlot != reload)
+			{
+				//	解放されたか、もっと新しい読み直しが始まっている
+				isSucceeded = false;
+			}
+			else
+			{
+				pTarget->ReloadSlot = 0;
+				if (isSucceeded == true)
+				{
+					std::swap(pTarget->Asset, pReload->Asset);
+					std::swap(pTarget->Dependencies, pReload->Dependencies);
+					pTarget->State = EAssetState::Ready;
+					pTarget->HasFailed = false;
+					replaced.push_back(target);
+				}
+				else
+				{
+					ECSE_LOG(System::ELogLevel::Warning, "AssetManager: failed to reload {}, keeping the previous version.", pReload->Path);
+				}
+			}
+
+			for (auto& callback : pReload->Callbacks)
+			{
+				mNotifications.push_back({ std::move(callback), target, isSucceeded });
+			}
+			pReload->Callbacks.clear();
+			Destroy(reload);
+		}
+		mReadyReloads.clear();
+
+		//	差し替えた素材に依存する素材（読み直しの版は除く）
+		if (replaced.empty() == true) return;
+		for (const Slot& slot : mSlots)
+		{
+			if (slot.State == EAssetState::Invalid || slot.State == EAssetState::Loading || slot.ReloadTarget != 0) continue;
+			const bool isDependent = std::any_of(slot.Dependencies.begin(), slot.Dependencies.end(),
+				[&](uint32_t Dependency) { return std::find(replaced.begin(), replaced.end(), Dependency) != replaced.end(); });
+			if (isDependent == true) OutDependents.push_back(slot.FilePath);
+		}
+	}
+
+	/// <summary>
+	/// 読み込みが終わり、依存も揃っていれば Ready か Failed にして、待っている素材へ伝える（mMutex を持って呼ぶ）
+	/// </summary>
+	void AssetManager::Resolve(uint32_t Handle)
+	{
+		Slot* pSlot = FindSlot(Handle);
+		if (pSlot == nullptr || pSlot->State != EAssetState::Loading) return;
+		if (pSlot->IsDecoded == false || pSlot->PendingDependencies > 0) return;
+
+		const bool isSucceeded = pSlot->HasFailed == false;
+		pSlot->State = isSucceeded ? EAssetState::Ready : EAssetState::Failed;
+		if (isSucceeded == false) pSlot->Asset.reset();
+		mLoadingCount--;
+
+		//	読み直しの版は Update で差し替える（通知もその時に）
+		if (pSlot->ReloadTarget != 0)
+		{
+			mReadyReloads.push_back(Handle);
+			return;
+		}
+
+		for (auto& callback : pSlot->Callbacks)
+		{
+			mNotifications.push_back({ std::move(callback), Handle, isSucceeded });
+		}
+		pSlot->Callbacks.clear();
+
+		//	待っている素材へ伝える（その先で破棄が起きてもスロットの配列は動かないが、念のため引き直す）
+		const std::vector<uint32_t> dependents = std::move(pSlot->Dependents);
+		pSlot->Dependents.clear();
+		for (uint32_t dependent : dependents)
+		{
+			Slot* pDependent = FindSlot(dependent);
+			if (pDependent == nullptr || pDependent->State != EAssetState::Loading) continue;
+			pDependent->PendingDependencies--;
+			if (isSucceeded == false) pDependent->HasFailed = true;
+			Resolve(dependent);
+		}
+
+		//	読み込み中に参照が無くなっていたら、ここで破棄する
+		pSlot = FindSlot(Handle);
+		if (pSlot != nullptr && pSlot->RefCount == 0) Destroy(Handle);
+	}
+
+	/// <summary>
+	/// From の依存をたどって To に着くか（循環の検出。mMutex を持って呼ぶ）
+	/// </summary>
+	bool AssetManager::DependsOn(uint32_t From, uint32_t To) const
+	{
+		std::vector<uint32_t> stack = { From };
+		std::unordered_set<uint32_t> visited;
+		while (stack.empty() == false)
+		{
+			const uint32_t handle = stack.back();
+			stack.pop_back();
+			if (handle == To) return true;
+			if (visited.insert(handle).second == false) continue;
+
+			const Slot* pSlot = FindSlot(handle);
+			if (pSlot == nullptr) continue;
+			stack.insert(stack.end(), pSlot->Dependencies.begin(), pSlot->Dependencies.end());
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// 参照カウントを減らし、0 なら破棄する（mMutex を持って呼ぶ）
+	/// </summary>
+	void AssetManager::UnloadLocked(uint32_t Handle)
+	{
+		Slot* pSlot = FindSlot(Handle);
+		if (pSlot == nullptr || pSlot->RefCount == 0) return;
+		if (--pSlot->RefCount > 0) return;
+
+		//	読み込み中なら Resolve で破棄する
+		if (pSlot->State == EAssetState::Loading) return;
+		Destroy(Handle);
+	}
+
+	/// <summary>
+	/// 素材を破棄してスロットを空け、依存への参照を手放す（mMutex を持って呼ぶ）
+	/// </summary>
+	void AssetManager::Destroy(uint32_t Handle)
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		Slot& slot = mSlots[index];
+		const std::vector<uint32_t> dependencies = std::move(slot.Dependencies);
+
+		//	読み直しの版は mPathToSlot に載っていない
+		if (auto it = mPathToSlot.find(slot.PathHash); it != mPathToSlot.end() && it->second == index) mPathToSlot.erase(it);
+		slot.Asset.reset();
+		slot.Path.clear();
+		slot.PathHash = 0;
+		slot.FilePath.clear();
+		slot.ReloadTarget = 0;
+		slot.ReloadSlot = 0;
+		slot.Dependencies.clear();
+		slot.Dependents.clear();
+		slot.Callbacks.clear();
+		slot.RefCount = 0;
+		slot.PendingDependencies = 0;
+		slot.State = EAssetState::Invalid;
+		slot.IsDecoded = false;
+		slot.HasFailed = false;
+		slot.Generation++;
+		if (slot.Generation == 0) slot.Generation = 1;
+		mFreeSlots.push_back(index);
+
+		for (uint32_t dependency : dependencies)
+		{
+			UnloadLocked(dependency);
+		}
+	}
+
+	/// <summary>
+	/// ワーカーで処理する（JobSystem が無ければその場で）
+	/// </summary>
+	void AssetManager::Dispatch(std::function<void()> Task)
+	{
+		auto* pJobs = ServiceLocator::Get<JobSystem>();
+		if (pJobs != nullptr)
+		{
+			pJobs->Run(std::move(Task));
+		}
+		else
+		{
+			Task();
+		}
+	}
+}
@@ -5,17 +5,44 @@
 
 #include<System/Window/Window.hpp>
 #include<System/Log/Logger.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<System/Thread/TaskScheduler.hpp>
+#include<System/IO/AsyncFileIO.hpp>
+#include<System/Asset/AssetManager.hpp>
+#include<System/Asset/AssetHotReloader.hpp>
 #include<System/EngineConfig.hpp>
 #include<Graphics/DX12/DX12.hpp>
 #include<Debug/ImGui/ImGuiManager.hpp>
+#include<Debug/Profiler/Profiler.hpp>
 #include<Graphics/GraphicsDescriptorHeap/GDescriptorHeapManager.hpp>
 #include<ECS/Entity/EntityManager.hpp>
+#include<ECS/System/SystemScheduler.hpp>
+#include<Graphics/Render/RenderWorld.hpp>
+#include<Graphics/Texture/TextureLoader.hpp>
+#include<Graphics/Texture/TextureStreamer.hpp>
 
 namespace Ecse::System
 {
 	void Engine::OnCreate()
 	{
 		mpWindow = nullptr;
+		mpDX12 = nullptr;
+		mpImGui = nullptr;
+		mpProfiler = nullptr;
+		mpEntityManager = nullptr;
+		mpSystemScheduler = nullptr;
+		mpRenderWorld = nullptr;
+		mpTextureLoader = nullptr;
+		mpTextureStreamer = nullptr;
+		mpAssetManager = nullptr;
+		mpAssetHotReloader = nullptr;
+		mpTaskScheduler = nullptr;
+		mSnapshots = {};
+		mWriteSlot = 0;
+		mFrameStats = {};
+		mFrameStatsSum = {};
+		mFrameStatsCount = 0;
+		mFrameStatsLogInterval = 0;
 		mIsInitialized = false;
 	}
 
@@ -37,6 +64,38 @@ namespace Ecse::System
 
 		ECSE_LOG(ELogLevel::Log, "Engine Initialize.");
 
+		//	ワーカースレッド。盗み合う仕事のスケジューラ（ここを呼ぶスレッドがメインスレッドになる。仕事が無い間ワーカーは眠る）
+		if (JobSystem::Create() == false) return false;
+		const EJobExecution jobExecution = Context.UseJobFibers ? EJobExecution::Fiber : EJobExecution::Thread;
+		if (ServiceLocator::Get<JobSystem>()->Initialize(Context.WorkerCount, jobExecution) == false) return false;
+
+		//	非同期のファイル読み込み
+		if (AsyncFileIO::Create() == false) return false;
+		if (ServiceLocator::Get<AsyncFileIO>()->Initialize() == false) return false;
+
+		//	コルーチンの待ち（JobSystem と AsyncFileIO の後。フェンスとフレームの待ちは Update で再開する）
+		if (TaskScheduler::Create() == false) return false;
+		mpTaskScheduler = ServiceLocator::Get<TaskScheduler>();
+
+		//	素材の読み込みと参照カウント（GPU に触らないので AsyncFileIO の後ならどこでもよい）
+		if (AssetManager::Create() == false) return false;
+		mpAssetManager = ServiceLocator::Get<AssetManager>();
+		if (mpAssetManager->Initialize(Context.AssetRoot) == false) return false;
+
+#if ECSE_ASSET_HOT_RELOAD_ENABLED
+		//	素材の読み直し（焼いた素材のフォルダが決まっている時だけ。失敗しても読み直せないだけなので続ける）
+		if (Context.AssetRoot.empty() == false)
+		{
+			AssetHotReloader::Create();
+			mpAssetHotReloader = ServiceLocator::Get<AssetHotReloader>();
+			if (mpAssetHotReloader->Initialize(Context.AssetRoot, Context.AssetSourceRoot) == false)
+			{
+				ECSE_LOG(ELogLevel::Warning, "Engine: asset hot reload is disabled.");
+				AssetHotReloader::Release();
+				mpAssetHotReloader = nullptr;
+			}
+		}
+#endif
 
 		//	短くしたら見やすいのか見にくいのか分らなくなってきた。
 		//	ウィンドウ
@@ -59,14 +118,49 @@ namespace Ecse::System
 		// ImGui
 		if (Debug::ImGuiManager::Create() == false) return false;
 		mpImGui = ServiceLocator::Get<ImGuiManager>();
-		if (mpImGui->Initialize() == false) return false;
+		if (mpImGui->Initialize(Context.UseRenderThread == false) == false) return false;
 #endif
 
+		//	Profiler（ImGuiの後に作るとデバッグ表示が登録される）
+		if (Profiler::Create() == false) return false;
+		mpProfiler = ServiceLocator::Get<Profiler>();
+		if (mpProfiler->Initialize(mpDX12->GetDevice(), mpDX12->GetCommandQueue()) == false) return false;
+		//	描画スレッドを使う時はこのスレッドの区間を "Game" の下にまとめる
+		mpProfiler->SetThreadName("Game");
+		mFrameStatsLogInterval = Context.FrameStatsLogInterval;
+
 		//	EntityManager
 		if (ECS::EntityManager::Create() == false) return false;
 		mpEntityManager = ServiceLocator::Get<ECS::EntityManager>();
 		if (mpEntityManager->Initialize() == false) return false;
 
+		//	RenderWorld（レジストリの変更を監視するので EntityManager の後）
+		if (RenderWorld::Create() == false) return false;
+		mpRenderWorld = ServiceLocator::Get<RenderWorld>();
+		if (mpRenderWorld->Initialize(mpEntityManager->GetRegistry()) == false) return false;
+
+		//	SystemScheduler（システムは JobSystem のワーカーで動くので JobSystem の後）
+		if (ECS::SystemScheduler::Create() == false) return false;
+		mpSystemScheduler = ServiceLocator::Get<ECS::SystemScheduler>();
+		if (mpSystemScheduler->Initialize(mpEntityManager->GetRegistry(), Context.UseParallelSystems) == false) return false;
+
+		//	TextureLoader（プレースホルダーのディスクリプタを取るので GDHManager の後）
+		if (TextureLoader::Create() == false) return false;
+		mpTextureLoader = ServiceLocator::Get<TextureLoader>();
+		if (mpTextureLoader->Initialize(mpDX12->GetDevice()) == false) return false;
+
+		//	TextureStreamer（プレースホルダーを TextureLoader から借りるのでその後）
+		if (TextureStreamer::Create() == false) return false;
+		mpTextureStreamer = ServiceLocator::Get<TextureStreamer>();
+		if (mpTextureStreamer->Initialize(mpDX12->GetDevice(), Context.TextureBudget) == false) return false;
+
+		//	描画スレッド
+		if (Context.UseRenderThread == true)
+		{
+			if (mRenderThread.Start([this](uint32_t Slot) { RenderSnapshot(Slot); }) == false) return false;
+			ECSE_LOG(ELogLevel::Log, "Engine: Pipelined rendering enabled.");
+		}
+
 		// 全ての初期化正常終了後にフラグを立てる
 		mIsInitialized = true;
 
@@ -83,6 +177,8 @@ namespace Ecse::System
 	{
 		if (mIsInitialized == false) return false;
 
+		const auto frameStart = std::chrono::steady_clock::now();
+
 		//	OSメッセージ処理
 		mpWindow->ProcessMessages();
 
@@ -92,38 +188,236 @@ namespace Ecse::System
 			return false;
 		}
 
+		if (mRenderThread.IsRunning() == true)
+		{
+			this->RunPipelined();
+		}
+		else
+		{
+			this->RunSerial();
+		}
+
+		mFrameStats.FrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		this->AccumulateFrameStats();
+
+		return true;
+	}
+
+	void Engine::Shutdown()
+	{
+		if (mIsInitialized == false) return;
+
+		ECSE_LOG(ELogLevel::Log, "Engine Shutdown.");
+
+		//	描画中のフレームを流し切ってから止める
+		mRenderThread.Stop();
+
+		if(mpImGui->IsCreated()) mpImGui->Release();
+
+		ECS::SystemScheduler::Release();
+
+		Graphics::RenderWorld::Release();
+
+		//	クエリヒープを使用中のまま解放しないように待つ
+		mpDX12->WaitForGPU();
+		TaskScheduler::Release();
+		AssetHotReloader::Release();
+		AssetManager::Release();
+		Graphics::TextureStreamer::Release();
+		Graphics::TextureLoader::Release();
+		Debug::Profiler::Release();
+		Window::Release();
+		AsyncFileIO::Release();
+		JobSystem::Release();
+		mIsInitialized = false;
+	}
+
+	/// <summary>
+	/// 直近のフレームの計測結果
+	/// </summary>
+	const FrameStats& Engine::GetFrameStats() const
+	{
+		return mFrameStats;
+	}
+
+	/// <summary>
+	/// フレームの時間の内訳を足し込み、間隔ごとに平均をログに出す
+	/// UseRenderThread を切り替えて同じ場面を動かせば、直列とパイプラインの差を比べられる。
+	/// </summary>
+	void Engine::AccumulateFrameStats()
+	{
+		if (mFrameStatsLogInterval == 0) return;
+
+		mFrameStatsSum.FrameMs += mFrameStats.FrameMs;
+		mFrameStatsSum.GameMs += mFrameStats.GameMs;
+		mFrameStatsSum.RenderMs += mFrameStats.RenderMs;
+		mFrameStatsSum.WaitMs += mFrameStats.WaitMs;
+		mFrameStatsCount++;
+		if (mFrameStatsCount < mFrameStatsLogInterval) return;
+
+		const double count = static_cast<double>(mFrameStatsCount);
+		ECSE_LOG(ELogLevel::Log, "Engine: {} {} frames avg frame {:.2f} ms (game {:.2f}, render {:.2f}, wait {:.2f})",
+			mRenderThread.IsRunning() ? "pipelined" : "serial", mFrameStatsCount,
+			mFrameStatsSum.FrameMs / count, mFrameStatsSum.GameMs / count, mFrameStatsSum.RenderMs / count, mFrameStatsSum.WaitMs / count);
+		mFrameStatsSum = {};
+		mFrameStatsCount = 0;
+	}
+
+	/// <summary>
+	/// 1スレッドで更新と描画を順番に行う
+	/// </summary>
+	void Engine::RunSerial()
+	{
+		using Clock = std::chrono::steady_clock;
+
+		const auto gameStart = Clock::now();
+
 		this->NewFrame();
 
 		// 状態更新
 
 #if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
-		mpImGui->Update();
+		{
+			ECSE_PROFILE_CPU("ImGui");
+			mpImGui->Update();
+		}
 #endif
+
+		this->UpdateStages();
+
+		//	描画用の状態を抜き出す
+		{
+			ECSE_PROFILE_CPU("RenderWorld::Extract");
+			mpRenderWorld->Extract(mWriteSlot);
+		}
+
+		const auto renderStart = Clock::now();
+
 		//	描画
 
 		this->EndFrame();
 
+		const auto renderEnd = Clock::now();
+
 		//	エンティティの削除
-		mpEntityManager->Update();
+		{
+			ECSE_PROFILE_CPU("EntityManager");
+			mpEntityManager->Update();
+		}
 
-		return true;
+		mWriteSlot = (mWriteSlot + 1) % FRAME_SNAPSHOT_COUNT;
+
+		mFrameStats.GameMs = std::chrono::duration<double, std::milli>((renderStart - gameStart) + (Clock::now() - renderEnd)).count();
+		mFrameStats.RenderMs = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+		mFrameStats.WaitMs = 0.0;
 	}
 
-	void Engine::Shutdown()
+	/// <summary>
+	/// ゲームスレッドは更新とスナップショットの作成だけを行い、記録と送信は描画スレッドに任せる
+	/// </summary>
+	void Engine::RunPipelined()
 	{
-		if (mIsInitialized == false) return;
+		const auto gameStart = std::chrono::steady_clock::now();
 
-		ECSE_LOG(ELogLevel::Log, "Engine Shutdown.");
+		{
+			//	このスレッドの区間は描画スレッドが解決するフレームの "Game" の下に並ぶ
+			ECSE_PROFILE_CPU("Update");
 
-		if(mpImGui->IsCreated()) mpImGui->Release();
-		Window::Release();
-		mIsInitialized = false;
+			// 状態更新
+#if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
+			mpImGui->NewFrame();
+			{
+				ECSE_PROFILE_CPU("ImGui");
+				mpImGui->Update();
+			}
+#endif
+
+			//	エンティティの削除
+			{
+				ECSE_PROFILE_CPU("EntityManager");
+				mpEntityManager->Update();
+			}
+
+			this->UpdateStages();
+
+			//	描画スレッドに渡す情報の確定。もう片方は描画スレッドが読んでいる
+			{
+				ECSE_PROFILE_CPU("RenderWorld::Extract");
+				mpRenderWorld->Extract(mWriteSlot);
+			}
+			FrameSnapshot& snapshot = mSnapshots[mWriteSlot];
+			snapshot.Width = mpWindow->GetWidth();
+			snapshot.Height = mpWindow->GetHeight();
+#if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
+			mpImGui->CaptureDrawData(mWriteSlot);
+#endif
+		}
+
+		mFrameStats.GameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gameStart).count();
+
+		//	前のフレームの描画完了を待ってから渡す
+		mRenderThread.Kick(mWriteSlot);
+		mWriteSlot = (mWriteSlot + 1) % FRAME_SNAPSHOT_COUNT;
+
+		mFrameStats.RenderMs = mRenderThread.GetLastRenderMs();
+		mFrameStats.WaitMs = mRenderThread.GetLastWaitMs();
+	}
+
+	/// <summary>
+	/// 直列とパイプラインで共通の更新（素材、コルーチン、システム、テクスチャ）
+	/// </summary>
+	void Engine::UpdateStages()
+	{
+		//	変わった素材の焼き直しと、読み直した素材の差し替え・読み込みが終わった素材のコールバック
+		{
+			ECSE_PROFILE_CPU("AssetManager");
+			if (mpAssetHotReloader != nullptr) mpAssetHotReloader->Update();
+			mpAssetManager->Update();
+		}
+
+		//	GPU のフェンスに届いたものと次のフレームを待っていたコルーチンの再開
+		{
+			ECSE_PROFILE_CPU("TaskScheduler");
+			mpTaskScheduler->Update();
+		}
+
+		//	ゲームのシステム（競合しないものはワーカーで同時に動く。前のフレームの時間を経過時間にする）
+		{
+			ECSE_PROFILE_CPU("SystemScheduler");
+			mpSystemScheduler->Update(static_cast<float>(mFrameStats.FrameMs / 1000.0));
+		}
+
+		//	届いたテクスチャの差し替えと転送
+		{
+			ECSE_PROFILE_CPU("TextureStreaming");
+			mpTextureLoader->Update();
+			mpTextureStreamer->Update();
+		}
+	}
+
+	/// <summary>
+	/// スナップショット1つ分の記録と送信（描画スレッド）
+	/// </summary>
+	void Engine::RenderSnapshot(uint32_t Slot)
+	{
+		const FrameSnapshot& snapshot = mSnapshots[Slot];
+
+		this->BeginRecording(snapshot.Width, snapshot.Height);
+
+#if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
+		{
+			ECSE_PROFILE_CPU("ImGui");
+			ECSE_PROFILE_GPU("ImGui");
+			mpImGui->RenderCapturedDrawData(Slot);
+		}
+#endif
+
+		this->EndRecording();
 	}
 
 	void Engine::NewFrame()
 	{
-		mpDX12->BegineRendering();
-		mpDX12->SetViewPort(0, 0, mpWindow->GetWidth(), mpWindow->GetHeight());
+		this->BeginRecording(mpWindow->GetWidth(), mpWindow->GetHeight());
 #if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
 		mpImGui->NewFrame();
 #endif
@@ -133,9 +427,31 @@ namespace Ecse::System
 	{
 		// ImGuiのRenderなどもここに呼ぶ
 #if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED
-		mpImGui->EndFrame();
+		{
+			ECSE_PROFILE_CPU("ImGui");
+			ECSE_PROFILE_GPU("ImGui");
+			mpImGui->EndFrame();
+		}
 #endif
+		this->EndRecording();
+	}
+
+	/// <summary>
+	/// コマンドの記録開始
+	/// </summary>
+	void Engine::BeginRecording(int Width, int Height)
+	{
+		mpDX12->BegineRendering();
+		mpDX12->SetViewPort(static_cast<float>(Width), static_cast<float>(Height));
+		mpProfiler->BeginFrame(mpDX12->GetFrameIndex(), mpDX12->GetCommandList());
+	}
+
+	/// <summary>
+	/// コマンドの送信と画面のフリップ
+	/// </summary>
+	void Engine::EndRecording()
+	{
+		mpProfiler->EndFrame(mpDX12->GetCommandList());
 		mpDX12->Flip();
 	}
 }
-
@@ -0,0 +1,1057 @@
+﻿#include "pch.h"
+#include<System/IO/AsyncFileIO.hpp>
+
+#if !defined(_WIN32)
+#include<cerrno>
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+#if defined(__linux__)
+#include<linux/io_uring.h>
+#include<sys/eventfd.h>
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#endif
+
+#include<algorithm>
+#include<cstring>
+#include<iterator>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		constexpr uint32_t SLOT_BITS = 16;
+		constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+		uint32_t MakeHandle(uint32_t Index, uint16_t Generation)
+		{
+			return (static_cast<uint32_t>(Generation) << SLOT_BITS) | Index;
+		}
+
+		/// <summary>
+		/// 位置を指定して同期で読む（Threads 用）
+		/// </summary>
+		/// <returns>読めた大きさ（失敗なら IAsyncIOBackend::RESULT_FAILED）</returns>
+		int64_t ReadAt(intptr_t Native, uint64_t Offset, uint8_t* pBuffer, uint32_t Size)
+		{
+#if defined(_WIN32)
+			//	ファイルは FILE_FLAG_OVERLAPPED で開いているので、自分のイベントで完了を待つ
+			thread_local const HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = static_cast<DWORD>(Offset);
+			overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+			overlapped.hEvent = event;
+
+			DWORD read = 0;
+			if (ReadFile(reinterpret_cast<HANDLE>(Native), pBuffer, Size, nullptr, &overlapped) == FALSE && GetLastError() != ERROR_IO_PENDING)
+			{
+				return GetLastError() == ERROR_HANDLE_EOF ? 0 : IAsyncIOBackend::RESULT_FAILED;
+			}
+			if (GetOverlappedResult(reinterpret_cast<HANDLE>(Native), &overlapped, &read, TRUE) == FALSE)
+			{
+				return GetLastError() == ERROR_HANDLE_EOF ? 0 : IAsyncIOBackend::RESULT_FAILED;
+			}
+			return read;
+#else
+			while (true)
+			{
+				const ssize_t read = pread(static_cast<int>(Native), pBuffer, Size, static_cast<off_t>(Offset));
+				if (read >= 0) return read;
+				if (errno != EINTR) return IAsyncIOBackend::RESULT_FAILED;
+			}
+#endif
+		}
+
+		/// <summary>
+		/// 専用のスレッドで同期読み込みする（io_uring も IOCP も使えない時）
+		/// </summary>
+		class ThreadBackend final : public IAsyncIOBackend
+		{
+		public:
+			~ThreadBackend() override
+			{
+				{
+					std::lock_guard lock(mMutex);
+					mIsExitRequested = true;
+				}
+				mWorkCondition.notify_all();
+				for (std::thread& thread : mThreads) thread.join();
+			}
+
+			bool Initialize(uint32_t ThreadCount)
+			{
+				ThreadCount = std::max(ThreadCount, 1u);
+				for (uint32_t i = 0; i < ThreadCount; ++i)
+				{
+					mThreads.emplace_back(&ThreadBackend::WorkerMain, this);
+				}
+				return true;
+			}
+
+			bool Attach(intptr_t) override
+			{
+				return true;
+			}
+
+			bool Submit(uint32_t Slot, intptr_t Native, uint64_t Offset, uint8_t* pBuffer, uint32_t Size) override
+			{
+				{
+					std::lock_guard lock(mMutex);
+					mQueue.push_back({ Slot, Native, Offset, pBuffer, Size });
+				}
+				mWorkCondition.notify_one();
+				return true;
+			}
+
+			void Cancel(uint32_t Slot, intptr_t) override
+			{
+				//	まだ読み始めていなければ取り除く（読み始めたものは止められない）
+				std::lock_guard lock(mMutex);
+				auto it = std::find_if(mQueue.begin(), mQueue.end(), [Slot](const Operation& Op) { return Op.Slot == Slot; });
+				if (it == mQueue.end()) return;
+				mQueue.erase(it);
+				mDone.push_back({ Slot, RESULT_CANCELLED });
+				mDoneCondition.notify_one();
+			}
+
+			void WaitCompletions(std::vector<Completion>& Out) override
+			{
+				std::unique_lock lock(mMutex);
+				mDoneCondition.wait(lock, [this]() { return mDone.empty() == false || mWake == true; });
+				Out.insert(Out.end(), mDone.begin(), mDone.end());
+				mDone.clear();
+				mWake = false;
+			}
+
+			void Wake() override
+			{
+				{
+					std::lock_guard lock(mMutex);
+					mWake = true;
+				}
+				mDoneCondition.notify_one();
+			}
+
+		private:
+			struct Operation
+			{
+				uint32_t Slot;
+				intptr_t Native;
+				uint64_t Offset;
+				uint8_t* pBuffer;
+				uint32_t Size;
+			};
+
+			void WorkerMain()
+			{
+				std::unique_lock lock(mMutex);
+				while (true)
+				{
+					mWorkCondition.wait(lock, [this]() { return mQueue.empty() == false || mIsExitRequested == true; });
+					if (mIsExitRequested == true) return;
+
+					const Operation op = mQueue.front();
+					mQueue.pop_front();
+					lock.unlock();
+					const int64_t result = ReadAt(op.Native, op.Offset, op.pBuffer, op.Size);
+					lock.lock();
+
+					mDone.push_back({ op.Slot, result });
+					mDoneCondition.notify_one();
+				}
+			}
+
+			std::vector<std::thread> mThreads;
+			std::mutex mMutex;
+			//	読む順番待ちと、その通知
+			std::deque<Operation> mQueue;
+			std::condition_variable mWorkCondition;
+			//	完了と、その通知
+			std::vector<Completion> mDone;
+			std::condition_variable mDoneCondition;
+			bool mWake = false;
+			bool mIsExitRequested = false;
+		};
+
+#if defined(__linux__)
+		/// <summary>
+		/// io_uring（liburing を使わずにシステムコールを直接呼ぶ）
+		/// 投入と刈り取りは I/O スレッドだけが行う。Wake は eventfd への書き込みで、
+		/// eventfd の読み込みを常に1つ投入しておくことで WaitCompletions を起こす。
+		/// </summary>
+		class IoUringBackend final : public IAsyncIOBackend
+		{
+		public:
+			~IoUringBackend() override
+			{
+				if (mpSqes != nullptr) munmap(mpSqes, mSqeMapSize);
+				if (mpCqRing != nullptr && mpCqRing != mpSqRing) munmap(mpCqRing, mCqMapSize);
+				if (mpSqRing != nullptr) munmap(mpSqRing, mSqMapSize);
+				if (mRingFd >= 0) close(mRingFd);
+				if (mEventFd >= 0) close(mEventFd);
+			}
+
+			bool Initialize(uint32_t QueueDepth)
+			{
+				//	読み込みと取り消しが最大 QueueDepth 個ずつと、eventfd の読み込み
+				io_uring_params params = {};
+				mRingFd = static_cast<int>(syscall(__NR_io_uring_setup, QueueDepth * 2 + 2, &params));
+				if (mRingFd < 0) return false;
+
+				mSqMapSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+				mCqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if (singleMap) mSqMapSize = mCqMapSize = std::max(mSqMapSize, mCqMapSize);
+
+				void* sqRing = mmap(nullptr, mSqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQ_RING);
+				if (sqRing == MAP_FAILED) return false;
+				mpSqRing = static_cast<uint8_t*>(sqRing);
+
+				if (singleMap)
+				{
+					mpCqRing = mpSqRing;
+				}
+				else
+				{
+					void* cqRing = mmap(nullptr, mCqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_CQ_RING);
+					if (cqRing == MAP_FAILED) return false;
+					mpCqRing = static_cast<uint8_t*>(cqRing);
+				}
+
+				mSqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+				void* sqes = mmap(nullptr, mSqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQES);
+				if (sqes == MAP_FAILED) return false;
+				mpSqes = static_cast<io_uring_sqe*>(sqes);
+
+				mpSqTail = reinterpret_cast<uint32_t*>(mpSqRing + params.sq_off.tail);
+				mpSqHead = reinterpret_cast<uint32_t*>(mpSqRing + params.sq_off.head);
+				mSqMask = *reinterpret_cast<uint32_t*>(mpSqRing + params.sq_off.ring_mask);
+				mSqEntries = params.sq_entries;
+				mpSqArray = reinterpret_cast<uint32_t*>(mpSqRing + params.sq_off.array);
+				mSqTail = *mpSqTail;
+				mpCqHead = reinterpret_cast<uint32_t*>(mpCqRing + params.cq_off.head);
+				mpCqTail = reinterpret_cast<uint32_t*>(mpCqRing + params.cq_off.tail);
+				mCqMask = *reinterpret_cast<uint32_t*>(mpCqRing + params.cq_off.ring_mask);
+				mpCqes = reinterpret_cast<io_uring_cqe*>(mpCqRing + params.cq_off.cqes);
+
+				mEventFd = eventfd(0, EFD_CLOEXEC);
+				if (mEventFd < 0) return false;
+				ArmWake();
+
+				//	IORING_OP_READ が無い古いカーネル（5.6 未満）では使わない
+				Flush(0);
+				std::vector<Completion> probe;
+				Reap(probe);
+				return mIsReadSupported;
+			}
+
+			bool Attach(intptr_t) override
+			{
+				return true;
+			}
+
+			bool Submit(uint32_t Slot, intptr_t Native, uint64_t Offset, uint8_t* pBuffer, uint32_t Size) override
+			{
+				io_uring_sqe* sqe = NextSqe();
+				if (sqe == nullptr) return false;
+				sqe->opcode = IORING_OP_READ;
+				sqe->fd = static_cast<int>(Native);
+				sqe->off = Offset;
+				sqe->addr = reinterpret_cast<uint64_t>(pBuffer);
+				sqe->len = Size;
+				sqe->user_data = Slot;
+				return true;
+			}
+
+			void Cancel(uint32_t Slot, intptr_t) override
+			{
+				io_uring_sqe* sqe = NextSqe();
+				if (sqe == nullptr) return;
+				sqe->opcode = IORING_OP_ASYNC_CANCEL;
+				sqe->fd = -1;
+				sqe->addr = Slot;
+				sqe->user_data = CANCEL_TAG;
+			}
+
+			void WaitCompletions(std::vector<Completion>& Out) override
+			{
+				//	先に渡しておく（取り消しは、刈り取ってスロットが使い回される前に届いていなければならない）
+				Flush(0);
+				while (true)
+				{
+					if (Reap(Out) == true) break;
+					//	完了が1つ来るまで待つ
+					Flush(1);
+				}
+			}
+
+			void Wake() override
+			{
+				const uint64_t value = 1;
+				[[maybe_unused]] const ssize_t written = write(mEventFd, &value, sizeof(value));
+			}
+
+		private:
+			//	読み込み以外の完了の目印
+			static constexpr uint64_t WAKE_TAG = ~0ull;
+			static constexpr uint64_t CANCEL_TAG = ~0ull - 1;
+
+			io_uring_sqe* NextSqe()
+			{
+				const uint32_t head = std::atomic_ref<uint32_t>(*mpSqHead).load(std::memory_order_acquire);
+				if (mSqTail - head >= mSqEntries)
+				{
+					//	いっぱいなら先に渡してしまう
+					Flush(0);
+					if (mSqTail - std::atomic_ref<uint32_t>(*mpSqHead).load(std::memory_order_acquire) >= mSqEntries) return nullptr;
+				}
+
+				const uint32_t index = mSqTail & mSqMask;
+				io_uring_sqe* sqe = &mpSqes[index];
+				std::memset(sqe, 0, sizeof(*sqe));
+				mpSqArray[index] = index;
+				++mSqTail;
+				std::atomic_ref<uint32_t>(*mpSqTail).store(mSqTail, std::memory_order_release);
+				++mToSubmit;
+				return sqe;
+			}
+
+			void ArmWake()
+			{
+				io_uring_sqe* sqe = NextSqe();
+				if (sqe == nullptr) return;
+				sqe->opcode = IORING_OP_READ;
+				sqe->fd = mEventFd;
+				sqe->addr = reinterpret_cast<uint64_t>(&mWakeValue);
+				sqe->len = sizeof(mWakeValue);
+				sqe->user_data = WAKE_TAG;
+			}
+
+			//	溜まった投入を渡し、MinComplete 個の完了まで待つ
+			void Flush(uint32_t MinComplete)
+			{
+				if (mToSubmit == 0 && MinComplete == 0) return;
+				const uint32_t flags = MinComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+				while (true)
+				{
+					const long result = syscall(__NR_io_uring_enter, mRingFd, mToSubmit, MinComplete, flags, nullptr, 0);
+					if (result >= 0)
+					{
+						mToSubmit -= static_cast<uint32_t>(std::min<long>(result, mToSubmit));
+						return;
+					}
+					//	EAGAIN や EBUSY（完了の列があふれそう）は刈り取ってから次の回で渡し直す
+					if (errno != EINTR) return;
+				}
+			}
+
+			//	完了を全て取り出す（読み込みの完了か Wake があれば true）
+			bool Reap(std::vector<Completion>& Out)
+			{
+				bool received = false;
+				uint32_t head = *mpCqHead;
+				const uint32_t tail = std::atomic_ref<uint32_t>(*mpCqTail).load(std::memory_order_acquire);
+				for (; head != tail; ++head)
+				{
+					const io_uring_cqe& cqe = mpCqes[head & mCqMask];
+					if (cqe.user_data == WAKE_TAG)
+					{
+						if (cqe.res == -EINVAL) mIsReadSupported = false;
+						ArmWake();
+						received = true;
+					}
+					else if (cqe.user_data != CANCEL_TAG)
+					{
+						int64_t result = cqe.res;
+						if (result == -ECANCELED || result == -EINTR) result = RESULT_CANCELLED;
+						else if (result < 0) result = RESULT_FAILED;
+						Out.push_back({ static_cast<uint32_t>(cqe.user_data), result });
+						received = true;
+					}
+				}
+				std::atomic_ref<uint32_t>(*mpCqHead).store(head, std::memory_order_release);
+				return received;
+			}
+
+			int mRingFd = -1;
+			int mEventFd = -1;
+			uint64_t mWakeValue = 0;
+			bool mIsReadSupported = true;
+			//	投入側
+			uint8_t* mpSqRing = nullptr;
+			size_t mSqMapSize = 0;
+			io_uring_sqe* mpSqes = nullptr;
+			size_t mSqeMapSize = 0;
+			uint32_t* mpSqHead = nullptr;
+			uint32_t* mpSqTail = nullptr;
+			uint32_t* mpSqArray = nullptr;
+			uint32_t mSqMask = 0;
+			uint32_t mSqEntries = 0;
+			uint32_t mSqTail = 0;
+			uint32_t mToSubmit = 0;
+			//	完了側
+			uint8_t* mpCqRing = nullptr;
+			size_t mCqMapSize = 0;
+			uint32_t* mpCqHead = nullptr;
+			uint32_t* mpCqTail = nullptr;
+			io_uring_cqe* mpCqes = nullptr;
+			uint32_t mCqMask = 0;
+		};
+#endif
+
+#if defined(_WIN32)
+		/// <summary>
+		/// I/O 完了ポート
+		/// OVERLAPPED は要求のスロットごとに持ち、完了した OVERLAPPED の位置からスロット番号を求める。
+		/// </summary>
+		class IocpBackend final : public IAsyncIOBackend
+		{
+		public:
+			~IocpBackend() override
+			{
+				if (mPort != nullptr) CloseHandle(mPort);
+			}
+
+			bool Initialize(uint32_t SlotCount)
+			{
+				mPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+				if (mPort == nullptr) return false;
+				mOverlapped.resize(SlotCount);
+				return true;
+			}
+
+			bool Attach(intptr_t Native) override
+			{
+				const HANDLE file = reinterpret_cast<HANDLE>(Native);
+				if (CreateIoCompletionPort(file, mPort, FILE_KEY, 0) == nullptr) return false;
+				SetFileCompletionNotificationModes(file, FILE_SKIP_SET_EVENT_ON_HANDLE);
+				return true;
+			}
+
+			bool Submit(uint32_t Slot, intptr_t Native, uint64_t Offset, uint8_t* pBuffer, uint32_t Size) override
+			{
+				OVERLAPPED& overlapped = mOverlapped[Slot];
+				overlapped = {};
+				overlapped.Offset = static_cast<DWORD>(Offset);
+				overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+				if (ReadFile(reinterpret_cast<HANDLE>(Native), pBuffer, Size, nullptr, &overlapped) == FALSE)
+				{
+					const DWORD error = GetLastError();
+					if (error == ERROR_IO_PENDING) return true;
+					//	終わりより後ろはポートに届かないので、ここで完了にする
+					if (error == ERROR_HANDLE_EOF)
+					{
+						mImmediate.push_back({ Slot, 0 });
+						return true;
+					}
+					return false;
+				}
+				return true;
+			}
+
+			void Cancel(uint32_t Slot, intptr_t Native) override
+			{
+				CancelIoEx(reinterpret_cast<HANDLE>(Native), &mOverlapped[Slot]);
+			}
+
+			void WaitCompletions(std::vector<Completion>& Out) override
+			{
+				Out.insert(Out.end(), mImmediate.begin(), mImmediate.end());
+				mImmediate.clear();
+
+				OVERLAPPED_ENTRY entries[64];
+				ULONG count = 0;
+				if (GetQueuedCompletionStatusEx(mPort, entries, static_cast<ULONG>(std::size(entries)), &count, Out.empty() ? INFINITE : 0, FALSE) == FALSE)
+				{
+					return;
+				}
+
+				for (ULONG i = 0; i < count; ++i)
+				{
+					const OVERLAPPED_ENTRY& entry = entries[i];
+					if (entry.lpCompletionKey == WAKE_KEY || entry.lpOverlapped == nullptr) continue;
+
+					const uint32_t slot = static_cast<uint32_t>(entry.lpOverlapped - mOverlapped.data());
+					//	Internal は NTSTATUS
+					const ULONG_PTR status = entry.lpOverlapped->Internal;
+					int64_t result = entry.dwNumberOfBytesTransferred;
+					if (status == NT_STATUS_END_OF_FILE) result = 0;
+					else if (status == NT_STATUS_CANCELLED) result = RESULT_CANCELLED;
+					else if (status != 0) result = RESULT_FAILED;
+					Out.push_back({ slot, result });
+				}
+			}
+
+			void Wake() override
+			{
+				PostQueuedCompletionStatus(mPort, 0, WAKE_KEY, nullptr);
+			}
+
+		private:
+			static constexpr ULONG_PTR FILE_KEY = 1;
+			static constexpr ULONG_PTR WAKE_KEY = 2;
+			static constexpr ULONG_PTR NT_STATUS_END_OF_FILE = 0xC0000011;
+			static constexpr ULONG_PTR NT_STATUS_CANCELLED = 0xC0000120;
+
+			HANDLE mPort = nullptr;
+			std::vector<OVERLAPPED> mOverlapped;
+			//	ReadFile がその場で終わったもの（I/O スレッドだけが触る）
+			std::vector<Completion> mImmediate;
+		};
+#endif
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void AsyncFileIO::OnCreate()
+	{
+		mpBackend = nullptr;
+		mBackendType = EAsyncIOBackend::Threads;
+		mQueueDepth = DEFAULT_QUEUE_DEPTH;
+		mPendingCount = 0;
+		mInFlightCount = 0;
+		mStats = {};
+		mWakeRequested = false;
+		mIsExitRequested = false;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void AsyncFileIO::OnDestroy()
+	{
+		this->Stop();
+	}
+
+	/// <summary>
+	/// 仕組みを選んで I/O スレッドを起動する
+	/// </summary>
+	/// <param name="Backend">使う仕組み（使えなければ Threads にする）</param>
+	/// <param name="QueueDepth">OS に同時に渡す数</param>
+	/// <param name="ThreadCount">Threads の時の読み込みスレッドの数</param>
+	/// <returns>true:成功</returns>
+	bool AsyncFileIO::Initialize(EAsyncIOBackend Backend, uint32_t QueueDepth, uint32_t ThreadCount)
+	{
+		if (mpBackend != nullptr) return false;
+
+		mQueueDepth = std::clamp(QueueDepth, 1u, MAX_REQUESTS);
+		if (Backend == EAsyncIOBackend::Auto)
+		{
+#if defined(_WIN32)
+			Backend = EAsyncIOBackend::Iocp;
+#elif defined(__linux__)
+			Backend = EAsyncIOBackend::IoUring;
+#else
+			Backend = EAsyncIOBackend::Threads;
+#endif
+		}
+
+#if defined(__linux__)
+		if (Backend == EAsyncIOBackend::IoUring)
+		{
+			auto backend = std::make_unique<IoUringBackend>();
+			if (backend->Initialize(mQueueDepth))
+			{
+				mpBackend = std::move(backend);
+				mBackendType = EAsyncIOBackend::IoUring;
+			}
+			else
+			{
+				//	コンテナなどで io_uring が禁止されていることがある
+				ECSE_LOG(ELogLevel::Warning, "AsyncFileIO: io_uring is not available. Falling back to threads.");
+			}
+		}
+#endif
+#if defined(_WIN32)
+		if (Backend == EAsyncIOBackend::Iocp)
+		{
+			auto backend = std::make_unique<IocpBackend>();
+			if (backend->Initialize(MAX_REQUESTS))
+			{
+				mpBackend = std::move(backend);
+				mBackendType = EAsyncIOBackend::Iocp;
+			}
+			else
+			{
+				ECSE_LOG(ELogLevel::Warning, "AsyncFileIO: Failed CreateIoCompletionPort. Falling back to threads.");
+			}
+		}
+#endif
+		if (mpBackend == nullptr)
+		{
+			auto backend = std::make_unique<ThreadBackend>();
+			backend->Initialize(ThreadCount);
+			mpBackend = std::move(backend);
+			mBackendType = EAsyncIOBackend::Threads;
+		}
+
+		mRequests.resize(MAX_REQUESTS);
+		mFreeRequests.reserve(MAX_REQUESTS);
+		for (uint32_t i = MAX_REQUESTS; i > 0; --i) mFreeRequests.push_back(i - 1);
+		mFiles.resize(MAX_FILES);
+		mFreeFiles.reserve(MAX_FILES);
+		for (uint32_t i = MAX_FILES; i > 0; --i) mFreeFiles.push_back(i - 1);
+
+		mIsExitRequested = false;
+		mIoThread = std::thread(&AsyncFileIO::IoThreadMain, this);
+
+		static constexpr const char* BACKEND_NAMES[] = { "Auto", "io_uring", "IOCP", "Threads" };
+		ECSE_LOG(ELogLevel::Log, "AsyncFileIO: {} (queue depth {}).", BACKEND_NAMES[static_cast<uint32_t>(mBackendType)], mQueueDepth);
+		return true;
+	}
+
+	/// <summary>
+	/// 読み込み用に開く
+	/// </summary>
+	/// <returns>ハンドル（開けなければ INVALID_ASYNC_FILE_HANDLE）</returns>
+	AsyncFileHandle AsyncFileIO::OpenFile(const std::filesystem::path& Path)
+	{
+		if (mpBackend == nullptr) return INVALID_ASYNC_FILE_HANDLE;
+
+#if defined(_WIN32)
+		const HANDLE file = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			ECSE_LOG(ELogLevel::Error, "AsyncFileIO: Failed CreateFile ({}).", Path.string());
+			return INVALID_ASYNC_FILE_HANDLE;
+		}
+		LARGE_INTEGER size = {};
+		GetFileSizeEx(file, &size);
+		const intptr_t native = reinterpret_cast<intptr_t>(file);
+		const uint64_t fileSize = static_cast<uint64_t>(size.QuadPart);
+		const auto closeNative = [file]() { CloseHandle(file); };
+#else
+		const int file = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+		{
+			ECSE_LOG(ELogLevel::Error, "AsyncFileIO: Failed open ({}).", Path.string());
+			return INVALID_ASYNC_FILE_HANDLE;
+		}
+		struct stat status = {};
+		fstat(file, &status);
+		const intptr_t native = file;
+		const uint64_t fileSize = static_cast<uint64_t>(status.st_size);
+		const auto closeNative = [file]() { close(file); };
+#endif
+
+		if (mpBackend->Attach(native) == false)
+		{
+			ECSE_LOG(ELogLevel::Error, "AsyncFileIO: Failed to attach ({}).", Path.string());
+			closeNative();
+			return INVALID_ASYNC_FILE_HANDLE;
+		}
+
+		std::lock_guard lock(mMutex);
+		if (mFreeFiles.empty())
+		{
+			ECSE_LOG(ELogLevel::Error, "AsyncFileIO: Too many open files ({}).", Path.string());
+			closeNative();
+			return INVALID_ASYNC_FILE_HANDLE;
+		}
+
+		const uint32_t index = mFreeFiles.back();
+		mFreeFiles.pop_back();
+		FileSlot& slot = mFiles[index];
+		slot.Native = native;
+		slot.Size = fileSize;
+		slot.IsOpen = true;
+		return MakeHandle(index, slot.Generation);
+	}
+
+	/// <summary>
+	/// 閉じる（読み込み中の要求が無いこと）
+	/// </summary>
+	void AsyncFileIO::CloseFile(AsyncFileHandle File)
+	{
+		std::lock_guard lock(mMutex);
+		const uint32_t index = File & SLOT_MASK;
+		if (index >= mFiles.size()) return;
+		FileSlot& slot = mFiles[index];
+		if (slot.IsOpen == false || slot.Generation != static_cast<uint16_t>(File >> SLOT_BITS)) return;
+
+#if defined(_WIN32)
+		CloseHandle(reinterpret_cast<HANDLE>(slot.Native));
+#else
+		close(static_cast<int>(slot.Native));
+#endif
+		slot.Native = -1;
+		slot.Size = 0;
+		slot.IsOpen = false;
+		slot.Generation++;
+		if (slot.Generation == 0) slot.Generation = 1;
+		mFreeFiles.push_back(index);
+	}
+
+	/// <summary>
+	/// ファイルの大きさ（バイト）
+	/// </summary>
+	uint64_t AsyncFileIO::GetFileSize(AsyncFileHandle File) const
+	{
+		std::lock_guard lock(mMutex);
+		const uint32_t index = File & SLOT_MASK;
+		if (index >= mFiles.size()) return 0;
+		const FileSlot& slot = mFiles[index];
+		if (slot.IsOpen == false || slot.Generation != static_cast<uint16_t>(File >> SLOT_BITS)) return 0;
+		return slot.Size;
+	}
+
+	/// <summary>
+	/// 読み込みを要求する（すぐに返る）
+	/// </summary>
+	/// <returns>ハンドル（受け付けられなければ INVALID_ASYNC_READ_HANDLE）</returns>
+	AsyncReadHandle AsyncFileIO::Read(AsyncReadRequest Request)
+	{
+		AsyncReadHandle handle;
+		{
+			std::lock_guard lock(mMutex);
+			handle = Enqueue(Request);
+		}
+		if (handle != INVALID_ASYNC_READ_HANDLE && mWakeRequested.exchange(true) == false) mpBackend->Wake();
+		return handle;
+	}
+
+	/// <summary>
+	/// まとめて要求する（ロックと I/O スレッドの起こし直しが1回で済む）
+	/// </summary>
+	/// <param name="Requests">要求</param>
+	/// <param name="OutHandles">それぞれのハンドル（Requests と同じ数。受け付けられなかったものは INVALID_ASYNC_READ_HANDLE）</param>
+	/// <returns>受け付けた数</returns>
+	uint32_t AsyncFileIO::ReadBatch(std::span<AsyncReadRequest> Requests, std::span<AsyncReadHandle> OutHandles)
+	{
+		uint32_t accepted = 0;
+		{
+			std::lock_guard lock(mMutex);
+			for (size_t i = 0; i < Requests.size(); ++i)
+			{
+				const AsyncReadHandle handle = Enqueue(Requests[i]);
+				if (i < OutHandles.size()) OutHandles[i] = handle;
+				if (handle != INVALID_ASYNC_READ_HANDLE) ++accepted;
+			}
+		}
+		if (accepted > 0 && mWakeRequested.exchange(true) == false) mpBackend->Wake();
+		return accepted;
+	}
+
+	/// <summary>
+	/// 取り消す。順番待ちならすぐに、読み込み中なら OS が止められれば Cancelled で完了する
+	/// </summary>
+	/// <returns>true:まだ終わっていなかった</returns>
+	bool AsyncFileIO::Cancel(AsyncReadHandle Handle)
+	{
+		{
+			std::lock_guard lock(mMutex);
+			const uint32_t index = Handle & SLOT_MASK;
+			if (index >= mRequests.size()) return false;
+			RequestSlot& slot = mRequests[index];
+			if (slot.State == EAsyncReadState::Invalid || slot.Generation != static_cast<uint16_t>(Handle >> SLOT_BITS)) return false;
+			if (slot.CancelRequested == true) return true;
+
+			slot.CancelRequested = true;
+			mCancelled.push_back(index);
+		}
+		if (mWakeRequested.exchange(true) == false) mpBackend->Wake();
+		return true;
+	}
+
+	/// <summary>
+	/// 状態
+	/// </summary>
+	EAsyncReadState AsyncFileIO::GetState(AsyncReadHandle Handle) const
+	{
+		std::lock_guard lock(mMutex);
+		const uint32_t index = Handle & SLOT_MASK;
+		if (index >= mRequests.size()) return EAsyncReadState::Invalid;
+		const RequestSlot& slot = mRequests[index];
+		if (slot.Generation != static_cast<uint16_t>(Handle >> SLOT_BITS)) return EAsyncReadState::Invalid;
+		return slot.State;
+	}
+
+	/// <summary>
+	/// 完了する（コールバックを呼び終える）まで待つ（I/O スレッドのコールバックの中からは呼ばない）
+	/// </summary>
+	void AsyncFileIO::Wait(AsyncReadHandle Handle)
+	{
+		const uint32_t index = Handle & SLOT_MASK;
+		const uint16_t generation = static_cast<uint16_t>(Handle >> SLOT_BITS);
+
+		std::unique_lock lock(mMutex);
+		if (index >= mRequests.size()) return;
+		mCompletedCondition.wait(lock, [&]()
+			{
+				const RequestSlot& slot = mRequests[index];
+				return slot.State == EAsyncReadState::Invalid || slot.Generation != generation;
+			});
+	}
+
+	/// <summary>
+	/// 全ての要求が完了するまで待つ
+	/// </summary>
+	void AsyncFileIO::WaitIdle()
+	{
+		std::unique_lock lock(mMutex);
+		mCompletedCondition.wait(lock, [this]() { return mPendingCount == 0 && mInFlightCount == 0; });
+	}
+
+	/// <summary>
+	/// 使っている仕組み
+	/// </summary>
+	EAsyncIOBackend AsyncFileIO::GetBackend() const
+	{
+		return mBackendType;
+	}
+
+	/// <summary>
+	/// 今までの合計
+	/// </summary>
+	AsyncFileIOStats AsyncFileIO::GetStats() const
+	{
+		std::lock_guard lock(mMutex);
+		AsyncFileIOStats stats = mStats;
+		stats.Pending = mPendingCount;
+		stats.InFlight = mInFlightCount;
+		return stats;
+	}
+
+	/// <summary>
+	/// 1つ受け付ける（mMutex を持って呼ぶ）
+	/// </summary>
+	AsyncReadHandle AsyncFileIO::Enqueue(AsyncReadRequest& Request)
+	{
+		if (mpBackend == nullptr || mIsExitRequested == true) return INVALID_ASYNC_READ_HANDLE;
+
+		const uint32_t fileIndex = Request.File & SLOT_MASK;
+		if (fileIndex >= mFiles.size()) return INVALID_ASYNC_READ_HANDLE;
+		const FileSlot& file = mFiles[fileIndex];
+		if (file.IsOpen == false || file.Generation != static_cast<uint16_t>(Request.File >> SLOT_BITS)) return INVALID_ASYNC_READ_HANDLE;
+
+		if (mFreeRequests.empty())
+		{
+			ECSE_LOG(ELogLevel::Warning, "AsyncFileIO: Too many requests.");
+			return INVALID_ASYNC_READ_HANDLE;
+		}
+
+		const uint32_t index = mFreeRequests.back();
+		mFreeRequests.pop_back();
+		RequestSlot& slot = mRequests[index];
+		slot.Native = file.Native;
+		slot.Offset = Request.Offset;
+		slot.pBuffer = Request.Buffer.data();
+		slot.Size = Request.Buffer.size();
+		slot.Done = 0;
+		slot.OnComplete = std::move(Request.OnComplete);
+		slot.QueuedAt = std::chrono::steady_clock::now();
+		slot.State = EAsyncReadState::Pending;
+		slot.CancelRequested = false;
+
+		mPending[static_cast<uint32_t>(Request.Priority)].push_back(index);
+		mPendingCount++;
+		mStats.Submitted++;
+		return MakeHandle(index, slot.Generation);
+	}
+
+	/// <summary>
+	/// I/O スレッド本体
+	/// 取り消しの処理 → 優先度順に OS へ渡す → 完了を待つ → コールバック、を繰り返す。
+	/// 読み込み中のスロットの中身は I/O スレッドだけが触るので、OS に渡す時と完了の時はロックを持たない。
+	/// </summary>
+	void AsyncFileIO::IoThreadMain()
+	{
+		//	完了させるもの
+		struct Finished
+		{
+			uint32_t Slot;
+			EAsyncReadResult Result;
+			bool WasInFlight;
+		};
+
+		std::vector<uint32_t> toSubmit;
+		std::vector<uint32_t> toCancel;
+		std::vector<Finished> finished;
+		std::vector<IAsyncIOBackend::Completion> completions;
+
+		//	残りを1回分（MAX_READ_SIZE まで）渡す
+		const auto submit = [this](uint32_t Index)
+			{
+				RequestSlot& slot = mRequests[Index];
+				const uint32_t size = static_cast<uint32_t>(std::min<uint64_t>(slot.Size - slot.Done, MAX_READ_SIZE));
+				return mpBackend->Submit(Index, slot.Native, slot.Offset + slot.Done, slot.pBuffer + slot.Done, size);
+			};
+
+		//	コールバックを呼んでからスロットを返す
+		const auto finish = [this](const Finished& Item)
+			{
+				RequestSlot& slot = mRequests[Item.Slot];
+				AsyncReadCompletion completion;
+				completion.Handle = MakeHandle(Item.Slot, slot.Generation);
+				completion.Result = Item.Result;
+				completion.BytesRead = slot.Done;
+				completion.LatencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.QueuedAt).count();
+				auto callback = std::move(slot.OnComplete);
+				slot.OnComplete = nullptr;
+				if (callback) callback(completion);
+
+				{
+					std::lock_guard lock(mMutex);
+					(Item.WasInFlight ? mInFlightCount : mPendingCount)--;
+					switch (Item.Result)
+					{
+					case EAsyncReadResult::Succeeded: mStats.Succeeded++; break;
+					case EAsyncReadResult::Failed: mStats.Failed++; break;
+					case EAsyncReadResult::Cancelled: mStats.Cancelled++; break;
+					}
+					mStats.BytesRead += slot.Done;
+					slot.State = EAsyncReadState::Invalid;
+					slot.Generation++;
+					if (slot.Generation == 0) slot.Generation = 1;
+					mFreeRequests.push_back(Item.Slot);
+				}
+				mCompletedCondition.notify_all();
+			};
+
+		while (true)
+		{
+			mWakeRequested.store(false);
+			{
+				std::lock_guard lock(mMutex);
+
+				//	取り消し（順番待ちはその場で完了、読み込み中は OS に頼む）
+				for (const uint32_t index : mCancelled)
+				{
+					RequestSlot& slot = mRequests[index];
+					if (slot.State == EAsyncReadState::Pending)
+					{
+						for (std::deque<uint32_t>& queue : mPending)
+						{
+							auto it = std::find(queue.begin(), queue.end(), index);
+							if (it != queue.end())
+							{
+								queue.erase(it);
+								break;
+							}
+						}
+						finished.push_back({ index, EAsyncReadResult::Cancelled, false });
+					}
+					else if (slot.State == EAsyncReadState::InFlight)
+					{
+						toCancel.push_back(index);
+					}
+				}
+				mCancelled.clear();
+
+				//	優先度の高いものから空いている分だけ渡す
+				if (mIsExitRequested == false)
+				{
+					for (std::deque<uint32_t>& queue : mPending)
+					{
+						while (queue.empty() == false && mInFlightCount < mQueueDepth)
+						{
+							const uint32_t index = queue.front();
+							queue.pop_front();
+							mRequests[index].State = EAsyncReadState::InFlight;
+							mPendingCount--;
+							mInFlightCount++;
+							toSubmit.push_back(index);
+						}
+					}
+				}
+
+				//	終了要求の後は、取り消したものを全て完了させてから抜ける
+				if (mIsExitRequested == true && mInFlightCount == 0 && mPendingCount == 0 && finished.empty()) break;
+			}
+
+			for (const uint32_t index : toSubmit)
+			{
+				if (submit(index) == false) finished.push_back({ index, EAsyncReadResult::Failed, true });
+			}
+			toSubmit.clear();
+			for (const uint32_t index : toCancel)
+			{
+				mpBackend->Cancel(index, mRequests[index].Native);
+			}
+			toCancel.clear();
+
+			//	状態が変わったら待たずに最初からやり直す
+			if (finished.empty() == false)
+			{
+				for (const Finished& item : finished) finish(item);
+				finished.clear();
+				continue;
+			}
+
+			completions.clear();
+			mpBackend->WaitCompletions(completions);
+
+			for (const IAsyncIOBackend::Completion& completion : completions)
+			{
+				RequestSlot& slot = mRequests[completion.Slot];
+				if (completion.Result == IAsyncIOBackend::RESULT_CANCELLED)
+				{
+					finished.push_back({ completion.Slot, EAsyncReadResult::Cancelled, true });
+					continue;
+				}
+				if (completion.Result < 0)
+				{
+					finished.push_back({ completion.Slot, EAsyncReadResult::Failed, true });
+					continue;
+				}
+
+				slot.Done += static_cast<uint64_t>(completion.Result);
+				//	短く読めただけなら残りを渡し直す（0 ならファイルの終わり）
+				if (completion.Result > 0 && slot.Done < slot.Size && slot.CancelRequested == false)
+				{
+					if (submit(completion.Slot) == false) finished.push_back({ completion.Slot, EAsyncReadResult::Failed, true });
+					continue;
+				}
+				finished.push_back({ completion.Slot, slot.CancelRequested && slot.Done < slot.Size ? EAsyncReadResult::Cancelled : EAsyncReadResult::Succeeded, true });
+			}
+
+			for (const Finished& item : finished) finish(item);
+			finished.clear();
+		}
+	}
+
+	/// <summary>
+	/// I/O スレッドの停止とファイルを閉じる
+	/// 順番待ちと読み込み中の要求は全て取り消し、コールバックを呼び終えてから止める。
+	/// </summary>
+	void AsyncFileIO::Stop()
+	{
+		if (mpBackend == nullptr) return;
+
+		{
+			std::lock_guard lock(mMutex);
+			mIsExitRequested = true;
+			for (uint32_t i = 0; i < mRequests.size(); ++i)
+			{
+				RequestSlot& slot = mRequests[i];
+				if (slot.State == EAsyncReadState::Invalid || slot.CancelRequested == true) continue;
+				slot.CancelRequested = true;
+				mCancelled.push_back(i);
+			}
+		}
+		mpBackend->Wake();
+		if (mIoThread.joinable()) mIoThread.join();
+		mpBackend.reset();
+
+		for (FileSlot& file : mFiles)
+		{
+			if (file.IsOpen == false) continue;
+#if defined(_WIN32)
+			CloseHandle(reinterpret_cast<HANDLE>(file.Native));
+#else
+			close(static_cast<int>(file.Native));
+#endif
+			file = {};
+		}
+		mFiles.clear();
+		mFreeFiles.clear();
+		mRequests.clear();
+		mFreeRequests.clear();
+		for (std::deque<uint32_t>& queue : mPending) queue.clear();
+		mCancelled.clear();
+	}
+}
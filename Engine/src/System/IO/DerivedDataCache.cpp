@@ -0,0 +1,141 @@
+﻿#include "pch.h"
+#include<System/IO/DerivedDataCache.hpp>
+#include<Utility/Hash/Hash.hpp>
+
+#include<atomic>
+#include<fstream>
+#include<random>
+#include<thread>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		/// <summary>
+		/// 上位と下位で別の種を使い、128bit にする
+		/// </summary>
+		constexpr uint64_t HIGH_SEED = 0x45435345444443ull;
+		constexpr uint64_t LOW_SEED = 0x646463656373ull;
+	}
+
+	/// <summary>
+	/// 32 文字の16進数
+	/// </summary>
+	std::string DerivedDataKey::ToString() const
+	{
+		return std::format("{:016x}{:016x}", High, Low);
+	}
+
+	/// <summary>
+	/// 置き場所を決める（フォルダは最初の書き込みで作る）
+	/// </summary>
+	DerivedDataCache::DerivedDataCache(const std::filesystem::path& Root)
+		:mRoot(Root)
+	{
+	}
+
+	/// <summary>
+	/// キーを求める
+	/// </summary>
+	/// <param name="Source">元データ</param>
+	/// <param name="Recipe">作り方（設定と作る側のバージョンを全て含めた文字列）</param>
+	DerivedDataKey DerivedDataCache::MakeKey(std::span<const uint8_t> Source, std::string_view Recipe)
+	{
+		//	元データのハッシュと作り方を種に混ぜる（作り方だけが変わっても別のキーになる）
+		const uint64_t recipe = Utility::Hash64(Recipe);
+
+		DerivedDataKey key;
+		key.High = Utility::Hash64(Source, HIGH_SEED ^ recipe);
+		key.Low = Utility::Hash64(Source, LOW_SEED + recipe);
+		return key;
+	}
+
+	/// <summary>
+	/// 置いてあるか
+	/// </summary>
+	bool DerivedDataCache::Contains(const DerivedDataKey& Key) const
+	{
+		std::error_code error;
+		return std::filesystem::is_regular_file(GetPath(Key), error);
+	}
+
+	/// <summary>
+	/// 読み込む（なければ false）
+	/// </summary>
+	bool DerivedDataCache::Get(const DerivedDataKey& Key, std::vector<uint8_t>& OutBytes) const
+	{
+		std::ifstream file(GetPath(Key), std::ios::binary | std::ios::ate);
+		if (file.is_open() == false) return false;
+
+		const std::streamsize size = file.tellg();
+		if (size <= 0) return false;
+		file.seekg(0);
+
+		OutBytes.resize(static_cast<size_t>(size));
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(OutBytes.data()), size));
+	}
+
+	/// <summary>
+	/// 書き込む（既にあれば何もしない）
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool DerivedDataCache::Put(const DerivedDataKey& Key, std::span<const uint8_t> Bytes) const
+	{
+		if (Contains(Key) == true) return true;
+
+		const std::filesystem::path path = GetPath(Key);
+		std::error_code error;
+		std::filesystem::create_directories(path.parent_path(), error);
+		if (error)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "DerivedDataCache: Failed to create {}", path.parent_path().string());
+			return false;
+		}
+
+		//	書き終わるまで本来の名前では見えないようにする
+		//	一時ファイルの名前は、プロセスごとの乱数とスレッドと通し番号で他と重ならないようにする
+		static const uint32_t processTag = std::random_device()();
+		static std::atomic<uint64_t> temporaryCounter = 0;
+		const uint64_t counter = temporaryCounter.fetch_add(1, std::memory_order_relaxed);
+		const size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+		std::filesystem::path temporary = path;
+		temporary += std::format(".{:08x}.{:x}.{}.tmp", processTag, thread, counter);
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (file.is_open() == false ||
+				file.write(reinterpret_cast<const char*>(Bytes.data()), static_cast<std::streamsize>(Bytes.size())).good() == false)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "DerivedDataCache: Failed to write {}", temporary.string());
+				file.close();
+				std::filesystem::remove(temporary, error);
+				return false;
+			}
+		}
+
+		//	同じキーを先に誰かが置いていても中身は同じなので、どちらが残っても良い
+		std::filesystem::rename(temporary, path, error);
+		if (error)
+		{
+			std::filesystem::remove(temporary, error);
+			return Contains(Key);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// キーに対応するファイルの場所
+	/// </summary>
+	std::filesystem::path DerivedDataCache::GetPath(const DerivedDataKey& Key) const
+	{
+		const std::string name = Key.ToString();
+		return mRoot / name.substr(0, 2) / name;
+	}
+
+	/// <summary>
+	/// 置き場所
+	/// </summary>
+	const std::filesystem::path& DerivedDataCache::GetRoot() const
+	{
+		return mRoot;
+	}
+}
@@ -0,0 +1,346 @@
+﻿#include "pch.h"
+#include<System/IO/FileWatcher.hpp>
+
+#if defined(__linux__)
+#include<cerrno>
+#include<poll.h>
+#include<sys/eventfd.h>
+#include<sys/inotify.h>
+#include<unistd.h>
+#endif
+
+namespace Ecse::System
+{
+	namespace
+	{
+		//	UTF-8 の '/' 区切りの文字列にする
+		std::string ToGenericString(const std::filesystem::path& Path)
+		{
+			const std::u8string text = Path.generic_u8string();
+			return std::string(text.begin(), text.end());
+		}
+
+#if defined(__linux__)
+		//	見張る変化（書き終わり・名前の変更・削除。フォルダが増えた時に見張りを足すため作成も）
+		constexpr uint32_t INOTIFY_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+#endif
+	}
+
+	FileWatcher::FileWatcher()
+		:mRoot()
+		, mDebounce(DEFAULT_DEBOUNCE_MS)
+		, mWatchThread()
+		, mMutex()
+		, mPending()
+		, mWatches()
+		, mNative(-1)
+		, mWake(-1)
+		, mIsExitRequested(false)
+	{
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		this->Stop();
+	}
+
+	/// <summary>
+	/// 見張り始める
+	/// </summary>
+	/// <param name="Root">見張るフォルダ</param>
+	/// <param name="DebounceMs">同じファイルの変化をまとめる時間（ミリ秒）</param>
+	/// <returns>true:成功</returns>
+	bool FileWatcher::Start(const std::filesystem::path& Root, uint32_t DebounceMs)
+	{
+		Stop();
+
+		std::error_code error;
+		if (std::filesystem::is_directory(Root, error) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "FileWatcher: directory not found. ({})", Root.string());
+			return false;
+		}
+
+		mRoot = Root;
+		mDebounce = std::chrono::milliseconds(DebounceMs);
+		mIsExitRequested = false;
+
+#if defined(_WIN32)
+		const HANDLE directory = CreateFileW(mRoot.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (directory == INVALID_HANDLE_VALUE)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "FileWatcher: failed to open {}. (error {})", mRoot.string(), GetLastError());
+			return false;
+		}
+		mNative = reinterpret_cast<intptr_t>(directory);
+		mWake = reinterpret_cast<intptr_t>(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+#elif defined(__linux__)
+		mNative = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (mNative < 0)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "FileWatcher: inotify_init1 failed. (errno {})", errno);
+			mNative = -1;
+			return false;
+		}
+		mWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		AddWatchRecursive("", false);
+#else
+		ECSE_LOG(System::ELogLevel::Error, "FileWatcher: not supported on this platform.");
+		return false;
+#endif
+
+		mWatchThread = std::thread(&FileWatcher::WatchThreadMain, this);
+		return true;
+	}
+
+	/// <summary>
+	/// 見張りをやめる（まだ落ち着いていない変化は捨てる）
+	/// </summary>
+	void FileWatcher::Stop()
+	{
+		if (mWatchThread.joinable() == true)
+		{
+			mIsExitRequested = true;
+#if defined(_WIN32)
+			SetEvent(reinterpret_cast<HANDLE>(mWake));
+#elif defined(__linux__)
+			const uint64_t one = 1;
+			[[maybe_unused]] const ssize_t written = write(static_cast<int>(mWake), &one, sizeof(one));
+#endif
+			mWatchThread.join();
+		}
+
+#if defined(_WIN32)
+		if (mNative != -1) CloseHandle(reinterpret_cast<HANDLE>(mNative));
+		if (mWake != -1) CloseHandle(reinterpret_cast<HANDLE>(mWake));
+#elif defined(__linux__)
+		if (mNative != -1) close(static_cast<int>(mNative));
+		if (mWake != -1) close(static_cast<int>(mWake));
+#endif
+		mNative = -1;
+		mWake = -1;
+		mWatches.clear();
+
+		std::lock_guard lock(mMutex);
+		mPending.clear();
+	}
+
+	/// <summary>
+	/// 見張っているか
+	/// </summary>
+	bool FileWatcher::IsWatching() const
+	{
+		return mWatchThread.joinable();
+	}
+
+	/// <summary>
+	/// 見張っているフォルダ
+	/// </summary>
+	const std::filesystem::path& FileWatcher::GetRoot() const
+	{
+		return mRoot;
+	}
+
+	/// <summary>
+	/// 落ち着いた変化を取り出す（ゲームスレッドでフレームに1回）
+	/// </summary>
+	/// <param name="OutChanges">後ろに足す</param>
+	/// <returns>足した数</returns>
+	uint32_t FileWatcher::Poll(std::vector<FileChangeEvent>& OutChanges)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		uint32_t count = 0;
+
+		std::lock_guard lock(mMutex);
+		for (auto it = mPending.begin(); it != mPending.end();)
+		{
+			if (now - it->second.Time < mDebounce)
+			{
+				++it;
+				continue;
+			}
+			OutChanges.push_back({ it->first, it->second.Type, it->second.Time });
+			it = mPending.erase(it);
+			count++;
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// 変化を記録する（同じファイルなら時刻を更新する）
+	/// </summary>
+	void FileWatcher::Push(std::string Path, EFileChange Type)
+	{
+		std::lock_guard lock(mMutex);
+		PendingChange& change = mPending[std::move(Path)];
+		change.Type = Type;
+		change.Time = std::chrono::steady_clock::now();
+	}
+
+	/// <summary>
+	/// フォルダとその下を全て見張りに加える（inotify はフォルダごとに登録がいる）
+	/// </summary>
+	/// <param name="Directory">Root からの相対パス（空か '/' で終わる）</param>
+	/// <param name="IsNew">見張る前に作られたファイルを変化として報告する</param>
+	void FileWatcher::AddWatchRecursive(const std::string& Directory, bool IsNew)
+	{
+#if defined(__linux__)
+		const std::filesystem::path fullPath = mRoot / std::filesystem::path(std::u8string(Directory.begin(), Directory.end()));
+		const int watch = inotify_add_watch(static_cast<int>(mNative), fullPath.c_str(), INOTIFY_MASK);
+		if (watch < 0)
+		{
+			ECSE_LOG(System::ELogLevel::Warning, "FileWatcher: failed to watch {}. (errno {})", fullPath.string(), errno);
+			return;
+		}
+		mWatches[watch] = Directory;
+
+		//	登録より前に作られた中身は通知が来ないので、ここで拾う
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(fullPath, std::filesystem::directory_options::skip_permission_denied, error))
+		{
+			const std::string path = Directory + ToGenericString(entry.path().filename());
+			if (entry.is_directory(error) == true && entry.is_symlink(error) == false)
+			{
+				AddWatchRecursive(path + '/', IsNew);
+			}
+			else if (IsNew == true)
+			{
+				Push(path, EFileChange::Modified);
+			}
+		}
+#else
+		(void)Directory;
+		(void)IsNew;
+#endif
+	}
+
+	/// <summary>
+	/// 変化を受け取って待つスレッド
+	/// </summary>
+	void FileWatcher::WatchThreadMain()
+	{
+#if defined(_WIN32)
+		const HANDLE directory = reinterpret_cast<HANDLE>(mNative);
+		const HANDLE wake = reinterpret_cast<HANDLE>(mWake);
+		const HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		//	FILE_NOTIFY_INFORMATION は DWORD 境界に並ぶ
+		std::vector<DWORD> buffer(64 * 1024 / sizeof(DWORD));
+
+		while (mIsExitRequested == false)
+		{
+			OVERLAPPED overlapped = {};
+			overlapped.hEvent = event;
+			ResetEvent(event);
+			if (ReadDirectoryChangesW(directory, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)), TRUE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+				nullptr, &overlapped, nullptr) == FALSE)
+			{
+				ECSE_LOG(System::ELogLevel::Error, "FileWatcher: ReadDirectoryChangesW failed. (error {})", GetLastError());
+				break;
+			}
+
+			const HANDLE handles[] = { event, wake };
+			if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+			{
+				//	終了要求。読み込み中の要求を取り消してから抜ける
+				CancelIoEx(directory, &overlapped);
+				DWORD ignored = 0;
+				GetOverlappedResult(directory, &overlapped, &ignored, TRUE);
+				break;
+			}
+
+			DWORD size = 0;
+			if (GetOverlappedResult(directory, &overlapped, &size, FALSE) == FALSE) continue;
+			if (size == 0)
+			{
+				//	バッファに収まらなかった分は捨てられている
+				ECSE_LOG(System::ELogLevel::Warning, "FileWatcher: change buffer overflowed, some changes were dropped. ({})", mRoot.string());
+				continue;
+			}
+
+			const uint8_t* pCursor = reinterpret_cast<const uint8_t*>(buffer.data());
+			while (true)
+			{
+				const auto* pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(pCursor);
+				const std::wstring_view name(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+				switch (pInfo->Action)
+				{
+				case FILE_ACTION_ADDED:
+				case FILE_ACTION_MODIFIED:
+				case FILE_ACTION_RENAMED_NEW_NAME:
+					Push(ToGenericString(std::filesystem::path(name)), EFileChange::Modified);
+					break;
+				case FILE_ACTION_REMOVED:
+				case FILE_ACTION_RENAMED_OLD_NAME:
+					Push(ToGenericString(std::filesystem::path(name)), EFileChange::Removed);
+					break;
+				}
+				if (pInfo->NextEntryOffset == 0) break;
+				pCursor += pInfo->NextEntryOffset;
+			}
+		}
+		CloseHandle(event);
+#elif defined(__linux__)
+		pollfd fds[2] = {};
+		fds[0].fd = static_cast<int>(mNative);
+		fds[0].events = POLLIN;
+		fds[1].fd = static_cast<int>(mWake);
+		fds[1].events = POLLIN;
+		alignas(inotify_event) char buffer[16 * 1024];
+
+		while (mIsExitRequested == false)
+		{
+			if (poll(fds, 2, -1) < 0)
+			{
+				if (errno == EINTR) continue;
+				ECSE_LOG(System::ELogLevel::Error, "FileWatcher: poll failed. (errno {})", errno);
+				break;
+			}
+			if ((fds[1].revents & POLLIN) != 0) break;
+
+			while (true)
+			{
+				const ssize_t size = read(fds[0].fd, buffer, sizeof(buffer));
+				if (size <= 0) break;
+
+				for (const char* pCursor = buffer; pCursor < buffer + size;)
+				{
+					const auto* pEvent = reinterpret_cast<const inotify_event*>(pCursor);
+					pCursor += sizeof(inotify_event) + pEvent->len;
+
+					if ((pEvent->mask & IN_Q_OVERFLOW) != 0)
+					{
+						ECSE_LOG(System::ELogLevel::Warning, "FileWatcher: event queue overflowed, some changes were dropped. ({})", mRoot.string());
+						continue;
+					}
+					if ((pEvent->mask & IN_IGNORED) != 0)
+					{
+						mWatches.erase(pEvent->wd);
+						continue;
+					}
+
+					const auto it = mWatches.find(pEvent->wd);
+					if (it == mWatches.end() || pEvent->len == 0) continue;
+					std::string path = it->second + pEvent->name;
+
+					if ((pEvent->mask & IN_ISDIR) != 0)
+					{
+						//	増えたフォルダも見張る（中身はもう作られているかもしれない）
+						if ((pEvent->mask & (IN_CREATE | IN_MOVED_TO)) != 0) AddWatchRecursive(path + '/', true);
+						continue;
+					}
+					if ((pEvent->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+					{
+						Push(std::move(path), EFileChange::Modified);
+					}
+					else if ((pEvent->mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+					{
+						Push(std::move(path), EFileChange::Removed);
+					}
+				}
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,156 @@
+﻿#include "pch.h"
+#include<System/IO/MappedFile.hpp>
+
+#if !defined(_WIN32)
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+namespace Ecse::System
+{
+	MappedFile::MappedFile()
+		:mpData(nullptr)
+		, mSize(0)
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// ファイルを開いて割り当てる（大きさ 0 のファイルは割り当てられないので失敗）
+	/// </summary>
+	/// <param name="Path">ファイルの場所</param>
+	/// <returns>true:成功</returns>
+	bool MappedFile::Open(const std::filesystem::path& Path)
+	{
+		Release();
+
+#if defined(_WIN32)
+		const HANDLE file = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateFile ({}).", Path.string());
+			return false;
+		}
+
+		LARGE_INTEGER size = {};
+		if (GetFileSizeEx(file, &size) == FALSE || size.QuadPart == 0)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed GetFileSizeEx ({}).", Path.string());
+			CloseHandle(file);
+			return false;
+		}
+
+		const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed CreateFileMapping ({}).", Path.string());
+			return false;
+		}
+
+		void* pMapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (pMapped == nullptr)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed MapViewOfFile ({}).", Path.string());
+			return false;
+		}
+
+		mSize = static_cast<uint64_t>(size.QuadPart);
+#else
+		const int file = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed open ({}).", Path.string());
+			return false;
+		}
+
+		struct stat status = {};
+		if (fstat(file, &status) != 0 || status.st_size == 0)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed fstat ({}).", Path.string());
+			close(file);
+			return false;
+		}
+
+		void* pMapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (pMapped == MAP_FAILED)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "Failed mmap ({}).", Path.string());
+			return false;
+		}
+
+		mSize = static_cast<uint64_t>(status.st_size);
+#endif
+		mpData = static_cast<const uint8_t*>(pMapped);
+		return true;
+	}
+
+	/// <summary>
+	/// 割り当てを外して閉じる
+	/// </summary>
+	void MappedFile::Release()
+	{
+		if (mpData != nullptr)
+		{
+#if defined(_WIN32)
+			UnmapViewOfFile(mpData);
+#else
+			munmap(const_cast<uint8_t*>(mpData), static_cast<size_t>(mSize));
+#endif
+		}
+		mpData = nullptr;
+		mSize = 0;
+	}
+
+	/// <summary>
+	/// 先頭から順に読むことを OS に伝え、先読みさせる
+	/// </summary>
+	void MappedFile::Prefetch() const
+	{
+		if (mpData == nullptr) return;
+
+#if defined(_WIN32)
+		WIN32_MEMORY_RANGE_ENTRY range = {};
+		range.VirtualAddress = const_cast<uint8_t*>(mpData);
+		range.NumberOfBytes = static_cast<SIZE_T>(mSize);
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+		void* pData = const_cast<uint8_t*>(mpData);
+		madvise(pData, static_cast<size_t>(mSize), MADV_SEQUENTIAL);
+		madvise(pData, static_cast<size_t>(mSize), MADV_WILLNEED);
+#endif
+	}
+
+	/// <summary>
+	/// 開いているか
+	/// </summary>
+	bool MappedFile::IsOpen() const
+	{
+		return mpData != nullptr;
+	}
+
+	/// <summary>
+	/// 中身（開いていなければ空）
+	/// </summary>
+	std::span<const uint8_t> MappedFile::GetBytes() const
+	{
+		if (mpData == nullptr) return {};
+		return { mpData, static_cast<size_t>(mSize) };
+	}
+
+	/// <summary>
+	/// 大きさ（バイト）
+	/// </summary>
+	uint64_t MappedFile::GetSize() const
+	{
+		return mSize;
+	}
+}
@@ -0,0 +1,311 @@
+﻿#include "pch.h"
+#include<System/IO/PackArchive.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<Utility/Compression/Lz4.hpp>
+#include<Utility/Hash/Hash.hpp>
+
+#include<algorithm>
+#include<atomic>
+#include<cstring>
+#include<functional>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		//	[Offset, Offset + Count * Stride) がファイルに収まるか（掛け算があふれないように割って比べる）
+		bool IsRangeInside(uint64_t Offset, uint64_t Count, uint64_t Stride, uint64_t FileSize)
+		{
+			if (Offset > FileSize) return false;
+			return Count <= (FileSize - Offset) / Stride;
+		}
+	}
+
+	PackArchive::PackArchive()
+		:mFile()
+		, mpHeader(nullptr)
+		, mEntries()
+		, mChunks()
+		, mPaths()
+	{
+	}
+
+	PackArchive::~PackArchive()
+	{
+		this->Release();
+	}
+
+	/// <summary>
+	/// 開いて目次を確かめる
+	/// </summary>
+	/// <param name="Path">ファイルの場所</param>
+	/// <returns>true:成功</returns>
+	bool PackArchive::Open(const std::filesystem::path& Path)
+	{
+		Release();
+
+		if (mFile.Open(Path) == false) return false;
+
+		const std::span<const uint8_t> bytes = mFile.GetBytes();
+		if (Validate(bytes) == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackArchive: invalid file. ({})", Path.string());
+			Release();
+			return false;
+		}
+
+		mpHeader = reinterpret_cast<const PackHeader*>(bytes.data());
+		mEntries = std::span(reinterpret_cast<const PackEntry*>(bytes.data() + mpHeader->EntryOffset), mpHeader->EntryCount);
+		mChunks = std::span(reinterpret_cast<const PackChunk*>(bytes.data() + mpHeader->ChunkOffset), mpHeader->ChunkCount);
+		mPaths = std::string_view(reinterpret_cast<const char*>(bytes.data() + mpHeader->PathOffset), static_cast<size_t>(mpHeader->PathSize));
+		return true;
+	}
+
+	/// <summary>
+	/// 閉じる
+	/// </summary>
+	void PackArchive::Release()
+	{
+		mFile.Release();
+		mpHeader = nullptr;
+		mEntries = {};
+		mChunks = {};
+		mPaths = {};
+	}
+
+	/// <summary>
+	/// 開いているか
+	/// </summary>
+	bool PackArchive::IsOpen() const
+	{
+		return mpHeader != nullptr;
+	}
+
+	/// <summary>
+	/// 探す（なければ nullptr）
+	/// </summary>
+	/// <param name="Path">パス（NormalizePath と同じ規則で比べる）</param>
+	const PackEntry* PackArchive::Find(std::string_view Path) const
+	{
+		const std::string normalized = NormalizePath(Path);
+		const uint64_t hash = Utility::Hash64(normalized);
+
+		auto it = std::lower_bound(mEntries.begin(), mEntries.end(), hash,
+			[](const PackEntry& Entry, uint64_t Hash) { return Entry.PathHash < Hash; });
+		for (; it != mEntries.end() && it->PathHash == hash; ++it)
+		{
+			if (GetPath(*it) == normalized) return &*it;
+		}
+		return nullptr;
+	}
+
+	/// <summary>
+	/// 目次（PathHash の順）
+	/// </summary>
+	std::span<const PackEntry> PackArchive::GetEntries() const
+	{
+		return mEntries;
+	}
+
+	/// <summary>
+	/// 目次の行のパス（NormalizePath した形）
+	/// </summary>
+	std::string_view PackArchive::GetPath(const PackEntry& Entry) const
+	{
+		return mPaths.substr(Entry.PathOffset, Entry.PathLength);
+	}
+
+	/// <summary>
+	/// 1つ読む
+	/// </summary>
+	/// <param name="Entry">目次の行</param>
+	/// <param name="Out">書き込み先（Entry.Size バイト）</param>
+	/// <returns>true:成功</returns>
+	bool PackArchive::Read(const PackEntry& Entry, std::span<uint8_t> Out) const
+	{
+		if (IsOpen() == false || Out.size() != Entry.Size) return false;
+
+		std::atomic<bool> succeeded = true;
+		const auto run = [&](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					if (ReadChunk(Entry.FirstChunk + i, Out.data() + static_cast<size_t>(i) * PACK_CHUNK_SIZE) == false)
+					{
+						succeeded.store(false, std::memory_order_relaxed);
+					}
+				}
+			};
+
+		//	1チャンクならワーカーに渡すより自分で展開した方が速い
+		if (Entry.ChunkCount <= 1)
+		{
+			run(0, Entry.ChunkCount);
+		}
+		else
+		{
+			JobSystem::ParallelForOrInline(Entry.ChunkCount, run);
+		}
+
+		if (succeeded.load() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackArchive: Failed to decompress. {}", GetPath(Entry));
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// パスで探して読む
+	/// </summary>
+	/// <param name="Path">パス</param>
+	/// <param name="OutBytes">中身</param>
+	/// <returns>true:成功</returns>
+	bool PackArchive::Read(std::string_view Path, std::vector<uint8_t>& OutBytes) const
+	{
+		const PackEntry* entry = Find(Path);
+		if (entry == nullptr) return false;
+
+		OutBytes.resize(static_cast<size_t>(entry->Size));
+		return Read(*entry, OutBytes);
+	}
+
+	/// <summary>
+	/// まとめて読む
+	/// </summary>
+	/// <param name="Entries">目次の行</param>
+	/// <param name="Outs">それぞれの書き込み先（Entry.Size バイト）</param>
+	/// <returns>true:全て成功</returns>
+	bool PackArchive::ReadBatch(std::span<const PackEntry* const> Entries, std::span<const std::span<uint8_t>> Outs) const
+	{
+		if (IsOpen() == false || Entries.size() != Outs.size()) return false;
+
+		//	全てのチャンクを1列に並べて分ける
+		struct ChunkTask
+		{
+			uint32_t Chunk;
+			uint8_t* Out;
+		};
+		std::vector<ChunkTask> tasks;
+		for (size_t i = 0; i < Entries.size(); ++i)
+		{
+			const PackEntry& entry = *Entries[i];
+			if (Outs[i].size() != entry.Size) return false;
+			for (uint32_t c = 0; c < entry.ChunkCount; ++c)
+			{
+				tasks.push_back({ entry.FirstChunk + c, Outs[i].data() + static_cast<size_t>(c) * PACK_CHUNK_SIZE });
+			}
+		}
+
+		std::atomic<bool> succeeded = true;
+		JobSystem::ParallelForOrInline(static_cast<uint32_t>(tasks.size()), [&](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					if (ReadChunk(tasks[i].Chunk, tasks[i].Out) == false)
+					{
+						succeeded.store(false, std::memory_order_relaxed);
+					}
+				}
+			});
+
+		if (succeeded.load() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackArchive: Failed to decompress.");
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// パスを目次の形にする（'\' を '/' に、英字を小文字に、先頭の "./" と "/" を取る）
+	/// </summary>
+	std::string PackArchive::NormalizePath(std::string_view Path)
+	{
+		while (true)
+		{
+			if (Path.starts_with("./") || Path.starts_with(".\\")) Path.remove_prefix(2);
+			else if (Path.starts_with("/") || Path.starts_with("\\")) Path.remove_prefix(1);
+			else break;
+		}
+
+		std::string result(Path);
+		for (char& c : result)
+		{
+			if (c == '\\') c = '/';
+			else if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// 目次に使うパスのハッシュ（NormalizePath した後の文字列の Hash64）
+	/// </summary>
+	uint64_t PackArchive::HashPath(std::string_view Path)
+	{
+		return Utility::Hash64(NormalizePath(Path));
+	}
+
+	/// <summary>
+	/// ファイルの中身が正しいか（目次とチャンクの表が範囲内か）
+	/// </summary>
+	bool PackArchive::Validate(std::span<const uint8_t> Bytes)
+	{
+		if (Bytes.size() < sizeof(PackHeader)) return false;
+
+		PackHeader header;
+		std::memcpy(&header, Bytes.data(), sizeof(header));
+		const uint64_t fileSize = Bytes.size();
+		if (header.Magic != PACK_MAGIC || header.Version != PACK_VERSION) return false;
+		if (header.ChunkSize != PACK_CHUNK_SIZE || header.FileSize != fileSize) return false;
+		if (header.EntryOffset % alignof(PackEntry) != 0 || header.ChunkOffset % alignof(PackChunk) != 0) return false;
+		if (IsRangeInside(header.EntryOffset, header.EntryCount, sizeof(PackEntry), fileSize) == false) return false;
+		if (IsRangeInside(header.ChunkOffset, header.ChunkCount, sizeof(PackChunk), fileSize) == false) return false;
+		if (IsRangeInside(header.PathOffset, header.PathSize, 1, fileSize) == false) return false;
+		if (header.DataOffset % PACK_ALIGNMENT != 0 || header.DataOffset > fileSize) return false;
+
+		const auto* entries = reinterpret_cast<const PackEntry*>(Bytes.data() + header.EntryOffset);
+		const auto* chunks = reinterpret_cast<const PackChunk*>(Bytes.data() + header.ChunkOffset);
+
+		for (const PackChunk& chunk : std::span(chunks, header.ChunkCount))
+		{
+			if (chunk.Size > PACK_CHUNK_SIZE || chunk.CompressedSize > chunk.Size) return false;
+			if (chunk.Offset < header.DataOffset || IsRangeInside(chunk.Offset, chunk.CompressedSize, 1, fileSize) == false) return false;
+		}
+
+		for (uint32_t i = 0; i < header.EntryCount; ++i)
+		{
+			const PackEntry& entry = entries[i];
+			//	二分探索のために並んでいること
+			if (i > 0 && entries[i - 1].PathHash > entry.PathHash) return false;
+			if (static_cast<uint64_t>(entry.PathOffset) + entry.PathLength > header.PathSize) return false;
+			if (static_cast<uint64_t>(entry.FirstChunk) + entry.ChunkCount > header.ChunkCount) return false;
+			if (entry.ChunkCount != (entry.Size + PACK_CHUNK_SIZE - 1) / PACK_CHUNK_SIZE) return false;
+
+			//	最後以外は PACK_CHUNK_SIZE ちょうどで、合わせると Size になること
+			uint64_t remaining = entry.Size;
+			for (uint32_t c = 0; c < entry.ChunkCount; ++c)
+			{
+				const uint64_t expected = remaining < PACK_CHUNK_SIZE ? remaining : PACK_CHUNK_SIZE;
+				if (chunks[entry.FirstChunk + c].Size != expected) return false;
+				remaining -= expected;
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// チャンクを1つ展開する
+	/// </summary>
+	bool PackArchive::ReadChunk(uint32_t Index, uint8_t* Out) const
+	{
+		const PackChunk& chunk = mChunks[Index];
+		const uint8_t* source = mFile.GetBytes().data() + chunk.Offset;
+		if (chunk.CompressedSize == chunk.Size)
+		{
+			std::memcpy(Out, source, chunk.Size);
+			return true;
+		}
+		return Utility::Lz4Decompress(source, chunk.CompressedSize, Out, chunk.Size);
+	}
+}
@@ -0,0 +1,336 @@
+﻿#include "pch.h"
+#include<System/IO/PackWriter.hpp>
+#include<System/IO/PackArchive.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<Utility/Compression/Lz4.hpp>
+#include<Utility/Hash/Hash.hpp>
+
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<limits>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		//	まとめて圧縮するチャンクの数の目安（小さなファイルが続いても並列にできるように、この数まで溜めてから分ける）
+		constexpr uint32_t BATCH_CHUNK_COUNT = 256;
+
+		uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+		{
+			return (Value + Alignment - 1) / Alignment * Alignment;
+		}
+
+		uint32_t GetChunkCount(uint64_t Size)
+		{
+			return static_cast<uint32_t>((Size + PACK_CHUNK_SIZE - 1) / PACK_CHUNK_SIZE);
+		}
+
+		bool ReadFile(const std::filesystem::path& Path, std::vector<uint8_t>& OutBytes)
+		{
+			std::ifstream file(Path, std::ios::binary | std::ios::ate);
+			if (file.is_open() == false) return false;
+
+			const std::streamsize size = file.tellg();
+			if (size < 0) return false;
+			OutBytes.resize(static_cast<size_t>(size));
+			file.seekg(0);
+			return file.read(reinterpret_cast<char*>(OutBytes.data()), size).good() || size == 0;
+		}
+
+		//	圧縮した後のチャンク1つ
+		struct CookedChunk
+		{
+			//	元
+			const uint8_t* Source = nullptr;
+			uint32_t Size = 0;
+			//	圧縮したもの（空ならそのまま入れる）
+			std::vector<uint8_t> Compressed;
+		};
+	}
+
+	/// <summary>
+	/// メモリ上のデータを追加する
+	/// </summary>
+	/// <param name="Path">パック内のパス</param>
+	/// <param name="Bytes">中身</param>
+	/// <returns>true:成功（同じパスが既にあれば false）</returns>
+	bool PackWriter::Add(std::string_view Path, std::vector<uint8_t> Bytes)
+	{
+		std::string normalized = PackArchive::NormalizePath(Path);
+		if (mPaths.insert(normalized).second == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Duplicate path. {}", normalized);
+			return false;
+		}
+
+		PendingEntry& entry = mEntries.emplace_back();
+		entry.PathHash = Utility::Hash64(normalized);
+		entry.Path = std::move(normalized);
+		entry.Size = Bytes.size();
+		entry.Bytes = std::move(Bytes);
+		return true;
+	}
+
+	/// <summary>
+	/// ファイルを追加する
+	/// </summary>
+	/// <param name="Path">パック内のパス</param>
+	/// <param name="Source">読むファイル</param>
+	/// <returns>true:成功</returns>
+	bool PackWriter::AddFile(std::string_view Path, const std::filesystem::path& Source)
+	{
+		std::error_code error;
+		const uint64_t size = std::filesystem::file_size(Source, error);
+		if (error)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Failed to open. {}", Source.string());
+			return false;
+		}
+
+		std::string normalized = PackArchive::NormalizePath(Path);
+		if (mPaths.insert(normalized).second == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Duplicate path. {}", normalized);
+			return false;
+		}
+
+		PendingEntry& entry = mEntries.emplace_back();
+		entry.PathHash = Utility::Hash64(normalized);
+		entry.Path = std::move(normalized);
+		entry.Size = size;
+		entry.Source = Source;
+		return true;
+	}
+
+	/// <summary>
+	/// フォルダの下のファイルを全て追加する（パック内のパスは Root からの相対パス）
+	/// </summary>
+	/// <param name="Root">フォルダ</param>
+	/// <returns>追加した数</returns>
+	uint32_t PackWriter::AddDirectory(const std::filesystem::path& Root)
+	{
+		uint32_t count = 0;
+		std::error_code error;
+		for (const auto& item : std::filesystem::recursive_directory_iterator(Root, error))
+		{
+			if (item.is_regular_file() == false) continue;
+
+			const std::string path = std::filesystem::relative(item.path(), Root).generic_string();
+			if (AddFile(path, item.path())) ++count;
+		}
+		if (error)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Failed to enumerate. {}", Root.string());
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// 圧縮するか（しなければ全てのチャンクをそのまま入れる）
+	/// </summary>
+	void PackWriter::SetCompression(bool Enable)
+	{
+		mCompress = Enable;
+	}
+
+	/// <summary>
+	/// 書き出す
+	/// </summary>
+	/// <param name="Output">書き出し先</param>
+	/// <param name="pStats">結果の統計（不要なら nullptr）</param>
+	/// <returns>true:成功</returns>
+	bool PackWriter::Write(const std::filesystem::path& Output, PackWriteStats* pStats) const
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		//	目次の順（ハッシュが同じならパスの順）に中身も並べる
+		std::vector<const PendingEntry*> order;
+		order.reserve(mEntries.size());
+		for (const PendingEntry& entry : mEntries) order.push_back(&entry);
+		std::sort(order.begin(), order.end(), [](const PendingEntry* a, const PendingEntry* b)
+			{
+				if (a->PathHash != b->PathHash) return a->PathHash < b->PathHash;
+				return a->Path < b->Path;
+			});
+
+		uint64_t chunkCount = 0;
+		uint64_t pathSize = 0;
+		for (const PendingEntry* entry : order)
+		{
+			chunkCount += GetChunkCount(entry->Size);
+			pathSize += entry->Path.size();
+		}
+		if (chunkCount > std::numeric_limits<uint32_t>::max() || pathSize > std::numeric_limits<uint32_t>::max())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Too many files. {}", Output.string());
+			return false;
+		}
+
+		PackHeader header = {};
+		header.Magic = PACK_MAGIC;
+		header.Version = PACK_VERSION;
+		header.EntryCount = static_cast<uint32_t>(order.size());
+		header.ChunkCount = static_cast<uint32_t>(chunkCount);
+		header.ChunkSize = PACK_CHUNK_SIZE;
+		header.EntryOffset = sizeof(PackHeader);
+		header.ChunkOffset = header.EntryOffset + sizeof(PackEntry) * order.size();
+		header.PathOffset = header.ChunkOffset + sizeof(PackChunk) * chunkCount;
+		header.PathSize = pathSize;
+		header.DataOffset = AlignUp(header.PathOffset + pathSize, PACK_ALIGNMENT);
+
+		std::vector<PackEntry> entries(order.size());
+		std::vector<PackChunk> chunks;
+		chunks.reserve(static_cast<size_t>(chunkCount));
+		std::string paths;
+		paths.reserve(static_cast<size_t>(pathSize));
+
+		std::error_code error;
+		if (Output.has_parent_path()) std::filesystem::create_directories(Output.parent_path(), error);
+		std::ofstream out(Output, std::ios::binary | std::ios::trunc);
+		if (out.is_open() == false)
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Failed to write. {}", Output.string());
+			return false;
+		}
+
+		//	目次は最後に書くので、まずは場所だけ空けておく
+		const std::vector<char> zeros(PACK_ALIGNMENT, 0);
+		for (uint64_t written = 0; written < header.DataOffset; written += PACK_ALIGNMENT)
+		{
+			out.write(zeros.data(), PACK_ALIGNMENT);
+		}
+
+		PackWriteStats stats;
+		uint64_t offset = header.DataOffset;
+		auto* pJobs = ServiceLocator::Get<JobSystem>();
+
+		for (size_t batchBegin = 0; batchBegin < order.size();)
+		{
+			//	チャンクが BATCH_CHUNK_COUNT 個になるまでファイルを集める
+			size_t batchEnd = batchBegin;
+			uint32_t batchChunkCount = 0;
+			while (batchEnd < order.size() && (batchEnd == batchBegin || batchChunkCount < BATCH_CHUNK_COUNT))
+			{
+				batchChunkCount += GetChunkCount(order[batchEnd]->Size);
+				++batchEnd;
+			}
+
+			//	中身を読む（メモリ上のものはそのまま指す）
+			std::vector<std::vector<uint8_t>> loaded(batchEnd - batchBegin);
+			std::vector<CookedChunk> cooked;
+			cooked.reserve(batchChunkCount);
+			for (size_t i = batchBegin; i < batchEnd; ++i)
+			{
+				const PendingEntry& entry = *order[i];
+				const uint8_t* data = entry.Bytes.data();
+				if (entry.Source.empty() == false)
+				{
+					std::vector<uint8_t>& bytes = loaded[i - batchBegin];
+					if (ReadFile(entry.Source, bytes) == false || bytes.size() != entry.Size)
+					{
+						ECSE_LOG(System::ELogLevel::Error, "PackWriter: Failed to read. {}", entry.Source.string());
+						return false;
+					}
+					data = bytes.data();
+				}
+
+				for (uint64_t position = 0; position < entry.Size; position += PACK_CHUNK_SIZE)
+				{
+					CookedChunk& chunk = cooked.emplace_back();
+					chunk.Source = data + position;
+					chunk.Size = static_cast<uint32_t>(std::min<uint64_t>(entry.Size - position, PACK_CHUNK_SIZE));
+				}
+			}
+
+			//	チャンクごとに並列に圧縮する
+			if (mCompress)
+			{
+				const auto compress = [&cooked](uint32_t Begin, uint32_t End)
+					{
+						for (uint32_t i = Begin; i < End; ++i)
+						{
+							CookedChunk& chunk = cooked[i];
+							chunk.Compressed.resize(Utility::Lz4CompressBound(chunk.Size));
+							const size_t size = Utility::Lz4Compress(chunk.Source, chunk.Size, chunk.Compressed.data(), chunk.Compressed.size());
+							//	小さくならなければそのまま入れる（展開の手間も省ける）
+							if (size == 0 || size >= chunk.Size)
+							{
+								chunk.Compressed.clear();
+								chunk.Compressed.shrink_to_fit();
+							}
+							else
+							{
+								chunk.Compressed.resize(size);
+							}
+						}
+					};
+				if (pJobs != nullptr)
+				{
+					pJobs->ParallelFor(static_cast<uint32_t>(cooked.size()), compress);
+				}
+				else
+				{
+					compress(0, static_cast<uint32_t>(cooked.size()));
+				}
+			}
+
+			//	ファイルごとに先頭を PACK_ALIGNMENT に揃えて順に書く
+			size_t next = 0;
+			for (size_t i = batchBegin; i < batchEnd; ++i)
+			{
+				const PendingEntry& entry = *order[i];
+				PackEntry& packEntry = entries[i];
+				packEntry.PathHash = entry.PathHash;
+				packEntry.Size = entry.Size;
+				packEntry.FirstChunk = static_cast<uint32_t>(chunks.size());
+				packEntry.ChunkCount = GetChunkCount(entry.Size);
+				packEntry.PathOffset = static_cast<uint32_t>(paths.size());
+				packEntry.PathLength = static_cast<uint32_t>(entry.Path.size());
+				paths += entry.Path;
+
+				for (uint32_t c = 0; c < packEntry.ChunkCount; ++c)
+				{
+					const CookedChunk& chunk = cooked[next++];
+					const bool stored = chunk.Compressed.empty();
+					const uint32_t size = stored ? chunk.Size : static_cast<uint32_t>(chunk.Compressed.size());
+					out.write(reinterpret_cast<const char*>(stored ? chunk.Source : chunk.Compressed.data()), size);
+					chunks.push_back({ offset, size, chunk.Size });
+					offset += size;
+					if (stored) ++stats.StoredChunkCount;
+				}
+
+				const uint64_t padding = AlignUp(offset, PACK_ALIGNMENT) - offset;
+				out.write(zeros.data(), static_cast<std::streamsize>(padding));
+				offset += padding;
+				stats.SourceSize += entry.Size;
+			}
+
+			batchBegin = batchEnd;
+		}
+
+		header.FileSize = offset;
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(PackEntry) * entries.size()));
+		out.write(reinterpret_cast<const char*>(chunks.data()), static_cast<std::streamsize>(sizeof(PackChunk) * chunks.size()));
+		out.write(paths.data(), static_cast<std::streamsize>(paths.size()));
+		out.close();
+		if (out.fail())
+		{
+			ECSE_LOG(System::ELogLevel::Error, "PackWriter: Failed to write. {}", Output.string());
+			return false;
+		}
+
+		if (pStats != nullptr)
+		{
+			*pStats = stats;
+			pStats->EntryCount = header.EntryCount;
+			pStats->ChunkCount = header.ChunkCount;
+			pStats->FileSize = header.FileSize;
+			pStats->ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return true;
+	}
+}
@@ -7,10 +7,12 @@ namespace Ecse::System
 	//	メモリ上に確保
 	std::mutex Logger::sLogMutex;
 
+#if defined(_WIN32)
 	static bool operator&(const EConsoleTextColor a, const EConsoleTextColor b)
 	{
 		return static_cast<uint8_t>(a) & static_cast<uint8_t>(b);
 	}
+#endif
 
 	/// <summary>
 	/// コンソールウィンドウの作成とそのコンソールに書き込めるようにターゲット
@@ -19,6 +21,7 @@ namespace Ecse::System
 	{
 #if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED 
 
+#if defined(_WIN32)
 		if (AllocConsole() == true)
 		{
 			FILE* fp = nullptr;
@@ -28,6 +31,7 @@ namespace Ecse::System
 			//	日本語に対応させます。
 			std::setlocale(LC_ALL, "japanese");
 		}
+#endif
 		std::cout << "Logger Online." << std::endl;
 #endif
 	}
@@ -39,7 +43,9 @@ namespace Ecse::System
 	{
 #if defined(_DEBUG) || ECSE_DEV_TOOL_ENABLED 
 		std::cout << "Logger Shutdown." << std::endl;
+#if defined(_WIN32)
 		FreeConsole();
+#endif
 #endif
 
 	}
@@ -49,6 +55,7 @@ namespace Ecse::System
 	/// </summary>
 	void Logger::SetTextColor(ELogLevel Level)
 	{
+#if defined(_WIN32)
 		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 		WORD color = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE; // デフォルトは白
 
@@ -64,6 +71,22 @@ namespace Ecse::System
 			break;
 		}
 		SetConsoleTextAttribute(hConsole, color);
+#else
+		//	端末の色はエスケープシーケンスで変える
+		switch (Level) {
+		case ELogLevel::Warning:
+			std::cout << "\x1b[93m";
+			break;
+		case ELogLevel::Error:
+			std::cout << "\x1b[91m";
+			break;
+		case ELogLevel::Fatal:
+			std::cout << "\x1b[97;41m";
+			break;
+		default:
+			break;
+		}
+#endif
 	}
 
 	/// <summary>
@@ -78,8 +101,10 @@ namespace Ecse::System
 		std::lock_guard lock(sLogMutex);
 
 		//	Debug出力（vsの出力ウィンドウ）
+#if defined(_WIN32)
 		std::string debugMsg = std::format("[{}]{}\n", (int)Level, Message);
 		OutputDebugStringA(debugMsg.c_str());
+#endif
 		
 		//	エラー以外は色を変える
 		if (Level != ELogLevel::Log) {
@@ -111,14 +136,23 @@ namespace Ecse::System
 		if (Level != ELogLevel::Log) {
 			std::cout << "  -> " << File << "(" << Line<< ")" << std::endl;
 			// 色を戻す
+#if defined(_WIN32)
 			SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
+#else
+			std::cout << "\x1b[0m" << std::flush;
+#endif
 		}
 
 		//	Fatalの時は実行を止める+メッセージボックス
 		if (Level == ELogLevel::Fatal) {
 			std::string fatalDetail = std::format("{}\n\nLocation: {}({})", Message, File, Line);
+#if defined(_WIN32)
 			MessageBoxA(nullptr, fatalDetail.c_str(), "Fatal Error", MB_ICONERROR);
 			DebugBreak();
+#else
+			std::cerr << fatalDetail << std::endl;
+			std::abort();
+#endif
 		}
 	}
 
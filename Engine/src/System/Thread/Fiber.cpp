@@ -0,0 +1,173 @@
+﻿#include "pch.h"
+#include<System/Thread/Fiber.hpp>
+
+#if defined(__linux__)
+#include<cerrno>
+#include<cstdint>
+#include<ucontext.h>
+#endif
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// OS から呼ばれるファイバーの入口
+	/// </summary>
+	struct FiberEntry
+	{
+#if defined(_WIN32)
+		static void WINAPI Proc(LPVOID pParameter)
+		{
+			Fiber* pFiber = static_cast<Fiber*>(pParameter);
+			pFiber->mEntry(pFiber->mpUserData);
+		}
+#elif defined(__linux__)
+		//	makecontext は int の引数しか渡せないので、ポインタを上下に分けて渡す
+		static void Proc(uint32_t High, uint32_t Low)
+		{
+			Fiber* pFiber = reinterpret_cast<Fiber*>((static_cast<uintptr_t>(High) << 32) | Low);
+			pFiber->mEntry(pFiber->mpUserData);
+		}
+#endif
+	};
+
+	Fiber::Fiber()
+		:mpNative(nullptr)
+		, mpStack(nullptr)
+		, mEntry(nullptr)
+		, mpUserData(nullptr)
+		, mIsThread(false)
+		, mIsConverted(false)
+	{
+	}
+
+	Fiber::~Fiber()
+	{
+		this->Destroy();
+	}
+
+	/// <summary>
+	/// 自分のスタックを持つファイバーを作る（最初に切り替えた時に Entry から動き出す）
+	/// </summary>
+	/// <param name="StackSize">スタックの大きさ（バイト）</param>
+	/// <param name="Entry">入口</param>
+	/// <param name="pUserData">Entry に渡す値</param>
+	/// <returns>true:成功</returns>
+	bool Fiber::Create(size_t StackSize, EntryFunction Entry, void* pUserData)
+	{
+		if (mpNative != nullptr) return false;
+		mEntry = Entry;
+		mpUserData = pUserData;
+		mIsThread = false;
+
+#if defined(_WIN32)
+		mpNative = CreateFiber(StackSize, FiberEntry::Proc, this);
+		if (mpNative == nullptr)
+		{
+			ECSE_LOG(ELogLevel::Error, "Fiber: CreateFiber failed ({}).", GetLastError());
+			return false;
+		}
+		return true;
+#elif defined(__linux__)
+		auto* pContext = new ucontext_t();
+		if (getcontext(pContext) != 0)
+		{
+			delete pContext;
+			ECSE_LOG(ELogLevel::Error, "Fiber: getcontext failed ({}).", errno);
+			return false;
+		}
+		mpStack = new uint8_t[StackSize];
+		pContext->uc_stack.ss_sp = mpStack;
+		pContext->uc_stack.ss_size = StackSize;
+		pContext->uc_link = nullptr;
+
+		const auto self = reinterpret_cast<uintptr_t>(this);
+		makecontext(pContext, reinterpret_cast<void(*)()>(FiberEntry::Proc), 2, static_cast<uint32_t>(self >> 32), static_cast<uint32_t>(self));
+		mpNative = pContext;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/// <summary>
+	/// 呼んだスレッドを、今の続きを表すファイバーにする（既にファイバーならそれを使う）
+	/// </summary>
+	/// <returns>true:成功</returns>
+	bool Fiber::ConvertCurrentThread()
+	{
+		if (mpNative != nullptr) return false;
+		mIsThread = true;
+
+#if defined(_WIN32)
+		if (IsThreadAFiber() == TRUE)
+		{
+			mpNative = GetCurrentFiber();
+			mIsConverted = false;
+			return true;
+		}
+		mpNative = ConvertThreadToFiber(nullptr);
+		if (mpNative == nullptr)
+		{
+			ECSE_LOG(ELogLevel::Error, "Fiber: ConvertThreadToFiber failed ({}).", GetLastError());
+			return false;
+		}
+		mIsConverted = true;
+		return true;
+#elif defined(__linux__)
+		//	中身は最初に Switch で切り替えた時に保存される
+		mpNative = new ucontext_t();
+		mIsConverted = true;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/// <summary>
+	/// 破棄する（ConvertCurrentThread したものは、そのスレッドで呼ぶと元のスレッドに戻る）
+	/// 動いている途中のファイバーは破棄できない。
+	/// </summary>
+	void Fiber::Destroy()
+	{
+		if (mpNative == nullptr) return;
+
+#if defined(_WIN32)
+		if (mIsThread == false)
+		{
+			DeleteFiber(mpNative);
+		}
+		else if (mIsConverted == true)
+		{
+			ConvertFiberToThread();
+		}
+#elif defined(__linux__)
+		delete static_cast<ucontext_t*>(mpNative);
+		delete[] static_cast<uint8_t*>(mpStack);
+#endif
+		mpNative = nullptr;
+		mpStack = nullptr;
+		mIsThread = false;
+		mIsConverted = false;
+	}
+
+	/// <summary>
+	/// 作られているか
+	/// </summary>
+	bool Fiber::IsValid() const
+	{
+		return mpNative != nullptr;
+	}
+
+	/// <summary>
+	/// 今動いている From を止めて To へ切り替える（From へ戻ってきたら、ここから続く）
+	/// </summary>
+	void Fiber::Switch(Fiber& From, Fiber& To)
+	{
+#if defined(_WIN32)
+		(void)From;
+		SwitchToFiber(To.mpNative);
+#elif defined(__linux__)
+		swapcontext(static_cast<ucontext_t*>(From.mpNative), static_cast<ucontext_t*>(To.mpNative));
+#endif
+	}
+}
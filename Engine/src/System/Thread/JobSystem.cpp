@@ -0,0 +1,829 @@
+﻿#include "pch.h"
+#include<System/Thread/JobSystem.hpp>
+
+#include<algorithm>
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// JobSystem の1つの仕事
+	/// </summary>
+	struct Job
+	{
+		//	仕事
+		std::function<void()> Function;
+		//	終わった時に減らすカウンター
+		JobCounter* pCounter = nullptr;
+		//	止まっていたファイバー（nullptr でなければ Function の代わりにこの続きを動かす）
+		JobFiber* pFiber = nullptr;
+	};
+
+	/// <summary>
+	/// JobSystem が仕事を動かすファイバー
+	/// </summary>
+	struct JobFiber
+	{
+		//	自分のスタック
+		Fiber Context;
+		//	持ち主
+		JobSystem* pOwner = nullptr;
+		//	次に動かす仕事
+		Job* pJob = nullptr;
+	};
+
+	namespace
+	{
+		/// <summary>
+		/// 使い終わった Job をスレッドごとに取っておく数
+		/// </summary>
+		constexpr size_t MAX_CACHED_JOBS = 1024;
+
+		/// <summary>
+		/// ワーカーが眠る前に仕事を探し直す回数
+		/// </summary>
+		constexpr uint32_t SPIN_COUNT = 64;
+
+		/// <summary>
+		/// ファイバーからスレッドのスタックへ戻った理由
+		/// </summary>
+		enum class EFiberAction : uint8_t
+		{
+			None,
+			//	仕事を終えた
+			Finished,
+			//	pWaitCounter が 0 になるのを待つ
+			Waiting,
+		};
+
+		/// <summary>
+		/// スレッドごとの状態
+		/// ファイバーは Wait の後で別のスレッドへ移るので、ファイバーの上からは必ず GetThreadContext で引き直す。
+		/// </summary>
+		struct ThreadContext
+		{
+			//	このスレッドを持っている JobSystem と、その中の番号
+			const JobSystem* pOwner = nullptr;
+			uint32_t Index = JobSystem::INVALID_THREAD_INDEX;
+			//	番号の無いスレッドが盗む相手を選ぶ乱数
+			uint32_t Random = 0x2545F491u;
+			//	使い終わった Job（積んだスレッドと実行したスレッドが違っても良い）
+			std::vector<Job*> FreeJobs;
+			//	スレッドのスタック（ファイバーから戻る先）
+			Fiber Scheduler;
+			//	今このスレッドで動いているファイバー
+			JobFiber* pCurrentFiber = nullptr;
+			//	手元に置いている空いたファイバー
+			JobFiber* pIdleFiber = nullptr;
+			//	ファイバーから戻った理由
+			EFiberAction Action = EFiberAction::None;
+			JobCounter* pWaitCounter = nullptr;
+
+			~ThreadContext()
+			{
+				for (Job* pJob : FreeJobs)
+				{
+					delete pJob;
+				}
+			}
+		};
+
+		thread_local ThreadContext tContext;
+
+		//	スレッドが変わっても古いスレッドの変数を読まないように、ファイバーを切り替える関数からは必ずこれを通す
+		//	（コンパイラが関数の中で thread_local のアドレスを使い回さないように、インライン展開させない）
+#if defined(_MSC_VER)
+		__declspec(noinline)
+#else
+		__attribute__((noinline))
+#endif
+		ThreadContext& GetThreadContext()
+		{
+			return tContext;
+		}
+
+		Job* AllocateJob(std::function<void()> Func, JobCounter* pCounter)
+		{
+			ThreadContext& context = GetThreadContext();
+			Job* pJob = nullptr;
+			if (context.FreeJobs.empty() == false)
+			{
+				pJob = context.FreeJobs.back();
+				context.FreeJobs.pop_back();
+			}
+			else
+			{
+				pJob = new Job();
+			}
+			pJob->Function = std::move(Func);
+			pJob->pCounter = pCounter;
+			pJob->pFiber = nullptr;
+			return pJob;
+		}
+
+		void FreeJob(Job* pJob)
+		{
+			pJob->Function = nullptr;
+			pJob->pCounter = nullptr;
+			pJob->pFiber = nullptr;
+			ThreadContext& context = GetThreadContext();
+			if (context.FreeJobs.size() < MAX_CACHED_JOBS)
+			{
+				context.FreeJobs.push_back(pJob);
+			}
+			else
+			{
+				delete pJob;
+			}
+		}
+
+		uint32_t NextRandom(uint32_t& State)
+		{
+			//	xorshift32
+			State ^= State << 13;
+			State ^= State >> 17;
+			State ^= State << 5;
+			return State;
+		}
+	}
+
+	JobCounter::JobCounter()
+		:mValue(0)
+		, mReleasing(0)
+		, mMutex()
+		, mWaiters()
+	{
+	}
+
+	JobCounter::~JobCounter()
+	{
+	}
+
+	/// <summary>
+	/// 全て終わっているか
+	/// </summary>
+	bool JobCounter::IsDone() const
+	{
+		return mValue.load(std::memory_order_acquire) == 0 && mReleasing.load(std::memory_order_acquire) == 0;
+	}
+
+	/// <summary>
+	/// 残りの数
+	/// </summary>
+	uint32_t JobCounter::GetValue() const
+	{
+		return mValue.load(std::memory_order_acquire);
+	}
+
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void JobSystem::OnCreate()
+	{
+		mQueuedCount = 0;
+		mSleepingCount = 0;
+		mIsExitRequested = false;
+		mExecution = EJobExecution::Thread;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// </summary>
+	void JobSystem::OnDestroy()
+	{
+		this->Stop();
+	}
+
+	/// <summary>
+	/// ワーカーを起動する（呼んだスレッドをメインスレッドとして番号 0 にする）
+	/// </summary>
+	/// <param name="WorkerCount">ワーカー数（0:論理コア数-1）</param>
+	/// <param name="Execution">仕事の動かし方</param>
+	/// <param name="FiberCount">EJobExecution::Fiber の時に作るファイバーの数</param>
+	/// <returns>true:成功</returns>
+	bool JobSystem::Initialize(uint32_t WorkerCount, EJobExecution Execution, uint32_t FiberCount)
+	{
+		if (mThreads.empty() == false) return false;
+
+		if (WorkerCount == 0)
+		{
+			const uint32_t hardware = std::thread::hardware_concurrency();
+			WorkerCount = hardware > 1 ? hardware - 1 : 1;
+		}
+
+		mQueuedCount = 0;
+		mSleepingCount = 0;
+		mIsExitRequested = false;
+		mExecution = Execution;
+
+		if (mExecution == EJobExecution::Fiber)
+		{
+			mFibers.reserve(FiberCount);
+			for (uint32_t i = 0; i < FiberCount; ++i)
+			{
+				auto* pFiber = new JobFiber();
+				pFiber->pOwner = this;
+				if (pFiber->Context.Create(FIBER_STACK_SIZE, &JobSystem::FiberMain, pFiber) == false)
+				{
+					delete pFiber;
+					break;
+				}
+				mFibers.push_back(pFiber);
+			}
+			mFreeFibers = mFibers;
+			if (mFibers.empty() == true)
+			{
+				ECSE_LOG(ELogLevel::Warning, "JobSystem: failed to create fibers, running jobs on the worker stacks.");
+				mExecution = EJobExecution::Thread;
+			}
+		}
+
+		//	ワーカーが他のスレッドの状態を読むので、起動する前に全て作っておく
+		mThreads.reserve(WorkerCount + 1);
+		for (uint32_t i = 0; i <= WorkerCount; ++i)
+		{
+			auto state = std::make_unique<ThreadState>();
+			state->Random = 0x9E3779B9u * (i + 1);
+			mThreads.push_back(std::move(state));
+		}
+		ThreadContext& context = GetThreadContext();
+		context.pOwner = this;
+		context.Index = 0;
+
+		mWorkers.reserve(WorkerCount);
+		for (uint32_t i = 1; i <= WorkerCount; ++i)
+		{
+			mWorkers.emplace_back(&JobSystem::WorkerMain, this, i);
+		}
+
+		ECSE_LOG(ELogLevel::Log, "JobSystem: {} workers{}.", WorkerCount,
+			mExecution == EJobExecution::Fiber ? std::format(", {} fibers", mFibers.size()) : std::string());
+		return true;
+	}
+
+	/// <summary>
+	/// 仕事を積む（完了は待たない）
+	/// </summary>
+	/// <param name="Func">仕事</param>
+	/// <param name="pCounter">完了を数えるカウンター（不要なら nullptr）</param>
+	void JobSystem::Run(std::function<void()> Func, JobCounter* pCounter)
+	{
+		if (pCounter != nullptr) pCounter->mValue.fetch_add(1, std::memory_order_relaxed);
+		this->Push(AllocateJob(std::move(Func), pCounter));
+	}
+
+	/// <summary>
+	/// After が 0 になってから仕事を積む（既に 0 ならすぐ積む）
+	/// </summary>
+	/// <param name="Func">仕事</param>
+	/// <param name="pCounter">完了を数えるカウンター（不要なら nullptr）</param>
+	/// <param name="After">先に終わっていてほしい仕事のカウンター</param>
+	void JobSystem::Run(std::function<void()> Func, JobCounter* pCounter, JobCounter& After)
+	{
+		if (pCounter != nullptr) pCounter->mValue.fetch_add(1, std::memory_order_relaxed);
+		Job* pJob = AllocateJob(std::move(Func), pCounter);
+
+		if (this->AddWaiter(After, pJob) == false) this->Push(pJob);
+	}
+
+	/// <summary>
+	/// カウンターが 0 になるまで、他の仕事を手伝いながら待つ
+	/// </summary>
+	void JobSystem::Wait(JobCounter& Counter)
+	{
+		//	ファイバーの上なら止まってワーカーを空ける（戻ってきた時に 0 でなければもう一度止まる）
+		if (GetThreadContext().pCurrentFiber != nullptr)
+		{
+			while (Counter.IsDone() == false)
+			{
+				this->Suspend(Counter);
+			}
+			return;
+		}
+
+		const uint32_t index = this->GetThreadIndex();
+		while (Counter.IsDone() == false)
+		{
+			Job* pJob = this->FindJob(index);
+			if (pJob != nullptr)
+			{
+				this->Execute(pJob, index);
+				continue;
+			}
+			//	残りは他のスレッドが実行中
+			std::this_thread::yield();
+		}
+	}
+
+	/// <summary>
+	/// JobSystem の外の処理（I/O など）の完了を待つためにカウンターを増やす（終わったら Complete を呼ぶ）
+	/// </summary>
+	void JobSystem::AddPending(JobCounter& Counter, uint32_t Count)
+	{
+		Counter.mValue.fetch_add(Count, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// AddPending した処理が1つ終わった（どのスレッドから呼んでもよい）
+	/// </summary>
+	void JobSystem::Complete(JobCounter& Counter)
+	{
+		this->Decrement(Counter);
+	}
+
+	/// <summary>
+	/// [0, Count) を分けて並列に処理し、全て終わるまで待つ（呼んだスレッドも処理する）
+	/// </summary>
+	/// <param name="Count">要素数</param>
+	/// <param name="Func">[Begin, End) を処理する関数</param>
+	/// <param name="MinGrain">1回に処理する最小の要素数（1要素が軽い時に大きくする）</param>
+	void JobSystem::ParallelFor(uint32_t Count, const std::function<void(uint32_t, uint32_t)>& Func, uint32_t MinGrain)
+	{
+		if (Count == 0) return;
+		if (MinGrain == 0) MinGrain = 1;
+
+		//	分ける意味がない
+		const uint64_t threadCount = mThreads.size();
+		if (threadCount <= 1 || Count <= MinGrain)
+		{
+			Func(0, Count);
+			return;
+		}
+
+		//	1スレッドあたり16塊くらいを目安にし、偏りは分け直しで吸収する
+		const uint64_t chunkCount = threadCount * 16;
+		const uint32_t grain = std::max(MinGrain, static_cast<uint32_t>((Count + chunkCount - 1) / chunkCount));
+
+		JobCounter counter;
+		this->RunRange(Func, counter, grain, 0, Count);
+		this->Wait(counter);
+	}
+
+	/// <summary>
+	/// JobSystem があれば ParallelFor で分け、なければ呼んだスレッドで [0, Count) をまとめて処理する
+	/// </summary>
+	/// <param name="Count">要素数</param>
+	/// <param name="Func">[Begin, End) を処理する関数</param>
+	/// <param name="MinGrain">1回に処理する最小の要素数（1要素が軽い時に大きくする）</param>
+	void JobSystem::ParallelForOrInline(uint32_t Count, const std::function<void(uint32_t, uint32_t)>& Func, uint32_t MinGrain)
+	{
+		if (Count == 0) return;
+		if (JobSystem* pJobs = ServiceLocator::Get<JobSystem>())
+		{
+			pJobs->ParallelFor(Count, Func, MinGrain);
+			return;
+		}
+		Func(0, Count);
+	}
+
+	/// <summary>
+	/// ワーカー数（メインスレッドは含まない）
+	/// </summary>
+	uint32_t JobSystem::GetWorkerCount() const
+	{
+		return static_cast<uint32_t>(mWorkers.size());
+	}
+
+	/// <summary>
+	/// 呼んだスレッドの番号（0:メインスレッド、1～:ワーカー、それ以外は INVALID_THREAD_INDEX）
+	/// </summary>
+	uint32_t JobSystem::GetThreadIndex() const
+	{
+		const ThreadContext& context = GetThreadContext();
+		return context.pOwner == this ? context.Index : INVALID_THREAD_INDEX;
+	}
+
+	/// <summary>
+	/// 仕事の動かし方
+	/// </summary>
+	EJobExecution JobSystem::GetExecution() const
+	{
+		return mExecution;
+	}
+
+	/// <summary>
+	/// 直近までの数
+	/// </summary>
+	JobSystemStats JobSystem::GetStats() const
+	{
+		JobSystemStats stats;
+		for (const auto& state : mThreads)
+		{
+			stats.Executed += state->Executed.load(std::memory_order_relaxed);
+			stats.Stolen += state->Stolen.load(std::memory_order_relaxed);
+			stats.Splits += state->Splits.load(std::memory_order_relaxed);
+			stats.Sleeps += state->Sleeps.load(std::memory_order_relaxed);
+			stats.Suspends += state->Suspends.load(std::memory_order_relaxed);
+			stats.InlineRuns += state->InlineRuns.load(std::memory_order_relaxed);
+		}
+		return stats;
+	}
+
+	/// <summary>
+	/// ワーカー本体
+	/// </summary>
+	void JobSystem::WorkerMain(uint32_t Index)
+	{
+		ThreadContext& context = GetThreadContext();
+		context.pOwner = this;
+		context.Index = Index;
+		ThreadState& state = *mThreads[Index];
+
+		uint32_t idleCount = 0;
+		while (true)
+		{
+			Job* pJob = this->FindJob(Index);
+			if (pJob != nullptr)
+			{
+				this->Execute(pJob, Index);
+				idleCount = 0;
+				continue;
+			}
+
+			//	残っている仕事は流し切ってから抜ける
+			if (mIsExitRequested.load(std::memory_order_acquire) == true) break;
+
+			//	すぐ次が積まれることが多いので、少し探し直してから眠る
+			if (++idleCount < SPIN_COUNT)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			idleCount = 0;
+
+			//	Push は数を増やしてから眠っている数を見るので、どちらかが必ず相手に気付く
+			std::unique_lock lock(mSleepMutex);
+			mSleepingCount.fetch_add(1);
+			mCondition.wait(lock, [this]() { return mQueuedCount.load() > 0 || mIsExitRequested.load() == true; });
+			mSleepingCount.fetch_sub(1);
+			state.Sleeps.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		context.Scheduler.Destroy();
+		context.pIdleFiber = nullptr;
+		context.pOwner = nullptr;
+		context.Index = INVALID_THREAD_INDEX;
+	}
+
+	/// <summary>
+	/// ワーカーの停止（残っている仕事は流し切る）
+	/// </summary>
+	void JobSystem::Stop()
+	{
+		if (mThreads.empty() == true) return;
+
+		{
+			std::lock_guard lock(mSleepMutex);
+			mIsExitRequested = true;
+		}
+		mCondition.notify_all();
+
+		for (auto& worker : mWorkers)
+		{
+			if (worker.joinable() == true) worker.join();
+		}
+		mWorkers.clear();
+
+		//	ワーカーが抜けた後に残った仕事（それが積んだ仕事も）をここで流す
+		const uint32_t index = this->GetThreadIndex();
+		while (Job* pJob = this->FindJob(index))
+		{
+			this->Execute(pJob, index);
+		}
+
+		mThreads.clear();
+		mSharedJobs.clear();
+
+		ThreadContext& context = GetThreadContext();
+		if (context.pOwner == this)
+		{
+			context.Scheduler.Destroy();
+			context.pIdleFiber = nullptr;
+			context.pOwner = nullptr;
+			context.Index = INVALID_THREAD_INDEX;
+		}
+
+		//	まだ止まっているファイバー（0 にならないカウンターを待っている）も捨てる
+		for (JobFiber* pFiber : mFibers)
+		{
+			delete pFiber;
+		}
+		mFibers.clear();
+		mFreeFibers.clear();
+	}
+
+	/// <summary>
+	/// 仕事をキューへ入れ、眠っているワーカーがいれば起こす
+	/// </summary>
+	void JobSystem::Push(Job* pJob)
+	{
+		//	Initialize 前はその場で実行
+		if (mThreads.empty() == true)
+		{
+			this->Execute(pJob, INVALID_THREAD_INDEX);
+			return;
+		}
+
+		const uint32_t index = this->GetThreadIndex();
+		if (index != INVALID_THREAD_INDEX)
+		{
+			mThreads[index]->Queue.Push(pJob);
+		}
+		else
+		{
+			std::lock_guard lock(mSharedMutex);
+			mSharedJobs.push_back(pJob);
+		}
+
+		mQueuedCount.fetch_add(1);
+		if (mSleepingCount.load() > 0)
+		{
+			{
+				std::lock_guard lock(mSleepMutex);
+			}
+			mCondition.notify_one();
+		}
+	}
+
+	/// <summary>
+	/// 次の仕事を探す（自分のキュー → 共有のキュー → 他のスレッドのキュー）
+	/// </summary>
+	/// <returns>見つからなければ nullptr</returns>
+	Job* JobSystem::FindJob(uint32_t Index)
+	{
+		Job* pJob = nullptr;
+		if (Index != INVALID_THREAD_INDEX && mThreads[Index]->Queue.Pop(pJob) == true)
+		{
+			mQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+			return pJob;
+		}
+
+		//	どこにも無ければ鍵も他のスレッドのキャッシュラインも触らない
+		if (mQueuedCount.load(std::memory_order_relaxed) <= 0) return nullptr;
+
+		{
+			std::lock_guard lock(mSharedMutex);
+			if (mSharedJobs.empty() == false)
+			{
+				pJob = mSharedJobs.front();
+				mSharedJobs.pop_front();
+			}
+		}
+		if (pJob != nullptr)
+		{
+			mQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+			return pJob;
+		}
+
+		//	盗む相手は毎回ずらして、同じスレッドに集まらないようにする
+		const uint32_t threadCount = static_cast<uint32_t>(mThreads.size());
+		uint32_t& random = Index != INVALID_THREAD_INDEX ? mThreads[Index]->Random : GetThreadContext().Random;
+		const uint32_t start = NextRandom(random) % threadCount;
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			const uint32_t victim = (start + i) % threadCount;
+			if (victim == Index) continue;
+			if (mThreads[victim]->Queue.Steal(pJob) == false) continue;
+
+			mQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+			if (Index != INVALID_THREAD_INDEX) mThreads[Index]->Stolen.fetch_add(1, std::memory_order_relaxed);
+			return pJob;
+		}
+		return nullptr;
+	}
+
+	/// <summary>
+	/// 仕事を実行する（ファイバーで動かすか、止まっていたファイバーの続きを動かす）
+	/// </summary>
+	void JobSystem::Execute(Job* pJob, uint32_t Index)
+	{
+		//	止まっていたファイバーの続き
+		if (pJob->pFiber != nullptr)
+		{
+			JobFiber* pFiber = pJob->pFiber;
+			FreeJob(pJob);
+			this->SwitchToFiber(pFiber);
+			return;
+		}
+
+		//	ファイバーは番号のあるスレッドのスタックからだけ使う（ファイバーの中で積まれた仕事は Wait で止まるので、ここへは来ない）
+		if (mExecution == EJobExecution::Fiber && Index != INVALID_THREAD_INDEX && GetThreadContext().pCurrentFiber == nullptr)
+		{
+			JobFiber* pFiber = this->AcquireFiber();
+			if (pFiber != nullptr)
+			{
+				pFiber->pJob = pJob;
+				this->SwitchToFiber(pFiber);
+				return;
+			}
+			mThreads[Index]->InlineRuns.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		this->RunJob(pJob);
+	}
+
+	/// <summary>
+	/// 仕事の関数を呼び、カウンターを減らす
+	/// </summary>
+	void JobSystem::RunJob(Job* pJob)
+	{
+		pJob->Function();
+
+		//	Function の中で止まって別のスレッドへ移っているかもしれないので、番号は引き直す
+		//	待っている側が統計を読んでも数え漏れがないよう、カウンターを減らす前に数える
+		const uint32_t index = this->GetThreadIndex();
+		if (index != INVALID_THREAD_INDEX && index < mThreads.size())
+		{
+			mThreads[index]->Executed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		JobCounter* pCounter = pJob->pCounter;
+		FreeJob(pJob);
+		if (pCounter != nullptr) this->Decrement(*pCounter);
+	}
+
+	/// <summary>
+	/// スレッドのスタックからファイバーへ切り替え、戻ってきたら止まった理由に応じて片付ける
+	/// ファイバーが止まり切る前に他のスレッドが続きを動かさないよう、待ちへの登録は戻ってきたスレッドのスタックで行う。
+	/// </summary>
+	void JobSystem::SwitchToFiber(JobFiber* pFiber)
+	{
+		//	スレッドのスタックはスレッドを移らないので、ここでは context をそのまま使える
+		ThreadContext& context = GetThreadContext();
+		if (context.Scheduler.IsValid() == false && context.Scheduler.ConvertCurrentThread() == false)
+		{
+			//	切り替えられないので、このスレッドのスタックで動かす（続きの場合は他のスレッドに任せる）
+			if (pFiber->pJob == nullptr)
+			{
+				Job* pResume = AllocateJob(nullptr, nullptr);
+				pResume->pFiber = pFiber;
+				this->Push(pResume);
+				return;
+			}
+			Job* pJob = pFiber->pJob;
+			pFiber->pJob = nullptr;
+			this->ReleaseFiber(pFiber);
+			this->RunJob(pJob);
+			return;
+		}
+
+		context.pCurrentFiber = pFiber;
+		context.Action = EFiberAction::None;
+		Fiber::Switch(context.Scheduler, pFiber->Context);
+		context.pCurrentFiber = nullptr;
+
+		const EFiberAction action = context.Action;
+		context.Action = EFiberAction::None;
+		if (action == EFiberAction::Finished)
+		{
+			this->ReleaseFiber(pFiber);
+		}
+		else if (action == EFiberAction::Waiting)
+		{
+			JobCounter& counter = *context.pWaitCounter;
+			context.pWaitCounter = nullptr;
+			Job* pResume = AllocateJob(nullptr, nullptr);
+			pResume->pFiber = pFiber;
+			if (this->AddWaiter(counter, pResume) == false) this->Push(pResume);
+		}
+	}
+
+	/// <summary>
+	/// 今動いているファイバーを止め、Counter が 0 になったら続きを積むようにする
+	/// </summary>
+	void JobSystem::Suspend(JobCounter& Counter)
+	{
+		ThreadContext& context = GetThreadContext();
+		JobFiber* pFiber = context.pCurrentFiber;
+		if (context.Index < mThreads.size()) mThreads[context.Index]->Suspends.fetch_add(1, std::memory_order_relaxed);
+
+		context.Action = EFiberAction::Waiting;
+		context.pWaitCounter = &Counter;
+		Fiber::Switch(pFiber->Context, context.Scheduler);
+		//	ここから先は別のスレッドかもしれない（context は使わない）
+	}
+
+	/// <summary>
+	/// ファイバーの入口（仕事を1つ動かすごとにスレッドのスタックへ戻る）
+	/// </summary>
+	void JobSystem::FiberMain(void* pUserData)
+	{
+		JobFiber* pFiber = static_cast<JobFiber*>(pUserData);
+		while (true)
+		{
+			Job* pJob = pFiber->pJob;
+			pFiber->pJob = nullptr;
+			pFiber->pOwner->RunJob(pJob);
+
+			ThreadContext& context = GetThreadContext();
+			context.Action = EFiberAction::Finished;
+			Fiber::Switch(pFiber->Context, context.Scheduler);
+		}
+	}
+
+	/// <summary>
+	/// 空いたファイバーを取る（無ければ nullptr）
+	/// </summary>
+	JobFiber* JobSystem::AcquireFiber()
+	{
+		ThreadContext& context = GetThreadContext();
+		if (context.pIdleFiber != nullptr)
+		{
+			JobFiber* pFiber = context.pIdleFiber;
+			context.pIdleFiber = nullptr;
+			return pFiber;
+		}
+
+		std::lock_guard lock(mFiberMutex);
+		if (mFreeFibers.empty() == true) return nullptr;
+		JobFiber* pFiber = mFreeFibers.back();
+		mFreeFibers.pop_back();
+		return pFiber;
+	}
+
+	/// <summary>
+	/// 仕事を終えたファイバーを返す
+	/// </summary>
+	void JobSystem::ReleaseFiber(JobFiber* pFiber)
+	{
+		//	次の仕事もこのスレッドで動かすことが多いので、1つは鍵を取らずに使えるよう手元に置く
+		ThreadContext& context = GetThreadContext();
+		if (context.pIdleFiber == nullptr)
+		{
+			context.pIdleFiber = pFiber;
+			return;
+		}
+
+		std::lock_guard lock(mFiberMutex);
+		mFreeFibers.push_back(pFiber);
+	}
+
+	/// <summary>
+	/// カウンターが 0 になるのを待つ仕事に加える
+	/// 0 にしたスレッドは mMutex を取ってから待ちを取り出すので、ここで 0 でなければ必ず拾われる。
+	/// </summary>
+	/// <returns>false:既に 0 だった（加えていない）</returns>
+	bool JobSystem::AddWaiter(JobCounter& Counter, Job* pJob)
+	{
+		std::lock_guard lock(Counter.mMutex);
+		if (Counter.mValue.load(std::memory_order_acquire) == 0) return false;
+		Counter.mWaiters.push_back(pJob);
+		return true;
+	}
+
+	/// <summary>
+	/// カウンターを 1 減らし、0 になったら待っていた仕事を積む
+	/// </summary>
+	void JobSystem::Decrement(JobCounter& Counter)
+	{
+		//	待っている側が 0 を見てカウンターを破棄しないように、触り終わるまで mReleasing で引き留める
+		Counter.mReleasing.fetch_add(1);
+		if (Counter.mValue.fetch_sub(1) != 1)
+		{
+			Counter.mReleasing.fetch_sub(1);
+			return;
+		}
+
+		std::vector<Job*> waiters;
+		{
+			std::lock_guard lock(Counter.mMutex);
+			waiters.swap(Counter.mWaiters);
+		}
+		Counter.mReleasing.fetch_sub(1);
+
+		for (Job* pJob : waiters)
+		{
+			this->Push(pJob);
+		}
+	}
+
+	/// <summary>
+	/// ParallelFor の範囲を処理する（盗まれていたら残りを半分に分けて積む）
+	/// 自分のキューが空＝前に分けた分が他のスレッドに盗まれたので、まだ手の空いているスレッドがいるかもしれない。
+	/// その時だけ分けるので、誰も盗みに来なければ分けずに小さな塊ずつ順に処理する。
+	/// </summary>
+	void JobSystem::RunRange(const std::function<void(uint32_t, uint32_t)>& Func, JobCounter& Counter, uint32_t Grain, uint32_t Begin, uint32_t End)
+	{
+		while (Begin < End)
+		{
+			//	Func の中の Wait でファイバーごと別のスレッドへ移ることがあるので、番号は毎回引き直す
+			const uint32_t index = this->GetThreadIndex();
+			const uint32_t remaining = End - Begin;
+			const bool isHungry = index != INVALID_THREAD_INDEX ? mThreads[index]->Queue.GetSize() == 0 : mQueuedCount.load(std::memory_order_relaxed) <= 0;
+			if (remaining > static_cast<uint64_t>(Grain) * 2 && isHungry == true)
+			{
+				const uint32_t middle = Begin + remaining / 2;
+				this->Run([this, &Func, &Counter, Grain, middle, End]()
+					{
+						this->RunRange(Func, Counter, Grain, middle, End);
+					}, &Counter);
+				if (index != INVALID_THREAD_INDEX) mThreads[index]->Splits.fetch_add(1, std::memory_order_relaxed);
+				End = middle;
+				continue;
+			}
+
+			const uint32_t end = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(Begin) + Grain, End));
+			Func(Begin, end);
+			Begin = end;
+		}
+	}
+}
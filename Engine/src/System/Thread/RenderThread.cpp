@@ -0,0 +1,145 @@
+﻿#include "pch.h"
+#include<System/Thread/RenderThread.hpp>
+
+namespace Ecse::System
+{
+	RenderThread::RenderThread()
+		:mThread()
+		, mMutex()
+		, mCondition()
+		, mRenderFunc()
+		, mSlot(0)
+		, mHasWork(false)
+		, mIsBusy(false)
+		, mIsExitRequested(false)
+		, mLastRenderMs(0.0)
+		, mLastWaitMs(0.0)
+	{
+	}
+
+	RenderThread::~RenderThread()
+	{
+		this->Stop();
+	}
+
+	/// <summary>
+	/// スレッドの開始
+	/// </summary>
+	/// <param name="RenderFunc">スナップショット番号を受け取って1フレーム分を記録・送信する処理</param>
+	/// <returns>true:成功</returns>
+	bool RenderThread::Start(std::function<void(uint32_t)> RenderFunc)
+	{
+		if (mThread.joinable() == true) return false;
+		if (RenderFunc == nullptr) return false;
+
+		mRenderFunc = std::move(RenderFunc);
+		mHasWork = false;
+		mIsBusy = false;
+		mIsExitRequested = false;
+		mThread = std::thread(&RenderThread::ThreadMain, this);
+		return true;
+	}
+
+	/// <summary>
+	/// スナップショットの描画を依頼する
+	/// </summary>
+	/// <param name="Slot">描画するスナップショット番号</param>
+	void RenderThread::Kick(uint32_t Slot)
+	{
+		const auto waitStart = std::chrono::steady_clock::now();
+
+		std::unique_lock lock(mMutex);
+
+		//	前のフレームの描画が終わるまで待つ（もう片方のスナップショットを解放してもらう）
+		mCondition.wait(lock, [this]() { return mHasWork == false && mIsBusy == false; });
+
+		mLastWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+
+		mSlot = Slot;
+		mHasWork = true;
+		lock.unlock();
+		mCondition.notify_all();
+	}
+
+	/// <summary>
+	/// 依頼済みのフレームの描画完了まで待つ
+	/// </summary>
+	void RenderThread::WaitIdle()
+	{
+		if (mThread.joinable() == false) return;
+
+		std::unique_lock lock(mMutex);
+		mCondition.wait(lock, [this]() { return mHasWork == false && mIsBusy == false; });
+	}
+
+	/// <summary>
+	/// スレッドの停止（依頼済みのフレームは描画してから止める）
+	/// </summary>
+	void RenderThread::Stop()
+	{
+		if (mThread.joinable() == false) return;
+
+		{
+			std::lock_guard lock(mMutex);
+			mIsExitRequested = true;
+		}
+		mCondition.notify_all();
+		mThread.join();
+	}
+
+	/// <summary>
+	/// 起動しているかどうか
+	/// </summary>
+	bool RenderThread::IsRunning() const
+	{
+		return mThread.joinable();
+	}
+
+	/// <summary>
+	/// 直近のフレームの記録・送信にかかった時間（ミリ秒）
+	/// </summary>
+	double RenderThread::GetLastRenderMs() const
+	{
+		return mLastRenderMs.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// 直近の Kick で描画スレッドを待った時間（ミリ秒）
+	/// </summary>
+	double RenderThread::GetLastWaitMs() const
+	{
+		return mLastWaitMs;
+	}
+
+	/// <summary>
+	/// スレッド本体
+	/// </summary>
+	void RenderThread::ThreadMain()
+	{
+		while (true)
+		{
+			uint32_t slot = 0;
+			{
+				std::unique_lock lock(mMutex);
+				mCondition.wait(lock, [this]() { return mHasWork == true || mIsExitRequested == true; });
+
+				//	依頼が残っていれば描画してから抜ける
+				if (mHasWork == false) break;
+
+				slot = mSlot;
+				mHasWork = false;
+				mIsBusy = true;
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			mRenderFunc(slot);
+			mLastRenderMs.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+
+			{
+				std::lock_guard lock(mMutex);
+				mIsBusy = false;
+			}
+			mCondition.notify_all();
+		}
+	}
+}
@@ -0,0 +1,103 @@
+﻿#include "pch.h"
+#include<System/Thread/TaskFrameAllocator.hpp>
+
+#include<array>
+#include<atomic>
+#include<bit>
+#include<new>
+#include<vector>
+
+namespace Ecse::System
+{
+	namespace
+	{
+		/// <summary>
+		/// 使い終わったフレーム（段ごと）
+		/// </summary>
+		struct FrameCache
+		{
+			std::array<std::vector<void*>, TaskFrameAllocator::SIZE_CLASS_COUNT> Frames;
+
+			~FrameCache()
+			{
+				for (std::vector<void*>& frames : Frames)
+				{
+					for (void* pFrame : frames)
+					{
+						::operator delete(pFrame);
+					}
+				}
+			}
+		};
+
+		thread_local FrameCache tFrameCache;
+
+		std::atomic<uint64_t> sAllocations = 0;
+		std::atomic<uint64_t> sReused = 0;
+		std::atomic<uint64_t> sLarge = 0;
+
+		//	大きさから段（64 → 0、65～128 → 1 ...）
+		uint32_t GetSizeClass(size_t Size)
+		{
+			if (Size <= TaskFrameAllocator::MIN_SIZE) return 0;
+			return static_cast<uint32_t>(std::bit_width(Size - 1)) - static_cast<uint32_t>(std::bit_width(TaskFrameAllocator::MIN_SIZE - 1));
+		}
+	}
+
+	/// <summary>
+	/// 確保する
+	/// </summary>
+	void* TaskFrameAllocator::Allocate(size_t Size)
+	{
+		sAllocations.fetch_add(1, std::memory_order_relaxed);
+		if (Size > MAX_SIZE)
+		{
+			sLarge.fetch_add(1, std::memory_order_relaxed);
+			return ::operator new(Size);
+		}
+
+		const uint32_t sizeClass = GetSizeClass(Size);
+		std::vector<void*>& frames = tFrameCache.Frames[sizeClass];
+		if (frames.empty() == false)
+		{
+			void* pFrame = frames.back();
+			frames.pop_back();
+			sReused.fetch_add(1, std::memory_order_relaxed);
+			return pFrame;
+		}
+		return ::operator new(MIN_SIZE << sizeClass);
+	}
+
+	/// <summary>
+	/// 解放する（Size は Allocate と同じもの）
+	/// </summary>
+	void TaskFrameAllocator::Free(void* pFrame, size_t Size)
+	{
+		if (pFrame == nullptr) return;
+		if (Size > MAX_SIZE)
+		{
+			::operator delete(pFrame);
+			return;
+		}
+
+		std::vector<void*>& frames = tFrameCache.Frames[GetSizeClass(Size)];
+		if (frames.size() < MAX_CACHED_PER_CLASS)
+		{
+			frames.push_back(pFrame);
+			return;
+		}
+		::operator delete(pFrame);
+	}
+
+	/// <summary>
+	/// 直近までの数
+	/// </summary>
+	TaskFrameStats TaskFrameAllocator::GetStats()
+	{
+		TaskFrameStats stats;
+		stats.Allocations = sAllocations.load(std::memory_order_relaxed);
+		stats.Reused = sReused.load(std::memory_order_relaxed);
+		stats.Large = sLarge.load(std::memory_order_relaxed);
+		return stats;
+	}
+}
@@ -0,0 +1,227 @@
+﻿#include "pch.h"
+#include<System/Thread/TaskScheduler.hpp>
+#include<System/Service/ServiceLocator.hpp>
+#if defined(_WIN32)
+#include<Graphics/DX12/DX12.hpp>
+#endif
+
+namespace Ecse::System
+{
+	/// <summary>
+	/// 初期化（実質コンストラクタ）
+	/// </summary>
+	void TaskScheduler::OnCreate()
+	{
+#if defined(_WIN32)
+		mFenceWaiters.clear();
+#endif
+		mFrameWaiters.clear();
+		mResumes.clear();
+		mResumedCount = 0;
+		mFrameCount = 0;
+	}
+
+	/// <summary>
+	/// 終了処理（実質デストラクタ）
+	/// 待っているものは再開できないので、そのまま手放す（フレームは片付かない）
+	/// </summary>
+	void TaskScheduler::OnDestroy()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+#if defined(_WIN32)
+		if (mFenceWaiters.empty() == false || mFrameWaiters.empty() == false)
+		{
+			ECSE_LOG(ELogLevel::Warning, "TaskScheduler: {} fence and {} frame waiters were dropped.", mFenceWaiters.size(), mFrameWaiters.size());
+		}
+		mFenceWaiters.clear();
+#else
+		if (mFrameWaiters.empty() == false)
+		{
+			ECSE_LOG(ELogLevel::Warning, "TaskScheduler: {} frame waiters were dropped.", mFrameWaiters.size());
+		}
+#endif
+		mFrameWaiters.clear();
+		mResumes.clear();
+	}
+
+	/// <summary>
+	/// JobSystem のワーカーへ移って続ける（JobSystem が無ければそのまま続ける）
+	/// </summary>
+	TaskScheduler::JobAwaiter TaskScheduler::Schedule()
+	{
+		return JobAwaiter(*this, nullptr);
+	}
+
+	/// <summary>
+	/// カウンターが 0 になってから、JobSystem のワーカーで続ける（既に 0 ならそのまま続ける）
+	/// </summary>
+	TaskScheduler::JobAwaiter TaskScheduler::WaitFor(JobCounter& Counter)
+	{
+		return JobAwaiter(*this, &Counter);
+	}
+
+	/// <summary>
+	/// ファイルを読み、読み終わったら JobSystem のワーカーで続ける
+	/// </summary>
+	/// <param name="File">AsyncFileIO で開いたファイル</param>
+	/// <param name="Buffer">書き込み先（読み終わるまで持っておく）</param>
+	/// <param name="Offset">ファイル先頭からの位置</param>
+	/// <param name="Priority">優先度</param>
+	/// <returns>読み込みの結果を返す待ち（受け付けられなければ Failed ですぐに続く）</returns>
+	CallbackAwaiter<AsyncReadCompletion> TaskScheduler::Read(AsyncFileHandle File, std::span<uint8_t> Buffer, uint64_t Offset, EAsyncIOPriority Priority)
+	{
+		return CallbackAwaiter<AsyncReadCompletion>([File, Buffer, Offset, Priority](CallbackAwaiter<AsyncReadCompletion>::ResumeFunction Resume)
+			{
+				AsyncFileIO* pIO = ServiceLocator::Get<AsyncFileIO>();
+				if (pIO == nullptr)
+				{
+					Resume(AsyncReadCompletion{});
+					return;
+				}
+
+				AsyncReadRequest request;
+				request.File = File;
+				request.Offset = Offset;
+				request.Buffer = Buffer;
+				request.Priority = Priority;
+				//	I/O スレッドで続きを動かすと他の完了が遅れるので、ワーカーへ回す
+				request.OnComplete = [Resume](const AsyncReadCompletion& Completion)
+					{
+						JobSystem* pJobs = ServiceLocator::Get<JobSystem>();
+						if (pJobs == nullptr)
+						{
+							Resume(Completion);
+							return;
+						}
+						pJobs->Run([Resume, Completion]() { Resume(Completion); });
+					};
+
+				//	受け付けられなければ OnComplete は呼ばれない
+				if (pIO->Read(std::move(request)) == INVALID_ASYNC_READ_HANDLE)
+				{
+					Resume(AsyncReadCompletion{});
+				}
+			});
+	}
+
+#if defined(_WIN32)
+	/// <summary>
+	/// GPU がフェンスの値に届いたら、ゲームスレッドの Update で続ける
+	/// </summary>
+	TaskScheduler::FenceAwaiter TaskScheduler::WaitForFence(ID3D12Fence* pFence, uint64_t Value)
+	{
+		return FenceAwaiter(*this, pFence, Value);
+	}
+
+	/// <summary>
+	/// ここまでに DX12 が積んだ GPU の処理が終わったら、ゲームスレッドの Update で続ける（DX12 が無ければそのまま続ける）
+	/// </summary>
+	TaskScheduler::FenceAwaiter TaskScheduler::WaitForGPU()
+	{
+		Graphics::DX12* pDX12 = ServiceLocator::Get<Graphics::DX12>();
+		if (pDX12 == nullptr) return FenceAwaiter(*this, nullptr, 0);
+		return FenceAwaiter(*this, pDX12->GetFence(), pDX12->GetLastSignaledFenceValue());
+	}
+#endif
+
+	/// <summary>
+	/// 次のフレームの Update で続ける
+	/// </summary>
+	TaskScheduler::FrameAwaiter TaskScheduler::NextFrame()
+	{
+		return FrameAwaiter(*this);
+	}
+
+	/// <summary>
+	/// フェンスに届いたものと、次のフレームを待っていたものを再開する（ゲームスレッドでフレームに1回）
+	/// </summary>
+	void TaskScheduler::Update()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFrameCount++;
+
+			//	再開した先で次のフレームを待ったら次の Update で再開するように、今の分だけを取り出す
+			mResumes.swap(mFrameWaiters);
+
+#if defined(_WIN32)
+			for (size_t i = 0; i < mFenceWaiters.size();)
+			{
+				FenceWaiter& waiter = mFenceWaiters[i];
+				if (waiter.pFence->GetCompletedValue() < waiter.Value)
+				{
+					i++;
+					continue;
+				}
+				mResumes.push_back(waiter.Handle);
+				waiter = mFenceWaiters.back();
+				mFenceWaiters.pop_back();
+			}
+#endif
+			mResumedCount += mResumes.size();
+		}
+
+		//	再開した先で待ちを加えられるよう、ロックの外で動かす
+		for (std::coroutine_handle<> handle : mResumes)
+		{
+			handle.resume();
+		}
+		mResumes.clear();
+	}
+
+	/// <summary>
+	/// 直近までの待ちの数
+	/// </summary>
+	TaskSchedulerStats TaskScheduler::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		TaskSchedulerStats stats;
+#if defined(_WIN32)
+		stats.WaitingFences = static_cast<uint32_t>(mFenceWaiters.size());
+#endif
+		stats.WaitingFrames = static_cast<uint32_t>(mFrameWaiters.size());
+		stats.Resumed = mResumedCount;
+		stats.Frames = mFrameCount;
+		return stats;
+	}
+
+	/// <summary>
+	/// JobSystem のワーカーで続きを動かす
+	/// </summary>
+	/// <returns>true:止まる（JobSystem が無ければ false でそのまま続ける）</returns>
+	bool TaskScheduler::ResumeOnWorker(std::coroutine_handle<> Handle, JobCounter* pAfter)
+	{
+		JobSystem* pJobs = ServiceLocator::Get<JobSystem>();
+		if (pJobs == nullptr) return false;
+
+		if (pAfter != nullptr)
+		{
+			pJobs->Run([Handle]() { Handle.resume(); }, nullptr, *pAfter);
+		}
+		else
+		{
+			pJobs->Run([Handle]() { Handle.resume(); });
+		}
+		return true;
+	}
+
+#if defined(_WIN32)
+	/// <summary>
+	/// フェンスの待ちを加える
+	/// </summary>
+	void TaskScheduler::AddFenceWaiter(ID3D12Fence* pFence, uint64_t Value, std::coroutine_handle<> Handle)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFenceWaiters.push_back({ pFence, Value, Handle });
+	}
+#endif
+
+	/// <summary>
+	/// 次のフレームの待ちを加える
+	/// </summary>
+	void TaskScheduler::AddFrameWaiter(std::coroutine_handle<> Handle)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFrameWaiters.push_back(Handle);
+	}
+}
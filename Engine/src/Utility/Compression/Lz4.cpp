@@ -0,0 +1,229 @@
+﻿#include "pch.h"
+#include<Utility/Compression/Lz4.hpp>
+
+#include<cstring>
+
+namespace Ecse::Utility
+{
+	namespace
+	{
+		//	一致の最短の長さ
+		constexpr size_t MIN_MATCH = 4;
+		//	最後の 5 バイトは必ずリテラルにする（形式の決まり）
+		constexpr size_t LAST_LITERALS = 5;
+		//	最後の一致はブロックの終わりから 12 バイトより前で始める（形式の決まり）
+		constexpr size_t MATCH_FIND_LIMIT = 12;
+		//	一致を探せる距離
+		constexpr size_t MAX_DISTANCE = 65535;
+		//	展開で決め打ちの大きさで写す時に、書き込み先の終わりまで空けておく大きさ
+		constexpr size_t WILD_COPY_MARGIN = 8;
+		//	ハッシュ表の大きさ（2 の HASH_BITS 乗。16KB なのでスタックに置く）
+		constexpr uint32_t HASH_BITS = 12;
+
+		uint32_t Read32(const uint8_t* p)
+		{
+			uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		uint32_t HashSequence(uint32_t Sequence)
+		{
+			return (Sequence * 2654435761u) >> (32 - HASH_BITS);
+		}
+
+		//	15 を超えた長さを 255 ずつ書く
+		uint8_t* WriteLength(uint8_t* p, size_t Length)
+		{
+			while (Length >= 255)
+			{
+				*p++ = 255;
+				Length -= 255;
+			}
+			*p++ = static_cast<uint8_t>(Length);
+			return p;
+		}
+
+		//	長さの続きを読む（読み切れなければ false）
+		bool ReadLength(const uint8_t*& p, const uint8_t* End, size_t& Length)
+		{
+			uint8_t byte;
+			do
+			{
+				if (p >= End) return false;
+				byte = *p++;
+				Length += byte;
+			} while (byte == 255);
+			return true;
+		}
+
+		/// <summary>
+		/// リテラルと一致を1組書く（MatchLength が 0 なら最後のリテラルだけ）
+		/// </summary>
+		/// <returns>書いた後の位置（収まらなければ nullptr）</returns>
+		uint8_t* WriteSequence(uint8_t* p, const uint8_t* End, const uint8_t* Literals, size_t LiteralLength, size_t Offset, size_t MatchLength)
+		{
+			const size_t worst = 1 + LiteralLength / 255 + 1 + LiteralLength + 2 + MatchLength / 255 + 1;
+			if (static_cast<size_t>(End - p) < worst) return nullptr;
+
+			uint8_t* token = p++;
+			*token = static_cast<uint8_t>((LiteralLength >= 15 ? 15 : LiteralLength) << 4);
+			if (LiteralLength >= 15) p = WriteLength(p, LiteralLength - 15);
+			std::memcpy(p, Literals, LiteralLength);
+			p += LiteralLength;
+
+			if (MatchLength == 0) return p;
+
+			*p++ = static_cast<uint8_t>(Offset);
+			*p++ = static_cast<uint8_t>(Offset >> 8);
+			const size_t length = MatchLength - MIN_MATCH;
+			*token |= static_cast<uint8_t>(length >= 15 ? 15 : length);
+			if (length >= 15) p = WriteLength(p, length - 15);
+			return p;
+		}
+	}
+
+	/// <summary>
+	/// LZ4 のブロック形式で圧縮する（フレームのヘッダーは付けない）
+	/// </summary>
+	/// <param name="Source">元のデータ</param>
+	/// <param name="SourceSize">元の大きさ（バイト）</param>
+	/// <param name="Destination">書き込み先</param>
+	/// <param name="Capacity">書き込み先の大きさ（Lz4CompressBound 以上なら必ず収まる）</param>
+	/// <returns>書いた大きさ（収まらなければ 0）</returns>
+	size_t Lz4Compress(const void* Source, size_t SourceSize, void* Destination, size_t Capacity)
+	{
+		const uint8_t* const src = static_cast<const uint8_t*>(Source);
+		uint8_t* const dst = static_cast<uint8_t*>(Destination);
+		uint8_t* op = dst;
+		const uint8_t* const oend = dst + Capacity;
+		size_t anchor = 0;
+
+		if (SourceSize > MATCH_FIND_LIMIT)
+		{
+			//	位置 + 1 を入れる（0 は空）
+			uint32_t table[1u << HASH_BITS] = {};
+			const size_t matchLimit = SourceSize - LAST_LITERALS;
+			const size_t findLimit = SourceSize - MATCH_FIND_LIMIT;
+			size_t ip = 0;
+
+			while (ip < findLimit)
+			{
+				const uint32_t sequence = Read32(src + ip);
+				uint32_t& slot = table[HashSequence(sequence)];
+				const size_t candidate = slot;
+				slot = static_cast<uint32_t>(ip + 1);
+
+				if (candidate == 0 || ip - (candidate - 1) > MAX_DISTANCE || Read32(src + candidate - 1) != sequence)
+				{
+					//	一致しない所が続くほど大きく飛ばす（圧縮できないデータで時間を使わない）
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+
+				size_t ref = candidate - 1;
+				//	前にも伸ばす
+				while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+				{
+					--ip;
+					--ref;
+				}
+				//	後ろに伸ばす
+				size_t length = MIN_MATCH;
+				while (ip + length < matchLimit && src[ip + length] == src[ref + length]) ++length;
+
+				op = WriteSequence(op, oend, src + anchor, ip - anchor, ip - ref, length);
+				if (op == nullptr) return 0;
+
+				ip += length;
+				anchor = ip;
+				//	一致の終わりの少し前も表に入れると、続く一致が見つかりやすい
+				if (ip - 2 < findLimit) table[HashSequence(Read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+			}
+		}
+
+		op = WriteSequence(op, oend, src + anchor, SourceSize - anchor, 0, 0);
+		if (op == nullptr) return 0;
+		return static_cast<size_t>(op - dst);
+	}
+
+	/// <summary>
+	/// LZ4 のブロック形式を展開する
+	/// </summary>
+	/// <param name="Source">圧縮したデータ</param>
+	/// <param name="SourceSize">圧縮したデータの大きさ（バイト）</param>
+	/// <param name="Destination">書き込み先</param>
+	/// <param name="DestinationSize">展開後の大きさ（ちょうどこの大きさにならなければ失敗）</param>
+	/// <returns>true:成功</returns>
+	bool Lz4Decompress(const void* Source, size_t SourceSize, void* Destination, size_t DestinationSize)
+	{
+		const uint8_t* ip = static_cast<const uint8_t*>(Source);
+		const uint8_t* const iend = ip + SourceSize;
+		uint8_t* const dst = static_cast<uint8_t*>(Destination);
+		uint8_t* op = dst;
+		uint8_t* const oend = dst + DestinationSize;
+
+		while (ip < iend)
+		{
+			const uint8_t token = *ip++;
+
+			//	リテラル
+			size_t literalLength = token >> 4;
+
+			//	短いリテラルは入力と出力に余裕があれば 16 バイト決め打ちで写す（はみ出した分は後で上書きされる）
+			if (literalLength < 15 && iend - ip >= 16 && static_cast<size_t>(oend - op) >= 16 + WILD_COPY_MARGIN)
+			{
+				std::memcpy(op, ip, 16);
+				ip += literalLength;
+				op += literalLength;
+			}
+			else
+			{
+				if (literalLength == 15 && ReadLength(ip, iend, literalLength) == false) return false;
+				if (static_cast<size_t>(iend - ip) < literalLength || static_cast<size_t>(oend - op) < literalLength) return false;
+				std::memcpy(op, ip, literalLength);
+				ip += literalLength;
+				op += literalLength;
+			}
+
+			//	最後の組は一致を持たない
+			if (ip == iend) break;
+
+			//	一致
+			if (iend - ip < 2) return false;
+			const size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > static_cast<size_t>(op - dst)) return false;
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && ReadLength(ip, iend, matchLength) == false) return false;
+			matchLength += MIN_MATCH;
+			if (static_cast<size_t>(oend - op) < matchLength) return false;
+
+			const uint8_t* match = op - offset;
+			if (offset >= 8 && static_cast<size_t>(oend - op) >= matchLength + WILD_COPY_MARGIN)
+			{
+				//	8 バイトずつ写す（最後は少しはみ出す）
+				uint8_t* const end = op + matchLength;
+				do
+				{
+					std::memcpy(op, match, 8);
+					op += 8;
+					match += 8;
+				} while (op < end);
+				op = end;
+			}
+			else if (offset >= matchLength)
+			{
+				std::memcpy(op, match, matchLength);
+				op += matchLength;
+			}
+			else
+			{
+				//	重なる一致は直前の並びの繰り返しなので 1 バイトずつ写す
+				for (size_t i = 0; i < matchLength; ++i) *op++ = *match++;
+			}
+		}
+		return op == oend;
+	}
+}
@@ -0,0 +1,120 @@
+﻿#include "pch.h"
+#include<Utility/Hash/Hash.hpp>
+
+#include<cstring>
+
+namespace Ecse::Utility
+{
+	namespace
+	{
+		constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+		constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+		constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+		constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+		constexpr uint64_t Rotl(uint64_t Value, int Shift)
+		{
+			return (Value << Shift) | (Value >> (64 - Shift));
+		}
+
+		//	リトルエンディアンだけを想定（x64 / ARM64）
+		uint64_t Read64(const uint8_t* p)
+		{
+			uint64_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		uint32_t Read32(const uint8_t* p)
+		{
+			uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		uint64_t Round(uint64_t Acc, uint64_t Input)
+		{
+			Acc += Input * PRIME2;
+			Acc = Rotl(Acc, 31);
+			return Acc * PRIME1;
+		}
+
+		uint64_t MergeRound(uint64_t Acc, uint64_t Value)
+		{
+			Acc ^= Round(0, Value);
+			return Acc * PRIME1 + PRIME4;
+		}
+	}
+
+	/// <summary>
+	/// 中身から求める 64bit のハッシュ（XXH64 と同じ値）
+	/// </summary>
+	/// <param name="Data">先頭</param>
+	/// <param name="Size">大きさ（バイト）</param>
+	/// <param name="Seed">種（同じデータから別のハッシュが欲しい時に変える）</param>
+	uint64_t Hash64(const void* Data, size_t Size, uint64_t Seed)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(Data);
+		const uint8_t* const end = p + Size;
+		uint64_t hash;
+
+		//	32 バイトずつ4本の並びで混ぜる
+		if (Size >= 32)
+		{
+			uint64_t v1 = Seed + PRIME1 + PRIME2;
+			uint64_t v2 = Seed + PRIME2;
+			uint64_t v3 = Seed;
+			uint64_t v4 = Seed - PRIME1;
+			const uint8_t* const limit = end - 32;
+			do
+			{
+				v1 = Round(v1, Read64(p));
+				v2 = Round(v2, Read64(p + 8));
+				v3 = Round(v3, Read64(p + 16));
+				v4 = Round(v4, Read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			hash = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+			hash = MergeRound(hash, v1);
+			hash = MergeRound(hash, v2);
+			hash = MergeRound(hash, v3);
+			hash = MergeRound(hash, v4);
+		}
+		else
+		{
+			hash = Seed + PRIME5;
+		}
+
+		hash += static_cast<uint64_t>(Size);
+
+		//	残り
+		while (p + 8 <= end)
+		{
+			hash ^= Round(0, Read64(p));
+			hash = Rotl(hash, 27) * PRIME1 + PRIME4;
+			p += 8;
+		}
+		if (p + 4 <= end)
+		{
+			hash ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+			hash = Rotl(hash, 23) * PRIME2 + PRIME3;
+			p += 4;
+		}
+		while (p < end)
+		{
+			hash ^= static_cast<uint64_t>(*p) * PRIME5;
+			hash = Rotl(hash, 11) * PRIME1;
+			++p;
+		}
+
+		//	最後にビットを散らす
+		hash ^= hash >> 33;
+		hash *= PRIME2;
+		hash ^= hash >> 29;
+		hash *= PRIME3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+}
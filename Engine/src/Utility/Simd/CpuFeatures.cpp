@@ -0,0 +1,79 @@
+﻿#include "pch.h"
+#include<Utility/Simd/CpuFeatures.hpp>
+
+#if defined(_MSC_VER)
+#include<intrin.h>
+#else
+#include<cpuid.h>
+#endif
+
+namespace Ecse::Utility
+{
+	/// <summary>
+	/// cpuid 命令の結果（eax, ebx, ecx, edx）
+	/// </summary>
+	static std::array<uint32_t, 4> CpuId(uint32_t Leaf, uint32_t SubLeaf)
+	{
+		std::array<uint32_t, 4> regs = {};
+#if defined(_MSC_VER)
+		int info[4] = {};
+		__cpuidex(info, static_cast<int>(Leaf), static_cast<int>(SubLeaf));
+		for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(info[i]);
+#else
+		__cpuid_count(Leaf, SubLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		return regs;
+	}
+
+	/// <summary>
+	/// OSが XMM/YMM レジスタを保存してくれるか
+	/// </summary>
+	static bool IsYmmStateEnabled()
+	{
+#if defined(_MSC_VER)
+		const uint64_t xcr0 = _xgetbv(0);
+#else
+		uint32_t eax = 0;
+		uint32_t edx = 0;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		const uint64_t xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+		return (xcr0 & 0x6) == 0x6;
+	}
+
+	/// <summary>
+	/// 判定の本体
+	/// </summary>
+	static CpuFeatures DetectCpuFeatures()
+	{
+		CpuFeatures features;
+
+		const uint32_t maxLeaf = CpuId(0, 0)[0];
+		if (maxLeaf < 1) return features;
+
+		const auto leaf1 = CpuId(1, 0);
+		const bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+		const bool ymm = osxsave && IsYmmStateEnabled();
+
+		features.Sse41 = (leaf1[2] & (1u << 19)) != 0;
+		features.Avx = ymm && (leaf1[2] & (1u << 28)) != 0;
+		features.Fma = features.Avx && (leaf1[2] & (1u << 12)) != 0;
+
+		if (maxLeaf >= 7)
+		{
+			const auto leaf7 = CpuId(7, 0);
+			features.Avx2 = features.Avx && (leaf7[1] & (1u << 5)) != 0;
+		}
+
+		return features;
+	}
+
+	/// <summary>
+	/// 実行中のCPUの拡張命令（初回呼び出し時に判定して以降は使い回す）
+	/// </summary>
+	const CpuFeatures& GetCpuFeatures()
+	{
+		static const CpuFeatures sFeatures = DetectCpuFeatures();
+		return sFeatures;
+	}
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+/*
+* テスト用の小さな仕組み（外からテストのライブラリは持ってこない）
+* ECSE_TEST(名前) { ... } で登録し、中で ECSE_CHECK(式) を並べる。確認に失敗してもそのテストの残りは続ける。
+* main から RunTests を呼ぶ。引数に文字列を渡すと、名前にそれを含むテストだけを動かす。
+*/
+
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<vector>
+
+namespace Ecse::Test
+{
+	/// <summary>
+	/// 登録したテスト1つ
+	/// </summary>
+	struct TestCase
+	{
+		//	名前
+		const char* Name;
+		//	処理
+		void(*Function)();
+	};
+
+	/// <summary>
+	/// 登録したテスト（翻訳単位をまたいで1つ）
+	/// </summary>
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	/// <summary>
+	/// 今動いているテストで失敗した確認の数
+	/// </summary>
+	inline uint32_t& GetFailureCount()
+	{
+		static uint32_t count = 0;
+		return count;
+	}
+
+	/// <summary>
+	/// 静的な変数の初期化でテストを登録する
+	/// </summary>
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* Name, void(*Function)())
+		{
+			GetTests().push_back({ Name, Function });
+		}
+	};
+
+	/// <summary>
+	/// 失敗した確認を出す
+	/// </summary>
+	inline void ReportFailure(const char* Expression, const char* File, int Line)
+	{
+		std::fprintf(stderr, "  %s(%d): check failed: %s\n", File, Line, Expression);
+		GetFailureCount()++;
+	}
+
+	/// <summary>
+	/// 登録したテストを順に動かす
+	/// </summary>
+	/// <returns>失敗したテストの数（main の戻り値にする）</returns>
+	inline int RunTests(int argc, char* argv[])
+	{
+		const char* filter = argc > 1 ? argv[1] : nullptr;
+		uint32_t run = 0;
+		uint32_t failed = 0;
+		for (const TestCase& test : GetTests())
+		{
+			if (filter != nullptr && std::strstr(test.Name, filter) == nullptr) continue;
+
+			GetFailureCount() = 0;
+			const auto start = std::chrono::steady_clock::now();
+			test.Function();
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			const bool isPassed = GetFailureCount() == 0;
+			std::printf("[%s] %s (%.1f ms)\n", isPassed ? "  OK  " : " FAIL ", test.Name, ms);
+			std::fflush(stdout);
+			run++;
+			if (isPassed == false) failed++;
+		}
+		std::printf("%u tests, %u failed\n", run, failed);
+		return static_cast<int>(failed);
+	}
+}
+
+/// <summary>
+/// テストの登録
+/// </summary>
+#define ECSE_TEST(Name) \
+	static void Name(); \
+	static ::Ecse::Test::TestRegistrar Name##Registrar(#Name, &Name); \
+	static void Name()
+
+/// <summary>
+/// 式が true になっているかの確認
+/// </summary>
+#define ECSE_CHECK(Expression) \
+	do { \
+		if (static_cast<bool>(Expression) == false) ::Ecse::Test::ReportFailure(#Expression, __FILE__, __LINE__); \
+	} while (0)
+
+/// <summary>
+/// 2つの値の差が Tolerance 以下かの確認
+/// </summary>
+#define ECSE_CHECK_NEAR(Actual, Expected, Tolerance) \
+	do { \
+		if ((std::fabs(static_cast<double>(Actual) - static_cast<double>(Expected)) <= (Tolerance)) == false) \
+			::Ecse::Test::ReportFailure(#Actual " == " #Expected, __FILE__, __LINE__); \
+	} while (0)
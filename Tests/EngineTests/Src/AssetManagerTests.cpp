@@ -0,0 +1,371 @@
+﻿/*
+* AssetManager のテスト（ウィンドウも DX12 も無しで動かす）
+* ファイルは SetReader で差し替えたメモリ上のもの。中身の "dep <パス>" の行を依存として読み込み、"fail" の行があれば失敗する。
+*/
+
+#include<TestRunner.hpp>
+#include<System/Asset/AssetManager.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<atomic>
+#include<map>
+#include<mutex>
+#include<sstream>
+#include<string>
+
+using namespace Ecse::System;
+
+namespace
+{
+	/// <summary>
+	/// 中身の文字列をそのまま持つ素材
+	/// </summary>
+	class TextAsset : public IAsset
+	{
+	public:
+		std::string Text;
+	};
+
+	/// <summary>
+	/// TextAsset とは別の型（型の違いの確認用）
+	/// </summary>
+	class OtherAsset : public IAsset
+	{
+	};
+
+	/// <summary>
+	/// メモリ上のファイル（ワーカーから読むので守る）
+	/// </summary>
+	class MemoryFiles
+	{
+	public:
+		void Write(const std::string& Path, const std::string& Text)
+		{
+			std::lock_guard lock(mMutex);
+			mFiles[Path] = Text;
+		}
+
+		bool Read(std::string_view Path, std::vector<uint8_t>& OutBytes)
+		{
+			std::lock_guard lock(mMutex);
+			const auto it = mFiles.find(std::string(Path));
+			if (it == mFiles.end()) return false;
+			OutBytes.assign(it->second.begin(), it->second.end());
+			return true;
+		}
+
+	private:
+		std::mutex mMutex;
+		std::map<std::string, std::string> mFiles;
+	};
+
+	/// <summary>
+	/// TextAsset の読み方
+	/// </summary>
+	class TextLoader : public IAssetLoader
+	{
+	public:
+		explicit TextLoader(std::atomic<uint32_t>* pLoadCount) :mpLoadCount(pLoadCount) {}
+
+		std::unique_ptr<IAsset> Load(AssetLoadContext& Context)override
+		{
+			mpLoadCount->fetch_add(1);
+			auto asset = std::make_unique<TextAsset>();
+			asset->Text.assign(Context.GetBytes().begin(), Context.GetBytes().end());
+
+			std::istringstream stream(asset->Text);
+			std::string line;
+			bool isFailed = false;
+			while (std::getline(stream, line))
+			{
+				if (line.starts_with("dep ")) Context.AddDependency<TextAsset>(line.substr(4));
+				else if (line == "fail") isFailed = true;
+			}
+			if (isFailed) return nullptr;
+			return asset;
+		}
+
+	private:
+		std::atomic<uint32_t>* mpLoadCount;
+	};
+
+	/// <summary>
+	/// 何もしない OtherAsset の読み方
+	/// </summary>
+	class OtherLoader : public IAssetLoader
+	{
+	public:
+		std::unique_ptr<IAsset> Load(AssetLoadContext&)override
+		{
+			return std::make_unique<OtherAsset>();
+		}
+	};
+
+	/// <summary>
+	/// テスト1つ分の JobSystem と AssetManager
+	/// </summary>
+	class AssetFixture
+	{
+	public:
+		AssetFixture()
+		{
+			JobSystem::Create();
+			ServiceLocator::Get<JobSystem>()->Initialize(2);
+			AssetManager::Create();
+			mpManager = ServiceLocator::Get<AssetManager>();
+			mpManager->Initialize();
+			mpManager->RegisterLoader<TextAsset>(std::make_unique<TextLoader>(&mLoadCount));
+			mpManager->RegisterLoader<OtherAsset>(std::make_unique<OtherLoader>());
+			mpManager->SetReader([this](std::string_view Path, std::vector<uint8_t>& OutBytes) { return mFiles.Read(Path, OutBytes); });
+		}
+
+		~AssetFixture()
+		{
+			mpManager->WaitIdle();
+			AssetManager::Release();
+			JobSystem::Release();
+		}
+
+		AssetManager& Manager() { return *mpManager; }
+		MemoryFiles& Files() { return mFiles; }
+		uint32_t GetLoadCount() const { return mLoadCount.load(); }
+
+		/// <summary>
+		/// 読み込みが終わるまで待ってコールバックを呼ぶ
+		/// </summary>
+		void Settle()
+		{
+			mpManager->WaitIdle();
+			mpManager->Update();
+		}
+
+		/// <summary>
+		/// 素材の文字列（Ready でなければ空）
+		/// </summary>
+		std::string GetText(AssetHandle<TextAsset> Handle) const
+		{
+			const TextAsset* pAsset = mpManager->Get(Handle);
+			return pAsset != nullptr ? pAsset->Text : std::string();
+		}
+
+	private:
+		AssetManager* mpManager = nullptr;
+		MemoryFiles mFiles;
+		std::atomic<uint32_t> mLoadCount = 0;
+	};
+}
+
+ECSE_TEST(AssetManager_LoadsOnceAndSharesHandle)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("Textures/Stone.txt", "stone");
+
+	const AssetHandle<TextAsset> first = fixture.Manager().Load<TextAsset>("Textures/Stone.txt");
+	//	区切りと大文字小文字が違っても同じ素材
+	const AssetHandle<TextAsset> second = fixture.Manager().Load<TextAsset>(".\\textures\\STONE.txt");
+	ECSE_CHECK(first.IsValid());
+	ECSE_CHECK(first == second);
+	ECSE_CHECK(fixture.Manager().GetRefCount(first) == 2);
+
+	ECSE_CHECK(fixture.Manager().Wait(first) == EAssetState::Ready);
+	ECSE_CHECK(fixture.GetText(first) == "stone");
+	ECSE_CHECK(fixture.GetLoadCount() == 1);
+
+	//	型が違うものとしては読めない
+	ECSE_CHECK(fixture.Manager().Load<OtherAsset>("Textures/Stone.txt").IsValid() == false);
+	ECSE_CHECK(fixture.Manager().Get(AssetHandle<OtherAsset>{ first.Value }) == nullptr);
+
+	fixture.Manager().Unload(first);
+	ECSE_CHECK(fixture.Manager().GetState(first) == EAssetState::Ready);
+	fixture.Manager().Unload(second);
+	ECSE_CHECK(fixture.Manager().GetState(first) == EAssetState::Invalid);
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 0);
+}
+
+ECSE_TEST(AssetManager_StaleHandleAfterSlotReuse)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("a.txt", "a");
+	fixture.Files().Write("b.txt", "b");
+
+	const AssetHandle<TextAsset> a = fixture.Manager().Load<TextAsset>("a.txt");
+	fixture.Settle();
+	fixture.Manager().Unload(a);
+
+	//	空いたスロットを使い回しても、古いハンドルは世代で弾く
+	const AssetHandle<TextAsset> b = fixture.Manager().Load<TextAsset>("b.txt");
+	fixture.Settle();
+	ECSE_CHECK((a.Value & 0xFFFF) == (b.Value & 0xFFFF));
+	ECSE_CHECK(a != b);
+	ECSE_CHECK(fixture.Manager().GetState(a) == EAssetState::Invalid);
+	ECSE_CHECK(fixture.Manager().Get(a) == nullptr);
+	ECSE_CHECK(fixture.GetText(b) == "b");
+	fixture.Manager().Unload(b);
+}
+
+ECSE_TEST(AssetManager_ReadyAfterAllDependencies)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("Materials/Wall.txt", "dep Textures/Albedo.txt\ndep Textures/Normal.txt\n");
+	fixture.Files().Write("Textures/Albedo.txt", "albedo");
+	fixture.Files().Write("Textures/Normal.txt", "dep Textures/Albedo.txt\n");
+
+	bool isCalled = false;
+	bool isSucceeded = false;
+	const AssetHandle<TextAsset> material = fixture.Manager().Load<TextAsset>("Materials/Wall.txt",
+		[&](AssetHandle<TextAsset>, bool Succeeded) { isCalled = true; isSucceeded = Succeeded; });
+
+	//	コールバックは Update で呼ぶ
+	fixture.Manager().WaitIdle();
+	ECSE_CHECK(isCalled == false);
+	fixture.Manager().Update();
+	ECSE_CHECK(isCalled && isSucceeded);
+
+	ECSE_CHECK(fixture.Manager().GetState(material) == EAssetState::Ready);
+	AssetManagerStats stats = fixture.Manager().GetStats();
+	ECSE_CHECK(stats.Ready == 3);
+	ECSE_CHECK(stats.Total == 3);
+	//	共有された依存は1回だけ読む
+	ECSE_CHECK(fixture.GetLoadCount() == 3);
+
+	const AssetHandle<TextAsset> albedo = fixture.Manager().Load<TextAsset>("Textures/Albedo.txt");
+	ECSE_CHECK(fixture.Manager().GetRefCount(albedo) == 3);
+	fixture.Manager().Unload(albedo);
+
+	//	依存への参照は一緒に手放す
+	fixture.Manager().Unload(material);
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 0);
+}
+
+ECSE_TEST(AssetManager_FailsWhenDependencyFails)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("Level.txt", "dep Props/Crate.txt\ndep Props/Missing.txt\n");
+	fixture.Files().Write("Props/Crate.txt", "crate");
+	fixture.Files().Write("Broken.txt", "fail\n");
+
+	bool isCalled = false;
+	bool isSucceeded = true;
+	const AssetHandle<TextAsset> level = fixture.Manager().Load<TextAsset>("Level.txt",
+		[&](AssetHandle<TextAsset>, bool Succeeded) { isCalled = true; isSucceeded = Succeeded; });
+	const AssetHandle<TextAsset> broken = fixture.Manager().Load<TextAsset>("Broken.txt");
+	fixture.Settle();
+
+	ECSE_CHECK(isCalled && isSucceeded == false);
+	ECSE_CHECK(fixture.Manager().GetState(level) == EAssetState::Failed);
+	ECSE_CHECK(fixture.Manager().Get(level) == nullptr);
+	ECSE_CHECK(fixture.Manager().GetState(broken) == EAssetState::Failed);
+
+	const AssetManagerStats stats = fixture.Manager().GetStats();
+	ECSE_CHECK(stats.Ready == 1);
+	ECSE_CHECK(stats.Failed == 3);
+
+	//	読み込み済みの Failed に後から Load しても、次の Update で失敗が届く
+	bool isLateCalled = false;
+	const AssetHandle<TextAsset> again = fixture.Manager().Load<TextAsset>("Broken.txt", [&](AssetHandle<TextAsset>, bool Succeeded) { isLateCalled = Succeeded == false; });
+	fixture.Settle();
+	ECSE_CHECK(isLateCalled);
+
+	fixture.Manager().Unload(again);
+	fixture.Manager().Unload(broken);
+	fixture.Manager().Unload(level);
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 0);
+}
+
+ECSE_TEST(AssetManager_CircularDependencyFails)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("A.txt", "dep B.txt\n");
+	fixture.Files().Write("B.txt", "dep C.txt\n");
+	fixture.Files().Write("C.txt", "dep A.txt\n");
+
+	const AssetHandle<TextAsset> a = fixture.Manager().Load<TextAsset>("A.txt");
+	fixture.Settle();
+	ECSE_CHECK(fixture.Manager().GetState(a) == EAssetState::Failed);
+
+	//	循環を切った参照も残らない
+	fixture.Manager().Unload(a);
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 0);
+}
+
+ECSE_TEST(AssetManager_UnloadWhileLoading)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("Big.txt", "dep Small.txt\n");
+	fixture.Files().Write("Small.txt", "small");
+
+	//	読み込み中に参照が無くなったものは、終わってから破棄する
+	for (uint32_t i = 0; i < 50; ++i)
+	{
+		const AssetHandle<TextAsset> handle = fixture.Manager().Load<TextAsset>("Big.txt");
+		fixture.Manager().Unload(handle);
+	}
+	fixture.Settle();
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 0);
+}
+
+ECSE_TEST(AssetManager_ReloadSwapsInPlaceAndReloadsDependents)
+{
+	AssetFixture fixture;
+	fixture.Files().Write("Material.txt", "dep Texture.txt\n");
+	fixture.Files().Write("Texture.txt", "v1");
+
+	const AssetHandle<TextAsset> material = fixture.Manager().Load<TextAsset>("Material.txt");
+	const AssetHandle<TextAsset> texture = fixture.Manager().Load<TextAsset>("Texture.txt");
+	fixture.Settle();
+	ECSE_CHECK(fixture.GetText(texture) == "v1");
+	ECSE_CHECK(fixture.GetLoadCount() == 2);
+
+	//	新しい版は揃ってから Update で差し替える。それまでは古い版が見える
+	fixture.Files().Write("Texture.txt", "v2");
+	bool isReloaded = false;
+	ECSE_CHECK(fixture.Manager().Reload("Texture.txt", [&](bool Succeeded) { isReloaded = Succeeded; }));
+	fixture.Manager().WaitIdle();
+	ECSE_CHECK(fixture.GetText(texture) == "v1");
+	fixture.Manager().Update();
+	ECSE_CHECK(isReloaded);
+	ECSE_CHECK(fixture.GetText(texture) == "v2");
+
+	//	依存していたマテリアルも読み直す（ハンドルはそのまま）
+	fixture.Settle();
+	ECSE_CHECK(fixture.GetLoadCount() == 4);
+	ECSE_CHECK(fixture.Manager().GetState(material) == EAssetState::Ready);
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 2);
+
+	//	失敗した読み直しは古い版を残す
+	fixture.Files().Write("Texture.txt", "fail\n");
+	bool isFailed = false;
+	fixture.Manager().Reload("Texture.txt", [&](bool Succeeded) { isFailed = Succeeded == false; });
+	fixture.Settle();
+	ECSE_CHECK(isFailed);
+	ECSE_CHECK(fixture.GetText(texture) == "v2");
+
+	//	読み込んでいないものは読み直せない
+	ECSE_CHECK(fixture.Manager().Reload("Unknown.txt") == false);
+
+	fixture.Manager().Unload(material);
+	fixture.Manager().Unload(texture);
+	ECSE_CHECK(fixture.Manager().GetStats().Total == 0);
+}
+
+ECSE_TEST(AssetManager_WorksWithoutJobSystem)
+{
+	//	JobSystem が無ければ呼んだスレッドでその場で読む
+	std::atomic<uint32_t> loadCount = 0;
+	MemoryFiles files;
+	files.Write("Inline.txt", "dep Child.txt\n");
+	files.Write("Child.txt", "child");
+
+	AssetManager::Create();
+	AssetManager* pManager = ServiceLocator::Get<AssetManager>();
+	pManager->Initialize();
+	pManager->RegisterLoader<TextAsset>(std::make_unique<TextLoader>(&loadCount));
+	pManager->SetReader([&files](std::string_view Path, std::vector<uint8_t>& OutBytes) { return files.Read(Path, OutBytes); });
+
+	const AssetHandle<TextAsset> handle = pManager->Load<TextAsset>("Inline.txt");
+	ECSE_CHECK(pManager->GetState(handle) == EAssetState::Ready);
+	ECSE_CHECK(loadCount.load() == 2);
+	pManager->Unload(handle);
+	ECSE_CHECK(pManager->GetStats().Total == 0);
+	AssetManager::Release();
+}
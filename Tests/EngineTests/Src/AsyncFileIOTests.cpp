@@ -0,0 +1,363 @@
+﻿/*
+* AsyncFileIO のテスト
+* 一時フォルダに決まった中身のファイルを書き、io_uring と専用スレッドの両方の仕組みで読む。
+* 順番を確かめるテストは、最初の要求のコールバックで I/O スレッドを止めている間に要求を積む。
+*/
+
+#include<TestRunner.hpp>
+#include<System/IO/AsyncFileIO.hpp>
+#include<System/Service/ServiceLocator.hpp>
+
+#include<atomic>
+#include<fstream>
+#include<future>
+#include<random>
+#include<thread>
+
+using namespace Ecse::System;
+
+namespace
+{
+	/// <summary>
+	/// 試す仕組み（io_uring が使えなければ Threads に落ちるので、その時は同じものを2回試す）
+	/// </summary>
+	constexpr EAsyncIOBackend BACKENDS[] = { EAsyncIOBackend::IoUring, EAsyncIOBackend::Threads };
+
+	/// <summary>
+	/// 表示用の仕組みの名前
+	/// </summary>
+	const char* GetBackendName(EAsyncIOBackend Backend)
+	{
+		switch (Backend)
+		{
+		case EAsyncIOBackend::IoUring: return "io_uring";
+		case EAsyncIOBackend::Iocp: return "iocp";
+		case EAsyncIOBackend::Threads: return "threads";
+		default: return "auto";
+		}
+	}
+
+	/// <summary>
+	/// ファイルの Index バイト目の中身
+	/// </summary>
+	uint8_t GetPatternByte(uint64_t Index)
+	{
+		return static_cast<uint8_t>((Index * 131) ^ (Index >> 8));
+	}
+
+	/// <summary>
+	/// 決まった中身のファイルを持つ一時フォルダ（終わったら消す）
+	/// </summary>
+	class PatternFile
+	{
+	public:
+		explicit PatternFile(uint64_t Size)
+			:mSize(Size)
+		{
+			std::random_device random;
+			mDirectory = std::filesystem::temp_directory_path() / ("EcseAsyncFileIOTests-" + std::to_string(random()));
+			std::filesystem::create_directories(mDirectory);
+
+			std::vector<char> bytes(Size);
+			for (uint64_t i = 0; i < Size; ++i) bytes[i] = static_cast<char>(GetPatternByte(i));
+			std::ofstream file(GetPath(), std::ios::binary | std::ios::trunc);
+			file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		}
+
+		~PatternFile()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(mDirectory, error);
+		}
+
+		std::filesystem::path GetPath() const { return mDirectory / "Pattern.bin"; }
+		uint64_t GetSize() const { return mSize; }
+
+	private:
+		std::filesystem::path mDirectory;
+		uint64_t mSize;
+	};
+
+	/// <summary>
+	/// テスト1つ分の AsyncFileIO
+	/// </summary>
+	class AsyncFixture
+	{
+	public:
+		AsyncFixture(EAsyncIOBackend Backend, uint32_t QueueDepth)
+		{
+			AsyncFileIO::Create();
+			mpIO = ServiceLocator::Get<AsyncFileIO>();
+			mpIO->Initialize(Backend, QueueDepth, 2);
+		}
+
+		~AsyncFixture()
+		{
+			AsyncFileIO::Release();
+		}
+
+		AsyncFileIO& IO() { return *mpIO; }
+
+	private:
+		AsyncFileIO* mpIO = nullptr;
+	};
+
+	/// <summary>
+	/// 最初の要求のコールバックで I/O スレッドを止めておく（Release を呼ぶまで他の要求は OS に渡らない）
+	/// </summary>
+	class IoThreadGate
+	{
+	public:
+		/// <summary>
+		/// File の先頭を読み、そのコールバックに入るまで待つ
+		/// </summary>
+		void Close(AsyncFileIO& IO, AsyncFileHandle File)
+		{
+			AsyncReadRequest request;
+			request.File = File;
+			request.Buffer = mBuffer;
+			request.Priority = EAsyncIOPriority::Critical;
+			request.OnComplete = [this](const AsyncReadCompletion&)
+				{
+					mEntered.set_value();
+					mRelease.get_future().wait();
+				};
+			IO.Read(std::move(request));
+			mEntered.get_future().wait();
+		}
+
+		void Release()
+		{
+			mRelease.set_value();
+		}
+
+	private:
+		uint8_t mBuffer[16] = {};
+		std::promise<void> mEntered;
+		std::promise<void> mRelease;
+	};
+
+	/// <summary>
+	/// Buffer が Offset からの中身と同じか
+	/// </summary>
+	bool MatchesPattern(std::span<const uint8_t> Buffer, uint64_t Offset)
+	{
+		for (size_t i = 0; i < Buffer.size(); ++i)
+		{
+			if (Buffer[i] != GetPatternByte(Offset + i)) return false;
+		}
+		return true;
+	}
+}
+
+ECSE_TEST(AsyncFileIO_ReadsFullOffsetAndPastEnd)
+{
+	const PatternFile pattern(256 * 1024 + 123);
+	for (const EAsyncIOBackend backend : BACKENDS)
+	{
+		AsyncFixture fixture(backend, 8);
+		AsyncFileIO& io = fixture.IO();
+		std::printf("  requested %s, using %s\n", GetBackendName(backend), GetBackendName(io.GetBackend()));
+		const AsyncFileHandle file = io.OpenFile(pattern.GetPath());
+		ECSE_CHECK(file != INVALID_ASYNC_FILE_HANDLE);
+		ECSE_CHECK(io.GetFileSize(file) == pattern.GetSize());
+
+		//	全体、途中から、終わりを跨ぐもの（残りを渡し直して 0 で止まる）、終わりより後
+		struct Case
+		{
+			uint64_t Offset;
+			uint64_t Size;
+			uint64_t Expected;
+		};
+		const Case cases[] = {
+			{ 0, pattern.GetSize(), pattern.GetSize() },
+			{ 4097, 10000, 10000 },
+			{ pattern.GetSize() - 100, 4096, 100 },
+			{ pattern.GetSize() + 10, 64, 0 },
+		};
+		for (const Case& item : cases)
+		{
+			std::vector<uint8_t> buffer(item.Size, 0);
+			AsyncReadCompletion result;
+			AsyncReadRequest request;
+			request.File = file;
+			request.Offset = item.Offset;
+			request.Buffer = buffer;
+			request.OnComplete = [&result](const AsyncReadCompletion& Completion) { result = Completion; };
+			const AsyncReadHandle handle = io.Read(std::move(request));
+			ECSE_CHECK(handle != INVALID_ASYNC_READ_HANDLE);
+			io.Wait(handle);
+
+			ECSE_CHECK(result.Handle == handle);
+			ECSE_CHECK(result.Result == EAsyncReadResult::Succeeded);
+			ECSE_CHECK(result.BytesRead == item.Expected);
+			ECSE_CHECK(MatchesPattern(std::span<const uint8_t>(buffer.data(), static_cast<size_t>(result.BytesRead)), item.Offset));
+			ECSE_CHECK(io.GetState(handle) == EAsyncReadState::Invalid);
+		}
+
+		//	閉じたファイルと無効なハンドルは受け付けない
+		uint8_t byte = 0;
+		io.CloseFile(file);
+		ECSE_CHECK(io.Read({ file, 0, std::span<uint8_t>(&byte, 1) }) == INVALID_ASYNC_READ_HANDLE);
+		ECSE_CHECK(io.Read({ INVALID_ASYNC_FILE_HANDLE, 0, std::span<uint8_t>(&byte, 1) }) == INVALID_ASYNC_READ_HANDLE);
+		ECSE_CHECK(io.OpenFile(pattern.GetPath().parent_path() / "Missing.bin") == INVALID_ASYNC_FILE_HANDLE);
+	}
+}
+
+ECSE_TEST(AsyncFileIO_CriticalOvertakesQueuedLow)
+{
+	const PatternFile pattern(600 * 512);
+	for (const EAsyncIOBackend backend : BACKENDS)
+	{
+		AsyncFixture fixture(backend, 1);
+		AsyncFileIO& io = fixture.IO();
+		const AsyncFileHandle file = io.OpenFile(pattern.GetPath());
+
+		IoThreadGate gate;
+		gate.Close(io, file);
+
+		//	低い優先度 599 個の後ろに Critical を1つ積む
+		constexpr uint32_t COUNT = 600;
+		std::vector<uint8_t> buffer(COUNT * 512);
+		std::vector<AsyncReadRequest> requests(COUNT);
+		std::vector<AsyncReadHandle> handles(COUNT);
+		std::atomic<uint32_t> order = 0;
+		std::vector<uint32_t> finishedAt(COUNT, UINT32_MAX);
+		for (uint32_t i = 0; i < COUNT; ++i)
+		{
+			requests[i].File = file;
+			requests[i].Offset = i * 512ull;
+			requests[i].Buffer = std::span<uint8_t>(buffer.data() + i * 512, 512);
+			requests[i].Priority = (i == COUNT - 1) ? EAsyncIOPriority::Critical : EAsyncIOPriority::Low;
+			requests[i].OnComplete = [&order, &finishedAt, i](const AsyncReadCompletion&) { finishedAt[i] = order.fetch_add(1); };
+		}
+		ECSE_CHECK(io.ReadBatch(requests, handles) == COUNT);
+		ECSE_CHECK(io.GetState(handles[0]) == EAsyncReadState::Pending);
+
+		gate.Release();
+		io.WaitIdle();
+
+		ECSE_CHECK(finishedAt[COUNT - 1] == 0);
+		//	同じ優先度は来た順
+		bool isFifo = true;
+		for (uint32_t i = 1; i + 1 < COUNT; ++i)
+		{
+			if (finishedAt[i] != finishedAt[i - 1] + 1) isFifo = false;
+		}
+		ECSE_CHECK(isFifo);
+		ECSE_CHECK(MatchesPattern(buffer, 0));
+	}
+}
+
+ECSE_TEST(AsyncFileIO_CancelHalfOfBatch)
+{
+	const PatternFile pattern(2000 * 256);
+	for (const EAsyncIOBackend backend : BACKENDS)
+	{
+		AsyncFixture fixture(backend, 1);
+		AsyncFileIO& io = fixture.IO();
+		const AsyncFileHandle file = io.OpenFile(pattern.GetPath());
+
+		IoThreadGate gate;
+		gate.Close(io, file);
+
+		constexpr uint32_t COUNT = 2000;
+		std::vector<uint8_t> buffer(COUNT * 256);
+		std::vector<AsyncReadRequest> requests(COUNT);
+		std::vector<AsyncReadHandle> handles(COUNT);
+		std::vector<EAsyncReadResult> results(COUNT, EAsyncReadResult::Failed);
+		std::atomic<uint32_t> callbacks = 0;
+		for (uint32_t i = 0; i < COUNT; ++i)
+		{
+			requests[i].File = file;
+			requests[i].Offset = i * 256ull;
+			requests[i].Buffer = std::span<uint8_t>(buffer.data() + i * 256, 256);
+			requests[i].OnComplete = [&results, &callbacks, i](const AsyncReadCompletion& Completion)
+				{
+					results[i] = Completion.Result;
+					callbacks.fetch_add(1);
+				};
+		}
+		ECSE_CHECK(io.ReadBatch(requests, handles) == COUNT);
+
+		//	まだ誰も OS に渡っていないので、取り消したものは全て Cancelled で終わる
+		uint32_t cancelAccepted = 0;
+		for (uint32_t i = 0; i < COUNT; i += 2)
+		{
+			cancelAccepted += io.Cancel(handles[i]) ? 1 : 0;
+		}
+		ECSE_CHECK(cancelAccepted == COUNT / 2);
+
+		gate.Release();
+		io.WaitIdle();
+
+		ECSE_CHECK(callbacks.load() == COUNT);
+		uint32_t wrong = 0;
+		for (uint32_t i = 0; i < COUNT; ++i)
+		{
+			const EAsyncReadResult expected = (i % 2 == 0) ? EAsyncReadResult::Cancelled : EAsyncReadResult::Succeeded;
+			if (results[i] != expected) wrong++;
+			if (i % 2 == 1 && MatchesPattern(std::span<const uint8_t>(buffer.data() + i * 256, 256), i * 256ull) == false) wrong++;
+		}
+		ECSE_CHECK(wrong == 0);
+		//	終わったものは取り消せない
+		ECSE_CHECK(io.Cancel(handles[1]) == false);
+
+		const AsyncFileIOStats stats = io.GetStats();
+		ECSE_CHECK(stats.Cancelled == COUNT / 2);
+		ECSE_CHECK(stats.Succeeded == COUNT / 2 + 1);
+		ECSE_CHECK(stats.Pending == 0 && stats.InFlight == 0);
+	}
+}
+
+ECSE_TEST(AsyncFileIO_ReleaseDrainsEveryCallback)
+{
+	const PatternFile pattern(500 * 1024);
+	for (const EAsyncIOBackend backend : BACKENDS)
+	{
+		constexpr uint32_t COUNT = 500;
+		std::vector<uint8_t> buffer(COUNT * 1024);
+		std::atomic<uint32_t> callbacks = 0;
+		std::atomic<uint32_t> cancelled = 0;
+		//	門は AsyncFileIO を止め終わるまで残す
+		IoThreadGate gate;
+		std::thread opener;
+		{
+			AsyncFixture fixture(backend, 4);
+			AsyncFileIO& io = fixture.IO();
+			const AsyncFileHandle file = io.OpenFile(pattern.GetPath());
+			gate.Close(io, file);
+
+			std::vector<AsyncReadRequest> requests(COUNT);
+			std::vector<AsyncReadHandle> handles(COUNT);
+			for (uint32_t i = 0; i < COUNT; ++i)
+			{
+				requests[i].File = file;
+				requests[i].Offset = i * 1024ull;
+				requests[i].Buffer = std::span<uint8_t>(buffer.data() + i * 1024, 1024);
+				requests[i].Priority = EAsyncIOPriority::Low;
+				requests[i].OnComplete = [&callbacks, &cancelled](const AsyncReadCompletion& Completion)
+					{
+						if (Completion.Result == EAsyncReadResult::Cancelled) cancelled.fetch_add(1);
+						callbacks.fetch_add(1);
+					};
+			}
+			ECSE_CHECK(io.ReadBatch(requests, handles) == COUNT);
+
+			//	止め始めた（新しい要求を受け付けなくなった）のを見てから I/O スレッドを動かす
+			opener = std::thread([&io, &gate, file]()
+				{
+					uint8_t byte = 0;
+					while (io.Read({ file, 0, std::span<uint8_t>(&byte, 1) }) != INVALID_ASYNC_READ_HANDLE)
+					{
+						std::this_thread::yield();
+					}
+					gate.Release();
+				});
+			//	待たずに止める
+		}
+		opener.join();
+		ECSE_CHECK(callbacks.load() == COUNT);
+		ECSE_CHECK(cancelled.load() == COUNT);
+	}
+}
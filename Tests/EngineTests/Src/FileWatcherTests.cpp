@@ -0,0 +1,174 @@
+﻿/*
+* FileWatcher のテスト
+* 一時フォルダの下でファイルを書き換え、落ち着いた変化がまとめて1つずつ届くかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<System/IO/FileWatcher.hpp>
+
+#include<algorithm>
+#include<fstream>
+#include<random>
+#include<thread>
+
+using namespace Ecse::System;
+
+namespace
+{
+	/// <summary>
+	/// 変化を待つ時間の上限
+	/// </summary>
+	constexpr auto WAIT_TIMEOUT = std::chrono::seconds(5);
+
+	/// <summary>
+	/// テスト1つ分の一時フォルダ（終わったら消す）
+	/// </summary>
+	class TemporaryDirectory
+	{
+	public:
+		TemporaryDirectory()
+		{
+			std::random_device random;
+			mPath = std::filesystem::temp_directory_path() / ("EcseFileWatcherTests-" + std::to_string(random()));
+			std::filesystem::create_directories(mPath);
+		}
+
+		~TemporaryDirectory()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(mPath, error);
+		}
+
+		const std::filesystem::path& GetPath() const { return mPath; }
+
+		/// <summary>
+		/// ファイルを書く（フォルダも作る）
+		/// </summary>
+		void Write(const std::string& Path, const std::string& Text) const
+		{
+			const std::filesystem::path fullPath = mPath / Path;
+			std::filesystem::create_directories(fullPath.parent_path());
+			std::ofstream file(fullPath, std::ios::binary | std::ios::trunc);
+			file << Text;
+		}
+
+	private:
+		std::filesystem::path mPath;
+	};
+
+	/// <summary>
+	/// Count 個の変化が落ち着くまで待つ（来なければ時間切れで返す）
+	/// </summary>
+	std::vector<FileChangeEvent> WaitForChanges(FileWatcher& Watcher, size_t Count)
+	{
+		std::vector<FileChangeEvent> changes;
+		const auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+		while (changes.size() < Count && std::chrono::steady_clock::now() < deadline)
+		{
+			Watcher.Poll(changes);
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		std::sort(changes.begin(), changes.end(), [](const FileChangeEvent& A, const FileChangeEvent& B) { return A.Path < B.Path; });
+		return changes;
+	}
+
+	/// <summary>
+	/// 少し待っても余計な変化が来ないか
+	/// </summary>
+	bool IsQuiet(FileWatcher& Watcher, uint32_t DebounceMs)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(DebounceMs * 3));
+		std::vector<FileChangeEvent> changes;
+		return Watcher.Poll(changes) == 0;
+	}
+}
+
+ECSE_TEST(FileWatcher_FailsForMissingDirectory)
+{
+	FileWatcher watcher;
+	ECSE_CHECK(watcher.Start(std::filesystem::temp_directory_path() / "EcseFileWatcherTests-missing" / "nowhere") == false);
+	ECSE_CHECK(watcher.IsWatching() == false);
+}
+
+ECSE_TEST(FileWatcher_DebouncesRepeatedWrites)
+{
+	TemporaryDirectory directory;
+	const uint32_t debounceMs = 100;
+	FileWatcher watcher;
+	ECSE_CHECK(watcher.Start(directory.GetPath(), debounceMs));
+	ECSE_CHECK(watcher.IsWatching());
+	ECSE_CHECK(watcher.GetRoot() == directory.GetPath());
+
+	//	保存を何度も繰り返しても、落ち着くまでは何も返さない
+	for (uint32_t i = 0; i < 5; ++i) directory.Write("Shader.hlsl", "version " + std::to_string(i));
+	std::vector<FileChangeEvent> early;
+	ECSE_CHECK(watcher.Poll(early) == 0);
+
+	const std::vector<FileChangeEvent> changes = WaitForChanges(watcher, 1);
+	ECSE_CHECK(changes.size() == 1);
+	if (changes.size() != 1) return;
+	ECSE_CHECK(changes[0].Path == "Shader.hlsl");
+	ECSE_CHECK(changes[0].Type == EFileChange::Modified);
+	ECSE_CHECK(IsQuiet(watcher, debounceMs));
+}
+
+ECSE_TEST(FileWatcher_ReportsFilesInNewSubdirectories)
+{
+	TemporaryDirectory directory;
+	directory.Write("Existing/Old.txt", "old");
+
+	FileWatcher watcher;
+	ECSE_CHECK(watcher.Start(directory.GetPath(), 50));
+
+	//	見張る前からあるフォルダの下と、後から作ったフォルダの下
+	directory.Write("Existing/Old.txt", "changed");
+	directory.Write("Textures/Rock/Albedo.png", "png");
+
+	const std::vector<FileChangeEvent> changes = WaitForChanges(watcher, 2);
+	ECSE_CHECK(changes.size() == 2);
+	if (changes.size() != 2) return;
+	ECSE_CHECK(changes[0].Path == "Existing/Old.txt");
+	ECSE_CHECK(changes[1].Path == "Textures/Rock/Albedo.png");
+	ECSE_CHECK(changes[1].Type == EFileChange::Modified);
+}
+
+ECSE_TEST(FileWatcher_ReportsRenameAndRemove)
+{
+	TemporaryDirectory directory;
+	directory.Write("Level.json", "v1");
+	directory.Write("Unused.json", "unused");
+
+	FileWatcher watcher;
+	ECSE_CHECK(watcher.Start(directory.GetPath(), 50));
+
+	//	一時ファイルに書いてから名前を変えて置き換えるエディタの保存
+	directory.Write("Level.json.tmp", "v2");
+	std::filesystem::rename(directory.GetPath() / "Level.json.tmp", directory.GetPath() / "Level.json");
+	std::filesystem::remove(directory.GetPath() / "Unused.json");
+
+	const std::vector<FileChangeEvent> changes = WaitForChanges(watcher, 3);
+	ECSE_CHECK(changes.size() == 3);
+	if (changes.size() != 3) return;
+	ECSE_CHECK(changes[0].Path == "Level.json" && changes[0].Type == EFileChange::Modified);
+	ECSE_CHECK(changes[1].Path == "Level.json.tmp" && changes[1].Type == EFileChange::Removed);
+	ECSE_CHECK(changes[2].Path == "Unused.json" && changes[2].Type == EFileChange::Removed);
+}
+
+ECSE_TEST(FileWatcher_StopDropsPendingChanges)
+{
+	TemporaryDirectory directory;
+	FileWatcher watcher;
+	ECSE_CHECK(watcher.Start(directory.GetPath(), 10000));
+	directory.Write("Pending.txt", "pending");
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	watcher.Stop();
+	ECSE_CHECK(watcher.IsWatching() == false);
+	std::vector<FileChangeEvent> changes;
+	ECSE_CHECK(watcher.Poll(changes) == 0);
+
+	//	止めた後にもう一度始められる
+	ECSE_CHECK(watcher.Start(directory.GetPath(), 20));
+	directory.Write("Pending.txt", "again");
+	ECSE_CHECK(WaitForChanges(watcher, 1).size() == 1);
+}
@@ -0,0 +1,231 @@
+﻿/*
+* GpuCullingReference のテスト
+* 視錐台は各軸 [-10, 10] の箱、Hi-Z 用の行列は単位行列（ワールド座標がそのまま NDC）にして結果を確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/GpuDriven/GpuCullingReference.hpp>
+#include<Graphics/Culling/HiZPyramid.hpp>
+
+#include<algorithm>
+#include<vector>
+
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// 各軸 [-HalfSize, HalfSize] の箱を視錐台にした定数
+	/// </summary>
+	GpuCullConstants MakeConstants(uint32_t ObjectCount, uint32_t MeshCount, uint32_t Flags, float HalfSize = 10.0f)
+	{
+		GpuCullConstants constants = {};
+		const float axes[3][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			constants.Planes[axis * 2 + 0] = DirectX::XMFLOAT4(axes[axis][0], axes[axis][1], axes[axis][2], HalfSize);
+			constants.Planes[axis * 2 + 1] = DirectX::XMFLOAT4(-axes[axis][0], -axes[axis][1], -axes[axis][2], HalfSize);
+		}
+		constants.ViewProjection = {};
+		constants.ViewProjection._11 = 1.0f;
+		constants.ViewProjection._22 = 1.0f;
+		constants.ViewProjection._33 = 1.0f;
+		constants.ViewProjection._44 = 1.0f;
+		constants.ObjectCount = ObjectCount;
+		constants.MeshCount = MeshCount;
+		constants.MaxCommands = UINT32_MAX;
+		constants.Flags = Flags;
+		return constants;
+	}
+
+	/// <summary>
+	/// AABB だけを持つ描画対象
+	/// </summary>
+	GpuObject MakeObject(float X, float Y, float Z, float Extent, uint32_t Mesh = 0)
+	{
+		GpuObject object = {};
+		object.Center = DirectX::XMFLOAT3(X, Y, Z);
+		object.Extents = DirectX::XMFLOAT3(Extent, Extent, Extent);
+		object.Radius = Extent * 1.7320508f;
+		object.Mesh = Mesh;
+		return object;
+	}
+
+	/// <summary>
+	/// 詰めたコマンドの描画対象の添字（グループ内の並びは不定なので並べ替える）
+	/// </summary>
+	std::vector<uint32_t> GetObjectIndices(const std::vector<IndirectCommand>& Commands)
+	{
+		std::vector<uint32_t> indices;
+		for (const IndirectCommand& command : Commands) indices.push_back(command.ObjectIndex);
+		std::sort(indices.begin(), indices.end());
+		return indices;
+	}
+}
+
+ECSE_TEST(GpuCullingReference_FrustumKeepsIntersectingBoxes)
+{
+	const GpuCullConstants constants = MakeConstants(0, 0, GPU_CULL_FLAG_FRUSTUM);
+
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(0.0f, 0.0f, 0.0f, 1.0f), constants));
+	//	中心が外でも箱が掛かっていれば残す
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(10.5f, 0.0f, 0.0f, 1.0f), constants));
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(0.0f, -10.9f, 0.0f, 1.0f), constants));
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(11.0f, 0.0f, 0.0f, 1.0f), constants));
+
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(11.5f, 0.0f, 0.0f, 1.0f), constants) == false);
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(0.0f, 0.0f, -12.0f, 1.0f), constants) == false);
+	ECSE_CHECK(GpuCullingReference::IsInsideFrustum(MakeObject(50.0f, 50.0f, 50.0f, 5.0f), constants) == false);
+}
+
+ECSE_TEST(GpuCullingReference_MakeCommandUsesMeshRange)
+{
+	const GpuMeshInfo mesh = { 36, 120, -8, 0 };
+	const IndirectCommand command = GpuCullingReference::MakeCommand(7, mesh);
+	ECSE_CHECK(command.ObjectIndex == 7);
+	ECSE_CHECK(command.Draw.IndexCountPerInstance == 36);
+	ECSE_CHECK(command.Draw.InstanceCount == 1);
+	ECSE_CHECK(command.Draw.StartIndexLocation == 120);
+	ECSE_CHECK(command.Draw.BaseVertexLocation == -8);
+	ECSE_CHECK(command.Draw.StartInstanceLocation == 0);
+}
+
+ECSE_TEST(GpuCullingReference_CompactsVisibleObjects)
+{
+	//	グループをまたぐ数にして、半分は視錐台の外・無効・範囲外のメッシュにする
+	const uint32_t count = GPU_CULL_GROUP_SIZE * 3 + 17;
+	const std::vector<GpuMeshInfo> meshes = { { 3, 0, 0, 0 }, { 6, 3, 4, 0 } };
+	std::vector<GpuObject> objects;
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		GpuObject object = MakeObject(0.0f, 0.0f, 0.0f, 1.0f, i % 2);
+		switch (i % 8)
+		{
+		case 1: object.Center.x = 30.0f; break;
+		case 3: object.Flags = GPU_OBJECT_FLAG_DISABLED; break;
+		case 5: object.Mesh = 2; break;
+		case 7: object.Center.z = -15.0f; break;
+		default: expected.push_back(i); break;
+		}
+		objects.push_back(object);
+	}
+
+	GpuCullConstants constants = MakeConstants(count, static_cast<uint32_t>(meshes.size()), GPU_CULL_FLAG_FRUSTUM);
+	std::vector<IndirectCommand> commands;
+	const uint32_t visible = GpuCullingReference::CullAndCompact(objects, meshes, constants, nullptr, {}, commands);
+
+	ECSE_CHECK(visible == expected.size());
+	ECSE_CHECK(GetObjectIndices(commands) == expected);
+	for (const IndirectCommand& command : commands)
+	{
+		const GpuMeshInfo& mesh = meshes[objects[command.ObjectIndex].Mesh];
+		ECSE_CHECK(command.Draw.IndexCountPerInstance == mesh.IndexCount);
+		ECSE_CHECK(command.Draw.StartIndexLocation == mesh.StartIndex);
+	}
+
+	//	書き込めるのは MaxCommands まで。カウンタは見えた数のまま
+	constants.MaxCommands = 10;
+	const uint32_t clamped = GpuCullingReference::CullAndCompact(objects, meshes, constants, nullptr, {}, commands);
+	ECSE_CHECK(clamped == expected.size());
+	ECSE_CHECK(commands.size() == 10);
+
+	//	ObjectCount より後ろは見ない
+	constants = MakeConstants(GPU_CULL_GROUP_SIZE, static_cast<uint32_t>(meshes.size()), GPU_CULL_FLAG_FRUSTUM);
+	GpuCullingReference::CullAndCompact(objects, meshes, constants, nullptr, {}, commands);
+	for (const IndirectCommand& command : commands) ECSE_CHECK(command.ObjectIndex < GPU_CULL_GROUP_SIZE);
+}
+
+ECSE_TEST(GpuCullingReference_HiZRejectsBoxesBehindDepth)
+{
+	//	左半分は手前（0.2）、右半分は奥（0.9）の深度
+	const uint32_t size = 64;
+	std::vector<float> depth(size * size);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x) depth[y * size + x] = x < size / 2 ? 0.2f : 0.9f;
+	}
+	HiZPyramid pyramid;
+	pyramid.Build(depth, size, size);
+
+	const GpuCullConstants constants = MakeConstants(0, 0, GPU_CULL_FLAG_HIZ);
+	ECSE_CHECK(GpuCullingReference::IsOccluded(MakeObject(-0.5f, 0.0f, 0.5f, 0.1f), constants, pyramid));
+	ECSE_CHECK(GpuCullingReference::IsOccluded(MakeObject(-0.5f, 0.0f, 0.15f, 0.01f), constants, pyramid) == false);
+	ECSE_CHECK(GpuCullingReference::IsOccluded(MakeObject(0.5f, 0.0f, 0.5f, 0.1f), constants, pyramid) == false);
+	//	奥の半分に掛かっていれば隠れていない
+	ECSE_CHECK(GpuCullingReference::IsOccluded(MakeObject(0.0f, 0.0f, 0.5f, 0.2f), constants, pyramid) == false);
+
+	//	近平面をまたぐものと、ピラミッドが無い時は見えている扱い
+	GpuCullConstants perspective = constants;
+	perspective.ViewProjection._44 = 0.0f;
+	perspective.ViewProjection._34 = 1.0f;
+	ECSE_CHECK(GpuCullingReference::IsOccluded(MakeObject(-0.5f, 0.0f, 0.0f, 0.5f), perspective, pyramid) == false);
+	ECSE_CHECK(GpuCullingReference::IsOccluded(MakeObject(-0.5f, 0.0f, 0.5f, 0.1f), constants, HiZPyramid()) == false);
+}
+
+ECSE_TEST(GpuCullingReference_TwoPhaseMatchesSinglePass)
+{
+	//	左半分だけ手前に遮るものがある深度
+	const uint32_t size = 32;
+	std::vector<float> depth(size * size);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x) depth[y * size + x] = x < size / 2 ? 0.3f : 1.0f;
+	}
+	HiZPyramid pyramid;
+	pyramid.Build(depth, size, size);
+
+	//	NDC の中に格子状に並べ、奥行きを変える
+	std::vector<GpuObject> objects;
+	for (uint32_t i = 0; i < 150; ++i)
+	{
+		const float x = -0.9f + 1.8f * static_cast<float>(i % 10) / 9.0f;
+		const float y = -0.9f + 1.8f * static_cast<float>((i / 10) % 5) / 4.0f;
+		const float z = (i / 50) == 0 ? 0.1f : (i / 50) == 1 ? 0.5f : 0.8f;
+		objects.push_back(MakeObject(x, y, z, 0.05f));
+	}
+	const std::vector<GpuMeshInfo> meshes = { { 3, 0, 0, 0 } };
+	const uint32_t count = static_cast<uint32_t>(objects.size());
+
+	std::vector<IndirectCommand> single;
+	GpuCullingReference::CullAndCompact(objects, meshes, MakeConstants(count, 1, GPU_CULL_FLAG_FRUSTUM | GPU_CULL_FLAG_HIZ), &pyramid, {}, single);
+	const std::vector<uint32_t> expected = GetObjectIndices(single);
+	ECSE_CHECK(expected.empty() == false);
+	ECSE_CHECK(expected.size() < count);
+
+	//	前のフレームでは 3 つおきに見えていたことにする
+	std::vector<uint32_t> visibility(count);
+	for (uint32_t i = 0; i < count; ++i) visibility[i] = i % 3 == 0 ? 1 : 0;
+	const std::vector<uint32_t> previous = visibility;
+
+	std::vector<IndirectCommand> early;
+	GpuCullingReference::CullAndCompact(objects, meshes, MakeConstants(count, 1, GPU_CULL_FLAG_FRUSTUM | GPU_CULL_FLAG_EARLY | GPU_CULL_FLAG_VISIBILITY_VALID), nullptr, visibility, early);
+
+	//	1段目は前のフレームで見えていたものだけを描き、結果は書き換えない
+	ECSE_CHECK(visibility == previous);
+	for (const IndirectCommand& command : early) ECSE_CHECK(previous[command.ObjectIndex] == 1);
+
+	std::vector<IndirectCommand> late;
+	GpuCullingReference::CullAndCompact(objects, meshes, MakeConstants(count, 1, GPU_CULL_FLAG_FRUSTUM | GPU_CULL_FLAG_HIZ | GPU_CULL_FLAG_LATE | GPU_CULL_FLAG_VISIBILITY_VALID), &pyramid, visibility, late);
+
+	//	2段目は1段目で描いたものを描かない
+	const std::vector<uint32_t> earlyIndices = GetObjectIndices(early);
+	const std::vector<uint32_t> lateIndices = GetObjectIndices(late);
+	for (const uint32_t index : lateIndices)
+	{
+		ECSE_CHECK(std::binary_search(earlyIndices.begin(), earlyIndices.end(), index) == false);
+	}
+
+	//	2段目が残した結果は1回で判定した結果と同じ
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ECSE_CHECK((visibility[i] != 0) == std::binary_search(expected.begin(), expected.end(), i));
+	}
+
+	//	新しく見えたものは全て2段目が描く
+	for (const uint32_t index : expected)
+	{
+		if (previous[index] != 0) continue;
+		ECSE_CHECK(std::binary_search(lateIndices.begin(), lateIndices.end(), index));
+	}
+}
@@ -0,0 +1,151 @@
+﻿/*
+* HiZPyramid（CPU 側の深度ピラミッド）のテスト
+* 各テクセルが、深度バッファ上で覆う範囲の一番奥の深度になっているかを総当たりで確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Culling/HiZPyramid.hpp>
+
+#include<random>
+#include<vector>
+
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// 深度バッファ上の範囲の一番奥の深度
+	/// </summary>
+	float GetMaxDepth(const std::vector<float>& Depth, uint32_t Width, uint32_t X0, uint32_t Y0, uint32_t X1, uint32_t Y1)
+	{
+		float depth = 0.0f;
+		for (uint32_t y = Y0; y < Y1; ++y)
+		{
+			for (uint32_t x = X0; x < X1; ++x) depth = std::max(depth, Depth[static_cast<size_t>(y) * Width + x]);
+		}
+		return depth;
+	}
+
+	/// <summary>
+	/// 乱数の深度で作ったピラミッドを総当たりと比べる
+	/// </summary>
+	void CheckAgainstBruteForce(uint32_t Width, uint32_t Height, uint32_t Seed)
+	{
+		std::mt19937 random(Seed);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		std::vector<float> depth(static_cast<size_t>(Width) * Height);
+		for (float& value : depth) value = distribution(random);
+
+		HiZPyramid pyramid;
+		pyramid.Build(depth, Width, Height);
+		ECSE_CHECK(pyramid.Width == HiZPyramid::GetBaseSize(Width));
+		ECSE_CHECK(pyramid.Height == HiZPyramid::GetBaseSize(Height));
+		ECSE_CHECK(pyramid.GetMipCount() == HiZPyramid::GetMipCount(pyramid.Width, pyramid.Height));
+
+		for (uint32_t mip = 0; mip < pyramid.GetMipCount(); ++mip)
+		{
+			const uint32_t mipWidth = pyramid.GetMipWidth(mip);
+			const uint32_t mipHeight = pyramid.GetMipHeight(mip);
+			ECSE_CHECK(pyramid.Mips[mip].size() == static_cast<size_t>(mipWidth) * mipHeight);
+
+			uint32_t mismatches = 0;
+			for (uint32_t y = 0; y < mipHeight; ++y)
+			{
+				uint32_t y0, y1;
+				HiZPyramid::GetFootprint(y, Height, mipHeight, y0, y1);
+				for (uint32_t x = 0; x < mipWidth; ++x)
+				{
+					uint32_t x0, x1;
+					HiZPyramid::GetFootprint(x, Width, mipWidth, x0, x1);
+					if (pyramid.Load(mip, x, y) != GetMaxDepth(depth, Width, x0, y0, x1, y1)) mismatches++;
+				}
+			}
+			ECSE_CHECK(mismatches == 0);
+		}
+
+		//	一番上は全体で一番奥
+		ECSE_CHECK(pyramid.Load(pyramid.GetMipCount() - 1, 0, 0) == GetMaxDepth(depth, Width, 0, 0, Width, Height));
+	}
+}
+
+ECSE_TEST(HiZPyramid_RoundsBaseSizeDownToPowerOfTwo)
+{
+	ECSE_CHECK(HiZPyramid::GetBaseSize(1) == 1);
+	ECSE_CHECK(HiZPyramid::GetBaseSize(2) == 2);
+	ECSE_CHECK(HiZPyramid::GetBaseSize(3) == 2);
+	ECSE_CHECK(HiZPyramid::GetBaseSize(1080) == 1024);
+	ECSE_CHECK(HiZPyramid::GetBaseSize(1920) == 1024);
+	ECSE_CHECK(HiZPyramid::GetBaseSize(2048) == 2048);
+
+	ECSE_CHECK(HiZPyramid::GetMipCount(1, 1) == 1);
+	ECSE_CHECK(HiZPyramid::GetMipCount(1024, 1024) == 11);
+	ECSE_CHECK(HiZPyramid::GetMipCount(1024, 512) == 11);
+	ECSE_CHECK(HiZPyramid::GetMipCount(4, 64) == 7);
+}
+
+ECSE_TEST(HiZPyramid_FootprintCoversWholeSource)
+{
+	//	割り切れない大きさでも、隣り合うテクセルの範囲を合わせると縮小元の全体を覆う
+	const uint32_t sizes[][2] = { { 1920, 1024 }, { 1080, 1024 }, { 7, 4 }, { 5, 1 }, { 1, 1 }, { 64, 32 } };
+	for (const auto& size : sizes)
+	{
+		uint32_t covered = 0;
+		for (uint32_t dst = 0; dst < size[1]; ++dst)
+		{
+			uint32_t begin, end;
+			HiZPyramid::GetFootprint(dst, size[0], size[1], begin, end);
+			ECSE_CHECK(begin <= covered);
+			ECSE_CHECK(end > begin);
+			ECSE_CHECK(end <= size[0]);
+			covered = std::max(covered, end);
+		}
+		ECSE_CHECK(covered == size[0]);
+	}
+}
+
+ECSE_TEST(HiZPyramid_MatchesBruteForceMax)
+{
+	CheckAgainstBruteForce(64, 64, 1);
+	CheckAgainstBruteForce(1920 / 8, 1080 / 8, 2);
+	CheckAgainstBruteForce(37, 23, 3);
+	CheckAgainstBruteForce(5, 300, 4);
+	CheckAgainstBruteForce(1, 1, 5);
+}
+
+ECSE_TEST(HiZPyramid_KeepsFarthestOfSinglePixel)
+{
+	//	1ピクセルだけ奥にあっても、上のミップ全てに残る
+	const uint32_t width = 100;
+	const uint32_t height = 60;
+	std::vector<float> depth(width * height, 0.25f);
+	depth[59 * width + 99] = 0.75f;
+
+	HiZPyramid pyramid;
+	pyramid.Build(depth, width, height);
+	for (uint32_t mip = 0; mip < pyramid.GetMipCount(); ++mip)
+	{
+		const int32_t last = static_cast<int32_t>(pyramid.GetMipWidth(mip)) - 1;
+		const int32_t bottom = static_cast<int32_t>(pyramid.GetMipHeight(mip)) - 1;
+		ECSE_CHECK(pyramid.Load(mip, last, bottom) == 0.75f);
+		ECSE_CHECK(pyramid.Load(mip, 0, 0) == 0.25f || (last == 0 && bottom == 0));
+	}
+
+	//	範囲外の読み込みは端に寄せる
+	ECSE_CHECK(pyramid.Load(0, -5, -5) == pyramid.Load(0, 0, 0));
+	ECSE_CHECK(pyramid.Load(0, 1000, 1000) == 0.75f);
+}
+
+ECSE_TEST(HiZPyramid_IgnoresInvalidInput)
+{
+	HiZPyramid pyramid;
+	std::vector<float> depth(16, 1.0f);
+	pyramid.Build(depth, 4, 4);
+	ECSE_CHECK(pyramid.GetMipCount() == 3);
+
+	//	大きさが 0 や深度が足りない時は空にする
+	pyramid.Build(depth, 0, 4);
+	ECSE_CHECK(pyramid.GetMipCount() == 0);
+	ECSE_CHECK(pyramid.Width == 0 && pyramid.Height == 0);
+	pyramid.Build(depth, 8, 8);
+	ECSE_CHECK(pyramid.GetMipCount() == 0);
+}
@@ -0,0 +1,410 @@
+﻿/*
+* JobSystem のテスト
+* 数えた仕事、仕事の中の Wait、依存の鎖と合流、ParallelFor の範囲、外のスレッドからの利用、Release での流し切りを確かめる。
+* ファイバーで動かす時は、Wait をまたいだスレッドの移動と、ファイバーが尽きた時にスレッドのスタックで動かすことも確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<atomic>
+#include<chrono>
+#include<thread>
+
+using namespace Ecse::System;
+
+namespace
+{
+	/// <summary>
+	/// 試す仕事の動かし方
+	/// </summary>
+	constexpr EJobExecution EXECUTIONS[] = { EJobExecution::Thread, EJobExecution::Fiber };
+
+	/// <summary>
+	/// テスト1つ分の JobSystem
+	/// </summary>
+	class JobFixture
+	{
+	public:
+		explicit JobFixture(EJobExecution Execution, uint32_t WorkerCount = 3, uint32_t FiberCount = JobSystem::DEFAULT_FIBER_COUNT)
+		{
+			JobSystem::Create();
+			mpJobs = ServiceLocator::Get<JobSystem>();
+			mpJobs->Initialize(WorkerCount, Execution, FiberCount);
+		}
+
+		~JobFixture()
+		{
+			JobSystem::Release();
+		}
+
+		JobSystem& Jobs() { return *mpJobs; }
+
+	private:
+		JobSystem* mpJobs = nullptr;
+	};
+}
+
+ECSE_TEST(JobSystem_RunsCountedJobs)
+{
+	for (const EJobExecution execution : EXECUTIONS)
+	{
+		JobFixture fixture(execution);
+		JobSystem& jobs = fixture.Jobs();
+
+		constexpr uint32_t COUNT = 100000;
+		std::atomic<uint32_t> sum = 0;
+		JobCounter counter;
+		for (uint32_t i = 0; i < COUNT; ++i)
+		{
+			jobs.Run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		}
+		jobs.Wait(counter);
+		ECSE_CHECK(counter.IsDone());
+		ECSE_CHECK(counter.GetValue() == 0);
+		ECSE_CHECK(sum.load() == COUNT);
+		ECSE_CHECK(jobs.GetStats().Executed >= COUNT);
+	}
+}
+
+ECSE_TEST(JobSystem_NestedWaitsInsideJobs)
+{
+	for (const EJobExecution execution : EXECUTIONS)
+	{
+		JobFixture fixture(execution);
+		JobSystem& jobs = fixture.Jobs();
+
+		//	親は子を積んで待ち、子は孫を積んで待つ（ワーカーが全員待っていても止まらない）
+		constexpr uint32_t PARENTS = 64;
+		constexpr uint32_t CHILDREN = 16;
+		std::atomic<uint32_t> leaves = 0;
+		std::atomic<uint32_t> badParents = 0;
+		JobCounter parents;
+		for (uint32_t p = 0; p < PARENTS; ++p)
+		{
+			jobs.Run([&]()
+				{
+					JobCounter children;
+					for (uint32_t c = 0; c < CHILDREN; ++c)
+					{
+						jobs.Run([&]()
+							{
+								JobCounter grandchild;
+								jobs.Run([&leaves]() { leaves.fetch_add(1); }, &grandchild);
+								jobs.Wait(grandchild);
+							}, &children);
+					}
+					jobs.Wait(children);
+					if (children.IsDone() == false) badParents.fetch_add(1);
+				}, &parents);
+		}
+		jobs.Wait(parents);
+		ECSE_CHECK(leaves.load() == PARENTS * CHILDREN);
+		ECSE_CHECK(badParents.load() == 0);
+	}
+}
+
+ECSE_TEST(JobSystem_DependencyChainAndFanIn)
+{
+	for (const EJobExecution execution : EXECUTIONS)
+	{
+		JobFixture fixture(execution);
+		JobSystem& jobs = fixture.Jobs();
+
+		//	50 段の鎖は前の段が終わってから動く
+		constexpr uint32_t CHAIN = 50;
+		std::vector<JobCounter> links(CHAIN);
+		std::vector<uint32_t> order(CHAIN, UINT32_MAX);
+		std::atomic<uint32_t> sequence = 0;
+		jobs.Run([&]() { order[0] = sequence.fetch_add(1); }, &links[0]);
+		for (uint32_t i = 1; i < CHAIN; ++i)
+		{
+			jobs.Run([&, i]() { order[i] = sequence.fetch_add(1); }, &links[i], links[i - 1]);
+		}
+		jobs.Wait(links[CHAIN - 1]);
+		bool isOrdered = true;
+		for (uint32_t i = 0; i < CHAIN; ++i)
+		{
+			if (order[i] != i) isOrdered = false;
+		}
+		ECSE_CHECK(isOrdered);
+
+		//	1000 個が終わってから1つが動く
+		constexpr uint32_t FAN_IN = 1000;
+		std::atomic<uint32_t> done = 0;
+		uint32_t seen = 0;
+		JobCounter sources;
+		JobCounter sink;
+		for (uint32_t i = 0; i < FAN_IN; ++i)
+		{
+			jobs.Run([&done]() { done.fetch_add(1); }, &sources);
+		}
+		jobs.Run([&]() { seen = done.load(); }, &sink, sources);
+		jobs.Wait(sink);
+		ECSE_CHECK(seen == FAN_IN);
+
+		//	既に 0 のカウンターの後はすぐ積まれる
+		bool isRun = false;
+		JobCounter empty;
+		JobCounter after;
+		jobs.Run([&isRun]() { isRun = true; }, &after, empty);
+		jobs.Wait(after);
+		ECSE_CHECK(isRun);
+	}
+}
+
+ECSE_TEST(JobSystem_ParallelForCoversEveryIndexOnce)
+{
+	for (const EJobExecution execution : EXECUTIONS)
+	{
+		JobFixture fixture(execution);
+		JobSystem& jobs = fixture.Jobs();
+
+		const uint32_t sizes[] = { 0, 1, 7, 64, 1000, 100003 };
+		const uint32_t grains[] = { 1, 16, 4096 };
+		for (const uint32_t size : sizes)
+		{
+			for (const uint32_t grain : grains)
+			{
+				std::vector<std::atomic<uint32_t>> hits(size);
+				std::atomic<uint32_t> badRanges = 0;
+				jobs.ParallelFor(size, [&](uint32_t Begin, uint32_t End)
+					{
+						if (Begin >= End || End > size) badRanges.fetch_add(1);
+						for (uint32_t i = Begin; i < End; ++i) hits[i].fetch_add(1);
+					}, grain);
+
+				uint32_t wrong = 0;
+				for (const std::atomic<uint32_t>& hit : hits)
+				{
+					if (hit.load() != 1) wrong++;
+				}
+				ECSE_CHECK(wrong == 0);
+				ECSE_CHECK(badRanges.load() == 0);
+			}
+		}
+
+		//	ParallelFor の中の ParallelFor
+		constexpr uint32_t OUTER = 64;
+		constexpr uint32_t INNER = 500;
+		std::vector<std::atomic<uint32_t>> cells(OUTER * INNER);
+		jobs.ParallelFor(OUTER, [&](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t row = Begin; row < End; ++row)
+				{
+					jobs.ParallelFor(INNER, [&, row](uint32_t InnerBegin, uint32_t InnerEnd)
+						{
+							for (uint32_t i = InnerBegin; i < InnerEnd; ++i) cells[row * INNER + i].fetch_add(1);
+						}, 8);
+				}
+			});
+		uint32_t wrong = 0;
+		for (const std::atomic<uint32_t>& cell : cells)
+		{
+			if (cell.load() != 1) wrong++;
+		}
+		ECSE_CHECK(wrong == 0);
+	}
+}
+
+ECSE_TEST(JobSystem_UsedFromExternalThreads)
+{
+	for (const EJobExecution execution : EXECUTIONS)
+	{
+		JobFixture fixture(execution);
+		JobSystem& jobs = fixture.Jobs();
+
+		//	ワーカーでもメインスレッドでもないスレッドから積んで待つ
+		constexpr uint32_t THREADS = 4;
+		constexpr uint32_t JOBS = 2000;
+		std::atomic<uint32_t> sum = 0;
+		std::atomic<uint32_t> covered = 0;
+		std::atomic<uint32_t> badIndex = 0;
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < THREADS; ++t)
+		{
+			threads.emplace_back([&]()
+				{
+					if (jobs.GetThreadIndex() != JobSystem::INVALID_THREAD_INDEX) badIndex.fetch_add(1);
+					JobCounter counter;
+					for (uint32_t i = 0; i < JOBS; ++i)
+					{
+						jobs.Run([&sum]() { sum.fetch_add(1); }, &counter);
+					}
+					jobs.Wait(counter);
+					jobs.ParallelFor(1000, [&covered](uint32_t Begin, uint32_t End) { covered.fetch_add(End - Begin); });
+				});
+		}
+		for (std::thread& thread : threads) thread.join();
+		ECSE_CHECK(sum.load() == THREADS * JOBS);
+		ECSE_CHECK(covered.load() == THREADS * 1000);
+		ECSE_CHECK(badIndex.load() == 0);
+		ECSE_CHECK(jobs.GetThreadIndex() == 0);
+	}
+}
+
+ECSE_TEST(JobSystem_ReleaseDrainsQueuedJobs)
+{
+	for (const EJobExecution execution : EXECUTIONS)
+	{
+		std::atomic<uint32_t> sum = 0;
+		{
+			JobFixture fixture(execution);
+			JobSystem& jobs = fixture.Jobs();
+			//	待たずに止めても、積んだ仕事とそれが積んだ仕事は全て動く
+			for (uint32_t i = 0; i < 1000; ++i)
+			{
+				jobs.Run([&jobs, &sum]()
+					{
+						sum.fetch_add(1);
+						jobs.Run([&sum]() { sum.fetch_add(1); });
+					});
+			}
+		}
+		ECSE_CHECK(sum.load() == 2000);
+	}
+}
+
+ECSE_TEST(JobSystem_FiberResumesAfterExternalComplete)
+{
+	JobFixture fixture(EJobExecution::Fiber);
+	JobSystem& jobs = fixture.Jobs();
+
+	//	外のスレッドが Complete するまで、全ての仕事がファイバーごと止まる
+	constexpr uint32_t COUNT = 64;
+	JobCounter gate;
+	jobs.AddPending(gate);
+	std::atomic<uint32_t> started = 0;
+	std::atomic<uint32_t> resumed = 0;
+	JobCounter counter;
+	for (uint32_t i = 0; i < COUNT; ++i)
+	{
+		jobs.Run([&]()
+			{
+				started.fetch_add(1);
+				jobs.Wait(gate);
+				if (gate.IsDone()) resumed.fetch_add(1);
+			}, &counter);
+	}
+
+	std::thread completer([&]()
+		{
+			while (started.load() < COUNT) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			jobs.Complete(gate);
+		});
+	jobs.Wait(counter);
+	completer.join();
+
+	ECSE_CHECK(resumed.load() == COUNT);
+	ECSE_CHECK(jobs.GetStats().Suspends >= COUNT);
+	ECSE_CHECK(jobs.GetStats().InlineRuns == 0);
+}
+
+ECSE_TEST(JobSystem_FiberMigratesAcrossWait)
+{
+	JobFixture fixture(EJobExecution::Fiber);
+	JobSystem& jobs = fixture.Jobs();
+
+	//	止まった仕事のスレッドを別の仕事で塞ぐと、続きは他のスレッドで動く
+	JobCounter gate;
+	jobs.AddPending(gate);
+	//	std::this_thread::get_id は最適化で Wait をまたいで使い回されることがあるので、スレッドの番号で比べる
+	uint32_t before = JobSystem::INVALID_THREAD_INDEX;
+	uint32_t after = JobSystem::INVALID_THREAD_INDEX;
+	uint32_t blocker = JobSystem::INVALID_THREAD_INDEX;
+	std::atomic<bool> isBlocking = false;
+	std::atomic<bool> isResumed = false;
+	JobCounter counter;
+	jobs.Run([&]()
+		{
+			before = jobs.GetThreadIndex();
+			//	自分のキューへ積むので、止まった後にこのスレッドがすぐ拾う
+			jobs.Run([&]()
+				{
+					blocker = jobs.GetThreadIndex();
+					isBlocking.store(true);
+					while (isResumed.load() == false) std::this_thread::yield();
+				}, &counter);
+			jobs.Wait(gate);
+			after = jobs.GetThreadIndex();
+			isResumed.store(true);
+		}, &counter);
+
+	std::thread completer([&]()
+		{
+			while (isBlocking.load() == false) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			jobs.Complete(gate);
+		});
+	jobs.Wait(counter);
+	completer.join();
+
+	ECSE_CHECK(isResumed.load());
+	ECSE_CHECK(jobs.GetStats().Suspends >= 1);
+	//	塞いだ仕事が盗まれて別のスレッドで動いた時は、元のスレッドで続いてもよい
+	if (blocker == before) ECSE_CHECK(after != before);
+	std::printf("  %s\n", after != before ? "resumed on another thread" : "blocker was stolen, resumed in place");
+}
+
+ECSE_TEST(JobSystem_FiberExhaustionRunsInline)
+{
+	//	ファイバーが 2 つしか無いと、残りはスレッドのスタックでそのまま動く
+	JobFixture fixture(EJobExecution::Fiber, 3, 2);
+	JobSystem& jobs = fixture.Jobs();
+
+	constexpr uint32_t COUNT = 20;
+	JobCounter gate;
+	jobs.AddPending(gate);
+	std::atomic<uint32_t> started = 0;
+	std::atomic<uint32_t> finished = 0;
+	JobCounter counter;
+	for (uint32_t i = 0; i < COUNT; ++i)
+	{
+		jobs.Run([&]()
+			{
+				started.fetch_add(1);
+				jobs.Wait(gate);
+				finished.fetch_add(1);
+			}, &counter);
+	}
+
+	std::thread completer([&]()
+		{
+			while (started.load() < COUNT) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			jobs.Complete(gate);
+		});
+	jobs.Wait(counter);
+	completer.join();
+
+	const JobSystemStats stats = jobs.GetStats();
+	ECSE_CHECK(finished.load() == COUNT);
+	ECSE_CHECK(stats.Suspends >= 2);
+	ECSE_CHECK(stats.InlineRuns >= COUNT - 2);
+	std::printf("  %llu suspends, %llu inline runs\n", static_cast<unsigned long long>(stats.Suspends), static_cast<unsigned long long>(stats.InlineRuns));
+}
+
+ECSE_TEST(JobSystem_ParallelForOrInlineWithoutJobSystem)
+{
+	//	JobSystem が無ければ呼んだスレッドで一度にまとめて処理する
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	JobSystem::ParallelForOrInline(100, [&ranges](uint32_t Begin, uint32_t End) { ranges.emplace_back(Begin, End); }, 8);
+	ECSE_CHECK(ranges.size() == 1);
+	ECSE_CHECK(ranges.empty() == false && ranges[0] == std::make_pair(0u, 100u));
+
+	//	0 個なら呼ばない
+	JobSystem::ParallelForOrInline(0, [&ranges](uint32_t Begin, uint32_t End) { ranges.emplace_back(Begin, End); });
+	ECSE_CHECK(ranges.size() == 1);
+
+	//	あれば ParallelFor で分ける
+	JobFixture fixture(EJobExecution::Thread);
+	std::vector<std::atomic<uint32_t>> hits(10000);
+	JobSystem::ParallelForOrInline(10000, [&hits](uint32_t Begin, uint32_t End)
+		{
+			for (uint32_t i = Begin; i < End; ++i) hits[i].fetch_add(1);
+		}, 16);
+	uint32_t wrong = 0;
+	for (const std::atomic<uint32_t>& hit : hits)
+	{
+		if (hit.load() != 1) wrong++;
+	}
+	ECSE_CHECK(wrong == 0);
+}
@@ -0,0 +1,236 @@
+﻿/*
+* LodSelector のテスト
+* 境目の幅（ヒステリシス）でレベルが行き来しないか、フレーム時間で閾値の倍率が上がって戻るか、
+* Select が描くものだけを選んだメッシュと一緒に返すかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Render/LodSelector.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<ECS/Component/TransformComponent.hpp>
+#include<ECS/Component/MeshRendererComponent.hpp>
+
+#include<cmath>
+#include<vector>
+
+using namespace Ecse;
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// 3段の詳細度（0.05 を下回ると描かない）
+	/// </summary>
+	ECS::LodComponent MakeLod()
+	{
+		ECS::LodComponent lod;
+		lod.Meshes = { 10, 11, 12, 0 };
+		lod.ScreenSizes = { 0.5f, 0.2f, 0.05f, 0.0f };
+		lod.LevelCount = 3;
+		return lod;
+	}
+
+	/// <summary>
+	/// 画面上の大きさを Center の周りで ±Amplitude の割合だけ揺らした時に、レベルが変わった回数
+	/// </summary>
+	uint32_t CountSwitches(float Center, float Amplitude, float Hysteresis)
+	{
+		const ECS::LodComponent lod = MakeLod();
+		uint8_t previous = LodSelector::UNKNOWN_LEVEL;
+		uint32_t switches = 0;
+		for (uint32_t frame = 0; frame < 100; ++frame)
+		{
+			const float size = Center * (1.0f + Amplitude * std::sin(static_cast<float>(frame) * 0.7f));
+			const uint8_t level = LodSelector::SelectLevel(lod, size, previous, 1.0f, Hysteresis);
+			if (previous != LodSelector::UNKNOWN_LEVEL && level != previous) switches++;
+			previous = level;
+		}
+		return switches;
+	}
+}
+
+ECSE_TEST(LodSelector_SelectLevelByScreenSize)
+{
+	const ECS::LodComponent lod = MakeLod();
+	constexpr uint8_t UNKNOWN = LodSelector::UNKNOWN_LEVEL;
+
+	//	初めて見えた時は幅を持たせない
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.6f, UNKNOWN, 1.0f, 0.1f) == 0);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.5f, UNKNOWN, 1.0f, 0.1f) == 0);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.3f, UNKNOWN, 1.0f, 0.1f) == 1);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.1f, UNKNOWN, 1.0f, 0.1f) == 2);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.01f, UNKNOWN, 1.0f, 0.1f) == LodSelector::CULLED_LEVEL);
+
+	//	倍率は全ての閾値に掛かる
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.6f, UNKNOWN, 2.0f, 0.1f) == 1);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.09f, UNKNOWN, 2.0f, 0.1f) == LodSelector::CULLED_LEVEL);
+
+	//	LOD なしは常にレベル 0
+	ECSE_CHECK(LodSelector::SelectLevel(ECS::LodComponent(), 0.0f, UNKNOWN, 4.0f, 0.1f) == 0);
+
+	//	最後を 0 にすれば描き続ける
+	ECS::LodComponent keep = lod;
+	keep.ScreenSizes[2] = 0.0f;
+	ECSE_CHECK(LodSelector::SelectLevel(keep, 0.0001f, UNKNOWN, 1.0f, 0.1f) == 2);
+
+	//	カメラが球の中にあれば一番細かい
+	ECSE_CHECK(LodSelector::ComputeScreenSize(2.0f, 1.0f, 1.0f) >= 1.0e30f);
+	ECSE_CHECK_NEAR(LodSelector::ComputeScreenSize(1.0f, 4.0f, 2.0f), 0.5f, 1.0e-6);
+}
+
+ECSE_TEST(LodSelector_HysteresisBand)
+{
+	const ECS::LodComponent lod = MakeLod();
+	constexpr float H = 0.1f;
+
+	//	細かい側からは閾値の (1 - h) 倍を下回るまで落ちない
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.46f, 0, 1.0f, H) == 0);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.44f, 0, 1.0f, H) == 1);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.19f, 1, 1.0f, H) == 1);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.17f, 1, 1.0f, H) == 2);
+
+	//	粗い側からは (1 + h) 倍を越えるまで上がらない
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.54f, 1, 1.0f, H) == 1);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.56f, 1, 1.0f, H) == 0);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.21f, 2, 1.0f, H) == 2);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.23f, 2, 1.0f, H) == 1);
+
+	//	描かなくなったものも (1 + h) 倍を越えるまで戻らない
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.052f, LodSelector::CULLED_LEVEL, 1.0f, H) == LodSelector::CULLED_LEVEL);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.056f, LodSelector::CULLED_LEVEL, 1.0f, H) == 2);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.047f, 2, 1.0f, H) == 2);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.044f, 2, 1.0f, H) == LodSelector::CULLED_LEVEL);
+
+	//	一度に何段も越えれば幅があっても飛ぶ
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.01f, 0, 1.0f, H) == LodSelector::CULLED_LEVEL);
+	ECSE_CHECK(LodSelector::SelectLevel(lod, 0.9f, LodSelector::CULLED_LEVEL, 1.0f, H) == 0);
+
+	//	境目の周りで 5% 揺れても、幅があれば切り替わらない
+	ECSE_CHECK(CountSwitches(0.2f, 0.05f, H) == 0);
+	ECSE_CHECK(CountSwitches(0.5f, 0.05f, H) == 0);
+	ECSE_CHECK(CountSwitches(0.2f, 0.05f, 0.0f) > 10);
+}
+
+ECSE_TEST(LodSelector_BudgetScalesAndDecays)
+{
+	LodSelector selector;
+	ECSE_CHECK(selector.GetScale() == 1.0f);
+
+	//	目標が無ければ変えない
+	selector.UpdateBudget(100.0);
+	ECSE_CHECK(selector.GetScale() == 1.0f);
+
+	//	目標を超えるたびに 5% ずつ上がり、上限で止まる
+	selector.SetTargetFrameTime(16.0);
+	selector.UpdateBudget(20.0);
+	ECSE_CHECK_NEAR(selector.GetScale(), 1.05f, 1.0e-5);
+	selector.UpdateBudget(20.0);
+	ECSE_CHECK_NEAR(selector.GetScale(), 1.05f * 1.05f, 1.0e-5);
+	for (uint32_t i = 0; i < 100; ++i) selector.UpdateBudget(33.0);
+	ECSE_CHECK(selector.GetScale() == 4.0f);
+
+	//	目標の 85% から目標までは動かさない
+	selector.UpdateBudget(14.0);
+	selector.UpdateBudget(16.0);
+	ECSE_CHECK(selector.GetScale() == 4.0f);
+
+	//	余裕があれば 2% ずつゆっくり戻り、1 で止まる
+	selector.UpdateBudget(10.0);
+	ECSE_CHECK_NEAR(selector.GetScale(), 4.0f * 0.98f, 1.0e-5);
+	uint32_t frames = 1;
+	while (selector.GetScale() > 1.0f && frames < 1000)
+	{
+		selector.UpdateBudget(10.0);
+		frames++;
+	}
+	ECSE_CHECK(selector.GetScale() == 1.0f);
+	//	上げるより戻す方が遅い（4 倍まで 29 フレーム、戻るのは 69 フレーム）
+	ECSE_CHECK(frames > 60);
+
+	//	上限を下げれば今の倍率も収める
+	for (uint32_t i = 0; i < 100; ++i) selector.UpdateBudget(33.0);
+	selector.SetMaxScale(2.0f);
+	ECSE_CHECK(selector.GetScale() == 2.0f);
+	selector.SetMaxScale(0.5f);
+	ECSE_CHECK(selector.GetScale() == 1.0f);
+
+	//	目標を外すか Reset で戻る
+	selector.SetMaxScale(4.0f);
+	selector.UpdateBudget(33.0);
+	ECSE_CHECK(selector.GetScale() > 1.0f);
+	selector.SetTargetFrameTime(0.0);
+	ECSE_CHECK(selector.GetScale() == 1.0f);
+	selector.SetTargetFrameTime(16.0);
+	selector.UpdateBudget(33.0);
+	selector.Reset();
+	ECSE_CHECK(selector.GetScale() == 1.0f);
+}
+
+ECSE_TEST(LodSelector_SelectKeepsLevelsPerEntity)
+{
+	entt::registry registry;
+	RenderProxyBuffer proxies;
+	const ECS::LodComponent lod = MakeLod();
+
+	//	半径 1 の物を +z に並べる（_22 が 1 なので画面上の大きさは 1 / 距離）
+	const float distances[] = { 1.5f, 4.0f, 100.0f, 100.0f };
+	std::vector<entt::entity> entities;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		const entt::entity entity = registry.create();
+		ECS::TransformComponent transform;
+		ECS::MeshRendererComponent renderer;
+		renderer.Mesh = 7;
+		const uint32_t index = proxies.Upsert(entity, transform, renderer, 0, i < 3 ? &lod : nullptr);
+		proxies.CenterZ[index] = distances[i];
+		proxies.Radius[index] = 1.0f;
+		entities.push_back(entity);
+	}
+	const std::vector<uint32_t> visible = { 0, 1, 2, 3 };
+
+	DirectX::XMFLOAT4X4 projection = {};
+	projection._22 = 1.0f;
+	const DirectX::XMFLOAT3 camera(0.0f, 0.0f, 0.0f);
+
+	LodSelector selector;
+	selector.Select(proxies, visible, camera, projection);
+	//	遠すぎるものは抜け、LOD なしは元のメッシュのまま
+	ECSE_CHECK((std::vector<uint32_t>(selector.GetVisible().begin(), selector.GetVisible().end()) == std::vector<uint32_t>{ 0, 1, 3 }));
+	ECSE_CHECK((std::vector<uint32_t>(selector.GetMeshes().begin(), selector.GetMeshes().end()) == std::vector<uint32_t>{ 10, 11, 7 }));
+	ECSE_CHECK(selector.GetStats().Tested == 4);
+	ECSE_CHECK(selector.GetStats().Culled == 1);
+	ECSE_CHECK(selector.GetStats().Changed == 0);
+	ECSE_CHECK(selector.GetStats().PerLevel[0] == 2);
+	ECSE_CHECK(selector.GetStats().PerLevel[1] == 1);
+
+	//	境目の内側へ少し離れても前のレベルのまま
+	proxies.CenterZ[0] = 2.1f;
+	selector.Select(proxies, visible, camera, projection);
+	ECSE_CHECK(selector.GetMeshes()[0] == 10);
+	ECSE_CHECK(selector.GetStats().Changed == 0);
+
+	//	幅を越えれば切り替わる
+	proxies.CenterZ[0] = 2.3f;
+	selector.Select(proxies, visible, camera, projection);
+	ECSE_CHECK(selector.GetMeshes()[0] == 11);
+	ECSE_CHECK(selector.GetStats().Changed == 1);
+
+	//	同じ番号の別の世代は前のレベルを引き継がない（引き継げば幅の内側なのでレベル 1 のまま）
+	registry.destroy(entities[0]);
+	const entt::entity reused = registry.create();
+	ECSE_CHECK(entt::to_entity(reused) == entt::to_entity(entities[0]));
+	proxies.Entities[0] = reused;
+	proxies.CenterZ[0] = 1.9f;
+	selector.Select(proxies, visible, camera, projection);
+	ECSE_CHECK(selector.GetMeshes()[0] == 10);
+	ECSE_CHECK(selector.GetStats().Changed == 0);
+
+	//	フレームが重いと倍率が上がり、早めに粗いレベルへ落ちる
+	selector.SetTargetFrameTime(16.0);
+	for (uint32_t i = 0; i < 10; ++i) selector.UpdateBudget(40.0);
+	selector.Select(proxies, visible, camera, projection);
+	ECSE_CHECK_NEAR(selector.GetStats().Scale, std::pow(1.05f, 10.0f), 1.0e-4);
+	ECSE_CHECK(selector.GetMeshes()[0] == 11);
+	ECSE_CHECK(selector.GetMeshes()[1] == 12);
+	ECSE_CHECK(selector.GetStats().Changed == 2);
+}
@@ -0,0 +1,228 @@
+﻿/*
+* Lz4Compress と Lz4Decompress のテスト
+* 色々な形のデータで圧縮と展開が元に戻るかを確かめ、途中で切れたデータ、大きさの合わない書き込み先、
+* 壊れた一致の位置を渡した時に失敗して、書き込み先の外に触れないかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Utility/Compression/Lz4.hpp>
+
+#include<algorithm>
+#include<cstring>
+#include<random>
+#include<string>
+#include<vector>
+
+using namespace Ecse::Utility;
+
+namespace
+{
+	/// <summary>
+	/// 書き込み先の後ろに置く見張りのバイト
+	/// </summary>
+	constexpr size_t GUARD_SIZE = 64;
+	constexpr uint8_t GUARD_BYTE = 0xCD;
+
+	/// <summary>
+	/// 圧縮する
+	/// </summary>
+	std::vector<uint8_t> Compress(const std::vector<uint8_t>& Source)
+	{
+		std::vector<uint8_t> compressed(Lz4CompressBound(Source.size()));
+		const size_t size = Lz4Compress(Source.data(), Source.size(), compressed.data(), compressed.size());
+		compressed.resize(size);
+		return compressed;
+	}
+
+	/// <summary>
+	/// 後ろに見張りを置いた書き込み先へ展開する
+	/// </summary>
+	/// <param name="OutIsGuardIntact">見張りが書き換えられていないか</param>
+	bool Decompress(const uint8_t* Source, size_t SourceSize, std::vector<uint8_t>& Out, size_t Size, bool& OutIsGuardIntact)
+	{
+		Out.assign(Size + GUARD_SIZE, GUARD_BYTE);
+		const bool isSucceeded = Lz4Decompress(Source, SourceSize, Out.data(), Size);
+		OutIsGuardIntact = true;
+		for (size_t i = Size; i < Out.size(); ++i)
+		{
+			if (Out[i] != GUARD_BYTE) OutIsGuardIntact = false;
+		}
+		Out.resize(Size);
+		return isSucceeded;
+	}
+
+	/// <summary>
+	/// 試すデータ（空、短いもの、乱数、繰り返し、重なる一致、文章）
+	/// </summary>
+	std::vector<std::vector<uint8_t>> MakeSamples()
+	{
+		std::vector<std::vector<uint8_t>> samples;
+		samples.emplace_back();
+		samples.push_back({ 42 });
+		samples.emplace_back(15, 7);
+
+		std::mt19937 random(1234);
+		std::vector<uint8_t> noise(100 * 1024);
+		for (uint8_t& value : noise) value = static_cast<uint8_t>(random());
+		samples.push_back(noise);
+
+		samples.emplace_back(200 * 1024, 0);
+
+		//	一致の位置が 1〜7（8 バイトずつ写せない重なり）
+		for (uint32_t period = 1; period < 8; ++period)
+		{
+			std::vector<uint8_t> repeat(5000);
+			for (size_t i = 0; i < repeat.size(); ++i) repeat[i] = static_cast<uint8_t>(i % period + 'a');
+			samples.push_back(repeat);
+		}
+
+		std::string text;
+		for (uint32_t i = 0; i < 3000; ++i) text += "entity " + std::to_string(i % 97) + " moved to chunk " + std::to_string(i % 13) + "\n";
+		samples.emplace_back(text.begin(), text.end());
+
+		//	乱数と繰り返しが混ざったもの（長いリテラルと長い一致の両方）
+		std::vector<uint8_t> mixed;
+		for (uint32_t block = 0; block < 16; ++block)
+		{
+			const size_t length = 100 + random() % 2000;
+			for (size_t i = 0; i < length; ++i) mixed.push_back(block % 2 == 0 ? static_cast<uint8_t>(random()) : static_cast<uint8_t>(block));
+		}
+		samples.push_back(mixed);
+		return samples;
+	}
+}
+
+ECSE_TEST(Lz4_RoundTrip)
+{
+	for (const std::vector<uint8_t>& source : MakeSamples())
+	{
+		const std::vector<uint8_t> compressed = Compress(source);
+		ECSE_CHECK(compressed.size() > 0);
+		ECSE_CHECK(compressed.size() <= Lz4CompressBound(source.size()));
+
+		std::vector<uint8_t> restored;
+		bool isGuardIntact = false;
+		ECSE_CHECK(Decompress(compressed.data(), compressed.size(), restored, source.size(), isGuardIntact));
+		ECSE_CHECK(isGuardIntact);
+		ECSE_CHECK(restored == source);
+	}
+
+	//	繰り返しは小さくなる
+	const std::vector<uint8_t> zeros(64 * 1024, 0);
+	ECSE_CHECK(Compress(zeros).size() < 1024);
+}
+
+ECSE_TEST(Lz4_CompressFailsWhenCapacityIsTooSmall)
+{
+	std::mt19937 random(99);
+	std::vector<uint8_t> noise(4096);
+	for (uint8_t& value : noise) value = static_cast<uint8_t>(random());
+
+	//	圧縮できないデータは元より大きくなるので、元と同じ大きさには収まらない
+	std::vector<uint8_t> destination(noise.size() + GUARD_SIZE, GUARD_BYTE);
+	ECSE_CHECK(Lz4Compress(noise.data(), noise.size(), destination.data(), noise.size()) == 0);
+	bool isGuardIntact = true;
+	for (size_t i = noise.size(); i < destination.size(); ++i)
+	{
+		if (destination[i] != GUARD_BYTE) isGuardIntact = false;
+	}
+	ECSE_CHECK(isGuardIntact);
+}
+
+ECSE_TEST(Lz4_TruncatedInputFails)
+{
+	for (const std::vector<uint8_t>& source : MakeSamples())
+	{
+		if (source.empty()) continue;
+		const std::vector<uint8_t> compressed = Compress(source);
+
+		//	途中で切れたものは、どこで切れても最後まで展開できない
+		uint32_t succeeded = 0;
+		uint32_t overrun = 0;
+		const size_t step = std::max<size_t>(1, compressed.size() / 500);
+		for (size_t length = 0; length < compressed.size(); length += step)
+		{
+			std::vector<uint8_t> restored;
+			bool isGuardIntact = false;
+			if (Decompress(compressed.data(), length, restored, source.size(), isGuardIntact)) succeeded++;
+			if (isGuardIntact == false) overrun++;
+		}
+		ECSE_CHECK(succeeded == 0);
+		ECSE_CHECK(overrun == 0);
+	}
+}
+
+ECSE_TEST(Lz4_WrongDestinationSizeFails)
+{
+	std::string text;
+	for (uint32_t i = 0; i < 500; ++i) text += "chunk " + std::to_string(i % 7) + ";";
+	const std::vector<uint8_t> source(text.begin(), text.end());
+	const std::vector<uint8_t> compressed = Compress(source);
+
+	std::vector<uint8_t> restored;
+	bool isGuardIntact = false;
+	ECSE_CHECK(Decompress(compressed.data(), compressed.size(), restored, source.size() - 1, isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+	ECSE_CHECK(Decompress(compressed.data(), compressed.size(), restored, source.size() + 1, isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+	ECSE_CHECK(Decompress(compressed.data(), compressed.size(), restored, 0, isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+}
+
+ECSE_TEST(Lz4_CorruptMatchOffsetFails)
+{
+	//	"abcd" のリテラルと、4 つ前から 4 バイトの一致、最後にリテラル "e"
+	std::vector<uint8_t> block = { 0x40, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x10, 'e' };
+	const std::string expected = "abcdabcde";
+
+	std::vector<uint8_t> restored;
+	bool isGuardIntact = false;
+	ECSE_CHECK(Decompress(block.data(), block.size(), restored, expected.size(), isGuardIntact));
+	ECSE_CHECK(std::string(restored.begin(), restored.end()) == expected);
+
+	//	位置 0 は無効
+	block[5] = 0x00;
+	ECSE_CHECK(Decompress(block.data(), block.size(), restored, expected.size(), isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+
+	//	書き込み先の先頭より前を指す
+	block[5] = 0x05;
+	ECSE_CHECK(Decompress(block.data(), block.size(), restored, expected.size(), isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+	block[5] = 0xFF;
+	block[6] = 0xFF;
+	ECSE_CHECK(Decompress(block.data(), block.size(), restored, expected.size(), isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+
+	//	リテラルの長さが入力を超える
+	block = { 0xF0, 0xFF, 0xFF, 'a' };
+	ECSE_CHECK(Decompress(block.data(), block.size(), restored, 600, isGuardIntact) == false);
+	ECSE_CHECK(isGuardIntact);
+}
+
+ECSE_TEST(Lz4_RandomCorruptionStaysInside)
+{
+	std::string text;
+	for (uint32_t i = 0; i < 2000; ++i) text += "texture " + std::to_string(i % 31) + " mip " + std::to_string(i % 11) + "\n";
+	const std::vector<uint8_t> source(text.begin(), text.end());
+	const std::vector<uint8_t> compressed = Compress(source);
+
+	//	どこを壊しても書き込み先の外には書かない（成功するかは壊し方による）
+	std::mt19937 random(7);
+	uint32_t overrun = 0;
+	for (uint32_t trial = 0; trial < 2000; ++trial)
+	{
+		std::vector<uint8_t> corrupt = compressed;
+		const uint32_t flips = 1 + random() % 4;
+		for (uint32_t f = 0; f < flips; ++f)
+		{
+			corrupt[random() % corrupt.size()] = static_cast<uint8_t>(random());
+		}
+
+		std::vector<uint8_t> restored;
+		bool isGuardIntact = false;
+		Decompress(corrupt.data(), corrupt.size(), restored, source.size(), isGuardIntact);
+		if (isGuardIntact == false) overrun++;
+	}
+	ECSE_CHECK(overrun == 0);
+}
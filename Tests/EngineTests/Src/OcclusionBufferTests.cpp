@@ -0,0 +1,269 @@
+﻿/*
+* OcclusionBuffer のテスト
+* カメラに正対した壁の裏を解析的に求め、隠れていないものを隠れたと言わないこと、
+* AVX2 と 1 ピクセルずつの描画・判定が同じ結果になること、Cull が順序と遮蔽物を保つことを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Culling/OcclusionBuffer.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<ECS/Component/TransformComponent.hpp>
+#include<ECS/Component/MeshRendererComponent.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<random>
+
+using namespace Ecse;
+using namespace Ecse::Graphics;
+
+namespace
+{
+	constexpr uint32_t WIDTH = 320;
+	constexpr uint32_t HEIGHT = 192;
+
+	/// <summary>
+	/// 原点から +z を向いたカメラ
+	/// </summary>
+	DirectX::XMFLOAT4X4 MakeViewProjection()
+	{
+		using namespace DirectX;
+		const XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 400.0f);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		return viewProjection;
+	}
+
+	/// <summary>
+	/// 画面上の矩形（ピクセル）と一番手前の深度
+	/// </summary>
+	struct ScreenRect
+	{
+		float MinX = FLT_MAX;
+		float MinY = FLT_MAX;
+		float MaxX = -FLT_MAX;
+		float MaxY = -FLT_MAX;
+		float MinZ = FLT_MAX;
+	};
+
+	/// <summary>
+	/// ワールド空間の AABB を画面へ写す
+	/// </summary>
+	ScreenRect Project(const DirectX::XMFLOAT4X4& ViewProjection, const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents)
+	{
+		using namespace DirectX;
+		const XMMATRIX matrix = XMLoadFloat4x4(&ViewProjection);
+		ScreenRect rect;
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			const XMVECTOR corner = XMVectorSet(
+				Center.x + ((i & 1) ? Extents.x : -Extents.x),
+				Center.y + ((i & 2) ? Extents.y : -Extents.y),
+				Center.z + ((i & 4) ? Extents.z : -Extents.z),
+				1.0f);
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector4Transform(corner, matrix));
+			const float sx = (clip.x / clip.w * 0.5f + 0.5f) * WIDTH;
+			const float sy = (0.5f - clip.y / clip.w * 0.5f) * HEIGHT;
+			rect.MinX = std::min(rect.MinX, sx);
+			rect.MaxX = std::max(rect.MaxX, sx);
+			rect.MinY = std::min(rect.MinY, sy);
+			rect.MaxY = std::max(rect.MaxY, sy);
+			rect.MinZ = std::min(rect.MinZ, clip.z / clip.w);
+		}
+		return rect;
+	}
+
+	/// <summary>
+	/// Inner が Outer から Margin ピクセル内側に収まるか（負なら外側へ広げる）
+	/// </summary>
+	bool IsInside(const ScreenRect& Inner, const ScreenRect& Outer, float Margin)
+	{
+		return Inner.MinX >= Outer.MinX + Margin && Inner.MaxX <= Outer.MaxX - Margin
+			&& Inner.MinY >= Outer.MinY + Margin && Inner.MaxY <= Outer.MaxY - Margin;
+	}
+
+	/// <summary>
+	/// 乱数で置いた箱
+	/// </summary>
+	struct TestBox
+	{
+		DirectX::XMFLOAT3 Center;
+		DirectX::XMFLOAT3 Extents;
+	};
+
+	std::vector<TestBox> MakeBoxes(uint32_t Count, uint32_t Seed, float MinZ, float MaxZ)
+	{
+		std::mt19937 random(Seed);
+		std::uniform_real_distribution<float> x(-15.0f, 15.0f);
+		std::uniform_real_distribution<float> y(-9.0f, 9.0f);
+		std::uniform_real_distribution<float> z(MinZ, MaxZ);
+		std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+		std::vector<TestBox> boxes(Count);
+		for (TestBox& box : boxes)
+		{
+			box.Center = { x(random), y(random), z(random) };
+			box.Extents = { extent(random), extent(random), extent(random) };
+		}
+		return boxes;
+	}
+}
+
+ECSE_TEST(OcclusionBuffer_WallHidesOnlyWhatIsBehind)
+{
+	const DirectX::XMFLOAT4X4 viewProjection = MakeViewProjection();
+	DirectX::XMFLOAT4X4 identity;
+	DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+
+	//	z = 19.5 に手前の面があるカメラに正対した壁
+	const DirectX::XMFLOAT3 wallCenter(0.0f, 0.0f, 20.0f);
+	const DirectX::XMFLOAT3 wallExtents(8.0f, 5.0f, 0.5f);
+	const float wallFront = wallCenter.z - wallExtents.z;
+	const ScreenRect wallRect = Project(viewProjection, DirectX::XMFLOAT3(wallCenter.x, wallCenter.y, wallFront), DirectX::XMFLOAT3(wallExtents.x, wallExtents.y, 0.0f));
+
+	for (const bool useSimd : { false, true })
+	{
+		OcclusionBuffer buffer(WIDTH, HEIGHT);
+		buffer.SetUseSimd(useSimd);
+		if (useSimd && buffer.IsUsingSimd() == false)
+		{
+			std::printf("  avx2 not supported, simd pass skipped\n");
+			continue;
+		}
+		buffer.BeginFrame(viewProjection);
+		buffer.AddOccluderBox(identity, wallCenter, wallExtents);
+		buffer.Rasterize();
+		ECSE_CHECK(buffer.GetLastStats().OccluderTriangles > 0);
+
+		uint32_t falseOcclusions = 0;
+		uint32_t missedOcclusions = 0;
+		uint32_t hidden = 0;
+		for (const TestBox& box : MakeBoxes(5000, 7, 3.0f, 60.0f))
+		{
+			const ScreenRect rect = Project(viewProjection, box.Center, box.Extents);
+			const float boxFront = box.Center.z - box.Extents.z;
+			const bool isVisible = buffer.IsVisible(box.Center, box.Extents);
+			if (isVisible == false) hidden++;
+
+			//	壁の面より奥にあり、壁の面の矩形に収まるものだけが隠れてよい
+			//	（遮蔽物はピクセルの中心で塗るので、1ピクセル未満のはみ出しは隠れる）
+			const bool canBeHidden = boxFront > wallFront && IsInside(rect, wallRect, -1.0f);
+			if (isVisible == false && canBeHidden == false) falseOcclusions++;
+
+			//	1ピクセル以上内側で十分奥にあるものは隠れていてほしい
+			const bool mustBeHidden = boxFront >= wallFront + 0.5f && IsInside(rect, wallRect, 1.0f);
+			if (isVisible && mustBeHidden) missedOcclusions++;
+		}
+		ECSE_CHECK(falseOcclusions == 0);
+		ECSE_CHECK(missedOcclusions == 0);
+		ECSE_CHECK(hidden > 0);
+	}
+}
+
+ECSE_TEST(OcclusionBuffer_SimdMatchesScalar)
+{
+	OcclusionBuffer scalar(WIDTH, HEIGHT);
+	OcclusionBuffer simd(WIDTH, HEIGHT);
+	scalar.SetUseSimd(false);
+	simd.SetUseSimd(true);
+	if (simd.IsUsingSimd() == false)
+	{
+		std::printf("  avx2 not supported, skipped\n");
+		return;
+	}
+
+	//	行ごとの並列描画も通す
+	System::JobSystem::Create();
+	System::ServiceLocator::Get<System::JobSystem>()->Initialize(3);
+
+	//	回した箱をいくつも重ねる
+	const DirectX::XMFLOAT4X4 viewProjection = MakeViewProjection();
+	scalar.BeginFrame(viewProjection);
+	simd.BeginFrame(viewProjection);
+	std::mt19937 random(99);
+	std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+	for (const TestBox& box : MakeBoxes(40, 3, 10.0f, 50.0f))
+	{
+		float q[4] = { axis(random), axis(random), axis(random), axis(random) };
+		const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		const DirectX::XMVECTOR rotation = DirectX::XMVectorSet(q[0] / length, q[1] / length, q[2] / length, q[3] / length);
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixRotationQuaternion(rotation) * DirectX::XMMatrixTranslation(box.Center.x, box.Center.y, box.Center.z));
+		const DirectX::XMFLOAT3 extents(box.Extents.x * 2.0f, box.Extents.y * 2.0f, box.Extents.z);
+		scalar.AddOccluderBox(world, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), extents);
+		simd.AddOccluderBox(world, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), extents);
+	}
+	scalar.Rasterize();
+	simd.Rasterize();
+
+	//	FMA の丸めの違い以上にずれない
+	const std::vector<float>& scalarDepth = scalar.GetDepth();
+	const std::vector<float>& simdDepth = simd.GetDepth();
+	ECSE_CHECK(scalarDepth.size() == simdDepth.size());
+	float maxDifference = 0.0f;
+	uint32_t coverageDifference = 0;
+	uint32_t covered = 0;
+	for (size_t i = 0; i < std::min(scalarDepth.size(), simdDepth.size()); ++i)
+	{
+		if (scalarDepth[i] < 1.0f) covered++;
+		if ((scalarDepth[i] < 1.0f) != (simdDepth[i] < 1.0f))
+		{
+			coverageDifference++;
+			continue;
+		}
+		maxDifference = std::max(maxDifference, std::fabs(scalarDepth[i] - simdDepth[i]));
+	}
+	ECSE_CHECK(covered > 0);
+	ECSE_CHECK(maxDifference <= 1e-5f);
+	//	辺の上に乗ったピクセルだけは丸めで入れ替わってよい
+	ECSE_CHECK(coverageDifference * 1000 <= covered);
+
+	uint32_t mismatches = 0;
+	uint32_t hidden = 0;
+	for (const TestBox& box : MakeBoxes(5000, 11, 3.0f, 120.0f))
+	{
+		const bool isVisible = scalar.IsVisible(box.Center, box.Extents);
+		if (isVisible == false) hidden++;
+		if (isVisible != simd.IsVisible(box.Center, box.Extents)) mismatches++;
+	}
+	ECSE_CHECK(hidden > 0);
+	ECSE_CHECK(mismatches * 1000 <= 5000);
+	std::printf("  %u covered pixels, %u coverage differences, max depth difference %g, %u of 5000 hidden, %u mismatches\n",
+		covered, coverageDifference, maxDifference, hidden, mismatches);
+
+	System::JobSystem::Release();
+}
+
+ECSE_TEST(OcclusionBuffer_CullKeepsOrderAndOccluders)
+{
+	RenderProxyBuffer proxies;
+	auto add = [&proxies](uint32_t Id, const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Extents, uint8_t Flag)
+		{
+			ECS::TransformComponent transform;
+			transform.Position = Position;
+			ECS::MeshRendererComponent renderer;
+			renderer.BoundsExtents = Extents;
+			return proxies.Upsert(static_cast<entt::entity>(Id), transform, renderer, Flag);
+		};
+
+	//	壁、壁の裏、壁の手前、壁の横
+	const uint32_t wall = add(0, { 0.0f, 0.0f, 20.0f }, { 8.0f, 5.0f, 0.5f }, RenderProxyBuffer::FLAG_OCCLUDER);
+	const uint32_t behind = add(1, { 0.0f, 0.0f, 40.0f }, { 1.0f, 1.0f, 1.0f }, 0);
+	const uint32_t front = add(2, { 0.0f, 0.0f, 10.0f }, { 1.0f, 1.0f, 1.0f }, 0);
+	const uint32_t beside = add(3, { 25.0f, 0.0f, 40.0f }, { 1.0f, 1.0f, 1.0f }, 0);
+
+	OcclusionBuffer buffer(WIDTH, HEIGHT);
+	buffer.BeginFrame(MakeViewProjection());
+	buffer.AddOccluders(proxies);
+	buffer.Rasterize();
+	ECSE_CHECK(buffer.GetLastStats().OccluderTriangles == 12);
+
+	std::vector<uint32_t> visible = { beside, behind, wall, front };
+	buffer.Cull(proxies, visible);
+	ECSE_CHECK((visible == std::vector<uint32_t>{ beside, wall, front }));
+	ECSE_CHECK(buffer.GetLastStats().Tested == 4);
+	ECSE_CHECK(buffer.GetLastStats().Occluded == 1);
+}
@@ -0,0 +1,349 @@
+﻿/*
+* PackWriter と PackArchive のテスト
+* 一時フォルダにパックを書き出して読み戻し、途中で切れたファイル、目次やチャンクの表の壊れた位置を
+* Validate と Open が弾くか、中身だけが壊れた時に Read が失敗を返すかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<System/IO/PackArchive.hpp>
+#include<System/IO/PackWriter.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<System/Service/ServiceLocator.hpp>
+
+#include<cstring>
+#include<fstream>
+#include<functional>
+#include<random>
+#include<string>
+#include<vector>
+
+using namespace Ecse::System;
+
+namespace
+{
+	/// <summary>
+	/// テスト1つ分の一時フォルダと JobSystem（終わったら消す）
+	/// </summary>
+	class PackFixture
+	{
+	public:
+		PackFixture()
+		{
+			std::random_device random;
+			mDirectory = std::filesystem::temp_directory_path() / ("EcsePackArchiveTests-" + std::to_string(random()));
+			std::filesystem::create_directories(mDirectory);
+
+			JobSystem::Create();
+			ServiceLocator::Get<JobSystem>()->Initialize(3);
+		}
+
+		~PackFixture()
+		{
+			JobSystem::Release();
+			std::error_code error;
+			std::filesystem::remove_all(mDirectory, error);
+		}
+
+		std::filesystem::path GetPath(std::string_view Name) const { return mDirectory / Name; }
+
+	private:
+		std::filesystem::path mDirectory;
+	};
+
+	/// <summary>
+	/// パックに入れる中身（空、短い文章、チャンクの境目ちょうど、乱数で複数チャンク、繰り返しで複数チャンク）
+	/// </summary>
+	std::vector<std::pair<std::string, std::vector<uint8_t>>> MakeFiles()
+	{
+		std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+		files.emplace_back("Empty.bin", std::vector<uint8_t>());
+
+		const std::string text = "{ \"name\": \"crate\", \"mesh\": \"Meshes/Crate.mesh\" }";
+		files.emplace_back("Prefabs/Crate.json", std::vector<uint8_t>(text.begin(), text.end()));
+
+		std::vector<uint8_t> exact(PACK_CHUNK_SIZE);
+		for (size_t i = 0; i < exact.size(); ++i) exact[i] = static_cast<uint8_t>(i / 256);
+		files.emplace_back("Data/Exact.bin", exact);
+
+		std::mt19937 random(4321);
+		std::vector<uint8_t> noise(PACK_CHUNK_SIZE * 3 + 1234);
+		for (uint8_t& value : noise) value = static_cast<uint8_t>(random());
+		files.emplace_back("Textures/Noise.tex", noise);
+
+		std::vector<uint8_t> pattern(PACK_CHUNK_SIZE * 4 + 77);
+		for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = static_cast<uint8_t>((i % 251) ^ (i / 4096));
+		files.emplace_back("Meshes/Level.mesh", pattern);
+		return files;
+	}
+
+	/// <summary>
+	/// MakeFiles の中身でパックを書き出す
+	/// </summary>
+	bool WritePack(const std::filesystem::path& Output, bool IsCompressed, PackWriteStats* pStats = nullptr)
+	{
+		PackWriter writer;
+		writer.SetCompression(IsCompressed);
+		for (auto& [path, bytes] : MakeFiles())
+		{
+			if (writer.Add(path, bytes) == false) return false;
+		}
+		return writer.Write(Output, pStats);
+	}
+
+	std::vector<uint8_t> ReadAll(const std::filesystem::path& Path)
+	{
+		std::ifstream file(Path, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void WriteAll(const std::filesystem::path& Path, const std::vector<uint8_t>& Bytes)
+	{
+		std::ofstream file(Path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(Bytes.data()), static_cast<std::streamsize>(Bytes.size()));
+	}
+
+	PackHeader GetHeader(const std::vector<uint8_t>& Bytes)
+	{
+		PackHeader header;
+		std::memcpy(&header, Bytes.data(), sizeof(header));
+		return header;
+	}
+
+	/// <summary>
+	/// 目次の行を書き換えた写し
+	/// </summary>
+	std::vector<uint8_t> WithEntry(std::vector<uint8_t> Bytes, uint32_t Index, const std::function<void(PackEntry&)>& Edit)
+	{
+		const PackHeader header = GetHeader(Bytes);
+		PackEntry entry;
+		const size_t offset = static_cast<size_t>(header.EntryOffset) + sizeof(PackEntry) * Index;
+		std::memcpy(&entry, Bytes.data() + offset, sizeof(entry));
+		Edit(entry);
+		std::memcpy(Bytes.data() + offset, &entry, sizeof(entry));
+		return Bytes;
+	}
+
+	/// <summary>
+	/// チャンクの表の行を書き換えた写し
+	/// </summary>
+	std::vector<uint8_t> WithChunk(std::vector<uint8_t> Bytes, uint32_t Index, const std::function<void(PackChunk&)>& Edit)
+	{
+		const PackHeader header = GetHeader(Bytes);
+		PackChunk chunk;
+		const size_t offset = static_cast<size_t>(header.ChunkOffset) + sizeof(PackChunk) * Index;
+		std::memcpy(&chunk, Bytes.data() + offset, sizeof(chunk));
+		Edit(chunk);
+		std::memcpy(Bytes.data() + offset, &chunk, sizeof(chunk));
+		return Bytes;
+	}
+
+	/// <summary>
+	/// ヘッダーを書き換えた写し
+	/// </summary>
+	std::vector<uint8_t> WithHeader(std::vector<uint8_t> Bytes, const std::function<void(PackHeader&)>& Edit)
+	{
+		PackHeader header = GetHeader(Bytes);
+		Edit(header);
+		std::memcpy(Bytes.data(), &header, sizeof(header));
+		return Bytes;
+	}
+}
+
+ECSE_TEST(PackArchive_RoundTrip)
+{
+	PackFixture fixture;
+	const auto files = MakeFiles();
+
+	for (const bool isCompressed : { true, false })
+	{
+		const std::filesystem::path path = fixture.GetPath(isCompressed ? "Compressed.pak" : "Stored.pak");
+		PackWriteStats stats;
+		ECSE_CHECK(WritePack(path, isCompressed, &stats));
+		ECSE_CHECK(stats.EntryCount == files.size());
+		ECSE_CHECK(stats.FileSize == std::filesystem::file_size(path));
+		if (isCompressed)
+		{
+			//	乱数のチャンクは小さくならないのでそのまま入る
+			ECSE_CHECK(stats.StoredChunkCount >= 4);
+			ECSE_CHECK(stats.StoredChunkCount < stats.ChunkCount);
+		}
+		else
+		{
+			ECSE_CHECK(stats.StoredChunkCount == stats.ChunkCount);
+		}
+
+		PackArchive archive;
+		ECSE_CHECK(archive.Open(path));
+		ECSE_CHECK(archive.GetEntries().size() == files.size());
+
+		//	1つずつ読む（パスの大文字小文字と区切りは問わない）
+		for (const auto& [name, bytes] : files)
+		{
+			std::string variant = "./" + name;
+			for (char& c : variant)
+			{
+				if (c == '/') c = '\\';
+				else if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+			}
+			const PackEntry* entry = archive.Find(variant);
+			ECSE_CHECK(entry != nullptr);
+			if (entry == nullptr) continue;
+			ECSE_CHECK(archive.GetPath(*entry) == PackArchive::NormalizePath(name));
+			ECSE_CHECK(entry->Size == bytes.size());
+
+			std::vector<uint8_t> read;
+			ECSE_CHECK(archive.Read(name, read));
+			ECSE_CHECK(read == bytes);
+		}
+		ECSE_CHECK(archive.Find("Missing.bin") == nullptr);
+
+		//	まとめて読む
+		std::vector<const PackEntry*> entries;
+		std::vector<std::vector<uint8_t>> buffers;
+		for (const auto& [name, bytes] : files)
+		{
+			entries.push_back(archive.Find(name));
+			buffers.emplace_back(bytes.size());
+		}
+		std::vector<std::span<uint8_t>> outs(buffers.begin(), buffers.end());
+		ECSE_CHECK(archive.ReadBatch(entries, outs));
+		bool isSame = true;
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			if (buffers[i] != files[i].second) isSame = false;
+		}
+		ECSE_CHECK(isSame);
+
+		//	書き込み先の大きさが違えば読まない
+		std::vector<uint8_t> wrong(files[1].second.size() + 1);
+		ECSE_CHECK(archive.Read(*archive.Find(files[1].first), wrong) == false);
+
+		archive.Release();
+		ECSE_CHECK(archive.IsOpen() == false);
+	}
+
+	//	同じパスは2回入れられない
+	PackWriter writer;
+	ECSE_CHECK(writer.Add("Same.bin", { 1, 2, 3 }));
+	ECSE_CHECK(writer.Add("./SAME.bin", { 4 }) == false);
+}
+
+ECSE_TEST(PackArchive_TruncatedFileIsRejected)
+{
+	PackFixture fixture;
+	const std::filesystem::path path = fixture.GetPath("Full.pak");
+	ECSE_CHECK(WritePack(path, true));
+	const std::vector<uint8_t> bytes = ReadAll(path);
+	ECSE_CHECK(PackArchive::Validate(bytes));
+
+	//	どこで切れても通らない
+	uint32_t accepted = 0;
+	for (size_t length = 0; length < bytes.size(); length += 997)
+	{
+		if (PackArchive::Validate(std::span(bytes.data(), length))) accepted++;
+	}
+	ECSE_CHECK(PackArchive::Validate(std::span(bytes.data(), bytes.size() - 1)) == false);
+	ECSE_CHECK(accepted == 0);
+
+	//	切れたファイルは開けない
+	const std::filesystem::path truncated = fixture.GetPath("Truncated.pak");
+	WriteAll(truncated, std::vector<uint8_t>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+	PackArchive archive;
+	ECSE_CHECK(archive.Open(truncated) == false);
+	ECSE_CHECK(archive.IsOpen() == false);
+	ECSE_CHECK(archive.Open(path));
+}
+
+ECSE_TEST(PackArchive_CorruptHeaderAndTableOfContentsAreRejected)
+{
+	PackFixture fixture;
+	const std::filesystem::path path = fixture.GetPath("Toc.pak");
+	ECSE_CHECK(WritePack(path, true));
+	const std::vector<uint8_t> bytes = ReadAll(path);
+	const PackHeader header = GetHeader(bytes);
+	ECSE_CHECK(header.EntryCount >= 3);
+
+	//	ヘッダー
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.Magic ^= 1; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.Version++; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.ChunkSize /= 2; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.FileSize++; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.EntryOffset = H.FileSize; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.EntryOffset += 4; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.EntryCount = UINT32_MAX; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.ChunkOffset = UINT64_MAX - 8; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.PathSize = H.FileSize; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.DataOffset += 1; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithHeader(bytes, [](PackHeader& H) { H.DataOffset = H.FileSize + PACK_ALIGNMENT; })) == false);
+
+	//	目次
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, 1, [](PackEntry& E) { E.PathHash = 0; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, 0, [](PackEntry& E) { E.PathHash = UINT64_MAX; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, 0, [&header](PackEntry& E) { E.PathOffset = static_cast<uint32_t>(header.PathSize); })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, 0, [](PackEntry& E) { E.PathLength = UINT32_MAX; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, 0, [&header](PackEntry& E) { E.FirstChunk = header.ChunkCount; })) == false);
+
+	//	大きさとチャンクの数が合わない
+	const std::span<const PackEntry> entries(reinterpret_cast<const PackEntry*>(bytes.data() + header.EntryOffset), header.EntryCount);
+	uint32_t multiChunk = 0;
+	for (uint32_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].ChunkCount > 1) multiChunk = i;
+	}
+	ECSE_CHECK(entries[multiChunk].ChunkCount > 1);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, multiChunk, [](PackEntry& E) { E.Size += PACK_CHUNK_SIZE; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, multiChunk, [](PackEntry& E) { E.Size--; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithEntry(bytes, multiChunk, [](PackEntry& E) { E.ChunkCount--; })) == false);
+
+	//	壊れた目次のファイルは開けない
+	const std::filesystem::path corrupt = fixture.GetPath("CorruptToc.pak");
+	WriteAll(corrupt, WithEntry(bytes, 1, [](PackEntry& E) { E.PathHash = 0; }));
+	PackArchive archive;
+	ECSE_CHECK(archive.Open(corrupt) == false);
+}
+
+ECSE_TEST(PackArchive_CorruptChunkOffsetsAreRejected)
+{
+	PackFixture fixture;
+	const std::filesystem::path path = fixture.GetPath("Chunks.pak");
+	ECSE_CHECK(WritePack(path, true));
+	const std::vector<uint8_t> bytes = ReadAll(path);
+	const PackHeader header = GetHeader(bytes);
+	const std::span<const PackChunk> chunks(reinterpret_cast<const PackChunk*>(bytes.data() + header.ChunkOffset), header.ChunkCount);
+
+	//	圧縮されたチャンクを1つ探す
+	uint32_t compressed = UINT32_MAX;
+	for (uint32_t i = 0; i < chunks.size(); ++i)
+	{
+		if (chunks[i].CompressedSize < chunks[i].Size) compressed = i;
+	}
+	ECSE_CHECK(compressed != UINT32_MAX);
+	if (compressed == UINT32_MAX) return;
+
+	ECSE_CHECK(PackArchive::Validate(WithChunk(bytes, compressed, [&header](PackChunk& C) { C.Offset = header.DataOffset - 1; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithChunk(bytes, compressed, [&header](PackChunk& C) { C.Offset = header.FileSize - C.CompressedSize + 1; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithChunk(bytes, compressed, [](PackChunk& C) { C.Offset = UINT64_MAX - 4; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithChunk(bytes, compressed, [](PackChunk& C) { C.CompressedSize = C.Size + 1; })) == false);
+	ECSE_CHECK(PackArchive::Validate(WithChunk(bytes, compressed, [](PackChunk& C) { C.Size = PACK_CHUNK_SIZE + 1; })) == false);
+
+	//	範囲内だが中身の壊れたチャンクは Validate を通るが、読むと失敗する
+	const std::vector<uint8_t> shortened = WithChunk(bytes, compressed, [](PackChunk& C) { C.CompressedSize /= 2; });
+	ECSE_CHECK(PackArchive::Validate(shortened));
+	const std::filesystem::path corrupt = fixture.GetPath("CorruptChunk.pak");
+	WriteAll(corrupt, shortened);
+
+	PackArchive archive;
+	ECSE_CHECK(archive.Open(corrupt));
+	uint32_t failed = 0;
+	uint32_t succeeded = 0;
+	for (const PackEntry& entry : archive.GetEntries())
+	{
+		std::vector<uint8_t> out(static_cast<size_t>(entry.Size));
+		const bool isOwner = compressed >= entry.FirstChunk && compressed < entry.FirstChunk + entry.ChunkCount;
+		const bool isRead = archive.Read(entry, out);
+		if (isOwner && isRead == false) failed++;
+		if (isOwner == false && isRead) succeeded++;
+	}
+	ECSE_CHECK(failed == 1);
+	ECSE_CHECK(succeeded + 1 == archive.GetEntries().size());
+}
@@ -0,0 +1,243 @@
+﻿/*
+* ProfileScopeRecorder と ProfileTree のテスト
+* 周波数を 1000 にして、1 Tick = 1 ミリ秒で結果を確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Debug/Profiler/ProfileTree.hpp>
+
+#include<vector>
+
+using namespace Ecse::Debug;
+
+namespace
+{
+	constexpr uint64_t MS_FREQUENCY = 1000;
+}
+
+ECSE_TEST(ProfileScopeRecorder_IssuesTimestampSlots)
+{
+	ProfileScopeRecorder recorder;
+	recorder.Reserve(8);
+
+	ECSE_CHECK(recorder.Begin("Frame") == 0);
+	ECSE_CHECK(recorder.Begin("Shadows") == 2);
+	ECSE_CHECK(recorder.End() == 3);
+	ECSE_CHECK(recorder.Begin("Opaque") == 4);
+	ECSE_CHECK(recorder.IsBalanced() == false);
+	ECSE_CHECK(recorder.End() == 5);
+	ECSE_CHECK(recorder.End() == 1);
+	ECSE_CHECK(recorder.IsBalanced());
+	ECSE_CHECK(recorder.GetTimestampCount() == 6);
+
+	const auto scopes = recorder.GetScopes();
+	ECSE_CHECK(scopes.size() == 3);
+	ECSE_CHECK(scopes[0].Parent == -1 && scopes[0].Depth == 0);
+	ECSE_CHECK(scopes[1].Parent == 0 && scopes[1].Depth == 1);
+	ECSE_CHECK(scopes[2].Parent == 0 && scopes[2].Depth == 1);
+
+	//	開始のない End は何もしない
+	ECSE_CHECK(recorder.End() == ProfileScopeRecorder::INVALID_INDEX);
+	ECSE_CHECK(recorder.IsBalanced());
+}
+
+ECSE_TEST(ProfileScopeRecorder_DropsScopesOverLimit)
+{
+	ProfileScopeRecorder recorder;
+	recorder.Reserve(2);
+
+	ECSE_CHECK(recorder.Begin("Frame") == 0);
+	ECSE_CHECK(recorder.Begin("A") == 2);
+	//	上限を超えた区間は捨てるが、End との対応は崩さない
+	ECSE_CHECK(recorder.Begin("B") == ProfileScopeRecorder::INVALID_INDEX);
+	ECSE_CHECK(recorder.Begin("C") == ProfileScopeRecorder::INVALID_INDEX);
+	ECSE_CHECK(recorder.End() == ProfileScopeRecorder::INVALID_INDEX);
+	ECSE_CHECK(recorder.End() == ProfileScopeRecorder::INVALID_INDEX);
+	ECSE_CHECK(recorder.End() == 3);
+	ECSE_CHECK(recorder.End() == 1);
+	ECSE_CHECK(recorder.IsBalanced());
+	ECSE_CHECK(recorder.GetDroppedCount() == 2);
+	ECSE_CHECK(recorder.GetTimestampCount() == 4);
+
+	recorder.Reset();
+	ECSE_CHECK(recorder.GetDroppedCount() == 0);
+	ECSE_CHECK(recorder.GetScopes().empty());
+}
+
+ECSE_TEST(ProfileTree_ResolvesCpuTimesRelativeToFrameStart)
+{
+	ProfileScopeRecorder recorder;
+	recorder.Reserve(8);
+	std::vector<uint64_t> ticks(16);
+
+	ticks[recorder.Begin("Frame")] = 100;
+	ticks[recorder.Begin("Update")] = 102;
+	ticks[recorder.Begin("Physics")] = 103;
+	ticks[recorder.End()] = 107;
+	ticks[recorder.End()] = 110;
+	ticks[recorder.Begin("Render")] = 111;
+	ticks[recorder.End()] = 120;
+	ticks[recorder.End()] = 125;
+
+	ProfileTree tree;
+	tree.AddCpu(recorder.GetScopes(), std::span<const uint64_t>(ticks.data(), recorder.GetTimestampCount()), MS_FREQUENCY);
+
+	const ProfileNode* frame = tree.Find({ "Frame" });
+	ECSE_CHECK(frame != nullptr);
+	if (frame == nullptr) return;
+	ECSE_CHECK_NEAR(frame->CpuStartMs, 0.0, 1e-9);
+	ECSE_CHECK_NEAR(frame->CpuMs, 25.0, 1e-9);
+	ECSE_CHECK(frame->CpuCalls == 1);
+	ECSE_CHECK(frame->GpuCalls == 0);
+	ECSE_CHECK_NEAR(frame->GpuMs, -1.0, 1e-9);
+
+	const ProfileNode* physics = tree.Find({ "Frame", "Update", "Physics" });
+	ECSE_CHECK(physics != nullptr);
+	if (physics == nullptr) return;
+	ECSE_CHECK_NEAR(physics->CpuStartMs, 3.0, 1e-9);
+	ECSE_CHECK_NEAR(physics->CpuMs, 4.0, 1e-9);
+	ECSE_CHECK(physics->Depth == 2);
+
+	const ProfileNode* render = tree.Find({ "Frame", "Render" });
+	ECSE_CHECK(render != nullptr);
+	if (render == nullptr) return;
+	ECSE_CHECK_NEAR(render->CpuStartMs, 11.0, 1e-9);
+	ECSE_CHECK_NEAR(render->CpuMs, 9.0, 1e-9);
+
+	ECSE_CHECK(tree.Find({ "Frame", "Physics" }) == nullptr);
+	ECSE_CHECK(tree.Find({ "Missing" }) == nullptr);
+}
+
+ECSE_TEST(ProfileTree_BuildsSiblingLinks)
+{
+	ProfileScopeRecorder recorder;
+	recorder.Reserve(8);
+	std::vector<uint64_t> ticks(16);
+
+	ticks[recorder.Begin("Frame")] = 0;
+	ticks[recorder.Begin("A")] = 1;
+	ticks[recorder.End()] = 2;
+	ticks[recorder.Begin("B")] = 3;
+	ticks[recorder.End()] = 4;
+	ticks[recorder.Begin("C")] = 5;
+	ticks[recorder.End()] = 6;
+	ticks[recorder.End()] = 7;
+
+	ProfileTree tree;
+	tree.AddCpu(recorder.GetScopes(), ticks, MS_FREQUENCY);
+
+	const auto nodes = tree.GetNodes();
+	ECSE_CHECK(nodes.size() == 4);
+	ECSE_CHECK(tree.GetFirstRoot() == 0);
+	if (nodes.size() != 4) return;
+
+	//	子は記録した順に兄弟で繋がる
+	const char* expected[] = { "A", "B", "C" };
+	int32_t child = nodes[0].FirstChild;
+	for (const char* name : expected)
+	{
+		ECSE_CHECK(child >= 0);
+		if (child < 0) return;
+		ECSE_CHECK(nodes[child].Name == name);
+		ECSE_CHECK(nodes[child].Parent == 0);
+		child = nodes[child].NextSibling;
+	}
+	ECSE_CHECK(child == -1);
+
+	tree.Clear();
+	ECSE_CHECK(tree.GetNodes().empty());
+	ECSE_CHECK(tree.GetFirstRoot() == -1);
+}
+
+ECSE_TEST(ProfileTree_MergesRepeatedScopes)
+{
+	ProfileScopeRecorder recorder;
+	recorder.Reserve(8);
+	std::vector<uint64_t> ticks(16);
+
+	ticks[recorder.Begin("Frame")] = 100;
+	ticks[recorder.Begin("Shadows")] = 110;
+	ticks[recorder.End()] = 150;
+	ticks[recorder.Begin("Shadows")] = 160;
+	ticks[recorder.End()] = 170;
+	ticks[recorder.End()] = 300;
+
+	ProfileTree tree;
+	tree.AddCpu(recorder.GetScopes(), ticks, MS_FREQUENCY);
+
+	//	同じ親の下の同じ名前は1つのノードにまとめ、時間は合計する
+	ECSE_CHECK(tree.GetNodes().size() == 2);
+	const ProfileNode* shadows = tree.Find({ "Frame", "Shadows" });
+	ECSE_CHECK(shadows != nullptr);
+	if (shadows == nullptr) return;
+	ECSE_CHECK(shadows->CpuCalls == 2);
+	ECSE_CHECK_NEAR(shadows->CpuMs, 50.0, 1e-9);
+	ECSE_CHECK_NEAR(shadows->CpuStartMs, 10.0, 1e-9);
+}
+
+ECSE_TEST(ProfileTree_MergesCpuAndGpuIntoSameNodes)
+{
+	ProfileScopeRecorder cpu;
+	cpu.Reserve(4);
+	std::vector<uint64_t> cpuTicks(8);
+	cpuTicks[cpu.Begin("Frame")] = 1000;
+	cpuTicks[cpu.Begin("Opaque")] = 1001;
+	cpuTicks[cpu.End()] = 1003;
+	cpuTicks[cpu.End()] = 1010;
+
+	//	GPU は周波数も始まりも違う。キューをまたいで逆転した区間は 0 に丸める
+	ProfileScopeRecorder gpu;
+	gpu.Reserve(4);
+	std::vector<uint64_t> gpuTicks(8);
+	gpuTicks[gpu.Begin("Frame")] = 50000;
+	gpuTicks[gpu.Begin("Opaque")] = 52000;
+	gpuTicks[gpu.End()] = 51000;
+	gpuTicks[gpu.Begin("Post")] = 54000;
+	gpuTicks[gpu.End()] = 58000;
+	gpuTicks[gpu.End()] = 60000;
+
+	ProfileTree tree;
+	tree.AddCpu(cpu.GetScopes(), cpuTicks, MS_FREQUENCY);
+	tree.AddGpu(gpu.GetScopes(), gpuTicks, MS_FREQUENCY * 1000);
+
+	ECSE_CHECK(tree.GetNodes().size() == 3);
+	const ProfileNode* opaque = tree.Find({ "Frame", "Opaque" });
+	ECSE_CHECK(opaque != nullptr);
+	if (opaque == nullptr) return;
+	ECSE_CHECK_NEAR(opaque->CpuMs, 2.0, 1e-9);
+	ECSE_CHECK_NEAR(opaque->GpuStartMs, 2.0, 1e-9);
+	ECSE_CHECK_NEAR(opaque->GpuMs, 0.0, 1e-9);
+	ECSE_CHECK(opaque->GpuCalls == 1);
+
+	//	GPU にしか無い区間は CPU 側が未計測のまま
+	const ProfileNode* post = tree.Find({ "Frame", "Post" });
+	ECSE_CHECK(post != nullptr);
+	if (post == nullptr) return;
+	ECSE_CHECK_NEAR(post->CpuMs, -1.0, 1e-9);
+	ECSE_CHECK(post->CpuCalls == 0);
+	ECSE_CHECK_NEAR(post->GpuStartMs, 4.0, 1e-9);
+	ECSE_CHECK_NEAR(post->GpuMs, 4.0, 1e-9);
+}
+
+ECSE_TEST(ProfileTree_IgnoresScopesWithoutTimestamps)
+{
+	ProfileScopeRecorder recorder;
+	recorder.Reserve(4);
+	std::vector<uint64_t> ticks(8);
+	ticks[recorder.Begin("Frame")] = 10;
+	ticks[recorder.Begin("A")] = 11;
+	ticks[recorder.End()] = 12;
+	ticks[recorder.End()] = 20;
+
+	//	読み戻しが途中までしか無い時は、そこまでの区間だけを使う
+	ProfileTree tree;
+	tree.AddCpu(recorder.GetScopes(), std::span<const uint64_t>(ticks.data(), 3), MS_FREQUENCY);
+	ECSE_CHECK(tree.GetNodes().size() == 1);
+	ECSE_CHECK(tree.Find({ "Frame", "A" }) == nullptr);
+
+	//	周波数が 0 や区間が空なら何もしない
+	tree.Clear();
+	tree.AddCpu(recorder.GetScopes(), ticks, 0);
+	tree.AddGpu({}, ticks, MS_FREQUENCY);
+	ECSE_CHECK(tree.GetNodes().empty());
+}
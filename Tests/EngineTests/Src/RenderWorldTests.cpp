@@ -0,0 +1,131 @@
+﻿/*
+* RenderWorld のテスト
+* レジストリを書き換えて両方のスナップショットを抜き出し、プロキシバッファに正しく載っているかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Render/RenderWorld.hpp>
+#include<ECS/Tag/SceneTags.hpp>
+#include<ECS/Component/TransformComponent.hpp>
+#include<ECS/Component/MeshRendererComponent.hpp>
+#include<System/Service/ServiceLocator.hpp>
+
+using namespace Ecse;
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// テスト1つ分のレジストリと RenderWorld
+	/// </summary>
+	class RenderWorldFixture
+	{
+	public:
+		RenderWorldFixture()
+		{
+			RenderWorld::Create();
+			mpWorld = System::ServiceLocator::Get<RenderWorld>();
+			mpWorld->Initialize(mRegistry);
+		}
+
+		~RenderWorldFixture()
+		{
+			RenderWorld::Release();
+		}
+
+		entt::registry& Registry() { return mRegistry; }
+		RenderWorld& World() { return *mpWorld; }
+
+		/// <summary>
+		/// 描画対象になるエンティティを作る
+		/// </summary>
+		entt::entity CreateRenderable(uint32_t Mesh)
+		{
+			const entt::entity entity = mRegistry.create();
+			mRegistry.emplace<ECS::RenderableTag>(entity);
+			mRegistry.emplace<ECS::TransformComponent>(entity);
+			mRegistry.emplace<ECS::MeshRendererComponent>(entity).Mesh = Mesh;
+			return entity;
+		}
+
+		/// <summary>
+		/// 全てのスナップショットを抜き出す
+		/// </summary>
+		void ExtractAll()
+		{
+			for (uint32_t slot = 0; slot < System::FRAME_SNAPSHOT_COUNT; ++slot)
+			{
+				mpWorld->Extract(slot);
+			}
+		}
+
+	private:
+		entt::registry mRegistry;
+		RenderWorld* mpWorld = nullptr;
+	};
+}
+
+ECSE_TEST(RenderWorld_ExtractsIntoEverySnapshot)
+{
+	RenderWorldFixture fixture;
+	const entt::entity entity = fixture.CreateRenderable(3);
+	fixture.ExtractAll();
+
+	for (uint32_t slot = 0; slot < System::FRAME_SNAPSHOT_COUNT; ++slot)
+	{
+		const RenderProxyBuffer& proxies = fixture.World().GetProxies(slot);
+		ECSE_CHECK(proxies.GetCount() == 1);
+		const uint32_t index = proxies.Find(entity);
+		ECSE_CHECK(index != RenderProxyBuffer::INVALID_INDEX);
+		if (index == RenderProxyBuffer::INVALID_INDEX) continue;
+		ECSE_CHECK(proxies.Mesh[index] == 3);
+	}
+
+	//	条件が崩れたら外れる
+	fixture.Registry().remove<ECS::RenderableTag>(entity);
+	fixture.ExtractAll();
+	ECSE_CHECK(fixture.World().GetProxies(0).GetCount() == 0);
+	ECSE_CHECK(fixture.World().GetProxies(1).GetCount() == 0);
+}
+
+ECSE_TEST(RenderWorld_RecreateWithSameIndexInOneFrame)
+{
+	RenderWorldFixture fixture;
+	const entt::entity first = fixture.CreateRenderable(1);
+	fixture.ExtractAll();
+
+	//	同じフレームで消して作り直すと、同じ番号の新しい世代になる
+	fixture.Registry().destroy(first);
+	const entt::entity second = fixture.CreateRenderable(2);
+	ECSE_CHECK(entt::to_entity(first) == entt::to_entity(second));
+	ECSE_CHECK(first != second);
+	fixture.ExtractAll();
+
+	for (uint32_t slot = 0; slot < System::FRAME_SNAPSHOT_COUNT; ++slot)
+	{
+		const RenderProxyBuffer& proxies = fixture.World().GetProxies(slot);
+		ECSE_CHECK(proxies.GetCount() == 1);
+		ECSE_CHECK(proxies.Find(first) == RenderProxyBuffer::INVALID_INDEX);
+		const uint32_t index = proxies.Find(second);
+		ECSE_CHECK(index != RenderProxyBuffer::INVALID_INDEX);
+		if (index == RenderProxyBuffer::INVALID_INDEX) continue;
+		ECSE_CHECK(proxies.Mesh[index] == 2);
+	}
+}
+
+ECSE_TEST(RenderWorld_RecreateAsNonRenderableInOneFrame)
+{
+	RenderWorldFixture fixture;
+	const entt::entity first = fixture.CreateRenderable(1);
+	fixture.ExtractAll();
+
+	//	作り直したものが描画対象でなければ何も載らない
+	fixture.Registry().destroy(first);
+	const entt::entity second = fixture.Registry().create();
+	fixture.Registry().emplace<ECS::TransformComponent>(second);
+	ECSE_CHECK(entt::to_entity(first) == entt::to_entity(second));
+	fixture.ExtractAll();
+
+	ECSE_CHECK(fixture.World().GetProxies(0).GetCount() == 0);
+	ECSE_CHECK(fixture.World().GetProxies(1).GetCount() == 0);
+}
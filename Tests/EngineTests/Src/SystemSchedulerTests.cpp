@@ -0,0 +1,316 @@
+﻿/*
+* SystemScheduler のテスト
+* 宣言から張られる依存の数、競合するシステムが重ならないこと、Exclusive と無効化、
+* ランダムに作ったシステムを並列に動かした結果が登録順に動かした結果と同じになることを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<ECS/System/SystemScheduler.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<atomic>
+#include<random>
+#include<utility>
+#include<vector>
+
+using namespace Ecse;
+using namespace Ecse::ECS;
+
+namespace
+{
+	/// <summary>
+	/// 型だけが違うコンポーネント
+	/// </summary>
+	template<uint32_t N>
+	struct Value
+	{
+		uint64_t Data = 0;
+	};
+
+	/// <summary>
+	/// Value の型の数
+	/// </summary>
+	constexpr uint32_t VALUE_TYPE_COUNT = 8;
+
+	template<uint32_t... N>
+	void DeclareValue(SystemAccess& Access, uint32_t Type, bool IsWrite, std::integer_sequence<uint32_t, N...>)
+	{
+		((Type == N ? (IsWrite ? Access.Write<Value<N>>() : Access.Read<Value<N>>(), 0) : 0), ...);
+	}
+
+	/// <summary>
+	/// 番号で選んだ Value を宣言する
+	/// </summary>
+	void DeclareValue(SystemAccess& Access, uint32_t Type, bool IsWrite)
+	{
+		DeclareValue(Access, Type, IsWrite, std::make_integer_sequence<uint32_t, VALUE_TYPE_COUNT>());
+	}
+
+	template<uint32_t... N>
+	uint64_t& GetValue(entt::registry& Registry, uint32_t Type, entt::entity Entity, std::integer_sequence<uint32_t, N...>)
+	{
+		uint64_t* pData = nullptr;
+		((Type == N ? (pData = &Registry.get<Value<N>>(Entity).Data, 0) : 0), ...);
+		return *pData;
+	}
+
+	/// <summary>
+	/// 番号で選んだ Value を取る
+	/// </summary>
+	uint64_t& GetValue(entt::registry& Registry, uint32_t Type, entt::entity Entity)
+	{
+		return GetValue(Registry, Type, Entity, std::make_integer_sequence<uint32_t, VALUE_TYPE_COUNT>());
+	}
+
+	template<uint32_t... N>
+	void EmplaceValues(entt::registry& Registry, entt::entity Entity, uint64_t Seed, std::integer_sequence<uint32_t, N...>)
+	{
+		(Registry.emplace<Value<N>>(Entity, Value<N>{ Seed * VALUE_TYPE_COUNT + N }), ...);
+	}
+
+	/// <summary>
+	/// テスト1つ分の JobSystem と SystemScheduler
+	/// </summary>
+	class SchedulerFixture
+	{
+	public:
+		explicit SchedulerFixture(bool IsParallel)
+		{
+			System::JobSystem::Create();
+			System::ServiceLocator::Get<System::JobSystem>()->Initialize(3);
+			SystemScheduler::Create();
+			mpScheduler = System::ServiceLocator::Get<SystemScheduler>();
+			mpScheduler->Initialize(mRegistry, IsParallel);
+		}
+
+		~SchedulerFixture()
+		{
+			SystemScheduler::Release();
+			System::JobSystem::Release();
+		}
+
+		entt::registry& Registry() { return mRegistry; }
+		SystemScheduler& Scheduler() { return *mpScheduler; }
+
+	private:
+		entt::registry mRegistry;
+		SystemScheduler* mpScheduler = nullptr;
+	};
+
+	/// <summary>
+	/// 同時に動いている読み手と書き手を数え、宣言通りに分けられているかを見る
+	/// </summary>
+	class AccessTracker
+	{
+	public:
+		void Begin(uint32_t Type, bool IsWrite)
+		{
+			if (IsWrite)
+			{
+				if (mWriters[Type].fetch_add(1) != 0 || mReaders[Type].load() != 0) mViolations.fetch_add(1);
+				return;
+			}
+			mReaders[Type].fetch_add(1);
+			if (mWriters[Type].load() != 0) mViolations.fetch_add(1);
+		}
+
+		void End(uint32_t Type, bool IsWrite)
+		{
+			if (IsWrite)
+			{
+				mWriters[Type].fetch_sub(1);
+				return;
+			}
+			mReaders[Type].fetch_sub(1);
+		}
+
+		uint32_t GetViolations() const { return mViolations.load(); }
+
+	private:
+		std::atomic<uint32_t> mReaders[VALUE_TYPE_COUNT] = {};
+		std::atomic<uint32_t> mWriters[VALUE_TYPE_COUNT] = {};
+		std::atomic<uint32_t> mViolations = 0;
+	};
+
+	/// <summary>
+	/// ランダムに作ったシステム1つ
+	/// </summary>
+	struct RandomSystem
+	{
+		std::vector<uint32_t> Reads;
+		std::vector<uint32_t> Writes;
+		bool IsExclusive = false;
+		bool IsEnabled = true;
+	};
+
+	/// <summary>
+	/// 決まった種からシステムを作る（型は重ならないように選ぶ）
+	/// </summary>
+	std::vector<RandomSystem> MakeRandomSystems(uint32_t Count, uint32_t Seed)
+	{
+		std::mt19937 random(Seed);
+		std::vector<RandomSystem> systems(Count);
+		for (RandomSystem& system : systems)
+		{
+			for (uint32_t type = 0; type < VALUE_TYPE_COUNT; ++type)
+			{
+				const uint32_t roll = random() % 8;
+				if (roll == 0) system.Writes.push_back(type);
+				else if (roll <= 2) system.Reads.push_back(type);
+			}
+			if (system.Writes.empty()) system.Writes.push_back(random() % VALUE_TYPE_COUNT);
+			std::erase(system.Reads, system.Writes.front());
+			system.IsExclusive = random() % 10 == 0;
+			system.IsEnabled = random() % 12 != 0;
+		}
+		return systems;
+	}
+
+	/// <summary>
+	/// システムを登録して Frames 回動かし、全ての値を返す
+	/// </summary>
+	std::vector<uint64_t> RunRandomSystems(const std::vector<RandomSystem>& Systems, bool IsParallel, uint32_t Frames, uint32_t& Violations)
+	{
+		constexpr uint32_t ENTITY_COUNT = 256;
+		SchedulerFixture fixture(IsParallel);
+		entt::registry& registry = fixture.Registry();
+		SystemScheduler& scheduler = fixture.Scheduler();
+
+		std::vector<entt::entity> entities(ENTITY_COUNT);
+		for (uint32_t i = 0; i < ENTITY_COUNT; ++i)
+		{
+			entities[i] = registry.create();
+			EmplaceValues(registry, entities[i], i, std::make_integer_sequence<uint32_t, VALUE_TYPE_COUNT>());
+		}
+
+		AccessTracker tracker;
+		for (uint32_t index = 0; index < Systems.size(); ++index)
+		{
+			const RandomSystem& system = Systems[index];
+			SystemAccess access;
+			for (const uint32_t type : system.Reads) DeclareValue(access, type, false);
+			for (const uint32_t type : system.Writes) DeclareValue(access, type, true);
+			if (system.IsExclusive) access.Exclusive();
+
+			//	書く値を、読む値と自分の番号から順番に依存する形で混ぜる（順番が入れ替わると結果が変わる）
+			const SystemId id = scheduler.AddSystem("Random" + std::to_string(index), access, [&system, &tracker, &entities, index](entt::registry& Registry, float)
+				{
+					for (const uint32_t type : system.Reads) tracker.Begin(type, false);
+					for (const uint32_t type : system.Writes) tracker.Begin(type, true);
+					for (const entt::entity entity : entities)
+					{
+						uint64_t mixed = index + 1;
+						for (const uint32_t type : system.Reads) mixed = mixed * 31 + GetValue(Registry, type, entity);
+						for (const uint32_t type : system.Writes)
+						{
+							uint64_t& data = GetValue(Registry, type, entity);
+							data = data * 1099511628211ull + mixed;
+						}
+					}
+					for (const uint32_t type : system.Writes) tracker.End(type, true);
+					for (const uint32_t type : system.Reads) tracker.End(type, false);
+				});
+			scheduler.SetEnabled(id, system.IsEnabled);
+		}
+
+		for (uint32_t frame = 0; frame < Frames; ++frame)
+		{
+			scheduler.Update(1.0f / 60.0f);
+		}
+		Violations = tracker.GetViolations();
+
+		std::vector<uint64_t> values;
+		values.reserve(ENTITY_COUNT * VALUE_TYPE_COUNT);
+		for (const entt::entity entity : entities)
+		{
+			for (uint32_t type = 0; type < VALUE_TYPE_COUNT; ++type) values.push_back(GetValue(registry, type, entity));
+		}
+		return values;
+	}
+}
+
+ECSE_TEST(SystemScheduler_BuildsEdgesFromAccess)
+{
+	SchedulerFixture fixture(true);
+	SystemScheduler& scheduler = fixture.Scheduler();
+
+	//	A が書き、B と C が読み（B と C は競合しない）、E は D の書いたものを読んで A の型に書く
+	auto nothing = [](entt::registry&, float) {};
+	const SystemId a = scheduler.AddSystem("A", SystemAccess().Write<Value<0>>(), nothing);
+	const SystemId b = scheduler.AddSystem("B", SystemAccess().Read<Value<0>>(), nothing);
+	const SystemId c = scheduler.AddSystem("C", SystemAccess().Read<Value<0>>(), nothing);
+	const SystemId d = scheduler.AddSystem("D", SystemAccess().Write<Value<1>>(), nothing);
+	const SystemId e = scheduler.AddSystem("E", SystemAccess().Read<Value<1>>().Write<Value<0>>(), nothing);
+	ECSE_CHECK(scheduler.GetSystemCount() == 5);
+	ECSE_CHECK(scheduler.GetName(e) == "E");
+
+	scheduler.Update(0.0f);
+	SystemSchedulerStats stats = scheduler.GetStats();
+	ECSE_CHECK(stats.Systems == 5);
+	//	A-B, A-C, A-E, B-E, C-E, D-E
+	ECSE_CHECK(stats.Edges == 6);
+
+	//	依存のある組は重ならない
+	const std::pair<SystemId, SystemId> edges[] = { { a, b }, { a, c }, { a, e }, { b, e }, { c, e }, { d, e } };
+	for (const auto& [before, after] : edges)
+	{
+		ECSE_CHECK(scheduler.GetTiming(before).EndMs <= scheduler.GetTiming(after).StartMs);
+	}
+
+	//	クリティカルパスは E で終わる
+	const std::span<const SystemId> path = scheduler.GetCriticalPath();
+	ECSE_CHECK(path.empty() == false);
+	if (path.empty() == false) ECSE_CHECK(path.back() == e);
+	ECSE_CHECK(scheduler.GetTiming(e).IsOnCriticalPath);
+}
+
+ECSE_TEST(SystemScheduler_ExclusiveAndDisabledSystems)
+{
+	SchedulerFixture fixture(true);
+	SystemScheduler& scheduler = fixture.Scheduler();
+
+	//	Exclusive は型を宣言していなくても全てと競合する
+	std::vector<uint32_t> calls(4, 0);
+	const SystemId first = scheduler.AddSystem("First", SystemAccess().Read<Value<0>>(), [&calls](entt::registry&, float) { calls[0]++; });
+	const SystemId second = scheduler.AddSystem("Second", SystemAccess().Read<Value<1>>(), [&calls](entt::registry&, float) { calls[1]++; });
+	const SystemId exclusive = scheduler.AddSystem("Exclusive", SystemAccess().Exclusive(), [&calls](entt::registry&, float) { calls[2]++; });
+	const SystemId last = scheduler.AddSystem("Last", SystemAccess().Read<Value<2>>(), [&calls](entt::registry&, float) { calls[3]++; });
+
+	scheduler.Update(0.0f);
+	ECSE_CHECK(scheduler.GetStats().Edges == 3);
+	ECSE_CHECK(scheduler.GetTiming(first).EndMs <= scheduler.GetTiming(exclusive).StartMs);
+	ECSE_CHECK(scheduler.GetTiming(second).EndMs <= scheduler.GetTiming(exclusive).StartMs);
+	ECSE_CHECK(scheduler.GetTiming(exclusive).EndMs <= scheduler.GetTiming(last).StartMs);
+
+	//	無効にしたものは次の Update から動かず、依存からも外れる
+	scheduler.SetEnabled(exclusive, false);
+	ECSE_CHECK(scheduler.IsEnabled(exclusive) == false);
+	scheduler.Update(0.0f);
+	ECSE_CHECK(scheduler.GetStats().Systems == 3);
+	ECSE_CHECK(scheduler.GetStats().Edges == 0);
+	ECSE_CHECK(scheduler.GetTiming(exclusive).Ms == 0.0);
+	ECSE_CHECK((calls == std::vector<uint32_t>{ 2, 2, 1, 2 }));
+
+	scheduler.SetEnabled(exclusive, true);
+	scheduler.Update(0.0f);
+	ECSE_CHECK(scheduler.GetStats().Edges == 3);
+	ECSE_CHECK(calls[2] == 2);
+}
+
+ECSE_TEST(SystemScheduler_ParallelMatchesSerial)
+{
+	constexpr uint32_t SYSTEM_COUNT = 40;
+	constexpr uint32_t FRAMES = 6;
+	const uint32_t seeds[] = { 1, 7, 42 };
+	for (const uint32_t seed : seeds)
+	{
+		const std::vector<RandomSystem> systems = MakeRandomSystems(SYSTEM_COUNT, seed);
+		uint32_t serialViolations = 0;
+		uint32_t parallelViolations = 0;
+		const std::vector<uint64_t> serial = RunRandomSystems(systems, false, FRAMES, serialViolations);
+		const std::vector<uint64_t> parallel = RunRandomSystems(systems, true, FRAMES, parallelViolations);
+		ECSE_CHECK(serial == parallel);
+		ECSE_CHECK(serialViolations == 0);
+		ECSE_CHECK(parallelViolations == 0);
+	}
+}
@@ -0,0 +1,335 @@
+﻿/*
+* Task と TaskScheduler のテスト
+* 深い co_await の入れ子、手放した Task の後片付け、ワーカーへの移動と待ち、次のフレームの順番、フレームの使い回しを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<System/Thread/Task.hpp>
+#include<System/Thread/TaskScheduler.hpp>
+#include<System/Thread/JobSystem.hpp>
+
+#include<atomic>
+#include<chrono>
+#include<thread>
+#include<vector>
+
+using namespace Ecse::System;
+
+namespace
+{
+	/// <summary>
+	/// テスト1つ分の JobSystem と TaskScheduler
+	/// </summary>
+	class TaskFixture
+	{
+	public:
+		TaskFixture()
+		{
+			JobSystem::Create();
+			mpJobs = ServiceLocator::Get<JobSystem>();
+			mpJobs->Initialize(3);
+			TaskScheduler::Create();
+			mpScheduler = ServiceLocator::Get<TaskScheduler>();
+		}
+
+		~TaskFixture()
+		{
+			TaskScheduler::Release();
+			JobSystem::Release();
+		}
+
+		JobSystem& Jobs() { return *mpJobs; }
+		TaskScheduler& Scheduler() { return *mpScheduler; }
+
+	private:
+		JobSystem* mpJobs = nullptr;
+		TaskScheduler* mpScheduler = nullptr;
+	};
+
+	Task<uint32_t> Square(uint32_t Value)
+	{
+		co_return Value * Value;
+	}
+
+	/// <summary>
+	/// Depth 段だけ co_await を入れ子にする（続きへそのまま切り替えるのでスタックは積まれない）
+	/// </summary>
+	Task<uint32_t> Nest(uint32_t Depth)
+	{
+		if (Depth == 0) co_return 0;
+		const uint32_t inner = co_await Nest(Depth - 1);
+		co_return inner + 1;
+	}
+
+	Task<> SetFlag(bool& Flag)
+	{
+		Flag = true;
+		co_return;
+	}
+
+	/// <summary>
+	/// ワーカーへ移ってから値を返す
+	/// </summary>
+	Task<uint32_t> SquareOnWorker(TaskScheduler& Scheduler, uint32_t Value)
+	{
+		co_await Scheduler.Schedule();
+		co_return co_await Square(Value);
+	}
+}
+
+ECSE_TEST(Task_StartsOnlyWhenStartedOrAwaited)
+{
+	bool isRun = false;
+	{
+		Task<> task = SetFlag(isRun);
+		ECSE_CHECK(task.IsValid());
+		ECSE_CHECK(task.IsDone() == false);
+	}
+	//	一度も動かさずに破棄したら動かない
+	ECSE_CHECK(isRun == false);
+
+	Task<> task = SetFlag(isRun);
+	task.Start();
+	ECSE_CHECK(isRun);
+	ECSE_CHECK(task.IsDone());
+
+	Task<uint32_t> square = Square(7);
+	square.Start();
+	ECSE_CHECK(square.IsDone());
+	ECSE_CHECK(square.GetResult() == 49);
+
+	//	ムーブしても持ち主が移るだけ
+	Task<uint32_t> moved = Square(3);
+	Task<uint32_t> owner = std::move(moved);
+	ECSE_CHECK(moved.IsValid() == false);
+	owner.Start();
+	ECSE_CHECK(owner.GetResult() == 9);
+}
+
+ECSE_TEST(Task_NestedAwaitDoesNotGrowStack)
+{
+	constexpr uint32_t DEPTH = 1000;
+	Task<uint32_t> task = Nest(DEPTH);
+	task.Start();
+	ECSE_CHECK(task.IsDone());
+	ECSE_CHECK(task.GetResult() == DEPTH);
+}
+
+ECSE_TEST(Task_FrameAllocatorReusesFrames)
+{
+	const TaskFrameStats before = TaskFrameAllocator::GetStats();
+
+	//	同じ段に丸められる大きさは使い回される
+	void* pFirst = TaskFrameAllocator::Allocate(100);
+	TaskFrameAllocator::Free(pFirst, 100);
+	void* pSecond = TaskFrameAllocator::Allocate(120);
+	ECSE_CHECK(pSecond == pFirst);
+	TaskFrameAllocator::Free(pSecond, 120);
+
+	//	大きすぎるものはプールを通さない
+	void* pLarge = TaskFrameAllocator::Allocate(TaskFrameAllocator::MAX_SIZE + 1);
+	ECSE_CHECK(pLarge != nullptr);
+	TaskFrameAllocator::Free(pLarge, TaskFrameAllocator::MAX_SIZE + 1);
+
+	//	他のスレッドで解放したものはそのスレッドの空きに入る
+	void* pShared = TaskFrameAllocator::Allocate(TaskFrameAllocator::MAX_SIZE);
+	std::thread([pShared]() { TaskFrameAllocator::Free(pShared, TaskFrameAllocator::MAX_SIZE); }).join();
+
+	const TaskFrameStats after = TaskFrameAllocator::GetStats();
+	ECSE_CHECK(after.Allocations - before.Allocations == 4);
+	ECSE_CHECK(after.Reused - before.Reused >= 1);
+	ECSE_CHECK(after.Large - before.Large == 1);
+
+	//	Task のフレームも使い回される
+	for (uint32_t i = 0; i < 100; ++i)
+	{
+		Task<uint32_t> task = Square(i);
+		task.Start();
+	}
+	const TaskFrameStats tasks = TaskFrameAllocator::GetStats();
+	ECSE_CHECK(tasks.Allocations - after.Allocations == 100);
+	ECSE_CHECK(tasks.Reused - after.Reused >= 99);
+}
+
+ECSE_TEST(Task_DetachedTasksFinishOnWorkers)
+{
+	TaskFixture fixture;
+	JobSystem& jobs = fixture.Jobs();
+	TaskScheduler& scheduler = fixture.Scheduler();
+
+	constexpr uint32_t COUNT = 2000;
+	JobCounter counter;
+	jobs.AddPending(counter, COUNT);
+	std::atomic<uint32_t> sum = 0;
+	std::atomic<uint32_t> onWorker = 0;
+
+	auto body = [&](uint32_t Value) -> Task<>
+		{
+			const uint32_t squared = co_await SquareOnWorker(scheduler, Value);
+			if (jobs.GetThreadIndex() != JobSystem::INVALID_THREAD_INDEX) onWorker.fetch_add(1);
+			sum.fetch_add(squared);
+			jobs.Complete(counter);
+		};
+
+	uint32_t expected = 0;
+	for (uint32_t i = 0; i < COUNT; ++i)
+	{
+		expected += i * i;
+		//	動かす前に手放す、動かしてから手放す、持ったまま破棄するの3通り
+		Task<> task = body(i);
+		if (i % 3 == 0)
+		{
+			task.Detach();
+		}
+		else if (i % 3 == 1)
+		{
+			task.Start();
+			task.Detach();
+		}
+		else
+		{
+			task.Start();
+		}
+	}
+	jobs.Wait(counter);
+
+	ECSE_CHECK(sum.load() == expected);
+	ECSE_CHECK(onWorker.load() == COUNT);
+}
+
+ECSE_TEST(Task_WaitForResumesAfterCounter)
+{
+	TaskFixture fixture;
+	JobSystem& jobs = fixture.Jobs();
+	TaskScheduler& scheduler = fixture.Scheduler();
+
+	//	既に 0 のカウンターは止まらずに続く
+	JobCounter empty;
+	bool isPassed = false;
+	auto passThrough = [&]() -> Task<>
+		{
+			co_await scheduler.WaitFor(empty);
+			isPassed = true;
+		};
+	Task<> pass = passThrough();
+	pass.Start();
+	ECSE_CHECK(isPassed);
+	ECSE_CHECK(pass.IsDone());
+
+	//	外の処理が終わるまで続かない
+	JobCounter gate;
+	jobs.AddPending(gate);
+	std::atomic<bool> isGateOpen = false;
+	std::atomic<bool> isResumedEarly = false;
+	JobCounter done;
+	jobs.AddPending(done);
+	auto waiter = [&]() -> Task<>
+		{
+			co_await scheduler.WaitFor(gate);
+			if (isGateOpen.load() == false) isResumedEarly.store(true);
+			jobs.Complete(done);
+		};
+	Task<> task = waiter();
+	task.Start();
+	ECSE_CHECK(task.IsDone() == false);
+
+	std::thread opener([&]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			isGateOpen.store(true);
+			jobs.Complete(gate);
+		});
+	jobs.Wait(done);
+	opener.join();
+	ECSE_CHECK(isResumedEarly.load() == false);
+
+	//	別のスレッドで終わった Task を co_await すると、そのまま続きが動く
+	std::atomic<uint32_t> result = 0;
+	JobCounter awaited;
+	jobs.AddPending(awaited);
+	auto parent = [&]() -> Task<>
+		{
+			Task<uint32_t> child = SquareOnWorker(scheduler, 12);
+			result.store(co_await child);
+			jobs.Complete(awaited);
+		};
+	parent().Detach();
+	jobs.Wait(awaited);
+	ECSE_CHECK(result.load() == 144);
+}
+
+ECSE_TEST(Task_NextFrameResumesInUpdateOrder)
+{
+	TaskFixture fixture;
+	TaskScheduler& scheduler = fixture.Scheduler();
+
+	//	それぞれのフレームで動いた時の Update の回数を覚える
+	constexpr uint32_t FRAMES = 3;
+	std::vector<uint64_t> seen;
+	auto walker = [&](uint32_t Id) -> Task<>
+		{
+			for (uint32_t frame = 0; frame < FRAMES; ++frame)
+			{
+				co_await scheduler.NextFrame();
+				seen.push_back(scheduler.GetStats().Frames * 10 + Id);
+			}
+		};
+
+	Task<> first = walker(1);
+	Task<> second = walker(2);
+	first.Start();
+	second.Start();
+	ECSE_CHECK(scheduler.GetStats().WaitingFrames == 2);
+	ECSE_CHECK(seen.empty());
+
+	//	Update で再開した先で次のフレームを待ったら、次の Update まで動かない
+	for (uint32_t frame = 1; frame <= FRAMES; ++frame)
+	{
+		scheduler.Update();
+		ECSE_CHECK(seen.size() == frame * 2);
+	}
+	ECSE_CHECK(first.IsDone());
+	ECSE_CHECK(second.IsDone());
+
+	const std::vector<uint64_t> expected = { 11, 12, 21, 22, 31, 32 };
+	ECSE_CHECK(seen == expected);
+
+	const TaskSchedulerStats stats = scheduler.GetStats();
+	ECSE_CHECK(stats.WaitingFrames == 0);
+	ECSE_CHECK(stats.Resumed == FRAMES * 2);
+	ECSE_CHECK(stats.Frames == FRAMES);
+}
+
+ECSE_TEST(Task_CallbackAwaiterResumesFromAnyThread)
+{
+	//	処理を始めた関数の中で呼ばれたら止まらない
+	auto immediate = []() -> Task<uint32_t>
+		{
+			co_return co_await CallbackAwaiter<uint32_t>([](CallbackAwaiter<uint32_t>::ResumeFunction Resume) { Resume(5); });
+		};
+	Task<uint32_t> task = immediate();
+	task.Start();
+	ECSE_CHECK(task.IsDone());
+	ECSE_CHECK(task.GetResult() == 5);
+
+	//	別のスレッドから呼ばれたら、そのスレッドで続く
+	std::thread worker;
+	std::atomic<bool> isFinished = false;
+	std::thread::id resumedOn;
+	auto later = [&]() -> Task<>
+		{
+			const uint32_t value = co_await CallbackAwaiter<uint32_t>([&worker](CallbackAwaiter<uint32_t>::ResumeFunction Resume)
+				{
+					worker = std::thread([Resume]() { Resume(8); });
+				});
+			resumedOn = std::this_thread::get_id();
+			if (value == 8) isFinished.store(true);
+		};
+	Task<> pending = later();
+	pending.Start();
+	const std::thread::id workerId = worker.get_id();
+	worker.join();
+	ECSE_CHECK(isFinished.load());
+	ECSE_CHECK(resumedOn == workerId);
+	ECSE_CHECK(pending.IsDone());
+}
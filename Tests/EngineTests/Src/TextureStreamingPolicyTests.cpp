@@ -0,0 +1,222 @@
+﻿/*
+* TextureStreamingPolicy のテスト
+* 欲しいミップの計算と、予算の中での割り当て（常駐の末尾・面積順・最近映った順に残す）を確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Texture/TextureStreamingPolicy.hpp>
+
+#include<random>
+#include<vector>
+
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// RGBA8 の正方形のテクスチャ
+	/// </summary>
+	StreamingTexture MakeTexture(uint32_t Size, uint8_t MinResidentMip, uint8_t RequestedMip, uint8_t ResidentMip, float Priority = 1.0f, uint64_t LastUsedFrame = 0)
+	{
+		StreamingTexture texture;
+		while ((Size >> texture.MipCount) > 0 && texture.MipCount < StreamingTexture::MAX_MIPS)
+		{
+			const uint64_t size = Size >> texture.MipCount;
+			texture.MipBytes[texture.MipCount] = size * size * 4;
+			texture.MipCount++;
+		}
+		texture.MinResidentMip = MinResidentMip;
+		texture.RequestedMip = RequestedMip;
+		texture.ResidentMip = ResidentMip;
+		texture.Priority = Priority;
+		texture.LastUsedFrame = LastUsedFrame;
+		return texture;
+	}
+
+	/// <summary>
+	/// 割り当てた結果の大きさの合計
+	/// </summary>
+	uint64_t SumTargetBytes(const std::vector<StreamingTexture>& Textures, const std::vector<uint8_t>& Targets)
+	{
+		uint64_t bytes = 0;
+		for (size_t i = 0; i < Textures.size(); ++i) bytes += TextureStreamingPolicy::ComputeResidentBytes(Textures[i], Targets[i]);
+		return bytes;
+	}
+}
+
+ECSE_TEST(TextureStreamingPolicy_RequiredMipFollowsScreenArea)
+{
+	//	1024x1024 は 11 段
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 1024.0f * 1024.0f) == 0);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 2048.0f * 2048.0f) == 0);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 512.0f * 512.0f) == 1);
+	//	画面のピクセルより粗くならない（512x512 は 90000 以上、256x256 は足りない）
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 300.0f * 300.0f) == 1);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 1.0f) == 10);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(2048, 512, 12, 256.0f * 256.0f) == 2);
+
+	//	映っていなければ一番粗いもの
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 0.0f) == 10);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, -1.0f) == 10);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 0, 100.0f) == 0);
+
+	//	ずらした後もミップの範囲に収める
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 512.0f * 512.0f, 2) == 3);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 512.0f * 512.0f, -5) == 0);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeRequiredMip(1024, 1024, 11, 512.0f * 512.0f, 20) == 10);
+}
+
+ECSE_TEST(TextureStreamingPolicy_ResidentBytesSumsCoarserMips)
+{
+	const StreamingTexture texture = MakeTexture(8, 2, 0, 2);
+	ECSE_CHECK(texture.MipCount == 4);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeResidentBytes(texture, 0) == (64 + 16 + 4 + 1) * 4);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeResidentBytes(texture, 2) == (4 + 1) * 4);
+	ECSE_CHECK(TextureStreamingPolicy::ComputeResidentBytes(texture, 4) == 0);
+}
+
+ECSE_TEST(TextureStreamingPolicy_GrantsRequestsWithinBudget)
+{
+	const std::vector<StreamingTexture> textures = {
+		MakeTexture(1024, 6, 0, 6, 100.0f),
+		MakeTexture(512, 5, 2, 5, 50.0f),
+		MakeTexture(256, 4, 7, 4, 10.0f),
+	};
+	std::vector<uint8_t> targets(textures.size());
+
+	TextureStreamingPolicy policy;
+	const StreamingBudgetStats stats = policy.Resolve(textures, UINT64_MAX, targets);
+
+	//	欲しいミップは常駐の末尾より粗くならない
+	ECSE_CHECK(targets[0] == 0);
+	ECSE_CHECK(targets[1] == 2);
+	ECSE_CHECK(targets[2] == 4);
+	ECSE_CHECK(stats.TargetBytes == stats.RequestedBytes);
+	ECSE_CHECK(stats.TargetBytes == SumTargetBytes(textures, targets));
+	ECSE_CHECK(stats.Upgrades == 2);
+	ECSE_CHECK(stats.Evictions == 0);
+	ECSE_CHECK(stats.Starved == 0);
+}
+
+ECSE_TEST(TextureStreamingPolicy_KeepsMandatoryTailOverBudget)
+{
+	const std::vector<StreamingTexture> textures = {
+		MakeTexture(1024, 4, 0, 0, 100.0f),
+		MakeTexture(1024, 4, 0, 0, 50.0f),
+	};
+	std::vector<uint8_t> targets(textures.size());
+
+	TextureStreamingPolicy policy;
+	const StreamingBudgetStats stats = policy.Resolve(textures, 0, targets);
+
+	//	予算が足りなくても常駐の末尾は外さない
+	ECSE_CHECK(targets[0] == 4 && targets[1] == 4);
+	ECSE_CHECK(stats.MandatoryBytes == SumTargetBytes(textures, targets));
+	ECSE_CHECK(stats.TargetBytes == stats.MandatoryBytes);
+	ECSE_CHECK(stats.Evictions == 2);
+	ECSE_CHECK(stats.Starved == 2);
+}
+
+ECSE_TEST(TextureStreamingPolicy_UpgradesLargestScreenAreaFirst)
+{
+	//	予算は常駐の末尾と、どちらか1枚を全て置く分だけ
+	const std::vector<StreamingTexture> textures = {
+		MakeTexture(1024, 4, 0, 4, 10.0f),
+		MakeTexture(1024, 4, 0, 4, 90.0f),
+	};
+	std::vector<uint8_t> targets(textures.size());
+	const uint64_t budget = TextureStreamingPolicy::ComputeResidentBytes(textures[0], 0) + TextureStreamingPolicy::ComputeResidentBytes(textures[1], 4);
+
+	TextureStreamingPolicy policy;
+	const StreamingBudgetStats stats = policy.Resolve(textures, budget, targets);
+	ECSE_CHECK(targets[1] == 0);
+	ECSE_CHECK(targets[0] == 4);
+	ECSE_CHECK(stats.TargetBytes == budget);
+	ECSE_CHECK(stats.Starved == 1);
+	ECSE_CHECK(stats.Upgrades == 1);
+}
+
+ECSE_TEST(TextureStreamingPolicy_SmallTexturesFillLeftoverBudget)
+{
+	//	大きい方は次の段が入らず止まるが、小さい方は面積が小さくても入る
+	const std::vector<StreamingTexture> textures = {
+		MakeTexture(2048, 5, 0, 5, 100.0f),
+		MakeTexture(128, 5, 0, 5, 1.0f),
+	};
+	std::vector<uint8_t> targets(textures.size());
+	const uint64_t mandatory = TextureStreamingPolicy::ComputeResidentBytes(textures[0], 5) + TextureStreamingPolicy::ComputeResidentBytes(textures[1], 5);
+	const uint64_t budget = mandatory + textures[0].MipBytes[4] + textures[0].MipBytes[3] + TextureStreamingPolicy::ComputeResidentBytes(textures[1], 0);
+
+	TextureStreamingPolicy policy;
+	const StreamingBudgetStats stats = policy.Resolve(textures, budget, targets);
+	ECSE_CHECK(targets[0] == 3);
+	ECSE_CHECK(targets[1] == 0);
+	ECSE_CHECK(stats.Starved == 1);
+	ECSE_CHECK(stats.TargetBytes <= budget);
+}
+
+ECSE_TEST(TextureStreamingPolicy_RetainsRecentlyUsedMips)
+{
+	//	どちらも今は細かいミップまで置いてあるが、もう欲しくない。残せるのは1枚分だけ
+	const std::vector<StreamingTexture> textures = {
+		MakeTexture(512, 5, 5, 0, 1.0f, 10),
+		MakeTexture(512, 5, 5, 0, 1.0f, 20),
+	};
+	std::vector<uint8_t> targets(textures.size());
+	const uint64_t budget = TextureStreamingPolicy::ComputeResidentBytes(textures[0], 0) + TextureStreamingPolicy::ComputeResidentBytes(textures[1], 5);
+
+	TextureStreamingPolicy policy;
+	StreamingBudgetStats stats = policy.Resolve(textures, budget, targets);
+	ECSE_CHECK(targets[1] == 0);
+	ECSE_CHECK(targets[0] == 5);
+	ECSE_CHECK(stats.Retained == 1);
+	ECSE_CHECK(stats.Evictions == 1);
+	ECSE_CHECK(stats.Upgrades == 0);
+
+	//	予算に余裕があれば両方残す
+	stats = policy.Resolve(textures, UINT64_MAX, targets);
+	ECSE_CHECK(targets[0] == 0 && targets[1] == 0);
+	ECSE_CHECK(stats.Retained == 2);
+	ECSE_CHECK(stats.Evictions == 0);
+}
+
+ECSE_TEST(TextureStreamingPolicy_NeverExceedsBudgetAboveMandatory)
+{
+	std::mt19937 random(7);
+	std::vector<StreamingTexture> textures;
+	for (uint32_t i = 0; i < 300; ++i)
+	{
+		const uint32_t size = 32u << (random() % 7);
+		StreamingTexture texture = MakeTexture(size, 0, 0, 0, static_cast<float>(random() % 1000), random() % 50);
+		texture.MinResidentMip = static_cast<uint8_t>(std::min<uint32_t>(4, texture.MipCount - 1));
+		texture.RequestedMip = static_cast<uint8_t>(random() % texture.MipCount);
+		texture.ResidentMip = static_cast<uint8_t>(random() % (texture.MinResidentMip + 1));
+		textures.push_back(texture);
+	}
+	std::vector<uint8_t> targets(textures.size());
+
+	TextureStreamingPolicy policy;
+	const StreamingBudgetStats full = policy.Resolve(textures, UINT64_MAX, targets);
+	for (uint32_t step = 0; step <= 8; ++step)
+	{
+		const uint64_t budget = full.MandatoryBytes + (full.TargetBytes - full.MandatoryBytes) * step / 8;
+		const StreamingBudgetStats stats = policy.Resolve(textures, budget, targets);
+		ECSE_CHECK(stats.TargetBytes <= budget);
+		ECSE_CHECK(stats.TargetBytes == SumTargetBytes(textures, targets));
+
+		uint32_t upgrades = 0;
+		uint32_t evictions = 0;
+		uint32_t outOfRange = 0;
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			//	欲しいミップと今置いてあるミップの細かい方より細かくせず、常駐の末尾より粗くしない
+			const uint8_t finest = std::min(textures[i].RequestedMip, textures[i].ResidentMip);
+			if (targets[i] < finest || targets[i] > textures[i].MinResidentMip) outOfRange++;
+			if (targets[i] < textures[i].ResidentMip) upgrades++;
+			if (targets[i] > textures[i].ResidentMip) evictions++;
+		}
+		ECSE_CHECK(outOfRange == 0);
+		ECSE_CHECK(stats.Upgrades == upgrades);
+		ECSE_CHECK(stats.Evictions == evictions);
+	}
+}
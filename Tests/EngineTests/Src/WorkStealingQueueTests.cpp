@@ -0,0 +1,102 @@
+﻿/*
+* WorkStealingQueue のテスト
+* 持ち主1人と盗むスレッド3人で取り合い、全ての要素がちょうど1回ずつ取られるかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<System/Thread/WorkStealingQueue.hpp>
+
+#include<atomic>
+#include<thread>
+
+using namespace Ecse::System;
+
+ECSE_TEST(WorkStealingQueue_PopIsLifoAndStealIsFifo)
+{
+	WorkStealingQueue<uint32_t> queue(4);
+	uint32_t item = 0;
+	ECSE_CHECK(queue.Pop(item) == false);
+	ECSE_CHECK(queue.Steal(item) == false);
+
+	//	最初の大きさを超えて積むと倍に広がる
+	for (uint32_t i = 0; i < 100; ++i) queue.Push(i);
+	ECSE_CHECK(queue.GetSize() == 100);
+
+	ECSE_CHECK(queue.Steal(item) && item == 0);
+	ECSE_CHECK(queue.Steal(item) && item == 1);
+	ECSE_CHECK(queue.Pop(item) && item == 99);
+	ECSE_CHECK(queue.Pop(item) && item == 98);
+	ECSE_CHECK(queue.GetSize() == 96);
+
+	//	取り出しと積み直しを繰り返しても順番は崩れない
+	uint32_t expected = 97;
+	bool isOrdered = true;
+	while (queue.Pop(item))
+	{
+		if (item != expected) isOrdered = false;
+		expected--;
+	}
+	ECSE_CHECK(isOrdered);
+	ECSE_CHECK(expected == 1);
+	ECSE_CHECK(queue.GetSize() == 0);
+}
+
+ECSE_TEST(WorkStealingQueue_ThievesTakeEachItemOnce)
+{
+	constexpr uint32_t ITEM_COUNT = 200000;
+	constexpr uint32_t THIEF_COUNT = 3;
+
+	WorkStealingQueue<uint32_t> queue(16);
+	std::vector<std::atomic<uint32_t>> taken(ITEM_COUNT);
+	std::atomic<uint32_t> total = 0;
+	std::atomic<bool> isDone = false;
+
+	std::vector<std::thread> thieves;
+	std::atomic<uint32_t> stolen = 0;
+	for (uint32_t t = 0; t < THIEF_COUNT; ++t)
+	{
+		thieves.emplace_back([&]()
+			{
+				uint32_t item = 0;
+				while (isDone.load() == false || queue.GetSize() > 0)
+				{
+					if (queue.Steal(item) == false)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					taken[item].fetch_add(1);
+					total.fetch_add(1);
+					stolen.fetch_add(1);
+				}
+			});
+	}
+
+	//	持ち主は積みながら時々自分でも取る（最後の1つの取り合いを起こす）
+	uint32_t item = 0;
+	for (uint32_t i = 0; i < ITEM_COUNT; ++i)
+	{
+		queue.Push(i);
+		if (i % 3 == 0 && queue.Pop(item))
+		{
+			taken[item].fetch_add(1);
+			total.fetch_add(1);
+		}
+	}
+	while (queue.Pop(item))
+	{
+		taken[item].fetch_add(1);
+		total.fetch_add(1);
+	}
+	isDone.store(true);
+	for (std::thread& thief : thieves) thief.join();
+
+	uint32_t wrong = 0;
+	for (const std::atomic<uint32_t>& count : taken)
+	{
+		if (count.load() != 1) wrong++;
+	}
+	ECSE_CHECK(wrong == 0);
+	ECSE_CHECK(total.load() == ITEM_COUNT);
+	std::printf("  %u of %u items stolen\n", stolen.load(), ITEM_COUNT);
+}
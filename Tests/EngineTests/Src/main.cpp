@@ -0,0 +1,17 @@
+﻿/*
+* エンジンの D3D12 に依存しない部分のテスト
+*
+* EngineTests [名前の一部]
+*/
+
+#include<TestRunner.hpp>
+#include<System/Log/Logger.hpp>
+
+int main(int argc, char* argv[])
+{
+	//	失敗した時の理由がログに出るようにする
+	Ecse::System::Logger::Create();
+	const int result = Ecse::Test::RunTests(argc, argv);
+	Ecse::System::Logger::Release();
+	return result;
+}
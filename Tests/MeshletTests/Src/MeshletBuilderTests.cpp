@@ -0,0 +1,205 @@
+﻿/*
+* MeshletBuilder のテスト
+* 262144 三角形の球を分け、全ての三角形がちょうど1回ずつ入っているか、上限と包む球を守っているかを確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Mesh/MeshletBuilder.hpp>
+#include"SphereMesh.hpp"
+
+#include<algorithm>
+#include<array>
+
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// 向きを保ったまま一番小さい添字が先頭に来るように回した三角形
+	/// </summary>
+	std::array<uint32_t, 3> Canonicalize(uint32_t A, uint32_t B, uint32_t C)
+	{
+		if (B < A && B < C) return { B, C, A };
+		if (C < A && C < B) return { C, A, B };
+		return { A, B, C };
+	}
+
+	/// <summary>
+	/// 262144 三角形の球を分けたもの（テストの間で使い回す）
+	/// </summary>
+	struct LargeSphere
+	{
+		Ecse::Test::SphereMesh Sphere;
+		MeshletMesh Mesh;
+		MeshletBuildStats Stats;
+		bool IsBuilt = false;
+	};
+
+	const LargeSphere& GetLargeSphere()
+	{
+		static const LargeSphere sphere = []()
+			{
+				LargeSphere result;
+				result.Sphere = Ecse::Test::MakeSphere(512, 257);
+				result.IsBuilt = MeshletBuilder::Build(result.Sphere.Positions, result.Sphere.Indices, result.Mesh, &result.Stats);
+				return result;
+			}();
+		return sphere;
+	}
+}
+
+ECSE_TEST(MeshletBuilder_SphereHasExpectedSize)
+{
+	const LargeSphere& sphere = GetLargeSphere();
+	ECSE_CHECK(sphere.Sphere.Indices.size() == 262144 * 3);
+	ECSE_CHECK(sphere.IsBuilt);
+	ECSE_CHECK(sphere.Stats.TriangleCount == 262144);
+	ECSE_CHECK(sphere.Stats.MeshletCount == sphere.Mesh.Meshlets.size());
+	ECSE_CHECK(sphere.Mesh.Bounds.size() == sphere.Mesh.Meshlets.size());
+
+	//	格子状のメッシュは頂点の上限で切れるので、頂点が十分に詰まっていて三角形は頂点数より多い
+	const uint32_t lowerBound = (262144 + MESHLET_MAX_TRIANGLES - 1) / MESHLET_MAX_TRIANGLES;
+	ECSE_CHECK(sphere.Stats.MeshletCount >= lowerBound);
+	ECSE_CHECK(sphere.Stats.AverageVertices > MESHLET_MAX_VERTICES * 0.9f);
+	ECSE_CHECK(sphere.Stats.AverageTriangles > static_cast<float>(MESHLET_MAX_VERTICES));
+	std::printf("  meshlets %u, avg vertices %.1f, avg triangles %.1f, cones %u, %.1f ms\n",
+		sphere.Stats.MeshletCount, sphere.Stats.AverageVertices, sphere.Stats.AverageTriangles, sphere.Stats.ConeCount, sphere.Stats.ElapsedMs);
+}
+
+ECSE_TEST(MeshletBuilder_CoversEveryTriangleExactlyOnce)
+{
+	const LargeSphere& sphere = GetLargeSphere();
+	const MeshletMesh& mesh = sphere.Mesh;
+
+	std::vector<std::array<uint32_t, 3>> expected;
+	for (size_t i = 0; i < sphere.Sphere.Indices.size(); i += 3)
+	{
+		expected.push_back(Canonicalize(sphere.Sphere.Indices[i], sphere.Sphere.Indices[i + 1], sphere.Sphere.Indices[i + 2]));
+	}
+
+	std::vector<std::array<uint32_t, 3>> actual;
+	uint32_t overLimit = 0;
+	uint32_t badLocalIndex = 0;
+	uint32_t nextVertex = 0;
+	uint32_t nextTriangle = 0;
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		if (meshlet.VertexCount == 0 || meshlet.VertexCount > MESHLET_MAX_VERTICES) overLimit++;
+		if (meshlet.TriangleCount == 0 || meshlet.TriangleCount > MESHLET_MAX_TRIANGLES) overLimit++;
+		//	メッシュレットは隙間なく順に詰まっている
+		ECSE_CHECK(meshlet.VertexOffset == nextVertex);
+		ECSE_CHECK(meshlet.TriangleOffset == nextTriangle);
+		nextVertex += meshlet.VertexCount;
+		nextTriangle += meshlet.TriangleCount;
+
+		for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const uint32_t packed = mesh.Triangles[meshlet.TriangleOffset + t];
+			uint32_t corners[3];
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint32_t local = MeshletMesh::UnpackTriangle(packed, c);
+				if (local >= meshlet.VertexCount)
+				{
+					badLocalIndex++;
+					corners[c] = 0;
+					continue;
+				}
+				corners[c] = mesh.Vertices[meshlet.VertexOffset + local];
+			}
+			actual.push_back(Canonicalize(corners[0], corners[1], corners[2]));
+		}
+	}
+	ECSE_CHECK(nextVertex == mesh.Vertices.size());
+	ECSE_CHECK(nextTriangle == mesh.Triangles.size());
+	ECSE_CHECK(overLimit == 0);
+	ECSE_CHECK(badLocalIndex == 0);
+
+	//	向きも含めて同じ三角形の集まり
+	std::sort(expected.begin(), expected.end());
+	std::sort(actual.begin(), actual.end());
+	ECSE_CHECK(actual.size() == expected.size());
+	ECSE_CHECK(actual == expected);
+}
+
+ECSE_TEST(MeshletBuilder_BoundsContainAllVertices)
+{
+	const LargeSphere& sphere = GetLargeSphere();
+	const MeshletMesh& mesh = sphere.Mesh;
+
+	uint32_t outside = 0;
+	uint32_t badCones = 0;
+	for (size_t i = 0; i < mesh.Meshlets.size(); ++i)
+	{
+		const Meshlet& meshlet = mesh.Meshlets[i];
+		const MeshletBounds& bounds = mesh.Bounds[i];
+		const DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&bounds.Center);
+		for (uint32_t v = 0; v < meshlet.VertexCount; ++v)
+		{
+			const DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&sphere.Sphere.Positions[mesh.Vertices[meshlet.VertexOffset + v]]);
+			const float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(p, center)));
+			if (distance > bounds.Radius * (1.0f + 1e-5f)) outside++;
+		}
+
+		//	球は凸なので、メッシュレットの法線はまとまり、軸は外を向く
+		if (bounds.ConeCutoff >= 1.0f) continue;
+		const float outward = DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMLoadFloat3(&bounds.ConeAxis), DirectX::XMVector3Normalize(center)));
+		if (outward <= 0.0f) badCones++;
+	}
+	ECSE_CHECK(outside == 0);
+	ECSE_CHECK(badCones == 0);
+	//	細かい球ではほぼ全てのメッシュレットがコーンを持つ
+	ECSE_CHECK(sphere.Stats.ConeCount * 10 >= sphere.Stats.MeshletCount * 9);
+}
+
+ECSE_TEST(MeshletBuilder_RejectsInvalidInput)
+{
+	const std::vector<DirectX::XMFLOAT3> positions = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } };
+	MeshletMesh mesh;
+
+	const std::vector<uint32_t> partial = { 0, 1 };
+	ECSE_CHECK(MeshletBuilder::Build(positions, partial, mesh) == false);
+	const std::vector<uint32_t> outOfRange = { 0, 1, 3 };
+	ECSE_CHECK(MeshletBuilder::Build(positions, outOfRange, mesh) == false);
+	ECSE_CHECK(mesh.Meshlets.empty());
+
+	//	1 つだけの三角形でも 1 つのメッシュレットになる
+	const std::vector<uint32_t> single = { 0, 1, 2 };
+	ECSE_CHECK(MeshletBuilder::Build(positions, single, mesh));
+	ECSE_CHECK(mesh.Meshlets.size() == 1);
+	if (mesh.Meshlets.size() != 1) return;
+	ECSE_CHECK(mesh.Meshlets[0].VertexCount == 3 && mesh.Meshlets[0].TriangleCount == 1);
+	//	1 枚の三角形の法線は 1 本なので、コーンは開いていない（-z が表）
+	ECSE_CHECK_NEAR(mesh.Bounds[0].ConeCutoff, 0.0, 1e-6);
+	ECSE_CHECK_NEAR(mesh.Bounds[0].ConeAxis.z, -1.0, 1e-6);
+}
+
+ECSE_TEST(MeshletBuilder_SplitsDisconnectedTriangles)
+{
+	//	頂点を共有しない三角形ばかりでも上限で分ける
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < 1000; ++i)
+	{
+		const float x = static_cast<float>(i);
+		const uint32_t base = static_cast<uint32_t>(positions.size());
+		positions.push_back({ x, 0.0f, 0.0f });
+		positions.push_back({ x, 1.0f, 0.0f });
+		positions.push_back({ x + 1.0f, 0.0f, 0.0f });
+		indices.insert(indices.end(), { base, base + 1, base + 2 });
+	}
+
+	MeshletMesh mesh;
+	MeshletBuildStats stats;
+	ECSE_CHECK(MeshletBuilder::Build(positions, indices, mesh, &stats));
+	ECSE_CHECK(stats.TriangleCount == 1000);
+	uint32_t triangles = 0;
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		ECSE_CHECK(meshlet.VertexCount <= MESHLET_MAX_VERTICES);
+		triangles += meshlet.TriangleCount;
+	}
+	ECSE_CHECK(triangles == 1000);
+	//	頂点の上限（64 / 3 = 21 三角形）で切れる
+	ECSE_CHECK(mesh.Meshlets.size() == (1000 + 20) / 21);
+}
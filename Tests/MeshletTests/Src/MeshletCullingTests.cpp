@@ -0,0 +1,230 @@
+﻿/*
+* MeshletCulling のテスト
+* 乱数で置いた 40 個のカメラから球を見て、捨てたメッシュレットが本当に見えないかを三角形ごとに確かめる。
+*/
+
+#include<TestRunner.hpp>
+#include<Graphics/Culling/FrustumCulling.hpp>
+#include<Graphics/Mesh/MeshletBuilder.hpp>
+#include<Graphics/Mesh/MeshletCulling.hpp>
+#include"SphereMesh.hpp"
+
+#include<random>
+
+using namespace DirectX;
+using namespace Ecse::Graphics;
+
+namespace
+{
+	/// <summary>
+	/// 面の向きと平面の距離の誤差の許容
+	/// </summary>
+	constexpr float TOLERANCE = 1e-4f;
+
+	/// <summary>
+	/// 分割済みの球（テストの間で使い回す）
+	/// </summary>
+	struct CullingSphere
+	{
+		Ecse::Test::SphereMesh Sphere;
+		MeshletMesh Mesh;
+	};
+
+	const CullingSphere& GetCullingSphere()
+	{
+		static const CullingSphere sphere = []()
+			{
+				CullingSphere result;
+				result.Sphere = Ecse::Test::MakeSphere(512, 257);
+				MeshletBuilder::Build(result.Sphere.Positions, result.Sphere.Indices, result.Mesh);
+				return result;
+			}();
+		return sphere;
+	}
+
+	/// <summary>
+	/// 1 つのカメラで捨てたものを調べた結果
+	/// </summary>
+	struct CullCheck
+	{
+		uint32_t FrustumCulled = 0;
+		uint32_t ConeCulled = 0;
+		uint32_t FalseFrustumCulls = 0;
+		uint32_t FalseConeCulls = 0;
+	};
+
+	/// <summary>
+	/// 捨てたメッシュレットをワールド空間の頂点で確かめる
+	/// 視錐台で捨てたものは全頂点が同じ平面の外、コーンで捨てたものは全三角形がカメラに裏を向けていなければならない。
+	/// </summary>
+	CullCheck CheckCulling(const CullingSphere& Sphere, const XMFLOAT4X4& World, const Frustum& WorldFrustum, const XMFLOAT3& CameraPosition)
+	{
+		const MeshletMesh& mesh = Sphere.Mesh;
+		const MeshletCullConstants constants = MeshletCulling::MakeConstants(World, WorldFrustum, CameraPosition, static_cast<uint32_t>(mesh.Meshlets.size()));
+		const XMMATRIX world = XMLoadFloat4x4(&World);
+		const XMVECTOR camera = XMLoadFloat3(&CameraPosition);
+
+		CullCheck check;
+		std::vector<XMVECTOR> worldVertices;
+		for (size_t i = 0; i < mesh.Meshlets.size(); ++i)
+		{
+			const Meshlet& meshlet = mesh.Meshlets[i];
+			const MeshletBounds& bounds = mesh.Bounds[i];
+			const bool isFrustumCulled = MeshletCulling::IsInsideFrustum(bounds, constants) == false;
+			const bool isConeCulled = isFrustumCulled == false && MeshletCulling::IsBackFacing(bounds, constants);
+			if (isFrustumCulled == false && isConeCulled == false) continue;
+
+			worldVertices.clear();
+			for (uint32_t v = 0; v < meshlet.VertexCount; ++v)
+			{
+				const XMVECTOR local = XMLoadFloat3(&Sphere.Sphere.Positions[mesh.Vertices[meshlet.VertexOffset + v]]);
+				worldVertices.push_back(XMVector3TransformCoord(local, world));
+			}
+
+			if (isFrustumCulled)
+			{
+				check.FrustumCulled++;
+				bool isSeparated = false;
+				for (const XMFLOAT4& plane : WorldFrustum.Planes)
+				{
+					const XMVECTOR normal = XMVectorSet(plane.x, plane.y, plane.z, 0.0f);
+					bool isAllOutside = true;
+					for (const XMVECTOR& p : worldVertices)
+					{
+						if (XMVectorGetX(XMVector3Dot(normal, p)) + plane.w > TOLERANCE)
+						{
+							isAllOutside = false;
+							break;
+						}
+					}
+					if (isAllOutside)
+					{
+						isSeparated = true;
+						break;
+					}
+				}
+				check.FalseFrustumCulls += isSeparated ? 0 : 1;
+				continue;
+			}
+
+			check.ConeCulled++;
+			for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+			{
+				const uint32_t packed = mesh.Triangles[meshlet.TriangleOffset + t];
+				const XMVECTOR a = worldVertices[MeshletMesh::UnpackTriangle(packed, 0)];
+				const XMVECTOR b = worldVertices[MeshletMesh::UnpackTriangle(packed, 1)];
+				const XMVECTOR c = worldVertices[MeshletMesh::UnpackTriangle(packed, 2)];
+				const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+				const float length = XMVectorGetX(XMVector3Length(normal));
+				if (length <= 1e-12f) continue;
+
+				//	時計回りが表なので、法線の側にカメラがあれば見えている
+				const float facing = XMVectorGetX(XMVector3Dot(XMVectorScale(normal, 1.0f / length), XMVectorSubtract(camera, a)));
+				if (facing > TOLERANCE)
+				{
+					check.FalseConeCulls++;
+					break;
+				}
+			}
+		}
+		return check;
+	}
+}
+
+ECSE_TEST(MeshletCulling_RandomCamerasHaveNoFalseCulls)
+{
+	const CullingSphere& sphere = GetCullingSphere();
+	ECSE_CHECK(sphere.Mesh.Meshlets.empty() == false);
+
+	std::mt19937 random(20261019);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> distance(1.6f, 6.0f);
+	std::uniform_real_distribution<float> fov(20.0f, 80.0f);
+
+	constexpr uint32_t CAMERA_COUNT = 40;
+	CullCheck total;
+	for (uint32_t i = 0; i < CAMERA_COUNT; ++i)
+	{
+		//	半分は拡大縮小と回転と移動の入ったワールド行列で見る
+		XMMATRIX world = XMMatrixIdentity();
+		if (i % 2 == 1)
+		{
+			world = XMMatrixMultiply(XMMatrixMultiply(XMMatrixScaling(1.5f, 2.0f, 0.75f), XMMatrixRotationY(0.7f * static_cast<float>(i))), XMMatrixTranslation(3.0f, -1.0f, 5.0f));
+		}
+		const XMVECTOR origin = XMVector3TransformCoord(XMVectorZero(), world);
+
+		//	球の外から、中心の近くを狙う
+		XMVECTOR direction = XMVectorZero();
+		while (XMVectorGetX(XMVector3Length(direction)) < 0.1f)
+		{
+			direction = XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+		}
+		const float scale = (i % 2 == 1) ? 2.0f : 1.0f;
+		const XMVECTOR eye = XMVectorAdd(origin, XMVectorScale(XMVector3Normalize(direction), distance(random) * scale));
+		const XMVECTOR target = XMVectorAdd(origin, XMVectorSet(unit(random) * 0.5f, unit(random) * 0.5f, unit(random) * 0.5f, 0.0f));
+		const XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		//	遠クリップも球に掛かるように短めにする
+		const float farZ = (i % 4 == 0) ? distance(random) * scale : 100.0f;
+		const XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(fov(random)), 16.0f / 9.0f, 0.1f, farZ);
+
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		XMFLOAT4X4 worldMatrix;
+		XMStoreFloat4x4(&worldMatrix, world);
+		XMFLOAT3 cameraPosition;
+		XMStoreFloat3(&cameraPosition, eye);
+
+		const CullCheck check = CheckCulling(sphere, worldMatrix, Frustum::FromViewProjection(viewProjection), cameraPosition);
+		total.FrustumCulled += check.FrustumCulled;
+		total.ConeCulled += check.ConeCulled;
+		total.FalseFrustumCulls += check.FalseFrustumCulls;
+		total.FalseConeCulls += check.FalseConeCulls;
+	}
+
+	std::printf("  %u cameras x %zu meshlets: frustum culled %u, cone culled %u\n",
+		CAMERA_COUNT, sphere.Mesh.Meshlets.size(), total.FrustumCulled, total.ConeCulled);
+	ECSE_CHECK(total.FalseFrustumCulls == 0);
+	ECSE_CHECK(total.FalseConeCulls == 0);
+	//	どちらの判定も実際に働いている
+	ECSE_CHECK(total.FrustumCulled > 0);
+	ECSE_CHECK(total.ConeCulled > 0);
+}
+
+ECSE_TEST(MeshletCulling_MirroredWorldDisablesCone)
+{
+	const CullingSphere& sphere = GetCullingSphere();
+	const Frustum frustum = Frustum::FromViewProjection([]()
+		{
+			XMFLOAT4X4 viewProjection;
+			const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -4.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 1.0f, 0.1f, 100.0f)));
+			return viewProjection;
+		}());
+	const XMFLOAT3 camera(0.0f, 0.0f, -4.0f);
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	XMFLOAT4X4 mirrored;
+	XMStoreFloat4x4(&mirrored, XMMatrixScaling(-1.0f, 1.0f, 1.0f));
+
+	const uint32_t count = static_cast<uint32_t>(sphere.Mesh.Meshlets.size());
+	const MeshletCullConstants normal = MeshletCulling::MakeConstants(identity, frustum, camera, count);
+	const MeshletCullConstants flipped = MeshletCulling::MakeConstants(mirrored, frustum, camera, count);
+	ECSE_CHECK((normal.Flags & MESHLET_CULL_FLAG_CONE) != 0);
+	ECSE_CHECK((flipped.Flags & MESHLET_CULL_FLAG_CONE) == 0);
+	ECSE_CHECK((flipped.Flags & MESHLET_CULL_FLAG_FRUSTUM) != 0);
+
+	//	正面から見ると奥の半分はコーンで捨てられる
+	std::vector<uint32_t> visible;
+	const uint32_t visibleCount = MeshletCulling::Cull(sphere.Mesh.Bounds, normal, visible);
+	ECSE_CHECK(visibleCount < count * 3 / 4);
+	ECSE_CHECK(visibleCount > count / 4);
+	ECSE_CHECK(MeshletCulling::Cull(sphere.Mesh.Bounds, flipped, visible) == count);
+
+	//	MeshletCount より後ろは見ない
+	MeshletCullConstants partial = normal;
+	partial.MeshletCount = 10;
+	partial.Flags = 0;
+	ECSE_CHECK(MeshletCulling::Cull(sphere.Mesh.Bounds, partial, visible) == 10);
+	ECSE_CHECK(visible.size() == 10 && visible.back() == 9);
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+/*
+* テスト用の UV 球
+* 三角形は時計回りが表（MeshletBuilder と同じ）で、表の法線は外を向く。
+*/
+
+#include<DirectXMath.h>
+#include<cmath>
+#include<cstdint>
+#include<vector>
+
+namespace Ecse::Test
+{
+	/// <summary>
+	/// 頂点とインデックス
+	/// </summary>
+	struct SphereMesh
+	{
+		std::vector<DirectX::XMFLOAT3> Positions;
+		std::vector<uint32_t> Indices;
+	};
+
+	/// <summary>
+	/// 半径 1 の UV 球を作る（三角形は 2 * Slices * (Stacks - 1) 個）
+	/// </summary>
+	/// <param name="Slices">経度の分割数</param>
+	/// <param name="Stacks">緯度の分割数（2 以上）</param>
+	inline SphereMesh MakeSphere(uint32_t Slices, uint32_t Stacks)
+	{
+		constexpr float PI = 3.14159265358979f;
+		SphereMesh mesh;
+
+		//	北極、間の輪を上から順に、南極
+		mesh.Positions.push_back(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+		for (uint32_t stack = 1; stack < Stacks; ++stack)
+		{
+			const float theta = PI * static_cast<float>(stack) / static_cast<float>(Stacks);
+			for (uint32_t slice = 0; slice < Slices; ++slice)
+			{
+				const float phi = 2.0f * PI * static_cast<float>(slice) / static_cast<float>(Slices);
+				mesh.Positions.push_back(DirectX::XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+			}
+		}
+		const uint32_t south = static_cast<uint32_t>(mesh.Positions.size());
+		mesh.Positions.push_back(DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f));
+
+		auto ring = [Slices](uint32_t Stack, uint32_t Slice) { return 1 + (Stack - 1) * Slices + Slice % Slices; };
+		auto push = [&mesh](uint32_t A, uint32_t B, uint32_t C)
+			{
+				mesh.Indices.push_back(A);
+				mesh.Indices.push_back(B);
+				mesh.Indices.push_back(C);
+			};
+
+		for (uint32_t slice = 0; slice < Slices; ++slice)
+		{
+			push(0, ring(1, slice + 1), ring(1, slice));
+		}
+		for (uint32_t stack = 1; stack + 1 < Stacks; ++stack)
+		{
+			for (uint32_t slice = 0; slice < Slices; ++slice)
+			{
+				const uint32_t upper0 = ring(stack, slice);
+				const uint32_t upper1 = ring(stack, slice + 1);
+				const uint32_t lower0 = ring(stack + 1, slice);
+				const uint32_t lower1 = ring(stack + 1, slice + 1);
+				push(upper0, upper1, lower0);
+				push(upper1, lower1, lower0);
+			}
+		}
+		for (uint32_t slice = 0; slice < Slices; ++slice)
+		{
+			push(ring(Stacks - 1, slice), ring(Stacks - 1, slice + 1), south);
+		}
+		return mesh;
+	}
+}
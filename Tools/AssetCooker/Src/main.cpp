@@ -0,0 +1,1934 @@
+﻿/*
+* 素材をエンジンが実行時にそのまま読める形に焼くツール
+*
+* AssetCooker mesh <入力.obj> <出力.emesh> [--no-optimize] [--quantize]
+* AssetCooker texture <入力> <出力.dds> [--bc1|--bc3|--bc4|--bc5|--bc7] [--linear] [--no-mips] [--portable] [--cache=<フォルダ>|--no-cache]
+* AssetCooker pack <入力フォルダ> <出力.epak> [--store]
+* AssetCooker bench-pack <入力.epak> [--loose=<フォルダ>]
+* AssetCooker bench-mesh <入力.emesh> [--repeat=<数>]
+* AssetCooker bench-io <入力フォルダ> [--threads] [--depth=<数>]
+* AssetCooker bench-jobs [--workers=<数>] [--count=<数>]
+* AssetCooker bench-waits [--workers=<数>] [--chains=<数>] [--latency=<ミリ秒>]
+* AssetCooker bench-pipeline [--frames=<数>] [--game=<ミリ秒>] [--render=<ミリ秒>] [--jitter=<%>]
+* AssetCooker bench-systems [--workers=<数>] [--entities=<数>]
+* AssetCooker bench-meshlets [--obj=<入力.obj>] [--cameras=<数>]
+* AssetCooker bench-cull [--count=<数>] [--shape=sphere|aabb]
+* AssetCooker bench-occlusion [--count=<数>] [--occluders=<数>]
+* AssetCooker bench-bvh [--count=<数>] [--queries=<数>] [--rays=<数>]
+* AssetCooker bench-drawqueue [--count=<数>]
+*/
+
+#include<System/Service/ServiceLocator.hpp>
+#include<System/Log/Logger.hpp>
+#include<System/IO/AsyncFileIO.hpp>
+#include<System/IO/DerivedDataCache.hpp>
+#include<System/IO/PackArchive.hpp>
+#include<System/IO/PackWriter.hpp>
+#include<System/Thread/JobSystem.hpp>
+#include<System/Thread/RenderThread.hpp>
+#include<ECS/System/SystemScheduler.hpp>
+#include<Graphics/Mesh/MeshAsset.hpp>
+#include<Graphics/Culling/DynamicBvh.hpp>
+#include<Graphics/Culling/FrustumCulling.hpp>
+#include<Graphics/Culling/OcclusionBuffer.hpp>
+#include<Graphics/Culling/StaticBvh.hpp>
+#include<Graphics/Mesh/MeshAssetCooker.hpp>
+#include<Graphics/Mesh/MeshletBuilder.hpp>
+#include<Graphics/Mesh/MeshletCulling.hpp>
+#include<Graphics/Mesh/ObjImporter.hpp>
+#include<Graphics/Render/DrawQueue.hpp>
+#include<Graphics/Render/InstanceBatcher.hpp>
+#include<Graphics/Render/RenderProxyBuffer.hpp>
+#include<Graphics/Texture/TextureCooker.hpp>
+
+#include<algorithm>
+#include<array>
+#include<chrono>
+#include<cfloat>
+#include<cmath>
+#include<condition_variable>
+#include<cstdio>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<functional>
+#include<iterator>
+#include<memory>
+#include<mutex>
+#include<random>
+#include<string>
+#include<string_view>
+#include<thread>
+#include<vector>
+
+namespace
+{
+	using namespace Ecse;
+
+	/// <summary>
+	/// コマンド1つ分
+	/// </summary>
+	struct CookCommand
+	{
+		//	名前（第1引数）
+		std::string_view Name;
+		//	使い方
+		std::string_view Usage;
+		//	受け取る引数の数（"--" で始まるオプションは数えない）
+		size_t ArgumentCount;
+		//	本体（0:成功）
+		std::function<int(const std::vector<std::string_view>&, const std::vector<std::string_view>&)> Run;
+	};
+
+	/// <summary>
+	/// OBJ をメッシュレット付きの .emesh に焼く
+	/// --no-optimize : 三角形と頂点を並べ替えない
+	/// --quantize    : 位置を 16bit、法線を八面体の 16bit x 2 にする
+	/// </summary>
+	int CookMesh(const std::vector<std::string_view>& Arguments, const std::vector<std::string_view>& Options)
+	{
+		const std::filesystem::path input(Arguments[0]);
+		const std::filesystem::path output(Arguments[1]);
+
+		Graphics::MeshCookSettings settings;
+		for (const std::string_view option : Options)
+		{
+			if (option == "--no-optimize")
+			{
+				settings.OptimizeVertexCache = false;
+				settings.OptimizeOverdraw = false;
+				settings.OptimizeVertexFetch = false;
+			}
+			else if (option == "--quantize")
+			{
+				settings.Flags |= Graphics::MESH_ASSET_FLAG_QUANTIZED_POSITION | Graphics::MESH_ASSET_FLAG_QUANTIZED_NORMAL;
+			}
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		Graphics::MeshAssetData data;
+		if (Graphics::ObjImporter::Load(input, data) == false)
+		{
+			std::fprintf(stderr, "failed to load %s\n", input.string().c_str());
+			return 1;
+		}
+
+		Graphics::MeshCookStats stats;
+		if (Graphics::MeshAssetCooker::Write(output, data, settings, &stats) == false)
+		{
+			std::fprintf(stderr, "failed to cook %s\n", output.string().c_str());
+			return 1;
+		}
+
+		std::printf("%s: vertices=%u triangles=%u meshlets=%u size=%llu bytes (%.1f ms)\n",
+			output.string().c_str(), stats.VertexCount, stats.TriangleCount, stats.MeshletCount,
+			static_cast<unsigned long long>(stats.FileSize), stats.ElapsedMs);
+		std::printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			stats.Before.Acmr, stats.After.Acmr, stats.Before.Atvr, stats.After.Atvr);
+		return 0;
+	}
+
+	/// <summary>
+	/// 画像をミップ付きのブロック圧縮の DDS に焼く
+	/// --bc1 / --bc3 / --bc4 / --bc5 / --bc7 : 形式（既定は BC7）
+	/// --linear      : sRGB として扱わない（マスクなど）
+	/// --no-mips     : ミップを作らない
+	/// --portable    : DirectXTex があっても BlockCompressor で圧縮する
+	/// --cache=<dir> : 派生データのキャッシュの場所（既定は DerivedDataCache）
+	/// --no-cache    : キャッシュを使わない
+	/// </summary>
+	int CookTexture(const std::vector<std::string_view>& Arguments, const std::vector<std::string_view>& Options)
+	{
+		const std::filesystem::path input(Arguments[0]);
+		const std::filesystem::path output(Arguments[1]);
+
+		Graphics::TextureCookSettings settings;
+		std::filesystem::path cacheRoot = "DerivedDataCache";
+		bool useCache = true;
+		for (const std::string_view option : Options)
+		{
+			if (option == "--bc1") settings.Format = Graphics::EBlockFormat::BC1;
+			else if (option == "--bc3") settings.Format = Graphics::EBlockFormat::BC3;
+			else if (option == "--bc4") settings.Format = Graphics::EBlockFormat::BC4;
+			else if (option == "--bc5") settings.Format = Graphics::EBlockFormat::BC5;
+			else if (option == "--bc7") settings.Format = Graphics::EBlockFormat::BC7;
+			else if (option == "--linear") settings.Srgb = false;
+			else if (option == "--no-mips") settings.GenerateMips = false;
+			else if (option == "--portable") settings.Encoder = Graphics::ETextureEncoder::Portable;
+			else if (option == "--no-cache") useCache = false;
+			else if (option.starts_with("--cache=")) cacheRoot = std::filesystem::path(option.substr(8));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		std::unique_ptr<System::DerivedDataCache> cache;
+		if (useCache) cache = std::make_unique<System::DerivedDataCache>(cacheRoot);
+
+		Graphics::TextureCookStats stats;
+		if (Graphics::TextureCooker::Write(input, output, settings, cache.get(), &stats) == false)
+		{
+			std::fprintf(stderr, "failed to cook %s\n", input.string().c_str());
+			return 1;
+		}
+
+		std::printf("%s: %ux%u mips=%u size=%llu -> %llu bytes%s%s (%.1f ms)\n",
+			output.string().c_str(), stats.Width, stats.Height, stats.MipCount,
+			static_cast<unsigned long long>(stats.SourceSize), static_cast<unsigned long long>(stats.FileSize),
+			stats.CacheHit ? " [cache]" : "", stats.UsedPortableEncoder ? " [portable]" : "", stats.ElapsedMs);
+		if (stats.CacheKey.empty() == false)
+		{
+			std::printf("  key %s\n", stats.CacheKey.c_str());
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// フォルダの下を全て1つのパックファイルにまとめる
+	/// --store : 圧縮しない
+	/// </summary>
+	int Pack(const std::vector<std::string_view>& Arguments, const std::vector<std::string_view>& Options)
+	{
+		const std::filesystem::path input(Arguments[0]);
+		const std::filesystem::path output(Arguments[1]);
+
+		System::PackWriter writer;
+		for (const std::string_view option : Options)
+		{
+			if (option == "--store") writer.SetCompression(false);
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		if (writer.AddDirectory(input) == 0)
+		{
+			std::fprintf(stderr, "no files in %s\n", input.string().c_str());
+			return 1;
+		}
+
+		System::PackWriteStats stats;
+		if (writer.Write(output, &stats) == false)
+		{
+			std::fprintf(stderr, "failed to pack %s\n", output.string().c_str());
+			return 1;
+		}
+
+		std::printf("%s: files=%u chunks=%u (stored %u) size=%llu -> %llu bytes (%.1f%%, %.1f ms)\n",
+			output.string().c_str(), stats.EntryCount, stats.ChunkCount, stats.StoredChunkCount,
+			static_cast<unsigned long long>(stats.SourceSize), static_cast<unsigned long long>(stats.FileSize),
+			stats.SourceSize > 0 ? 100.0 * static_cast<double>(stats.FileSize) / static_cast<double>(stats.SourceSize) : 0.0, stats.ElapsedMs);
+		return 0;
+	}
+
+	/// <summary>
+	/// パックファイルの読み込みの速さを測る（OS のキャッシュに載った状態で、1回空読みしてから測る）
+	/// --loose=<dir> : 同じファイルをバラのまま読んだ場合と比べる（pack に渡したフォルダ）
+	/// </summary>
+	int BenchPack(const std::vector<std::string_view>& Arguments, const std::vector<std::string_view>& Options)
+	{
+		const std::filesystem::path input(Arguments[0]);
+
+		std::filesystem::path loose;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--loose=")) loose = std::filesystem::path(option.substr(8));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		const auto measure = [](const char* Label, uint64_t Bytes, const std::function<bool()>& Func)
+			{
+				if (Func() == false) return false;
+				const auto start = std::chrono::steady_clock::now();
+				if (Func() == false) return false;
+				const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				std::printf("  %-10s %9.1f ms %9.1f MB/s\n", Label, ms, static_cast<double>(Bytes) / (1024.0 * 1024.0) / (ms / 1000.0));
+				return true;
+			};
+
+		//	開く時間は目次を割り当てて確かめる分だけ
+		const auto openStart = std::chrono::steady_clock::now();
+		System::PackArchive archive;
+		if (archive.Open(input) == false)
+		{
+			std::fprintf(stderr, "failed to open %s\n", input.string().c_str());
+			return 1;
+		}
+		const double openMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - openStart).count();
+
+		const std::span<const System::PackEntry> entries = archive.GetEntries();
+		std::vector<std::vector<uint8_t>> buffers(entries.size());
+		std::vector<const System::PackEntry*> pointers(entries.size());
+		std::vector<std::span<uint8_t>> outs(entries.size());
+		uint64_t totalSize = 0;
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			buffers[i].resize(static_cast<size_t>(entries[i].Size));
+			pointers[i] = &entries[i];
+			outs[i] = buffers[i];
+			totalSize += entries[i].Size;
+		}
+
+		std::printf("%s: files=%zu size=%llu bytes, open %.2f ms\n",
+			input.string().c_str(), entries.size(), static_cast<unsigned long long>(totalSize), openMs);
+
+		//	1つずつ（大きなファイルはチャンクを並列に展開する）
+		const bool readOk = measure("read", totalSize, [&]()
+			{
+				for (size_t i = 0; i < entries.size(); ++i)
+				{
+					if (archive.Read(entries[i], buffers[i]) == false) return false;
+				}
+				return true;
+			});
+		//	全てのチャンクをまとめて並列に展開する
+		const bool batchOk = measure("batch", totalSize, [&]() { return archive.ReadBatch(pointers, outs); });
+		if (readOk == false || batchOk == false)
+		{
+			std::fprintf(stderr, "failed to read %s\n", input.string().c_str());
+			return 1;
+		}
+
+		//	同じファイルをバラで開いて読む
+		if (loose.empty() == false)
+		{
+			std::vector<uint8_t> buffer;
+			const bool looseOk = measure("loose", totalSize, [&]()
+				{
+					for (const System::PackEntry& entry : entries)
+					{
+						std::ifstream file(loose / std::filesystem::path(archive.GetPath(entry)), std::ios::binary);
+						if (file.is_open() == false) return false;
+						buffer.resize(static_cast<size_t>(entry.Size));
+						if (entry.Size > 0 && file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(entry.Size)).good() == false) return false;
+					}
+					return true;
+				});
+			if (looseOk == false)
+			{
+				std::fprintf(stderr, "failed to read loose files in %s\n", loose.string().c_str());
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// 焼いたメッシュを読んでアップロード用のメモリへ送るまでの速さを、MeshAsset で割り当てた場合と ifstream で読んだ場合で比べる
+	/// どちらも中身を確かめてから、全てのストリームをまとめた範囲を1回コピーする。
+	/// OS のキャッシュに載った状態で、1回空読みしてから測る。
+	/// --repeat=<数> : 繰り返す回数（既定は 20）
+	/// </summary>
+	int BenchMesh(const std::vector<std::string_view>& Arguments, const std::vector<std::string_view>& Options)
+	{
+		const std::filesystem::path input(Arguments[0]);
+
+		uint32_t repeat = 20;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--repeat=")) repeat = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(9)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		Graphics::MeshAsset asset;
+		if (asset.Open(input) == false)
+		{
+			std::fprintf(stderr, "failed to open %s\n", input.string().c_str());
+			return 1;
+		}
+		const Graphics::MeshAssetHeader header = asset.GetHeader();
+		asset.Release();
+
+		//	アップロード用のメモリの代わり
+		std::vector<uint8_t> staging(static_cast<size_t>(header.DataSize));
+		const auto measure = [&](const char* Label, const std::function<bool()>& Func)
+			{
+				if (Func() == false) return false;
+				const auto start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < repeat; ++i)
+				{
+					if (Func() == false) return false;
+				}
+				const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeat;
+				std::printf("  %-10s %9.3f ms %9.1f MB/s\n", Label, ms, static_cast<double>(header.FileSize) / (1024.0 * 1024.0) / (ms / 1000.0));
+				return true;
+			};
+
+		std::printf("%s: vertices=%u indices=%u meshlets=%u size=%llu bytes (data %llu)\n",
+			input.string().c_str(), header.VertexCount, header.IndexCount, header.MeshletCount,
+			static_cast<unsigned long long>(header.FileSize), static_cast<unsigned long long>(header.DataSize));
+
+		//	割り当て + 確かめる + コピー
+		const bool mappedOk = measure("mapped", [&]()
+			{
+				Graphics::MeshAsset mapped;
+				if (mapped.Open(input) == false) return false;
+				const std::span<const uint8_t> data = mapped.GetData();
+				if (data.size() != staging.size()) return false;
+				std::memcpy(staging.data(), data.data(), data.size());
+				return true;
+			});
+
+		//	読み込み用のバッファへ読む + 確かめる + コピー
+		std::vector<uint8_t> buffer;
+		const bool streamOk = measure("ifstream", [&]()
+			{
+				std::ifstream file(input, std::ios::binary);
+				if (file.is_open() == false) return false;
+				buffer.resize(static_cast<size_t>(header.FileSize));
+				if (file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())).good() == false) return false;
+				if (Graphics::MeshAsset::Validate(buffer) == false) return false;
+				std::memcpy(staging.data(), buffer.data() + header.DataOffset, staging.size());
+				return true;
+			});
+
+		if (mappedOk == false || streamOk == false)
+		{
+			std::fprintf(stderr, "failed to read %s\n", input.string().c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// 読み込み時間の分布を表示する
+	/// </summary>
+	void PrintLatency(const char* Label, std::vector<double> LatencyMs, uint64_t Bytes, double ElapsedMs)
+	{
+		std::sort(LatencyMs.begin(), LatencyMs.end());
+		const auto percentile = [&LatencyMs](double Rate)
+			{
+				if (LatencyMs.empty()) return 0.0;
+				return LatencyMs[std::min(LatencyMs.size() - 1, static_cast<size_t>(Rate * static_cast<double>(LatencyMs.size())))];
+			};
+		std::printf("  %-10s %9.1f ms %9.1f MB/s  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms\n",
+			Label, ElapsedMs, static_cast<double>(Bytes) / (1024.0 * 1024.0) / (ElapsedMs / 1000.0),
+			percentile(0.50), percentile(0.95), percentile(0.99), LatencyMs.empty() ? 0.0 : LatencyMs.back());
+	}
+
+	/// <summary>
+	/// フォルダの下のファイルを全て読む速さを、ifstream で1つずつ読んだ場合と AsyncFileIO でまとめて要求した場合で比べる
+	/// 読み込み時間は全てを要求した時刻から各ファイルを読み終えるまで（起動時の読み込みで待たされる時間）。
+	/// OS のキャッシュの影響を揃えるため、測る前に1回空読みする。
+	/// --threads     : io_uring / IOCP を使わずに専用スレッドで読む
+	/// --depth=<数>  : OS に同時に渡す数（既定は AsyncFileIO::DEFAULT_QUEUE_DEPTH）
+	/// </summary>
+	int BenchIO(const std::vector<std::string_view>& Arguments, const std::vector<std::string_view>& Options)
+	{
+		const std::filesystem::path input(Arguments[0]);
+
+		System::EAsyncIOBackend backend = System::EAsyncIOBackend::Auto;
+		uint32_t depth = System::AsyncFileIO::DEFAULT_QUEUE_DEPTH;
+		for (const std::string_view option : Options)
+		{
+			if (option == "--threads") backend = System::EAsyncIOBackend::Threads;
+			else if (option.starts_with("--depth=")) depth = static_cast<uint32_t>(std::stoul(std::string(option.substr(8))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		std::vector<std::filesystem::path> paths;
+		std::vector<std::vector<uint8_t>> buffers;
+		uint64_t totalSize = 0;
+		std::error_code error;
+		for (const auto& item : std::filesystem::recursive_directory_iterator(input, error))
+		{
+			if (item.is_regular_file() == false) continue;
+			paths.push_back(item.path());
+			buffers.emplace_back(static_cast<size_t>(item.file_size()));
+			totalSize += buffers.back().size();
+		}
+		if (paths.empty())
+		{
+			std::fprintf(stderr, "no files in %s\n", input.string().c_str());
+			return 1;
+		}
+
+		System::AsyncFileIO::Create();
+		auto* io = System::ServiceLocator::Get<System::AsyncFileIO>();
+		io->Initialize(backend, depth);
+
+		static constexpr const char* BACKEND_NAMES[] = { "auto", "io_uring", "IOCP", "threads" };
+		std::printf("%s: files=%zu size=%llu bytes, backend=%s depth=%u\n", input.string().c_str(), paths.size(),
+			static_cast<unsigned long long>(totalSize), BACKEND_NAMES[static_cast<uint32_t>(io->GetBackend())], depth);
+
+		//	ifstream で1つずつ
+		const auto readBlocking = [&](std::vector<double>* pLatency)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				for (size_t i = 0; i < paths.size(); ++i)
+				{
+					std::ifstream file(paths[i], std::ios::binary);
+					file.read(reinterpret_cast<char*>(buffers[i].data()), static_cast<std::streamsize>(buffers[i].size()));
+					if (pLatency != nullptr) pLatency->push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				}
+			};
+
+		//	全てを開いてまとめて要求する
+		std::vector<System::AsyncFileHandle> files(paths.size());
+		for (size_t i = 0; i < paths.size(); ++i) files[i] = io->OpenFile(paths[i]);
+		std::mutex latencyMutex;
+		const auto readAsync = [&](std::vector<double>* pLatency)
+			{
+				std::vector<System::AsyncReadRequest> requests(paths.size());
+				std::vector<System::AsyncReadHandle> handles(paths.size());
+				for (size_t i = 0; i < paths.size(); ++i)
+				{
+					requests[i].File = files[i];
+					requests[i].Buffer = buffers[i];
+					if (pLatency == nullptr) continue;
+					requests[i].OnComplete = [&latencyMutex, pLatency](const System::AsyncReadCompletion& Completion)
+						{
+							std::lock_guard lock(latencyMutex);
+							pLatency->push_back(Completion.LatencyMs);
+						};
+				}
+				io->ReadBatch(requests, handles);
+				io->WaitIdle();
+			};
+
+		readBlocking(nullptr);
+		std::vector<double> blockingLatency;
+		auto start = std::chrono::steady_clock::now();
+		readBlocking(&blockingLatency);
+		PrintLatency("ifstream", blockingLatency, totalSize, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+		readAsync(nullptr);
+		std::vector<double> asyncLatency;
+		start = std::chrono::steady_clock::now();
+		readAsync(&asyncLatency);
+		PrintLatency("async", asyncLatency, totalSize, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+		const System::AsyncFileIOStats stats = io->GetStats();
+		System::AsyncFileIO::Release();
+		if (stats.Failed > 0)
+		{
+			std::fprintf(stderr, "%llu reads failed\n", static_cast<unsigned long long>(stats.Failed));
+			return 1;
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// JobSystem がワーカー数に応じて速くなるかを測る（ファイルは使わない）
+	/// 重さの偏った ParallelFor を1スレッドと JobSystem で比べ、空の仕事を積む速さと依存の鎖を辿る速さも測る。
+	/// ワーカー数は 1 から倍ずつ増やし、それぞれ3回測って一番速い時間を出す。
+	/// --workers=<数> : 最大のワーカー数（既定は論理コア数-1）
+	/// --count=<数>   : ParallelFor の要素数（既定は 1<<20）
+	/// </summary>
+	int BenchJobs(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		const uint32_t hardware = std::thread::hardware_concurrency();
+		uint32_t maxWorkers = hardware > 1 ? hardware - 1 : 1;
+		uint32_t count = 1u << 20;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--workers=")) maxWorkers = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(10)))));
+			else if (option.starts_with("--count=")) count = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(8)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		//	64要素に1つだけ64倍重い（カリングで一部のメッシュだけ細かい、のような偏り）
+		std::vector<uint32_t> results(count);
+		const std::function<void(uint32_t, uint32_t)> kernel = [&results](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+				{
+					uint32_t value = i;
+					const uint32_t iterations = (i % 64 == 0) ? 64 * 64 : 64;
+					for (uint32_t k = 0; k < iterations; ++k)
+					{
+						value = value * 1664525u + 1013904223u;
+					}
+					results[i] = value;
+				}
+			};
+		const auto best = [](const std::function<void()>& Func)
+			{
+				double bestMs = 0.0;
+				for (int i = 0; i < 3; ++i)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					Func();
+					const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+					if (i == 0 || ms < bestMs) bestMs = ms;
+				}
+				return bestMs;
+			};
+		const auto checksum = [&results]()
+			{
+				uint64_t sum = 0;
+				for (const uint32_t value : results) sum += value;
+				return sum;
+			};
+
+		const double serialMs = best([&]() { kernel(0, count); });
+		const uint64_t expected = checksum();
+		std::printf("parallel-for count=%u, hardware threads=%u\n", count, hardware);
+		std::printf("  %-10s %9.2f ms\n", "serial", serialMs);
+
+		//	main で作った既定の JobSystem は止めて、ワーカー数ごとに作り直す
+		System::JobSystem::Release();
+
+		constexpr uint32_t SPAWN_COUNT = 1u << 18;
+		constexpr uint32_t CHAIN_LENGTH = 1u << 12;
+		bool isMatched = true;
+		for (uint32_t workers = 1; ; workers = std::min(workers * 2, maxWorkers))
+		{
+			System::JobSystem::Create();
+			auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+			jobs->Initialize(workers);
+
+			std::fill(results.begin(), results.end(), 0u);
+			const double forMs = best([&]() { jobs->ParallelFor(count, kernel); });
+			isMatched = isMatched && checksum() == expected;
+
+			//	空の仕事を積んで全て終わるまで
+			const double spawnMs = best([&]()
+				{
+					System::JobCounter counter;
+					for (uint32_t i = 0; i < SPAWN_COUNT; ++i)
+					{
+						jobs->Run([]() {}, &counter);
+					}
+					jobs->Wait(counter);
+				});
+
+			//	1つ前が終わってから積まれる仕事の鎖
+			const double chainMs = best([&]()
+				{
+					std::vector<System::JobCounter> counters(CHAIN_LENGTH);
+					jobs->Run([]() {}, &counters[0]);
+					for (uint32_t i = 1; i < CHAIN_LENGTH; ++i)
+					{
+						jobs->Run([]() {}, &counters[i], counters[i - 1]);
+					}
+					jobs->Wait(counters.back());
+				});
+
+			const System::JobSystemStats stats = jobs->GetStats();
+			std::printf("  %-10s %9.2f ms  x%.2f  (workers=%u)  spawn %.2f Mjobs/s  chain %.2f us/job  stolen %llu splits %llu sleeps %llu\n",
+				"jobs", forMs, serialMs / forMs, workers,
+				static_cast<double>(SPAWN_COUNT) / (spawnMs * 1000.0), chainMs * 1000.0 / CHAIN_LENGTH,
+				static_cast<unsigned long long>(stats.Stolen), static_cast<unsigned long long>(stats.Splits), static_cast<unsigned long long>(stats.Sleeps));
+			System::JobSystem::Release();
+			if (workers == maxWorkers) break;
+		}
+		if (isMatched == false)
+		{
+			std::fprintf(stderr, "jobs result mismatch\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// 決まった時間の後に完了する読み込みのふり（専用スレッドで JobSystem::Complete を呼ぶ）
+	/// </summary>
+	class SimulatedDevice
+	{
+	public:
+		explicit SimulatedDevice(System::JobSystem& Jobs)
+			:mJobs(Jobs)
+			, mIsExitRequested(false)
+		{
+			mThread = std::thread([this]() { this->ThreadMain(); });
+		}
+
+		~SimulatedDevice()
+		{
+			{
+				std::lock_guard lock(mMutex);
+				mIsExitRequested = true;
+			}
+			mCondition.notify_one();
+			mThread.join();
+		}
+
+		/// <summary>
+		/// Latency の後に Counter を1つ減らす
+		/// </summary>
+		void Submit(System::JobCounter& Counter, std::chrono::microseconds Latency)
+		{
+			mJobs.AddPending(Counter);
+			{
+				std::lock_guard lock(mMutex);
+				mRequests.push_back({ std::chrono::steady_clock::now() + Latency, &Counter });
+			}
+			mCondition.notify_one();
+		}
+
+	private:
+		struct Request
+		{
+			std::chrono::steady_clock::time_point Time;
+			System::JobCounter* pCounter;
+		};
+
+		void ThreadMain()
+		{
+			std::unique_lock lock(mMutex);
+			while (mIsExitRequested == false)
+			{
+				if (mRequests.empty() == true)
+				{
+					mCondition.wait(lock);
+					continue;
+				}
+
+				const auto first = std::min_element(mRequests.begin(), mRequests.end(), [](const Request& A, const Request& B) { return A.Time < B.Time; });
+				if (first->Time > std::chrono::steady_clock::now())
+				{
+					mCondition.wait_until(lock, first->Time);
+					continue;
+				}
+				System::JobCounter* pCounter = first->pCounter;
+				*first = mRequests.back();
+				mRequests.pop_back();
+
+				lock.unlock();
+				mJobs.Complete(*pCounter);
+				lock.lock();
+			}
+		}
+
+		System::JobSystem& mJobs;
+		std::thread mThread;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::vector<Request> mRequests;
+		bool mIsExitRequested;
+	};
+
+	/// <summary>
+	/// 読み込み → 展開 → 転送 → 設定 のように、段ごとに読み込みを待つ鎖をたくさん流す速さを、待ち方ごとに比べる
+	/// blocking : ワーカーのまま完了まで眠って待つ（他の仕事は動かない。子を積んで待つと全員が親で眠って止まるので、子はその場で呼ぶ）
+	/// helping  : EJobExecution::Thread の Wait（待っている間に他の仕事をスタックに積んで動かす）
+	/// fibers   : EJobExecution::Fiber の Wait（ファイバーを止めてワーカーを空ける）
+	/// 各段は子の仕事を積んで待ち、子は少し計算してから読み込みを要求して待つ。
+	/// --workers=<数>      : ワーカー数（既定は論理コア数-1）
+	/// --chains=<数>       : 同時に流す鎖の数（既定は 256）
+	/// --latency=<ミリ秒>  : 読み込み1回の時間（既定は 1）
+	/// </summary>
+	int BenchWaits(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t workers = 0;
+		uint32_t chainCount = 256;
+		uint32_t latencyMs = 1;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--workers=")) workers = static_cast<uint32_t>(std::stoul(std::string(option.substr(10))));
+			else if (option.starts_with("--chains=")) chainCount = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(9)))));
+			else if (option.starts_with("--latency=")) latencyMs = static_cast<uint32_t>(std::stoul(std::string(option.substr(10))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		constexpr uint32_t STAGE_COUNT = 4;
+		const std::chrono::microseconds latency(latencyMs * 1000);
+		std::printf("chains=%u stages=%u latency=%u ms\n", chainCount, STAGE_COUNT, latencyMs);
+
+		struct Mode
+		{
+			const char* Name;
+			System::EJobExecution Execution;
+			bool IsBlocking;
+		};
+		static constexpr Mode MODES[] = {
+			{ "blocking", System::EJobExecution::Thread, true },
+			{ "helping", System::EJobExecution::Thread, false },
+			{ "fibers", System::EJobExecution::Fiber, false },
+		};
+		//	main で作った既定の JobSystem は止めて、待ち方ごとに作り直す
+		System::JobSystem::Release();
+		for (const Mode& mode : MODES)
+		{
+			//	鎖ごとに鎖と子の2つが同時に止まるので、その分のファイバーを作る
+			System::JobSystem::Create();
+			auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+			jobs->Initialize(workers, mode.Execution, chainCount * 2);
+
+			{
+				SimulatedDevice device(*jobs);
+				const auto wait = [&](System::JobCounter& Counter)
+					{
+						if (mode.IsBlocking == false)
+						{
+							jobs->Wait(Counter);
+							return;
+						}
+						while (Counter.IsDone() == false)
+						{
+							std::this_thread::sleep_for(std::chrono::microseconds(50));
+						}
+					};
+
+				std::vector<double> latencyMs(chainCount);
+				const auto start = std::chrono::steady_clock::now();
+				System::JobCounter chains;
+				for (uint32_t i = 0; i < chainCount; ++i)
+				{
+					jobs->Run([&, i]()
+						{
+							for (uint32_t stage = 0; stage < STAGE_COUNT; ++stage)
+							{
+								const auto step = [&]()
+									{
+										//	展開や変換の代わりの少しの計算
+										volatile uint32_t value = i;
+										for (uint32_t k = 0; k < 20000; ++k) value = value * 1664525u + 1013904223u;
+
+										System::JobCounter read;
+										device.Submit(read, latency);
+										wait(read);
+									};
+								if (mode.IsBlocking == true)
+								{
+									step();
+									continue;
+								}
+								System::JobCounter child;
+								jobs->Run(step, &child);
+								jobs->Wait(child);
+							}
+							latencyMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+						}, &chains);
+				}
+				jobs->Wait(chains);
+				const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				std::sort(latencyMs.begin(), latencyMs.end());
+				const System::JobSystemStats stats = jobs->GetStats();
+				std::printf("  %-10s %9.1f ms  p50 %.1f  max %.1f ms  (workers=%u)  suspends %llu inline %llu\n",
+					mode.Name, elapsedMs, latencyMs[latencyMs.size() / 2], latencyMs.back(), jobs->GetWorkerCount(),
+					static_cast<unsigned long long>(stats.Suspends), static_cast<unsigned long long>(stats.InlineRuns));
+			}
+			System::JobSystem::Release();
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// Ms ミリ秒の間 CPU を回し続ける（bench-pipeline の更新と記録の代わり）
+	/// </summary>
+	void SpinFor(double Ms)
+	{
+		const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(Ms));
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+	}
+
+	/// <summary>
+	/// 更新と記録を1スレッドで順に行う時と、RenderThread で1フレームずらして並べた時のフレーム時間を比べる（ウィンドウも DX12 も使わない）
+	/// Engine::RunSerial / RunPipelined と同じ形で、更新と記録の代わりに決まった時間だけ CPU を回す。
+	/// 時間はフレームごとに ±jitter% 揺らし、記録の揺れを更新の間に吸収できるかも見る。
+	/// --frames=<数>      : 計測するフレーム数（既定は 300）
+	/// --game=<ミリ秒>    : 1フレームの更新の時間（既定は 6）
+	/// --render=<ミリ秒>  : 1フレームの記録と送信の時間（既定は 5）
+	/// --jitter=<%>       : 時間の揺れ（既定は 20）
+	/// </summary>
+	int BenchPipeline(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t frameCount = 300;
+		double gameMs = 6.0;
+		double renderMs = 5.0;
+		uint32_t jitter = 20;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--frames=")) frameCount = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(9)))));
+			else if (option.starts_with("--game=")) gameMs = std::stod(std::string(option.substr(7)));
+			else if (option.starts_with("--render=")) renderMs = std::stod(std::string(option.substr(9)));
+			else if (option.starts_with("--jitter=")) jitter = std::min(100u, static_cast<uint32_t>(std::stoul(std::string(option.substr(9)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		//	両方の方式で同じ揺れになるように、フレームごとの時間を先に決めておく
+		std::mt19937 random(20261019);
+		std::uniform_real_distribution<double> scale(1.0 - jitter / 100.0, 1.0 + jitter / 100.0);
+		std::vector<double> gameLoads(frameCount);
+		std::vector<double> renderLoads(frameCount);
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			gameLoads[i] = gameMs * scale(random);
+			renderLoads[i] = renderMs * scale(random);
+		}
+		std::printf("frames=%u game=%.2f ms render=%.2f ms jitter=%u%%\n", frameCount, gameMs, renderMs, jitter);
+
+		struct FrameSums
+		{
+			double FrameMs = 0.0;
+			double GameMs = 0.0;
+			double RenderMs = 0.0;
+			double WaitMs = 0.0;
+		};
+		const auto print = [frameCount](const char* Name, const FrameSums& Sums)
+			{
+				const double count = static_cast<double>(frameCount);
+				std::printf("  %-10s frame %7.2f ms  game %6.2f  render %6.2f  wait %6.2f  (%.1f fps)\n",
+					Name, Sums.FrameMs / count, Sums.GameMs / count, Sums.RenderMs / count, Sums.WaitMs / count, 1000.0 * count / Sums.FrameMs);
+			};
+		using Clock = std::chrono::steady_clock;
+
+		//	直列：更新してから記録する
+		{
+			FrameSums sums;
+			for (uint32_t i = 0; i < frameCount; ++i)
+			{
+				const auto gameStart = Clock::now();
+				SpinFor(gameLoads[i]);
+				const auto renderStart = Clock::now();
+				SpinFor(renderLoads[i]);
+				const auto frameEnd = Clock::now();
+
+				sums.GameMs += std::chrono::duration<double, std::milli>(renderStart - gameStart).count();
+				sums.RenderMs += std::chrono::duration<double, std::milli>(frameEnd - renderStart).count();
+				sums.FrameMs += std::chrono::duration<double, std::milli>(frameEnd - gameStart).count();
+			}
+			print("serial", sums);
+		}
+
+		//	パイプライン：N フレーム目を記録している間に N+1 フレーム目を更新する
+		{
+			//	記録する側はスナップショット番号ではなくフレーム番号で時間を引く
+			std::array<uint32_t, System::FRAME_SNAPSHOT_COUNT> snapshots = {};
+			System::RenderThread renderThread;
+			if (renderThread.Start([&](uint32_t Slot) { SpinFor(renderLoads[snapshots[Slot]]); }) == false)
+			{
+				std::fprintf(stderr, "failed to start the render thread\n");
+				return 1;
+			}
+
+			FrameSums sums;
+			uint32_t writeSlot = 0;
+			for (uint32_t i = 0; i < frameCount; ++i)
+			{
+				const auto gameStart = Clock::now();
+				SpinFor(gameLoads[i]);
+				snapshots[writeSlot] = i;
+				const auto gameEnd = Clock::now();
+
+				renderThread.Kick(writeSlot);
+				writeSlot = (writeSlot + 1) % System::FRAME_SNAPSHOT_COUNT;
+
+				sums.GameMs += std::chrono::duration<double, std::milli>(gameEnd - gameStart).count();
+				sums.RenderMs += renderThread.GetLastRenderMs();
+				sums.WaitMs += renderThread.GetLastWaitMs();
+				sums.FrameMs += std::chrono::duration<double, std::milli>(Clock::now() - gameStart).count();
+			}
+			renderThread.Stop();
+			print("pipelined", sums);
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// bench-systems で使うコンポーネント（中身は計算の結果を入れるだけ）
+	/// </summary>
+	struct BenchPosition { uint32_t Value = 0; };
+	struct BenchVelocity { uint32_t Value = 1; };
+	struct BenchAi { uint32_t Value = 2; };
+	struct BenchAnimation { uint32_t Value = 3; };
+	struct BenchHealth { uint32_t Value = 4; };
+	struct BenchBounds { uint32_t Value = 5; };
+
+	/// <summary>
+	/// Iterations 回の計算で TTo を TFrom から作る（bench-systems の1システム分の仕事）
+	/// </summary>
+	template<typename TFrom, typename TTo>
+	void BenchTransform(entt::registry& Registry, uint32_t Iterations)
+	{
+		for (auto [entity, from, to] : Registry.view<const TFrom, TTo>().each())
+		{
+			uint32_t value = from.Value ^ to.Value;
+			for (uint32_t k = 0; k < Iterations; ++k) value = value * 1664525u + 1013904223u;
+			to.Value = value;
+		}
+	}
+
+	/// <summary>
+	/// SystemScheduler がシステムをどれだけ同時に動かせるかを測る（ファイルは使わない）
+	/// AI → 操舵 → 移動 → 境界 の鎖と、アニメーション・体力のような独立したシステム、それらを読む集計を並べ、
+	/// 登録順に1つずつ動かした時と並列に動かした時のフレーム時間を比べ、システムごとの時間とクリティカルパスを出す。
+	/// --workers=<数>  : ワーカー数（既定は論理コア数-1）
+	/// --entities=<数> : エンティティの数（既定は 100000）
+	/// </summary>
+	int BenchSystems(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t workers = 0;
+		uint32_t entityCount = 100000;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--workers=")) workers = static_cast<uint32_t>(std::stoul(std::string(option.substr(10))));
+			else if (option.starts_with("--entities=")) entityCount = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(11)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		entt::registry registry;
+		for (uint32_t i = 0; i < entityCount; ++i)
+		{
+			const entt::entity entity = registry.create();
+			registry.emplace<BenchPosition>(entity);
+			registry.emplace<BenchVelocity>(entity);
+			registry.emplace<BenchAnimation>(entity);
+			registry.emplace<BenchHealth>(entity);
+			registry.emplace<BenchBounds>(entity);
+			if (i % 4 == 0) registry.emplace<BenchAi>(entity);
+		}
+
+		//	main で作った既定の JobSystem は止めて、指定のワーカー数で作り直す
+		System::JobSystem::Release();
+		System::JobSystem::Create();
+		auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+		jobs->Initialize(workers);
+		ECS::SystemScheduler::Create();
+		auto* scheduler = System::ServiceLocator::Get<ECS::SystemScheduler>();
+		scheduler->Initialize(registry);
+
+		using ECS::SystemAccess;
+		scheduler->AddSystem("ai", SystemAccess().Read<BenchPosition>().Write<BenchAi>(), [](entt::registry& Registry, float) { BenchTransform<BenchPosition, BenchAi>(Registry, 256); });
+		scheduler->AddSystem("steer", SystemAccess().Read<BenchAi>().Write<BenchVelocity>(), [](entt::registry& Registry, float) { BenchTransform<BenchAi, BenchVelocity>(Registry, 64); });
+		scheduler->AddSystem("integrate", SystemAccess().Read<BenchVelocity>().Write<BenchPosition>(), [](entt::registry& Registry, float) { BenchTransform<BenchVelocity, BenchPosition>(Registry, 16); });
+		scheduler->AddSystem("bounds", SystemAccess().Read<BenchPosition>().Write<BenchBounds>(), [](entt::registry& Registry, float) { BenchTransform<BenchPosition, BenchBounds>(Registry, 32); });
+		scheduler->AddSystem("animate", SystemAccess().Read<BenchVelocity>().Write<BenchAnimation>(), [](entt::registry& Registry, float) { BenchTransform<BenchVelocity, BenchAnimation>(Registry, 96); });
+		scheduler->AddSystem("regen", SystemAccess().Read<BenchAi>().Write<BenchHealth>(), [](entt::registry& Registry, float) { BenchTransform<BenchAi, BenchHealth>(Registry, 48); });
+		scheduler->AddSystem("stats", SystemAccess().Read<BenchHealth, BenchAnimation, BenchBounds>(), [](entt::registry& Registry, float)
+			{
+				uint64_t sum = 0;
+				for (auto [entity, health, animation, bounds] : Registry.view<const BenchHealth, const BenchAnimation, const BenchBounds>().each()) sum += health.Value ^ animation.Value ^ bounds.Value;
+				volatile uint64_t sink = sum;
+				(void)sink;
+			});
+
+		constexpr int FRAME_COUNT = 20;
+		std::printf("systems=%u entities=%u workers=%u\n", scheduler->GetSystemCount(), entityCount, jobs->GetWorkerCount());
+		double serialMs = 0.0;
+		for (const bool isParallel : { false, true })
+		{
+			scheduler->SetParallel(isParallel);
+			double bestMs = 0.0;
+			for (int frame = 0; frame < FRAME_COUNT; ++frame)
+			{
+				scheduler->Update(1.0f / 60.0f);
+				const double ms = scheduler->GetStats().FrameMs;
+				if (frame == 0 || ms < bestMs) bestMs = ms;
+			}
+			if (isParallel == false) serialMs = bestMs;
+
+			const ECS::SystemSchedulerStats stats = scheduler->GetStats();
+			std::printf("  %-8s %8.2f ms  x%.2f  (last frame: total %.2f ms, critical path %.2f ms, edges %u)\n",
+				isParallel ? "parallel" : "serial", bestMs, serialMs / bestMs, stats.TotalMs, stats.CriticalPathMs, stats.Edges);
+		}
+
+		//	最後の並列のフレームの内訳（* はクリティカルパス）
+		for (ECS::SystemId id = 0; id < scheduler->GetSystemCount(); ++id)
+		{
+			const ECS::SystemTiming& timing = scheduler->GetTiming(id);
+			const std::string_view name = scheduler->GetName(id);
+			std::printf("    %-10.*s %7.2f ms  [%7.2f - %7.2f]  thread %u %s\n", static_cast<int>(name.size()), name.data(),
+				timing.Ms, timing.StartMs, timing.EndMs, timing.ThreadIndex, timing.IsOnCriticalPath ? "*" : "");
+		}
+
+		ECS::SystemScheduler::Release();
+		System::JobSystem::Release();
+		return 0;
+	}
+
+	/// <summary>
+	/// FrustumCuller::Cull の速さを命令セットごとに比べる
+	/// 1辺 1000 の立方体に乱数で AABB を置き、原点から +z を向いたカメラで判定する。
+	/// 命令セットごとに10回測って一番速い時間を出し、見えている添字が Scalar と同じかも確かめる。
+	/// --count=<数>          : 描画対象の数（既定は 1000000）
+	/// --shape=sphere|aabb : 判定に使う形（既定は両方）
+	/// </summary>
+	int BenchCull(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t count = 1000000;
+		std::vector<Graphics::ECullShape> shapes = { Graphics::ECullShape::Sphere, Graphics::ECullShape::Aabb };
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--count=")) count = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(8)))));
+			else if (option == "--shape=sphere") shapes = { Graphics::ECullShape::Sphere };
+			else if (option == "--shape=aabb") shapes = { Graphics::ECullShape::Aabb };
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		//	カリングが読むのは境界だけなので、境界とエンティティだけを詰める
+		Graphics::RenderProxyBuffer proxies;
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 5.0f);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float ex = extent(random);
+			const float ey = extent(random);
+			const float ez = extent(random);
+			proxies.Entities.push_back(static_cast<entt::entity>(i));
+			proxies.CenterX.push_back(position(random));
+			proxies.CenterY.push_back(position(random));
+			proxies.CenterZ.push_back(position(random));
+			proxies.ExtentX.push_back(ex);
+			proxies.ExtentY.push_back(ey);
+			proxies.ExtentZ.push_back(ez);
+			proxies.Radius.push_back(std::sqrt(ex * ex + ey * ey + ez * ez));
+		}
+
+		DirectX::XMFLOAT4X4 viewProjection;
+		const DirectX::XMMATRIX view = DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(view, DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f)));
+		const Graphics::Frustum frustum = Graphics::Frustum::FromViewProjection(viewProjection);
+
+		const auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+		std::printf("proxies=%u workers=%u supported=%s\n", count, jobs != nullptr ? jobs->GetWorkerCount() : 0,
+			Graphics::FrustumCuller::GetSupportedSimdPath() == Graphics::ESimdPath::Avx ? "avx" :
+			Graphics::FrustumCuller::GetSupportedSimdPath() == Graphics::ESimdPath::Sse ? "sse" : "scalar");
+
+		Graphics::FrustumCuller culler;
+		std::vector<uint32_t> expected;
+		std::vector<uint32_t> visible;
+		bool isMatching = true;
+		for (const Graphics::ECullShape shape : shapes)
+		{
+			double scalarMs = 0.0;
+			for (const auto& [label, path] : { std::pair<const char*, Graphics::ESimdPath>("scalar", Graphics::ESimdPath::Scalar),
+				std::pair<const char*, Graphics::ESimdPath>("sse", Graphics::ESimdPath::Sse), std::pair<const char*, Graphics::ESimdPath>("avx", Graphics::ESimdPath::Avx) })
+			{
+				culler.SetSimdPath(path);
+				if (culler.GetSimdPath() != path)
+				{
+					std::printf("  %-6s %-6s not supported\n", shape == Graphics::ECullShape::Sphere ? "sphere" : "aabb", label);
+					continue;
+				}
+
+				double bestMs = 0.0;
+				for (int i = 0; i < 10; ++i)
+				{
+					culler.Cull(proxies, frustum, shape, visible);
+					const double ms = culler.GetLastStats().ElapsedMs;
+					if (i == 0 || ms < bestMs) bestMs = ms;
+				}
+				if (path == Graphics::ESimdPath::Scalar)
+				{
+					expected = visible;
+					scalarMs = bestMs;
+				}
+				const bool isSame = visible == expected;
+				isMatching = isMatching && isSame;
+				std::printf("  %-6s %-6s %8.3f ms  %8.1f Mproxy/s  x%.2f  visible %u (%.1f%%)%s\n",
+					shape == Graphics::ECullShape::Sphere ? "sphere" : "aabb", label, bestMs,
+					static_cast<double>(count) / 1.0e6 / (bestMs / 1000.0), scalarMs / bestMs,
+					static_cast<uint32_t>(visible.size()), 100.0 * static_cast<double>(visible.size()) / count, isSame ? "" : "  MISMATCH");
+			}
+		}
+		return isMatching ? 0 : 1;
+	}
+
+	/// <summary>
+	/// OcclusionBuffer の遮蔽物の描画と判定の速さを AVX2 と 1 ピクセルずつで比べる
+	/// 原点から +z を向いたカメラの前に壁を並べ、乱数で置いた AABB を視錐台カリングしてから遮蔽で判定する。
+	/// それぞれ10回測って一番速い時間を出す。FMA の丸めで辺の上の物が入れ替わることはあるので、Scalar と違った数は出すだけにする。
+	/// --count=<数>     : 描画対象の数（既定は 200000）
+	/// --occluders=<数> : 壁の数（既定は 64）
+	/// </summary>
+	int BenchOcclusion(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t count = 200000;
+		uint32_t occluderCount = 64;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--count=")) count = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(8)))));
+			else if (option.starts_with("--occluders=")) occluderCount = static_cast<uint32_t>(std::stoul(std::string(option.substr(12))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		//	判定が読むのは境界と印だけなので、それだけを詰める
+		Graphics::RenderProxyBuffer proxies;
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> positionX(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> positionY(-2.0f, 10.0f);
+		std::uniform_real_distribution<float> positionZ(5.0f, 300.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 3.0f);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float ex = extent(random);
+			const float ey = extent(random);
+			const float ez = extent(random);
+			proxies.Entities.push_back(static_cast<entt::entity>(i));
+			proxies.CenterX.push_back(positionX(random));
+			proxies.CenterY.push_back(positionY(random));
+			proxies.CenterZ.push_back(positionZ(random));
+			proxies.ExtentX.push_back(ex);
+			proxies.ExtentY.push_back(ey);
+			proxies.ExtentZ.push_back(ez);
+			proxies.Radius.push_back(std::sqrt(ex * ex + ey * ey + ez * ez));
+			proxies.Flags.push_back(0);
+		}
+
+		//	街並みのように、手前から奥までカメラに向いた壁を並べる
+		std::uniform_real_distribution<float> wallX(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> wallZ(15.0f, 150.0f);
+		std::uniform_real_distribution<float> wallWidth(6.0f, 14.0f);
+		std::vector<std::pair<DirectX::XMFLOAT3, DirectX::XMFLOAT3>> walls(occluderCount);
+		for (auto& [center, extents] : walls)
+		{
+			center = DirectX::XMFLOAT3(wallX(random), 4.0f, wallZ(random));
+			extents = DirectX::XMFLOAT3(wallWidth(random), 6.0f, 0.5f);
+		}
+
+		DirectX::XMFLOAT4X4 viewProjection;
+		const DirectX::XMMATRIX view = DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(view, DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f)));
+		DirectX::XMFLOAT4X4 identity;
+		DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+
+		Graphics::FrustumCuller culler;
+		std::vector<uint32_t> inFrustum;
+		culler.Cull(proxies, Graphics::Frustum::FromViewProjection(viewProjection), Graphics::ECullShape::Aabb, inFrustum);
+
+		Graphics::OcclusionBuffer buffer;
+		buffer.SetUseSimd(true);
+		const auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+		std::printf("proxies=%u occluders=%u in-frustum=%u buffer=%ux%u workers=%u supported=%s\n", count, occluderCount,
+			static_cast<uint32_t>(inFrustum.size()), buffer.GetWidth(), buffer.GetHeight(), jobs != nullptr ? jobs->GetWorkerCount() : 0,
+			buffer.IsUsingSimd() ? "avx2" : "scalar");
+
+		std::vector<uint32_t> expected;
+		std::vector<uint32_t> visible;
+		double scalarMs = 0.0;
+		for (const auto& [label, useSimd] : { std::pair<const char*, bool>("scalar", false), std::pair<const char*, bool>("avx2", true) })
+		{
+			buffer.SetUseSimd(useSimd);
+			if (buffer.IsUsingSimd() != useSimd)
+			{
+				std::printf("  %-6s not supported\n", label);
+				continue;
+			}
+
+			double bestRasterizeMs = 0.0;
+			double bestTestMs = 0.0;
+			for (int i = 0; i < 10; ++i)
+			{
+				buffer.BeginFrame(viewProjection);
+				for (const auto& [center, extents] : walls)
+				{
+					buffer.AddOccluderBox(identity, center, extents);
+				}
+				buffer.Rasterize();
+				visible = inFrustum;
+				buffer.Cull(proxies, visible);
+				const Graphics::OcclusionStats& stats = buffer.GetLastStats();
+				if (i == 0 || stats.RasterizeMs < bestRasterizeMs) bestRasterizeMs = stats.RasterizeMs;
+				if (i == 0 || stats.TestMs < bestTestMs) bestTestMs = stats.TestMs;
+			}
+
+			const double totalMs = bestRasterizeMs + bestTestMs;
+			if (useSimd == false)
+			{
+				expected = visible;
+				scalarMs = totalMs;
+			}
+
+			//	順序は保たれるので、並びを比べて違った数を数える
+			std::vector<uint32_t> differ;
+			std::set_symmetric_difference(expected.begin(), expected.end(), visible.begin(), visible.end(), std::back_inserter(differ));
+			const Graphics::OcclusionStats& stats = buffer.GetLastStats();
+			std::printf("  %-6s rasterize %8.3f ms (%u tris)  test %8.3f ms  %8.1f Mbox/s  x%.2f  hidden %u of %u (%.1f%%)  differ %u\n",
+				label, bestRasterizeMs, stats.OccluderTriangles, bestTestMs,
+				static_cast<double>(stats.Tested) / 1.0e6 / (bestTestMs / 1000.0), scalarMs / totalMs,
+				stats.Occluded, stats.Tested, stats.Tested > 0 ? 100.0 * stats.Occluded / stats.Tested : 0.0, static_cast<uint32_t>(differ.size()));
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// 総当たりで集めた添字が全て BVH の結果に入っているか
+	/// </summary>
+	/// <param name="Expected">総当たりの結果</param>
+	/// <param name="Actual">BVH の結果（DynamicBvh は太らせた箱なので余分に返してよい）</param>
+	/// <param name="OutExtra">余分に返した数</param>
+	/// <returns>漏れた数</returns>
+	uint32_t CountMissed(const std::vector<uint32_t>& Expected, std::vector<uint32_t> Actual, uint64_t& OutExtra)
+	{
+		std::sort(Actual.begin(), Actual.end());
+		uint32_t missed = 0;
+		for (const uint32_t index : Expected)
+		{
+			missed += std::binary_search(Actual.begin(), Actual.end(), index) ? 0 : 1;
+		}
+		OutExtra += Actual.size() + missed - Expected.size();
+		return missed;
+	}
+
+	/// <summary>
+	/// StaticBvh と DynamicBvh の作成と問い合わせの速さを総当たりと比べる
+	/// 1辺 1000 の立方体に乱数で AABB を置き、原点から +z を向いた視錐台、乱数で置いた箱、乱数の光線で問い合わせる。
+	/// 総当たりで見つかった物を BVH が1つでも漏らすか、一番手前の当たりが総当たりと違ったら失敗にする。
+	/// 箱と光線は1つずつ問い合わせる版と、JobSystem で並列に行う Batch 版の両方を測る。
+	/// --count=<数>   : 物の数（既定は 100000）
+	/// --queries=<数> : 箱の問い合わせの数（既定は 1000）
+	/// --rays=<数>    : 光線の数（既定は 1000）
+	/// </summary>
+	int BenchBvh(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t count = 100000;
+		uint32_t queryCount = 1000;
+		uint32_t rayCount = 1000;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--count=")) count = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(8)))));
+			else if (option.starts_with("--queries=")) queryCount = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(10)))));
+			else if (option.starts_with("--rays=")) rayCount = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(7)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 5.0f);
+		std::uniform_real_distribution<float> queryExtent(10.0f, 20.0f);
+		std::vector<Graphics::Aabb> bounds(count);
+		for (Graphics::Aabb& box : bounds)
+		{
+			box = Graphics::Aabb::FromCenterExtents({ position(random), position(random), position(random) }, { extent(random), extent(random), extent(random) });
+		}
+		std::vector<Graphics::Aabb> queries(queryCount);
+		for (Graphics::Aabb& box : queries)
+		{
+			box = Graphics::Aabb::FromCenterExtents({ position(random), position(random), position(random) }, { queryExtent(random), queryExtent(random), queryExtent(random) });
+		}
+		std::normal_distribution<float> direction(0.0f, 1.0f);
+		std::vector<Graphics::Ray> rays(rayCount);
+		for (Graphics::Ray& ray : rays)
+		{
+			ray.Origin = { position(random), position(random), position(random) };
+			DirectX::XMStoreFloat3(&ray.Direction, DirectX::XMVector3Normalize(DirectX::XMVectorSet(direction(random), direction(random), direction(random), 0.0f)));
+		}
+
+		DirectX::XMFLOAT4X4 viewProjection;
+		const DirectX::XMMATRIX view = DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(view, DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f)));
+		const Graphics::Frustum frustum = Graphics::Frustum::FromViewProjection(viewProjection);
+
+		const auto elapsedMs = [](const auto& Start) { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count(); };
+		const auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+		std::printf("boxes=%u queries=%u rays=%u workers=%u\n", count, queryCount, rayCount, jobs != nullptr ? jobs->GetWorkerCount() : 0);
+
+		//	作成
+		Graphics::StaticBvh staticBvh;
+		staticBvh.Build(bounds);
+		std::printf("  build   static        %9.2f ms  nodes %u\n", staticBvh.GetLastBuildMs(), staticBvh.GetNodeCount());
+
+		Graphics::DynamicBvh dynamicBvh;
+		std::vector<uint32_t> proxies(count);
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			proxies[i] = dynamicBvh.CreateProxy(bounds[i], i);
+		}
+		std::printf("  build   dynamic       %9.2f ms  height %d\n", elapsedMs(start), dynamicBvh.GetHeight());
+
+		//	視錐台（総当たりは FrustumCuller の AABB と同じ判定）
+		std::vector<uint32_t> expected;
+		start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const DirectX::XMFLOAT3 center = bounds[i].Center();
+			const DirectX::XMFLOAT3 extents((bounds[i].Max.x - bounds[i].Min.x) * 0.5f, (bounds[i].Max.y - bounds[i].Min.y) * 0.5f, (bounds[i].Max.z - bounds[i].Min.z) * 0.5f);
+			bool isVisible = true;
+			for (const DirectX::XMFLOAT4& plane : frustum.Planes)
+			{
+				const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+				const float reach = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+				if (distance + reach < 0.0f)
+				{
+					isVisible = false;
+					break;
+				}
+			}
+			if (isVisible) expected.push_back(i);
+		}
+		const double bruteFrustumMs = elapsedMs(start);
+		std::printf("  frustum brute         %9.3f ms  visible %zu\n", bruteFrustumMs, expected.size());
+
+		uint32_t missed = 0;
+		std::vector<uint32_t> found;
+		const auto reportFrustum = [&](const char* Label, double Ms)
+			{
+				uint64_t extra = 0;
+				const uint32_t miss = CountMissed(expected, found, extra);
+				missed += miss;
+				std::printf("  frustum %-13s %9.3f ms  x%.1f  found %zu  extra %llu  missed %u\n",
+					Label, Ms, bruteFrustumMs / Ms, found.size(), static_cast<unsigned long long>(extra), miss);
+			};
+		start = std::chrono::steady_clock::now();
+		staticBvh.QueryFrustum(frustum, found);
+		reportFrustum("static", elapsedMs(start));
+		start = std::chrono::steady_clock::now();
+		dynamicBvh.QueryFrustum(frustum, found);
+		reportFrustum("dynamic", elapsedMs(start));
+
+		//	箱
+		std::vector<std::vector<uint32_t>> expectedBoxes(queryCount);
+		start = std::chrono::steady_clock::now();
+		for (uint32_t q = 0; q < queryCount; ++q)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (bounds[i].Overlaps(queries[q])) expectedBoxes[q].push_back(i);
+			}
+		}
+		const double bruteAabbMs = elapsedMs(start);
+		size_t overlapCount = 0;
+		for (const auto& result : expectedBoxes) overlapCount += result.size();
+		std::printf("  aabb    brute         %9.3f ms  overlaps %zu\n", bruteAabbMs, overlapCount);
+
+		std::vector<std::vector<uint32_t>> foundBoxes(queryCount);
+		const auto reportAabb = [&](const char* Label, double Ms)
+			{
+				uint64_t extra = 0;
+				uint32_t miss = 0;
+				for (uint32_t q = 0; q < queryCount; ++q)
+				{
+					miss += CountMissed(expectedBoxes[q], foundBoxes[q], extra);
+				}
+				missed += miss;
+				std::printf("  aabb    %-13s %9.3f ms  x%.1f  extra %llu  missed %u\n",
+					Label, Ms, bruteAabbMs / Ms, static_cast<unsigned long long>(extra), miss);
+			};
+		//	1スレッドで総当たりと比べる
+		start = std::chrono::steady_clock::now();
+		for (uint32_t q = 0; q < queryCount; ++q)
+		{
+			foundBoxes[q].clear();
+			staticBvh.QueryAabb(queries[q], foundBoxes[q]);
+		}
+		reportAabb("static", elapsedMs(start));
+		start = std::chrono::steady_clock::now();
+		for (uint32_t q = 0; q < queryCount; ++q)
+		{
+			foundBoxes[q].clear();
+			dynamicBvh.QueryAabb(queries[q], foundBoxes[q]);
+		}
+		reportAabb("dynamic", elapsedMs(start));
+
+		//	並列
+		start = std::chrono::steady_clock::now();
+		staticBvh.QueryAabbBatch(queries, foundBoxes);
+		reportAabb("static-batch", elapsedMs(start));
+		start = std::chrono::steady_clock::now();
+		dynamicBvh.QueryAabbBatch(queries, foundBoxes);
+		reportAabb("dynamic-batch", elapsedMs(start));
+
+		//	光線（総当たりは BVH と同じ slab 判定。DynamicBvh は太らせた箱で当てるので、総当たりも太らせた箱で行う）
+		const auto bruteRaycast = [&rays](const auto& GetBounds, uint32_t Count, std::vector<Graphics::RayHit>& Out)
+			{
+				const auto inv = [](float V) { return std::fabs(V) < 1.0e-30f ? std::copysign(1.0e30f, V) : 1.0f / V; };
+				for (uint32_t r = 0; r < rays.size(); ++r)
+				{
+					const Graphics::Ray& ray = rays[r];
+					const DirectX::XMFLOAT3 invDirection(inv(ray.Direction.x), inv(ray.Direction.y), inv(ray.Direction.z));
+					Graphics::RayHit hit;
+					for (uint32_t i = 0; i < Count; ++i)
+					{
+						const Graphics::Aabb& box = GetBounds(i);
+						const float tx1 = (box.Min.x - ray.Origin.x) * invDirection.x, tx2 = (box.Max.x - ray.Origin.x) * invDirection.x;
+						const float ty1 = (box.Min.y - ray.Origin.y) * invDirection.y, ty2 = (box.Max.y - ray.Origin.y) * invDirection.y;
+						const float tz1 = (box.Min.z - ray.Origin.z) * invDirection.z, tz2 = (box.Max.z - ray.Origin.z) * invDirection.z;
+						const float tMin = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+						const float tMax = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), ray.MaxT });
+						if (tMin <= tMax && tMin < hit.T)
+						{
+							hit.Index = i;
+							hit.T = tMin;
+						}
+					}
+					Out[r] = hit;
+				}
+			};
+		std::vector<Graphics::RayHit> expectedStaticHits(rayCount);
+		start = std::chrono::steady_clock::now();
+		bruteRaycast([&bounds](uint32_t I) -> const Graphics::Aabb& { return bounds[I]; }, count, expectedStaticHits);
+		const double bruteRayMs = elapsedMs(start);
+		std::vector<Graphics::RayHit> expectedDynamicHits(rayCount);
+		bruteRaycast([&](uint32_t I) -> const Graphics::Aabb& { return dynamicBvh.GetFatBounds(proxies[I]); }, count, expectedDynamicHits);
+		size_t hitCount = 0;
+		for (const Graphics::RayHit& hit : expectedStaticHits) hitCount += hit.IsHit() ? 1 : 0;
+		std::printf("  ray     brute         %9.3f ms  hits %zu\n", bruteRayMs, hitCount);
+
+		//	当たり外れと距離が合っていれば良い（同じ距離で当たる物が複数ある時はどれを返しても良い）
+		std::vector<Graphics::RayHit> foundHits(rayCount);
+		const auto reportRay = [&](const char* Label, double Ms, const std::vector<Graphics::RayHit>& Expected)
+			{
+				uint32_t wrong = 0;
+				for (uint32_t r = 0; r < rayCount; ++r)
+				{
+					if (Expected[r].IsHit() != foundHits[r].IsHit()) wrong++;
+					else if (Expected[r].IsHit() && Expected[r].Index != foundHits[r].Index &&
+						std::fabs(Expected[r].T - foundHits[r].T) > 1.0e-4f * std::max(1.0f, Expected[r].T)) wrong++;
+				}
+				missed += wrong;
+				std::printf("  ray     %-13s %9.3f ms  x%.1f  wrong %u\n", Label, Ms, bruteRayMs / Ms, wrong);
+			};
+		start = std::chrono::steady_clock::now();
+		for (uint32_t r = 0; r < rayCount; ++r)
+		{
+			foundHits[r] = staticBvh.Raycast(rays[r]);
+		}
+		reportRay("static", elapsedMs(start), expectedStaticHits);
+		start = std::chrono::steady_clock::now();
+		for (uint32_t r = 0; r < rayCount; ++r)
+		{
+			foundHits[r] = dynamicBvh.Raycast(rays[r]);
+		}
+		reportRay("dynamic", elapsedMs(start), expectedDynamicHits);
+		start = std::chrono::steady_clock::now();
+		staticBvh.RaycastBatch(rays, foundHits);
+		reportRay("static-batch", elapsedMs(start), expectedStaticHits);
+		start = std::chrono::steady_clock::now();
+		dynamicBvh.RaycastBatch(rays, foundHits);
+		reportRay("dynamic-batch", elapsedMs(start), expectedDynamicHits);
+
+		return missed == 0 ? 0 : 1;
+	}
+
+	/// <summary>
+	/// 乱数で描画の依頼を作る（2パス、1割が半透明、PSO 32種）
+	/// </summary>
+	/// <param name="Count">依頼の数</param>
+	/// <param name="MaterialCount">マテリアルの種類</param>
+	/// <param name="MeshCount">メッシュの種類</param>
+	std::vector<Graphics::DrawPacket> MakeBenchPackets(uint32_t Count, uint32_t MaterialCount, uint32_t MeshCount)
+	{
+		std::mt19937 random(12345);
+		std::uniform_int_distribution<uint32_t> pass(0, 1);
+		std::uniform_int_distribution<uint32_t> pso(0, 31);
+		std::uniform_int_distribution<uint32_t> material(0, MaterialCount - 1);
+		std::uniform_int_distribution<uint32_t> mesh(0, MeshCount - 1);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+		std::vector<Graphics::DrawPacket> packets(Count);
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			const bool isTranslucent = random() % 10 == 0;
+			packets[i].Key = Graphics::DrawKey::Make(pass(random), isTranslucent, pso(random), material(random), depth(random));
+			packets[i].Proxy = i;
+			packets[i].Mesh = mesh(random);
+		}
+		return packets;
+	}
+
+	/// <summary>
+	/// DrawQueue::Sort の基数ソートの速さを std::sort / std::stable_sort と比べる
+	/// 同じキーの依頼は積んだ順のままになるはずなので、std::stable_sort と並びが一致するかを確かめる。
+	/// それぞれ5回測って一番速い時間を出す。
+	/// 続けてマテリアルを 16 種に絞り、メッシュの種類を 16 / 256 / 4096 に変えて InstanceBatcher でまとめ、描画の数がどれだけ減るかを出す。
+	/// まとめた後の WriteInstances と、バッチごとに1回コールバックを呼ぶ記録の繰り返し（Record の GPU を使わない部分）の時間も測る。
+	/// --count=<数> : 依頼の数（既定は 200000）
+	/// </summary>
+	int BenchDrawQueue(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		uint32_t count = 200000;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--count=")) count = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(8)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		const std::vector<Graphics::DrawPacket> packets = MakeBenchPackets(count, 256, 4096);
+		const auto byKey = [](const Graphics::DrawPacket& A, const Graphics::DrawPacket& B) { return A.Key < B.Key; };
+		const auto best = [](const std::function<double()>& Func)
+			{
+				double bestMs = 0.0;
+				for (int i = 0; i < 5; ++i)
+				{
+					const double ms = Func();
+					if (i == 0 || ms < bestMs) bestMs = ms;
+				}
+				return bestMs;
+			};
+
+		Graphics::DrawQueue queue;
+		const double radixMs = best([&]()
+			{
+				queue.Clear();
+				for (const Graphics::DrawPacket& packet : packets) queue.Push(packet);
+				queue.Sort();
+				return queue.GetStats().SortMs;
+			});
+
+		std::vector<Graphics::DrawPacket> expected;
+		const double stableMs = best([&]()
+			{
+				expected = packets;
+				const auto start = std::chrono::steady_clock::now();
+				std::stable_sort(expected.begin(), expected.end(), byKey);
+				return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			});
+		std::vector<Graphics::DrawPacket> unstable;
+		const double sortMs = best([&]()
+			{
+				unstable = packets;
+				const auto start = std::chrono::steady_clock::now();
+				std::sort(unstable.begin(), unstable.end(), byKey);
+				return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			});
+
+		//	キーが同じなら積んだ順（Proxy の昇順）のままになっている
+		const std::span<const Graphics::DrawPacket> sorted = queue.GetPackets();
+		uint32_t mismatches = sorted.size() == expected.size() ? 0 : 1;
+		for (size_t i = 0; i < std::min(sorted.size(), expected.size()); ++i)
+		{
+			if (sorted[i].Key != expected[i].Key || sorted[i].Proxy != expected[i].Proxy || sorted[i].Mesh != expected[i].Mesh) mismatches++;
+		}
+
+		const Graphics::DrawQueueStats& stats = queue.GetStats();
+		const auto* jobs = System::ServiceLocator::Get<System::JobSystem>();
+		std::printf("packets=%u workers=%u radix passes=%u\n", count, jobs != nullptr ? jobs->GetWorkerCount() : 0, stats.RadixPasses);
+		std::printf("  radix       %8.3f ms  %8.1f Mpacket/s\n", radixMs, static_cast<double>(count) / 1.0e6 / (radixMs / 1000.0));
+		std::printf("  stable_sort %8.3f ms  x%.2f\n", stableMs, stableMs / radixMs);
+		std::printf("  sort        %8.3f ms  x%.2f\n", sortMs, sortMs / radixMs);
+		std::printf("  changes     pso %u -> %u  material %u -> %u  mesh %u -> %u\n",
+			stats.PsoChangesBefore, stats.PsoChanges, stats.MaterialChangesBefore, stats.MaterialChanges, stats.MeshChangesBefore, stats.MeshChanges);
+		std::printf("  matches stable_sort: %s (%u mismatches)\n", mismatches == 0 ? "yes" : "no", mismatches);
+
+		//	Build は描画対象の中身を読まず、WriteInstances はワールド行列だけを読む（_41 に添字を入れて写し先を確かめる）
+		Graphics::RenderProxyBuffer proxies;
+		proxies.World.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			DirectX::XMStoreFloat4x4(&proxies.World[i], DirectX::XMMatrixIdentity());
+			proxies.World[i]._41 = static_cast<float>(i);
+		}
+		Graphics::InstanceBatcher batcher;
+		std::vector<Graphics::InstanceData> instanceData(count);
+		for (const uint32_t meshCount : { 16u, 256u, 4096u })
+		{
+			const std::vector<Graphics::DrawPacket> meshPackets = MakeBenchPackets(count, 16, meshCount);
+			queue.Clear();
+			for (const Graphics::DrawPacket& packet : meshPackets) queue.Push(packet);
+			queue.Sort();
+			batcher.Build(queue.GetPackets(), proxies);
+
+			//	全ての依頼がちょうど1回ずつどれかのバッチに入っている
+			uint32_t instances = 0;
+			for (const Graphics::InstanceBatch& batch : batcher.GetBatches()) instances += batch.InstanceCount;
+			mismatches += instances == count ? 0 : 1;
+
+			const double writeMs = best([&]()
+				{
+					const auto start = std::chrono::steady_clock::now();
+					batcher.WriteInstances(instanceData.data());
+					return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				});
+
+			//	どのプロキシもちょうど1回ずつ書かれている
+			std::vector<uint8_t> written(count, 0);
+			uint32_t wrongInstances = 0;
+			for (uint32_t i = 0; i < batcher.GetInstanceCount(); ++i)
+			{
+				const uint32_t proxy = static_cast<uint32_t>(instanceData[i].World._41);
+				if (proxy >= count || written[proxy]++ != 0) wrongInstances++;
+			}
+			mismatches += wrongInstances;
+
+			//	Record と同じくバッチごとにアドレスを決めてコールバックを1回呼ぶ（コマンドリストへの記録の代わりに数えるだけ）
+			uint64_t recorded = 0;
+			const std::function<void(uint64_t, const Graphics::InstanceBatch&)> drawFunc = [&recorded](uint64_t Address, const Graphics::InstanceBatch& Batch)
+				{
+					recorded += Address + Batch.Mesh + Batch.InstanceCount;
+				};
+			const double recordMs = best([&]()
+				{
+					recorded = 0;
+					const auto start = std::chrono::steady_clock::now();
+					for (const Graphics::InstanceBatch& batch : batcher.GetBatches())
+					{
+						drawFunc(static_cast<uint64_t>(batch.FirstInstance) * sizeof(Graphics::InstanceData), batch);
+					}
+					return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				});
+
+			const Graphics::InstanceBatchStats& batchStats = batcher.GetStats();
+			std::printf("  meshes %4u  packets %u -> batches %u  (x%.1f)  largest %u  build %.3f ms  write %.3f ms  record %.3f ms%s\n",
+				meshCount, batchStats.PacketCount, batchStats.BatchCount,
+				static_cast<double>(batchStats.PacketCount) / std::max(batchStats.BatchCount, 1u), batchStats.LargestBatch, batchStats.BuildMs,
+				writeMs, recordMs, instances == count && wrongInstances == 0 ? "" : "  LOST INSTANCES");
+		}
+		return mismatches == 0 ? 0 : 1;
+	}
+
+	/// <summary>
+	/// 半径 1 の UV 球（三角形は 2 * Slices * (Stacks - 1) 個、時計回りが表）
+	/// </summary>
+	void MakeBenchSphere(uint32_t Slices, uint32_t Stacks, Graphics::MeshAssetData& OutData)
+	{
+		constexpr float PI = 3.14159265358979f;
+		OutData.Positions.push_back(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+		for (uint32_t stack = 1; stack < Stacks; ++stack)
+		{
+			const float theta = PI * static_cast<float>(stack) / static_cast<float>(Stacks);
+			for (uint32_t slice = 0; slice < Slices; ++slice)
+			{
+				const float phi = 2.0f * PI * static_cast<float>(slice) / static_cast<float>(Slices);
+				OutData.Positions.push_back(DirectX::XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+			}
+		}
+		const uint32_t south = static_cast<uint32_t>(OutData.Positions.size());
+		OutData.Positions.push_back(DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f));
+
+		auto ring = [Slices](uint32_t Stack, uint32_t Slice) { return 1 + (Stack - 1) * Slices + Slice % Slices; };
+		for (uint32_t slice = 0; slice < Slices; ++slice)
+		{
+			OutData.Indices.insert(OutData.Indices.end(), { 0, ring(1, slice + 1), ring(1, slice) });
+		}
+		for (uint32_t stack = 1; stack + 1 < Stacks; ++stack)
+		{
+			for (uint32_t slice = 0; slice < Slices; ++slice)
+			{
+				OutData.Indices.insert(OutData.Indices.end(), { ring(stack, slice), ring(stack, slice + 1), ring(stack + 1, slice) });
+				OutData.Indices.insert(OutData.Indices.end(), { ring(stack, slice + 1), ring(stack + 1, slice + 1), ring(stack + 1, slice) });
+			}
+		}
+		for (uint32_t slice = 0; slice < Slices; ++slice)
+		{
+			OutData.Indices.insert(OutData.Indices.end(), { ring(Stacks - 1, slice), ring(Stacks - 1, slice + 1), south });
+		}
+	}
+
+	/// <summary>
+	/// MeshletBuilder の分割と MeshletCulling の速さと捨てられる割合を測る
+	/// 既定では 262144 三角形の球を使う。カメラはメッシュを包む球の外から中心の近くを向ける。
+	/// --obj=<入力.obj> : 球の代わりに OBJ を使う
+	/// --cameras=<数>   : カメラの数（既定は 40）
+	/// </summary>
+	int BenchMeshlets(const std::vector<std::string_view>&, const std::vector<std::string_view>& Options)
+	{
+		std::filesystem::path input;
+		uint32_t cameraCount = 40;
+		for (const std::string_view option : Options)
+		{
+			if (option.starts_with("--obj=")) input = std::filesystem::path(option.substr(6));
+			else if (option.starts_with("--cameras=")) cameraCount = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(option.substr(10)))));
+			else
+			{
+				std::fprintf(stderr, "unknown option %.*s\n", static_cast<int>(option.size()), option.data());
+				return 1;
+			}
+		}
+
+		Graphics::MeshAssetData data;
+		if (input.empty()) MakeBenchSphere(512, 257, data);
+		else if (Graphics::ObjImporter::Load(input, data) == false)
+		{
+			std::fprintf(stderr, "failed to load %s\n", input.string().c_str());
+			return 1;
+		}
+
+		//	3回分割して一番速い時間を出す
+		Graphics::MeshletMesh mesh;
+		Graphics::MeshletBuildStats stats;
+		double buildMs = 0.0;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (Graphics::MeshletBuilder::Build(data.Positions, data.Indices, mesh, &stats) == false)
+			{
+				std::fprintf(stderr, "failed to build meshlets\n");
+				return 1;
+			}
+			if (i == 0 || stats.ElapsedMs < buildMs) buildMs = stats.ElapsedMs;
+		}
+		std::printf("%s: vertices=%zu triangles=%u\n", input.empty() ? "sphere" : input.string().c_str(), data.Positions.size(), stats.TriangleCount);
+		std::printf("  build    %8.2f ms  %8.1f Mtri/s  meshlets %u  avg vertices %.1f  avg triangles %.1f  cones %u\n",
+			buildMs, static_cast<double>(stats.TriangleCount) / 1.0e6 / (buildMs / 1000.0),
+			stats.MeshletCount, stats.AverageVertices, stats.AverageTriangles, stats.ConeCount);
+
+		//	メッシュを包む球
+		DirectX::XMVECTOR minimum = DirectX::XMVectorReplicate(FLT_MAX);
+		DirectX::XMVECTOR maximum = DirectX::XMVectorReplicate(-FLT_MAX);
+		for (const DirectX::XMFLOAT3& position : data.Positions)
+		{
+			minimum = DirectX::XMVectorMin(minimum, DirectX::XMLoadFloat3(&position));
+			maximum = DirectX::XMVectorMax(maximum, DirectX::XMLoadFloat3(&position));
+		}
+		const DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(minimum, maximum), 0.5f);
+		const float radius = std::max(DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(maximum, minimum))) * 0.5f, 1e-3f);
+
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> distance(1.6f, 6.0f);
+		std::uniform_real_distribution<float> fov(20.0f, 80.0f);
+
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixIdentity());
+		const uint32_t meshletCount = static_cast<uint32_t>(mesh.Meshlets.size());
+		std::vector<Graphics::MeshletCullConstants> cameras;
+		for (uint32_t i = 0; i < cameraCount; ++i)
+		{
+			DirectX::XMVECTOR direction = DirectX::XMVectorZero();
+			while (DirectX::XMVectorGetX(DirectX::XMVector3Length(direction)) < 0.1f)
+			{
+				direction = DirectX::XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+			}
+			const DirectX::XMVECTOR eye = DirectX::XMVectorAdd(center, DirectX::XMVectorScale(DirectX::XMVector3Normalize(direction), distance(random) * radius));
+			const DirectX::XMVECTOR target = DirectX::XMVectorAdd(center, DirectX::XMVectorScale(DirectX::XMVectorSet(unit(random), unit(random), unit(random), 0.0f), radius * 0.5f));
+			const DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH(eye, target, DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			const DirectX::XMMATRIX projection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(fov(random)), 16.0f / 9.0f, radius * 0.01f, radius * 100.0f);
+
+			DirectX::XMFLOAT4X4 viewProjection;
+			DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(view, projection));
+			DirectX::XMFLOAT3 cameraPosition;
+			DirectX::XMStoreFloat3(&cameraPosition, eye);
+			cameras.push_back(Graphics::MeshletCulling::MakeConstants(world, Graphics::Frustum::FromViewProjection(viewProjection), cameraPosition, meshletCount));
+		}
+
+		//	視錐台だけ、コーンだけ、両方でそれぞれ捨てた割合と 1 カメラあたりの時間
+		constexpr int REPEAT = 10;
+		std::vector<uint32_t> visible;
+		for (const auto& [label, flags] : { std::pair<const char*, uint32_t>("frustum", Graphics::MESHLET_CULL_FLAG_FRUSTUM), std::pair<const char*, uint32_t>("cone", Graphics::MESHLET_CULL_FLAG_CONE),
+			std::pair<const char*, uint32_t>("both", Graphics::MESHLET_CULL_FLAG_FRUSTUM | Graphics::MESHLET_CULL_FLAG_CONE) })
+		{
+			uint64_t visibleTotal = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (int repeat = 0; repeat < REPEAT; ++repeat)
+			{
+				for (Graphics::MeshletCullConstants constants : cameras)
+				{
+					constants.Flags = flags;
+					visibleTotal += Graphics::MeshletCulling::Cull(mesh.Bounds, constants, visible);
+				}
+			}
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			const double perCameraUs = ms * 1000.0 / static_cast<double>(REPEAT * cameraCount);
+			const double culled = 100.0 * (1.0 - static_cast<double>(visibleTotal) / (static_cast<double>(meshletCount) * REPEAT * cameraCount));
+			std::printf("  cull %-8s %8.2f us/camera  %8.1f Mmeshlet/s  culled %5.1f%%\n",
+				label, perCameraUs, static_cast<double>(meshletCount) / perCameraUs, culled);
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// 使えるコマンドの一覧
+	/// </summary>
+	const std::vector<CookCommand>& GetCommands()
+	{
+		static const std::vector<CookCommand> commands = {
+			{ "mesh", "mesh <input.obj> <output.emesh> [--no-optimize] [--quantize]", 2, CookMesh },
+			{ "texture", "texture <input> <output.dds> [--bc1|--bc3|--bc4|--bc5|--bc7] [--linear] [--no-mips] [--portable] [--cache=<dir>|--no-cache]", 2, CookTexture },
+			{ "pack", "pack <input dir> <output.epak> [--store]", 2, Pack },
+			{ "bench-pack", "bench-pack <input.epak> [--loose=<dir>]", 1, BenchPack },
+			{ "bench-mesh", "bench-mesh <input.emesh> [--repeat=<n>]", 1, BenchMesh },
+			{ "bench-io", "bench-io <input dir> [--threads] [--depth=<n>]", 1, BenchIO },
+			{ "bench-jobs", "bench-jobs [--workers=<n>] [--count=<n>]", 0, BenchJobs },
+			{ "bench-waits", "bench-waits [--workers=<n>] [--chains=<n>] [--latency=<ms>]", 0, BenchWaits },
+			{ "bench-pipeline", "bench-pipeline [--frames=<n>] [--game=<ms>] [--render=<ms>] [--jitter=<%>]", 0, BenchPipeline },
+			{ "bench-systems", "bench-systems [--workers=<n>] [--entities=<n>]", 0, BenchSystems },
+			{ "bench-meshlets", "bench-meshlets [--obj=<input.obj>] [--cameras=<n>]", 0, BenchMeshlets },
+			{ "bench-cull", "bench-cull [--count=<n>] [--shape=sphere|aabb]", 0, BenchCull },
+			{ "bench-occlusion", "bench-occlusion [--count=<n>] [--occluders=<n>]", 0, BenchOcclusion },
+			{ "bench-bvh", "bench-bvh [--count=<n>] [--queries=<n>] [--rays=<n>]", 0, BenchBvh },
+			{ "bench-drawqueue", "bench-drawqueue [--count=<n>]", 0, BenchDrawQueue },
+		};
+		return commands;
+	}
+
+	/// <summary>
+	/// 使い方の表示
+	/// </summary>
+	void PrintUsage()
+	{
+		std::printf("usage:\n");
+		for (const CookCommand& command : GetCommands())
+		{
+			std::printf("  AssetCooker %.*s\n", static_cast<int>(command.Usage.size()), command.Usage.data());
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string_view name(argv[1]);
+	std::vector<std::string_view> arguments;
+	std::vector<std::string_view> options;
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string_view argument(argv[i]);
+		(argument.starts_with("--") ? options : arguments).push_back(argument);
+	}
+
+	for (const CookCommand& command : GetCommands())
+	{
+		if (command.Name != name) continue;
+		if (arguments.size() != command.ArgumentCount)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		//	圧縮と展開はブロックの行やチャンクごとにワーカーへ分ける
+		System::Logger::Create();
+		System::JobSystem::Create();
+		System::ServiceLocator::Get<System::JobSystem>()->Initialize();
+		const int result = command.Run(arguments, options);
+		System::JobSystem::Release();
+		System::Logger::Release();
+		return result;
+	}
+
+	PrintUsage();
+	return 1;
+}
@@ -0,0 +1,45 @@
+# DirectXMath（ヘッダーだけ）の場所を決めて、ecse_directxmath を作る。
+# ECSE_DIRECTXMATH_INCLUDE_DIR に DirectXMath.h のあるフォルダを渡せばそれを使う。
+# 無ければ GitHub から DirectXMath と、Windows 以外で要る sal.h の入った DirectX-Headers を取ってくる。
+set(ECSE_DIRECTXMATH_INCLUDE_DIR "" CACHE PATH "DirectXMath.h のあるフォルダ（空なら取ってくる）")
+set(ECSE_DIRECTXMATH_TAG "feb2024" CACHE STRING "取ってくる DirectXMath のタグ")
+set(ECSE_DIRECTX_HEADERS_TAG "v1.613.1" CACHE STRING "取ってくる DirectX-Headers のタグ（sal.h 用）")
+
+add_library(ecse_directxmath INTERFACE)
+
+if(ECSE_DIRECTXMATH_INCLUDE_DIR)
+	if(NOT EXISTS "${ECSE_DIRECTXMATH_INCLUDE_DIR}/DirectXMath.h")
+		message(FATAL_ERROR "DirectXMath.h not found in ${ECSE_DIRECTXMATH_INCLUDE_DIR}")
+	endif()
+	target_include_directories(ecse_directxmath SYSTEM INTERFACE "${ECSE_DIRECTXMATH_INCLUDE_DIR}")
+	return()
+endif()
+
+find_path(ECSE_SYSTEM_DIRECTXMATH DirectXMath.h PATH_SUFFIXES directxmath)
+if(ECSE_SYSTEM_DIRECTXMATH)
+	target_include_directories(ecse_directxmath SYSTEM INTERFACE "${ECSE_SYSTEM_DIRECTXMATH}")
+	return()
+endif()
+
+include(FetchContent)
+FetchContent_Declare(directxmath
+	GIT_REPOSITORY https://github.com/microsoft/DirectXMath.git
+	GIT_TAG ${ECSE_DIRECTXMATH_TAG}
+	GIT_SHALLOW TRUE)
+FetchContent_Declare(directx_headers
+	GIT_REPOSITORY https://github.com/microsoft/DirectX-Headers.git
+	GIT_TAG ${ECSE_DIRECTX_HEADERS_TAG}
+	GIT_SHALLOW TRUE)
+# どちらもヘッダーを使うだけなので、向こうの CMakeLists は読まない
+FetchContent_GetProperties(directxmath)
+if(NOT directxmath_POPULATED)
+	FetchContent_Populate(directxmath)
+endif()
+FetchContent_GetProperties(directx_headers)
+if(NOT directx_headers_POPULATED)
+	FetchContent_Populate(directx_headers)
+endif()
+
+target_include_directories(ecse_directxmath SYSTEM INTERFACE
+	"${directxmath_SOURCE_DIR}/Inc"
+	"${directx_headers_SOURCE_DIR}/include/wsl/stubs")